@@ -0,0 +1,85 @@
+/// @file agent_order.cpp
+/// @brief Benchmarks of the order of the act loop, context order against Morton order
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "coordinates.hpp"
+#include "fixtures.hpp"
+#include "harness.hpp"
+#include "morton.hpp"
+#include "spatial_index.hpp"
+
+namespace {
+
+// A large building, so the index and the plan don't fit in the L2 cache
+constexpr auto width  = 1000;
+constexpr auto height = 600;
+
+/// @brief Agents spread uniformly over the grid, the plan tiles and the index
+struct order_fixture {
+    sti::spatial_index                    index { width, height };
+    std::vector<std::uint8_t>             tiles;
+    std::vector<sti::coordinates<double>> agents;
+
+    /// @param agents_per_cell The density of agents
+    /// @param morton Sort the agents by the Morton code of their cell, as
+    /// space_wrapper::snapshot with agents.order = morton, instead of leaving
+    /// them in the creation order, unrelated to the location
+    order_fixture(double agents_per_cell, bool morton)
+        : tiles(static_cast<std::size_t>(width * height))
+    {
+        auto       rng    = sti::bench::input_rng { 11 };
+        const auto random = [&](int max) { return static_cast<double>(rng(static_cast<std::uint32_t>(max) * 1000U)) / 1000.0; };
+
+        const auto n = static_cast<std::size_t>(agents_per_cell * width * height);
+        for (auto i = std::size_t { 0 }; i < n; ++i) agents.push_back({ random(width), random(height) });
+        for (auto& t : tiles) t = static_cast<std::uint8_t>(rng(4));
+
+        if (morton) {
+            std::stable_sort(agents.begin(), agents.end(), [](const auto& lho, const auto& rho) {
+                return sti::morton_code(lho.discrete()) < sti::morton_code(rho.discrete());
+            });
+        }
+
+        for (const auto& loc : agents) index.add(nullptr, loc);
+        index.build();
+    }
+};
+
+/// @brief The memory accesses of a tick of the act loop: the tile of each
+/// agent in the plan and the agents around it, in the infection stage
+/// @details The time difference comes from the cache misses, the work is the
+/// same in both orders. The misses themselves can be read running the
+/// benchmark under perf stat -e l2_rqsts.miss (or the counter of the machine)
+/// @param agents_per_cell The density of agents
+/// @param morton Iterate the agents in Morton order
+sti::bench::kernel act_loop(double agents_per_cell, bool morton)
+{
+    auto fixture = std::make_shared<order_fixture>(agents_per_cell, morton);
+
+    return [fixture](std::size_t iterations) {
+        auto contacts = std::size_t { 0 };
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            for (const auto& p : fixture->agents) {
+                const auto cell = p.discrete();
+                contacts += fixture->tiles[static_cast<std::size_t>(cell.y * width + cell.x)];
+                fixture->index.for_each_around(cell, 1, [&](sti::contagious_agent* /*unused*/, const sti::coordinates<double>& loc) {
+                    const auto [x, y] = loc - p;
+                    if (!(x * x + y * y > 1.0)) ++contacts;
+                });
+            }
+            sti::bench::do_not_optimize(contacts);
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "space/act_order/density_0.05/context", []() { return act_loop(0.05, false); } },
+    { "space/act_order/density_0.05/morton", []() { return act_loop(0.05, true); } },
+    { "space/act_order/density_0.5/context", []() { return act_loop(0.5, false); } },
+    { "space/act_order/density_0.5/morton", []() { return act_loop(0.5, true); } },
+};
+
+} // namespace
@@ -0,0 +1,77 @@
+/// @file agent_package.cpp
+/// @brief Benchmarks of the serialization of the migrating agents
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/packed_iarchive.hpp>
+#include <boost/mpi/packed_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <memory>
+#include <vector>
+
+#include "agent_package.hpp"
+#include "agent_wire.hpp"
+#include "harness.hpp"
+
+namespace {
+
+/// @brief Packages as sent by the Repast synchronization
+/// @param n The number of packages
+/// @param sections The sections of the wire sent
+std::vector<agent_package> packages(std::size_t n, std::uint8_t sections)
+{
+    auto out = std::vector<agent_package> {};
+    for (auto i = std::size_t { 0 }; i < n; ++i) {
+        auto p     = agent_package {};
+        p.id       = repast::AgentId { static_cast<int>(i), 0, 1, 0 };
+        p.sections = sections;
+        p.wire     = sti::agent_wire {};
+        out.push_back(p);
+    }
+    return out;
+}
+
+/// @brief Serialize a batch of packages into an MPI archive
+sti::bench::kernel serialize(std::size_t n, std::uint8_t sections)
+{
+    auto batch = std::make_shared<std::vector<agent_package>>(packages(n, sections));
+    return [batch](std::size_t iterations) {
+        const auto world = boost::mpi::communicator {};
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            auto buffer = boost::mpi::packed_oarchive::buffer_type {};
+            auto oa     = boost::mpi::packed_oarchive { world, buffer };
+            oa << *batch;
+            sti::bench::do_not_optimize(buffer);
+        }
+    };
+}
+
+/// @brief Deserialize a batch of packages from an MPI archive
+sti::bench::kernel deserialize(std::size_t n, std::uint8_t sections)
+{
+    const auto world  = boost::mpi::communicator {};
+    auto       buffer = std::make_shared<boost::mpi::packed_oarchive::buffer_type>();
+    {
+        const auto batch = packages(n, sections);
+        auto       oa    = boost::mpi::packed_oarchive { world, *buffer };
+        oa << batch;
+    }
+
+    return [buffer, world](std::size_t iterations) {
+        auto batch = std::vector<agent_package> {};
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            auto ia = boost::mpi::packed_iarchive { world, *buffer };
+            ia >> batch;
+            sti::bench::do_not_optimize(batch);
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "agent_package/serialize/all/1", []() { return serialize(1, sti::wire_section::ALL); } },
+    { "agent_package/serialize/all/256", []() { return serialize(256, sti::wire_section::ALL); } },
+    { "agent_package/serialize/infection/256", []() { return serialize(256, sti::wire_section::INFECTION); } },
+    { "agent_package/deserialize/all/1", []() { return deserialize(1, sti::wire_section::ALL); } },
+    { "agent_package/deserialize/all/256", []() { return deserialize(256, sti::wire_section::ALL); } },
+    { "agent_package/deserialize/infection/256", []() { return deserialize(256, sti::wire_section::INFECTION); } },
+};
+
+} // namespace
@@ -0,0 +1,97 @@
+/// @file fixtures.hpp
+/// @brief Synthetic inputs shared by the benchmarks
+#pragma once
+
+#include <boost/json.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "coordinates.hpp"
+
+namespace sti {
+namespace bench {
+
+    /// @brief Doctor specialties of the synthetic hospital
+    const auto specialties = std::vector<std::string> { "general_practitioner", "psychiatry", "surgery" };
+
+    /// @brief Create a hospital description, with walls and a room for each element
+    /// @details The border is walled, and the inner vertical walls every 10
+    /// columns have a single door, alternating top and bottom, so the paths
+    /// across the building zigzag
+    /// @param width The width of the building, at least 40
+    /// @param height The height of the building, at least 20
+    /// @return The JSON, as loaded from the hospital file
+    inline boost::json::object synthetic_hospital(int width, int height)
+    {
+        const auto point = [](int x, int y) {
+            return boost::json::value_from(coordinates<int> { x, y });
+        };
+
+        auto walls = boost::json::array {};
+        for (auto x = 0; x < width; ++x) {
+            walls.push_back(point(x, 0));
+            walls.push_back(point(x, height - 1));
+        }
+        for (auto y = 1; y < height - 1; ++y) {
+            walls.push_back(point(0, y));
+            walls.push_back(point(width - 1, y));
+        }
+        for (auto x = 10; x < width - 1; x += 10) {
+            const auto door = (x / 10) % 2 == 0 ? 1 : height - 2;
+            for (auto y = 1; y < height - 1; ++y) {
+                if (y != door) walls.push_back(point(x, y));
+            }
+        }
+
+        auto chairs = boost::json::array {};
+        for (auto x = 2; x < 9; ++x) chairs.push_back(point(x, height - 3));
+
+        auto triages = boost::json::array {};
+        triages.push_back({ { "patient_location", point(5, 5) } });
+
+        auto receptionists = boost::json::array {};
+        receptionists.push_back({ { "receptionist_location", point(3, 2) }, { "patient_location", point(3, 3) } });
+
+        // Three doctors per specialty, in the middle row, out of the walls
+        auto doctors = boost::json::array {};
+        auto x       = 12;
+        for (const auto& specialty : specialties) {
+            for (auto d = 0; d < 3; ++d, x += 2) {
+                if (x % 10 == 0) ++x;
+                doctors.push_back({ { "doctor_location", point(x, height / 2) },
+                                    { "patient_location", point(x, height / 2 + 1) },
+                                    { "specialty", specialty } });
+            }
+        }
+
+        return {
+            { "building", {
+                              { "width", width },
+                              { "height", height },
+                              { "walls", walls },
+                              { "chairs", chairs },
+                              { "entry", point(1, 1) },
+                              { "exit", point(1, height - 2) },
+                              { "triages", triages },
+                              { "icu", point(width - 2, 1) },
+                              { "receptionists", receptionists },
+                              { "doctors", doctors },
+                          } },
+        };
+    }
+
+    /// @brief A pseudo-random generator for the inputs, reproducible across runs
+    struct input_rng {
+        std::uint64_t state;
+
+        /// @brief Get a value in [0, n)
+        std::uint32_t operator()(std::uint32_t n)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<std::uint32_t>((state >> 33U) % n);
+        }
+    };
+
+} // namespace bench
+} // namespace sti
@@ -0,0 +1,131 @@
+/// @file harness.cpp
+/// @brief Minimal micro-benchmark harness of the sti-bench target
+#include "harness.hpp"
+
+#include <algorithm>
+#include <boost/mpi/environment.hpp>
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/// @brief All the registered benchmarks, sorted by name
+std::map<std::string, sti::bench::kernel_factory>& registry()
+{
+    static auto benchmarks = std::map<std::string, sti::bench::kernel_factory> {};
+    return benchmarks;
+}
+
+/// @brief Options of the command line
+struct options {
+    std::string filter {};
+    double      min_time_s { 0.05 };
+    std::size_t repetitions { 5 };
+    bool        csv {};
+};
+
+/// @brief Parse the command line
+/// @details --filter=<substring>, --min-time=<seconds>, --repetitions=<n>, --csv
+options parse(int argc, char** argv)
+{
+    auto opts = options {};
+    for (auto i = 1; i < argc; ++i) {
+        const auto arg   = std::string { argv[i] };
+        const auto value = [&](const std::string& key) { return arg.substr(key.size()); };
+
+        if (arg.rfind("--filter=", 0) == 0) opts.filter = value("--filter=");
+        if (arg.rfind("--min-time=", 0) == 0) opts.min_time_s = boost::lexical_cast<double>(value("--min-time="));
+        if (arg.rfind("--repetitions=", 0) == 0) opts.repetitions = boost::lexical_cast<std::size_t>(value("--repetitions="));
+        if (arg == "--csv") opts.csv = true;
+    }
+    return opts;
+}
+
+/// @brief Time one batch of a kernel, in seconds
+double time_batch(const sti::bench::kernel& k, std::size_t iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    k(iterations);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/// @brief The result of a benchmark
+struct result {
+    std::size_t iterations;
+    double      median_ns;
+    double      min_ns;
+};
+
+/// @brief Run a benchmark: find a batch size lasting at least the minimum
+/// time, then run the batch several times
+result measure(const sti::bench::kernel& k, const options& opts)
+{
+    auto iterations = std::size_t { 1 };
+    while (true) {
+        const auto elapsed = time_batch(k, iterations);
+        if (elapsed >= opts.min_time_s || iterations >= (std::size_t { 1 } << 30U)) break;
+
+        // Grow towards the minimum time, at most 10x per step
+        const auto factor = elapsed <= 0 ? 10.0 : std::min(10.0, 1.4 * opts.min_time_s / elapsed);
+        iterations        = std::max(iterations + 1, static_cast<std::size_t>(static_cast<double>(iterations) * factor));
+    }
+
+    auto per_op = std::vector<double> {};
+    for (auto r = std::size_t { 0 }; r < std::max(opts.repetitions, std::size_t { 1 }); ++r) {
+        per_op.push_back(time_batch(k, iterations) * 1e9 / static_cast<double>(iterations));
+    }
+    std::sort(per_op.begin(), per_op.end());
+    return { iterations, per_op[per_op.size() / 2], per_op.front() };
+}
+
+} // namespace
+
+/// @brief Register a benchmark
+/// @param name The name of the benchmark, with / separating the groups
+/// @param factory Creates the kernel, called only if the benchmark runs
+void sti::bench::add(const std::string& name, kernel_factory factory)
+{
+    registry()[name] = std::move(factory);
+}
+
+/// @brief Run the benchmarks matching the filter, and print the time per iteration
+int main(int argc, char** argv)
+{
+    // Some kernels use the MPI archives, a single process is enough
+    boost::mpi::environment env(argc, argv);
+
+    const auto opts = parse(argc, argv);
+    if (opts.csv) {
+        std::cout << "benchmark,iterations,median_ns,min_ns\n";
+    } else {
+        std::cout << std::left << std::setw(48) << "benchmark"
+                  << std::right << std::setw(12) << "iterations"
+                  << std::setw(16) << "median ns/op"
+                  << std::setw(16) << "min ns/op" << '\n';
+    }
+
+    for (const auto& [name, factory] : registry()) {
+        if (name.find(opts.filter) == std::string::npos) continue;
+
+        const auto k = factory();
+        const auto r = measure(k, opts);
+        if (opts.csv) {
+            std::cout << name << ',' << r.iterations << ',' << r.median_ns << ',' << r.min_ns << '\n';
+        } else {
+            std::cout << std::left << std::setw(48) << name
+                      << std::right << std::setw(12) << r.iterations
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(16) << r.median_ns
+                      << std::setw(16) << r.min_ns << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/// @file harness.hpp
+/// @brief Minimal micro-benchmark harness of the sti-bench target
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace sti {
+namespace bench {
+
+    /// @brief Runs a benchmark some number of times
+    /// @details Receives the number of iterations of one batch, the harness
+    /// measures the time of the whole call
+    using kernel = std::function<void(std::size_t iterations)>;
+
+    /// @brief Creates the kernel, the setup is not measured
+    using kernel_factory = std::function<kernel()>;
+
+    /// @brief Register a benchmark
+    /// @param name The name of the benchmark, with / separating the groups
+    /// @param factory Creates the kernel, called only if the benchmark runs
+    void add(const std::string& name, kernel_factory factory);
+
+    /// @brief Registers a benchmark at static initialization
+    struct registrar {
+        registrar(const std::string& name, kernel_factory factory)
+        {
+            add(name, std::move(factory));
+        }
+    };
+
+    /// @brief Keep the compiler from removing a value that is never used
+    /// @param value The value
+    template <typename T>
+    inline void do_not_optimize(T& value)
+    {
+        asm volatile(""
+                     :
+                     : "r,m"(value)
+                     : "memory");
+    }
+
+} // namespace bench
+} // namespace sti
@@ -0,0 +1,145 @@
+/// @file managers.cpp
+/// @brief Benchmarks of the manager protocols over an emulated network
+#include <boost/mpi/communicator.hpp>
+#include <memory>
+#include <repast_hpc/AgentId.h>
+#include <vector>
+
+#include "clock.hpp"
+#include "doctors/proxy_doctors.hpp"
+#include "doctors/real_doctors.hpp"
+#include "emulated_network.hpp"
+#include "fixtures.hpp"
+#include "harness.hpp"
+#include "hospital_plan.hpp"
+#include "manager_exchange.hpp"
+#include "queue_manager/proxy_queue_manager.hpp"
+#include "queue_manager/real_queue_manager.hpp"
+
+namespace {
+
+/// @brief A cluster network: a few microseconds and 10 GB/s per process
+constexpr auto cluster_link = sti::emulated_network::link { 2e-6, 10e9, true };
+
+/// @brief The id of the patient of a process entering in a tick
+repast::AgentId patient(std::size_t tick, int rank)
+{
+    return { static_cast<int>(tick), rank, 1, rank };
+}
+
+/// @brief The virtual processes, each one with its managers and exchange
+/// @details The real managers are in the process 0, the rest have proxies
+struct virtual_processes {
+    sti::emulated_network                               network;
+    boost::mpi::communicator                            self { MPI_COMM_SELF, boost::mpi::comm_attach };
+    std::vector<std::unique_ptr<sti::manager_exchange>> exchanges;
+    std::vector<sti::manager_exchange*>                 order;
+    std::size_t                                         tick {};
+
+    virtual_processes(int processes, sti::emulated_network::link l)
+        : network { processes, l }
+    {
+        for (auto p = 0; p < processes; ++p) {
+            exchanges.push_back(std::make_unique<sti::manager_exchange>(network.transport(p)));
+            order.push_back(exchanges.back().get());
+        }
+    }
+};
+
+/// @brief A reception queue fed by all the processes
+/// @details Each tick every process enqueues a patient, the one that entered
+/// some ticks earlier leaves, and the managers are exchanged
+/// @param processes The number of virtual processes
+/// @param l The link between the processes
+sti::bench::kernel queue_exchange(int processes, sti::emulated_network::link l)
+{
+    constexpr auto waiting = std::size_t { 8 };
+
+    struct fixture : virtual_processes {
+        std::vector<std::unique_ptr<sti::queue_manager>> queues;
+
+        fixture(int n, sti::emulated_network::link link)
+            : virtual_processes { n, link }
+        {
+            const auto boxes = std::vector<sti::coordinates<double>> { { 3, 3 }, { 5, 3 } };
+            queues.push_back(std::make_unique<sti::real_queue_manager>(&self, 0, boxes));
+            for (auto p = 1; p < n; ++p) queues.push_back(std::make_unique<sti::proxy_queue_manager>(&self, 0, 0));
+            for (auto p = 0; p < n; ++p) exchanges[static_cast<std::size_t>(p)]->join(queues[static_cast<std::size_t>(p)].get());
+        }
+    };
+    auto f = std::make_shared<fixture>(processes, l);
+
+    return [f, waiting](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i, ++f->tick) {
+            for (auto p = 0; p < static_cast<int>(f->queues.size()); ++p) {
+                auto& queue = *f->queues[static_cast<std::size_t>(p)];
+                queue.enqueue(patient(f->tick, p));
+                if (f->tick < waiting) continue;
+                auto turn = queue.is_my_turn(patient(f->tick - waiting, p));
+                sti::bench::do_not_optimize(turn);
+                queue.dequeue(patient(f->tick - waiting, p));
+            }
+            f->network.sync(f->order);
+        }
+    };
+}
+
+/// @brief The doctors queues fed by all the processes
+/// @details Each tick every process enqueues a patient in a specialty, the
+/// one that entered some ticks earlier leaves, and the managers are exchanged
+/// @param processes The number of virtual processes
+/// @param l The link between the processes
+sti::bench::kernel doctors_exchange(int processes, sti::emulated_network::link l)
+{
+    constexpr auto waiting = std::size_t { 8 };
+
+    struct fixture : virtual_processes {
+        sti::clock                                       clock { 60 };
+        sti::hospital_plan                               plan { sti::bench::synthetic_hospital(60, 40), &clock };
+        std::vector<std::unique_ptr<sti::doctors_queue>> doctors;
+
+        fixture(int n, sti::emulated_network::link link)
+            : virtual_processes { n, link }
+        {
+            doctors.push_back(std::make_unique<sti::real_doctors>(&self, 0, plan));
+            for (auto p = 1; p < n; ++p) doctors.push_back(std::make_unique<sti::proxy_doctors>(&self, 0, 0, plan));
+            for (auto p = 0; p < n; ++p) exchanges[static_cast<std::size_t>(p)]->join(doctors[static_cast<std::size_t>(p)].get());
+        }
+
+        /// @brief The specialty of the patients entering in a tick
+        sti::doctors_queue::specialty_type specialty(std::size_t t) const
+        {
+            return plan.find_specialty(sti::bench::specialties[t % sti::bench::specialties.size()]);
+        }
+    };
+    auto f = std::make_shared<fixture>(processes, l);
+
+    return [f, waiting](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i, ++f->tick) {
+            const auto timeout = sti::datetime { static_cast<sti::datetime::resolution>(f->tick + 86400) };
+            for (auto p = 0; p < static_cast<int>(f->doctors.size()); ++p) {
+                auto& doctors = *f->doctors[static_cast<std::size_t>(p)];
+                doctors.enqueue(f->specialty(f->tick), patient(f->tick, p), timeout);
+                if (f->tick < waiting) continue;
+                const auto leaving = f->tick - waiting;
+                auto       turn    = doctors.is_my_turn(f->specialty(leaving), patient(leaving, p));
+                sti::bench::do_not_optimize(turn);
+                doctors.dequeue(f->specialty(leaving), patient(leaving, p));
+            }
+            f->network.sync(f->order);
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "manager_exchange/queue/16", []() { return queue_exchange(16, {}); } },
+    { "manager_exchange/queue/64", []() { return queue_exchange(64, {}); } },
+    { "manager_exchange/queue/256", []() { return queue_exchange(256, {}); } },
+    { "manager_exchange/queue/256/cluster", []() { return queue_exchange(256, cluster_link); } },
+    { "manager_exchange/doctors/16", []() { return doctors_exchange(16, {}); } },
+    { "manager_exchange/doctors/64", []() { return doctors_exchange(64, {}); } },
+    { "manager_exchange/doctors/256", []() { return doctors_exchange(256, {}); } },
+    { "manager_exchange/doctors/256/cluster", []() { return doctors_exchange(256, cluster_link); } },
+};
+
+} // namespace
@@ -0,0 +1,92 @@
+/// @file pathfinder.cpp
+/// @brief Benchmarks of the pathfinder
+#include <memory>
+#include <vector>
+
+#include "clock.hpp"
+#include "coordinates.hpp"
+#include "fixtures.hpp"
+#include "harness.hpp"
+#include "hospital_plan.hpp"
+#include "pathfinder.hpp"
+
+namespace {
+
+/// @brief A hospital plan and the pairs of walkable cells to query
+struct pathfinder_fixture {
+    sti::clock                          clock { 60 };
+    sti::hospital_plan                  plan;
+    std::vector<sti::coordinates<int>> starts;
+    std::vector<sti::coordinates<int>> goals;
+
+    pathfinder_fixture(int width, int height, std::size_t pairs)
+        : plan { sti::bench::synthetic_hospital(width, height), &clock }
+    {
+        // Each goal is one of the destinations of the patients
+        const auto destinations = plan.destinations();
+        auto       rng          = sti::bench::input_rng { 42 };
+        while (starts.size() < pairs) {
+            const auto start = sti::coordinates<int> { static_cast<int>(rng(static_cast<std::uint32_t>(width))),
+                                                       static_cast<int>(rng(static_cast<std::uint32_t>(height))) };
+            if (!plan.obstacles().walkable(start)) continue;
+            starts.push_back(start);
+            goals.push_back(destinations.at(rng(static_cast<std::uint32_t>(destinations.size()))));
+        }
+    }
+};
+
+/// @brief next_step with an empty cache, every query runs A*
+sti::bench::kernel cold(int width, int height)
+{
+    auto fixture = std::make_shared<pathfinder_fixture>(width, height, 1024);
+    return [fixture](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            auto       pf   = sti::pathfinder { &fixture->plan.obstacles(), &fixture->clock };
+            const auto p    = i % fixture->starts.size();
+            auto       step = pf.next_step(fixture->starts[p], fixture->goals[p]);
+            sti::bench::do_not_optimize(step);
+        }
+    };
+}
+
+/// @brief next_step with all the paths already cached
+sti::bench::kernel warm(int width, int height)
+{
+    auto fixture = std::make_shared<pathfinder_fixture>(width, height, 1024);
+    auto pf      = std::make_shared<sti::pathfinder>(&fixture->plan.obstacles(), &fixture->clock);
+    for (auto p = std::size_t { 0 }; p < fixture->starts.size(); ++p) pf->next_step(fixture->starts[p], fixture->goals[p]);
+
+    return [fixture, pf](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            const auto p    = i % fixture->starts.size();
+            auto       step = pf->next_step(fixture->starts[p], fixture->goals[p]);
+            sti::bench::do_not_optimize(step);
+        }
+    };
+}
+
+/// @brief next_step with the flow fields of all the destinations precomputed
+sti::bench::kernel flow_fields(int width, int height)
+{
+    auto fixture = std::make_shared<pathfinder_fixture>(width, height, 1024);
+    auto pf      = std::make_shared<sti::pathfinder>(&fixture->plan.obstacles(), &fixture->clock);
+    pf->precompute(fixture->plan.destinations());
+
+    return [fixture, pf](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            const auto p    = i % fixture->starts.size();
+            auto       step = pf->next_step(fixture->starts[p], fixture->goals[p]);
+            sti::bench::do_not_optimize(step);
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "pathfinder/next_step/cold/60x40", []() { return cold(60, 40); } },
+    { "pathfinder/next_step/cold/200x120", []() { return cold(200, 120); } },
+    { "pathfinder/next_step/warm/60x40", []() { return warm(60, 40); } },
+    { "pathfinder/next_step/warm/200x120", []() { return warm(200, 120); } },
+    { "pathfinder/next_step/flow_fields/200x120", []() { return flow_fields(200, 120); } },
+};
+
+} // namespace
@@ -0,0 +1,104 @@
+/// @file queues.cpp
+/// @brief Benchmarks of the queues of the managers
+#include <boost/mpi/communicator.hpp>
+#include <memory>
+#include <repast_hpc/AgentId.h>
+#include <vector>
+
+#include "clock.hpp"
+#include "doctors/real_doctors.hpp"
+#include "fixtures.hpp"
+#include "harness.hpp"
+#include "hospital_plan.hpp"
+#include "queue_manager/real_queue_manager.hpp"
+
+namespace {
+
+/// @brief The id of the n-th patient
+repast::AgentId patient(std::size_t n)
+{
+    return { static_cast<int>(n), 0, 1, 0 };
+}
+
+/// @brief A reception/triage queue with a steady number of waiting patients
+/// @details Each iteration a patient enters the queue and another one leaves
+/// it, the front is served and the turn of a patient is checked
+/// @param length The number of patients waiting
+sti::bench::kernel queue_manager(std::size_t length)
+{
+    auto world   = std::make_shared<boost::mpi::communicator>();
+    auto boxes   = std::vector<sti::coordinates<double>> { { 3, 3 }, { 5, 3 } };
+    auto manager = std::make_shared<sti::real_queue_manager>(world.get(), 0, boxes);
+
+    // The boxes are taken by the first patients, the rest wait
+    for (auto i = std::size_t { 0 }; i < length + boxes.size(); ++i) manager->enqueue(patient(i));
+    manager->serve();
+
+    auto next = std::make_shared<std::size_t>(length + boxes.size());
+    return [world, manager, next, length](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            manager->enqueue(patient(*next));
+            manager->dequeue(patient(*next - length / 2)); // Someone from the middle gives up
+            manager->serve();
+            auto turn = manager->is_my_turn(patient(*next - length));
+            sti::bench::do_not_optimize(turn);
+            ++*next;
+        }
+    };
+}
+
+/// @brief The doctors queues with a steady number of waiting patients
+/// @details The patients are sorted by their timeout, each iteration a
+/// patient with a random timeout enters a specialty and another one leaves
+/// @param length The number of patients waiting in each specialty
+sti::bench::kernel doctors(std::size_t length)
+{
+    struct fixture {
+        boost::mpi::communicator world {};
+        sti::clock               clock { 60 };
+        sti::hospital_plan       plan { sti::bench::synthetic_hospital(60, 40), &clock };
+        sti::real_doctors        doctors { &world, 0, plan };
+        sti::bench::input_rng    rng { 3 };
+        std::size_t              next {};
+
+        /// @brief The id in the plan of the specialty of a patient
+        sti::doctors_queue::specialty_type specialty(std::size_t n) const
+        {
+            return plan.find_specialty(sti::bench::specialties[n % sti::bench::specialties.size()]);
+        }
+    };
+    auto f = std::make_shared<fixture>();
+
+    const auto enqueue = [f](std::size_t n) {
+        const auto timeout = sti::datetime { f->rng(86400) };
+        f->doctors.enqueue(f->specialty(n), patient(n), timeout);
+    };
+
+    // Each specialty has three doctors, taken by the first patients
+    const auto waiting = (length + 3) * sti::bench::specialties.size();
+    for (; f->next < waiting; ++f->next) enqueue(f->next);
+    f->doctors.serve();
+
+    return [f, enqueue, waiting](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            enqueue(f->next);
+            const auto leaving = f->next - waiting / 2;
+            f->doctors.dequeue(f->specialty(leaving), patient(leaving));
+            f->doctors.serve();
+            auto turn = f->doctors.is_my_turn(f->specialty(f->next), patient(f->next - waiting));
+            sti::bench::do_not_optimize(turn);
+            ++f->next;
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "queue_manager/steady/10", []() { return queue_manager(10); } },
+    { "queue_manager/steady/100", []() { return queue_manager(100); } },
+    { "queue_manager/steady/1000", []() { return queue_manager(1000); } },
+    { "doctors/steady/10", []() { return doctors(10); } },
+    { "doctors/steady/100", []() { return doctors(100); } },
+    { "doctors/steady/1000", []() { return doctors(1000); } },
+};
+
+} // namespace
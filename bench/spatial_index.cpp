@@ -0,0 +1,90 @@
+/// @file spatial_index.cpp
+/// @brief Benchmarks of the neighbour queries
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "coordinates.hpp"
+#include "fixtures.hpp"
+#include "harness.hpp"
+#include "spatial_index.hpp"
+
+namespace {
+
+constexpr auto width  = 200;
+constexpr auto height = 120;
+
+/// @brief Agents spread uniformly over the grid, and the query points
+struct index_fixture {
+    sti::spatial_index                  index { width, height };
+    std::vector<sti::coordinates<double>> points;
+
+    explicit index_fixture(double agents_per_cell)
+    {
+        auto       rng    = sti::bench::input_rng { 7 };
+        const auto random = [&](int max) { return static_cast<double>(rng(static_cast<std::uint32_t>(max) * 1000U)) / 1000.0; };
+
+        // The agents are never dereferenced, only their locations matter
+        const auto agents = static_cast<std::size_t>(agents_per_cell * width * height);
+        for (auto i = std::size_t { 0 }; i < agents; ++i) index.add(nullptr, { random(width), random(height) });
+        index.build();
+
+        for (auto i = 0; i < 1024; ++i) points.push_back({ random(width), random(height) });
+    }
+};
+
+/// @brief The query of space_wrapper::agents_around with a valid snapshot:
+/// scan the buckets around the point and keep the agents inside the circle
+/// @param agents_per_cell The density of agents
+/// @param r The radius of the query, as passed to agents_around
+sti::bench::kernel agents_around(double agents_per_cell, double r)
+{
+    auto fixture = std::make_shared<index_fixture>(agents_per_cell);
+    auto out     = std::make_shared<std::vector<sti::contagious_agent*>>();
+
+    return [fixture, out, r](std::size_t iterations) {
+        const auto range = static_cast<int>(std::ceil(r));
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            const auto& p = fixture->points[i % fixture->points.size()];
+            out->clear();
+            fixture->index.for_each_around(p.discrete(), range, [&](sti::contagious_agent* a, const sti::coordinates<double>& loc) {
+                const auto [x, y] = loc - p;
+                if (!(x * x + y * y > r)) out->push_back(a);
+            });
+            sti::bench::do_not_optimize(*out);
+        }
+    };
+}
+
+/// @brief Rebuild the whole index, as done after every walk
+/// @param agents_per_cell The density of agents
+sti::bench::kernel rebuild(double agents_per_cell)
+{
+    auto fixture   = std::make_shared<index_fixture>(agents_per_cell);
+    auto locations = std::make_shared<std::vector<sti::coordinates<double>>>();
+    fixture->index.for_each_around({ width / 2, height / 2 }, width, [&](sti::contagious_agent* /*unused*/, const sti::coordinates<double>& loc) {
+        locations->push_back(loc);
+    });
+
+    return [fixture, locations](std::size_t iterations) {
+        for (auto i = std::size_t { 0 }; i < iterations; ++i) {
+            fixture->index.clear();
+            for (const auto& loc : *locations) fixture->index.add(nullptr, loc);
+            fixture->index.build();
+        }
+    };
+}
+
+const auto registered = std::vector<sti::bench::registrar> {
+    { "space/agents_around/density_0.05/r1", []() { return agents_around(0.05, 1.0); } },
+    { "space/agents_around/density_0.05/r4", []() { return agents_around(0.05, 4.0); } },
+    { "space/agents_around/density_0.5/r1", []() { return agents_around(0.5, 1.0); } },
+    { "space/agents_around/density_0.5/r4", []() { return agents_around(0.5, 4.0); } },
+    { "space/agents_around/density_4/r1", []() { return agents_around(4.0, 1.0); } },
+    { "space/agents_around/density_4/r4", []() { return agents_around(4.0, 4.0); } },
+    { "space/index_rebuild/density_0.05", []() { return rebuild(0.05); } },
+    { "space/index_rebuild/density_0.5", []() { return rebuild(0.5); } },
+    { "space/index_rebuild/density_4", []() { return rebuild(4.0); } },
+};
+
+} // namespace
@@ -0,0 +1,84 @@
+/// @file act_phase.cpp
+/// @brief Execute the agents logic in several threads of the same process
+#include "act_phase.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+thread_local std::vector<sti::act_phase::deferred_write>* sti::act_phase::_current = nullptr;
+thread_local std::size_t                                  sti::act_phase::_agent   = 0;
+
+/// @brief Create a parallel act phase
+/// @param threads Number of threads to use, 0 to use the OpenMP default
+sti::act_phase::act_phase(int threads)
+    : _threads { threads }
+{
+#ifdef _OPENMP
+    if (_threads <= 0) _threads = omp_get_max_threads();
+#else
+    _threads = 1;
+#endif
+    _buffers.resize(static_cast<std::size_t>(_threads));
+}
+
+/// @brief Get the number of threads used by the read phase
+int sti::act_phase::threads() const
+{
+    return _threads;
+}
+
+/// @brief Start a read phase run in chunks, by the tasks of a tick_graph
+/// @param chunks The number of chunks, each with its buffer
+void sti::act_phase::begin_chunks(std::size_t chunks)
+{
+    if (_buffers.size() < chunks) _buffers.resize(chunks);
+    for (auto& buffer : _buffers) buffer.clear();
+}
+
+/// @brief Finish a read phase run in chunks, execute the deferred writes
+void sti::act_phase::end_chunks()
+{
+    commit_writes();
+}
+
+/// @brief Start deferring the writes of the calling thread
+void sti::act_phase::begin_read()
+{
+#ifdef _OPENMP
+    _current = &_buffers[static_cast<std::size_t>(omp_get_thread_num())];
+#else
+    _current = &_buffers.front();
+#endif
+}
+
+/// @brief Stop deferring the writes of the calling thread
+void sti::act_phase::end_read()
+{
+    _current = nullptr;
+}
+
+/// @brief Merge the thread buffers and execute the writes, in agent order
+void sti::act_phase::commit_writes()
+{
+    _merged.clear();
+    for (auto& buffer : _buffers) {
+        std::move(buffer.begin(), buffer.end(), std::back_inserter(_merged));
+        buffer.clear();
+    }
+
+    // Each agent is processed by only one thread, the writes of an agent are
+    // already in order inside its buffer, a stable sort keeps them that way
+    std::stable_sort(_merged.begin(), _merged.end(), [](const auto& lho, const auto& rho) {
+        return lho.agent < rho.agent;
+    });
+
+    for (auto& deferred : _merged) {
+        deferred.write();
+    }
+    _merged.clear();
+}
@@ -0,0 +1,129 @@
+/// @file act_phase.hpp
+/// @brief Execute the agents logic in several threads of the same process
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace sti {
+
+/// @brief Run the agents act() in parallel, in two phases: read and commit
+/// @details During the read phase every agent evaluates its logic, reading
+/// the shared state (managers, spaces, clock) but never modifying it. The
+/// writes to the shared state (requests to the managers, walks, releases)
+/// are stored in a per-thread buffer with commit() instead of executed. In
+/// the commit phase the buffers are merged, ordered by agent, and executed
+/// in a single thread, so the managers receive the requests in the same
+/// order as in a sequential run, before the synchronization.
+/// Outside of a read phase commit() executes the write immediately.
+class act_phase {
+
+public:
+    using write_type = std::function<void()>;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create a parallel act phase
+    /// @param threads Number of threads to use, 0 to use the OpenMP default
+    explicit act_phase(int threads);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of threads used by the read phase
+    int threads() const;
+
+    /// @brief Execute a function for each agent, then the deferred writes
+    /// @details The function must not throw, exceptions can't leave an OpenMP
+    /// region. The writes can.
+    /// @param n The number of agents
+    /// @param f The per-agent function, receives the index of the agent
+    template <typename F>
+    void run(std::size_t n, F&& f)
+    {
+        for (auto& buffer : _buffers) buffer.clear();
+
+#pragma omp parallel num_threads(_threads)
+        {
+            begin_read();
+#pragma omp for schedule(dynamic, 64)
+            for (auto i = std::ptrdiff_t { 0 }; i < static_cast<std::ptrdiff_t>(n); ++i) {
+                _agent = static_cast<std::size_t>(i);
+                f(static_cast<std::size_t>(i));
+            }
+            end_read();
+        }
+
+        commit_writes();
+    }
+
+    /// @brief Start a read phase run in chunks, by the tasks of a tick_graph
+    /// @param chunks The number of chunks, each with its buffer
+    void begin_chunks(std::size_t chunks);
+
+    /// @brief Execute a function for each agent of a chunk, in the calling thread
+    /// @details Like run(), the function must not throw. The chunks must
+    /// cover the agents in order, the buffers are merged in agent order
+    /// @param chunk The chunk
+    /// @param begin The first agent of the chunk
+    /// @param end The end of the chunk
+    /// @param f The per-agent function, receives the index of the agent
+    template <typename F>
+    void run_chunk(std::size_t chunk, std::size_t begin, std::size_t end, F&& f)
+    {
+        auto* const previous = std::exchange(_current, &_buffers[chunk]);
+        for (auto i = begin; i < end; ++i) {
+            _agent = i;
+            f(i);
+        }
+        _current = previous;
+    }
+
+    /// @brief Finish a read phase run in chunks, execute the deferred writes
+    void end_chunks();
+
+    /// @brief Execute a write to the shared state, or defer it to the commit
+    /// phase if called from inside a read phase
+    /// @param write The write function
+    template <typename F>
+    static void commit(F&& write)
+    {
+        if (_current == nullptr) {
+            write();
+            return;
+        }
+        _current->push_back({ _agent, write_type { std::forward<F>(write) } });
+    }
+
+private:
+    /// @brief A deferred write and the agent that requested it
+    struct deferred_write {
+        std::size_t agent;
+        write_type  write;
+    };
+
+    /// @brief Start deferring the writes of the calling thread
+    void begin_read();
+
+    /// @brief Stop deferring the writes of the calling thread
+    static void end_read();
+
+    /// @brief Merge the thread buffers and execute the writes, in agent order
+    void commit_writes();
+
+    int                                      _threads;
+    std::vector<std::vector<deferred_write>> _buffers; // One per thread, or per chunk
+    std::vector<deferred_write>              _merged;
+
+    // The buffer of the calling thread (null outside of a read phase) and
+    // the agent being processed by it
+    static thread_local std::vector<deferred_write>* _current;
+    static thread_local std::size_t                  _agent;
+}; // class act_phase
+
+} // namespace sti
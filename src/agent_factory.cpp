@@ -9,6 +9,7 @@
 #include "chair_manager.hpp"
 #include "clock.hpp"
 #include "contagious_agent.hpp"
+#include "counter_rng.hpp"
 #include "doctors.hpp"
 #include "hospital_plan.hpp"
 #include "icu.hpp"
@@ -45,6 +46,7 @@ struct human_incubating : public std::exception {
 /// @param reception A pointer to the reception
 /// @param triage A pointer to the triage
 /// @param doctors A pointer to the doctors queue
+/// @param timers A pointer to the queue of parked agents
 /// @param props The JSON object containing the simulation properties
 sti::agent_factory::agent_factory(communicator_ptr           comm,
                                   context_ptr                context,
@@ -56,6 +58,7 @@ sti::agent_factory::agent_factory(communicator_ptr           comm,
                                   sti::triage*               triage,
                                   sti::doctors*              doctors,
                                   sti::icu*                  icu,
+                                  sti::wake_queue*           timers,
                                   const boost::json::object& hospital_props)
     : _communicator { comm }
     , _context { context }
@@ -81,7 +84,7 @@ sti::agent_factory::agent_factory(communicator_ptr           comm,
             boost::json::value_to<double>(hospital_props.at("parameters").at("patient").at("walk_speed")),
             boost::json::value_to<timedelta>(hospital_props.at("parameters").at("reception").at("attention_time")),
             boost::json::value_to<timedelta>(hospital_props.at("parameters").at("triage").at("attention_time")),
-            patient_fsm::flyweight{}
+            timers
         } // clang-format on
     , _person_flyweight { &_infection_factory }
 {
@@ -103,10 +106,12 @@ sti::infection_factory* sti::agent_factory::get_infection_factory()
 /// @brief Create a brand new patient, with a new id, insert it into the context
 /// @param pos The position where to insert the patients
 /// @param st The stage of the patient infection
+/// @param subject The stable subject of the patient, see counter_rng::entity
 /// @return A raw pointer to the contagious agent created
 sti::agent_factory::patient_ptr sti::agent_factory::insert_new_patient(
     const coordinates<double>&   pos,
-    human_infection_cycle::STAGE st)
+    human_infection_cycle::STAGE st,
+    std::uint64_t                subject)
 {
     const auto rank = repast::RepastProcess::instance()->rank();
     const auto type = to_int(contagious_agent::type::PATIENT);
@@ -119,7 +124,7 @@ sti::agent_factory::patient_ptr sti::agent_factory::insert_new_patient(
     }();
     const auto mode = human_infection_cycle::MODE::NORMAL;
 
-    const auto hic     = _infection_factory.make_human_cycle(id, st, mode, infection_time);
+    const auto hic     = _infection_factory.make_human_cycle(id, subject, st, mode, infection_time);
     auto*      patient = new patient_agent { id, &_patient_flyweight, _clock->now(), hic };
 
     // Move the agent into position, add it to the repast contexts
@@ -130,16 +135,32 @@ sti::agent_factory::patient_ptr sti::agent_factory::insert_new_patient(
     return patient;
 }
 
+/// @brief Create a batch of new patients in the same position
+/// @details The snapshot of the space is grown once for all of them
+/// @param pos The position where to insert the patients
+/// @param stages The stage of the infection of each patient
+/// @param first_entry The entry number of the first patient, the next
+/// ones follow in order
+void sti::agent_factory::insert_new_patients(const coordinates<double>&                       pos,
+                                             const std::vector<human_infection_cycle::STAGE>& stages,
+                                             std::uint64_t                                    first_entry)
+{
+    _space->reserve(stages.size());
+    for (auto i = std::size_t { 0 }; i < stages.size(); ++i) {
+        insert_new_patient(pos, stages[i], counter_rng::subject(counter_rng::entity::PATIENT, first_entry + i));
+    }
+}
+
 /// @brief Recreate a serialized patient, with an existing id
 /// @param id The agent id
-/// @param data The serialized data
+/// @param wire The agent state in the fixed layout format
 /// @return A pointer to the newly created object
 sti::agent_factory::patient_ptr sti::agent_factory::recreate_patient(const repast::AgentId& id,
-                                                                     serial_data&           data)
+                                                                     const agent_wire&      wire)
 {
     auto* patient = new patient_agent { id,
                                         &_patient_flyweight };
-    patient->serialize(id, data, _communicator);
+    patient->unpack(id, wire, wire_section::ALL);
     return patient;
 };
 
@@ -152,12 +173,14 @@ sti::agent_factory::patient_ptr sti::agent_factory::recreate_patient(const repas
 /// @param type The person type/rol, for post processing
 /// @param st The stage of the patient infection
 /// @param immune The person immunity, True if is immune
+/// @param subject The stable subject of the person, see counter_rng::entity
 /// @return A raw pointer to the contagious agent created
 sti::agent_factory::person_ptr sti::agent_factory::insert_new_person(
     const coordinates<double>&       pos,
     const person_agent::person_type& type,
     human_infection_cycle::STAGE     st,
-    bool                             immune)
+    bool                             immune,
+    std::uint64_t                    subject)
 {
     // Stage can't be incubating for new patients
     if (st == human_infection_cycle::STAGE::INCUBATING) {
@@ -174,7 +197,7 @@ sti::agent_factory::person_ptr sti::agent_factory::insert_new_person(
     }();
     const auto mode = immune ? human_infection_cycle::MODE::IMMUNE : human_infection_cycle::MODE::NORMAL;
 
-    const auto hic    = _infection_factory.make_human_cycle(id, st, mode, infection_time);
+    const auto hic    = _infection_factory.make_human_cycle(id, subject, st, mode, infection_time);
     auto*      person = new person_agent { id, type, &_person_flyweight, hic };
 
     // Move the agent into position, add it to the repast contexts
@@ -184,15 +207,32 @@ sti::agent_factory::person_ptr sti::agent_factory::insert_new_person(
     return person;
 }
 
-/// @brief Recreate a serialized patient, with an existing id
+/// @brief Recreate a serialized person, with an existing id
 /// @param id The agent id
-/// @param data The serialized data
+/// @param wire The agent state in the fixed layout format
 /// @return A pointer to the newly created object
 sti::agent_factory::person_ptr sti::agent_factory::recreate_person(const repast::AgentId& id,
-                                                                   serial_data&           data) const
+                                                                   const agent_wire&      wire) const
 {
     auto* person = new person_agent { id,
                                       &_person_flyweight };
-    person->serialize(id, data, _communicator);
+    person->unpack(id, wire, wire_section::ALL);
     return person;
-};
\ No newline at end of file
+};
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the number of agents created, the next id
+/// @param ar The archive of the checkpoint
+void sti::agent_factory::save_state(oarchive& ar) const
+{
+    ar << _agents_created;
+}
+
+/// @brief Read the number of agents created, the next id
+/// @param ar The archive of the checkpoint
+void sti::agent_factory::load_state(iarchive& ar)
+{
+    ar >> _agents_created;
+}
@@ -2,7 +2,9 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
+#include "checkpoint.hpp"
 #include "infection_logic/infection_factory.hpp"
 #include "patient.hpp"
 #include "person.hpp"
@@ -20,7 +22,9 @@ class SharedContext;
 } // namespace repast
 
 namespace sti {
+struct agent_wire;
 class space_wrapper;
+class wake_queue;
 } // namespace sti
 
 namespace sti {
@@ -30,7 +34,7 @@ namespace sti {
 /// properties, to solve this problem a factory is used. The factory is created
 /// once with the shared properties, and every time a new agent is created the
 /// private attributes/properties must be supplied.
-class agent_factory {
+class agent_factory : public checkpoint_participant {
 
 public:
     using agent       = contagious_agent;
@@ -59,6 +63,7 @@ public:
     /// @param triage A pointer to the triage
     /// @param doctors A pointer to the doctors manager
     /// @param icu A pointer to the ICU
+    /// @param timers A pointer to the queue of parked agents
     /// @param hospital_props The JSON object containing the simulation properties
     agent_factory(communicator_ptr           comm,
                   context_ptr                context,
@@ -70,6 +75,7 @@ public:
                   sti::triage*               triage,
                   sti::doctors*              doctors,
                   sti::icu*                  icu,
+                  sti::wake_queue*           timers,
                   const boost::json::object& hospital_props);
 
     ////////////////////////////////////////////////////////////////////////////
@@ -85,16 +91,28 @@ public:
     /// @brief Create a brand new patient, with a new id, insert it into the context
     /// @param pos The position where to insert the patients
     /// @param st The stage of the patient infection
+    /// @param subject The stable subject of the patient, see counter_rng::entity
     /// @return A raw pointer to the contagious agent created
     patient_ptr insert_new_patient(const coordinates<double>&   pos,
-                                   human_infection_cycle::STAGE st);
+                                   human_infection_cycle::STAGE st,
+                                   std::uint64_t                subject);
+
+    /// @brief Create a batch of new patients in the same position
+    /// @details The snapshot of the space is grown once for all of them
+    /// @param pos The position where to insert the patients
+    /// @param stages The stage of the infection of each patient
+    /// @param first_entry The entry number of the first patient, the next
+    /// ones follow in order
+    void insert_new_patients(const coordinates<double>&                       pos,
+                             const std::vector<human_infection_cycle::STAGE>& stages,
+                             std::uint64_t                                    first_entry);
 
     /// @brief Recreate a serialized patient, with an existing id
     /// @param id The agent id
-    /// @param data The serialized data
+    /// @param wire The agent state in the fixed layout format
     /// @return A pointer to the newly created object
     patient_ptr recreate_patient(const repast::AgentId& id,
-                                 serial_data&           data);
+                                 const agent_wire&      wire);
 
     ////////////////////////////////////////////////////////////////////////////
     // PERSON CREATION
@@ -105,18 +123,32 @@ public:
     /// @param type The person type/rol, for post processing
     /// @param st The stage of the patient infection
     /// @param immune The person immunity, True if is immune
+    /// @param subject The stable subject of the person, see counter_rng::entity
     /// @return A raw pointer to the contagious agent created
     person_ptr insert_new_person(const coordinates<double>&       pos,
                                  const person_agent::person_type& type,
                                  human_infection_cycle::STAGE     st,
-                                 bool                             immune);
+                                 bool                             immune,
+                                 std::uint64_t                    subject);
 
-    /// @brief Recreate a serialized patient, with an existing id
+    /// @brief Recreate a serialized person, with an existing id
     /// @param id The agent id
-    /// @param data const The serialized data&
+    /// @param wire The agent state in the fixed layout format
     /// @return A pointer to the newly created object
     person_ptr recreate_person(const repast::AgentId& id,
-                               serial_data&           data) const;
+                               const agent_wire&      wire) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the number of agents created, the next id
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the number of agents created, the next id
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator_ptr _communicator;
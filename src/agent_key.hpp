@@ -0,0 +1,122 @@
+/// @file agent_key.hpp
+/// @brief The identity of an agent packed in 64 bits
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <repast_hpc/AgentId.h>
+#include <string>
+
+namespace sti {
+
+/// @brief The identity of an agent, packed in 64 bits
+/// @details A repast::AgentId has four ints, but the current rank is not
+/// part of the identity: two ids of the same agent in different processes
+/// are equal. The key keeps the id in the lower 32 bits, the starting rank
+/// in the next 16 and the type in the upper 16, the layout of the packed ids
+/// of the movements and the infection traces. Comparing and hashing a key is
+/// a single integer operation, and it's half the size in the manager
+/// messages. The managers use keys inside, the agent ids are converted at
+/// the Repast boundary, implicitly, the conversion is cheap.
+class agent_key {
+
+public:
+    /// @brief Hash of a key, a multiplicative mix of the packed bits
+    struct hash {
+        std::size_t operator()(const agent_key& key) const noexcept
+        {
+            return static_cast<std::size_t>((key._packed * 0x9E3779B97F4A7C15ULL) >> 16U);
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    agent_key() = default;
+
+    /// @brief Pack the identity of an agent
+    /// @param id The agent id, its current rank is dropped
+    agent_key(const repast::AgentId& id) // NOLINT
+        : _packed { static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.id()))
+                    | static_cast<std::uint64_t>(static_cast<std::uint16_t>(id.startingRank())) << 32U
+                    | static_cast<std::uint64_t>(static_cast<std::uint16_t>(id.agentType())) << 48U }
+    {
+    }
+
+    /// @brief Restore a packed key
+    /// @param packed The packed bits, see packed()
+    static agent_key from_packed(std::uint64_t packed)
+    {
+        auto key    = agent_key {};
+        key._packed = packed;
+        return key;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the packed bits
+    std::uint64_t packed() const
+    {
+        return _packed;
+    }
+
+    /// @brief Get the id of the agent in its starting process
+    int id() const
+    {
+        return static_cast<int>(static_cast<std::uint32_t>(_packed & 0xFFFFFFFFULL));
+    }
+
+    /// @brief Get the rank of the process that created the agent
+    int starting_rank() const
+    {
+        return static_cast<int>(static_cast<std::int16_t>((_packed >> 32U) & 0xFFFFU));
+    }
+
+    /// @brief Get the type of the agent
+    int agent_type() const
+    {
+        return static_cast<int>(static_cast<std::int16_t>((_packed >> 48U) & 0xFFFFU));
+    }
+
+    /// @brief Get the agent id, at the Repast boundary
+    /// @param current_rank The current rank of the agent
+    repast::AgentId to_id(int current_rank = 0) const
+    {
+        return { id(), starting_rank(), agent_type(), current_rank };
+    }
+
+    friend bool operator==(const agent_key& lho, const agent_key& rho)
+    {
+        return lho._packed == rho._packed;
+    }
+
+    friend bool operator!=(const agent_key& lho, const agent_key& rho)
+    {
+        return lho._packed != rho._packed;
+    }
+
+    friend bool operator<(const agent_key& lho, const agent_key& rho)
+    {
+        return lho._packed < rho._packed;
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& _packed;
+    }
+
+private:
+    std::uint64_t _packed {};
+}; // class agent_key
+
+/// @brief Format a key as the agent ids in the outputs, id.starting_rank.type
+inline std::string to_string(const agent_key& key)
+{
+    return std::to_string(key.id()) + "." + std::to_string(key.starting_rank()) + "." + std::to_string(key.agent_type());
+}
+
+} // namespace sti
@@ -0,0 +1,42 @@
+/// @file agent_locations.hpp
+/// @brief The locations of the agents, as seen by the infection logic
+#pragma once
+
+#include "coordinates.hpp"
+
+// Fw. declarations
+namespace repast {
+class AgentId;
+} // namespace repast
+
+namespace sti {
+
+/// @brief Lookup of the agents locations
+/// @details The infection cycles only need the location of their agent, the
+/// simulation gives it from the Repast spaces (space_wrapper), and the replay
+/// of a trace from the recorded frames (infection_replay)
+class agent_locations {
+
+public:
+    agent_locations()                       = default;
+    agent_locations(const agent_locations&) = default;
+    agent_locations& operator=(const agent_locations&) = default;
+
+    agent_locations(agent_locations&&) = default;
+    agent_locations& operator=(agent_locations&&) = default;
+
+    virtual ~agent_locations() = default;
+
+    /// @brief Get the discrete location of an agent
+    /// @param id The id of the agent
+    /// @return The discrete (integral) location of the agent
+    virtual coordinates<int> get_discrete_location(const repast::AgentId& id) const = 0;
+
+    /// @brief Get the continuous location of an agent
+    /// @param id The id of the agent
+    /// @return The continuous point of the agent
+    virtual coordinates<double> get_continuous_location(const repast::AgentId& id) const = 0;
+
+}; // class agent_locations
+
+} // namespace sti
@@ -2,7 +2,10 @@
 #pragma once
 
 #include <boost/mpi/communicator.hpp>
+#include <boost/serialization/binary_object.hpp>
+#include <cstdint>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/archive/text_oarchive.hpp>
@@ -12,6 +15,8 @@
 #include <repast_hpc/AgentRequest.h>
 
 #include "agent_factory.hpp"
+#include "agent_key.hpp"
+#include "agent_wire.hpp"
 #include "contagious_agent.hpp"
 #include "infection_logic/infection_cycle.hpp"
 
@@ -34,20 +39,28 @@ struct agent_package {
 
     /// @brief Create a new package, passing id and the contagious agent data
     /// @param agent A pointer to the agent being serialized
-    /// @param comm The MPI communicator
-    agent_package(sti::contagious_agent* agent, boost::mpi::communicator* comm)
+    /// @param changed The sections of the wire to send, see wire_section
+    agent_package(const sti::contagious_agent* agent, std::uint8_t changed)
         : id { agent->getId() }
-        , data {}
+        , sections { changed }
+        , wire {}
     {
-        data.reserve(150);
-        agent->serialize(data, comm);
+        agent->pack(wire);
     }
 
+    // Each section of the wire is copied as a single block into the archive
+    // buffer, the sections not present take no space
     template <class Archive>
     void serialize(Archive& ar, const unsigned int /*unused*/)
     {
         ar& id;
-        ar& data;
+        ar& sections;
+        if ((sections & sti::wire_section::INFECTION) != 0) {
+            ar& boost::serialization::make_binary_object(&wire.infection, sizeof(wire.infection));
+        }
+        if ((sections & sti::wire_section::BEHAVIOUR) != 0) {
+            ar& boost::serialization::make_binary_object(&wire.behaviour, sizeof(wire.behaviour));
+        }
     }
 
     /// @brief Get the ID as a Repast ID
@@ -58,10 +71,10 @@ struct agent_package {
     }
 
     repast::AgentId id {};
+    std::uint8_t    sections {};
 
-    // Use Boost.Serialization to serialize the contagious_agent into a string
-    // using boost::archive::text_iarchive and boost::archive::text_oarchive
-    sti::serial_data data;
+    // The agent state, in a fixed layout trivially copyable format
+    sti::agent_wire wire;
 
 }; // class agent_package
 
@@ -80,22 +93,42 @@ public:
 
     /// @brief Construct an agent provieder
     /// @param agents The repast SharedContext
-    /// @param comm The MPI communicator
-    agent_provider(repast::SharedContext<sti::contagious_agent>* agents, communicator_ptr comm)
+    explicit agent_provider(repast::SharedContext<sti::contagious_agent>* agents)
         : _agents { agents }
-        , _communicator { comm }
     {
     }
 
+    /// @brief Send only the sections changed since the last delta
+    /// @details Only valid for the agent states synchronization, where the
+    /// receivers already have a copy of every agent. Creations of new copies
+    /// (agent requests, migrations) must always send the full state.
+    /// @param enabled True to send deltas, false to send the full state
+    void deltas(bool enabled)
+    {
+        _deltas = enabled;
+        _changes.clear();
+    }
+
     /// @brief Serialize an agent and add it to a vector
     /// @param agent The agent to serialize
     /// @param out The vector to insert the package into
     void providePackage(sti::contagious_agent* agent, std::vector<agent_package>& out)
     {
-        // const auto id      = agent->getId();
-        // auto       data    = agent->serialize(_communicator);
-        // auto       package = agent_package { id, std::move(data) };
-        out.push_back(agent_package { agent, _communicator });
+        if (!_deltas) {
+            out.emplace_back(agent, sti::wire_section::ALL);
+            return;
+        }
+
+        // An agent can have copies in several processes, all of them must
+        // receive the same delta
+        const auto it = _changes.find(agent->getId());
+        if (it != _changes.end()) {
+            out.emplace_back(agent, it->second);
+            return;
+        }
+        const auto changes = agent->take_changes();
+        _changes.emplace(agent->getId(), changes);
+        out.emplace_back(agent, changes);
     }
 
     /// @brief Serialize a group of agents and add it to a vector
@@ -110,7 +143,10 @@ public:
 
 private:
     repast::SharedContext<sti::contagious_agent>* _agents;
-    communicator_ptr                              _communicator;
+    bool                                          _deltas {};
+
+    // Sections sent in the current delta round, by agent
+    std::unordered_map<sti::agent_key, std::uint8_t, sti::agent_key::hash> _changes;
 
 }; // class agent_provider
 
@@ -127,42 +163,41 @@ public:
     /// @param context The repast context
     /// @param space The repast discrete space
     /// @param agent_factory A agent_factory to create the patient type
-    /// @param comm The MPI communicator
     agent_receiver(context_ptr       context,
-                   agent_factory_ptr agent_factory,
-                   communicator_ptr  comm)
+                   agent_factory_ptr agent_factory)
         : _context { context }
         , _agent_factory { agent_factory }
-        , _communicator { comm }
     {
     }
 
-    /// @brief Create an agent from a package (deserializing the data)
+    /// @brief Create an agent from a package, reading the wire in place
     sti::contagious_agent* createAgent(const agent_package& package)
     {
-        const auto id          = package.get_id();
-        const auto agent_type  = sti::to_agent_enum(id.agentType());
-        auto       string_data = package.data;
+        const auto id         = package.get_id();
+        const auto agent_type = sti::to_agent_enum(id.agentType());
+
+        // A new copy can't be built from a delta
+        if (package.sections != sti::wire_section::ALL) {
+            throw sti::wrong_serialization {};
+        }
 
         if (agent_type == sti::contagious_agent::type::PATIENT) {
-            return _agent_factory->recreate_patient(id, string_data);
+            return _agent_factory->recreate_patient(id, package.wire);
         }
         if (agent_type == sti::contagious_agent::type::FIXED_PERSON) {
-            return _agent_factory->recreate_person(id, string_data);
+            return _agent_factory->recreate_person(id, package.wire);
         }
         throw sti::wrong_serialization {};
     }
 
-    /// @brief Update a "borrowed" agent
+    /// @brief Update a "borrowed" agent, reading the sections present
     void updateAgent(const agent_package& pkg)
     {
-        auto data_copy = pkg.data;
-        _context->getAgent(pkg.get_id())->serialize(pkg.get_id(), data_copy, _communicator);
+        _context->getAgent(pkg.get_id())->unpack(pkg.get_id(), pkg.wire, pkg.sections);
     }
 
 private:
     context_ptr       _context;
     agent_factory_ptr _agent_factory;
-    communicator_ptr  _communicator;
 
 }; // class agent_receiver
@@ -0,0 +1,73 @@
+/// @file agent_store.cpp
+/// @brief Dense storage of the agents state used by the tick passes
+#include "agent_store.hpp"
+
+#include "contagious_agent.hpp"
+
+/// @brief Remove all the agents
+void sti::agent_store::clear()
+{
+    _ids.clear();
+    _agents.clear();
+    _xs.clear();
+    _ys.clear();
+    _local.clear();
+    _slots.clear();
+    for (auto& slots : _local_slots) slots.clear();
+}
+
+/// @brief Make room for a number of agents, without reallocations
+/// @param n The total number of slots
+void sti::agent_store::reserve(std::size_t n)
+{
+    _ids.reserve(n);
+    _agents.reserve(n);
+    _xs.reserve(n);
+    _ys.reserve(n);
+    _local.reserve(n);
+    _slots.reserve(n);
+}
+
+/// @brief Add an agent in a new slot
+/// @param a The agent
+/// @param location The continuous location of the agent
+/// @param local True if the agent is local, false if it's a ghost copy
+/// @return The slot of the agent
+sti::agent_store::slot_type sti::agent_store::add(agent* a, const point& location, bool local)
+{
+    const auto slot = size();
+    _ids.push_back(a->getId());
+    _agents.push_back(a);
+    _xs.push_back(location.x);
+    _ys.push_back(location.y);
+    _local.push_back(local ? 1 : 0);
+    _slots[a->getId()] = slot;
+
+    if (local) {
+        const auto type = static_cast<std::size_t>(a->getId().agentType());
+        if (type >= _local_slots.size()) _local_slots.resize(type + 1);
+        _local_slots[type].push_back(slot);
+    }
+    return slot;
+}
+
+/// @brief Remove an agent, its slot stays empty
+/// @param id The id of the agent
+void sti::agent_store::remove(const agent_id& id)
+{
+    const auto it = _slots.find(id);
+    if (it == _slots.end()) return;
+
+    _agents[it->second] = nullptr;
+    _local[it->second]  = 0;
+    _slots.erase(it);
+}
+
+/// @brief Get the slot of an agent
+/// @param id The id of the agent
+/// @return The slot, or npos if the agent is not stored
+sti::agent_store::slot_type sti::agent_store::find(const agent_id& id) const
+{
+    const auto it = _slots.find(id);
+    return it == _slots.end() ? npos : it->second;
+}
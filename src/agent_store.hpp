@@ -0,0 +1,135 @@
+/// @file agent_store.hpp
+/// @brief Dense storage of the agents state used by the tick passes
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
+#include <vector>
+
+#include "agent_key.hpp"
+#include "coordinates.hpp"
+
+// Fw. declarations
+namespace sti {
+class contagious_agent;
+} // namespace sti
+
+namespace sti {
+
+/// @brief The agents of the context, each one in a dense slot
+/// @details The state is stored as parallel arrays (structure of arrays), one
+/// element per slot: the id, a handle to the Repast agent, the location and
+/// if the agent is local or a ghost copy. The passes over all the agents
+/// (the spatial index build, the act loop and the locations log) stream the
+/// arrays instead of querying the Repast projections by id. The slots are
+/// assigned in the order the agents are added, the removed agents leave an
+/// empty slot until the next clear(). The slots of the local agents are also
+/// kept by agent type, so each type can be processed by its own loop.
+class agent_store {
+
+public:
+    using agent     = contagious_agent;
+    using agent_id  = repast::AgentId;
+    using point     = coordinates<double>;
+    using slot_type = std::uint32_t;
+
+    constexpr static auto npos = std::numeric_limits<slot_type>::max();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BUILD
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Remove all the agents
+    void clear();
+
+    /// @brief Add an agent in a new slot
+    /// @param a The agent
+    /// @param location The continuous location of the agent
+    /// @param local True if the agent is local, false if it's a ghost copy
+    /// @return The slot of the agent
+    slot_type add(agent* a, const point& location, bool local);
+
+    /// @brief Make room for a number of agents, without reallocations
+    /// @param n The total number of slots
+    void reserve(std::size_t n);
+
+    /// @brief Remove an agent, its slot stays empty
+    /// @param id The id of the agent
+    void remove(const agent_id& id);
+
+    /// @brief Change the location of an agent
+    /// @param slot The slot of the agent
+    /// @param location The new location
+    void set_location(slot_type slot, const point& location)
+    {
+        _xs[slot] = location.x;
+        _ys[slot] = location.y;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // QUERIES
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the slot of an agent
+    /// @param id The id of the agent
+    /// @return The slot, or npos if the agent is not stored
+    slot_type find(const agent_id& id) const;
+
+    /// @brief Get the number of slots, including the empty ones
+    slot_type size() const
+    {
+        return static_cast<slot_type>(_agents.size());
+    }
+
+    /// @brief Get the agent of a slot
+    /// @return The agent, or nullptr if the slot is empty
+    agent* agent_at(slot_type slot) const
+    {
+        return _agents[slot];
+    }
+
+    /// @brief Get the agent of a slot, only if it is local
+    /// @return The agent, or nullptr if the slot is empty or a ghost copy
+    agent* local_at(slot_type slot) const
+    {
+        return _local[slot] != 0 ? _agents[slot] : nullptr;
+    }
+
+    /// @brief Get the slots of the local agents of a type, in slot order
+    /// @details The slots of the agents removed since the last clear() are
+    /// still listed, and are empty
+    /// @param agent_type The Repast agent type, see to_int()
+    const std::vector<slot_type>& local_slots(int agent_type) const
+    {
+        static const auto none = std::vector<slot_type> {};
+        const auto        t    = static_cast<std::size_t>(agent_type);
+        return t < _local_slots.size() ? _local_slots[t] : none;
+    }
+
+    /// @brief Get the id of the agent of a slot
+    const agent_id& id_at(slot_type slot) const
+    {
+        return _ids[slot];
+    }
+
+    /// @brief Get the location of the agent of a slot
+    point location_at(slot_type slot) const
+    {
+        return { _xs[slot], _ys[slot] };
+    }
+
+private:
+    std::vector<agent_id>     _ids;
+    std::vector<agent*>       _agents;
+    std::vector<double>       _xs;
+    std::vector<double>       _ys;
+    std::vector<std::uint8_t> _local;
+
+    std::vector<std::vector<slot_type>> _local_slots; // By agent type
+
+    std::unordered_map<agent_key, slot_type, agent_key::hash> _slots;
+}; // class agent_store
+
+} // namespace sti
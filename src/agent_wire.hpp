@@ -0,0 +1,125 @@
+/// @file agent_wire.hpp
+/// @brief Fixed layout representation of the agents, for the migrations
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <type_traits>
+
+#include "infection_logic/infection_source.hpp"
+
+namespace sti {
+
+/// @brief Error packing a string longer than the wire capacity
+struct wire_overflow : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: String too long for the agent wire format";
+    }
+};
+
+/// @brief Fixed capacity string, trivially copyable
+struct wire_string {
+    static constexpr auto capacity = std::size_t { 63 };
+
+    std::uint8_t size;
+    char         data[capacity];
+
+    /// @brief Store a string
+    /// @throws wire_overflow If the string is longer than the capacity
+    void assign(const std::string& str)
+    {
+        if (str.size() > capacity) throw wire_overflow {};
+        size = static_cast<std::uint8_t>(str.size());
+        std::memcpy(data, str.data(), str.size());
+    }
+
+    /// @brief Get the stored string
+    std::string str() const
+    {
+        return { data, std::min<std::size_t>(size, capacity) };
+    }
+};
+
+/// @brief The state of a human infection cycle
+struct infection_wire {
+    /// @brief The number of lanes, see human_infection_cycle
+    static constexpr auto max_lanes = std::size_t { 4 };
+
+    /// @brief The state of an extra infection lane
+    struct lane_wire {
+        std::uint8_t     stage;
+        std::uint32_t    infection_time;
+        std::uint32_t    incubation_end;
+        infection_source infected_by;
+    };
+
+    std::int32_t     id;
+    std::int32_t     starting_rank;
+    std::int32_t     agent_type;
+    std::int32_t     current_rank;
+    std::uint64_t    subject;
+    std::uint8_t     stage;
+    std::uint8_t     mode;
+    std::uint32_t    infection_time;
+    std::uint32_t    incubation_end;
+    std::int32_t     infect_x;
+    std::int32_t     infect_y;
+    infection_source infected_by;
+    lane_wire        extra_lanes[max_lanes - 1];
+};
+
+/// @brief The state of a patient FSM
+struct fsm_wire {
+    /// @brief Value of last_state when the FSM never changed state
+    static constexpr auto no_state = std::uint8_t { 0xFF };
+
+    std::uint8_t  state;
+    std::uint8_t  diagnosis; // Index of the diagnosis in the variant
+    double        destination_x;
+    double        destination_y;
+    std::uint32_t attention_end;
+    std::uint8_t  last_state;
+
+    // Doctor diagnosis
+    std::uint16_t doctor_assigned; // Id of the specialty in the hospital plan
+    std::int32_t  level;
+    std::uint32_t attention_time_limit;
+
+    // ICU diagnosis
+    std::uint32_t sleep_time;
+    std::uint8_t  survives;
+};
+
+/// @brief The behaviour state of an agent
+struct behaviour_wire {
+    // Patient
+    std::uint32_t entry_time;
+    fsm_wire      fsm;
+
+    // Person
+    wire_string role;
+};
+
+/// @brief The sections of the wire, sent only if they changed
+namespace wire_section {
+    constexpr auto INFECTION = std::uint8_t { 1U << 0U };
+    constexpr auto BEHAVIOUR = std::uint8_t { 1U << 1U };
+    constexpr auto ALL       = std::uint8_t { INFECTION | BEHAVIOUR };
+} // namespace wire_section
+
+/// @brief The state of an agent, written as is into the MPI buffers
+/// @details The fields are shared by all the agent types, each one only fills
+/// the ones it uses. The layout is the same in all the processes, which run the
+/// same binary.
+struct agent_wire {
+    infection_wire infection;
+    behaviour_wire behaviour;
+};
+
+static_assert(std::is_trivially_copyable_v<agent_wire>, "The wire format must be copyable with memcpy");
+
+} // namespace sti
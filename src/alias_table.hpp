@@ -0,0 +1,117 @@
+/// @file alias_table.hpp
+/// @brief Constant time sampling of discrete distributions
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace sti {
+
+/// @brief Exception: a distribution without outcomes, or with all of them impossible
+struct empty_distribution : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The distribution has no outcome with a positive probability";
+    }
+};
+
+/// @brief Discrete distribution sampled with the alias method
+/// @details The table is built once with Vose's algorithm, every outcome gets a
+/// column with its own probability and the alias filling the rest. A sample
+/// picks a column and decides between the outcome and its alias with a
+/// single uniform number, so it's constant time whatever the number of
+/// outcomes.
+template <typename T>
+class alias_table {
+
+public:
+    using probability_type = double;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    alias_table() = default;
+
+    /// @brief Build the table of a distribution
+    /// @details The probabilities are normalized, they don't need to sum 1
+    /// @throws empty_distribution If no outcome has a positive probability
+    /// @param outcomes The outcomes and their probabilities
+    explicit alias_table(const std::vector<std::pair<T, probability_type>>& outcomes)
+    {
+        auto total = probability_type { 0.0 };
+        for (const auto& [value, probability] : outcomes) total += probability;
+        if (outcomes.empty() || total <= 0.0) throw empty_distribution {};
+
+        const auto n = outcomes.size();
+        _values.reserve(n);
+        _threshold.resize(n);
+        _alias.resize(n);
+
+        // Scale the probabilities so the average column is 1
+        auto scaled = std::vector<probability_type>(n);
+        auto small  = std::vector<std::uint32_t> {};
+        auto large  = std::vector<std::uint32_t> {};
+        for (auto i = std::uint32_t { 0 }; i < n; ++i) {
+            _values.push_back(outcomes[i].first);
+            scaled[i] = outcomes[i].second * static_cast<probability_type>(n) / total;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+
+        // Fill each small column with a part of a large one
+        while (!small.empty() && !large.empty()) {
+            const auto s = small.back();
+            const auto l = large.back();
+            small.pop_back();
+            large.pop_back();
+
+            _threshold[s] = scaled[s];
+            _alias[s]     = l;
+
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            (scaled[l] < 1.0 ? small : large).push_back(l);
+        }
+
+        // The columns left are full, up to the rounding errors
+        for (const auto i : large) {
+            _threshold[i] = 1.0;
+            _alias[i]     = i;
+        }
+        for (const auto i : small) {
+            _threshold[i] = 1.0;
+            _alias[i]     = i;
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SAMPLING
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the outcome of a uniform random number
+    /// @param random A number in [0, 1)
+    const T& sample(probability_type random) const
+    {
+        const auto x      = random * static_cast<probability_type>(_values.size());
+        auto       column = static_cast<std::size_t>(x);
+        if (column >= _values.size()) column = _values.size() - 1;
+
+        const auto fraction = x - static_cast<probability_type>(column);
+        return fraction < _threshold[column] ? _values[column] : _values[_alias[column]];
+    }
+
+    /// @brief Get the outcomes, in the order of the construction
+    const std::vector<T>& values() const
+    {
+        return _values;
+    }
+
+private:
+    std::vector<T>                _values;
+    std::vector<probability_type> _threshold; // Probability of the column's own outcome
+    std::vector<std::uint32_t>    _alias;     // Outcome filling the rest of the column
+}; // class alias_table
+
+} // namespace sti
@@ -0,0 +1,213 @@
+/// @file chair_allocator.cpp
+/// @brief The free chairs of a chair manager, indexed by position and region
+#include "chair_allocator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "memory_usage.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// FREE_TREE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a tree with all the positions free
+/// @param size The number of positions
+sti::chair_allocator::free_tree::free_tree(std::size_t size)
+    : _counts(size + 1)
+    , _free { static_cast<std::uint32_t>(size) }
+{
+    // With every position at 1, each node counts the positions it covers
+    for (auto i = std::size_t { 1 }; i <= size; ++i) {
+        _counts[i] = static_cast<std::uint32_t>(i & (~i + 1));
+    }
+}
+
+/// @brief Add to the count of a position
+/// @param position The position
+/// @param delta 1 to free it, -1 to take it
+void sti::chair_allocator::free_tree::add(std::size_t position, int delta)
+{
+    for (auto i = position + 1; i < _counts.size(); i += i & (~i + 1)) {
+        _counts[i] = static_cast<std::uint32_t>(static_cast<int>(_counts[i]) + delta);
+    }
+    _free = static_cast<std::uint32_t>(static_cast<int>(_free) + delta);
+}
+
+/// @brief Get the free positions before one
+/// @param position The position, excluded
+std::uint32_t sti::chair_allocator::free_tree::before(std::size_t position) const
+{
+    auto count = std::uint32_t { 0 };
+    for (auto i = position; i > 0; i -= i & (~i + 1)) count += _counts[i];
+    return count;
+}
+
+/// @brief Get the position of the n-th free one, from 0
+/// @param n The rank of the free position, less than free()
+std::size_t sti::chair_allocator::free_tree::find(std::uint32_t n) const
+{
+    auto mask = std::size_t { 1 };
+    while (mask * 2 <= size()) mask *= 2;
+
+    // Descend the tree, skipping the nodes with n or fewer free positions
+    auto position = std::size_t { 0 };
+    for (; mask > 0; mask /= 2) {
+        const auto next = position + mask;
+        if (next <= size() && _counts[next] <= n) {
+            position = next;
+            n -= _counts[next];
+        }
+    }
+    return position;
+}
+
+/// @brief Get the first free position at or after one, wrapping around
+/// @param start The first position probed
+/// @return The position, or none if all are taken
+boost::optional<std::size_t> sti::chair_allocator::free_tree::probe(std::size_t start) const
+{
+    if (_free == 0) return boost::none;
+
+    // The free positions before the start are skipped, unless all are
+    const auto skipped = before(start);
+    return find(skipped < _free ? skipped : 0);
+}
+
+/// @brief Get the number of positions
+std::size_t sti::chair_allocator::free_tree::size() const
+{
+    return _counts.size() - 1;
+}
+
+/// @brief Get the number of free positions
+std::uint32_t sti::chair_allocator::free_tree::free() const
+{
+    return _free;
+}
+
+/// @brief Get the heap bytes of the tree
+std::size_t sti::chair_allocator::free_tree::memory_bytes() const
+{
+    return memory::bytes(_counts);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create an allocator of free chairs in one region
+/// @param chairs The number of chairs
+sti::chair_allocator::chair_allocator(std::size_t chairs)
+    : chair_allocator { std::vector<int>(chairs, 0) }
+{
+}
+
+/// @brief Create an allocator of free chairs split by region
+/// @param regions The region of each chair, by position in the pool
+sti::chair_allocator::chair_allocator(const std::vector<int>& regions)
+    : _free { regions.size() }
+{
+    auto keys = regions;
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    auto members = std::vector<std::vector<std::size_t>>(keys.size());
+    _slots.reserve(regions.size());
+    for (auto c = std::size_t { 0 }; c < regions.size(); ++c) {
+        const auto r = static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.end(), regions[c]) - keys.begin());
+        _slots.push_back({ static_cast<std::uint32_t>(r), static_cast<std::uint32_t>(members[r].size()), false });
+        members[r].push_back(c);
+    }
+
+    _regions.reserve(keys.size());
+    for (auto r = std::size_t { 0 }; r < keys.size(); ++r) {
+        const auto size = members[r].size();
+        _regions.push_back({ keys[r], std::move(members[r]), free_tree { size } });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Take a free chair
+/// @param region The region of the requester, ignored for one region
+/// @param random A uniform number in [0, 1), the start of the probe
+/// @return The position of the chair, or none if all are in use
+boost::optional<std::size_t> sti::chair_allocator::take(int region, double random)
+{
+    if (_free == 0) return boost::none;
+
+    // The regions around the one of the requester, nearest key first and the
+    // lower one on ties, until one has a free chair
+    const auto first = std::lower_bound(_regions.begin(), _regions.end(), region, [](const auto& r, int key) {
+        return r.key < key;
+    });
+    auto up   = static_cast<std::size_t>(first - _regions.begin());
+    auto down = up;
+    while (true) {
+        auto r = std::size_t {};
+        if (down == 0) {
+            r = up++;
+        } else if (up == _regions.size()) {
+            r = --down;
+        } else if (std::abs(_regions[up].key - region) < std::abs(_regions[down - 1].key - region)) {
+            r = up++;
+        } else {
+            r = --down;
+        }
+
+        auto& candidate = _regions[r];
+        if (candidate.tree.free() == 0) continue;
+
+        const auto start    = static_cast<std::size_t>(random * static_cast<double>(candidate.tree.size()));
+        const auto position = *candidate.tree.probe(start);
+        const auto chair    = candidate.chairs[position];
+        candidate.tree.add(position, -1);
+        _slots[chair].in_use = true;
+        --_free;
+        return chair;
+    }
+}
+
+/// @brief Release a chair
+/// @param chair The position of the chair
+/// @return True if the chair was in use
+bool sti::chair_allocator::release(std::size_t chair)
+{
+    auto& s = _slots.at(chair);
+    if (!s.in_use) return false;
+
+    _regions[s.region].tree.add(s.position, 1);
+    s.in_use = false;
+    ++_free;
+    return true;
+}
+
+/// @brief Mark a chair as in use or free, restoring a pool
+/// @param chair The position of the chair
+/// @param in_use True if the chair is in use
+void sti::chair_allocator::assign(std::size_t chair, bool in_use)
+{
+    auto& s = _slots.at(chair);
+    if (s.in_use == in_use) return;
+
+    _regions[s.region].tree.add(s.position, in_use ? -1 : 1);
+    s.in_use = in_use;
+    _free    = in_use ? _free - 1 : _free + 1;
+}
+
+/// @brief Get the number of free chairs
+std::size_t sti::chair_allocator::free() const
+{
+    return _free;
+}
+
+/// @brief Get the heap bytes of the trees
+std::size_t sti::chair_allocator::memory_bytes() const
+{
+    auto bytes = memory::bytes(_regions) + memory::bytes(_slots);
+    for (const auto& r : _regions) bytes += memory::bytes(r.chairs) + r.tree.memory_bytes();
+    return bytes;
+}
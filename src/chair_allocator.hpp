@@ -0,0 +1,128 @@
+/// @file chair_allocator.hpp
+/// @brief The free chairs of a chair manager, indexed by position and region
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sti {
+
+/// @brief The free chairs of a pool, split by region
+/// @details A chair is taken by probing the pool from a random position, the
+/// first free chair at or after it, wrapping around. Instead of scanning the
+/// pool, the free chairs are counted in a Fenwick tree by position, so the
+/// probe is a prefix count and a search, O(log n), and the release of a chair
+/// by its position too. The result is the same chair the scan returned, and
+/// the allocator is rebuilt from the in_use flags of the pool, it doesn't
+/// change the checkpoints.
+///
+/// With regions, usually the rank whose local dimensions contain the chair,
+/// each region has its own tree: take() probes the region of the requester
+/// first, and then the other regions, nearest first.
+class chair_allocator {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create an allocator without chairs
+    chair_allocator() = default;
+
+    /// @brief Create an allocator of free chairs in one region
+    /// @param chairs The number of chairs
+    explicit chair_allocator(std::size_t chairs);
+
+    /// @brief Create an allocator of free chairs split by region
+    /// @param regions The region of each chair, by position in the pool
+    explicit chair_allocator(const std::vector<int>& regions);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Take a free chair
+    /// @param region The region of the requester, ignored for one region
+    /// @param random A uniform number in [0, 1), the start of the probe
+    /// @return The position of the chair, or none if all are in use
+    boost::optional<std::size_t> take(int region, double random);
+
+    /// @brief Release a chair
+    /// @param chair The position of the chair
+    /// @return True if the chair was in use
+    bool release(std::size_t chair);
+
+    /// @brief Mark a chair as in use or free, restoring a pool
+    /// @param chair The position of the chair
+    /// @param in_use True if the chair is in use
+    void assign(std::size_t chair, bool in_use);
+
+    /// @brief Get the number of free chairs
+    std::size_t free() const;
+
+    /// @brief Get the heap bytes of the trees
+    std::size_t memory_bytes() const;
+
+private:
+    /// @brief Free positions counted in a Fenwick tree
+    class free_tree {
+
+    public:
+        /// @brief Create a tree with all the positions free
+        /// @param size The number of positions
+        explicit free_tree(std::size_t size);
+
+        /// @brief Add to the count of a position
+        /// @param position The position
+        /// @param delta 1 to free it, -1 to take it
+        void add(std::size_t position, int delta);
+
+        /// @brief Get the free positions before one
+        /// @param position The position, excluded
+        std::uint32_t before(std::size_t position) const;
+
+        /// @brief Get the position of the n-th free one, from 0
+        /// @param n The rank of the free position, less than free()
+        std::size_t find(std::uint32_t n) const;
+
+        /// @brief Get the first free position at or after one, wrapping around
+        /// @param start The first position probed
+        /// @return The position, or none if all are taken
+        boost::optional<std::size_t> probe(std::size_t start) const;
+
+        /// @brief Get the number of positions
+        std::size_t size() const;
+
+        /// @brief Get the number of free positions
+        std::uint32_t free() const;
+
+        /// @brief Get the heap bytes of the tree
+        std::size_t memory_bytes() const;
+
+    private:
+        std::vector<std::uint32_t> _counts; // 1-based, _counts[0] unused
+        std::uint32_t              _free {};
+    };
+
+    /// @brief The chairs of a region
+    struct region_chairs {
+        int                      key;
+        std::vector<std::size_t> chairs; // Positions in the pool, ascending
+        free_tree                tree;
+    };
+
+    /// @brief The place of a chair in its region
+    struct slot {
+        std::uint32_t region;
+        std::uint32_t position;
+        bool          in_use;
+    };
+
+    std::vector<region_chairs> _regions; // Sorted by key
+    std::vector<slot>          _slots;   // By position in the pool
+    std::size_t                _free {};
+}; // class chair_allocator
+
+} // namespace sti
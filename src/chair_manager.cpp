@@ -1,13 +1,16 @@
 #include <algorithm>
 #include <boost/json.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/mpi/collectives.hpp>
+#include <boost/serialization/map.hpp>
 #include <boost/serialization/optional.hpp>
+#include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/vector.hpp>
+#include <repast_hpc/GridDimensions.h>
 #include <cstdint>
-#include <fstream>
 #include <memory>
-#include <repast_hpc/Random.h>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -15,7 +18,12 @@
 #include "clock.hpp"
 #include "infection_logic/object_infection.hpp"
 #include "infection_logic/infection_factory.hpp"
+#include "infection_trace.hpp"
 #include "contagious_agent.hpp"
+#include "counter_rng.hpp"
+#include "manager_wire.hpp"
+#include "memory_usage.hpp"
+#include "output_files.hpp"
 #include "space_wrapper.hpp"
 
 ////////////////////////////////////////////////////////////////////////////
@@ -34,34 +42,70 @@ sti::chair_manager::chair_manager(const space_wrapper* space)
 /// @param inf_fac The infection factory
 void sti::chair_manager::create_chairs(const hospital_plan& hospital_plan, infection_factory& inff)
 {
+    using entity = counter_rng::entity;
     for (const auto& chair : hospital_plan.chairs()) {
         if (_space->local_dimensions().contains(chair.location)) {
+            const auto subject = counter_rng::subject(entity::CHAIR, chair.location.x, chair.location.y);
             _chair_pool.push_back({ chair.location,
-                                    inff.make_object_infection("chair", object_infection::STAGE::CLEAN) });
+                                    inff.make_object_infection("chair", object_infection::STAGE::CLEAN, subject) });
         }
     }
+
+    // The pool doesn't change anymore, the chairs can be referenced
+    for (auto i = std::size_t { 0 }; i < _chair_pool.size(); ++i) {
+        _chair_at[_chair_pool[i].first] = i;
+        _cleanings.add(&_chair_pool[i].second);
+    }
 }
 
 /// @brief Execute the periodic logic
+/// @details Only the chairs with agents on top interact, and only the
+/// chairs whose cleaning is due are cleaned
 void sti::chair_manager::tick()
 {
-    for (auto& [chair_location, chair_infection] : _chair_pool) {
-        for (auto& agent : _space->agents_in_cell(chair_location)) {
-            chair_infection.interact_with(*agent->get_infection_logic());
-            agent->get_infection_logic()->interact_with(chair_infection);
-        }
-        chair_infection.tick();
+    // Look up the chair under each agent of the snapshot, the agents of the
+    // same chair are visited in the same order than in the spatial index
+    const auto& store = _space->store();
+    _occupied         = 0;
+    for (auto slot = agent_store::slot_type { 0 }; slot < store.size(); ++slot) {
+        auto* agent = store.agent_at(slot);
+        if (agent == nullptr) continue;
+
+        const auto chair = _chair_at.find(store.location_at(slot).discrete());
+        if (chair == _chair_at.end()) continue;
+        ++_occupied;
+
+        auto& chair_infection = _chair_pool[chair->second].second;
+        chair_infection.interact_with(*agent->get_infection_logic());
+        agent->get_infection_logic()->interact_with(chair_infection);
+        if (_trace != nullptr) _trace->interaction(chair_infection, agent->getId());
     }
+
+    _cleanings.tick();
+}
+
+/// @brief Record the interactions of the chairs in an infection trace
+/// @details The chairs must be already created, they are declared in the trace
+/// @param trace The trace, outlives the manager
+void sti::chair_manager::record_to(infection_trace* trace)
+{
+    _trace = trace;
+    for (const auto& [location, infection] : _chair_pool) _trace->declare_object(infection);
 }
 
 ////////////////////////////////////////////////////////////////////////////
 // STATISTICS
 ////////////////////////////////////////////////////////////////////////////
 
+/// @brief Get the agents on top of the chairs of this process in the last tick()
+std::uint32_t sti::chair_manager::occupied() const
+{
+    return _occupied;
+}
+
 /// @brief Save stats
-/// @param folderpath The folder to save the results to
-/// @param rank The rank of the process
-void sti::chair_manager::save(const std::string& folderpath, int rank) const
+/// @param output The result files
+void sti::chair_manager::save(output_files& output) const
 {
     auto output_array = boost::json::array {};
 
@@ -69,13 +113,42 @@ void sti::chair_manager::save(const std::string& folderpath, int rank) const
         output_array.push_back(infection.stats());
     }
 
-    auto os = std::ostringstream {};
-    os << folderpath
-       << "/chairs.p"
-       << rank
-       << ".json";
-    auto chairs_file = std::ofstream { os.str() };
-    chairs_file << output_array;
+    output.write("chairs", "json", [output_array = std::move(output_array)]() { return boost::json::serialize(output_array); });
+}
+
+/// @brief Get the heap bytes of the chairs of this process and their cleanings
+std::size_t sti::chair_manager::memory_bytes() const
+{
+    return memory::bytes(_chair_pool) + memory::bytes(_chair_at) + _cleanings.memory_bytes();
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the infection state of the chairs of this process
+/// @param ar The archive of the checkpoint
+void sti::chair_manager::save_state(oarchive& ar) const
+{
+    ar << _chair_pool.size();
+    for (const auto& [location, infection] : _chair_pool) {
+        ar << infection;
+    }
+}
+
+/// @brief Read the infection state of the chairs of this process
+/// @throws bad_checkpoint If the chairs are not the same
+/// @param ar The archive of the checkpoint
+void sti::chair_manager::load_state(iarchive& ar)
+{
+    auto chairs = std::size_t {};
+    ar >> chairs;
+    if (chairs != _chair_pool.size()) throw bad_checkpoint {};
+
+    for (auto& [location, infection] : _chair_pool) {
+        ar >> infection;
+    }
+    _cleanings.reschedule();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -97,9 +170,10 @@ sti::proxy_chair_manager::proxy_chair_manager(communicator*        comm,
 
 /// @brief Request an empty chair
 /// @param id The id of the agent requesting a chair
-void sti::proxy_chair_manager::request_chair(const repast::AgentId& id)
+/// @param subject The stable subject of the agent, for the random chair
+void sti::proxy_chair_manager::request_chair(const agent_key& id, std::uint64_t subject)
 {
-    const auto& msg = chair_request_msg { id };
+    const auto& msg = chair_request_msg { id, subject };
     _request_buffer.push_back(msg);
 }
 
@@ -114,66 +188,85 @@ void sti::proxy_chair_manager::release_chair(const coordinates& chair_loc)
 /// @brief Check if there is a response without removing from the queue
 /// @param id The id of the agent requesting the chair
 /// @return An optional containing the response, if the manager already processed the request
-boost::optional<sti::chair_response_msg> sti::proxy_chair_manager::peek_response(const repast::AgentId& id)
+boost::optional<sti::chair_response_msg> sti::proxy_chair_manager::peek_response(const agent_key& id)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.agent_id == id;
-                                 });
-
-    // The number of messages for that id that are pending
-    if (it == _pending_responses.end())
-        return {};
-
-    return *it;
+    return _pending_responses.peek(id);
 }
 
 /// @brief Get the response of a chair request
 /// @param id The id of the agent requesting the chair
 /// @return An optional containing the response, if the manager already processed the request
-boost::optional<sti::chair_response_msg> sti::proxy_chair_manager::get_response(const repast::AgentId& id)
+boost::optional<sti::chair_response_msg> sti::proxy_chair_manager::get_response(const agent_key& id)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.agent_id == id;
-                                 });
-
-    if (it == _pending_responses.end()) {
-        return boost::none;
-    }
-
-    const auto response = *it;
-    _pending_responses.erase(it);
-    return response;
+    return _pending_responses.take(id);
 }
 
-/// @brief Send the requests and retrieve the pending responses
-void sti::proxy_chair_manager::sync()
+/// @brief Check if there are requests or releases since the last exchange
+/// @param destination The rank of the process
+bool sti::proxy_chair_manager::pending_requests(int destination) const
 {
-    // Send requests and releases
-    _world->send(_real_rank, mpi_base_tag + 0, _request_buffer);
-    _world->send(_real_rank, mpi_base_tag + 1, _release_buffer);
+    return destination == _real_rank && (!_request_buffer.empty() || !_release_buffer.empty());
+}
 
-    // Receive responses
-    auto new_responses = std::vector<chair_response_msg> {};
-    _world->recv(_real_rank, mpi_base_tag + 2, new_responses);
-    _pending_responses.insert(_pending_responses.end(), new_responses.begin(), new_responses.end());
+/// @brief Write the requests and releases since the last exchange
+/// @param destination The rank of the process
+/// @param ar The archive of the message to the real manager
+void sti::proxy_chair_manager::write_requests(int /*unused*/, oarchive& ar)
+{
+    write_wires<chair_request_wire>(ar, _request_buffer);
+    write_wires<chair_release_wire>(ar, _release_buffer);
 
     // Clear the buffers
     _request_buffer.clear();
     _release_buffer.clear();
 }
 
+/// @brief Read the responses to the requests
+/// @param source The rank of the process
+/// @param ar The archive of the message from the real manager
+void sti::proxy_chair_manager::read_responses(int /*unused*/, iarchive& ar)
+{
+    auto new_responses = std::vector<chair_response_msg> {};
+    read_wires<chair_response_wire>(ar, new_responses);
+    for (const auto& response : new_responses) {
+        _pending_responses.put(response.agent_id, response);
+    }
+}
+
 /// @brief Save stats
-/// @param folderpath The folder to save the results to
-/// @param rank The rank of the process
-void sti::proxy_chair_manager::save(const std::string& folderpath, int rank) const
+/// @param output The result files
+void sti::proxy_chair_manager::save(output_files& output) const
+{
+    chair_manager::save(output);
+}
+
+/// @brief Get the heap bytes of the chairs and the messages not yet exchanged
+std::size_t sti::proxy_chair_manager::memory_bytes() const
+{
+    return chair_manager::memory_bytes()
+        + memory::bytes(_request_buffer)
+        + memory::bytes(_release_buffer)
+        + _pending_responses.memory_bytes();
+}
+
+/// @brief Write the chairs and the messages not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_chair_manager::save_state(oarchive& ar) const
 {
-    chair_manager::save(folderpath, rank);
+    chair_manager::save_state(ar);
+    ar << _request_buffer;
+    ar << _release_buffer;
+    ar << _pending_responses;
+}
+
+/// @brief Read the chairs and the messages not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_chair_manager::load_state(iarchive& ar)
+{
+    chair_manager::load_state(ar);
+    ar >> _request_buffer;
+    ar >> _release_buffer;
+    ar >> _pending_responses;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -184,51 +277,71 @@ namespace {
 
 /// @brief Release a chair
 /// @param chair_pool The chairs
+/// @param chair_index The position of each chair in the pool
+/// @param allocator The free chairs of the pool
 /// @param location The location of the chair to release
-void release(std::vector<sti::real_chair_manager::chair>& chair_pool,
-             sti::coordinates<double>                     location)
+/// @return True if the chair was in use
+bool release(std::vector<sti::real_chair_manager::chair>&                    chair_pool,
+             const std::unordered_map<sti::coordinates<double>, std::size_t>& chair_index,
+             sti::chair_allocator&                                            allocator,
+             sti::coordinates<double>                                         location)
 {
-    const auto it = std::find_if(chair_pool.begin(), chair_pool.end(), [&](const auto& chair) {
-        return chair.location == location;
-    });
+    const auto it = chair_index.find(location);
 
-    // If the chair is not in the vector, something went wrong
-    if (it == chair_pool.end()) throw std::exception {};
+    // If the chair is not in the pool, something went wrong
+    if (it == chair_index.end()) throw std::exception {};
 
     // Otherwise, mark it as unused
-    it->in_use = false;
+    chair_pool[it->second].in_use = false;
+    return allocator.release(it->second);
 }
 
 /// @brief Get an empty chair
 /// @param chair_pool The pool of chairs
-sti::chair_response_msg search_chair(std::vector<sti::real_chair_manager::chair>& chair_pool)
+/// @param allocator The free chairs of the pool
+/// @param region The region of the requester, see chair_allocator
+/// @param subject The stable subject of the agent requesting the chair
+sti::chair_response_msg search_chair(std::vector<sti::real_chair_manager::chair>& chair_pool,
+                                     sti::chair_allocator&                        allocator,
+                                     int                                          region,
+                                     std::uint64_t                                subject)
 {
     // Chairs assigned need to be random otherwise the first chair will be
     // constantly in use, and infection rate goes to hell.
     // To pick a random chair, generate a random number in the range
-    // [0, number_of_chairs), and start looking for an empty chair at that point
-    // If after number_of_chairs iterations none is found, there are no chairs
-    // available.
-    // FIXME: it will be easier to keep a counter with the number of empty
-    // chairs, to determine if there are chairs available in O(1) instead of 
-    // this horrible O(N)
-
-    auto c          = static_cast<std::uint32_t>(repast::Random::instance()->nextDouble() * static_cast<double>(chair_pool.size()));
-    auto iterations = 0U;
+    // [0, number_of_chairs), and take the first empty chair at that point,
+    // the allocator finds it without scanning the pool
+    const auto random = sti::counter_rng::instance().uniform(sti::counter_rng::event::CHAIR, subject);
+    const auto c      = allocator.take(region, random);
+    if (!c) return sti::chair_response_msg { {}, boost::none };
+
+    chair_pool[*c].in_use = true;
+    return sti::chair_response_msg { {}, chair_pool[*c].location };
+}
 
-    while (iterations < chair_pool.size()) {
+/// @brief Get the region of each chair, the lowest rank containing it, collective
+/// @details The chairs outside every process are in region -1
+/// @param comm The MPI communicator
+/// @param building The hospital plan
+/// @param space A pointer to the space
+std::vector<int> chair_regions(boost::mpi::communicator* comm,
+                               const sti::hospital_plan& building,
+                               const sti::space_wrapper* space)
+{
+    const auto& chairs = building.chairs();
 
-        if (!chair_pool.at(c).in_use) {
-            chair_pool.at(c).in_use = true;
-            return sti::chair_response_msg { {}, chair_pool.at(c).location };
-        }
+    auto local = std::vector<std::uint32_t> {};
+    for (auto i = std::uint32_t { 0 }; i < chairs.size(); ++i) {
+        if (space->local_dimensions().contains(chairs[i].location)) local.push_back(i);
+    }
+    auto all = std::vector<std::vector<std::uint32_t>> {};
+    boost::mpi::all_gather(*comm, local, all);
 
-        ++c;
-        c = c >= chair_pool.size() ? 0 : c;
-        ++iterations;
+    auto regions = std::vector<int>(chairs.size(), -1);
+    for (auto rank = static_cast<int>(all.size()) - 1; rank >= 0; --rank) {
+        for (const auto i : all[static_cast<std::size_t>(rank)]) regions[i] = rank;
     }
-    
-    return sti::chair_response_msg { {}, boost::none };
+    return regions;
 }
 
 } // namespace
@@ -249,24 +362,28 @@ public:
         free_chairs.push_back(c);
     }
 
-    /// @brief Save the stats to a given folder
-    void save(const std::string& folderpath, int rank)
+    /// @brief Save the stats to the result files, formatted from a copy
+    void save(output_files& output)
     {
-        auto os = std::ostringstream {};
-        os << folderpath
-           << "/chair_availability.p"
-           << rank
-           << ".csv";
-        auto avail_file = std::ofstream { os.str() };
-
-        avail_file << "tick" << ','
-                   << "free_chairs" << '\n';
-
-        auto tick = 0;
-        for (const auto& entry : free_chairs) {
-            avail_file << tick++ << ','
-                       << entry << '\n';
-        }
+        output.write("chair_availability", "csv", [free_chairs = free_chairs]() {
+            auto avail_file = std::ostringstream {};
+
+            avail_file << "tick" << ','
+                       << "free_chairs" << '\n';
+
+            auto tick = 0;
+            for (const auto& entry : free_chairs) {
+                avail_file << tick++ << ','
+                           << entry << '\n';
+            }
+            return avail_file.str();
+        });
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& free_chairs;
     }
 
 private:
@@ -281,143 +398,588 @@ private:
 /// @param comm The MPI communicator
 /// @param building The hospital plan
 /// @param space A pointer to the space
-sti::real_chair_manager::real_chair_manager(communicator*        comm,
-                                            const hospital_plan& building,
-                                            const space_wrapper* space)
+/// @param regions The region of each chair, to take the chairs of the
+/// requester's process first, or empty for one region
+sti::real_chair_manager::real_chair_manager(communicator*           comm,
+                                            const hospital_plan&    building,
+                                            const space_wrapper*    space,
+                                            const std::vector<int>& regions)
     : chair_manager { space }
     , _world { comm }
+    , _allocator { regions.empty() ? chair_allocator { building.chairs().size() } : chair_allocator { regions } }
+    , _by_region { !regions.empty() }
     , _stats { /*std::make_unique<statistics>()*/ }
 {
     for (const auto& chair : building.chairs()) {
+        _chair_index[chair.location.continuous()] = _chair_pool.size();
         _chair_pool.push_back({ chair.location.continuous(), false });
     }
 }
 
 /// @brief Request an empty chair
 /// @param id The id of the agent requesting a chair
-void sti::real_chair_manager::request_chair(const repast::AgentId& id)
+/// @param subject The stable subject of the agent, for the random chair
+void sti::real_chair_manager::request_chair(const agent_key& id, std::uint64_t subject)
 {
-    auto response     = search_chair(_chair_pool);
+    auto response     = search_chair(_chair_pool, _allocator, _by_region ? _world->rank() : 0, subject);
     response.agent_id = id;
-    _pending_responses.push_back(response);
+    _pending_responses.put(id, response);
 } // void request_chair(...)
 
 /// @brief Release a chair
 /// @param chair_loc The coordinates of the chair being released
 void sti::real_chair_manager::release_chair(const sti::coordinates<double>& chair_loc)
 {
-    release(_chair_pool, chair_loc);
+    release(_chair_pool, _chair_index, _allocator, chair_loc);
 } // void release_chair(...)
 
 /// @brief Check if there is a response without removing from the queue
 /// @param id The id of the agent requesting the chair
 /// @return An optional containing the response, if the manager already processed the request
-boost::optional<sti::chair_response_msg> sti::real_chair_manager::peek_response(const repast::AgentId& id)
+boost::optional<sti::chair_response_msg> sti::real_chair_manager::peek_response(const agent_key& id)
+{
+    return _pending_responses.peek(id);
+}
+
+/// @brief Get the response of a chair request
+/// @param id The id of the agent requesting the chair
+/// @return An optional containing the response, if the manager already processed the request
+boost::optional<sti::chair_response_msg> sti::real_chair_manager::get_response(const agent_key& id)
+{
+    return _pending_responses.take(id);
+}
+
+/// @brief Read the requests and releases of a proxy
+/// @param source The rank of the proxy
+/// @param ar The archive of the message from the proxy
+void sti::real_chair_manager::read_requests(int source, iarchive& ar)
+{
+    auto requests = std::vector<chair_request_msg> {};
+    read_wires<chair_request_wire>(ar, requests);
+    read_wires<chair_release_wire>(ar, _incoming_releases);
+    for (const auto& req : requests) _incoming_requests.emplace_back(source, req);
+}
+
+/// @brief Process the releases first, then the requests
+void sti::real_chair_manager::serve()
+{
+    _outgoing_responses.clear();
+
+    // Process releases first
+    for (const auto& r : _incoming_releases) {
+        release(_chair_pool, _chair_index, _allocator, r.chair_location);
+    }
+
+    // Now process the requests, the receiver is the process that sent them,
+    // the process of the agent. They are served by subject, not in the
+    // order of the ranks, which depends on the layout
+    std::stable_sort(_incoming_requests.begin(), _incoming_requests.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.subject < rhs.second.subject;
+    });
+    for (const auto& [from_rank, req] : _incoming_requests) {
+        auto response     = search_chair(_chair_pool, _allocator, _by_region ? from_rank : 0, req.subject);
+        response.agent_id = req.agent_id;
+        _outgoing_responses[from_rank].push_back(response);
+    }
+
+    _incoming_requests.clear();
+    _incoming_releases.clear();
+
+    // Count the chairs
+    if (_stats) {
+        _stats->push_free_chairs(static_cast<statistics::counter_type>(_allocator.free()));
+    }
+}
+
+/// @brief Check if a proxy must receive responses
+/// @param destination The rank of the proxy
+bool sti::real_chair_manager::pending_responses(int destination) const
+{
+    const auto it = _outgoing_responses.find(destination);
+    return it != _outgoing_responses.end() && !it->second.empty();
+}
+
+/// @brief Write the responses to the requests of a proxy
+/// @param destination The rank of the proxy
+/// @param ar The archive of the message to the proxy
+void sti::real_chair_manager::write_responses(int destination, oarchive& ar)
+{
+    write_wires<chair_response_wire>(ar, _outgoing_responses[destination]);
+}
+
+/// @brief Save stats
+/// @param output The result files
+void sti::real_chair_manager::save(output_files& output) const
+{
+    chair_manager::save(output);
+    if (_stats) {
+        _stats->save(output);
+    }
+}
+
+/// @brief Get the heap bytes of the pool and the messages not yet exchanged
+std::size_t sti::real_chair_manager::memory_bytes() const
+{
+    return chair_manager::memory_bytes()
+        + memory::bytes(_chair_pool)
+        + memory::bytes(_chair_index)
+        + _allocator.memory_bytes()
+        + _pending_responses.memory_bytes()
+        + memory::bytes(_incoming_requests)
+        + memory::bytes(_incoming_releases)
+        + memory::bytes(_outgoing_responses);
+}
+
+/// @brief Write the chairs, the pool and the responses not yet read
+/// @param ar The archive of the checkpoint
+void sti::real_chair_manager::save_state(oarchive& ar) const
+{
+    chair_manager::save_state(ar);
+    ar << _chair_pool;
+    ar << _pending_responses;
+    if (_stats) ar << *_stats;
+}
+
+/// @brief Read the chairs, the pool and the responses not yet read
+/// @details The free chairs are restored from the pool
+/// @param ar The archive of the checkpoint
+void sti::real_chair_manager::load_state(iarchive& ar)
+{
+    chair_manager::load_state(ar);
+    ar >> _chair_pool;
+    for (auto i = std::size_t { 0 }; i < _chair_pool.size(); ++i) _allocator.assign(i, _chair_pool[i].in_use);
+    ar >> _pending_responses;
+    if (_stats) ar >> *_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SHARDED_CHAIR_MANAGER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Construct a sharded chair manager, collective
+/// @param comm The MPI communicator
+/// @param building The hospital plan
+/// @param space A pointer to the space
+/// @param max_hops The most shards a request is forwarded to, 0 for all of them
+sti::sharded_chair_manager::sharded_chair_manager(communicator*        comm,
+                                                  const hospital_plan& building,
+                                                  const space_wrapper* space,
+                                                  std::size_t          max_hops)
+    : chair_manager { space }
+    , _world { comm }
+{
+    const auto& chairs = building.chairs();
+
+    // The chairs inside the local dimensions of each process, a chair in the
+    // border of two processes goes to the lowest rank
+    auto local = std::vector<std::uint32_t> {};
+    for (auto i = std::uint32_t { 0 }; i < chairs.size(); ++i) {
+        if (space->local_dimensions().contains(chairs[i].location)) local.push_back(i);
+    }
+    auto all = std::vector<std::vector<std::uint32_t>> {};
+    boost::mpi::all_gather(*_world, local, all);
+
+    for (auto rank = 0; rank < static_cast<int>(all.size()); ++rank) {
+        auto owns = false;
+        for (const auto i : all[static_cast<std::size_t>(rank)]) {
+            const auto location = chairs[i].location.continuous();
+            if (!_chair_owner.emplace(location, rank).second) continue;
+            owns = true;
+
+            if (rank == _world->rank()) {
+                _chair_index[location] = _chair_pool.size();
+                _chair_pool.push_back({ location, false });
+            }
+        }
+        if (owns && rank != _world->rank()) _neighbours.push_back(rank);
+    }
+    _free_chairs = _chair_pool.size();
+    _allocator   = chair_allocator { _chair_pool.size() };
+
+    // Forward to the shards whose regions are nearest first, by the distance
+    // between the centres of the regions, the ranks break the ties. With a
+    // 2D split the ranks far in number can be adjacent, and the reverse
+    const auto dims    = space->local_dimensions();
+    const auto centre  = std::vector<double> { dims.origin().getX() + dims.extents().getX() / 2.0,
+                                               dims.origin().getY() + dims.extents().getY() / 2.0 };
+    auto       centres = std::vector<std::vector<double>> {};
+    boost::mpi::all_gather(*_world, centre, centres);
+
+    const auto sq_distance = [&](int rank) {
+        const auto& other = centres[static_cast<std::size_t>(rank)];
+        const auto  dx    = other[0] - centre[0];
+        const auto  dy    = other[1] - centre[1];
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(_neighbours.begin(), _neighbours.end(), [&](auto lhs, auto rhs) {
+        return sq_distance(lhs) < sq_distance(rhs);
+    });
+
+    // A request is rejected after the nearest shards, instead of waiting an
+    // exchange for each shard of the simulation
+    if (max_hops != 0 && _neighbours.size() > max_hops) _neighbours.resize(max_hops);
+}
+
+/// @brief Request an empty chair
+/// @param id The id of the agent requesting a chair
+/// @param subject The stable subject of the agent, for the random chair
+void sti::sharded_chair_manager::request_chair(const agent_key& id, std::uint64_t subject)
+{
+    const auto location = take_chair(subject);
+    if (location) {
+        _pending_responses.put(id, { id, location });
+    } else {
+        forward({ id, subject }, 0);
+    }
+}
+
+/// @brief Release a chair
+/// @param chair_loc The coordinates of the chair being released
+void sti::sharded_chair_manager::release_chair(const coordinates& chair_loc)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.agent_id == id;
-                                 });
+    const auto it = _chair_owner.find(chair_loc);
 
-    // The number of messages for that id that are pending
-    if (it == _pending_responses.end()) {
-        return boost::none;
+    // If the chair is not in the plan, something went wrong
+    if (it == _chair_owner.end()) throw std::exception {};
+
+    if (it->second == _world->rank()) {
+        release_owned(chair_loc);
+    } else {
+        _outgoing_releases[it->second].push_back({ chair_loc });
     }
+}
 
-    return *it;
+/// @brief Check if there is a response without removing from the queue
+/// @param id The id of the agent requesting the chair
+/// @return An optional containing the response, if the manager already processed the request
+boost::optional<sti::chair_response_msg> sti::sharded_chair_manager::peek_response(const agent_key& id)
+{
+    return _pending_responses.peek(id);
 }
 
 /// @brief Get the response of a chair request
 /// @param id The id of the agent requesting the chair
 /// @return An optional containing the response, if the manager already processed the request
-boost::optional<sti::chair_response_msg> sti::real_chair_manager::get_response(const repast::AgentId& id)
+boost::optional<sti::chair_response_msg> sti::sharded_chair_manager::get_response(const agent_key& id)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.agent_id == id;
-                                 });
+    return _pending_responses.take(id);
+}
 
-    if (it == _pending_responses.end()) {
-        return boost::none;
+/// @brief Check if there are requests or releases for a shard
+/// @param destination The rank of the shard
+bool sti::sharded_chair_manager::pending_requests(int destination) const
+{
+    return _outgoing_requests.count(destination) != 0 || _outgoing_releases.count(destination) != 0;
+}
+
+/// @brief Write the requests and releases for a shard
+/// @param destination The rank of the shard
+/// @param ar The archive of the message to the shard
+void sti::sharded_chair_manager::write_requests(int destination, oarchive& ar)
+{
+    write_wires<chair_request_wire>(ar, _outgoing_requests[destination]);
+    write_wires<chair_release_wire>(ar, _outgoing_releases[destination]);
+
+    _outgoing_requests.erase(destination);
+    _outgoing_releases.erase(destination);
+}
+
+/// @brief Read the requests and releases of another shard
+/// @param source The rank of the shard
+/// @param ar The archive of the message from the shard
+void sti::sharded_chair_manager::read_requests(int source, iarchive& ar)
+{
+    auto tmp_requests = std::vector<chair_request_msg> {};
+    read_wires<chair_request_wire>(ar, tmp_requests);
+    read_wires<chair_release_wire>(ar, _incoming_releases);
+
+    for (const auto& req : tmp_requests) {
+        _incoming_requests.emplace_back(source, req);
+    }
+}
+
+/// @brief Process the releases first, then the requests
+void sti::sharded_chair_manager::serve()
+{
+    _outgoing_responses.clear();
+
+    for (const auto& r : _incoming_releases) {
+        release_owned(r.chair_location);
     }
 
-    const auto response = *it;
-    _pending_responses.erase(it);
-    return response;
+    // The response goes back to the shard that forwarded the request, it
+    // keeps track of the shards tried. The requests are served by subject,
+    // as the real manager does
+    std::stable_sort(_incoming_requests.begin(), _incoming_requests.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.subject < rhs.second.subject;
+    });
+    for (const auto& [source, req] : _incoming_requests) {
+        _outgoing_responses[source].push_back({ req.agent_id, take_chair(req.subject) });
+    }
+
+    _incoming_requests.clear();
+    _incoming_releases.clear();
+}
+
+/// @brief Check if a shard must receive responses
+/// @param destination The rank of the shard
+bool sti::sharded_chair_manager::pending_responses(int destination) const
+{
+    return _outgoing_responses.count(destination) != 0;
+}
+
+/// @brief Write the responses to the requests of a shard
+/// @param destination The rank of the shard
+/// @param ar The archive of the message to the shard
+void sti::sharded_chair_manager::write_responses(int destination, oarchive& ar)
+{
+    write_wires<chair_response_wire>(ar, _outgoing_responses[destination]);
+}
+
+/// @brief Read the responses to the forwarded requests
+/// @param source The rank of the shard
+/// @param ar The archive of the message from the shard
+void sti::sharded_chair_manager::read_responses(int /*unused*/, iarchive& ar)
+{
+    auto responses = std::vector<chair_response_msg> {};
+    read_wires<chair_response_wire>(ar, responses);
+
+    // A shard without free chairs passes the request to the next one
+    for (const auto& response : responses) {
+        if (response.chair_location) {
+            _forwarded.erase(response.agent_id);
+            _pending_responses.put(response.agent_id, response);
+        } else {
+            const auto& state = _forwarded.at(response.agent_id);
+            forward({ response.agent_id, state.subject }, state.tried + 1);
+        }
+    }
+}
+
+/// @brief Save stats
+/// @param output The result files
+void sti::sharded_chair_manager::save(output_files& output) const
+{
+    chair_manager::save(output);
+}
+
+/// @brief Get the heap bytes of the shard and the messages not yet exchanged
+std::size_t sti::sharded_chair_manager::memory_bytes() const
+{
+    return chair_manager::memory_bytes()
+        + memory::bytes(_chair_pool)
+        + memory::bytes(_chair_index)
+        + _allocator.memory_bytes()
+        + memory::bytes(_chair_owner)
+        + memory::bytes(_neighbours)
+        + _pending_responses.memory_bytes()
+        + memory::bytes(_forwarded)
+        + memory::bytes(_outgoing_requests)
+        + memory::bytes(_outgoing_releases)
+        + memory::bytes(_incoming_requests)
+        + memory::bytes(_incoming_releases)
+        + memory::bytes(_outgoing_responses);
+}
+
+/// @brief Write the chairs, the shard and the messages not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::sharded_chair_manager::save_state(oarchive& ar) const
+{
+    chair_manager::save_state(ar);
+    ar << _chair_pool;
+    ar << _free_chairs;
+    ar << _pending_responses;
+    ar << _forwarded;
+    ar << _outgoing_requests;
+    ar << _outgoing_releases;
+}
 
-} // boost::optional<sti::chair_response_msg> get_response()
+/// @brief Read the chairs, the shard and the messages not yet exchanged
+/// @details The free chairs are restored from the shard
+/// @param ar The archive of the checkpoint
+void sti::sharded_chair_manager::load_state(iarchive& ar)
+{
+    chair_manager::load_state(ar);
+    ar >> _chair_pool;
+    for (auto i = std::size_t { 0 }; i < _chair_pool.size(); ++i) _allocator.assign(i, _chair_pool[i].in_use);
+    ar >> _free_chairs;
+    ar >> _pending_responses;
+    ar >> _forwarded;
+    ar >> _outgoing_requests;
+    ar >> _outgoing_releases;
+}
 
-/// @brief Receive all requests, process, and respond
-void sti::real_chair_manager::sync()
+/// @brief Take a free chair of this shard
+/// @param subject The stable subject of the agent requesting the chair
+/// @return The location of the chair, or none if all are in use
+boost::optional<sti::coordinates<double>> sti::sharded_chair_manager::take_chair(std::uint64_t subject)
 {
+    // The counter avoids probing the whole pool when it's full
+    if (_free_chairs == 0) return boost::none;
 
-    auto in_req       = std::vector<chair_request_msg> {};
-    auto in_rel       = std::vector<chair_release_msg> {};
-    auto out_response = std::map<int, std::vector<chair_response_msg>> {};
+    --_free_chairs;
+    return search_chair(_chair_pool, _allocator, 0, subject).chair_location;
+}
+
+/// @brief Release a chair of this shard
+/// @param chair_loc The coordinates of the chair
+void sti::sharded_chair_manager::release_owned(const coordinates& chair_loc)
+{
+    const auto it = _chair_index.find(chair_loc);
 
-    // First receive the request and releases
-    for (auto i = 0; i < _world->size() - 1; i++) {
-        auto tmp_requests = std::vector<chair_request_msg> {};
-        auto tmp_releases = std::vector<chair_release_msg> {};
+    // If the chair is not in the shard, something went wrong
+    if (it == _chair_index.end()) throw std::exception {};
 
-        _world->recv(boost::mpi::any_source, mpi_base_tag + 0, tmp_requests);
-        _world->recv(boost::mpi::any_source, mpi_base_tag + 1, tmp_releases);
+    _chair_pool[it->second].in_use = false;
+    if (_allocator.release(it->second)) ++_free_chairs;
+}
 
-        in_req.insert(in_req.end(), tmp_requests.begin(), tmp_requests.end());
-        in_rel.insert(in_rel.end(), tmp_releases.begin(), tmp_releases.end());
+/// @brief Forward a request to the next shard, or reject it if all were tried
+/// @param request The request of the agent
+/// @param tried The number of shards already tried
+void sti::sharded_chair_manager::forward(const chair_request_msg& request, std::size_t tried)
+{
+    const auto& id = request.agent_id;
+    if (tried < _neighbours.size()) {
+        _forwarded[id] = { request.subject, tried };
+        _outgoing_requests[_neighbours[tried]].push_back(request);
+        return;
     }
 
-    // Process releases first
-    for (const auto& r : in_rel) {
-        release(_chair_pool, r.chair_location);
+    _forwarded.erase(id);
+    _pending_responses.put(id, { id, boost::none });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RMA_CHAIR_MANAGER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Construct an RMA chair manager, collective
+/// @param comm The MPI communicator
+/// @param building The hospital plan
+/// @param space A pointer to the space
+sti::rma_chair_manager::rma_chair_manager(communicator*        comm,
+                                          const hospital_plan& building,
+                                          const space_wrapper* space)
+    : chair_manager { space }
+    , _world { comm }
+    , _window { comm, 0, building.chairs().size() + 1, 0 }
+{
+    for (const auto& chair : building.chairs()) {
+        _chair_index[chair.location.continuous()] = _chairs.size();
+        _chairs.push_back(chair.location.continuous());
     }
 
-    // Now process the requests
-    for (const auto& req : in_req) {
-        const auto from_rank = req.agent_id.currentRank();
-        auto       response  = search_chair(_chair_pool);
-        response.agent_id    = req.agent_id;
-        out_response[from_rank].push_back(response);
+    // Only the counter starts with a value, all the chairs are free
+    if (_world->rank() == _window.host()) {
+        _window.store(free_counter, static_cast<rma_counters::value_type>(_chairs.size()));
     }
+    _world->barrier();
+}
 
-    // Count the chairs
-    if (_stats) {
-        const auto free_chairs = std::count_if(_chair_pool.begin(), _chair_pool.end(),
-                                               [](const auto& chair) {
-                                                   return !chair.in_use;
-                                               });
-        _stats->push_free_chairs(free_chairs);
+/// @brief Request an empty chair, answered immediately
+/// @param id The id of the agent requesting a chair
+/// @param subject The stable subject of the agent, for the random chair
+void sti::rma_chair_manager::request_chair(const agent_key& id, std::uint64_t subject)
+{
+    // Take a chair from the counter, or give it back if there was none
+    if (_window.fetch_add(free_counter, -1) <= 0) {
+        _window.fetch_add(free_counter, 1);
+        _pending_responses.put(id, { id, boost::none });
+        return;
     }
 
-    // Generate the missing output buffers,
-    for (auto i = 0; i < _world->size(); i++) {
-        if (_world->rank() != i) {
-            out_response[i];
-        }
+    // A chair is free for this request, start looking at a random one as the
+    // real manager does. Others may take the free chairs seen, but not the
+    // one kept by the counter, so the search ends
+    const auto random = counter_rng::instance().uniform(counter_rng::event::CHAIR, subject);
+    auto       c      = static_cast<std::size_t>(random * static_cast<double>(_chairs.size()));
+    while (_window.compare_swap(c + 1, 0, 1) != 0) {
+        c = c + 1 >= _chairs.size() ? 0 : c + 1;
     }
+    _pending_responses.put(id, { id, _chairs[c] });
+}
 
-    // Send all the messages, the receiver it's in the agent id
-    for (const auto& [from_rank, vector] : out_response) {
-        _world->send(from_rank, mpi_base_tag + 2, vector);
+/// @brief Release a chair
+/// @param chair_loc The coordinates of the chair being released
+void sti::rma_chair_manager::release_chair(const coordinates& chair_loc)
+{
+    const auto it = _chair_index.find(chair_loc);
+
+    // If the chair is not in the plan, something went wrong
+    if (it == _chair_index.end()) throw std::exception {};
+
+    // The chair must be free before anyone can take it from the counter
+    if (_window.compare_swap(it->second + 1, 1, 0) == 1) {
+        _window.fetch_add(free_counter, 1);
     }
 }
 
-/// @brief Save stats
-/// @param folderpath The folder to save the results to
-/// @param rank The rank of the process
-void sti::real_chair_manager::save(const std::string& folderpath, int rank) const
+/// @brief Check if there is a response without removing from the queue
+/// @param id The id of the agent requesting the chair
+/// @return An optional containing the response, if the manager already processed the request
+boost::optional<sti::chair_response_msg> sti::rma_chair_manager::peek_response(const agent_key& id)
 {
-    chair_manager::save(folderpath, rank);
-    if (_stats) {
-        _stats->save(folderpath, _world->rank());
+    return _pending_responses.peek(id);
+}
+
+/// @brief Get the response of a chair request
+/// @param id The id of the agent requesting the chair
+/// @return An optional containing the response, if the manager already processed the request
+boost::optional<sti::chair_response_msg> sti::rma_chair_manager::get_response(const agent_key& id)
+{
+    return _pending_responses.take(id);
+}
+
+/// @brief Get the heap bytes of the chairs and the responses not yet read
+std::size_t sti::rma_chair_manager::memory_bytes() const
+{
+    return chair_manager::memory_bytes()
+        + memory::bytes(_chairs)
+        + memory::bytes(_chair_index)
+        + _pending_responses.memory_bytes();
+}
+
+/// @brief Write the chairs, the window in process 0 and the responses not yet read
+/// @param ar The archive of the checkpoint
+void sti::rma_chair_manager::save_state(oarchive& ar) const
+{
+    chair_manager::save_state(ar);
+    ar << _pending_responses;
+
+    if (_world->rank() == _window.host()) {
+        auto values = std::vector<rma_counters::value_type> {};
+        for (auto i = std::size_t { 0 }; i < _window.size(); ++i) values.push_back(_window.load(i));
+        ar << values;
     }
 }
 
+/// @brief Read the chairs, the window in process 0 and the responses not yet read
+/// @details Collective, no process uses the window until all restored it
+/// @throws bad_checkpoint If the chairs are not the same
+/// @param ar The archive of the checkpoint
+void sti::rma_chair_manager::load_state(iarchive& ar)
+{
+    chair_manager::load_state(ar);
+    ar >> _pending_responses;
+
+    if (_world->rank() == _window.host()) {
+        auto values = std::vector<rma_counters::value_type> {};
+        ar >> values;
+        if (values.size() != _window.size()) throw bad_checkpoint {};
+        for (auto i = std::size_t { 0 }; i < values.size(); ++i) _window.store(i, values[i]);
+    }
+    _world->barrier();
+}
+
 /// @brief Construct a chair manager
+/// @details With chair.manager.rank = sharded every process gets a shard,
+/// and forwards its requests to chair.sharded.hops shards at most (8 by
+/// default, 0 for all of them), with chair.manager.rank = rma the chairs are claimed in an RMA window,
+/// otherwise the property is the rank of the real manager. With
+/// chair.allocation = region the real manager takes the chairs of the
+/// requester's process first, the regions are found collectively
+/// @param execution_props The execution properties
 /// @param comm The MPI communicator
 /// @param building The hospital plan
 /// @param space A pointer to the space
@@ -426,10 +988,23 @@ std::unique_ptr<sti::chair_manager> sti::make_chair_manager(repast::Properties&
                                                             const hospital_plan&      building,
                                                             const space_wrapper*      space)
 {
-    const auto real_rank = boost::lexical_cast<int>(execution_props.getProperty("chair.manager.rank"));
+    const auto rank_prop = execution_props.getProperty("chair.manager.rank");
+    if (rank_prop == "sharded") {
+        const auto hops_prop = execution_props.getProperty("chair.sharded.hops");
+        const auto hops      = hops_prop.empty() ? std::size_t { 8 } : boost::lexical_cast<std::size_t>(hops_prop);
+        return std::make_unique<sharded_chair_manager>(comm, building, space, hops);
+    }
+    if (rank_prop == "rma") {
+        return std::make_unique<rma_chair_manager>(comm, building, space);
+    }
+
+    const auto real_rank = boost::lexical_cast<int>(rank_prop);
+    const auto regions   = execution_props.getProperty("chair.allocation") == "region"
+                               ? chair_regions(comm, building, space)
+                               : std::vector<int> {};
 
     if (comm->rank() == real_rank) {
-        return std::make_unique<real_chair_manager>(comm, building, space);
+        return std::make_unique<real_chair_manager>(comm, building, space, regions);
     }
     return std::make_unique<proxy_chair_manager>(comm, real_rank, space);
 }
\ No newline at end of file
@@ -3,16 +3,24 @@
 #pragma once
 
 #include <boost/mpi/communicator.hpp>
+#include <cstdint>
 #include <map>
 #include <memory>
-#include <repast_hpc/AgentId.h>
 #include <repast_hpc/Properties.h>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "agent_key.hpp"
+#include "chair_allocator.hpp"
+#include "checkpoint.hpp"
 #include "coordinates.hpp"
 #include "hospital_plan.hpp"
+#include "infection_logic/cleaning_queue.hpp"
 #include "infection_logic/object_infection.hpp"
+#include "manager_exchange.hpp"
+#include "response_mailbox.hpp"
+#include "rma_window.hpp"
 
 // Fw. declarations
 namespace repast {
@@ -25,6 +33,8 @@ class optional;
 }
 namespace sti {
 class infection_factory;
+class infection_trace;
+class output_files;
 class space_wrapper;
 }
 
@@ -32,12 +42,14 @@ namespace sti {
 
 /// @brief A chair request, a petition for an empty chair
 struct chair_request_msg {
-    repast::AgentId agent_id;
+    agent_key     agent_id;
+    std::uint64_t subject; // Of the agent, see counter_rng::entity
 
     template <typename Archive>
     void serialize(Archive& ar, const unsigned int /*unused*/)
     {
         ar& agent_id;
+        ar& subject;
     }
 };
 
@@ -57,7 +69,7 @@ struct chair_release_msg {
 struct chair_response_msg {
     // If a chair was available, the response has the coordinates, if there was no
     // chair available, no coordinates are sent
-    repast::AgentId                           agent_id;
+    agent_key                                 agent_id;
     boost::optional<sti::coordinates<double>> chair_location;
 
     template <typename Archive>
@@ -73,9 +85,13 @@ struct chair_response_msg {
 ////////////////////////////////////////////////////////////////////////////
 
 /// @brief Contains an interface for managing chairs, and the infection logic
-class chair_manager {
+class chair_manager : public exchange_participant
+    , public checkpoint_participant {
 
 public:
+    using exchange_participant::iarchive;
+    using exchange_participant::oarchive;
+
     using coordinates  = sti::coordinates<double>;
     using communicator = boost::mpi::communicator;
     template <typename T>
@@ -101,7 +117,8 @@ public:
 
     /// @brief Request an empty chair
     /// @param id The id of the agent requesting a chair
-    virtual void request_chair(const repast::AgentId& id) = 0;
+    /// @param subject The stable subject of the agent, for the random chair
+    virtual void request_chair(const agent_key& id, std::uint64_t subject) = 0;
 
     /// @brief Release a chair
     /// @param chair_loc The coordinates of the chair being released
@@ -110,15 +127,12 @@ public:
     /// @brief Check if there is a response without removing from the queue
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    virtual optional<chair_response_msg> peek_response(const repast::AgentId& id) = 0;
+    virtual optional<chair_response_msg> peek_response(const agent_key& id) = 0;
 
     /// @brief Get the response of a chair request
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    virtual optional<chair_response_msg> get_response(const repast::AgentId& id) = 0;
-
-    /// @brief Synchronize with the other processes
-    virtual void sync() = 0;
+    virtual optional<chair_response_msg> get_response(const agent_key& id) = 0;
 
     ////////////////////////////////////////////////////////////////////////////
     // CHAIR INFECTIONS
@@ -130,20 +144,49 @@ public:
     void create_chairs(const hospital_plan& hospital_plan, infection_factory& inff);
 
     /// @brief Execute the periodic logic
+    /// @details Only the chairs with agents on top interact, and only the
+    /// chairs whose cleaning is due are cleaned
     void tick();
 
+    /// @brief Record the interactions of the chairs in an infection trace
+    /// @details The chairs must be already created, they are declared in the trace
+    /// @param trace The trace, outlives the manager
+    void record_to(infection_trace* trace);
+
     ////////////////////////////////////////////////////////////////////////////
     // STATISTICS
     ////////////////////////////////////////////////////////////////////////////
 
+    /// @brief Get the agents on top of the chairs of this process in the last tick()
+    std::uint32_t occupied() const;
+
     /// @brief Save stats
-    /// @param folderpath The folder to save the results to
-    /// @param rank The rank of the process
-    virtual void save(const std::string& folderpath, int rank) const;
+    /// @param output The result files
+    virtual void save(output_files& output) const;
+
+    /// @brief Get the heap bytes of the chairs of this process and their cleanings
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the infection state of the chairs of this process
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the infection state of the chairs of this process
+    /// @throws bad_checkpoint If the chairs are not the same
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     const space_wrapper*                                            _space;
     std::vector<std::pair<sti::coordinates<int>, object_infection>> _chair_pool;
+    std::unordered_map<sti::coordinates<int>, std::size_t>          _chair_at; // Position in the pool
+    cleaning_queue                                                  _cleanings;
+    infection_trace*                                                _trace {};
+    std::uint32_t                                                   _occupied {};
 };
 
 /// @brief A proxy chair manager, that comunicates with the real one through MPI
@@ -168,7 +211,8 @@ public:
 
     /// @brief Request an empty chair
     /// @param id The id of the agent requesting a chair
-    void request_chair(const repast::AgentId& id) override;
+    /// @param subject The stable subject of the agent, for the random chair
+    void request_chair(const agent_key& id, std::uint64_t subject) override;
 
     /// @brief Release a chair
     /// @param chair_loc The coordinates of the chair being released
@@ -177,28 +221,53 @@ public:
     /// @brief Check if there is a response without removing from the queue
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    optional<chair_response_msg> peek_response(const repast::AgentId& id) override;
+    optional<chair_response_msg> peek_response(const agent_key& id) override;
 
     /// @brief Get the response of a chair request
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    optional<chair_response_msg> get_response(const repast::AgentId& id) override;
+    optional<chair_response_msg> get_response(const agent_key& id) override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are requests or releases since the last exchange
+    /// @param destination The rank of the process
+    bool pending_requests(int destination) const override;
+
+    /// @brief Write the requests and releases since the last exchange
+    /// @param destination The rank of the process
+    /// @param ar The archive of the message to the real manager
+    void write_requests(int destination, oarchive& ar) override;
 
-    /// @brief Send the requests and retrieve the pending responses
-    void sync() override;
+    /// @brief Read the responses to the requests
+    /// @param source The rank of the process
+    /// @param ar The archive of the message from the real manager
+    void read_responses(int source, iarchive& ar) override;
 
     /// @brief Save stats
+    /// @param output The result files
+    void save(output_files& output) const override;
 
-    /// @param rank The rank of the process
-    void save(const std::string& folderpath, int rank) const override;
+    /// @brief Get the heap bytes of the chairs and the messages not yet exchanged
+    std::size_t memory_bytes() const override;
+
+    /// @brief Write the chairs and the messages not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the chairs and the messages not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator* _world;
     int           _real_rank;
 
-    std::vector<chair_request_msg>  _request_buffer;
-    std::vector<chair_release_msg>  _release_buffer;
-    std::vector<chair_response_msg> _pending_responses;
+    std::vector<chair_request_msg>       _request_buffer;
+    std::vector<chair_release_msg>       _release_buffer;
+    response_mailbox<chair_response_msg> _pending_responses;
 };
 
 /// @brief The real chair manager containing the chair pool
@@ -208,6 +277,13 @@ public:
     struct chair {
         sti::coordinates<double> location;
         bool                     in_use;
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& location;
+            ar& in_use;
+        }
     };
     template <typename T>
     using pool_t = std::vector<T>;
@@ -223,13 +299,17 @@ public:
     /// @param comm The MPI communicator
     /// @param building The hospital plan
     /// @param space A pointer to the space
-    real_chair_manager(communicator*        comm,
-                       const hospital_plan& building,
-                       const space_wrapper* space);
+    /// @param regions The region of each chair, to take the chairs of the
+    /// requester's process first, or empty for one region
+    real_chair_manager(communicator*           comm,
+                       const hospital_plan&    building,
+                       const space_wrapper*    space,
+                       const std::vector<int>& regions = {});
 
     /// @brief Request an empty chair
     /// @param id The id of the agent requesting a chair
-    void request_chair(const repast::AgentId& id) override;
+    /// @param subject The stable subject of the agent, for the random chair
+    void request_chair(const agent_key& id, std::uint64_t subject) override;
 
     /// @brief Release a chair
     /// @param chair_loc The coordinates of the chair being released
@@ -238,29 +318,293 @@ public:
     /// @brief Check if there is a response without removing from the queue
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    optional<chair_response_msg> peek_response(const repast::AgentId& id) override;
+    optional<chair_response_msg> peek_response(const agent_key& id) override;
 
     /// @brief Get the response of a chair request
     /// @param id The id of the agent requesting the chair
     /// @return An optional containing the response, if the manager already processed the request
-    optional<chair_response_msg> get_response(const repast::AgentId& id) override;
+    optional<chair_response_msg> get_response(const agent_key& id) override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Read the requests and releases of a proxy
+    /// @param source The rank of the proxy
+    /// @param ar The archive of the message from the proxy
+    void read_requests(int source, iarchive& ar) override;
+
+    /// @brief Process the releases first, then the requests
+    void serve() override;
 
-    /// @brief Receive all requests, process, and respond
-    void sync() override;
+    /// @brief Check if a proxy must receive responses
+    /// @param destination The rank of the proxy
+    bool pending_responses(int destination) const override;
+
+    /// @brief Write the responses to the requests of a proxy
+    /// @param destination The rank of the proxy
+    /// @param ar The archive of the message to the proxy
+    void write_responses(int destination, oarchive& ar) override;
 
     /// @brief Save stats
-    /// @param folderpath The folder to save the results to
-    /// @param rank The rank of the process
-    void save(const std::string& folderpath, int rank) const override;
+    /// @param output The result files
+    void save(output_files& output) const override;
+
+    /// @brief Get the heap bytes of the pool and the messages not yet exchanged
+    std::size_t memory_bytes() const override;
+
+    /// @brief Write the chairs, the pool and the responses not yet read
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the chairs, the pool and the responses not yet read
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
-    communicator*                   _world;
-    pool_t<chair>                   _chair_pool;
-    std::vector<chair_response_msg> _pending_responses;
-    std::unique_ptr<statistics>     _stats;
+    communicator*                                _world;
+    pool_t<chair>                                _chair_pool;
+    std::unordered_map<coordinates, std::size_t> _chair_index; // Position in the pool
+    chair_allocator                              _allocator;   // Free chairs of the pool
+    bool                                         _by_region;   // chair.allocation = region
+    response_mailbox<chair_response_msg>         _pending_responses;
+    std::unique_ptr<statistics>                  _stats;
+
+    // Messages of the proxies received in the current exchange, and the
+    // responses by rank
+    std::vector<std::pair<int, chair_request_msg>>  _incoming_requests;
+    std::vector<chair_release_msg>                  _incoming_releases;
+    std::map<int, std::vector<chair_response_msg>> _outgoing_responses;
+};
+
+/// @brief A shard of a chair manager distributed among all the processes
+/// @details Each process owns the chairs inside its local dimensions, and
+/// answers the requests of its agents with them. Only when all its chairs are
+/// in use the request is forwarded to the other shards, the one whose region
+/// is nearest first, one per exchange until one has a free chair. After a
+/// bounded number of shards the request is rejected, as when all the chairs
+/// are in use. The releases go to the owner of the chair.
+class sharded_chair_manager final : public chair_manager {
+
+public:
+    using chair = real_chair_manager::chair;
+    template <typename T>
+    using pool_t = real_chair_manager::pool_t<T>;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Construct a sharded chair manager, collective
+    /// @param comm The MPI communicator
+    /// @param building The hospital plan
+    /// @param space A pointer to the space
+    /// @param max_hops The most shards a request is forwarded to, 0 for all of them
+    sharded_chair_manager(communicator*        comm,
+                          const hospital_plan& building,
+                          const space_wrapper* space,
+                          std::size_t          max_hops);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Request an empty chair
+    /// @param id The id of the agent requesting a chair
+    /// @param subject The stable subject of the agent, for the random chair
+    void request_chair(const agent_key& id, std::uint64_t subject) override;
+
+    /// @brief Release a chair
+    /// @param chair_loc The coordinates of the chair being released
+    void release_chair(const coordinates& chair_loc) override;
+
+    /// @brief Check if there is a response without removing from the queue
+    /// @param id The id of the agent requesting the chair
+    /// @return An optional containing the response, if the manager already processed the request
+    optional<chair_response_msg> peek_response(const agent_key& id) override;
+
+    /// @brief Get the response of a chair request
+    /// @param id The id of the agent requesting the chair
+    /// @return An optional containing the response, if the manager already processed the request
+    optional<chair_response_msg> get_response(const agent_key& id) override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are requests or releases for a shard
+    /// @param destination The rank of the shard
+    bool pending_requests(int destination) const override;
+
+    /// @brief Write the requests and releases for a shard
+    /// @param destination The rank of the shard
+    /// @param ar The archive of the message to the shard
+    void write_requests(int destination, oarchive& ar) override;
+
+    /// @brief Read the requests and releases of another shard
+    /// @param source The rank of the shard
+    /// @param ar The archive of the message from the shard
+    void read_requests(int source, iarchive& ar) override;
+
+    /// @brief Process the releases first, then the requests
+    void serve() override;
+
+    /// @brief Check if a shard must receive responses
+    /// @param destination The rank of the shard
+    bool pending_responses(int destination) const override;
+
+    /// @brief Write the responses to the requests of a shard
+    /// @param destination The rank of the shard
+    /// @param ar The archive of the message to the shard
+    void write_responses(int destination, oarchive& ar) override;
+
+    /// @brief Read the responses to the forwarded requests
+    /// @param source The rank of the shard
+    /// @param ar The archive of the message from the shard
+    void read_responses(int source, iarchive& ar) override;
+
+    /// @brief Save stats
+    /// @param output The result files
+    void save(output_files& output) const override;
+
+    /// @brief Get the heap bytes of the shard and the messages not yet exchanged
+    std::size_t memory_bytes() const override;
+
+    /// @brief Write the chairs, the shard and the messages not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the chairs, the shard and the messages not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
+private:
+    /// @brief Take a free chair of this shard
+    /// @param subject The stable subject of the agent requesting the chair
+    /// @return The location of the chair, or none if all are in use
+    optional<coordinates> take_chair(std::uint64_t subject);
+
+    /// @brief Release a chair of this shard
+    /// @param chair_loc The coordinates of the chair
+    void release_owned(const coordinates& chair_loc);
+
+    /// @brief Forward a request to the next shard, or reject it if all were tried
+    /// @param request The request of the agent
+    /// @param tried The number of shards already tried
+    void forward(const chair_request_msg& request, std::size_t tried);
+
+    communicator*                                _world;
+    pool_t<chair>                                _chair_pool; // Owned by this shard
+    std::size_t                                  _free_chairs;
+    chair_allocator                              _allocator; // Free chairs of the shard
+    std::unordered_map<coordinates, std::size_t> _chair_index; // Position in the pool
+    std::unordered_map<coordinates, int>         _chair_owner; // All the chairs
+    std::vector<int>                             _neighbours;  // Other shards with chairs, nearest first, up to the hops
+    response_mailbox<chair_response_msg>         _pending_responses;
+
+    /// @brief A request forwarded to other shards
+    struct forwarded_request {
+        std::uint64_t subject;
+        std::size_t   tried; // The number of shards tried
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& subject;
+            ar& tried;
+        }
+    };
+
+    // The requests forwarded, by agent
+    std::unordered_map<agent_key, forwarded_request, agent_key::hash> _forwarded;
+
+    // Messages for the other shards, and received in the current exchange
+    std::map<int, std::vector<chair_request_msg>>  _outgoing_requests;
+    std::map<int, std::vector<chair_release_msg>>  _outgoing_releases;
+    std::vector<std::pair<int, chair_request_msg>> _incoming_requests;
+    std::vector<chair_release_msg>                 _incoming_releases;
+    std::map<int, std::vector<chair_response_msg>> _outgoing_responses;
+};
+
+/// @brief Chair manager claiming the chairs directly in an MPI RMA window
+/// @details The occupancy of all the chairs lives in a window of the process
+/// 0, with a counter of the free chairs in front. A request first takes one
+/// from the counter, then marks a free chair with a compare and swap, so the
+/// response is ready in the same tick and no process serves the others. A
+/// release clears the chair before returning it to the counter, so a request
+/// that got one from the counter always finds a free chair. The assignment in
+/// a tick depends on the order the processes reach the window, so the runs
+/// with more than one process are not reproducible.
+class rma_chair_manager final : public chair_manager {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Construct an RMA chair manager, collective
+    /// @param comm The MPI communicator
+    /// @param building The hospital plan
+    /// @param space A pointer to the space
+    rma_chair_manager(communicator*        comm,
+                      const hospital_plan& building,
+                      const space_wrapper* space);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Request an empty chair, answered immediately
+    /// @param id The id of the agent requesting a chair
+    /// @param subject The stable subject of the agent, for the random chair
+    void request_chair(const agent_key& id, std::uint64_t subject) override;
+
+    /// @brief Release a chair
+    /// @param chair_loc The coordinates of the chair being released
+    void release_chair(const coordinates& chair_loc) override;
+
+    /// @brief Check if there is a response without removing from the queue
+    /// @param id The id of the agent requesting the chair
+    /// @return An optional containing the response, if the manager already processed the request
+    optional<chair_response_msg> peek_response(const agent_key& id) override;
+
+    /// @brief Get the response of a chair request
+    /// @param id The id of the agent requesting the chair
+    /// @return An optional containing the response, if the manager already processed the request
+    optional<chair_response_msg> get_response(const agent_key& id) override;
+
+    /// @brief Get the heap bytes of the chairs and the responses not yet read
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the chairs, the window in process 0 and the responses not yet read
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the chairs, the window in process 0 and the responses not yet read
+    /// @details Collective, no process uses the window until all restored it
+    /// @throws bad_checkpoint If the chairs are not the same
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
+private:
+    static constexpr auto free_counter = std::size_t { 0 }; // Index of the counter in the window
+
+    communicator*                                _world;
+    std::vector<coordinates>                     _chairs;      // All the chairs, in plan order
+    std::unordered_map<coordinates, std::size_t> _chair_index; // Position in the window, after the counter
+    rma_counters                                 _window;
+    response_mailbox<chair_response_msg>         _pending_responses;
 };
 
 /// @brief Construct a chair manager
+/// @details With chair.manager.rank = sharded every process gets a shard,
+/// with chair.manager.rank = rma the chairs are claimed in an RMA window,
+/// otherwise the property is the rank of the real manager
+/// @param execution_props The execution properties
 /// @param comm The MPI communicator
 /// @param building The hospital plan
 /// @param space A pointer to the space
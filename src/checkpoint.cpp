@@ -0,0 +1,93 @@
+/// @file checkpoint.cpp
+/// @brief Saving and restoring the state of the simulation
+#include "checkpoint.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+
+namespace {
+
+/// @brief Read a whole file into a packed archive buffer
+/// @throws bad_checkpoint If the file can't be read
+sti::checkpoint_participant::iarchive::buffer_type read_file(const std::string& path)
+{
+    auto file = std::ifstream { path, std::ios::binary };
+    if (!file) throw sti::bad_checkpoint {};
+
+    auto buffer = sti::checkpoint_participant::iarchive::buffer_type {};
+    buffer.assign(std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {});
+    return buffer;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT WRITER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Start an empty checkpoint
+/// @param comm The MPI communicator
+sti::checkpoint_writer::checkpoint_writer(const boost::mpi::communicator& comm)
+    : _buffer {}
+    , _archive { comm, _buffer }
+{
+}
+
+/// @brief Get the archive, to write the state into
+sti::checkpoint_participant::oarchive& sti::checkpoint_writer::archive()
+{
+    return _archive;
+}
+
+/// @brief Write the checkpoint of this process to its file
+/// @param folder The folder of the checkpoint, created if needed
+/// @param rank The rank of the process
+void sti::checkpoint_writer::write(const std::string& folder, int rank) const
+{
+    // All the processes try to create the folder, only one succeeds
+    auto error = std::error_code {};
+    std::filesystem::create_directories(folder, error);
+
+    auto file = std::ofstream { checkpoint_path(folder, rank), std::ios::binary };
+    file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT READER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Read the checkpoint file of this process
+/// @throws bad_checkpoint If the file can't be read
+/// @param folder The folder of the checkpoint
+/// @param comm The MPI communicator
+sti::checkpoint_reader::checkpoint_reader(const std::string& folder, const boost::mpi::communicator& comm)
+    : _buffer { read_file(checkpoint_path(folder, comm.rank())) }
+    , _archive { comm, _buffer }
+{
+}
+
+/// @brief Get the archive, to read the state from
+sti::checkpoint_participant::iarchive& sti::checkpoint_reader::archive()
+{
+    return _archive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FILES
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the file of a process in a checkpoint
+/// @param folder The folder of the checkpoint
+/// @param rank The rank of the process
+std::string sti::checkpoint_path(const std::string& folder, int rank)
+{
+    auto os = std::ostringstream {};
+    os << folder
+       << "/checkpoint.p"
+       << rank
+       << ".bin";
+    return os.str();
+}
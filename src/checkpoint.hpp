@@ -0,0 +1,121 @@
+/// @file checkpoint.hpp
+/// @brief Saving and restoring the state of the simulation
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/packed_iarchive.hpp>
+#include <boost/mpi/packed_oarchive.hpp>
+#include <exception>
+#include <string>
+
+namespace sti {
+
+/// @brief Exception: the checkpoint can't be read, or is from another run layout
+struct bad_checkpoint : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The checkpoint is missing, or was written with another process layout or tick length";
+    }
+};
+
+/// @brief A part of the simulation with state to keep in the checkpoints
+/// @details The state is written to a Boost.MPI packed archive, the format of
+/// the messages between the processes. The checkpoints are written between
+/// ticks, so the messages of the manager exchanges are never in flight. The
+/// methods not implemented do nothing, for the parts without state.
+class checkpoint_participant {
+
+public:
+    using iarchive = boost::mpi::packed_iarchive;
+    using oarchive = boost::mpi::packed_oarchive;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    checkpoint_participant() = default;
+
+    checkpoint_participant(const checkpoint_participant&) = default;
+    checkpoint_participant& operator=(const checkpoint_participant&) = default;
+
+    checkpoint_participant(checkpoint_participant&&) = default;
+    checkpoint_participant& operator=(checkpoint_participant&&) = default;
+
+    virtual ~checkpoint_participant() = default;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the state into a checkpoint
+    /// @param ar The archive of the checkpoint of this process
+    virtual void save_state(oarchive& /*unused*/) const { }
+
+    /// @brief Read the state written by save_state()
+    /// @details Called after the agents of the process are restored
+    /// @param ar The archive of the checkpoint of this process
+    virtual void load_state(iarchive& /*unused*/) { }
+
+}; // class checkpoint_participant
+
+/// @brief The checkpoint of a process being written
+class checkpoint_writer {
+
+public:
+    /// @brief Start an empty checkpoint
+    /// @param comm The MPI communicator
+    explicit checkpoint_writer(const boost::mpi::communicator& comm);
+
+    checkpoint_writer(const checkpoint_writer&) = delete;
+    checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+
+    checkpoint_writer(checkpoint_writer&&) = delete;
+    checkpoint_writer& operator=(checkpoint_writer&&) = delete;
+
+    ~checkpoint_writer() = default;
+
+    /// @brief Get the archive, to write the state into
+    checkpoint_participant::oarchive& archive();
+
+    /// @brief Write the checkpoint of this process to its file
+    /// @param folder The folder of the checkpoint, created if needed
+    /// @param rank The rank of the process
+    void write(const std::string& folder, int rank) const;
+
+private:
+    checkpoint_participant::oarchive::buffer_type _buffer;
+    checkpoint_participant::oarchive              _archive;
+}; // class checkpoint_writer
+
+/// @brief The checkpoint of a process being read
+class checkpoint_reader {
+
+public:
+    /// @brief Read the checkpoint file of this process
+    /// @throws bad_checkpoint If the file can't be read
+    /// @param folder The folder of the checkpoint
+    /// @param comm The MPI communicator
+    checkpoint_reader(const std::string& folder, const boost::mpi::communicator& comm);
+
+    checkpoint_reader(const checkpoint_reader&) = delete;
+    checkpoint_reader& operator=(const checkpoint_reader&) = delete;
+
+    checkpoint_reader(checkpoint_reader&&) = delete;
+    checkpoint_reader& operator=(checkpoint_reader&&) = delete;
+
+    ~checkpoint_reader() = default;
+
+    /// @brief Get the archive, to read the state from
+    checkpoint_participant::iarchive& archive();
+
+private:
+    checkpoint_participant::iarchive::buffer_type _buffer;
+    checkpoint_participant::iarchive              _archive;
+}; // class checkpoint_reader
+
+/// @brief Get the file of a process in a checkpoint
+/// @param folder The folder of the checkpoint
+/// @param rank The rank of the process
+std::string checkpoint_path(const std::string& folder, int rank);
+
+} // namespace sti
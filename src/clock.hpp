@@ -181,6 +181,12 @@ public:
         return datetime { static_cast<timedelta::resolution>(_tick) * _seconds_per_tick };
     }
 
+    /// @brief Get the current tick
+    double tick() const
+    {
+        return _tick;
+    }
+
     /// @brief Get the 'length' of a tick, in seconds
     /// @return The span of a tick, in seconds
     auto seconds_per_tick() const
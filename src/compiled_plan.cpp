@@ -0,0 +1,443 @@
+/// @file compiled_plan.cpp
+/// @brief Hospital compiled to a binary file, mapped at startup
+#include "compiled_plan.hpp"
+
+#include <boost/json.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "hospital_plan.hpp"
+
+namespace {
+
+/// @brief Offsets of the sections of a compiled plan, and the size of the file
+struct sections {
+    std::size_t walkable;
+    std::size_t tiles;
+    std::size_t walls;
+    std::size_t chairs;
+    std::size_t triages;
+    std::size_t receptionists;
+    std::size_t doctors;
+    std::size_t specialty_offsets;
+    std::size_t specialty_chars;
+    std::size_t influx_offsets;
+    std::size_t influx;
+    std::size_t infected_probability;
+    std::size_t parameters;
+    std::size_t end;
+};
+
+/// @brief Round an offset up to the next multiple of 8
+std::size_t align(std::size_t offset)
+{
+    return (offset + 7U) & ~std::size_t { 7U };
+}
+
+/// @brief Compute where each section starts, every one aligned to 8 bytes
+/// @param h The header of the file
+sections layout(const sti::compiled_plan::header& h)
+{
+    using plan = sti::compiled_plan;
+
+    const auto cells = std::size_t { h.width } * std::size_t { h.height };
+    const auto words = (cells + 63U) / 64U;
+
+    auto s   = sections {};
+    auto off = align(sizeof(sti::compiled_plan::header));
+
+    s.walkable = off;
+    off += words * sizeof(std::uint64_t);
+    s.tiles = off;
+    off     = align(off + cells);
+    s.walls = off;
+    off += h.walls * sizeof(plan::location_entry);
+    s.chairs = off;
+    off += h.chairs * sizeof(plan::location_entry);
+    s.triages = off;
+    off += h.triages * sizeof(plan::location_entry);
+    s.receptionists = off;
+    off += h.receptionists * sizeof(plan::receptionist_entry);
+    s.doctors = off;
+    off += h.doctors * sizeof(plan::doctor_entry);
+    s.specialty_offsets = off;
+    off                 = align(off + (h.specialties + std::size_t { 1 }) * sizeof(std::uint32_t));
+    s.specialty_chars   = off;
+    off                 = align(off + h.specialty_chars);
+    s.influx_offsets    = off;
+    off                 = align(off + (h.influx_days + std::size_t { 1 }) * sizeof(std::uint32_t));
+    s.influx            = off;
+    off                 = align(off + h.influx_intervals * sizeof(std::uint32_t));
+    s.infected_probability = off;
+    off += h.infected_days * sizeof(double);
+    s.parameters = off;
+    off += h.parameters_chars;
+    s.end = off;
+    return s;
+}
+
+/// @brief Append the bytes of an object to a buffer
+template <typename T>
+void put(std::vector<char>& buffer, const T* data, std::size_t count)
+{
+    const auto* bytes = reinterpret_cast<const char*>(data); // NOLINT
+    buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+}
+
+/// @brief Pad a buffer with zeros up to an offset
+void pad(std::vector<char>& buffer, std::size_t offset)
+{
+    buffer.resize(offset, '\0');
+}
+
+/// @brief Convert a location to its entry in the file
+sti::compiled_plan::location_entry to_entry(const sti::coordinates<int>& location)
+{
+    return { location.x, location.y };
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Map a compiled plan
+/// @throws invalid_compiled_plan If the file can't be mapped or is invalid
+/// @param filepath The path to the file
+sti::compiled_plan::compiled_plan(const std::string& filepath)
+    : _filepath { filepath }
+{
+    const auto fd = ::open(filepath.c_str(), O_RDONLY); // NOLINT
+    if (fd < 0) throw invalid_compiled_plan {};
+
+    struct stat st { };
+    if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(header)) {
+        _size = static_cast<std::size_t>(st.st_size);
+        _map  = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        if (_map == MAP_FAILED) { // NOLINT
+            _map  = nullptr;
+            _size = 0;
+        }
+    }
+    ::close(fd);
+    if (_map == nullptr) throw invalid_compiled_plan {};
+
+    // Validate the header and the sizes before giving access to any section
+    const auto& h     = head();
+    const auto  valid = [&]() {
+        if (h.magic != magic || h.version != version || h.byte_order != byte_order) return false;
+
+        const auto s = layout(h);
+        if (s.end > _size) return false;
+
+        _walkable             = s.walkable;
+        _tiles                = s.tiles;
+        _walls                = s.walls;
+        _chairs               = s.chairs;
+        _triages              = s.triages;
+        _receptionists        = s.receptionists;
+        _doctors              = s.doctors;
+        _specialty_offsets    = s.specialty_offsets;
+        _specialty_chars      = s.specialty_chars;
+        _influx_offsets       = s.influx_offsets;
+        _influx               = s.influx;
+        _infected_probability = s.infected_probability;
+        _parameters           = s.parameters;
+
+        // The offsets of the strings and the days must be sorted and in range
+        const auto names = at<std::uint32_t>(_specialty_offsets, h.specialties + std::size_t { 1 });
+        for (auto i = std::size_t { 0 }; i < h.specialties; ++i) {
+            if (names[i] > names[i + 1]) return false;
+        }
+        if (names[0] != 0 || names[h.specialties] != h.specialty_chars) return false;
+
+        const auto days = at<std::uint32_t>(_influx_offsets, h.influx_days + std::size_t { 1 });
+        for (auto i = std::size_t { 0 }; i < h.influx_days; ++i) {
+            if (days[i] > days[i + 1]) return false;
+        }
+        if (days[0] != 0 || days[h.influx_days] != h.influx_intervals) return false;
+
+        for (const auto& doctor : doctors()) {
+            if (doctor.specialty >= h.specialties) return false;
+        }
+        return true;
+    }();
+
+    if (!valid) {
+        ::munmap(const_cast<void*>(_map), _size); // NOLINT
+        throw invalid_compiled_plan {};
+    }
+}
+
+sti::compiled_plan::~compiled_plan()
+{
+    if (_map != nullptr) ::munmap(const_cast<void*>(_map), _size); // NOLINT
+}
+
+/// @brief Check if a file is a compiled plan, by its magic number
+/// @param filepath The path to the file
+bool sti::compiled_plan::is_compiled(const std::string& filepath)
+{
+    auto file  = std::ifstream { filepath, std::ios::binary };
+    auto bytes = std::array<char, 4> {};
+    file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return file && bytes == magic;
+}
+
+/// @brief Compile a hospital to a file
+/// @details The file is written to a temporary file and then renamed, so
+/// the processes mapping the previous one keep a valid copy
+/// @param filepath The path of the file
+/// @param plan The plan loaded from the JSON
+/// @param hospital The JSON with the parameters and the influx
+void sti::compiled_plan::write(const std::string& filepath, const hospital_plan& plan, const boost::json::object& hospital)
+{
+    // The influx is stored as arrays, the rest of the parameters stay as JSON
+    const auto& patient  = hospital.at("parameters").at("patient").as_object();
+    const auto  influx   = boost::json::value_to<std::vector<std::vector<std::uint32_t>>>(patient.at("influx"));
+    const auto  infected = boost::json::value_to<std::vector<double>>(patient.at("infected_probability"));
+
+    auto rest = hospital;
+    rest.erase("building");
+    auto& rest_patient = rest.at("parameters").as_object().at("patient").as_object();
+    rest_patient.erase("influx");
+    rest_patient.erase("infected_probability");
+    const auto parameters = boost::json::serialize(rest);
+
+    // Specialties as a table of offsets and the characters of all the names
+    auto name_offsets = std::vector<std::uint32_t> { 0 };
+    auto name_chars   = std::string {};
+    for (const auto& name : plan.specialties()) {
+        name_chars += name;
+        name_offsets.push_back(static_cast<std::uint32_t>(name_chars.size()));
+    }
+
+    auto day_offsets = std::vector<std::uint32_t> { 0 };
+    auto intervals   = std::vector<std::uint32_t> {};
+    for (const auto& day : influx) {
+        intervals.insert(intervals.end(), day.begin(), day.end());
+        day_offsets.push_back(static_cast<std::uint32_t>(intervals.size()));
+    }
+
+    const auto& grid = plan.obstacles();
+    const auto  hdr  = header {
+        magic,
+        version,
+        byte_order,
+        static_cast<std::uint32_t>(grid.width()),
+        static_cast<std::uint32_t>(grid.height()),
+        static_cast<std::uint32_t>(plan.walls().size()),
+        static_cast<std::uint32_t>(plan.chairs().size()),
+        static_cast<std::uint32_t>(plan.triages().size()),
+        static_cast<std::uint32_t>(plan.receptionists().size()),
+        static_cast<std::uint32_t>(plan.doctors().size()),
+        static_cast<std::uint32_t>(plan.specialties().size()),
+        static_cast<std::uint32_t>(name_chars.size()),
+        static_cast<std::uint32_t>(influx.size()),
+        static_cast<std::uint32_t>(intervals.size()),
+        static_cast<std::uint32_t>(infected.size()),
+        static_cast<std::uint32_t>(parameters.size()),
+        to_entry(plan.entry().location),
+        to_entry(plan.exit().location),
+        to_entry(plan.icu().location)
+    };
+    const auto s = layout(hdr);
+
+    auto buffer = std::vector<char> {};
+    buffer.reserve(s.end);
+    put(buffer, &hdr, 1);
+
+    pad(buffer, s.walkable);
+    put(buffer, grid.walkable_words().data(), grid.walkable_words().size());
+    put(buffer, grid.tiles().data(), grid.tiles().size());
+
+    pad(buffer, s.walls);
+    for (const auto& wall : plan.walls()) {
+        const auto e = to_entry(wall.location);
+        put(buffer, &e, 1);
+    }
+    for (const auto& chair : plan.chairs()) {
+        const auto e = to_entry(chair.location);
+        put(buffer, &e, 1);
+    }
+    for (const auto& triage : plan.triages()) {
+        const auto e = to_entry(triage.location);
+        put(buffer, &e, 1);
+    }
+    for (const auto& receptionist : plan.receptionists()) {
+        const auto e = receptionist_entry { to_entry(receptionist.location), to_entry(receptionist.patient_chair) };
+        put(buffer, &e, 1);
+    }
+    for (const auto& doctor : plan.doctors()) {
+        const auto e = doctor_entry { to_entry(doctor.location), to_entry(doctor.patient_chair), plan.find_specialty(doctor.type), 0 };
+        put(buffer, &e, 1);
+    }
+
+    pad(buffer, s.specialty_offsets);
+    put(buffer, name_offsets.data(), name_offsets.size());
+    pad(buffer, s.specialty_chars);
+    put(buffer, name_chars.data(), name_chars.size());
+
+    pad(buffer, s.influx_offsets);
+    put(buffer, day_offsets.data(), day_offsets.size());
+    pad(buffer, s.influx);
+    put(buffer, intervals.data(), intervals.size());
+    pad(buffer, s.infected_probability);
+    put(buffer, infected.data(), infected.size());
+
+    pad(buffer, s.parameters);
+    put(buffer, parameters.data(), parameters.size());
+
+    auto tmp_os = std::ostringstream {};
+    tmp_os << filepath << "." << getpid() << ".tmp";
+    const auto tmp_path = tmp_os.str();
+    {
+        auto file = std::ofstream { tmp_path, std::ios::binary };
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    }
+    std::rename(tmp_path.c_str(), filepath.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PLAN
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of columns
+std::uint32_t sti::compiled_plan::width() const
+{
+    return head().width;
+}
+
+/// @brief Get the number of rows
+std::uint32_t sti::compiled_plan::height() const
+{
+    return head().height;
+}
+
+/// @brief Get the walkability bits of the grid, as in plan_grid
+sti::compiled_plan::mapped_array<std::uint64_t> sti::compiled_plan::walkable() const
+{
+    const auto cells = std::size_t { width() } * std::size_t { height() };
+    return at<std::uint64_t>(_walkable, (cells + 63U) / 64U);
+}
+
+/// @brief Get the kind of each tile of the grid, as in plan_grid
+sti::compiled_plan::mapped_array<std::uint8_t> sti::compiled_plan::tiles() const
+{
+    return at<std::uint8_t>(_tiles, std::size_t { width() } * std::size_t { height() });
+}
+
+/// @brief Get the walls
+sti::compiled_plan::mapped_array<sti::compiled_plan::location_entry> sti::compiled_plan::walls() const
+{
+    return at<location_entry>(_walls, head().walls);
+}
+
+/// @brief Get the chairs
+sti::compiled_plan::mapped_array<sti::compiled_plan::location_entry> sti::compiled_plan::chairs() const
+{
+    return at<location_entry>(_chairs, head().chairs);
+}
+
+/// @brief Get the triages
+sti::compiled_plan::mapped_array<sti::compiled_plan::location_entry> sti::compiled_plan::triages() const
+{
+    return at<location_entry>(_triages, head().triages);
+}
+
+/// @brief Get the receptionists
+sti::compiled_plan::mapped_array<sti::compiled_plan::receptionist_entry> sti::compiled_plan::receptionists() const
+{
+    return at<receptionist_entry>(_receptionists, head().receptionists);
+}
+
+/// @brief Get the doctors
+sti::compiled_plan::mapped_array<sti::compiled_plan::doctor_entry> sti::compiled_plan::doctors() const
+{
+    return at<doctor_entry>(_doctors, head().doctors);
+}
+
+/// @brief Get the entry
+sti::compiled_plan::location_entry sti::compiled_plan::entry() const
+{
+    return head().entry;
+}
+
+/// @brief Get the exit
+sti::compiled_plan::location_entry sti::compiled_plan::exit() const
+{
+    return head().exit;
+}
+
+/// @brief Get the ICU
+sti::compiled_plan::location_entry sti::compiled_plan::icu() const
+{
+    return head().icu;
+}
+
+/// @brief Get the name of a specialty
+/// @param index The index of the specialty, as in doctor_entry
+std::string sti::compiled_plan::specialty(std::uint32_t index) const
+{
+    const auto offsets = at<std::uint32_t>(_specialty_offsets, head().specialties + std::size_t { 1 });
+    const auto chars   = at<char>(_specialty_chars, head().specialty_chars);
+    return { chars.data + offsets[index], chars.data + offsets[index + 1] };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PARAMETERS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of days of the patient influx
+std::uint32_t sti::compiled_plan::influx_days() const
+{
+    return head().influx_days;
+}
+
+/// @brief Get the patients entering in each interval of a day
+/// @param day The day
+sti::compiled_plan::mapped_array<std::uint32_t> sti::compiled_plan::influx(std::uint32_t day) const
+{
+    const auto offsets = at<std::uint32_t>(_influx_offsets, head().influx_days + std::size_t { 1 });
+    return at<std::uint32_t>(_influx + offsets[day] * sizeof(std::uint32_t), offsets[day + 1] - offsets[day]);
+}
+
+/// @brief Get the probability of an entering patient being infected, by day
+sti::compiled_plan::mapped_array<double> sti::compiled_plan::infected_probability() const
+{
+    return at<double>(_infected_probability, head().infected_days);
+}
+
+/// @brief Get the hospital JSON without the building and the influx
+boost::json::object sti::compiled_plan::parameters() const
+{
+    const auto chars = at<char>(_parameters, head().parameters_chars);
+    return boost::json::parse(std::string { chars.data, chars.size }).as_object();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// HELPERS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the header of the mapped file
+const sti::compiled_plan::header& sti::compiled_plan::head() const
+{
+    return *static_cast<const header*>(_map);
+}
+
+/// @brief Get an array of the mapped file
+/// @param offset The offset of the first element
+/// @param size The number of elements
+template <typename T>
+sti::compiled_plan::mapped_array<T> sti::compiled_plan::at(std::size_t offset, std::size_t size) const
+{
+    return { reinterpret_cast<const T*>(static_cast<const char*>(_map) + offset), size }; // NOLINT
+}
@@ -0,0 +1,224 @@
+/// @file compiled_plan.hpp
+/// @brief Hospital compiled to a binary file, mapped at startup
+#pragma once
+
+#include <array>
+#include <boost/json/object.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+
+namespace sti {
+class hospital_plan;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Exception: the compiled plan is missing, corrupted or of another version
+struct invalid_compiled_plan : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The compiled hospital plan is invalid or of another version";
+    }
+};
+
+/// @brief Hospital plan and parameters compiled from the JSON file
+/// @details The file has the grid of the plan as stored in memory, the lists
+/// of tiles, the patient influx and the rest of the parameters as JSON. The
+/// file is mapped read-only, so the processes of a node share the same pages
+/// and the plan is loaded without parsing or walking the tiles. The format is
+/// described in docs/file_formats/compiled_plan.md.
+class compiled_plan {
+
+public:
+    /// @brief A contiguous array in the mapped file
+    template <typename T>
+    struct mapped_array {
+        const T*    data;
+        std::size_t size;
+
+        const T* begin() const
+        {
+            return data;
+        }
+
+        const T* end() const
+        {
+            return data + size;
+        }
+
+        const T& operator[](std::size_t i) const
+        {
+            return data[i];
+        }
+    }; // struct mapped_array
+
+    /// @brief A tile with a single location
+    struct location_entry {
+        std::int32_t x;
+        std::int32_t y;
+    }; // struct location_entry
+
+    /// @brief A receptionist, the location and the patient chair
+    struct receptionist_entry {
+        location_entry location;
+        location_entry patient_chair;
+    }; // struct receptionist_entry
+
+    /// @brief A doctor, the location, the patient chair and the specialty
+    struct doctor_entry {
+        location_entry location;
+        location_entry patient_chair;
+        std::uint32_t  specialty; // Index in the names of the file
+        std::uint32_t  reserved;
+    }; // struct doctor_entry
+
+    /// @brief The start of the file, with the size of each section
+    struct header {
+        std::array<char, 4> magic;
+        std::uint32_t       version;
+        std::uint32_t       byte_order;
+        std::uint32_t       width;
+        std::uint32_t       height;
+        std::uint32_t       walls;
+        std::uint32_t       chairs;
+        std::uint32_t       triages;
+        std::uint32_t       receptionists;
+        std::uint32_t       doctors;
+        std::uint32_t       specialties;
+        std::uint32_t       specialty_chars;
+        std::uint32_t       influx_days;
+        std::uint32_t       influx_intervals;
+        std::uint32_t       infected_days;
+        std::uint32_t       parameters_chars;
+        location_entry      entry;
+        location_entry      exit;
+        location_entry      icu;
+    }; // struct header
+
+    static constexpr auto magic      = std::array { 'S', 'T', 'I', 'H' };
+    static constexpr auto version    = std::uint32_t { 1 };
+    static constexpr auto byte_order = std::uint32_t { 0x01020304 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Map a compiled plan
+    /// @throws invalid_compiled_plan If the file can't be mapped or is invalid
+    /// @param filepath The path to the file
+    explicit compiled_plan(const std::string& filepath);
+
+    compiled_plan(const compiled_plan&) = delete;
+    compiled_plan& operator=(const compiled_plan&) = delete;
+
+    compiled_plan(compiled_plan&&) = delete;
+    compiled_plan& operator=(compiled_plan&&) = delete;
+
+    ~compiled_plan();
+
+    /// @brief Check if a file is a compiled plan, by its magic number
+    /// @param filepath The path to the file
+    static bool is_compiled(const std::string& filepath);
+
+    /// @brief Compile a hospital to a file
+    /// @details The file is written to a temporary file and then renamed, so
+    /// the processes mapping the previous one keep a valid copy
+    /// @param filepath The path of the file
+    /// @param plan The plan loaded from the JSON
+    /// @param hospital The JSON with the parameters and the influx
+    static void write(const std::string& filepath, const hospital_plan& plan, const boost::json::object& hospital);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PLAN
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of columns
+    std::uint32_t width() const;
+
+    /// @brief Get the number of rows
+    std::uint32_t height() const;
+
+    /// @brief Get the walkability bits of the grid, as in plan_grid
+    mapped_array<std::uint64_t> walkable() const;
+
+    /// @brief Get the kind of each tile of the grid, as in plan_grid
+    mapped_array<std::uint8_t> tiles() const;
+
+    /// @brief Get the walls
+    mapped_array<location_entry> walls() const;
+
+    /// @brief Get the chairs
+    mapped_array<location_entry> chairs() const;
+
+    /// @brief Get the triages
+    mapped_array<location_entry> triages() const;
+
+    /// @brief Get the receptionists
+    mapped_array<receptionist_entry> receptionists() const;
+
+    /// @brief Get the doctors
+    mapped_array<doctor_entry> doctors() const;
+
+    /// @brief Get the entry
+    location_entry entry() const;
+
+    /// @brief Get the exit
+    location_entry exit() const;
+
+    /// @brief Get the ICU
+    location_entry icu() const;
+
+    /// @brief Get the name of a specialty
+    /// @param index The index of the specialty, as in doctor_entry
+    std::string specialty(std::uint32_t index) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PARAMETERS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of days of the patient influx
+    std::uint32_t influx_days() const;
+
+    /// @brief Get the patients entering in each interval of a day
+    /// @param day The day
+    mapped_array<std::uint32_t> influx(std::uint32_t day) const;
+
+    /// @brief Get the probability of an entering patient being infected, by day
+    mapped_array<double> infected_probability() const;
+
+    /// @brief Get the hospital JSON without the building and the influx
+    boost::json::object parameters() const;
+
+private:
+    std::string _filepath;
+    const void* _map {};
+    std::size_t _size {};
+
+    // Offsets of the sections in the file
+    std::size_t _walkable {};
+    std::size_t _tiles {};
+    std::size_t _walls {};
+    std::size_t _chairs {};
+    std::size_t _triages {};
+    std::size_t _receptionists {};
+    std::size_t _doctors {};
+    std::size_t _specialty_offsets {};
+    std::size_t _specialty_chars {};
+    std::size_t _influx_offsets {};
+    std::size_t _influx {};
+    std::size_t _infected_probability {};
+    std::size_t _parameters {};
+
+    /// @brief Get the header of the mapped file
+    const header& head() const;
+
+    /// @brief Get an array of the mapped file
+    /// @param offset The offset of the first element
+    /// @param size The number of elements
+    template <typename T>
+    mapped_array<T> at(std::size_t offset, std::size_t size) const;
+}; // class compiled_plan
+
+} // namespace sti
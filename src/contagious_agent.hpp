@@ -2,7 +2,6 @@
 #pragma once
 
 #include <boost/variant.hpp>
-#include <boost/mpi/detail/binary_buffer_oprimitive.hpp>
 #include <cstdint>
 #include <memory>
 #include <queue>
@@ -11,6 +10,7 @@
 #include <utility>
 #include <vector>
 
+#include "agent_wire.hpp"
 #include "clock.hpp"
 #include "infection_logic/infection_factory.hpp"
 
@@ -19,16 +19,10 @@ namespace boost {
 namespace json {
     class object;
 } // namespace json
-namespace mpi {
-    class communicator;
-} // namespace mpi
 } // namespace boost
 
 namespace sti {
 
-// The data is serialized into a buffer with Boost.MPI packed archives
-using serial_data = boost::mpi::binary_buffer_oprimitive::buffer_type;
-
 /// @brief An virtual class representing an agent capable of infecting others
 class contagious_agent {
 
@@ -42,6 +36,12 @@ public:
 
     using id_t = repast::AgentId;
 
+    /// @brief Counters incremented on every change of each part of the state
+    struct state_versions {
+        std::uint32_t infection;
+        std::uint32_t behaviour;
+    };
+
     ////////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////////
@@ -61,18 +61,35 @@ public:
     // SERIALIZATION
     ////////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Serialize the agent state into a string using Boost.Serialization
-    /// @param communicator The MPI communicator over which this archive will be sent
-    /// @return A string with the serialized data
-    virtual void serialize(serial_data& data, boost::mpi::communicator* communicator) = 0;
+    /// @brief Store the agent state in the fixed layout format
+    /// @param wire The destination, sent as is to other processes
+    virtual void pack(agent_wire& wire) const = 0;
 
-    /// @brief Reconstruct the agent state from a string using Boost.Serialization
+    /// @brief Restore the agent state from the fixed layout format
     /// @param id The new AgentId
-    /// @param data The serialized data
-    /// @param communicator The MPI communicator over which the archive was sent
-    virtual void serialize(const id_t& id,
-                           serial_data& data,
-                           boost::mpi::communicator* communicator) = 0;
+    /// @param wire The source
+    /// @param sections The sections of the wire to restore, see wire_section
+    virtual void unpack(const id_t& id, const agent_wire& wire, std::uint8_t sections) = 0;
+
+    /// @brief Get the version of each part of the agent state
+    virtual state_versions versions() const = 0;
+
+    /// @brief Get the sections changed since the last call, and mark them as synchronized
+    /// @details The first call after the creation returns all the sections
+    /// @return A mask of wire_section values
+    std::uint8_t take_changes()
+    {
+        const auto current = versions();
+        auto       changes = wire_section::ALL;
+        if (_synced_valid) {
+            changes = 0;
+            if (current.infection != _synced.infection) changes = static_cast<std::uint8_t>(changes | wire_section::INFECTION);
+            if (current.behaviour != _synced.behaviour) changes = static_cast<std::uint8_t>(changes | wire_section::BEHAVIOUR);
+        }
+        _synced       = current;
+        _synced_valid = true;
+        return changes;
+    }
 
     ////////////////////////////////////////////////////////////////////////////////
     // REPAST REQUIRED METHODS
@@ -117,20 +134,38 @@ public:
     /// @brief Perform the actions this agent is supposed to
     virtual void act() = 0;
 
+    /// @brief Check if the agent is parked, waiting for a known instant
+    /// @details While parked only the infection logic is ticked, act() is not
+    /// executed
+    bool parked() const
+    {
+        return _parked;
+    }
+
+    /// @brief Park or wake up the agent
+    /// @param parked True to park the agent
+    void parked(bool parked)
+    {
+        _parked = parked;
+    }
+
     /// @brief Get the infection logic
     /// @return A pointer to the infection logic
-    virtual infection_cycle* get_infection_logic() = 0;
+    virtual human_infection_cycle* get_infection_logic() = 0;
 
     /// @brief Get the infection logic
     /// @return A const pointer to the infection logic
-    virtual const infection_cycle* get_infection_logic() const = 0;
+    virtual const human_infection_cycle* get_infection_logic() const = 0;
 
     /// @brief Return the agent statistics as a json object
     /// @return A Boost.JSON object containing relevant statistics
     virtual boost::json::object stats() const = 0;
 
 private:
-    id_t _id;
+    id_t           _id;
+    bool           _parked {};
+    state_versions _synced {};
+    bool           _synced_valid {};
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <boost/json.hpp>
+#include <cmath>
 #include <boost/container_hash/hash_fwd.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/level.hpp>
@@ -109,6 +110,14 @@ std::ostream& operator<<(std::ostream& os, const coordinates<T>& c)
     return os;
 }
 
+/// @brief Calculate the distance between two continuous points
+/// @return The distance between the points
+inline double sq_distance(const coordinates<double>& lho, const coordinates<double>& rho)
+{
+    const auto diff = lho - rho;
+    return std::sqrt(diff.x * diff.x + diff.y * diff.y);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // JSON DE/SERIALIZATION
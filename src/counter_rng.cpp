@@ -0,0 +1,147 @@
+/// @file counter_rng.cpp
+/// @brief Counter-based random numbers, independent of the iteration order
+#include "counter_rng.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// INSTANCE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the process-wide generator
+sti::counter_rng& sti::counter_rng::instance()
+{
+    static auto rng = counter_rng {};
+    return rng;
+}
+
+/// @brief Set the seed, must be the same in all the processes
+/// @param seed The simulation seed
+void sti::counter_rng::seed(std::uint64_t seed)
+{
+    _key = { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32U) };
+}
+
+/// @brief Get the seed, to restart the simulation with the same draws
+std::uint64_t sti::counter_rng::seed() const
+{
+    return static_cast<std::uint64_t>(_key[0]) | (static_cast<std::uint64_t>(_key[1]) << 32U);
+}
+
+/// @brief Set the current tick, must be executed every tick
+/// @param tick The current tick
+void sti::counter_rng::tick(std::uint32_t tick)
+{
+    _tick = tick;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DRAWS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get a uniform number in the range [0, 1)
+/// @param e The kind of decision
+/// @param subject The entity making the decision
+/// @param draw The number of draw inside the decision, only the lower 23 bits are used
+/// @return A double in the range [0, 1)
+double sti::counter_rng::uniform(event e, std::uint64_t subject, std::uint32_t draw) const
+{
+    const auto counter = counter_type {
+        static_cast<std::uint32_t>(subject),
+        static_cast<std::uint32_t>(subject >> 32U),
+        _tick,
+        (static_cast<std::uint32_t>(e) << 24U) | (draw & 0x7FFFFFU)
+    };
+    return to_double(philox(counter, _key));
+}
+
+/// @brief Get a uniform number in the range [0, 1) for a pair of subjects
+/// @param e The kind of decision
+/// @param subject The entity making the decision
+/// @param other The entity it interacts with
+/// @return A double in the range [0, 1)
+double sti::counter_rng::uniform_pair(event e, std::uint64_t subject, std::uint64_t other) const
+{
+    // The draw field has the bit 23, never set in the single draws, and the
+    // other subject changes the key, a different Philox permutation
+    const auto counter = counter_type {
+        static_cast<std::uint32_t>(subject),
+        static_cast<std::uint32_t>(subject >> 32U),
+        _tick,
+        (static_cast<std::uint32_t>(e) << 24U) | pair_draw
+    };
+    const auto key = key_type { _key[0] ^ static_cast<std::uint32_t>(other), _key[1] ^ static_cast<std::uint32_t>(other >> 32U) };
+    return to_double(philox(counter, key));
+}
+
+/// @brief Convert a block into a uniform number in the range [0, 1)
+/// @param block The output of philox()
+double sti::counter_rng::to_double(const counter_type& block)
+{
+    // Use the upper 53 bits of the first two words as mantissa
+    const auto bits = (static_cast<std::uint64_t>(block[0]) << 32U) | block[1];
+    return static_cast<double>(bits >> 11U) * 0x1.0p-53;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SUBJECTS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the subject identifying a numbered entity
+/// @param kind The kind of entity
+/// @param serial The number of the entity, only the lower 56 bits are used
+std::uint64_t sti::counter_rng::subject(entity kind, std::uint64_t serial)
+{
+    return (static_cast<std::uint64_t>(kind) << 56U) | (serial & 0x00FFFFFFFFFFFFFFULL);
+}
+
+/// @brief Get the subject identifying an entity placed in a cell of the plan
+/// @details The cell uses 20 bits per axis, the generation the lower 16,
+/// so the subject of the next generation is the subject plus one
+/// @param kind The kind of entity
+/// @param x The x coordinate of the cell
+/// @param y The y coordinate of the cell
+/// @param generation The number of entities that held the cell before
+std::uint64_t sti::counter_rng::subject(entity kind, std::int32_t x, std::int32_t y, std::uint32_t generation)
+{
+    const auto cell = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x) & 0xFFFFFU) << 36U)
+        | (static_cast<std::uint64_t>(static_cast<std::uint32_t>(y) & 0xFFFFFU) << 16U)
+        | (generation & 0xFFFFU);
+    return subject(kind, cell);
+}
+
+/// @brief Get the subject identifying a string, with FNV-1a
+std::uint64_t sti::counter_rng::subject(const std::string& name)
+{
+    auto h = std::uint64_t { 14695981039346656037ULL };
+    for (const auto c : name) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/// @brief The Philox 4x32 block function, 10 rounds
+/// @param counter The counter to encrypt
+/// @param key The key
+/// @return Four random 32 bits words
+sti::counter_rng::counter_type sti::counter_rng::philox(counter_type counter, key_type key)
+{
+    constexpr auto multiplier_0 = std::uint64_t { 0xD2511F53U };
+    constexpr auto multiplier_1 = std::uint64_t { 0xCD9E8D57U };
+    constexpr auto weyl_0       = std::uint32_t { 0x9E3779B9U };
+    constexpr auto weyl_1       = std::uint32_t { 0xBB67AE85U };
+
+    for (auto round = 0; round < 10; ++round) {
+        const auto product_0 = multiplier_0 * counter[0];
+        const auto product_1 = multiplier_1 * counter[2];
+
+        counter = {
+            static_cast<std::uint32_t>(product_1 >> 32U) ^ counter[1] ^ key[0],
+            static_cast<std::uint32_t>(product_1),
+            static_cast<std::uint32_t>(product_0 >> 32U) ^ counter[3] ^ key[1],
+            static_cast<std::uint32_t>(product_0)
+        };
+        key[0] += weyl_0;
+        key[1] += weyl_1;
+    }
+    return counter;
+}
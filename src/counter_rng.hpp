@@ -0,0 +1,132 @@
+/// @file counter_rng.hpp
+/// @brief Counter-based random numbers, independent of the iteration order
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace sti {
+
+/// @brief Counter-based random number generator, Philox 4x32-10
+/// @details Instead of a sequential stream, each draw is a pure function of
+/// (seed, subject, tick, event, draw). The subject is usually an agent, the
+/// event identifies the decision being made, and the draw distinguishes
+/// several numbers inside the same decision. Given the same seed, the same
+/// decision gets the same number regardless of the order in which the agents
+/// are processed or which thread evaluates it.
+///
+/// The subjects don't use the Repast ids, which are numbered per starting
+/// process, but a stable identity of each entity, see entity: the entry
+/// sequence of the patients, the plan cell of the staff and the chairs, the
+/// pool index of the beds. The same entity makes the same draws with any
+/// split of the plan, so a decision evaluated in the same state gets the
+/// same number in a 1x1 and a 2x2 layout.
+class counter_rng {
+
+public:
+    /// @brief The kind of entity identified by a subject, its upper 8 bits
+    enum class entity : std::uint8_t {
+        NONE,
+        PATIENT, // Numbered by the order of entry in the hospital
+        STAFF, // Keyed by the cell of the plan, and the replacements of the post
+        CHAIR, // Keyed by the cell of the plan
+        BED, // Numbered by the index in the pool of the ICU
+    };
+
+    /// @brief The kind of random decision
+    enum class event : std::uint32_t {
+        CONTACT, // A human interacting with an infectious cycle
+        CONTAMINATION, // An object interacting with an infectious cycle
+        ENVIRONMENT, // A human inside an infectious environment
+        INCUBATION, // The incubation time of a new infection
+        PATIENT_ENTRY, // The initial stage of a new patient
+        TRIAGE, // The diagnosis of a patient
+        STAFF_IMMUNITY, // The immunity of a new staff member
+        CHAIR, // The first chair checked when searching for a free one
+        ICU_BED, // The first bed checked when searching for a free one
+    };
+
+    using counter_type = std::array<std::uint32_t, 4>;
+    using key_type     = std::array<std::uint32_t, 2>;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // INSTANCE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the process-wide generator
+    static counter_rng& instance();
+
+    /// @brief Set the seed, must be the same in all the processes
+    /// @param seed The simulation seed
+    void seed(std::uint64_t seed);
+
+    /// @brief Get the seed, to restart the simulation with the same draws
+    std::uint64_t seed() const;
+
+    /// @brief Set the current tick, must be executed every tick
+    /// @param tick The current tick
+    void tick(std::uint32_t tick);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // DRAWS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get a uniform number in the range [0, 1)
+    /// @param e The kind of decision
+    /// @param subject The entity making the decision
+    /// @param draw The number of draw inside the decision, only the lower 23 bits are used
+    /// @return A double in the range [0, 1)
+    double uniform(event e, std::uint64_t subject, std::uint32_t draw = 0) const;
+
+    /// @brief Get a uniform number in the range [0, 1) for a pair of subjects
+    /// @details The other subject is used whole, mixed into the key, so two
+    /// sources differing only in their upper bits (the entities of the same
+    /// kind) get different numbers. Never the same number as a draw of a
+    /// single subject
+    /// @param e The kind of decision
+    /// @param subject The entity making the decision
+    /// @param other The entity it interacts with
+    /// @return A double in the range [0, 1)
+    double uniform_pair(event e, std::uint64_t subject, std::uint64_t other) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SUBJECTS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the subject identifying a numbered entity
+    /// @param kind The kind of entity
+    /// @param serial The number of the entity, only the lower 56 bits are used
+    static std::uint64_t subject(entity kind, std::uint64_t serial);
+
+    /// @brief Get the subject identifying an entity placed in a cell of the plan
+    /// @details The cell uses 20 bits per axis, the generation the lower 16,
+    /// so the subject of the next generation is the subject plus one
+    /// @param kind The kind of entity
+    /// @param x The x coordinate of the cell
+    /// @param y The y coordinate of the cell
+    /// @param generation The number of entities that held the cell before
+    static std::uint64_t subject(entity kind, std::int32_t x, std::int32_t y, std::uint32_t generation = 0);
+
+    /// @brief Get the subject identifying a string, with FNV-1a
+    static std::uint64_t subject(const std::string& name);
+
+    /// @brief The Philox 4x32 block function, 10 rounds
+    /// @param counter The counter to encrypt
+    /// @param key The key
+    /// @return Four random 32 bits words
+    static counter_type philox(counter_type counter, key_type key);
+
+private:
+    /// @brief The draw field of the pair draws, out of the single ones
+    static constexpr auto pair_draw = std::uint32_t { 0x800000U };
+
+    /// @brief Convert a block into a uniform number in the range [0, 1)
+    /// @param block The output of philox()
+    static double to_double(const counter_type& block);
+
+    key_type      _key {};
+    std::uint32_t _tick {};
+}; // class counter_rng
+
+} // namespace sti
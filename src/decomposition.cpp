@@ -0,0 +1,234 @@
+#include "decomposition.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <repast_hpc/Properties.h>
+#include <repast_hpc/Utilities.h>
+
+#include "hospital_plan.hpp"
+
+namespace {
+
+/// @brief Cost of the floor cells, relative to the cells where agents stay
+constexpr auto floor_cost = 1.0 / 32.0;
+
+/// @brief Summed area table of the cell costs, to get the cost of any
+/// rectangle of the building in constant time
+class cost_table {
+public:
+    cost_table(const sti::hospital_plan& plan)
+        : _width { static_cast<int>(plan.width()) }
+        , _height { static_cast<int>(plan.height()) }
+        , _sums(static_cast<std::size_t>((_width + 1) * (_height + 1)), 0.0)
+    {
+        const auto costs = sti::cell_costs(plan);
+        for (auto y = 0; y < _height; ++y) {
+            for (auto x = 0; x < _width; ++x) {
+                at(x + 1, y + 1) = costs[static_cast<std::size_t>(y * _width + x)]
+                    + at(x, y + 1) + at(x + 1, y) - at(x, y);
+            }
+        }
+    }
+
+    /// @brief Get the cost of the cells in [x0, x1) x [y0, y1), clamped to the building
+    double cost(int x0, int y0, int x1, int y1) const
+    {
+        x0 = std::clamp(x0, 0, _width);
+        x1 = std::clamp(x1, 0, _width);
+        y0 = std::clamp(y0, 0, _height);
+        y1 = std::clamp(y1, 0, _height);
+        return at(x1, y1) - at(x0, y1) - at(x1, y0) + at(x0, y0);
+    }
+
+    int width() const
+    {
+        return _width;
+    }
+
+    int height() const
+    {
+        return _height;
+    }
+
+private:
+    int                 _width;
+    int                 _height;
+    std::vector<double> _sums;
+
+    double& at(int x, int y)
+    {
+        return _sums[static_cast<std::size_t>(y * (_width + 1) + x)];
+    }
+
+    double at(int x, int y) const
+    {
+        return _sums[static_cast<std::size_t>(y * (_width + 1) + x)];
+    }
+};
+
+/// @brief The split of an axis: the size of the tiles, and the cells of the
+/// grid before the building
+struct axis_split {
+    int tile;
+    int padding;
+};
+
+/// @brief Check if every process of the axis has cells of the building
+bool covers(axis_split split, int length, int count)
+{
+    const auto slack = count * split.tile - length;
+    return split.padding >= 0 && split.padding < split.tile && slack - split.padding < split.tile;
+}
+
+/// @brief Get the cost of the busiest tile
+double busiest(const cost_table& table, int px, int py, axis_split x, axis_split y)
+{
+    auto max = 0.0;
+    for (auto i = 0; i < px; ++i) {
+        for (auto j = 0; j < py; ++j) {
+            const auto x0 = i * x.tile - x.padding;
+            const auto y0 = j * y.tile - y.padding;
+            max           = std::max(max, table.cost(x0, y0, x0 + x.tile, y0 + y.tile));
+        }
+    }
+    return max;
+}
+
+/// @brief Optimize the split of an axis, with the other one fixed
+/// @details The tiles are at most half larger than the uniform ones, and the
+/// padding is smaller than a tile at both ends, so every process has cells
+/// of the building
+/// @param length The size of the building along the axis
+/// @param count The number of processes along the axis
+/// @param current The current split, kept if nothing is better
+/// @param evaluate Get the cost of the busiest tile with a split of the axis
+template <typename F>
+std::pair<axis_split, double> optimize_axis(int length, int count, std::pair<axis_split, double> current, F&& evaluate)
+{
+    if (!covers(current.first, length, count)) current.second = std::numeric_limits<double>::infinity();
+
+    const auto uniform = (length + count - 1) / count;
+    const auto largest = count == 1 ? uniform : uniform + uniform / 2;
+    for (auto tile = uniform; tile <= largest; ++tile) {
+        const auto slack = count * tile - length;
+        for (auto padding = std::max(0, slack - tile + 1); padding <= std::min(slack, tile - 1); ++padding) {
+            const auto split = axis_split { tile, padding };
+            const auto cost  = evaluate(split);
+            if (cost < current.second * (1 - 1e-9)) current = { split, cost };
+        }
+    }
+    return current;
+}
+
+} // namespace
+
+/// @brief Estimate the cost of simulating each cell of the building
+/// @details The patients wait in the chairs and in the boxes of the queues,
+/// and the staff stands still in their offices, so those cells hold most of
+/// the agents of a tick. The rest of the walkable cells are only crossed
+/// @param plan The hospital plan
+/// @return The cost of each cell, indexed as y * width + x
+std::vector<double> sti::cell_costs(const hospital_plan& plan)
+{
+    const auto width  = static_cast<int>(plan.width());
+    const auto height = static_cast<int>(plan.height());
+    auto       costs  = std::vector<double>(static_cast<std::size_t>(width * height), 0.0);
+
+    for (auto y = 0; y < height; ++y) {
+        for (auto x = 0; x < width; ++x) {
+            auto& cost = costs[static_cast<std::size_t>(y * width + x)];
+            switch (plan.tile({ x, y })) {
+            case tiles::ENUMS::WALL:
+                break;
+            case tiles::ENUMS::CHAIR:
+            case tiles::ENUMS::ENTRY:
+            case tiles::ENUMS::EXIT:
+            case tiles::ENUMS::TRIAGE:
+            case tiles::ENUMS::ICU:
+            case tiles::ENUMS::RECEPTIONIST:
+            case tiles::ENUMS::RECEPTION_PATIENT_CHAIR:
+            case tiles::ENUMS::DOCTOR:
+            case tiles::ENUMS::DOCTOR_PATIENT_CHAIR:
+                cost = 1.0;
+                break;
+            default:
+                cost = plan.obstacles().walkable({ x, y }) ? floor_cost : 0.0;
+            }
+        }
+    }
+    return costs;
+}
+
+/// @brief Split the building in equal tiles, with the given process layout
+/// @param plan The hospital plan
+/// @param processes The number of processes along each axis
+sti::decomposition sti::uniform_decomposition(const hospital_plan& plan, coordinates<int> processes)
+{
+    return { { 0, 0 }, { static_cast<int>(plan.width()), static_cast<int>(plan.height()) }, processes };
+}
+
+/// @brief Find the process layout and the grid that minimize the cost of the
+/// busiest process
+/// @details Every layout of the processes is tried. For each one the size of
+/// the tiles and the padding of the grid are optimized one axis at a time,
+/// every process keeping part of the building
+/// @param plan The hospital plan
+/// @param processes The number of processes
+sti::decomposition sti::balanced_decomposition(const hospital_plan& plan, int processes)
+{
+    constexpr auto rounds = 4;
+
+    const auto table     = cost_table { plan };
+    auto       best      = uniform_decomposition(plan, { processes, 1 });
+    auto       best_cost = std::numeric_limits<double>::infinity();
+
+    for (auto px = 1; px <= processes; ++px) {
+        if (processes % px != 0) continue;
+        const auto py = processes / px;
+        if (px > table.width() || py > table.height()) continue;
+
+        // Start from the uniform split, the optimization replaces it if it
+        // leaves a process without building
+        auto x = std::pair { axis_split { (table.width() + px - 1) / px, 0 }, 0.0 };
+        auto y = std::pair { axis_split { (table.height() + py - 1) / py, 0 }, 0.0 };
+        x.second = y.second = busiest(table, px, py, x.first, y.first);
+
+        for (auto round = 0; round < rounds; ++round) {
+            const auto before = x.second;
+            x                 = optimize_axis(table.width(), px, x, [&](axis_split s) { return busiest(table, px, py, s, y.first); });
+            y.second          = x.second;
+            y                 = optimize_axis(table.height(), py, y, [&](axis_split s) { return busiest(table, px, py, x.first, s); });
+            x.second          = y.second;
+            if (!(y.second < before)) break;
+        }
+
+        if (y.second < best_cost) {
+            best_cost = y.second;
+            best      = { { -x.first.padding, -y.first.padding },
+                          { px * x.first.tile, py * y.first.tile },
+                          { px, py } };
+        }
+    }
+    return best;
+}
+
+/// @brief Get the decomposition selected in the properties
+/// @details With space.decomposition = balanced the layout of the processes is
+/// computed from the plan, otherwise (uniform, the default) it is given by
+/// x.process and y.process
+/// @throws bad_decomposition If the decomposition is not known
+/// @param plan The hospital plan
+/// @param props The simulation properties
+/// @param processes The number of processes
+sti::decomposition sti::make_decomposition(const hospital_plan& plan, repast::Properties& props, int processes)
+{
+    const auto mode = props.getProperty("space.decomposition");
+    if (mode.empty() || mode == "uniform") {
+        return uniform_decomposition(plan, { repast::strToInt(props.getProperty("x.process")),
+                                             repast::strToInt(props.getProperty("y.process")) });
+    }
+    if (mode == "balanced") return balanced_decomposition(plan, processes);
+    throw bad_decomposition {};
+}
@@ -0,0 +1,72 @@
+/// @file decomposition.hpp
+/// @brief Division of the building between the processes
+#pragma once
+
+#include <exception>
+#include <vector>
+
+#include "coordinates.hpp"
+
+// Fw. declarations
+namespace repast {
+class Properties;
+} // namespace repast
+
+namespace sti {
+class hospital_plan;
+} // namespace sti
+
+namespace sti {
+
+/// @brief The grid of the Repast spaces and its split between the processes
+/// @details Repast splits the grid in equally sized tiles, one per process.
+/// The grid can be larger than the building and start before it, so the
+/// borders of the tiles can be moved out of the crowded areas while the tiles
+/// stay equal. The building is always at [0, width) x [0, height)
+struct decomposition {
+    coordinates<int> origin;    // The first cell of the grid, <= 0
+    coordinates<int> extent;    // The size of the grid, covering the building
+    coordinates<int> processes; // The number of processes along each axis
+};
+
+/// @brief Exception: the decomposition in the properties is invalid
+struct bad_decomposition : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: space.decomposition must be uniform or balanced";
+    }
+};
+
+/// @brief Estimate the cost of simulating each cell of the building
+/// @details The patients wait in the chairs and in the boxes of the queues,
+/// and the staff stands still in their offices, so those cells hold most of
+/// the agents of a tick. The rest of the walkable cells are only crossed
+/// @param plan The hospital plan
+/// @return The cost of each cell, indexed as y * width + x
+std::vector<double> cell_costs(const hospital_plan& plan);
+
+/// @brief Split the building in equal tiles, with the given process layout
+/// @param plan The hospital plan
+/// @param processes The number of processes along each axis
+decomposition uniform_decomposition(const hospital_plan& plan, coordinates<int> processes);
+
+/// @brief Find the process layout and the grid that minimize the cost of the
+/// busiest process
+/// @details Every layout of the processes is tried. For each one the size of
+/// the tiles and the padding of the grid are optimized one axis at a time,
+/// every process keeping part of the building
+/// @param plan The hospital plan
+/// @param processes The number of processes
+decomposition balanced_decomposition(const hospital_plan& plan, int processes);
+
+/// @brief Get the decomposition selected in the properties
+/// @details With space.decomposition = balanced the layout of the processes is
+/// computed from the plan, otherwise (uniform, the default) it is given by
+/// x.process and y.process
+/// @throws bad_decomposition If the decomposition is not known
+/// @param plan The hospital plan
+/// @param props The simulation properties
+/// @param processes The number of processes
+decomposition make_decomposition(const hospital_plan& plan, repast::Properties& props, int processes);
+
+} // namespace sti
@@ -2,8 +2,12 @@
 /// @brief Doctor dispatcher and queues
 #pragma once
 
+#include <cstdint>
 #include <memory>
-#include <map>
+#include <string>
+#include <vector>
+
+#include "clock.hpp"
 
 namespace repast {
 class Properties;
@@ -19,7 +23,6 @@ namespace mpi {
 } // namespace boost
 
 namespace sti {
-class timedelta;
 class doctors_queue;
 class hospital_plan;
 } // namespace sti
@@ -29,6 +32,7 @@ namespace sti {
 class doctors {
 public:
     using doctor_type      = std::string;
+    using specialty_id     = std::uint16_t; // As hospital_plan::specialty_id
     using communicator_ptr = boost::mpi::communicator*;
     using prob_precission  = double;
 
@@ -59,9 +63,9 @@ public:
     ////////////////////////////////////////////////////////////////////////////
     
     /// @brief Get the time period a takes a certain doctor appointment/attention
-    /// @param type The doctor type to get the attention time
+    /// @param type The doctor specialty to get the attention time
     /// @return The time period
-    timedelta get_attention_duration(const doctor_type& type) const;
+    timedelta get_attention_duration(specialty_id type) const;
 
     /// @brief Get the doctors queue
     /// @return A pointer to the doctor queues
@@ -69,7 +73,7 @@ public:
 
 private:
     int                                    _this_rank;
-    std::map<doctor_type, timedelta>       _attention_time;
+    std::vector<timedelta>                 _attention_time; // By specialty
     std::unique_ptr<doctors_queue>         _doctors;
 }; // class doctors
 
@@ -28,12 +28,18 @@ sti::doctors::doctors(repast::Properties&        execution_props,
                       const hospital_plan&       hospital_plan)
     : _this_rank { communicator->rank() }
     , _attention_time { [&]() {
-        auto       attention = decltype(_attention_time) {};
-        const auto data      = hospital_props.at("parameters").at("doctors").as_array();
+        auto       by_name = std::map<std::string, timedelta> {};
+        const auto data    = hospital_props.at("parameters").at("doctors").as_array();
         for (const auto& doctor : data) {
             const auto specialty = boost::json::value_to<std::string>(doctor.at("specialty"));
             const auto attention_duration = boost::json::value_to<timedelta>(doctor.at("attention_duration"));
-            attention[specialty] = attention_duration;
+            by_name[specialty] = attention_duration;
+        }
+
+        // Indexed by the specialty ids of the plan
+        auto attention = decltype(_attention_time) {};
+        for (const auto& specialty : hospital_plan.specialties()) {
+            attention.push_back(by_name.at(specialty));
         }
         return attention;
     }() }
@@ -43,7 +49,7 @@ sti::doctors::doctors(repast::Properties&        execution_props,
         if (communicator->rank() == real_rank) {
             return std::make_unique<real_doctors>(communicator, 4322, hospital_plan);
         }
-        return std::make_unique<proxy_doctors>(communicator, real_rank, 4322);
+        return std::make_unique<proxy_doctors>(communicator, real_rank, 4322, hospital_plan);
     }() }
 {
 }
@@ -51,9 +57,9 @@ sti::doctors::doctors(repast::Properties&        execution_props,
 sti::doctors::~doctors() = default;
 
 /// @brief Get the time period a takes a certain doctor appointment/attention
-/// @param type The doctor type to get the attention time
+/// @param type The doctor specialty to get the attention time
 /// @return The time period
-sti::timedelta sti::doctors::get_attention_duration(const doctor_type& type) const
+sti::timedelta sti::doctors::get_attention_duration(specialty_id type) const
 {
     return _attention_time.at(type);
 }
@@ -1,22 +1,34 @@
 #include "proxy_doctors.hpp"
 
-#include <algorithm>
 #include <boost/mpi/communicator.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/optional.hpp>
+#include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/utility.hpp>
 #include <repast_hpc/AgentId.h>
 
+#include "../hospital_plan.hpp"
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
+
 /// @brief Construct proxy queue, specifing the rank of the real queue
 /// @param communicator The MPI Communicator
 /// @param real_rank The rank of the process containing the real queue
 /// @param mpi_tag The MPI tag used for comunication
-sti::proxy_doctors::proxy_doctors(communicator_ptr communicator, int real_rank, int mpi_tag)
+/// @param hospital The hospital plan, to locate the doctor boxes
+sti::proxy_doctors::proxy_doctors(communicator_ptr communicator, int real_rank, int mpi_tag, const hospital_plan& hospital)
     : _communicator { communicator }
     , _real_rank(real_rank)
     , _base_tag { mpi_tag }
+    , _box_location { [&]() {
+        auto locations = decltype(_box_location) {};
+        for (const auto& doctor : hospital.doctors()) {
+            locations.push_back(doctor.patient_chair.continuous());
+        }
+        return locations;
+    }() }
 {
 }
 
@@ -24,7 +36,7 @@ sti::proxy_doctors::proxy_doctors(communicator_ptr communicator, int real_rank,
 /// @param type The doctor specialization to enqueue in
 /// @param id The agent id
 /// @param timeout Instant of time that the patient will leave if doesn't receive attention
-void sti::proxy_doctors::enqueue(const specialty_type& type, const repast::AgentId& id, const datetime& timeout)
+void sti::proxy_doctors::enqueue(const specialty_type& type, const agent_id& id, const datetime& timeout)
 {
     _enqueue_buffer.push_back({ type, { id, timeout } });
 }
@@ -35,6 +47,9 @@ void sti::proxy_doctors::enqueue(const specialty_type& type, const repast::Agent
 void sti::proxy_doctors::dequeue(const specialty_type& type, const agent_id& id)
 {
     _dequeue_buffer.push_back({ type, id });
+
+    const auto it = _turns.find(id);
+    if (it != _turns.end() && it->second.first == type) _turns.erase(it);
 }
 
 /// @brief Check if the agent has a turn assigned. Returns the location of the doctor to go
@@ -43,32 +58,76 @@ void sti::proxy_doctors::dequeue(const specialty_type& type, const agent_id& id)
 /// @return If the agent has a doctor assigned, the destination
 boost::optional<sti::doctors_queue::position> sti::proxy_doctors::is_my_turn(const specialty_type& type, const agent_id& id)
 {
-    const auto& queue = _front[type];
-    const auto  it    = std::find_if(queue.begin(), queue.end(),
-                                 [&](const auto& turn) {
-                                     return turn.second == id;
-                                 });
-
-    if (it != queue.end()) {
-        return it->first;
+    // Only lookups, the patients query the turns from several threads during
+    // the act phase
+    const auto it = _turns.find(id);
+    if (it != _turns.end() && it->second.first == type) {
+        return _box_location[it->second.second];
     }
 
     return {};
 }
 
-/// @brief Sync the queues between the processes
-void sti::proxy_doctors::sync()
+////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Check if there are enqueues or dequeues since the last exchange
+/// @param destination The rank of the process
+bool sti::proxy_doctors::pending_requests(int destination) const
+{
+    return destination == _real_rank && (!_enqueue_buffer.empty() || !_dequeue_buffer.empty());
+}
+
+/// @brief Write the enqueues and dequeues since the last exchange
+/// @param destination The rank of the process
+/// @param ar The archive of the message to the real queue
+void sti::proxy_doctors::write_requests(int /*unused*/, oarchive& ar)
 {
-    auto mpi_tag = _base_tag;
+    write_wires<patient_turn_wire>(ar, _enqueue_buffer);
+    write_wires<specialty_id_wire>(ar, _dequeue_buffer);
 
-    _communicator->send(_real_rank, mpi_tag++, _enqueue_buffer);
-    _communicator->send(_real_rank, mpi_tag++, _dequeue_buffer);
-    
     // Clear the queues
     _enqueue_buffer.clear();
     _dequeue_buffer.clear();
+}
 
-    // Use broadcast for the front, more practical
-    boost::mpi::broadcast(*_communicator, _front, _real_rank);
+/// @brief Read the new turns of the patients of this process
+/// @param source The rank of the process
+/// @param ar The archive of the message from the real queue
+void sti::proxy_doctors::read_responses(int /*unused*/, iarchive& ar)
+{
+    auto new_turns = std::vector<doctor_turn> {};
+    read_wires<doctor_turn_wire>(ar, new_turns);
+    for (const auto& turn : new_turns) {
+        _turns[turn.id] = { turn.specialty, turn.box };
+    }
+}
 
-}
\ No newline at end of file
+/// @brief Get the heap bytes of the turns and the requests
+std::size_t sti::proxy_doctors::memory_bytes() const
+{
+    return memory::bytes(_turns) + memory::bytes(_enqueue_buffer) + memory::bytes(_dequeue_buffer);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the turns and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_doctors::save_state(oarchive& ar) const
+{
+    ar << _turns;
+    ar << _enqueue_buffer;
+    ar << _dequeue_buffer;
+}
+
+/// @brief Read the turns and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_doctors::load_state(iarchive& ar)
+{
+    ar >> _turns;
+    ar >> _enqueue_buffer;
+    ar >> _dequeue_buffer;
+}
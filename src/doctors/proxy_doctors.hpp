@@ -4,6 +4,15 @@
 
 #include "../doctors_queue.hpp"
 
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sti {
+class hospital_plan;
+} // namespace sti
+
 namespace sti {
 
 class proxy_doctors final : public doctors_queue {
@@ -13,13 +22,14 @@ public:
     /// @param communicator The MPI Communicator
     /// @param real_rank The rank of the process containing the real queue
     /// @param mpi_tag The MPI tag used for comunication
-    proxy_doctors(communicator_ptr communicator, int real_rank, int mpi_tag);
+    /// @param hospital The hospital plan, to locate the doctor boxes
+    proxy_doctors(communicator_ptr communicator, int real_rank, int mpi_tag, const hospital_plan& hospital);
 
     /// @brief Enqueue in a doctor type
     /// @param type The doctor specialization to enqueue in
     /// @param id The agent id
     /// @param timeout Instant of time that the patient will leave if doesn't receive attention
-    void enqueue(const specialty_type& type, const repast::AgentId& id,  const datetime& timeout) override;
+    void enqueue(const specialty_type& type, const agent_id& id,  const datetime& timeout) override;
     
     /// @brief Remove an agent from the queues
     /// @param type The doctor type/specialty to dequeue from
@@ -32,17 +42,51 @@ public:
     /// @return If the agent has a doctor assigned, the destination
     boost::optional<position> is_my_turn(const specialty_type& type, const agent_id& id) override;
 
-    /// @brief Sync the queues between the processes
-    void sync() override;
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are enqueues or dequeues since the last exchange
+    /// @param destination The rank of the process
+    bool pending_requests(int destination) const override;
+
+    /// @brief Write the enqueues and dequeues since the last exchange
+    /// @param destination The rank of the process
+    /// @param ar The archive of the message to the real queue
+    void write_requests(int destination, oarchive& ar) override;
+
+    /// @brief Read the new turns of the patients of this process
+    /// @param source The rank of the process
+    /// @param ar The archive of the message from the real queue
+    void read_responses(int source, iarchive& ar) override;
+
+    /// @brief Get the heap bytes of the turns and the requests
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the turns and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the turns and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator_ptr _communicator;
     int              _real_rank;
     int              _base_tag;
-    front_type       _front;
+
+    std::vector<position> _box_location;
+
+    // The specialty and doctor box assigned to the patients of this process with a turn
+    std::unordered_map<agent_id, std::pair<specialty_type, box_type>, agent_key::hash> _turns;
 
     std::vector<std::pair<specialty_type, patient_turn>>    _enqueue_buffer;
-    std::vector<std::pair<specialty_type, repast::AgentId>> _dequeue_buffer;
+    std::vector<std::pair<specialty_type, agent_id>>        _dequeue_buffer;
 };
 
 } // namespace sti
\ No newline at end of file
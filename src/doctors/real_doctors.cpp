@@ -6,6 +6,7 @@
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/optional.hpp>
+#include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/mpi/communicator.hpp>
 #include <sstream>
@@ -14,6 +15,8 @@
 
 #include "../debug_flags.hpp"
 #include "../hospital_plan.hpp"
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
 
 /// @brief Construct real queue, specifing the rank of the real queue
 /// @param communicator The MPI Communicator
@@ -23,29 +26,23 @@ sti::real_doctors::real_doctors(communicator_ptr communicator, int mpi_tag, cons
     : _communicator { communicator }
     , _my_rank { _communicator->rank() }
     , _base_tag { mpi_tag }
-    // , _doctors {
-    //     [&]() {
-    //         auto queue = decltype(_doctors) {};
-    //         for (const auto& doctor : hospital.doctors()) {
-    //             queue[doctor.type].push_back(doctor.patient_chair.continuous());
-    //         }
-    //         return queue;
-    //     }()
-    // }
-    , _front { [&]() {
-        auto front = decltype(_front) {};
-        for (const auto& doctor : hospital.doctors()) {
-            front[doctor.type][doctor.patient_chair.continuous()] = boost::none;
+    , _specialties { hospital.specialties() }
+    , _boxes { [&]() {
+        auto boxes = decltype(_boxes) {};
+        for (auto specialty = specialty_type { 0 }; specialty < _specialties.size(); ++specialty) {
+            boxes.push_back(hospital.boxes(specialty));
         }
-        return front;
+        return boxes;
     }() }
-    , _patients_queue { [&]() {
-        auto pq = decltype(_patients_queue) {};
-        for (const auto& [specialty, boxes] : _front) {
-            pq[specialty] = {};
+    , _box_location { [&]() {
+        auto locations = decltype(_box_location) {};
+        for (const auto& doctor : hospital.doctors()) {
+            locations.push_back(doctor.patient_chair.continuous());
         }
-        return pq;
+        return locations;
     }() }
+    , _front(_box_location.size())
+    , _patients_queue(_specialties.size())
 {
 }
 
@@ -57,9 +54,10 @@ sti::real_doctors::real_doctors(communicator_ptr communicator, int mpi_tag, cons
 /// @param type The doctor specialization to enqueue in
 /// @param id The agent id
 /// @param timeout Instant of time that the patient will leave if doesn't receive attention
-void sti::real_doctors::enqueue(const specialty_type& type, const repast::AgentId& id, const datetime& timeout)
+void sti::real_doctors::enqueue(const specialty_type& type, const agent_id& id, const datetime& timeout)
 {
     insert_in_order(type, { id, timeout });
+    _owner[id] = _my_rank;
 }
 
 /// @brief Remove an agent from the queues
@@ -68,6 +66,7 @@ void sti::real_doctors::enqueue(const specialty_type& type, const repast::AgentI
 void sti::real_doctors::dequeue(const specialty_type& type, const agent_id& id)
 {
     remove_patient(type, id);
+    _owner.erase(id);
 }
 
 /// @brief Check if the agent has a turn assigned. Returns the location of the doctor to go
@@ -76,65 +75,68 @@ void sti::real_doctors::dequeue(const specialty_type& type, const agent_id& id)
 /// @return If the agent has a doctor assigned, the destination
 boost::optional<sti::doctors_queue::position> sti::real_doctors::is_my_turn(const specialty_type& type, const agent_id& id)
 {
-    const auto& queue = _front[type];
-    const auto  it    = std::find_if(queue.begin(), queue.end(),
-                                 [&](const auto& turn) {
-                                     return turn.second == id;
-                                 });
-
-    if (it != queue.end()) {
-        return it->first;
+    // Only lookups, the patients query the fronts from several threads during
+    // the act phase
+    const auto it = _doctor_of.find(id);
+    if (it != _doctor_of.end() && it->second.first == type) {
+        return _box_location[it->second.second];
     }
 
     return {};
 }
 
-/// @brief Sync the queues between the processes
-void sti::real_doctors::sync()
+////////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Read the enqueues and dequeues of a proxy
+/// @param source The rank of the proxy
+/// @param ar The archive of the message from the proxy
+void sti::real_doctors::read_requests(int source, iarchive& ar)
 {
-    const auto my_rank    = _communicator->rank();
-    const auto world_size = _communicator->size();
-    auto       to_enqueue = std::vector(static_cast<std::size_t>(world_size), std::vector<std::pair<specialty_type, patient_turn>> {});
-    auto       to_dequeue = std::vector(static_cast<std::size_t>(world_size), std::vector<std::pair<specialty_type, repast::AgentId>> {});
-    auto       mpi_tag    = _base_tag;
-
-    // Receive the new enqueue
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != my_rank) {
-            _communicator->recv(p, mpi_tag, to_enqueue.at(static_cast<std::size_t>(p)));
-        }
-    }
-    mpi_tag++;
+    auto to_enqueue = std::vector<std::pair<specialty_type, patient_turn>> {};
+    read_wires<patient_turn_wire>(ar, to_enqueue);
+    read_wires<specialty_id_wire>(ar, _to_dequeue);
 
-    // Receive the new dequeues
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != my_rank) {
-            _communicator->recv(p, mpi_tag, to_dequeue.at(static_cast<std::size_t>(p)));
-        }
+    for (const auto& new_enqueue : to_enqueue) {
+        _to_enqueue.emplace_back(source, new_enqueue);
     }
-    mpi_tag++;
+}
+
+/// @brief Apply the requests of all the proxies and update the front
+void sti::real_doctors::serve()
+{
+    _new_turns.clear();
 
     // Perform the enqueues
-    for (const auto& vector : to_enqueue) {
-        for (const auto& new_enqueue : vector) {
-            insert_in_order(new_enqueue.first, new_enqueue.second);
-        }
+    for (const auto& [source, new_enqueue] : _to_enqueue) {
+        insert_in_order(new_enqueue.first, new_enqueue.second);
+        _owner[new_enqueue.second.id] = source;
     }
 
     // Perform the dequeues
-    for (const auto& vector : to_dequeue) {
-        for (const auto& new_dequeue : vector) {
-            remove_patient(new_dequeue.first, new_dequeue.second);
-        }
+    for (const auto& new_dequeue : _to_dequeue) {
+        remove_patient(new_dequeue.first, new_dequeue.second);
+        _owner.erase(new_dequeue.second);
     }
 
-    // Update the front, poping patients from the queues
-    for (auto& [specialty, doctors] : _front) {
-        auto& patients = _patients_queue.at(specialty);
-        for (auto& doctor_location : doctors) {
-            if (!doctor_location.second.is_initialized() && !patients.empty()) {
-                doctor_location.second = patients.front().id;
+    _to_enqueue.clear();
+    _to_dequeue.clear();
+
+    // Update the front, poping patients from the queues. The process of each
+    // patient receives only its turns, the patients don't move while they wait
+    for (auto specialty = specialty_type { 0 }; specialty < _boxes.size(); ++specialty) {
+        auto& patients = _patients_queue[specialty];
+        for (const auto box : _boxes[specialty]) {
+            if (patients.empty()) break;
+            if (!_front[box].is_initialized()) {
+                const auto id  = patients.front();
+                _front[box]    = id;
+                _doctor_of[id] = { specialty, box };
                 patients.pop_front();
+
+                const auto owner = _owner.at(id);
+                if (owner != _my_rank) _new_turns[owner].push_back({ specialty, id, box });
             }
         }
     }
@@ -143,12 +145,12 @@ void sti::real_doctors::sync()
     if constexpr (sti::debug::doctors_print_front) {
         auto os = std::ostringstream {};
         os << "Current doctors: \n";
-        for (const auto& [doc_type, queue] : _front) {
-            os << "-> " << doc_type << "\n";
-            for (const auto& turn : queue) {
+        for (auto specialty = specialty_type { 0 }; specialty < _boxes.size(); ++specialty) {
+            os << "-> " << _specialties[specialty] << "\n";
+            for (const auto box : _boxes[specialty]) {
                 os << "   -> "
-                   << turn.first << " "
-                   << turn.second
+                   << _box_location[box] << " "
+                   << _front[box]
                    << "\n";
             }
         }
@@ -157,8 +159,35 @@ void sti::real_doctors::sync()
         }
     } // if constexpr
 
-    // Broadcast the new_front
-    boost::mpi::broadcast(*_communicator, _front, _my_rank);
+}
+
+/// @brief Check if a proxy has patients with new turns
+/// @param destination The rank of the proxy
+bool sti::real_doctors::pending_responses(int destination) const
+{
+    return _new_turns.count(destination) != 0;
+}
+
+/// @brief Write the new turns of the patients of a proxy
+/// @param destination The rank of the proxy
+/// @param ar The archive of the message to the proxy
+void sti::real_doctors::write_responses(int destination, oarchive& ar)
+{
+    write_wires<doctor_turn_wire>(ar, _new_turns[destination]);
+}
+
+/// @brief Get the heap bytes of the queues, the front and the messages
+std::size_t sti::real_doctors::memory_bytes() const
+{
+    auto total = memory::bytes(_front)
+        + memory::bytes(_patients_queue)
+        + memory::bytes(_doctor_of)
+        + memory::bytes(_owner)
+        + memory::bytes(_to_enqueue)
+        + memory::bytes(_to_dequeue)
+        + memory::bytes(_new_turns);
+    for (const auto& queue : _patients_queue) total += queue.memory_bytes();
+    return total;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -172,17 +201,8 @@ void sti::real_doctors::insert_in_order(const specialty_type& type, const patien
 {
     // The patients must be inserted according to the assigned priority, which
     // is implemented with a timeout/'wait_until <timeout> before leaving'. The
-    // queue must remain sorted, where queue[i].timeout < queue[i+1].timeout.
-
-    auto&      queue     = _patients_queue[type];
-    const auto insert_it = std::find_if(queue.begin(), queue.end(),
-                                        [&](const auto& queue_turn) {
-                                            // Returns true when the turn-in-queue
-                                            // timeouts after the inserting turn
-                                            return turn.timeout < queue_turn.timeout;
-                                        });
-
-    queue.insert(insert_it, turn);
+    // queue keeps them sorted by timeout, and in arrival order for the same one.
+    _patients_queue.at(type).push(turn.id, turn.timeout);
 }
 
 /// @brief Remove an agent from a queue
@@ -191,15 +211,36 @@ void sti::real_doctors::insert_in_order(const specialty_type& type, const patien
 void sti::real_doctors::remove_patient(const specialty_type& type, const agent_id& id)
 {
     // Check if the patient is in the front
-    auto& boxes  = _front.at(type);
-    auto  box_it = std::find_if(boxes.begin(), boxes.end(),
-                               [&](const auto& kv) { return kv.second == id; });
+    const auto it = _doctor_of.find(id);
 
-    if (box_it != boxes.end()) {
-        box_it->second = boost::none;
+    if (it != _doctor_of.end() && it->second.first == type) {
+        _front[it->second.second] = boost::none;
+        _doctor_of.erase(it);
     } else {
-        _patients_queue.at(type).remove_if([&](const auto& turn) {
-            return turn.id == id;
-        });
+        _patients_queue.at(type).erase(id);
     }
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the queues, the doctors assigned and the owner of each patient
+/// @param ar The archive of the checkpoint
+void sti::real_doctors::save_state(oarchive& ar) const
+{
+    ar << _front;
+    ar << _patients_queue;
+    ar << _doctor_of;
+    ar << _owner;
+}
+
+/// @brief Read the queues, the doctors assigned and the owner of each patient
+/// @param ar The archive of the checkpoint
+void sti::real_doctors::load_state(iarchive& ar)
+{
+    ar >> _front;
+    ar >> _patients_queue;
+    ar >> _doctor_of;
+    ar >> _owner;
+}
@@ -6,8 +6,13 @@
 
 #include <map>
 #include <repast_hpc/AgentId.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../clock.hpp"
+#include "../indexed_queue.hpp"
 
 // Fw. declarations
 namespace boost {
@@ -23,9 +28,9 @@ namespace sti {
 class real_doctors final : public doctors_queue {
 
 public:
-    /// @brief The list of doctors
-    using single_queue        = std::list<patient_turn>;
-    using patients_queue_type = std::map<specialty_type, single_queue>;
+    /// @brief The patients waiting for a specialty, ordered by timeout
+    using single_queue        = indexed_priority_queue<agent_id, datetime, agent_key::hash>;
+    using patients_queue_type = std::vector<single_queue>; // By specialty
 
     /// @brief Construct real queue, specifing the rank of the real queue
     /// @param communicator The MPI Communicator
@@ -37,7 +42,7 @@ public:
     /// @param type The doctor specialization to enqueue in
     /// @param id The agent id
     /// @param timeout Instant of time that the patient will leave if doesn't receive attention
-    void enqueue(const specialty_type& type, const repast::AgentId& id, const datetime& timeout) override;
+    void enqueue(const specialty_type& type, const agent_id& id, const datetime& timeout) override;
 
     /// @brief Remove an agent from the queues
     /// @param type The doctor type/specialty to dequeue from
@@ -50,18 +55,67 @@ public:
     /// @return If the agent has a doctor assigned, the destination
     boost::optional<position> is_my_turn(const specialty_type& type, const agent_id& id) override;
 
-    /// @brief Sync the queues between the processes
-    void sync() override;
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Read the enqueues and dequeues of a proxy
+    /// @param source The rank of the proxy
+    /// @param ar The archive of the message from the proxy
+    void read_requests(int source, iarchive& ar) override;
+
+    /// @brief Apply the requests of all the proxies and update the front
+    void serve() override;
+
+    /// @brief Check if a proxy has patients with new turns
+    /// @param destination The rank of the proxy
+    bool pending_responses(int destination) const override;
+
+    /// @brief Write the new turns of the patients of a proxy
+    /// @param destination The rank of the proxy
+    /// @param ar The archive of the message to the proxy
+    void write_responses(int destination, oarchive& ar) override;
+
+    /// @brief Get the heap bytes of the queues, the front and the messages
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the queues, the doctors assigned and the owner of each patient
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the queues, the doctors assigned and the owner of each patient
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator_ptr _communicator;
     int              _my_rank;
     int              _base_tag;
 
-    // doctors             _doctors;
+    // The layout of the plan, the boxes of each specialty and their locations
+    std::vector<std::string>           _specialties;
+    std::vector<std::vector<box_type>> _boxes;
+    std::vector<position>              _box_location;
+
     front_type          _front;
     patients_queue_type _patients_queue;
 
+    // The specialty and doctor box assigned to each patient in the front, and
+    // the process of each patient enqueued
+    std::unordered_map<agent_id, std::pair<specialty_type, box_type>, agent_key::hash> _doctor_of;
+    std::unordered_map<agent_id, int, agent_key::hash>                                 _owner;
+
+    // Requests of the proxies, received in the current exchange
+    std::vector<std::pair<int, std::pair<specialty_type, patient_turn>>> _to_enqueue;
+    std::vector<std::pair<specialty_type, agent_id>>                     _to_dequeue;
+
+    // The turns assigned in the current exchange, by process of the patient
+    std::map<int, std::vector<doctor_turn>> _new_turns;
+
     // Helper functions
 
     /// @brief Insert a new patient turn in order
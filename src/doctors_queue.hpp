@@ -4,12 +4,13 @@
 
 #include <cstdint>
 #include <boost/optional.hpp>
-#include <map>
-#include <repast_hpc/AgentId.h>
-#include <string>
+#include <vector>
 
+#include "agent_key.hpp"
+#include "checkpoint.hpp"
 #include "clock.hpp"
 #include "coordinates.hpp"
+#include "manager_exchange.hpp"
 
 namespace boost {
 template <typename T>
@@ -30,13 +31,17 @@ class hospital_plan;
 namespace sti {
 
 /// @brief Multiprocess queue that holds the doctors turns
-class doctors_queue {
+class doctors_queue : public exchange_participant
+    , public checkpoint_participant {
 
 public:
+    using exchange_participant::iarchive;
+    using exchange_participant::oarchive;
+
     /// @brief Represents a patient turn,
     struct patient_turn {
-        repast::AgentId id;
-        sti::datetime   timeout;
+        agent_key     id;
+        sti::datetime timeout;
 
         template <typename Archive>
         void serialize(Archive& ar, const unsigned int /*unused*/)
@@ -49,13 +54,31 @@ public:
     using mpi_tag_type     = int;
     using communicator_ptr = boost::mpi::communicator*;
 
-    using specialty_type = std::string;
-    using agent_id    = repast::AgentId;
-    using position    = sti::coordinates<double>;
+    /// @brief A specialty, as hospital_plan::specialty_id
+    using specialty_type = std::uint16_t;
+    /// @brief A doctor box, as hospital_plan::box_id
+    using box_type = std::uint32_t;
+    using agent_id = agent_key; // The agent ids convert to it
+    using position = sti::coordinates<double>;
+
+    /// @brief The type used to represent the current patients, the patient in
+    /// each doctor box, indexed by the box id
+    using front_type = std::vector<boost::optional<agent_id>>;
+
+    /// @brief A doctor assigned, notified to the process of the patient
+    struct doctor_turn {
+        specialty_type specialty;
+        agent_id       id;
+        box_type       box;
 
-    /// @brief The type used to represent the current patients, it consist of
-    /// one map per specialty, where each map is location -> patient.
-    using front_type = std::map<specialty_type, std::map<position, boost::optional<agent_id>>>;
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& specialty;
+            ar& id;
+            ar& box;
+        }
+    };
 
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
@@ -79,7 +102,7 @@ public:
     /// @param type The doctor specialization to enqueue in
     /// @param id The agent id
     /// @param timeout Instant of time that the patient will leave if doesn't receive attention
-    virtual void enqueue(const specialty_type& type, const repast::AgentId& id, const datetime& timeout) = 0;
+    virtual void enqueue(const specialty_type& type, const agent_id& id, const datetime& timeout) = 0;
 
     /// @brief Remove an agent from the queues
     /// @param type The doctor type/specialty to dequeue from
@@ -92,9 +115,6 @@ public:
     /// @return If the agent has a doctor assigned, the destination
     virtual boost::optional<position> is_my_turn(const specialty_type& type, const agent_id& id) = 0;
 
-    /// @brief Sync the queues between the processes
-    virtual void sync() = 0;
-
 }; // class doctors_queue
 
 } // namespace sti
@@ -0,0 +1,171 @@
+/// @file emulated_network.cpp
+/// @brief Virtual processes exchanging the managers' messages inside one process
+#include "emulated_network.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+/// @brief The transport of a virtual process
+class sti::emulated_network::endpoint final : public exchange_transport {
+
+public:
+    /// @brief Create the transport of a virtual process
+    /// @param network The network
+    /// @param rank The rank of the process
+    endpoint(emulated_network* network, int rank)
+        : _network { network }
+        , _rank { rank }
+    {
+    }
+
+    /// @brief Get the rank of this process
+    int rank() const override
+    {
+        return _rank;
+    }
+
+    /// @brief Get the number of processes
+    int size() const override
+    {
+        return _network->size();
+    }
+
+    /// @brief Get the communicator the messages are packed for
+    MPI_Comm packing() const override
+    {
+        return _network->_self;
+    }
+
+    /// @brief Deliver the messages of a round to the mailboxes of the receivers
+    /// @param tag The tag of the round
+    /// @param outgoing The messages by destination
+    void send(int tag, const std::map<int, buffer_type>& outgoing) override
+    {
+        for (const auto& [destination, buffer] : outgoing) _network->deliver(tag, _rank, destination, buffer);
+    }
+
+    /// @brief Take the messages of a round, all delivered by sync()
+    /// @param tag The tag of the round
+    /// @param incoming Output, the messages by source
+    void receive(int tag, std::map<int, buffer_type>& incoming) override
+    {
+        _network->take(tag, _rank, incoming);
+    }
+
+private:
+    emulated_network* _network;
+    int               _rank;
+}; // class sti::emulated_network::endpoint
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a network
+/// @param processes The number of virtual processes
+/// @param l The link between the processes
+sti::emulated_network::emulated_network(int processes, link l)
+    : _processes { std::max(processes, 1) }
+    , _link { l }
+    , _self { MPI_COMM_SELF, boost::mpi::comm_attach }
+    , _sent(static_cast<std::size_t>(_processes), 0)
+    , _received(static_cast<std::size_t>(_processes), 0)
+{
+}
+
+/// @brief Destruct defined after the endpoint
+sti::emulated_network::~emulated_network() = default;
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of virtual processes
+int sti::emulated_network::size() const
+{
+    return _processes;
+}
+
+/// @brief Create the transport of a virtual process
+/// @param rank The rank of the process
+/// @return The transport, must not outlive the network
+std::unique_ptr<sti::exchange_transport> sti::emulated_network::transport(int rank)
+{
+    return std::make_unique<endpoint>(this, rank);
+}
+
+/// @brief Exchange the managers of all the virtual processes
+/// @details Every exchange posts its requests, then every exchange
+/// serves them, then every exchange reads the responses
+/// @param exchanges The exchange of each virtual process, by rank
+void sti::emulated_network::sync(const std::vector<manager_exchange*>& exchanges)
+{
+    for (auto* exchange : exchanges) exchange->post();
+    close_round();
+    for (auto* exchange : exchanges) exchange->serve();
+    close_round();
+    for (auto* exchange : exchanges) exchange->finish();
+}
+
+/// @brief Get the totals of the rounds exchanged so far
+const sti::emulated_network::statistics& sti::emulated_network::stats() const
+{
+    return _stats;
+}
+
+/// @brief Deliver a message
+/// @param tag The tag of the round
+/// @param source The rank of the sender
+/// @param destination The rank of the receiver
+/// @param buffer The message
+void sti::emulated_network::deliver(int tag, int source, int destination, const buffer_type& buffer)
+{
+    auto& mailbox = _mailboxes[tag];
+    mailbox.resize(static_cast<std::size_t>(_processes));
+    mailbox.at(static_cast<std::size_t>(destination))[source] = buffer;
+
+    _sent[static_cast<std::size_t>(source)] += buffer.size();
+    _received[static_cast<std::size_t>(destination)] += buffer.size();
+    ++_stats.messages;
+    _stats.bytes += buffer.size();
+}
+
+/// @brief Take the messages of a round sent to a process
+/// @param tag The tag of the round
+/// @param destination The rank of the receiver
+/// @param incoming Output, the messages by source
+void sti::emulated_network::take(int tag, int destination, std::map<int, buffer_type>& incoming)
+{
+    incoming.clear();
+    const auto mailbox = _mailboxes.find(tag);
+    if (mailbox == _mailboxes.end() || mailbox->second.empty()) return;
+    std::swap(incoming, mailbox->second.at(static_cast<std::size_t>(destination)));
+}
+
+/// @brief Add the modelled time of the round delivered, and wait it if realtime
+void sti::emulated_network::close_round()
+{
+    // The slowest process, then the barrier
+    auto slowest = 0.0;
+    for (auto p = std::size_t { 0 }; p < _sent.size(); ++p) {
+        const auto bytes = std::max(_sent[p], _received[p]);
+        if (bytes == 0) continue;
+        const auto transfer = _link.bandwidth > 0 ? static_cast<double>(bytes) / _link.bandwidth : 0.0;
+        slowest             = std::max(slowest, _link.latency_s + transfer);
+    }
+    const auto levels = std::ceil(std::log2(static_cast<double>(_processes)));
+    const auto time   = slowest + _link.latency_s * levels;
+
+    ++_stats.rounds;
+    _stats.network_s += time;
+    std::fill(_sent.begin(), _sent.end(), 0);
+    std::fill(_received.begin(), _received.end(), 0);
+
+    // Spin, the rounds are usually shorter than the resolution of a sleep
+    if (_link.realtime && time > 0) {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::duration<double>(time);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+}
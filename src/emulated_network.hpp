@@ -0,0 +1,122 @@
+/// @file emulated_network.hpp
+/// @brief Virtual processes exchanging the managers' messages inside one process
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "manager_exchange.hpp"
+
+namespace sti {
+
+/// @brief An in-memory network of virtual processes, for the manager exchange
+/// @details Each virtual process has its own managers and its own exchange,
+/// created over transport(). sync() runs each phase of the exchange in all
+/// the virtual processes before the next phase, so the messages of a round
+/// are all delivered when they are received, in a single thread. The
+/// messages are packed for MPI_COMM_SELF, where the rank is 0: the real
+/// managers, that take their rank from their communicator, must be in the
+/// virtual process 0.
+///
+/// The time of each round is modelled from the link: the latency, if the
+/// process sends or receives something, plus the largest of the bytes it
+/// sends and receives over the bandwidth, for the slowest process, plus the
+/// non-blocking barrier closing the round, a latency per level of a binary
+/// tree. With a realtime link the rounds also wait that time, so it is part
+/// of the time measured by a benchmark.
+class emulated_network {
+
+public:
+    using buffer_type = exchange_transport::buffer_type;
+
+    /// @brief The link between every pair of virtual processes
+    struct link {
+        double latency_s {}; // Of a message
+        double bandwidth {}; // Bytes per second of each process, 0 for unlimited
+        bool   realtime {};  // Wait the time of the rounds
+    };
+
+    /// @brief The totals of the rounds exchanged
+    struct statistics {
+        std::uint64_t rounds {};
+        std::uint64_t messages {};
+        std::uint64_t bytes {};
+        double        network_s {}; // Modelled from the link
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create a network
+    /// @param processes The number of virtual processes
+    /// @param l The link between the processes
+    emulated_network(int processes, link l);
+
+    emulated_network(const emulated_network&) = delete;
+    emulated_network& operator=(const emulated_network&) = delete;
+
+    emulated_network(emulated_network&&) = delete;
+    emulated_network& operator=(emulated_network&&) = delete;
+
+    ~emulated_network();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of virtual processes
+    int size() const;
+
+    /// @brief Create the transport of a virtual process
+    /// @param rank The rank of the process
+    /// @return The transport, must not outlive the network
+    std::unique_ptr<exchange_transport> transport(int rank);
+
+    /// @brief Exchange the managers of all the virtual processes
+    /// @details Every exchange posts its requests, then every exchange
+    /// serves them, then every exchange reads the responses
+    /// @param exchanges The exchange of each virtual process, by rank
+    void sync(const std::vector<manager_exchange*>& exchanges);
+
+    /// @brief Get the totals of the rounds exchanged so far
+    const statistics& stats() const;
+
+private:
+    /// @brief The transport of a virtual process
+    class endpoint;
+
+    /// @brief Deliver a message
+    /// @param tag The tag of the round
+    /// @param source The rank of the sender
+    /// @param destination The rank of the receiver
+    /// @param buffer The message
+    void deliver(int tag, int source, int destination, const buffer_type& buffer);
+
+    /// @brief Take the messages of a round sent to a process
+    /// @param tag The tag of the round
+    /// @param destination The rank of the receiver
+    /// @param incoming Output, the messages by source
+    void take(int tag, int destination, std::map<int, buffer_type>& incoming);
+
+    /// @brief Add the modelled time of the round delivered, and wait it if realtime
+    void close_round();
+
+    int                      _processes;
+    link                     _link;
+    statistics               _stats;
+    boost::mpi::communicator _self;
+
+    // The messages of the rounds in flight, by tag, receiver and sender
+    std::map<int, std::vector<std::map<int, buffer_type>>> _mailboxes;
+
+    // The traffic of each process in the current round
+    std::vector<std::uint64_t> _sent;
+    std::vector<std::uint64_t> _received;
+}; // class emulated_network
+
+} // namespace sti
@@ -0,0 +1,58 @@
+/// @file ensemble.cpp
+/// @brief Several independent replicas of the simulation in one launch
+#include "ensemble.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <repast_hpc/Properties.h>
+#include <system_error>
+
+/// @brief Split the processes between the replicas of the ensemble
+/// @throws bad_ensemble If the processes can't be split evenly
+/// @param props_file The properties file
+/// @param argc The arguments count
+/// @param argv The arguments
+/// @param world The communicator with all the processes
+/// @return The replica of this process
+sti::replica sti::split_ensemble(const std::string& props_file, int argc, char** argv, boost::mpi::communicator& world)
+{
+    auto        props    = repast::Properties { props_file, argc, argv, &world };
+    const auto& replicas = props.getProperty("ensemble.replicas");
+    if (replicas.empty()) return { 0, world, {} };
+
+    const auto n = boost::lexical_cast<int>(replicas);
+    if (n < 1 || world.size() % n != 0) throw bad_ensemble {};
+
+    // Consecutive ranks share a replica, so its processes stay in the same
+    // nodes as far as possible
+    const auto index = world.rank() / (world.size() / n);
+    auto       out   = replica { index, world.split(index), {} };
+
+    // The seed of the replica
+    auto        seeds = std::vector<std::string> {};
+    const auto& list  = props.getProperty("ensemble.seeds");
+    if (!list.empty()) boost::split(seeds, list, boost::is_any_of(","));
+    if (!seeds.empty()) {
+        if (seeds.size() != static_cast<std::size_t>(n)) throw bad_ensemble {};
+        out.overrides.push_back("random.seed=" + boost::trim_copy(seeds[static_cast<std::size_t>(index)]));
+    } else if (!props.getProperty("random.seed").empty()) {
+        const auto seed = boost::lexical_cast<std::uint64_t>(props.getProperty("random.seed")) + static_cast<std::uint64_t>(index);
+        out.overrides.push_back("random.seed=" + std::to_string(seed));
+    }
+
+    // The output folder, all the processes try to create it
+    const auto folder = props.getProperty("output.folder") + "/replica." + std::to_string(index);
+    auto       error  = std::error_code {};
+    std::filesystem::create_directories(folder, error);
+    out.overrides.push_back("output.folder=" + folder);
+
+    // The properties specific to this replica
+    const auto prefix = "replica." + std::to_string(index) + ".";
+    for (auto it = props.keys_begin(); it != props.keys_end(); ++it) {
+        const auto& key = *it;
+        if (boost::starts_with(key, prefix)) out.overrides.push_back(key.substr(prefix.size()) + "=" + props.getProperty(key));
+    }
+    return out;
+}
@@ -0,0 +1,45 @@
+/// @file ensemble.hpp
+/// @brief Several independent replicas of the simulation in one launch
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace sti {
+
+/// @brief Exception: the processes can't be split between the replicas
+struct bad_ensemble : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The number of processes must be a multiple of ensemble.replicas, and ensemble.seeds must have a seed per replica";
+    }
+};
+
+/// @brief The replica of the ensemble run by this process
+struct replica {
+    int                       index;     // The replica number, 0 without ensemble
+    boost::mpi::communicator  comm;      // The processes running the replica
+    std::vector<std::string>  overrides; // Properties of the replica, as key=value arguments
+};
+
+/// @brief Split the processes between the replicas of the ensemble
+/// @details With ensemble.replicas = N the processes are split in N groups of
+/// consecutive ranks, each running an independent simulation with its own
+/// communicator. The properties of replica k are the shared ones, with:
+///   - random.seed: the k-th value of ensemble.seeds, or random.seed + k
+///   - output.folder: <output.folder>/replica.<k>, created if needed
+///   - <key>: for each replica.<k>.<key> property
+/// The x.process and y.process of the properties are the layout of a single
+/// replica. Without ensemble.replicas all the processes run one replica.
+/// Collective
+/// @throws bad_ensemble If the processes can't be split evenly
+/// @param props_file The properties file
+/// @param argc The arguments count
+/// @param argv The arguments
+/// @param world The communicator with all the processes
+/// @return The replica of this process
+replica split_ensemble(const std::string& props_file, int argc, char** argv, boost::mpi::communicator& world);
+
+} // namespace sti
@@ -3,13 +3,19 @@
 #include <boost/json.hpp>
 #include <boost/json/array.hpp>
 #include <boost/json/detail/value_to.hpp>
+#include <boost/serialization/vector.hpp>
 #include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
 
 #include "agent_factory.hpp"
+#include "compiled_plan.hpp"
+#include "counter_rng.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
+#include "table_writer.hpp"
 #include "utils.hpp"
 
 namespace {
@@ -40,6 +46,22 @@ struct influx_and_infected_probability_differ : public std::exception {
         return "Exception: Number of days in the influx distribution and the infected probability differ";
     }
 };
+
+struct influx_file_not_found : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The patient influx file can't be opened";
+    }
+};
+
+struct entry_spool_error : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The patients generated by the entry could not be written";
+    }
+};
+
+constexpr auto seconds_per_day = 24U * 60U * 60U;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -103,6 +125,110 @@ sti::probability_precission sti::patient_distribution::get_infected_probability(
     return _infected_chance.at(day);
 }
 
+/// @brief Read the influx of a day
+/// @param day The day, lower than days()
+/// @param patients Output, the patients entering in each interval of the day
+/// @param infected_chance Output, the probability of a patient of the day being infected
+void sti::patient_distribution::read_day(std::uint32_t               day,
+                                         std::vector<std::uint32_t>& patients,
+                                         probability_precission&     infected_chance)
+{
+    patients        = _data.at(day);
+    infected_chance = _infected_chance.at(day);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// INFLUX_STREAM
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Open and validate an influx file
+/// @throws inconsistent_bins_in_file If a day has a different number of intervals
+/// @throws negative_patients If an interval has a negative number of patients
+/// @param path The path of the file
+sti::influx_stream::influx_stream(std::string path)
+    : _path { std::move(path) }
+    , _file { _path }
+{
+    if (!_file) throw influx_file_not_found {};
+
+    // Validate the whole file once, only a day is in memory
+    auto patients = std::vector<std::uint32_t> {};
+    auto infected = probability_precission {};
+    while (parse_day(patients, infected)) {
+        if (_days == 0) _intervals = static_cast<std::uint32_t>(patients.size());
+        if (patients.empty() || patients.size() != _intervals) throw inconsistent_bins_in_file {};
+        validate_probability(infected, "Patient infected probabilty");
+        _total += std::accumulate(patients.begin(), patients.end(), 0U);
+        ++_days;
+    }
+    if (_days == 0) throw inconsistent_bins_in_file {};
+
+    _file     = std::ifstream { _path };
+    _next_day = 0;
+}
+
+/// @brief Get the total number of patients that will enter the hospital
+std::uint32_t sti::influx_stream::total_patients() const
+{
+    return _total;
+}
+
+/// @brief Get the number of days of the file
+std::uint32_t sti::influx_stream::days() const
+{
+    return _days;
+}
+
+/// @brief Get the number of bins/intervals in a day
+std::uint32_t sti::influx_stream::intervals() const
+{
+    return _intervals;
+}
+
+/// @brief Read the influx of a day
+/// @details The days are read in order, going back reopens the file
+/// @param day The day, lower than days()
+/// @param patients Output, the patients entering in each interval of the day
+/// @param infected_chance Output, the probability of a patient of the day being infected
+void sti::influx_stream::read_day(std::uint32_t               day,
+                                  std::vector<std::uint32_t>& patients,
+                                  probability_precission&     infected_chance)
+{
+    if (day >= _days) throw std::out_of_range { "The day is out of the patient influx" };
+    if (day < _next_day) {
+        _file     = std::ifstream { _path };
+        _next_day = 0;
+    }
+    while (_next_day <= day) {
+        if (!parse_day(patients, infected_chance)) throw influx_file_not_found {};
+    }
+}
+
+/// @brief Parse the next day of the file
+/// @return False at the end of the file
+bool sti::influx_stream::parse_day(std::vector<std::uint32_t>& patients, probability_precission& infected_chance)
+{
+    while (std::getline(_file, _line)) {
+        if (!_line.empty() && _line.back() == '\r') _line.pop_back();
+        if (_line.empty()) continue; // Skip the blank lines
+
+        auto row  = std::istringstream { _line };
+        auto cell = std::string {};
+        std::getline(row, cell, ',');
+        infected_chance = std::stod(cell);
+
+        patients.clear();
+        while (std::getline(row, cell, ',')) {
+            const auto value = std::stoll(cell);
+            if (value < 0) throw negative_patients {};
+            patients.push_back(static_cast<std::uint32_t>(value));
+        }
+        ++_next_day;
+        return true;
+    }
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // HOSPITAL_ENTRY
 ////////////////////////////////////////////////////////////////////////////////
@@ -113,59 +239,115 @@ sti::probability_precission sti::patient_distribution::get_infected_probability(
 /// @param clock The simulation clock
 /// @param patient_admissions The patient admission histogram
 /// @param factory The agent factory, for patient creation
-sti::hospital_entry::hospital_entry(sti::coordinates<int>  location,
-                                    sti::clock*            clock,
-                                    patient_distribution&& patient_admissions,
-                                    agent_factory*         factory)
+/// @param spool The file where the counters of the finished days are
+/// written, empty to keep them in memory
+sti::hospital_entry::hospital_entry(sti::coordinates<int>          location,
+                                    sti::clock*                    clock,
+                                    std::unique_ptr<influx_source> patient_admissions,
+                                    agent_factory*                 factory,
+                                    std::string                    spool)
     : _location { location }
     , _clock { clock }
-    , _patient_distribution(std::move(patient_admissions))
-    , _generated_patients(
-          _patient_distribution.days(), std::vector<std::uint32_t>(_patient_distribution.intervals(), 0U))
+    , _influx { std::move(patient_admissions) }
     // The length of the interval is the number of seconds in a day divided
     // by the number of intervals
-    , _interval_length { (24 * 60 * 60) / _patient_distribution.intervals() }
+    , _interval_length { seconds_per_day / _influx->intervals() }
+    , _spool_path { std::move(spool) }
     , _agent_factory { factory }
 {
+    if (!_spool_path.empty()) _spool.open(_spool_path, std::ios::binary | std::ios::trunc);
+    schedule_arrivals(0);
 }
 
-/// @brief Ask how many patients are waiting at the door, upon call the counter is cleared
-/// @details Calculate how many patients must be created according to the
-///          provided distribution. The function assumes the caller is going to create
-///          those agents, the internal counter of created agents is increased in N.
-/// @return The number of patients waiting admission
-std::uint64_t sti::hospital_entry::patients_waiting()
+/// @brief Read the influx of a day and compute the instants its patients arrive
+/// @details The patients of an interval arrive at a constant rate from
+/// its start, the rate being the length of the interval divided by the
+/// number of patients, rounded up
+/// @param day The day
+void sti::hospital_entry::schedule_arrivals(std::uint32_t day)
 {
-    const auto now         = _clock->now().human();
-    const auto day         = now.days;
-    const auto day_seconds = now.hours * 60 * 60 + now.minutes * 60 + now.seconds;
-    const auto bin         = day_seconds / _interval_length; // Calculate the corresponding bin for this instant
-    const auto bin_offset  = day_seconds % _interval_length; // Seconds since the start of the corresponding interval
-
-    // Get the number of patients expected for this interval and the rate of
-    // admission
-    const auto interval_admission_target = _patient_distribution.get(day, bin);
-
-    const auto expected = [&]() {
-        // Guard to make sure we don't divide by zero
-        if (interval_admission_target == 0) {
-            return 0U;
+    _day          = day;
+    _next_arrival = 0;
+    _arrivals.clear();
+    _day_generated.assign(_influx->intervals(), 0U);
+    if (day >= _influx->days()) return; // After the influx nobody arrives
+
+    _influx->read_day(day, _day_influx, _day_infected_chance);
+    for (auto bin = 0U; bin < _influx->intervals(); ++bin) {
+        const auto target = _day_influx[bin];
+        if (target == 0) continue;
+
+        // Note: this is ceil(_interval_lenght / target). If normal
+        // division (floor()) is used, it generates more patients than it
+        // should due to rounding
+        const auto rate  = (_interval_length + target - 1) / target;
+        const auto start = day * seconds_per_day + bin * _interval_length;
+        for (auto offset = 0U; offset < _interval_length; offset += rate) {
+            _arrivals.push_back({ datetime { start + offset }, bin });
         }
+    }
+}
 
-        // The number of patients that were already admitted durning this
-        // interval should be at least the time passed since the start of the
-        // interval divided by the rate.
-        // Note: this is equivalent to ceil(_interval_lenght / interval_admission_target).
-        // If normal division (floor()) is used, it generates more patients than
-        // it should due to rounding
-        const auto rate = (_interval_length + interval_admission_target - 1) / interval_admission_target;
-        return 1 + bin_offset / rate;
-    }();
+/// @brief Record the counters of the current day and schedule the next ones
+/// @param day The day of the current instant
+void sti::hospital_entry::advance_to(std::uint32_t day)
+{
+    while (_day < day && _day < _influx->days()) {
+        record_day(_day_generated);
+        schedule_arrivals(_day + 1);
+    }
+}
 
-    const auto agents_waiting = expected - _generated_patients.at(day).at(bin);
+/// @brief Store the patients generated in a finished day
+/// @param generated The patients generated in each interval
+void sti::hospital_entry::record_day(const std::vector<std::uint32_t>& generated)
+{
+    if (!_spool.is_open()) {
+        _generated_patients.push_back(generated);
+        return;
+    }
+    _spool.write(reinterpret_cast<const char*>(generated.data()), static_cast<std::streamsize>(generated.size() * sizeof(std::uint32_t)));
+    _spool.flush();
+    if (!_spool) throw entry_spool_error {};
+}
 
-    // Increase the number of agents created and return the value
-    _generated_patients.at(day).at(bin) += agents_waiting;
+/// @brief Get the patients generated in each interval of the days reached
+/// @return The finished days, and the current one if any
+std::vector<std::vector<std::uint32_t>> sti::hospital_entry::generated_patients() const
+{
+    auto days = _generated_patients;
+    if (_spool.is_open()) {
+        auto file = std::ifstream { _spool_path, std::ios::binary };
+        auto day  = std::vector<std::uint32_t>(_influx->intervals());
+        while (file.read(reinterpret_cast<char*>(day.data()), static_cast<std::streamsize>(day.size() * sizeof(std::uint32_t)))) {
+            days.push_back(day);
+        }
+    }
+    if (_day < _influx->days()) days.push_back(_day_generated);
+    return days;
+}
+
+/// @brief Ask how many patients are waiting at the door, upon call the counter is cleared
+/// @details Take the arrivals of the current interval up to now from the
+///          schedule. The arrivals of an interval without ticks are
+///          skipped. The function assumes the caller is going to create
+///          those agents, the internal counter of created agents is increased in N.
+/// @return The number of patients waiting admission
+std::uint64_t sti::hospital_entry::patients_waiting()
+{
+    const auto now      = _clock->now();
+    const auto seconds  = now.seconds_since_epoch();
+    const auto interval = datetime { seconds - (seconds % seconds_per_day) % _interval_length };
+
+    // Only the arrivals of the current day are scheduled
+    advance_to(seconds / seconds_per_day);
+    while (_next_arrival < _arrivals.size() && _arrivals[_next_arrival].instant < interval) ++_next_arrival;
+
+    auto agents_waiting = std::uint64_t { 0 };
+    for (; _next_arrival < _arrivals.size() && _arrivals[_next_arrival].instant <= now; ++_next_arrival) {
+        ++_day_generated[_arrivals[_next_arrival].interval];
+        ++agents_waiting;
+    }
     return agents_waiting;
 }
 
@@ -173,50 +355,113 @@ std::uint64_t sti::hospital_entry::patients_waiting()
 // SAVE STATISTICS
 ////////////////////////////////////////////////////////////////////////////
 
-/// @brief Save the stadistics/metrics to a file
-/// @param filepath The path to the folder where
-/// @param rank The rank of the process
-void sti::hospital_entry::save(const std::string& folderpath, int rank) const
+/// @brief Save the stadistics/metrics, as the entry table
+/// @param output The writer of the tables
+void sti::hospital_entry::save(const table_writer& output) const
 {
-    auto os = std::ostringstream {};
-    os << folderpath
-       << "/entry.p"
-       << rank
-       << ".csv";
+    auto generated = table {};
+
+    auto& days     = generated.add_column<std::int32_t>("day");
+    auto& periods  = generated.add_column<std::int32_t>("period");
+    auto& patients = generated.add_column<std::int32_t>("patients_generated");
+
+    // The days not reached have no patients
+    const auto reached = generated_patients();
+    for (auto day = 0UL; day < _influx->days(); ++day) {
+        for (auto bin = 0UL; bin < _influx->intervals(); ++bin) {
+            days.push_back(static_cast<std::int32_t>(day));
+            periods.push_back(static_cast<std::int32_t>(bin));
+            patients.push_back(static_cast<std::int32_t>(day < reached.size() ? reached[day][bin] : 0U));
+        }
+    }
+    output.write("entry", generated);
+    if (_spool.is_open()) std::remove(_spool_path.c_str());
+}
 
-    auto file = std::ofstream { os.str() };
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
 
-    file << "day,period,patients_generated\n";
+/// @brief Write the patients generated in each interval
+/// @param ar The archive of the checkpoint
+void sti::hospital_entry::save_state(oarchive& ar) const
+{
+    ar << generated_patients();
+}
 
-    for (auto day = 0UL; day < _generated_patients.size(); ++day) {
-        for (auto bin = 0UL; bin < _generated_patients.at(day).size(); ++bin) {
-            file << day << ','
-                 << bin << ','
-                 << _generated_patients.at(day).at(bin) << '\n';
-        }
+/// @brief Read the patients generated in each interval, and restore the
+/// entry numbers from them
+/// @details The influx of the restarted run may be longer, the days not
+/// reached yet keep their counters at zero. The schedule continues after
+/// the instant of the checkpoint
+/// @param ar The archive of the checkpoint
+void sti::hospital_entry::load_state(iarchive& ar)
+{
+    auto generated = decltype(_generated_patients) {};
+    ar >> generated;
+
+    // The patients are generated as soon as they arrive
+    _entered = 0;
+    for (const auto& day : generated) _entered += std::accumulate(day.begin(), day.end(), std::uint64_t { 0 });
+
+    // Copy the counters of an interval, the days and the intervals of the
+    // checkpoint may be less
+    const auto copy_day = [&](std::size_t day, std::vector<std::uint32_t>& counters) {
+        if (day >= generated.size()) return;
+        std::copy_n(generated[day].begin(), std::min(generated[day].size(), counters.size()), counters.begin());
+    };
+
+    // Record again the finished days
+    const auto now   = _clock->now();
+    const auto today = now.seconds_since_epoch() / seconds_per_day;
+    _generated_patients.clear();
+    if (_spool.is_open()) {
+        _spool.close();
+        _spool.open(_spool_path, std::ios::binary | std::ios::trunc);
+    }
+    for (auto day = 0U; day < std::min(today, _influx->days()); ++day) {
+        auto counters = std::vector<std::uint32_t>(_influx->intervals(), 0U);
+        copy_day(day, counters);
+        record_day(counters);
     }
+
+    // The schedule of the current day continues after the instant of the checkpoint
+    schedule_arrivals(today);
+    copy_day(today, _day_generated);
+    _next_arrival = static_cast<std::size_t>(std::upper_bound(_arrivals.begin(), _arrivals.end(), now, [](const datetime& instant, const arrival& a) {
+                                                 return instant < a.instant;
+                                             })
+                                             - _arrivals.begin());
 }
 
 /// @brief Get the total number of patients that will enter the hospital
 /// @return The number of patients
 std::uint32_t sti::hospital_entry::total_patients() const
 {
-    return _patient_distribution.total_patients();
+    return _influx->total_patients();
 }
 
 /// @brief Generate the pending patients
 void sti::hospital_entry::generate_patients()
 {
-    // Create the needed patients
-    const auto pending = patients_waiting();
-    for (auto i = 0U; i < pending; i++) {
+    using STAGES = human_infection_cycle::STAGE;
 
-        using STAGES = human_infection_cycle::STAGE;
+    // Create the needed patients, all at once
+    const auto pending = patients_waiting();
+    if (pending == 0) return;
 
-        const auto random = repast::Random::instance()->nextDouble();
-        const auto stage  = _patient_distribution.get_infected_probability(_clock->now().human().days) > random ? STAGES::SICK : STAGES::HEALTHY;
-        _agent_factory->insert_new_patient(_location.continuous(), stage);
+    const auto infected_chance = _day_infected_chance;
+    auto       stages          = std::vector<STAGES> {};
+    stages.reserve(pending);
+    for (auto i = 0U; i < pending; i++) {
+        const auto subject = counter_rng::subject(counter_rng::entity::PATIENT, _entered + i);
+        const auto random  = counter_rng::instance().uniform(counter_rng::event::PATIENT_ENTRY, subject);
+        stages.push_back(infected_chance > random ? STAGES::SICK : STAGES::HEALTHY);
     }
+
+    // The entry number is the subject of the patient, see counter_rng
+    _agent_factory->insert_new_patients(_location.continuous(), stages, _entered);
+    _entered += pending;
 }
 
 /// @brief Load the patient distribution curve from a file
@@ -244,4 +489,27 @@ sti::patient_distribution sti::load_patient_distribution(const boost::json::obje
     }
 
     return patient_distribution { std::move(data), std::move(infected_chance) };
-}
\ No newline at end of file
+}
+
+/// @brief Load the patient distribution curve from a compiled plan
+/// @param plan The compiled plan containing the influx
+sti::patient_distribution sti::load_patient_distribution(const compiled_plan& plan)
+{
+    auto data = std::vector<std::vector<std::uint32_t>> {};
+    for (auto day = std::uint32_t { 0 }; day < plan.influx_days(); ++day) {
+        const auto intervals = plan.influx(day);
+        data.emplace_back(intervals.begin(), intervals.end());
+    }
+
+    auto infected_chance = patient_distribution::infected_probability_type {};
+    for (const auto v : plan.infected_probability()) {
+        validate_probability(v, "Patient infected probabilty");
+        infected_chance.push_back(v);
+    }
+
+    if (data.size() != infected_chance.size()) {
+        throw influx_and_infected_probability_differ {};
+    }
+
+    return patient_distribution { std::move(data), std::move(infected_chance) };
+}
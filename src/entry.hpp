@@ -14,6 +14,7 @@
 #include <tuple>
 #include <vector>
 
+#include "checkpoint.hpp"
 #include "clock.hpp"
 #include "hospital_plan.hpp"
 #include "utils.hpp"
@@ -30,13 +31,58 @@ namespace sti {
 
 // Fw. declarations
 class agent_factory;
+class compiled_plan;
+class table_writer;
+
+/// @brief The source of the patients entering the hospital, day by day
+/// @details The influx is divided in days, which are also divided in N bins,
+///          the same number for all the days. The entry reads only the day
+///          it's simulating
+class influx_source {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    influx_source() = default;
+
+    influx_source(const influx_source&) = default;
+    influx_source& operator=(const influx_source&) = default;
+
+    influx_source(influx_source&&) = default;
+    influx_source& operator=(influx_source&&) = default;
+
+    virtual ~influx_source() = default;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the total number of patients that will enter the hospital
+    virtual std::uint32_t total_patients() const = 0;
+
+    /// @brief Get the number of days the influx covers
+    virtual std::uint32_t days() const = 0;
+
+    /// @brief Get the number of bins/intervals in a day
+    virtual std::uint32_t intervals() const = 0;
+
+    /// @brief Read the influx of a day
+    /// @param day The day, lower than days()
+    /// @param patients Output, the patients entering in each interval of the day
+    /// @param infected_chance Output, the probability of a patient of the day being infected
+    virtual void read_day(std::uint32_t               day,
+                          std::vector<std::uint32_t>& patients,
+                          probability_precission&     infected_chance) = 0;
+};
 
 /// @brief Distribution of patients entering the hospital
 /// @details Distribution/rate of patient entering the hospital in a given
 ///          length of time. The distribution is discrete divided in days, which
 ///          are also divided in N bins. The number of bins is specified by the
 ///          user but has to be equal for all days
-class patient_distribution {
+class patient_distribution final : public influx_source {
 
 public:
     using entry_rate_type           = std::vector<std::vector<std::uint32_t>>;
@@ -49,15 +95,23 @@ public:
                          infected_probability_type&& infected_chance);
 
     /// @brief Get the total number of patients that will enter the hospital
-    std::uint32_t total_patients() const;
+    std::uint32_t total_patients() const override;
 
     /// @brief Get the number of days the distribution cover
     /// @return The number of days for which data is available
-    std::uint32_t days() const;
+    std::uint32_t days() const override;
 
     /// @brief Get the number of bins/intervals in a day
     /// @return The number of intervals in a day
-    std::uint32_t intervals() const;
+    std::uint32_t intervals() const override;
+
+    /// @brief Read the influx of a day
+    /// @param day The day, lower than days()
+    /// @param patients Output, the patients entering in each interval of the day
+    /// @param infected_chance Output, the probability of a patient of the day being infected
+    void read_day(std::uint32_t               day,
+                  std::vector<std::uint32_t>& patients,
+                  probability_precission&     infected_chance) override;
 
     /// @brief Get the number of patients entering the hospital in a given interval
     /// @param day The day
@@ -75,8 +129,55 @@ private:
     infected_probability_type _infected_chance;
 };
 
+/// @brief Patient influx streamed from a CSV side file
+/// @details Each line is a day: the probability of a patient being infected
+///          followed by the patients of each interval, see the documentation.
+///          The file is scanned once when opened, to validate it and count
+///          the days, and then read a day at a time, so its size doesn't
+///          change the memory of the simulation
+class influx_stream final : public influx_source {
+
+public:
+    /// @brief Open and validate an influx file
+    /// @throws inconsistent_bins_in_file If a day has a different number of intervals
+    /// @throws negative_patients If an interval has a negative number of patients
+    /// @param path The path of the file
+    explicit influx_stream(std::string path);
+
+    /// @brief Get the total number of patients that will enter the hospital
+    std::uint32_t total_patients() const override;
+
+    /// @brief Get the number of days of the file
+    std::uint32_t days() const override;
+
+    /// @brief Get the number of bins/intervals in a day
+    std::uint32_t intervals() const override;
+
+    /// @brief Read the influx of a day
+    /// @details The days are read in order, going back reopens the file
+    /// @param day The day, lower than days()
+    /// @param patients Output, the patients entering in each interval of the day
+    /// @param infected_chance Output, the probability of a patient of the day being infected
+    void read_day(std::uint32_t               day,
+                  std::vector<std::uint32_t>& patients,
+                  probability_precission&     infected_chance) override;
+
+private:
+    /// @brief Parse the next day of the file
+    /// @return False at the end of the file
+    bool parse_day(std::vector<std::uint32_t>& patients, probability_precission& infected_chance);
+
+    std::string   _path;
+    std::ifstream _file;
+    std::uint32_t _next_day {}; // The day of the next line of the file
+    std::uint32_t _days {};
+    std::uint32_t _intervals {};
+    std::uint32_t _total {};
+    std::string   _line; // Line buffer, reused across days
+};
+
 /// @brief Hospital entry point, periodically generates
-class hospital_entry {
+class hospital_entry : public checkpoint_participant {
 
 public:
     /// @brief Create a hospital entry
@@ -85,10 +186,13 @@ public:
     /// @param clock The simulation clock
     /// @param patient_admissions The patient admission distribution
     /// @param factory The agent factory, for patient creation
-    hospital_entry(coordinates<int>           location,
-                   sti::clock*                clock,
-                   patient_distribution&&     patient_admissions,
-                   agent_factory*             factory);
+    /// @param spool The file where the counters of the finished days are
+    /// written, empty to keep them in memory
+    hospital_entry(coordinates<int>               location,
+                   sti::clock*                    clock,
+                   std::unique_ptr<influx_source> patient_admissions,
+                   agent_factory*                 factory,
+                   std::string                    spool = {});
 
     /// @brief Get the total number of patients that will enter the hospital
     /// @return The number of patients 
@@ -101,23 +205,79 @@ public:
     // SAVE STATISTICS
     ////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Save the stadistics/metrics to a file
-    /// @param filepath The path to the folder where
-    /// @param rank The rank of the process
-    void save(const std::string& folderpath, int rank) const;
+    /// @brief Save the stadistics/metrics, as the entry table
+    /// @param output The writer of the tables
+    void save(const table_writer& output) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the patients generated in each interval
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the patients generated in each interval, and restore the
+    /// entry numbers from them
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
-    coordinates<int>                        _location;
-    const sti::clock*                       _clock;
-    patient_distribution                    _patient_distribution;
+    /// @brief A patient arriving at the door
+    struct arrival {
+        datetime      instant;
+        std::uint32_t interval;
+    };
+
+    coordinates<int>               _location;
+    const sti::clock*              _clock;
+    std::unique_ptr<influx_source> _influx;
+    const std::uint32_t            _interval_length;
+
+    // The day being simulated: its influx, the arrivals in order, the next
+    // one, and the patients generated in each interval
+    std::uint32_t              _day {};
+    std::vector<std::uint32_t> _day_influx;
+    probability_precission     _day_infected_chance {};
+    std::vector<arrival>       _arrivals;
+    std::size_t                _next_arrival {};
+    std::vector<std::uint32_t> _day_generated;
+
+    // The patients generated since the start, the entry number of the next
+    // one, the same in any process layout
+    std::uint64_t _entered {};
+
+    // The patients generated in each interval of the finished days, in
+    // memory or in the spool file
     std::vector<std::vector<std::uint32_t>> _generated_patients;
-    const std::uint32_t                     _interval_length;
+    std::string                             _spool_path;
+    std::ofstream                           _spool;
 
     sti::agent_factory* _agent_factory;
 
+    /// @brief Read the influx of a day and compute the instants its patients arrive
+    /// @details The patients of an interval arrive at a constant rate from
+    /// its start, the rate being the length of the interval divided by the
+    /// number of patients, rounded up
+    /// @param day The day
+    void schedule_arrivals(std::uint32_t day);
+
+    /// @brief Record the counters of the current day and schedule the next ones
+    /// @param day The day of the current instant
+    void advance_to(std::uint32_t day);
+
+    /// @brief Store the patients generated in a finished day
+    /// @param generated The patients generated in each interval
+    void record_day(const std::vector<std::uint32_t>& generated);
+
+    /// @brief Get the patients generated in each interval of the days reached
+    /// @return The finished days, and the current one if any
+    std::vector<std::vector<std::uint32_t>> generated_patients() const;
+
     /// @brief Ask how many patients are waiting at the door, upon call the counter is cleared
-    /// @details Calculate how many patients must be created according to the
-    ///          provided distribution. The function assumes the caller is going to create
+    /// @details Take the arrivals of the current interval up to now from the
+    ///          schedule. The arrivals of an interval without ticks are
+    ///          skipped. The function assumes the caller is going to create
     ///          those agents, the internal counter of created agents is increased in N.
     /// @return The number of patients waiting admission
     std::uint64_t patients_waiting();
@@ -128,4 +288,8 @@ private:
 /// @details File format is described in the documentation
 patient_distribution load_patient_distribution(const boost::json::object& json);
 
+/// @brief Load the patient distribution curve from a compiled plan
+/// @param plan The compiled plan containing the influx
+patient_distribution load_patient_distribution(const compiled_plan& plan);
+
 } // namespace sti
\ No newline at end of file
@@ -0,0 +1,144 @@
+/// @file epidemic_series.cpp
+/// @brief Per tick counters of the hospital, reduced across the processes
+#include "epidemic_series.hpp"
+
+#include <algorithm>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <functional>
+
+#include "patient.hpp"
+#include "patient_fsm.hpp"
+#include "triage.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the series, the process 0 creates the file
+/// @details The infection sources are the symbols already interned, see
+/// symbol_table, the same in all the processes
+/// @param communicator The processes of the simulation
+/// @param folderpath The output folder
+/// @param specialties The specialties of the doctors, by specialty id
+/// @param interval The ticks between the reductions
+sti::epidemic_series::epidemic_series(boost::mpi::communicator*       communicator,
+                                      const std::string&              folderpath,
+                                      const std::vector<std::string>& specialties,
+                                      std::uint32_t                   interval)
+    : _communicator { communicator }
+    , _interval { interval == 0 ? default_interval : interval }
+    , _infections { patient_fsm::states }
+    , _chairs { _infections + 1 + symbol_table::instance().size() }
+    , _icu { _chairs + 1 }
+    , _waiting { _icu + 1 }
+    , _columns { _waiting + specialties.size() }
+    , _tally { symbol_table::instance().size() }
+    , _row(_columns)
+{
+    _rows.reserve(_interval * _columns);
+    _ticks.reserve(_interval);
+    if (_communicator->rank() != 0) return;
+
+    _file.open(folderpath + "/epidemic_series.csv");
+    _file << "tick";
+    for (auto s = std::size_t { 0 }; s < patient_fsm::states; ++s) {
+        _file << ",state." << patient_fsm::state_name(static_cast<patient_fsm::STATE>(s));
+    }
+    _file << ",infected_by.human";
+    for (auto s = symbol { 0 }; s < _tally.symbols(); ++s) _file << ",infected_by." << symbol_table::instance().name(s);
+    _file << ",chairs_occupied,icu_beds_in_use";
+    for (const auto& specialty : specialties) _file << ",waiting." << specialty;
+    _file << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the counters of the new infections, see infection_factory::count_infections()
+sti::infection_tally* sti::epidemic_series::infections()
+{
+    return &_tally;
+}
+
+/// @brief Count a local patient in the current tick
+/// @param patient The patient
+void sti::epidemic_series::add_patient(const patient_agent& patient)
+{
+    const auto state = patient.current_state();
+    ++_row[static_cast<std::size_t>(state)];
+
+    // The patients waiting in the queue of a doctor
+    if (state != patient_fsm::STATE::WAIT_FOR_DOCTOR || !triage::holds_doctor_diagnosis(patient.diagnosis())) return;
+    const auto specialty = boost::get<triage::doctor_diagnosis>(patient.diagnosis()).doctor_assigned;
+    if (_waiting + specialty < _columns) ++_row[_waiting + specialty];
+}
+
+/// @brief Set the agents on the chairs of this process in the current tick
+/// @param agents The number of agents
+void sti::epidemic_series::chairs_occupied(std::uint32_t agents)
+{
+    _row[_chairs] = agents;
+}
+
+/// @brief Set the beds in use in the current tick, only the real ICU
+/// @param beds The number of beds
+void sti::epidemic_series::icu_beds_in_use(std::uint32_t beds)
+{
+    _row[_icu] = beds;
+}
+
+/// @brief Finish the row of a tick, collective every interval ticks
+/// @param tick The tick
+void sti::epidemic_series::end_tick(std::uint32_t tick)
+{
+    _row[_infections] = static_cast<std::int64_t>(_tally.humans());
+    for (auto s = symbol { 0 }; s < _tally.symbols(); ++s) {
+        _row[_infections + 1 + s] = static_cast<std::int64_t>(_tally.by_symbol(s));
+    }
+    _tally.reset();
+
+    _rows.insert(_rows.end(), _row.begin(), _row.end());
+    _ticks.push_back(tick);
+    std::fill(_row.begin(), _row.end(), 0);
+
+    if (_ticks.size() >= _interval) flush();
+}
+
+/// @brief Reduce and write the rows not written yet, collective
+void sti::epidemic_series::close()
+{
+    flush();
+    if (_file.is_open()) _file.close();
+}
+
+/// @brief Get the heap bytes of the buffered rows
+std::size_t sti::epidemic_series::memory_bytes() const
+{
+    return (_row.capacity() + _rows.capacity()) * sizeof(std::int64_t) + _ticks.capacity() * sizeof(std::uint32_t)
+         + _tally.symbols() * sizeof(std::uint64_t);
+}
+
+/// @brief Sum the buffered rows in the process 0 and write them, collective
+void sti::epidemic_series::flush()
+{
+    // All the processes run the same ticks, so they buffer the same rows
+    if (_ticks.empty()) return;
+
+    constexpr auto root = 0;
+    auto           sum  = std::vector<std::int64_t>(_rows.size());
+    boost::mpi::reduce(*_communicator, _rows.data(), static_cast<int>(_rows.size()), sum.data(), std::plus<std::int64_t> {}, root);
+
+    if (_communicator->rank() == root) {
+        for (auto t = std::size_t { 0 }; t < _ticks.size(); ++t) {
+            _file << _ticks[t];
+            for (auto c = std::size_t { 0 }; c < _columns; ++c) _file << "," << sum[t * _columns + c];
+            _file << "\n";
+        }
+        _file.flush();
+    }
+
+    _rows.clear();
+    _ticks.clear();
+}
@@ -0,0 +1,111 @@
+/// @file epidemic_series.hpp
+/// @brief Per tick counters of the hospital, reduced across the processes
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "infection_logic/infection_tally.hpp"
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace sti {
+class patient_agent;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Time series of the epidemic, aggregated while the simulation runs
+/// @details Each process counts every tick its local patients in each state
+/// of the FSM, the new infections by the kind of source (other humans, each
+/// object type and the ICU environment), the agents on its chairs, the beds
+/// in use of the real ICU and the patients waiting for each specialty. Every
+/// interval ticks the buffered rows of all the processes are summed in the
+/// process 0 with a single reduction, and appended to
+/// epidemic_series.csv in the output folder, one row per tick:
+///
+///     tick,state.ENTRY,...,infected_by.human,infected_by.chair,...,
+///     chairs_occupied,icu_beds_in_use,waiting.<specialty>,...
+///
+/// The counters are cheap enough to be taken every tick, and the usual
+/// analyses don't need the per agent outputs anymore.
+class epidemic_series {
+
+public:
+    constexpr static auto default_interval = std::uint32_t { 100 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the series, the process 0 creates the file
+    /// @details The infection sources are the symbols already interned, see
+    /// symbol_table, the same in all the processes
+    /// @param communicator The processes of the simulation
+    /// @param folderpath The output folder
+    /// @param specialties The specialties of the doctors, by specialty id
+    /// @param interval The ticks between the reductions
+    epidemic_series(boost::mpi::communicator*       communicator,
+                    const std::string&              folderpath,
+                    const std::vector<std::string>& specialties,
+                    std::uint32_t                   interval);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the counters of the new infections, see infection_factory::count_infections()
+    infection_tally* infections();
+
+    /// @brief Count a local patient in the current tick
+    /// @param patient The patient
+    void add_patient(const patient_agent& patient);
+
+    /// @brief Set the agents on the chairs of this process in the current tick
+    /// @param agents The number of agents
+    void chairs_occupied(std::uint32_t agents);
+
+    /// @brief Set the beds in use in the current tick, only the real ICU
+    /// @param beds The number of beds
+    void icu_beds_in_use(std::uint32_t beds);
+
+    /// @brief Finish the row of a tick, collective every interval ticks
+    /// @param tick The tick
+    void end_tick(std::uint32_t tick);
+
+    /// @brief Reduce and write the rows not written yet, collective
+    void close();
+
+    /// @brief Get the heap bytes of the buffered rows
+    std::size_t memory_bytes() const;
+
+private:
+    /// @brief Sum the buffered rows in the process 0 and write them, collective
+    void flush();
+
+    boost::mpi::communicator* _communicator;
+    std::uint32_t             _interval;
+    std::ofstream             _file; // Only in the process 0
+
+    // Offsets of the groups of columns in a row
+    std::size_t _infections;
+    std::size_t _chairs;
+    std::size_t _icu;
+    std::size_t _waiting;
+    std::size_t _columns;
+
+    infection_tally            _tally;
+    std::vector<std::int64_t>  _row;   // Of the current tick
+    std::vector<std::int64_t>  _rows;  // Buffered until the next reduction
+    std::vector<std::uint32_t> _ticks; // Of the buffered rows
+}; // class epidemic_series
+
+} // namespace sti
@@ -1,6 +1,8 @@
 #include "exit.hpp"
 
 #include <boost/json.hpp>
+#include <boost/serialization/string.hpp>
+#include <cstddef>
 #include <fstream>
 #include <repast_hpc/AgentId.h>
 #include <ostream>
@@ -9,14 +11,20 @@
 #include <utility>
 #include <vector>
 
-#include "entry.hpp"
 #include "contagious_agent.hpp"
 #include "hospital_plan.hpp"
+#include "output_files.hpp"
+#include "record_stream.hpp"
 #include "space_wrapper.hpp"
 
 /// @brief Pointer to implementation struct
 struct sti::hospital_exit::impl {
-    boost::json::array agent_output_data;
+    explicit impl(const std::string& path)
+        : agent_output_data { path }
+    {
+    }
+
+    json_record_stream agent_output_data;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -28,20 +36,28 @@ struct sti::hospital_exit::impl {
 /// @param space Space wrapper
 /// @param clk The world clock
 /// @param location The tile the exit is located
-/// @param entry The hospital entry, to determine how many patients will enter
+/// @param folderpath The output folder, the agents are saved as they leave
+/// @param rank The rank of the process
 sti::hospital_exit::hospital_exit(repast_context_ptr    context,
                                   space_ptr             space,
                                   clock_ptr             clk,
                                   sti::coordinates<int> location,
-                                  const hospital_entry& entry)
+                                  const std::string&    folderpath,
+                                  int                   rank)
 
     : _context { context }
     , _space { space }
     , _clock { clk }
     , _location { location }
-    , _pimpl { std::make_unique<sti::hospital_exit::impl>() }
+    , _pimpl { [&]() {
+        auto os = std::ostringstream {};
+        os << folderpath
+           << "/exit.p"
+           << rank
+           << ".json";
+        return std::make_unique<sti::hospital_exit::impl>(os.str());
+    }() }
 {
-    _pimpl->agent_output_data.reserve(entry.total_patients());
 }
 
 sti::hospital_exit::~hospital_exit() = default;
@@ -60,7 +76,7 @@ void sti::hospital_exit::tick()
     for (const auto& agent : agents) {
         auto data         = agent->stats();
         data["exit_time"] = _clock->now().seconds_since_epoch();
-        _pimpl->agent_output_data.push_back(data);
+        _pimpl->agent_output_data.push(data);
         _space->remove_agent(agent);
         _context->removeAgent(agent);
     }
@@ -70,18 +86,41 @@ void sti::hospital_exit::tick()
 // SAVE STATISTICS
 ////////////////////////////////////////////////////////////////////////////
 
-/// @brief Save the stadistics/metrics to a file
-/// @param filepath The path to the folder where
-/// @param rank The rank of the process
-void sti::hospital_exit::save(const std::string& folderpath, int rank) const
+/// @brief Finish the file of the agents that left
+/// @details The agents are written as they leave, only the last ones are
+/// still in memory
+/// @param output The result files, the file is added to them
+void sti::hospital_exit::save(output_files& output)
+{
+    _pimpl->agent_output_data.close();
+    output.adopt("exit", "json");
+}
+
+/// @brief Get the heap bytes of the buffers of the agents file
+std::size_t sti::hospital_exit::memory_bytes() const
 {
-    auto os = std::ostringstream {};
-    os << folderpath
-       << "/exit.p"
-       << rank
-       << ".json";
+    return _pimpl->agent_output_data.memory_bytes();
+}
 
-    auto file = std::ofstream { os.str() };
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
 
-    file << _pimpl->agent_output_data;
+/// @brief Write the agents that left so far
+/// @param ar The archive of the checkpoint
+void sti::hospital_exit::save_state(oarchive& ar) const
+{
+    ar << _pimpl->agent_output_data.records();
+    ar << _pimpl->agent_output_data.size();
+}
+
+/// @brief Continue the file of the agents that left with the saved ones
+/// @param ar The archive of the checkpoint
+void sti::hospital_exit::load_state(iarchive& ar)
+{
+    auto records = std::string {};
+    auto count   = std::size_t {};
+    ar >> records;
+    ar >> count;
+    _pimpl->agent_output_data.resume(records, count);
 }
@@ -3,8 +3,11 @@
 #pragma once
 
 #include <boost/json/object.hpp>
+#include <cstddef>
 #include <memory>
+#include <string>
 
+#include "checkpoint.hpp"
 #include "hospital_plan.hpp"
 
 // Fw. declarations
@@ -20,11 +23,12 @@ namespace sti {
 class space_wrapper;
 class contagious_agent;
 class clock;
+class output_files;
 
 /// @brief Hospital exit, in charge of removing agents, and keeping several stats
 /// @details The exit has access to the repast context and spaces, it will
 ///          remove any agent that falls in the same tile, so be careful.
-class hospital_exit {
+class hospital_exit : public checkpoint_participant {
 
 public:
     using repast_context     = repast::SharedContext<contagious_agent>;
@@ -41,12 +45,14 @@ public:
     /// @param space Space wrapper
     /// @param clk The world clock
     /// @param location The tile the exit is located
-    /// @param entry The hospital entry, to determine how many patients will enter
+    /// @param folderpath The output folder, the agents are saved as they leave
+    /// @param rank The rank of the process
     hospital_exit(repast_context_ptr    context,
                   space_ptr             space,
                   clock_ptr             clk,
                   sti::coordinates<int> location,
-                  const hospital_entry& entry);
+                  const std::string&    folderpath,
+                  int                   rank);
 
     hospital_exit(const hospital_exit&) = delete;
     hospital_exit& operator=(const hospital_exit&) = delete;
@@ -67,10 +73,26 @@ public:
     // SAVE STATISTICS
     ////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Save the stadistics/metrics to a file
-    /// @param filepath The path to the folder where
-    /// @param rank The rank of the process
-    void save(const std::string& folderpath, int rank) const;
+    /// @brief Finish the file of the agents that left
+    /// @details The agents are written as they leave, only the last ones are
+    /// still in memory
+    /// @param output The result files, the file is added to them
+    void save(output_files& output);
+
+    /// @brief Get the heap bytes of the buffers of the agents file
+    std::size_t memory_bytes() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the agents that left so far
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Continue the file of the agents that left with the saved ones
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     repast_context_ptr    _context;
@@ -0,0 +1,98 @@
+/// @file hardware_counters.cpp
+/// @brief Hardware performance counters of the process, read with perf_event_open
+#include "hardware_counters.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+/// @brief The perf_event config of each counter, in the order of the enum
+constexpr auto configs = std::array<std::uint64_t, sti::hardware_counters::count> {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+/// @brief Open a hardware counter of the calling thread
+/// @param config The counter
+/// @param group The leader of the group, or -1 to open the leader
+/// @return The file descriptor, or -1 on error
+int open_counter(std::uint64_t config, int group)
+{
+    auto attr           = perf_event_attr {};
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // The leader starts disabled, the whole group is enabled at once
+    if (group < 0) attr.disabled = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Open and start the counters
+/// @param enabled If false no counter is opened
+sti::hardware_counters::hardware_counters(bool enabled)
+{
+    _fds.fill(-1);
+    if (!enabled) return;
+
+    _fds[cycles] = open_counter(configs[cycles], -1);
+    if (_fds[cycles] < 0) return;
+
+    // The rest are optional, a machine may lack some of them
+    for (auto c = std::size_t { 0 }; c < count; ++c) {
+        if (c != cycles) _fds[c] = open_counter(configs[c], _fds[cycles]);
+        if (_fds[c] >= 0) _order[_opened++] = static_cast<counter>(c);
+    }
+
+    ioctl(_fds[cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+sti::hardware_counters::~hardware_counters()
+{
+    for (const auto fd : _fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Read the counters since they were opened
+/// @details The values are scaled if the kernel multiplexed the group with
+/// other events
+/// @return The values, zeros if not available
+sti::hardware_counters::values sti::hardware_counters::read() const
+{
+    auto out = values {};
+    if (!available()) return out;
+
+    // The group format: the number of counters, the time enabled, the time
+    // running and the value of each counter
+    auto       buffer = std::array<std::uint64_t, 3 + count> {};
+    const auto bytes  = ::read(_fds[cycles], buffer.data(), sizeof(buffer));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) return out;
+
+    const auto enabled = buffer[1];
+    const auto running = buffer[2];
+    const auto scale   = running > 0 && running < enabled ? static_cast<double>(enabled) / static_cast<double>(running) : 1.0;
+    for (auto i = std::size_t { 0 }; i < _opened && i < buffer[0]; ++i) {
+        out[_order[i]] = static_cast<std::uint64_t>(static_cast<double>(buffer[3 + i]) * scale);
+    }
+    return out;
+}
@@ -0,0 +1,73 @@
+/// @file hardware_counters.hpp
+/// @brief Hardware performance counters of the process, read with perf_event_open
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace sti {
+
+/// @brief A group of hardware counters of the calling thread
+/// @details The counters are opened as a single perf_event group, so all of
+/// them count the same instructions and a single read gets them all. Only the
+/// user space is counted, which is allowed with the default
+/// perf_event_paranoid. If the kernel or the machine doesn't provide a
+/// counter it reads 0, if none of them can be opened available() is false.
+/// The threads of the act phase are not counted, only the main one.
+class hardware_counters {
+
+public:
+    /// @brief The counters of the group
+    enum counter : std::size_t {
+        cycles,
+        instructions,
+        cache_misses, // Last level cache
+        branch_misses,
+        count,
+    };
+
+    using values = std::array<std::uint64_t, count>;
+
+    /// @brief The names of the counters, as written in the tables
+    constexpr static auto names = std::array<const char*, count> { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Open and start the counters
+    /// @param enabled If false no counter is opened
+    explicit hardware_counters(bool enabled);
+
+    hardware_counters(const hardware_counters&) = delete;
+    hardware_counters& operator=(const hardware_counters&) = delete;
+
+    hardware_counters(hardware_counters&&) = delete;
+    hardware_counters& operator=(hardware_counters&&) = delete;
+
+    ~hardware_counters();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if the counters are counting
+    bool available() const
+    {
+        return _fds[cycles] >= 0;
+    }
+
+    /// @brief Read the counters since they were opened
+    /// @details The values are scaled if the kernel multiplexed the group with
+    /// other events
+    /// @return The values, zeros if not available
+    values read() const;
+
+private:
+    std::array<int, count>     _fds;
+    std::array<counter, count> _order {}; // Counters of the group, in the order of the reads
+    std::size_t                _opened {};
+}; // class hardware_counters
+
+} // namespace sti
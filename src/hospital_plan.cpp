@@ -4,9 +4,11 @@
 
 #include <boost/json.hpp>
 #include <boost/json/object.hpp>
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "compiled_plan.hpp"
 #include "json_serialization.hpp"
 #include "pathfinder.hpp"
 #include "clock.hpp"
@@ -33,7 +35,7 @@ std::vector<T> load_several(const boost::json::value&  hospital_params,
     for (const auto& element : boost::json::value_to<std::vector<boost::json::value>>(hospital_params.at("building").at(key))) {
         const auto loc = boost::json::value_to<sti::coordinates<int>>(element);
 
-        obstacles.at(static_cast<std::size_t>(loc.x)).at(static_cast<std::size_t>(loc.y)) = is_walkable;
+        obstacles.set(loc, is_walkable, static_cast<sti::plan_grid::tile_type>(e));
         vector.push_back(T { loc });
     }
     return vector;
@@ -52,7 +54,7 @@ T load_one(const boost::json::value&  hospital_params,
 {
     const auto loc = boost::json::value_to<sti::coordinates<int>>((hospital_params.at("building").at(key)));
 
-    obstacles.at(static_cast<std::size_t>(loc.x)).at(static_cast<std::size_t>(loc.y)) = is_walkable;
+    obstacles.set(loc, is_walkable, static_cast<sti::plan_grid::tile_type>(e));
     return T { loc };
 }
 
@@ -86,9 +88,7 @@ std::vector<sti::tiles::triage> sti::tiles::triage::load(const boost::json::obje
 
     for (const auto& element : boost::json::value_to<std::vector<boost::json::value>>(hospital.at("building").at("triages"))) {
         const auto location = boost::json::value_to<sti::coordinates<int>>(element.at("patient_location"));
-        map.at(static_cast<std::size_t>(location.x))
-            .at(static_cast<std::size_t>(location.y))
-            = true;
+        map.set(location, true, static_cast<plan_grid::tile_type>(ENUMS::TRIAGE));
         vector.push_back(triage { location });
     }
     return vector;
@@ -107,12 +107,8 @@ std::vector<sti::tiles::receptionist> sti::tiles::receptionist::load(const boost
     for (const auto& element : boost::json::value_to<std::vector<boost::json::value>>(hospital.at("building").at("receptionists"))) {
         const auto location      = boost::json::value_to<sti::coordinates<int>>(element.at("receptionist_location"));
         const auto patient_chair = boost::json::value_to<sti::coordinates<int>>(element.at("patient_location"));
-        map.at(static_cast<std::size_t>(location.x))
-            .at(static_cast<std::size_t>(location.y))
-            = true;
-        map.at(static_cast<std::size_t>(location.x))
-            .at(static_cast<std::size_t>(location.y))
-            = true;
+        map.set(location, true, static_cast<plan_grid::tile_type>(ENUMS::RECEPTIONIST));
+        map.set(patient_chair, true, static_cast<plan_grid::tile_type>(ENUMS::RECEPTION_PATIENT_CHAIR));
         vector.push_back(receptionist { location, patient_chair });
     }
     return vector;
@@ -127,12 +123,8 @@ std::vector<sti::tiles::doctor> sti::tiles::doctor::load(const boost::json::obje
         const auto location      = boost::json::value_to<sti::coordinates<int>>(element.at("doctor_location"));
         const auto patient_chair = boost::json::value_to<sti::coordinates<int>>(element.at("patient_location"));
         const auto type          = boost::json::value_to<std::string>(element.at("specialty"));
-        map.at(static_cast<std::size_t>(location.x))
-            .at(static_cast<std::size_t>(location.y))
-            = true;
-        map.at(static_cast<std::size_t>(location.x))
-            .at(static_cast<std::size_t>(location.y))
-            = true;
+        map.set(location, true, static_cast<plan_grid::tile_type>(ENUMS::DOCTOR));
+        map.set(patient_chair, true, static_cast<plan_grid::tile_type>(ENUMS::DOCTOR_PATIENT_CHAIR));
         vector.push_back(doctor { location, patient_chair, type });
     }
     return vector;
@@ -149,7 +141,7 @@ sti::hospital_plan::hospital_plan(const boost::json::object& json,
                                   const clock*               clock)
     : _width { boost::json::value_to<int>(json.at("building").at("width")) }
     , _height { boost::json::value_to<int>(json.at("building").at("height")) }
-    , _obstacles(static_cast<std::size_t>(_width), std::vector(static_cast<std::size_t>(_height), true))
+    , _obstacles { static_cast<std::size_t>(_width), static_cast<std::size_t>(_height), true, static_cast<plan_grid::tile_type>(tiles::ENUMS::FLOOR) }
     , _walls { tiles::wall::load(json, _obstacles) }
     , _chairs { tiles::chair::load(json, _obstacles) }
     , _entry { tiles::entry::load(json, _obstacles) }
@@ -160,21 +152,106 @@ sti::hospital_plan::hospital_plan(const boost::json::object& json,
     , _doctors { tiles::doctor::load(json, _obstacles) }
     , _pathfinder { &_obstacles, clock }
 {
+    index_specialties();
+}
+
+/// @brief Load a hospital from a compiled plan
+/// @details The grid is copied as it is in the file, without walking the tiles
+/// @param plan The compiled plan
+/// @param clock The simulation clock
+sti::hospital_plan::hospital_plan(const compiled_plan& plan,
+                                  const clock*         clock)
+    : _width { static_cast<length_t>(plan.width()) }
+    , _height { static_cast<length_t>(plan.height()) }
+    , _obstacles { plan.width(),
+                   plan.height(),
+                   { plan.walkable().begin(), plan.walkable().end() },
+                   { plan.tiles().begin(), plan.tiles().end() } }
+    , _walls { [&]() {
+        auto walls = decltype(_walls) {};
+        for (const auto& e : plan.walls()) walls.push_back({ { e.x, e.y } });
+        return walls;
+    }() }
+    , _chairs { [&]() {
+        auto chairs = decltype(_chairs) {};
+        for (const auto& e : plan.chairs()) chairs.push_back({ { e.x, e.y } });
+        return chairs;
+    }() }
+    , _entry { { plan.entry().x, plan.entry().y } }
+    , _exit { { plan.exit().x, plan.exit().y } }
+    , _triages { [&]() {
+        auto triages = decltype(_triages) {};
+        for (const auto& e : plan.triages()) triages.push_back({ { e.x, e.y } });
+        return triages;
+    }() }
+    , _icu { { plan.icu().x, plan.icu().y } }
+    , _receptionists { [&]() {
+        auto receptionists = decltype(_receptionists) {};
+        for (const auto& e : plan.receptionists()) {
+            receptionists.push_back({ { e.location.x, e.location.y }, { e.patient_chair.x, e.patient_chair.y } });
+        }
+        return receptionists;
+    }() }
+    , _doctors { [&]() {
+        auto doctors = decltype(_doctors) {};
+        for (const auto& e : plan.doctors()) {
+            doctors.push_back({ { e.location.x, e.location.y },
+                                { e.patient_chair.x, e.patient_chair.y },
+                                plan.specialty(e.specialty) });
+        }
+        return doctors;
+    }() }
+    , _pathfinder { &_obstacles, clock }
+{
+    index_specialties();
 }
 
 sti::hospital_plan::~hospital_plan() = default;
 
+/// @brief Give an id to the specialties and the doctor boxes
+void sti::hospital_plan::index_specialties()
+{
+    // Index the specialties by name, so their ids follow the order of the
+    // std::map used before the index
+    for (const auto& doctor : _doctors) _specialties.push_back(doctor.type);
+    std::sort(_specialties.begin(), _specialties.end());
+    _specialties.erase(std::unique(_specialties.begin(), _specialties.end()), _specialties.end());
+
+    _boxes.resize(_specialties.size());
+    _specialty_of_box.reserve(_doctors.size());
+    for (auto box = box_id { 0 }; box < _doctors.size(); ++box) {
+        const auto specialty = find_specialty(_doctors[box].type);
+        _boxes[specialty].push_back(box);
+        _specialty_of_box.push_back(specialty);
+    }
+
+    // The boxes of a specialty are served in the order of their patient chairs
+    for (auto& boxes : _boxes) {
+        std::sort(boxes.begin(), boxes.end(), [&](auto lhs, auto rhs) {
+            return _doctors[lhs].patient_chair.continuous() < _doctors[rhs].patient_chair.continuous();
+        });
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // HOSPITAL // PLAN
 ////////////////////////////////////////////////////////////////////////////
 
 /// @brief A const reference to the obstacles
-/// @return A vector of vectors of bools, True if the coordinate is walkable
+/// @return The plan grid, with the walkability and kind of each tile
 const sti::tiles::obstacles_map& sti::hospital_plan::obstacles() const
 {
     return _obstacles;
 }
 
+/// @brief Get the kind of tile in a given cell
+/// @param cell The cell to query, must be inside the plan
+/// @return The tile enum
+sti::tiles::ENUMS sti::hospital_plan::tile(const coordinates<int>& cell) const
+{
+    return static_cast<tiles::ENUMS>(_obstacles.tile(cell));
+}
+
 /// @brief Get the pathfinder
 /// @return A pointer to the pathfinder
 sti::pathfinder* sti::hospital_plan::get_pathfinder()
@@ -182,6 +259,27 @@ sti::pathfinder* sti::hospital_plan::get_pathfinder()
     return &_pathfinder;
 }
 
+/// @brief Get all the cells a patient can use as destination
+/// @details Chairs, reception and doctor patient chairs, triages, ICU and exit
+/// @return A vector with the discrete locations
+std::vector<sti::coordinates<int>> sti::hospital_plan::destinations() const
+{
+    auto goals = std::vector<coordinates<int>> {};
+    for (const auto& chair : _chairs) goals.push_back(chair.location);
+    for (const auto& receptionist : _receptionists) goals.push_back(receptionist.patient_chair);
+    for (const auto& triage : _triages) goals.push_back(triage.location);
+    for (const auto& doctor : _doctors) goals.push_back(doctor.patient_chair);
+    goals.push_back(_icu.location);
+    goals.push_back(_exit.location);
+    return goals;
+}
+
+/// @brief Precompute the pathfinder flow fields of all the destinations
+void sti::hospital_plan::precompute_paths()
+{
+    _pathfinder.precompute(destinations());
+}
+
 /// @brief Get all the walls
 const std::vector<sti::tiles::wall>& sti::hospital_plan::walls() const
 {
@@ -229,3 +327,38 @@ const std::vector<sti::tiles::doctor>& sti::hospital_plan::doctors() const
 {
     return _doctors;
 }
+
+////////////////////////////////////////////////////////////////////////////
+// HOSPITAL // SPECIALTIES
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the specialties of the doctors, sorted by name
+const std::vector<std::string>& sti::hospital_plan::specialties() const
+{
+    return _specialties;
+}
+
+/// @brief Get the id of a specialty
+/// @throws unknown_specialty If no doctor has the specialty
+/// @param name The name of the specialty
+sti::hospital_plan::specialty_id sti::hospital_plan::find_specialty(const std::string& name) const
+{
+    const auto it = std::lower_bound(_specialties.begin(), _specialties.end(), name);
+    if (it == _specialties.end() || *it != name) throw unknown_specialty {};
+    return static_cast<specialty_id>(it - _specialties.begin());
+}
+
+/// @brief Get the doctor boxes of a specialty, sorted by patient chair
+/// @param specialty The specialty
+/// @return The ids of the boxes, indexes in doctors()
+const std::vector<sti::hospital_plan::box_id>& sti::hospital_plan::boxes(specialty_id specialty) const
+{
+    return _boxes.at(specialty);
+}
+
+/// @brief Get the specialty of a doctor box
+/// @param box The box
+sti::hospital_plan::specialty_id sti::hospital_plan::specialty(box_id box) const
+{
+    return _specialty_of_box.at(box);
+}
@@ -2,12 +2,16 @@
 /// @brief Hospital abstraction, for accessing all hospital related stuff
 #pragma once
 
+#include <cstdint>
+#include <exception>
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "coordinates.hpp"
 #include "pathfinder.hpp"
+#include "plan_grid.hpp"
 #include "reception.hpp"
 
 // Fw. declarations
@@ -29,13 +33,14 @@ class hospital_entry;
 class hospital_exit;
 class hospital_plan;
 class clock;
+class compiled_plan;
 } // namespace sti
 
 namespace sti {
 
 namespace tiles {
 
-    enum class ENUMS {
+    enum class ENUMS : plan_grid::tile_type {
         FLOOR,
         WALL,
         CHAIR,
@@ -49,7 +54,7 @@ namespace tiles {
         DOCTOR_PATIENT_CHAIR
     };
 
-    using obstacles_map = std::vector<std::vector<bool>>;
+    using obstacles_map = plan_grid;
 
     /// @brief Wall tile
     struct wall {
@@ -144,11 +149,25 @@ namespace tiles {
 
 } // namespace tiles
 
+/// @brief Exception: a specialty without doctors in the hospital plan
+struct unknown_specialty : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The specialty has no doctors in the hospital plan";
+    }
+};
+
 /// @brief Hospital abstaction, provides access to all hospital-related functions
 class hospital_plan {
 public:
     using length_t = sti::coordinates<int>::length_t;
 
+    /// @brief Dense id of a specialty, its index in specialties()
+    using specialty_id = std::uint16_t;
+
+    /// @brief Dense id of a doctor box, its index in doctors()
+    using box_id = std::uint32_t;
+
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -158,6 +177,12 @@ public:
     /// @param clock The simulation clock
     hospital_plan(const boost::json::object& json, const clock* clock);
 
+    /// @brief Load a hospital from a compiled plan
+    /// @details The grid is copied as it is in the file, without walking the tiles
+    /// @param plan The compiled plan
+    /// @param clock The simulation clock
+    hospital_plan(const compiled_plan& plan, const clock* clock);
+
     hospital_plan(const hospital_plan&) = delete;
     hospital_plan& operator=(const hospital_plan&) = delete;
 
@@ -183,13 +208,26 @@ public:
     }
 
     /// @brief A const reference to the obstacles
-    /// @return A vector of vectors of bools, True if the coordinate is walkable
+    /// @return The plan grid, with the walkability and kind of each tile
     const tiles::obstacles_map& obstacles() const;
 
+    /// @brief Get the kind of tile in a given cell
+    /// @param cell The cell to query, must be inside the plan
+    /// @return The tile enum
+    tiles::ENUMS tile(const coordinates<int>& cell) const;
+
     /// @brief Get the pathfinder
     /// @return A pointer to the pathfinder
     pathfinder* get_pathfinder();
 
+    /// @brief Get all the cells a patient can use as destination
+    /// @details Chairs, reception and doctor patient chairs, triages, ICU and exit
+    /// @return A vector with the discrete locations
+    std::vector<coordinates<int>> destinations() const;
+
+    /// @brief Precompute the pathfinder flow fields of all the destinations
+    void precompute_paths();
+
     /// @brief Get all the walls
     const std::vector<tiles::wall>& walls() const;
 
@@ -214,6 +252,27 @@ public:
     /// @brief Get all the doctors
     const std::vector<tiles::doctor>& doctors() const;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // HOSPITAL // SPECIALTIES
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the specialties of the doctors, sorted by name
+    const std::vector<std::string>& specialties() const;
+
+    /// @brief Get the id of a specialty
+    /// @throws unknown_specialty If no doctor has the specialty
+    /// @param name The name of the specialty
+    specialty_id find_specialty(const std::string& name) const;
+
+    /// @brief Get the doctor boxes of a specialty, sorted by patient chair
+    /// @param specialty The specialty
+    /// @return The ids of the boxes, indexes in doctors()
+    const std::vector<box_id>& boxes(specialty_id specialty) const;
+
+    /// @brief Get the specialty of a doctor box
+    /// @param box The box
+    specialty_id specialty(box_id box) const;
+
 private:
     length_t _width;
     length_t _height;
@@ -229,7 +288,14 @@ private:
     std::vector<tiles::receptionist> _receptionists;
     std::vector<tiles::doctor>       _doctors;
 
+    std::vector<std::string>         _specialties;
+    std::vector<std::vector<box_id>> _boxes;           // By specialty
+    std::vector<specialty_id>        _specialty_of_box; // By box
+
     pathfinder _pathfinder;
+
+    /// @brief Give an id to the specialties and the doctor boxes
+    void index_specialties();
 };
 
 } // namespace sti
\ No newline at end of file
@@ -39,6 +39,7 @@ class hospital_plan;
 class clock;
 class space_wrapper;
 class real_icu;
+class shared_beds;
 } // namespace sti
 
 namespace sti {
@@ -63,12 +64,16 @@ public:
     /// @param hospital_plan The hospital plan.
     /// @param space The space_wrapper
     /// @param clock The simulation clock
+    /// @param folderpath The output folder, where the morgue is written
+    /// @param rma_admission Reserve the beds in an RMA window, instead of the manager exchange
     icu(repast::SharedContext<contagious_agent>* context,
         boost::mpi::communicator*                communicator,
         const boost::json::object&               hospital_props,
         const hospital_plan&                     hospital_plan,
         space_wrapper*                           space,
-        clock*                                   clock);
+        clock*                                   clock,
+        const std::string&                       folderpath,
+        bool                                     rma_admission = false);
 
     icu(const icu&) = delete;
     icu& operator=(const icu&) = delete;
@@ -111,6 +116,9 @@ public:
     void save(const std::string& folderpath) const;
 
 private:
+    // The counter of the beds, if shared, outlives the admission using it
+    std::unique_ptr<shared_beds> _shared_beds;
+
     // The wrapper stores an owning pointer to an abstract icu_admission and a
     // raw pointer to the real icu, in case the real_icu is in this process
     real_icu*                      _real_icu;
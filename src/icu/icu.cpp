@@ -1,7 +1,9 @@
 #include "../icu.hpp"
 
 #include <boost/lexical_cast.hpp>
+#include <boost/mpi/collectives.hpp>
 #include <boost/mpi/communicator.hpp>
+#include <boost/mpi/operations.hpp>
 #include <boost/json/object.hpp>
 #include <fstream>
 #include <repast_hpc/Properties.h>
@@ -15,6 +17,7 @@
 #include "../agent_factory.hpp"
 #include "real_icu.hpp"
 #include "proxy_icu.hpp"
+#include "shared_beds.hpp"
 
 ////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
@@ -28,18 +31,23 @@
 /// @param hospital_plan The hospital plan.
 /// @param space The space_wrapper
 /// @param clock The simulation clock
+/// @param folderpath The output folder, where the morgue is written
+/// @param rma_admission Reserve the beds in an RMA window, instead of the manager exchange
 sti::icu::icu(repast::SharedContext<contagious_agent>* context,
               boost::mpi::communicator*                communicator,
               const boost::json::object&               hospital_props,
               const hospital_plan&                     hospital_plan,
               space_wrapper*                           space,
-              clock*                                   clock)
-    : _real_icu { [&]() -> decltype(_real_icu) {
+              clock*                                   clock,
+              const std::string&                       folderpath,
+              bool                                     rma_admission)
+    : _shared_beds {}
+    , _real_icu { [&]() -> decltype(_real_icu) {
         // If the ICU is physically in this process create a real ICU. Ownership
         // is set in the next construct.
 
         if (space->local_dimensions().contains(hospital_plan.icu().location)) {
-            return new real_icu { context, communicator, mpi_tag, space, hospital_props, hospital_plan, clock };
+            return new real_icu { context, communicator, mpi_tag, space, hospital_props, hospital_plan, clock, folderpath };
         }
 
         return nullptr;
@@ -66,6 +74,15 @@ sti::icu::icu(repast::SharedContext<contagious_agent>* context,
         return new proxy_icu { communicator, mpi_tag, real_rank };
     }() }
 {
+    if (!rma_admission) return;
+
+    // The counter lives in the process of the real ICU
+    const auto host     = boost::mpi::all_reduce(*communicator,
+                                                 _real_icu != nullptr ? communicator->rank() : -1,
+                                                 boost::mpi::maximum<int>());
+    const auto capacity = hospital_props.at("parameters").at("icu").at("beds").as_int64();
+    _shared_beds        = std::make_unique<shared_beds>(communicator, host, static_cast<std::uint32_t>(capacity));
+    _icu_admission->share_beds(_shared_beds.get());
 }
 
 sti::icu::~icu() = default;
@@ -8,7 +8,10 @@
 #include <utility>
 #include <vector>
 
+#include "../agent_key.hpp"
+#include "../checkpoint.hpp"
 #include "../clock.hpp"
+#include "../manager_exchange.hpp"
 
 // Fw. declarations
 namespace boost {
@@ -23,7 +26,6 @@ namespace mpi {
 } // namespace boost
 
 namespace repast {
-class AgentId;
 class Properties;
 } // namespace repast
 
@@ -34,6 +36,7 @@ class object_agent;
 class hospital_plan;
 class clock;
 class space_wrapper;
+class shared_beds;
 } // namespace sti
 
 namespace sti {
@@ -41,13 +44,17 @@ namespace sti {
 /// @brief ICU manager
 /// @details Is implemented in two parts, a 'real' icu an P-1 proxys that
 /// synchronize with the real queue once per tick.
-class icu_admission {
+class icu_admission : public exchange_participant
+    , public checkpoint_participant {
 
 public:
+    using exchange_participant::iarchive;
+    using exchange_participant::oarchive;
+
     using precission = double;
 
-    using request_message  = repast::AgentId;
-    using response_message = std::pair<repast::AgentId, bool>;
+    using request_message  = agent_key;
+    using response_message = std::pair<agent_key, bool>;
 
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
@@ -69,18 +76,20 @@ public:
 
     /// @brief Request a bed in the ICU
     /// @param id The ID of the requesting agent
-    virtual void request_bed(const repast::AgentId& id) = 0;
+    virtual void request_bed(const agent_key& id) = 0;
 
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    virtual boost::optional<bool> peek_response(const repast::AgentId& id) const = 0;
+    virtual boost::optional<bool> peek_response(const agent_key& id) const = 0;
 
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    virtual boost::optional<bool> get_response(const repast::AgentId& id) = 0;
+    virtual boost::optional<bool> get_response(const agent_key& id) = 0;
 
-    /// @brief Sync the requests and responses between the processes
-    virtual void sync() = 0;
+    /// @brief Reserve the beds in a counter shared by all the processes
+    /// @details Called once after the construction, with icu.admission = rma
+    /// @param beds The shared counter, outlives the admission
+    virtual void share_beds(shared_beds* beds) = 0;
 
 }; // class icu
 
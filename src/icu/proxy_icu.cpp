@@ -5,9 +5,12 @@
 #include <boost/mpi/communicator.hpp>
 #include <boost/optional.hpp>
 #include <fstream>
-#include <repast_hpc/AgentId.h>
 #include <sstream>
 
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
+#include "shared_beds.hpp"
+
 ////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
 ////////////////////////////////////////////////////////////////////////////
@@ -22,6 +25,7 @@ sti::proxy_icu::proxy_icu(communicator_ptr           communicator,
     : _communicator { communicator }
     , _mpi_base_tag { mpi_tag }
     , _real_rank { real_rank }
+    , _shared_beds { nullptr }
 {
 }
 
@@ -33,62 +37,91 @@ sti::proxy_icu::~proxy_icu() = default;
 
 /// @brief Request a bed in the ICU
 /// @param id The ID of the requesting agent
-void sti::proxy_icu::request_bed(const repast::AgentId& id)
+void sti::proxy_icu::request_bed(const agent_key& id)
 {
+    if (_shared_beds != nullptr) {
+        _pending_responses.put(id, _shared_beds->reserve());
+        return;
+    }
     _pending_requests.push_back(id);
 }
 
 /// @brief Check if the request has been processed
 /// @return If the request was processed by the manager, True if there is a bed, false otherwise
-boost::optional<bool> sti::proxy_icu::peek_response(const repast::AgentId& id) const
+boost::optional<bool> sti::proxy_icu::peek_response(const agent_key& id) const
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.first == id;
-                                 });
-
-    if (it == _pending_responses.end()) {
-        return boost::none;
-    }
-
-    const auto response = *it;
-    return response.second;
+    return _pending_responses.peek(id);
 }
 
 /// @brief Check if the request has been processed
 /// @return If the request was processed by the manager, True if there is a bed, false otherwise
-boost::optional<bool> sti::proxy_icu::get_response(const repast::AgentId& id)
+boost::optional<bool> sti::proxy_icu::get_response(const agent_key& id)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.first == id;
-                                 });
-
-    if (it == _pending_responses.end()) {
-        return boost::none;
-    }
+    return _pending_responses.take(id);
+}
+
+/// @brief Reserve the beds in a counter shared by all the processes
+/// @details The requests are then answered immediately, without exchange
+/// @param beds The shared counter, outlives the admission
+void sti::proxy_icu::share_beds(shared_beds* beds)
+{
+    _shared_beds = beds;
+}
 
-    const auto response = *it;
-    _pending_responses.erase(it);
-    return response.second;
+////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Check if there are bed requests since the last exchange
+/// @param destination The rank of the process
+bool sti::proxy_icu::pending_requests(int destination) const
+{
+    return destination == _real_rank && !_pending_requests.empty();
 }
 
-/// @brief Sync the requests and responses between the processes
-void sti::proxy_icu::sync()
+/// @brief Write the bed requests since the last exchange
+/// @param destination The rank of the process
+/// @param ar The archive of the message to the real ICU
+void sti::proxy_icu::write_requests(int /*unused*/, oarchive& ar)
 {
-    // Send pending requests
-    auto mpi_tag = _mpi_base_tag;
-    _communicator->send(_real_rank, mpi_tag++, _pending_requests);
+    write_wires<agent_id_wire>(ar, _pending_requests);
     _pending_requests.clear();
+}
 
-    // The real ICU is processing the requests...
+/// @brief Read the responses to the requests
+/// @param source The rank of the process
+/// @param ar The archive of the message from the real ICU
+void sti::proxy_icu::read_responses(int /*unused*/, iarchive& ar)
+{
+    auto new_responses = std::vector<response_message> {};
+    read_wires<admission_wire>(ar, new_responses);
+    for (const auto& [id, admitted] : new_responses) {
+        _pending_responses.put(id, admitted);
+    }
+}
 
-    // Receive the responses
-    auto buff = decltype(_pending_responses) {};
-    _communicator->recv(_real_rank, mpi_tag++, buff);
-    _pending_responses.insert(_pending_responses.end(), buff.begin(), buff.end());
+/// @brief Get the heap bytes of the responses and the requests
+std::size_t sti::proxy_icu::memory_bytes() const
+{
+    return _pending_responses.memory_bytes() + memory::bytes(_pending_requests);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the responses and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_icu::save_state(oarchive& ar) const
+{
+    ar << _pending_responses;
+    ar << _pending_requests;
+}
+
+/// @brief Read the responses and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_icu::load_state(iarchive& ar)
+{
+    ar >> _pending_responses;
+    ar >> _pending_requests;
 }
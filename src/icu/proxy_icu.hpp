@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "../coordinates.hpp"
+#include "../response_mailbox.hpp"
 
 // Fw. declarations
 namespace boost {
@@ -66,25 +67,61 @@ public:
 
     /// @brief Request a bed in the ICU
     /// @param id The ID of the requesting agent
-    void request_bed(const repast::AgentId& id) override;
+    void request_bed(const agent_key& id) override;
 
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    boost::optional<bool> peek_response(const repast::AgentId& id) const override;
+    boost::optional<bool> peek_response(const agent_key& id) const override;
     
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    boost::optional<bool> get_response(const repast::AgentId& id) override;
+    boost::optional<bool> get_response(const agent_key& id) override;
 
-    /// @brief Sync the requests and responses between the processes
-    void sync() override;
+    /// @brief Reserve the beds in a counter shared by all the processes
+    /// @details The requests are then answered immediately, without exchange
+    /// @param beds The shared counter, outlives the admission
+    void share_beds(shared_beds* beds) override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are bed requests since the last exchange
+    /// @param destination The rank of the process
+    bool pending_requests(int destination) const override;
+
+    /// @brief Write the bed requests since the last exchange
+    /// @param destination The rank of the process
+    /// @param ar The archive of the message to the real ICU
+    void write_requests(int destination, oarchive& ar) override;
+
+    /// @brief Read the responses to the requests
+    /// @param source The rank of the process
+    /// @param ar The archive of the message from the real ICU
+    void read_responses(int source, iarchive& ar) override;
+
+    /// @brief Get the heap bytes of the responses and the requests
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the responses and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the responses and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator_ptr _communicator;
     int              _mpi_base_tag;
     int              _real_rank;
+    shared_beds*     _shared_beds;
 
-    std::vector<response_message> _pending_responses;
+    response_mailbox<bool>        _pending_responses;
     std::vector<request_message>  _pending_requests;
 };
 
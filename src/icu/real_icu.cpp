@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <boost/json/array.hpp>
+#include <boost/serialization/optional.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/json/object.hpp>
@@ -19,8 +21,14 @@
 #include "../json_serialization.hpp"
 #include "../agent_factory.hpp"
 #include "../clock.hpp"
+#include "../counter_rng.hpp"
 #include "../patient.hpp"
+#include "../record_stream.hpp"
 #include "../hospital_plan.hpp"
+#include "../infection_trace.hpp"
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
+#include "shared_beds.hpp"
 #include "../space_wrapper.hpp"
 
 namespace {
@@ -65,9 +73,17 @@ struct sti::real_icu::statistics {
     };
 
     /// @brief Keeps track of the number of patients currently in the ICU
-    std::vector<std::pair<repast::AgentId, datetime>> agent_admission;
-    std::vector<std::pair<repast::AgentId, datetime>> agent_release;
-    std::vector<std::pair<repast::AgentId, datetime>> rejections;
+    std::vector<std::pair<agent_key, datetime>> agent_admission;
+    std::vector<std::pair<agent_key, datetime>> agent_release;
+    std::vector<std::pair<agent_key, datetime>> rejections;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& agent_admission;
+        ar& agent_release;
+        ar& rejections;
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,8 +91,14 @@ struct sti::real_icu::statistics {
 ////////////////////////////////////////////////////////////////////////////////
 
 /// @brief Pointer to implementation struct
+/// @details The dead patients are written to the file as they arrive
 struct sti::real_icu::morgue {
-    boost::json::array agent_output_data {};
+    json_record_stream agent_output_data;
+
+    morgue(const std::string& path)
+        : agent_output_data { path }
+    {
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -91,14 +113,15 @@ struct sti::real_icu::morgue {
 /// @param hospital_props The hospital properties stored in a JSON object
 /// @param hospital_plan The hospital plan.
 /// @param clock The simulation clock
-/// @param af Agent factory, to construct the beds
+/// @param folderpath The output folder, where the morgue is written
 sti::real_icu::real_icu(repast::SharedContext<contagious_agent>* context,
                         communicator_ptr                         communicator,
                         int                                      mpi_tag,
                         space_wrapper*                           space,
                         const boost::json::object&               hospital_props,
                         const hospital_plan&                     hospital_plan,
-                        clock*                                   clock)
+                        clock*                                   clock,
+                        const std::string&                       folderpath)
     : _context { context }
     , _communicator { communicator }
     , _mpi_base_tag { mpi_tag }
@@ -106,9 +129,17 @@ sti::real_icu::real_icu(repast::SharedContext<contagious_agent>* context,
     , _clock { clock }
     , _icu_location { hospital_plan.icu().location }
     , _reserved_beds { 0 }
+    , _shared_beds { nullptr }
     , _capacity { static_cast<decltype(_capacity)>(hospital_props.at("parameters").at("icu").at("beds").as_int64()) }
     , _environment(hospital_props)
-    , _morgue { std::make_unique<morgue>() }
+    , _morgue { [&]() {
+        auto path = std::ostringstream {};
+        path << folderpath
+             << "/morgue.p"
+             << communicator->rank()
+             << ".json";
+        return std::make_unique<morgue>(path.str());
+    }() }
     , _stats { std::make_unique<statistics>() }
 {
 }
@@ -119,9 +150,18 @@ sti::real_icu::~real_icu() = default;
 /// @param if Infection factory, to construct the beds
 void sti::real_icu::create_beds(infection_factory& infection_factory)
 {
+    // The beds only exist in the process of the real ICU, the index in the
+    // pool is the same with any layout
     for (auto i = 0U; i < _capacity; ++i) {
-        _bed_pool.push_back({ infection_factory.make_object_infection("bed", object_infection::STAGE::CLEAN), nullptr });
+        const auto subject = counter_rng::subject(counter_rng::entity::BED, i);
+        _bed_pool.push_back({ infection_factory.make_object_infection("bed", object_infection::STAGE::CLEAN, subject), nullptr });
     }
+
+    // The pool doesn't change anymore, the beds can be referenced
+    for (auto& [bed, patient] : _bed_pool) {
+        _cleanings.add(&bed);
+    }
+    index_beds();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -130,115 +170,124 @@ void sti::real_icu::create_beds(infection_factory& infection_factory)
 
 /// @brief Check if the request has been processed
 /// @return If the request was processed by the manager, True if there is a bed, false otherwise
-boost::optional<bool> sti::real_icu::peek_response(const repast::AgentId& id) const
+boost::optional<bool> sti::real_icu::peek_response(const agent_key& id) const
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.first == id;
-                                 });
-
-    if (it == _pending_responses.end()) {
-        return boost::none;
-    }
-
-    const auto response = *it;
-    return response.second;
+    return _pending_responses.peek(id);
 }
 
 /// @brief Check if the request has been processed
 /// @return If the request was processed by the manager, True if there is a bed, false otherwise
-boost::optional<bool> sti::real_icu::get_response(const repast::AgentId& id)
+boost::optional<bool> sti::real_icu::get_response(const agent_key& id)
 {
-    // Search the vector of pending responses for the messages with that id
-    const auto it = std::find_if(_pending_responses.begin(),
-                                 _pending_responses.end(),
-                                 [&](const auto& r) {
-                                     return r.first == id;
-                                 });
-
-    if (it == _pending_responses.end()) {
-        return boost::none;
-    }
+    return _pending_responses.take(id);
+}
 
-    const auto response = *it;
-    _pending_responses.erase(it);
-    return response.second;
+/// @brief Reserve the beds in a counter shared by all the processes
+/// @details The proxies reserve their beds in the counter, and the
+/// patients leaving the ICU release them there
+/// @param beds The shared counter, outlives the admission
+void sti::real_icu::share_beds(shared_beds* beds)
+{
+    _shared_beds = beds;
+    _shared_beds->restore(_reserved_beds);
 }
 
-/// @brief Sync the requests and responses between the processes
-void sti::real_icu::sync()
+/// @brief Read the bed requests of a proxy
+/// @param source The rank of the proxy
+/// @param ar The archive of the message from the proxy
+void sti::real_icu::read_requests(int source, iarchive& ar)
 {
-    const auto world_size = _communicator->size();
-    const auto this_rank  = _communicator->rank();
-    auto       mpi_tag    = _mpi_base_tag;
-
-    // Thr incoming requests are actually world_size - 1, but using a map is
-    // more expensive
-    auto incoming_requests = std::vector(static_cast<std::uint64_t>(world_size), std::vector<request_message> {});
-
-    // Receive the new requests
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != this_rank) {
-            _communicator->recv(p, mpi_tag, incoming_requests.at(static_cast<std::uint64_t>(p)));
-        }
-    }
-    mpi_tag++;
-
-    // Process the requests
-    auto outgoing_responses = std::vector(static_cast<std::uint64_t>(world_size), std::vector<response_message> {});
-
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != this_rank) {
-            for (const auto& id : incoming_requests.at(static_cast<std::uint64_t>(p))) {
-                // If the number of reserved beds is less than the total number of beds,
-                // increment the reserved counter and queue the response as true
-                if (_reserved_beds < _bed_pool.size()) {
-                    _reserved_beds += 1;
-                    outgoing_responses.at(static_cast<std::uint64_t>(p)).push_back({ id, true });
-                } else {
-                    outgoing_responses.at(static_cast<std::uint64_t>(p)).push_back({ id, false });
-                }
-            }
-        }
-    }
+    auto& requests = _incoming_requests[source];
+    requests.clear();
+    read_wires<agent_id_wire>(ar, requests);
+}
 
-    // Send the responses
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != this_rank) {
-            _communicator->send(p, mpi_tag, outgoing_responses.at(static_cast<std::uint64_t>(p)));
+/// @brief Reserve the beds for the requests, in rank order
+void sti::real_icu::serve()
+{
+    _outgoing_responses.clear();
+
+    for (const auto& [p, requests] : _incoming_requests) {
+        auto& responses = _outgoing_responses[p];
+        for (const auto& id : requests) {
+            responses.push_back({ id, reserve_bed() });
         }
     }
+    _incoming_requests.clear();
+}
+
+/// @brief Check if a proxy must receive responses
+/// @param destination The rank of the proxy
+bool sti::real_icu::pending_responses(int destination) const
+{
+    const auto it = _outgoing_responses.find(destination);
+    return it != _outgoing_responses.end() && !it->second.empty();
+}
+
+/// @brief Write the responses to the requests of a proxy
+/// @param destination The rank of the proxy
+/// @param ar The archive of the message to the proxy
+void sti::real_icu::write_responses(int destination, oarchive& ar)
+{
+    write_wires<admission_wire>(ar, _outgoing_responses[destination]);
+}
+
+/// @brief Get the heap bytes of the beds, the messages and the morgue buffers
+std::size_t sti::real_icu::memory_bytes() const
+{
+    return memory::bytes(_bed_pool)
+        + memory::bytes(_free_beds)
+        + memory::bytes(_occupied_beds)
+        + memory::bytes(_bed_of)
+        + _cleanings.memory_bytes()
+        + _pending_responses.memory_bytes()
+        + memory::bytes(_incoming_requests)
+        + memory::bytes(_outgoing_responses)
+        + _morgue->agent_output_data.memory_bytes();
 }
 
 /// @brief Execute periodic actions
 void sti::real_icu::tick()
 {
-    // Kill the patients
-    for (auto& [bed, patient] : _bed_pool) {
-        if (patient != nullptr && patient->current_state() == patient_fsm::STATE::AWAITING_DELETION) {
-            kill(patient);
-        }
+    // Kill the patients, in bed order. Killing empties the bed, they are
+    // collected first
+    auto dead = std::vector<patient_agent*> {};
+    for (const auto b : _occupied_beds) {
+        auto* patient = _bed_pool[b].second;
+        if (patient->current_state() == patient_fsm::STATE::AWAITING_DELETION) dead.push_back(patient);
     }
-
-    // Collect stats, count the number of beds that have a patient assigned
-    const auto beds_in_use = std::count_if(_bed_pool.begin(), _bed_pool.end(),
-                                           [&](const auto& pair) {
-                                               return pair.second != nullptr;
-                                           });
+    for (auto* patient : dead) kill(patient);
 
     // Update the number of patients in the infection environment
-    _environment.patients(static_cast<std::uint32_t>(beds_in_use));
-
-    // Run the infection logic
-    for (auto& [bed, patient] : _bed_pool) {
-        if (patient != nullptr) {
-            bed.interact_with(*patient->get_infection_logic());
-            patient->get_infection_logic()->interact_with(bed);
-        }
-        bed.tick();
+    const auto patients = beds_in_use();
+    _environment.patients(patients);
+    _environment.sync(_clock->tick());
+    if (_trace != nullptr) _trace->icu_patients(patients);
+
+    // Run the infection logic, only the occupied beds interact
+    for (const auto b : _occupied_beds) {
+        auto& [bed, patient] = _bed_pool[b];
+        bed.interact_with(*patient->get_infection_logic());
+        patient->get_infection_logic()->interact_with(bed);
+        if (_trace != nullptr) _trace->interaction(bed, patient->getId());
     }
+    _cleanings.tick();
+}
+
+/// @brief Record the patients and the interactions of the beds in an infection trace
+/// @details The beds must be already created, they are declared in the trace
+/// @param trace The trace, outlives the ICU
+void sti::real_icu::record_to(infection_trace* trace)
+{
+    _trace = trace;
+    for (const auto& [bed, patient] : _bed_pool) _trace->declare_object(bed);
+}
+
+/// @brief Set how often the patients are exposed to the ICU environment
+/// @param rate The rate of the exposure
+void sti::real_icu::environment_rate(const tick_rate& rate)
+{
+    _environment.rate(rate);
 }
 
 /// @brief Save the ICU stats into a file
@@ -291,14 +340,72 @@ void sti::real_icu::save(const std::string& folderpath) const
 
     beds_file << data;
 
-    auto morgue = std::ostringstream {};
-    morgue << folderpath
-           << "/morgue.p"
-           << _communicator->rank()
-           << ".json";
-    auto morgue_file = std::ofstream { morgue.str() };
+    _morgue->agent_output_data.close();
+}
 
-    morgue_file << _morgue->agent_output_data;
+/// @brief Get the number of beds with a patient
+std::uint32_t sti::real_icu::beds_in_use() const
+{
+    return static_cast<std::uint32_t>(_occupied_beds.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the beds, the patients in them, the statistics and the morgue
+/// @param ar The archive of the checkpoint
+void sti::real_icu::save_state(oarchive& ar) const
+{
+    ar << (_shared_beds != nullptr ? _shared_beds->reserved() : _reserved_beds);
+    ar << _bed_pool.size();
+    for (const auto& [bed, patient] : _bed_pool) {
+        ar << bed;
+        ar << (patient != nullptr ? boost::optional<repast::AgentId> { patient->getId() } : boost::none);
+    }
+    ar << _pending_responses;
+    ar << *_stats;
+    ar << _morgue->agent_output_data.records();
+    ar << _morgue->agent_output_data.size();
+}
+
+/// @brief Read the beds, the patients in them, the statistics and the morgue
+/// @details The patients must be already restored, they are put back in
+/// their beds and in the ICU environment
+/// @throws bad_checkpoint If the beds or the patients are not the same
+/// @param ar The archive of the checkpoint
+void sti::real_icu::load_state(iarchive& ar)
+{
+    ar >> _reserved_beds;
+    if (_shared_beds != nullptr) _shared_beds->restore(_reserved_beds);
+
+    auto beds = std::size_t {};
+    ar >> beds;
+    if (beds != _bed_pool.size()) throw bad_checkpoint {};
+
+    for (auto& [bed, patient] : _bed_pool) {
+        auto id = boost::optional<repast::AgentId> {};
+        ar >> bed;
+        ar >> id;
+
+        patient = nullptr;
+        if (id) {
+            patient = static_cast<patient_agent*>(_context->getAgent(*id));
+            if (patient == nullptr) throw bad_checkpoint {};
+            patient->get_infection_logic()->set_environment(&_environment);
+        }
+    }
+    index_beds();
+    _cleanings.reschedule();
+
+    ar >> _pending_responses;
+    ar >> *_stats;
+
+    auto records = std::string {};
+    auto count   = std::size_t {};
+    ar >> records;
+    ar >> count;
+    _morgue->agent_output_data.resume(records, count);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -311,25 +418,17 @@ void sti::real_icu::save(const std::string& folderpath) const
 void sti::real_icu::insert(sti::patient_agent* patient)
 {
 
-    // Randomly select a bed
-    auto it = [&]() {
-        const auto start = static_cast<std::uint32_t>(repast::Random::instance()->nextDouble() * static_cast<double>(_bed_pool.size()));
-        auto aux_it = _bed_pool.begin() + start;
+    if (_free_beds.empty()) throw no_more_beds {};
 
-        for (auto i = 0U; i < _bed_pool.size(); ++i, ++aux_it) {
-            // If the end is reached, start over
-            if (aux_it == _bed_pool.end()) aux_it = _bed_pool.begin();
-            
-            if (aux_it->second == nullptr) return aux_it;
-        }
-
-        return _bed_pool.end();
-    }();
-
-    if (it == _bed_pool.end()) throw no_more_beds {};
+    // Randomly select a bed, the first free one from a random start, starting
+    // over if the end is reached
+    const auto random = counter_rng::instance().uniform(counter_rng::event::ICU_BED, patient->get_infection_logic()->subject());
+    const auto start  = static_cast<bed_index>(random * static_cast<double>(_bed_pool.size()));
+    auto       it     = _free_beds.lower_bound(start);
+    if (it == _free_beds.end()) it = _free_beds.begin();
 
     // And assign the patient to that bed
-    it->second = patient;
+    occupy(*it, patient);
 
     // Set the icu environment, which infects
     patient->get_infection_logic()->set_environment(&_environment);
@@ -343,18 +442,11 @@ void sti::real_icu::insert(sti::patient_agent* patient)
 /// @param patient_ptr A pointer to the patient to remove
 void sti::real_icu::remove(sti::patient_agent* patient_ptr)
 {
-    auto it = std::find_if(_bed_pool.begin(), _bed_pool.end(),
-                           [&](const auto& pair) {
-                               return pair.second == patient_ptr;
-                           });
-
-    if (it == _bed_pool.end()) throw no_patient_with_that_id {};
-
-    // Patient found, 'remove' it by nulling the pointer
-    it->second = nullptr;
+    // 'Remove' the patient by nulling the pointer of its bed
+    vacate(patient_ptr);
 
     // Decrease the number of beds in use
-    _reserved_beds -= 1;
+    release_bed();
 
     // Remove the icu environment from the patient
     patient_ptr->get_infection_logic()->set_environment(nullptr);
@@ -371,15 +463,11 @@ void sti::real_icu::remove(sti::patient_agent* patient_ptr)
 /// @param patient_ptr A pointer to the patient being removed
 void sti::real_icu::kill(sti::patient_agent* patient_ptr)
 {
-    auto it = std::find_if(_bed_pool.begin(), _bed_pool.end(),
-                           [&](const auto& pair) {
-                               return pair.second == patient_ptr;
-                           });
-
-    if (it == _bed_pool.end()) throw no_patient_with_that_id {};
+    // 'Remove' the patient by nulling the pointer of its bed
+    vacate(patient_ptr);
 
     // Decrease the number of beds in use
-    _reserved_beds -= 1;
+    release_bed();
 
     // Remove the icu environment from the patient
     patient_ptr->get_infection_logic()->set_environment(nullptr);
@@ -389,29 +477,95 @@ void sti::real_icu::kill(sti::patient_agent* patient_ptr)
 
     auto stats         = patient_ptr->stats();
     stats["exit_time"] = _clock->now().seconds_since_epoch();
-    _morgue->agent_output_data.push_back(stats);
+    _morgue->agent_output_data.push(stats);
     _space->remove_agent(patient_ptr);
     _context->removeAgent(patient_ptr);
-
-    // 'remove' it by nulling the pointer
-    it->second = nullptr;
 }
 
 /// @brief Request a bed in the ICU
 /// @param id The ID of the requesting agent
-void sti::real_icu::request_bed(const repast::AgentId& id)
+void sti::real_icu::request_bed(const agent_key& id)
 {
-    // If the number of reserved beds is less than the total number of beds,
-    // increment the reserved counter and queue the response as true
-    if (_reserved_beds < _bed_pool.size()) {
-        _reserved_beds += 1;
-        _pending_responses.push_back({ id, true });
+    // If there is a free bed, reserve it and queue the response as true
+    if (reserve_bed()) {
+        _pending_responses.put(id, true);
     }
 
     // Otherwise the ICU is full, store the rejection and queue the response as
     // false
     else {
         _stats->rejections.push_back({ id, _clock->now() });
-        _pending_responses.push_back({ id, false });
+        _pending_responses.put(id, false);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// REAL_ICU HELPER FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Reserve a bed, in the shared counter if there is one
+/// @return True if there was a free bed
+bool sti::real_icu::reserve_bed()
+{
+    if (_shared_beds != nullptr) return _shared_beds->reserve();
+
+    if (_reserved_beds < _bed_pool.size()) {
+        _reserved_beds += 1;
+        return true;
+    }
+    return false;
+}
+
+/// @brief Release a bed reserved, in the shared counter if there is one
+void sti::real_icu::release_bed()
+{
+    if (_shared_beds != nullptr) {
+        _shared_beds->release();
+        return;
+    }
+    _reserved_beds -= 1;
+}
+
+/// @brief Put a patient in a free bed
+/// @param bed The bed
+/// @param patient The patient
+void sti::real_icu::occupy(bed_index bed, patient_agent* patient)
+{
+    _bed_pool[bed].second = patient;
+    _free_beds.erase(bed);
+    _occupied_beds.insert(bed);
+    _bed_of[patient->getId()] = bed;
+}
+
+/// @brief Take a patient out of its bed
+/// @throws no_patient_with_that_id If the patient is not in a bed
+/// @param patient The patient
+void sti::real_icu::vacate(const patient_agent* patient)
+{
+    const auto it = _bed_of.find(patient->getId());
+    if (it == _bed_of.end() || _bed_pool[it->second].second != patient) throw no_patient_with_that_id {};
+
+    const auto bed        = it->second;
+    _bed_pool[bed].second = nullptr;
+    _occupied_beds.erase(bed);
+    _free_beds.insert(bed);
+    _bed_of.erase(it);
+}
+
+/// @brief Rebuild the free beds, the occupied ones and the beds of the
+/// patients from the pool
+void sti::real_icu::index_beds()
+{
+    _free_beds.clear();
+    _occupied_beds.clear();
+    _bed_of.clear();
+    for (auto b = bed_index { 0 }; b < _bed_pool.size(); ++b) {
+        auto* patient = _bed_pool[b].second;
+        if (patient == nullptr) {
+            _free_beds.insert(_free_beds.end(), b);
+            continue;
+        }
+        _occupied_beds.insert(_occupied_beds.end(), b);
+        _bed_of[patient->getId()] = b;
     }
 }
@@ -7,9 +7,14 @@
 #include <memory>
 #include <cstdint>
 #include <repast_hpc/SharedContext.h>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../coordinates.hpp"
+#include "../response_mailbox.hpp"
+#include "../infection_logic/cleaning_queue.hpp"
 #include "../infection_logic/icu_environment.hpp"
 
 // Fw. declarations
@@ -32,16 +37,23 @@ class clock;
 class space_wrapper;
 class object_infection;
 class contagious_agent;
+class infection_trace;
 } // namespace sti
 
 namespace sti {
 
 /// @brief Real ICU, in charge of the responses
+/// @details The beds are indexed: the free ones and the occupied ones are
+/// kept in sets ordered by bed, and the bed of each patient in a hash, so the
+/// admissions and the releases don't scan the pool, and the tick only visits
+/// the occupied beds. The empty beds only cost their cleanings, in a timer
+/// queue
 class real_icu final : public icu_admission {
 
 public:
     using communicator_ptr = boost::mpi::communicator*;
     using bed_counter_type = std::uint32_t;
+    using bed_index        = std::uint32_t;
 
     /// @brief Collect different statistics
     struct statistics;
@@ -61,13 +73,15 @@ public:
     /// @param hospital_props The hospital properties stored in a JSON object
     /// @param hospital_plan The hospital plan.
     /// @param clock The simulation clock
+    /// @param folderpath The output folder, where the morgue is written
     real_icu(repast::SharedContext<contagious_agent>* context,
              communicator_ptr                         communicator,
              int                                      mpi_tag,
              space_wrapper*                           space,
              const boost::json::object&               hospital_props,
              const hospital_plan&                     hospital_plan,
-             clock*                                   clock);
+             clock*                                   clock,
+             const std::string&                       folderpath);
 
     real_icu(const real_icu&) = delete;
     real_icu& operator=(const real_icu&) = delete;
@@ -87,18 +101,45 @@ public:
 
     /// @brief Request a bed in the ICU
     /// @param id The ID of the requesting agent
-    void request_bed(const repast::AgentId& id) override;
+    void request_bed(const agent_key& id) override;
 
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    boost::optional<bool> peek_response(const repast::AgentId& id) const override;
+    boost::optional<bool> peek_response(const agent_key& id) const override;
 
     /// @brief Check if the request has been processed, if so, return the answer
     /// @return An optional, containing True if there is a bed, false otherwise
-    boost::optional<bool> get_response(const repast::AgentId& id) override;
+    boost::optional<bool> get_response(const agent_key& id) override;
 
-    /// @brief Sync the requests and responses between the processes
-    void sync() override;
+    /// @brief Reserve the beds in a counter shared by all the processes
+    /// @details The proxies reserve their beds in the counter, and the
+    /// patients leaving the ICU release them there
+    /// @param beds The shared counter, outlives the admission
+    void share_beds(shared_beds* beds) override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Read the bed requests of a proxy
+    /// @param source The rank of the proxy
+    /// @param ar The archive of the message from the proxy
+    void read_requests(int source, iarchive& ar) override;
+
+    /// @brief Reserve the beds for the requests, in rank order
+    void serve() override;
+
+    /// @brief Check if a proxy must receive responses
+    /// @param destination The rank of the proxy
+    bool pending_responses(int destination) const override;
+
+    /// @brief Write the responses to the requests of a proxy
+    /// @param destination The rank of the proxy
+    /// @param ar The archive of the message to the proxy
+    void write_responses(int destination, oarchive& ar) override;
+
+    /// @brief Get the heap bytes of the beds, the messages and the morgue buffers
+    std::size_t memory_bytes() const override;
 
     ////////////////////////////////////////////////////////////////////////////
     // PATIENT INSERTION AND REMOVAL
@@ -128,6 +169,15 @@ public:
     /// contract the desease via environment, but not through other patients.
     void tick();
 
+    /// @brief Record the patients and the interactions of the beds in an infection trace
+    /// @details The beds must be already created, they are declared in the trace
+    /// @param trace The trace, outlives the ICU
+    void record_to(infection_trace* trace);
+
+    /// @brief Set how often the patients are exposed to the ICU environment
+    /// @param rate The rate of the exposure
+    void environment_rate(const tick_rate& rate);
+
     ////////////////////////////////////////////////////////////////////////////
     // STATS
     ////////////////////////////////////////////////////////////////////////////
@@ -136,7 +186,46 @@ public:
     /// @param filepath The path to the folder where
     void save(const std::string& folderpath) const;
 
+    /// @brief Get the number of beds with a patient
+    std::uint32_t beds_in_use() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the beds, the patients in them, the statistics and the morgue
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the beds, the patients in them, the statistics and the morgue
+    /// @details The patients must be already restored, they are put back in
+    /// their beds and in the ICU environment
+    /// @throws bad_checkpoint If the beds or the patients are not the same
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
 private:
+    /// @brief Reserve a bed, in the shared counter if there is one
+    /// @return True if there was a free bed
+    bool reserve_bed();
+
+    /// @brief Release a bed reserved, in the shared counter if there is one
+    void release_bed();
+
+    /// @brief Put a patient in a free bed
+    /// @param bed The bed
+    /// @param patient The patient
+    void occupy(bed_index bed, patient_agent* patient);
+
+    /// @brief Take a patient out of its bed
+    /// @throws no_patient_with_that_id If the patient is not in a bed
+    /// @param patient The patient
+    void vacate(const patient_agent* patient);
+
+    /// @brief Rebuild the free beds, the occupied ones and the beds of the
+    /// patients from the pool
+    void index_beds();
+
     repast::SharedContext<contagious_agent>* _context;
     communicator_ptr                         _communicator;
     int                                      _mpi_base_tag;
@@ -146,11 +235,23 @@ private:
     coordinates<int> _icu_location;
 
     bed_counter_type                                         _reserved_beds;
+    shared_beds*                                             _shared_beds;
     bed_counter_type                                         _capacity;
     std::vector<std::pair<object_infection, patient_agent*>> _bed_pool;
+    cleaning_queue                                           _cleanings;
     icu_environment                                          _environment;
+    infection_trace*                                         _trace {};
+
+    // The index of the pool
+    std::set<bed_index>                                       _free_beds;
+    std::set<bed_index>                                       _occupied_beds;
+    std::unordered_map<agent_key, bed_index, agent_key::hash> _bed_of;
+
+    response_mailbox<bool>        _pending_responses;
 
-    std::vector<response_message> _pending_responses;
+    // Requests of the proxies and their responses, by rank
+    std::map<int, std::vector<request_message>>  _incoming_requests;
+    std::map<int, std::vector<response_message>> _outgoing_responses;
 
     std::unique_ptr<morgue> _morgue;
 
@@ -0,0 +1,56 @@
+/// @file icu/shared_beds.cpp
+/// @brief Counter of the reserved ICU beds, shared by all the processes
+#include "shared_beds.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the counter, collective
+/// @param comm The MPI communicator
+/// @param host The rank of the real ICU
+/// @param capacity The number of beds
+sti::shared_beds::shared_beds(boost::mpi::communicator* comm, int host, bed_counter_type capacity)
+    : _capacity { capacity }
+    , _counter { comm, host, 1, 0 }
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Reserve a bed
+/// @return True if there was a free bed
+bool sti::shared_beds::reserve()
+{
+    // Only take a bed if the counter didn't change since it was read, so a
+    // full ICU never goes over its capacity
+    const auto capacity = static_cast<rma_counters::value_type>(_capacity);
+    auto       reserved = _counter.load(0);
+    while (reserved < capacity) {
+        const auto before = _counter.compare_swap(0, reserved, reserved + 1);
+        if (before == reserved) return true;
+        reserved = before;
+    }
+    return false;
+}
+
+/// @brief Release a bed reserved
+void sti::shared_beds::release()
+{
+    _counter.fetch_add(0, -1);
+}
+
+/// @brief Get the number of beds reserved
+sti::shared_beds::bed_counter_type sti::shared_beds::reserved() const
+{
+    return static_cast<bed_counter_type>(_counter.load(0));
+}
+
+/// @brief Replace the number of beds reserved, from a checkpoint
+/// @param reserved The number of beds reserved
+void sti::shared_beds::restore(bed_counter_type reserved)
+{
+    _counter.store(0, static_cast<rma_counters::value_type>(reserved));
+}
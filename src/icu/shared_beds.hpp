@@ -0,0 +1,61 @@
+/// @file icu/shared_beds.hpp
+/// @brief Counter of the reserved ICU beds, shared by all the processes
+#pragma once
+
+#include <cstdint>
+
+#include "../rma_window.hpp"
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace sti {
+
+/// @brief Reserved beds of the ICU, in an MPI RMA window of the real ICU process
+/// @details With icu.admission = rma the proxies reserve the beds themselves,
+/// the answer is known in the same tick and the real ICU doesn't serve them.
+/// The real ICU releases the beds in the same counter. The reservations in a
+/// tick depend on the order the processes reach the window.
+class shared_beds {
+
+public:
+    using bed_counter_type = std::uint32_t;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the counter, collective
+    /// @param comm The MPI communicator
+    /// @param host The rank of the real ICU
+    /// @param capacity The number of beds
+    shared_beds(boost::mpi::communicator* comm, int host, bed_counter_type capacity);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Reserve a bed
+    /// @return True if there was a free bed
+    bool reserve();
+
+    /// @brief Release a bed reserved
+    void release();
+
+    /// @brief Get the number of beds reserved
+    bed_counter_type reserved() const;
+
+    /// @brief Replace the number of beds reserved, from a checkpoint
+    /// @param reserved The number of beds reserved
+    void restore(bed_counter_type reserved);
+
+private:
+    bed_counter_type _capacity;
+    rma_counters     _counter;
+}; // class shared_beds
+
+} // namespace sti
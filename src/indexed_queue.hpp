@@ -0,0 +1,245 @@
+/// @file indexed_queue.hpp
+/// @brief Queues with constant time removal of any element
+#pragma once
+
+#include <boost/serialization/split_member.hpp>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+
+#include "memory_usage.hpp"
+
+namespace sti {
+
+/// @brief FIFO queue of unique elements, indexed by value
+/// @details The elements are stored in a list, and a hash from element to
+/// list node allows finding and removing any element in constant time.
+template <typename T, typename Hash = std::hash<T>>
+class indexed_queue {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add an element at the end, if not already in the queue
+    /// @param value The element
+    void push_back(const T& value)
+    {
+        if (_index.count(value) != 0) return;
+        _index[value] = _list.insert(_list.end(), value);
+    }
+
+    /// @brief Get the first element, the queue must not be empty
+    const T& front() const
+    {
+        return _list.front();
+    }
+
+    /// @brief Remove the first element, the queue must not be empty
+    void pop_front()
+    {
+        _index.erase(_list.front());
+        _list.pop_front();
+    }
+
+    /// @brief Remove an element
+    /// @param value The element
+    /// @return True if the element was in the queue
+    bool erase(const T& value)
+    {
+        const auto it = _index.find(value);
+        if (it == _index.end()) return false;
+
+        _list.erase(it->second);
+        _index.erase(it);
+        return true;
+    }
+
+    /// @brief Check if an element is in the queue
+    bool contains(const T& value) const
+    {
+        return _index.count(value) != 0;
+    }
+
+    /// @brief Check if the queue is empty
+    bool empty() const
+    {
+        return _list.empty();
+    }
+
+    /// @brief Get the number of elements in the queue
+    std::size_t size() const
+    {
+        return _list.size();
+    }
+
+    /// @brief Get the heap bytes of the elements and the index
+    std::size_t memory_bytes() const
+    {
+        return memory::bytes(_list) + memory::bytes(_index);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SERIALIZATION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the elements, in queue order
+    template <typename Archive>
+    void save(Archive& ar, const unsigned int /*unused*/) const
+    {
+        ar << _list.size();
+        for (const auto& value : _list) ar << value;
+    }
+
+    /// @brief Replace the elements by the ones written with save()
+    template <typename Archive>
+    void load(Archive& ar, const unsigned int /*unused*/)
+    {
+        _list.clear();
+        _index.clear();
+
+        auto size = std::size_t {};
+        ar >> size;
+        for (auto i = std::size_t { 0 }; i < size; ++i) {
+            auto value = T {};
+            ar >> value;
+            push_back(value);
+        }
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+private:
+    using list_type = std::list<T>;
+
+    list_type                                                _list;
+    std::unordered_map<T, typename list_type::iterator, Hash> _index;
+}; // class indexed_queue
+
+/// @brief Priority queue of unique elements, indexed by value
+/// @details The elements are ordered by priority, lowest first, and in
+/// insertion order for the same priority. A hash from element to node allows
+/// finding and removing any element in constant time, insertion is
+/// logarithmic.
+template <typename T, typename Priority, typename Hash = std::hash<T>>
+class indexed_priority_queue {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add an element, if not already in the queue
+    /// @param value The element
+    /// @param priority The priority, lower values leave the queue first
+    void push(const T& value, const Priority& priority)
+    {
+        if (_index.count(value) != 0) return;
+
+        // The multimap inserts after the elements with the same priority
+        _index[value] = _ordered.emplace(priority, value);
+    }
+
+    /// @brief Get the element with the lowest priority, the queue must not be empty
+    const T& front() const
+    {
+        return _ordered.begin()->second;
+    }
+
+    /// @brief Get the lowest priority, the queue must not be empty
+    const Priority& front_priority() const
+    {
+        return _ordered.begin()->first;
+    }
+
+    /// @brief Remove the element with the lowest priority, the queue must not be empty
+    void pop_front()
+    {
+        _index.erase(_ordered.begin()->second);
+        _ordered.erase(_ordered.begin());
+    }
+
+    /// @brief Remove an element
+    /// @param value The element
+    /// @return True if the element was in the queue
+    bool erase(const T& value)
+    {
+        const auto it = _index.find(value);
+        if (it == _index.end()) return false;
+
+        _ordered.erase(it->second);
+        _index.erase(it);
+        return true;
+    }
+
+    /// @brief Check if an element is in the queue
+    bool contains(const T& value) const
+    {
+        return _index.count(value) != 0;
+    }
+
+    /// @brief Check if the queue is empty
+    bool empty() const
+    {
+        return _ordered.empty();
+    }
+
+    /// @brief Get the number of elements in the queue
+    std::size_t size() const
+    {
+        return _ordered.size();
+    }
+
+    /// @brief Get the heap bytes of the elements and the index
+    std::size_t memory_bytes() const
+    {
+        return memory::bytes(_ordered) + memory::bytes(_index);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SERIALIZATION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the elements and their priorities, in queue order
+    template <typename Archive>
+    void save(Archive& ar, const unsigned int /*unused*/) const
+    {
+        ar << _ordered.size();
+        for (const auto& [priority, value] : _ordered) {
+            ar << priority;
+            ar << value;
+        }
+    }
+
+    /// @brief Replace the elements by the ones written with save()
+    /// @details Inserted in queue order, the ties keep their order
+    template <typename Archive>
+    void load(Archive& ar, const unsigned int /*unused*/)
+    {
+        _ordered.clear();
+        _index.clear();
+
+        auto size = std::size_t {};
+        ar >> size;
+        for (auto i = std::size_t { 0 }; i < size; ++i) {
+            auto priority = Priority {};
+            auto value    = T {};
+            ar >> priority;
+            ar >> value;
+            push(value, priority);
+        }
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+private:
+    using ordered_type = std::multimap<Priority, T>;
+
+    ordered_type                                                 _ordered;
+    std::unordered_map<T, typename ordered_type::iterator, Hash> _index;
+}; // class indexed_priority_queue
+
+} // namespace sti
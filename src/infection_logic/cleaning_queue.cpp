@@ -0,0 +1,64 @@
+/// @file infection_logic/cleaning_queue.cpp
+/// @brief Timer queue of the object cleanings
+#include "cleaning_queue.hpp"
+
+#include "../memory_usage.hpp"
+#include "object_infection.hpp"
+
+/// @brief Add an object, scheduled at its next cleaning
+/// @param object The object
+void sti::cleaning_queue::add(object_infection* object)
+{
+    _deadlines.push({ object->next_clean(), _added++, object });
+}
+
+/// @brief Clean the objects whose cleaning is due, and schedule the next one
+/// @details Each object is cleaned at most once per tick, in deadline
+/// order, and in insertion order for the same deadline
+void sti::cleaning_queue::tick()
+{
+    // All the objects share the clock, the first one not due ends the search
+    _due.clear();
+    while (!_deadlines.empty() && _deadlines.top().object->cleaning_due()) {
+        _due.push_back(_deadlines.top());
+        _deadlines.pop();
+    }
+
+    // Rescheduled after the search, an object is cleaned once per tick even
+    // if its next cleaning is already due
+    for (auto& e : _due) {
+        e.object->tick();
+        e.deadline = e.object->next_clean();
+        _deadlines.push(e);
+    }
+}
+
+/// @brief Schedule again all the objects, at their next cleaning
+/// @details Needed when the objects are changed outside tick(), e.g.
+/// restored from a checkpoint
+void sti::cleaning_queue::reschedule()
+{
+    auto entries = std::vector<entry> {};
+    while (!_deadlines.empty()) {
+        entries.push_back(_deadlines.top());
+        _deadlines.pop();
+    }
+
+    for (auto& e : entries) {
+        e.deadline = e.object->next_clean();
+        _deadlines.push(e);
+    }
+}
+
+/// @brief Get the number of objects in the queue
+std::size_t sti::cleaning_queue::size() const
+{
+    return _deadlines.size();
+}
+
+/// @brief Get the heap bytes of the queue
+/// @details The heap doesn't expose its capacity, the entries are counted
+std::size_t sti::cleaning_queue::memory_bytes() const
+{
+    return _deadlines.size() * sizeof(entry) + memory::bytes(_due);
+}
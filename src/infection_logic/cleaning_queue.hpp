@@ -0,0 +1,70 @@
+/// @file infection_logic/cleaning_queue.hpp
+/// @brief Timer queue of the object cleanings
+#pragma once
+
+#include <cstddef>
+#include <queue>
+#include <vector>
+
+#include "../clock.hpp"
+
+// Fw. declarations
+namespace sti {
+class object_infection;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Objects ordered by their next cleaning
+/// @details Only the objects whose cleaning is due are visited each tick, the
+/// rest cost nothing. The objects must not move in memory after add().
+class cleaning_queue {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add an object, scheduled at its next cleaning
+    /// @param object The object
+    void add(object_infection* object);
+
+    /// @brief Clean the objects whose cleaning is due, and schedule the next one
+    /// @details Each object is cleaned at most once per tick, in deadline
+    /// order, and in insertion order for the same deadline
+    void tick();
+
+    /// @brief Schedule again all the objects, at their next cleaning
+    /// @details Needed when the objects are changed outside tick(), e.g.
+    /// restored from a checkpoint
+    void reschedule();
+
+    /// @brief Get the number of objects in the queue
+    std::size_t size() const;
+
+    /// @brief Get the heap bytes of the queue
+    std::size_t memory_bytes() const;
+
+private:
+    /// @brief A scheduled cleaning
+    struct entry {
+        datetime          deadline;
+        std::size_t       order;
+        object_infection* object;
+    };
+
+    /// @brief Earliest deadline first
+    struct later {
+        bool operator()(const entry& lho, const entry& rho) const
+        {
+            if (lho.deadline.seconds_since_epoch() != rho.deadline.seconds_since_epoch()) return rho.deadline < lho.deadline;
+            return rho.order < lho.order;
+        }
+    };
+
+    std::priority_queue<entry, std::vector<entry>, later> _deadlines;
+    std::vector<entry>                                    _due;
+    std::size_t                                           _added {};
+}; // class cleaning_queue
+
+} // namespace sti
@@ -0,0 +1,70 @@
+/// @file infection_logic/close_pairs.cpp
+/// @brief Search of the close agents of a spatial index, for the contacts
+#include "close_pairs.hpp"
+
+/// @brief Find the close pairs of agents that can infect in some lane, in the device
+/// @details Each agent of the index is a work item that visits the forward
+/// half of its neighbourhood, as spatial_index::for_each_block(), and keeps
+/// the pairs that can infect in some lane. The pairs are appended with an
+/// atomic counter, if they don't fit the output grows and the search runs
+/// again. Without offloading the loop runs in the host
+/// @param index The agents and their locations
+/// @param susceptible The lanes in which each agent can get infected
+/// @param infectious The lanes in which each agent can infect
+/// @param range The maximum number of cells between the agents, per axis
+/// @param sq_limit The limit of the squared distance
+/// @param pairs Output, grown as needed, its capacity is kept between calls
+/// @return The number of pairs stored in pairs
+std::uint32_t sti::device_close_pairs(const spatial_index&     index,
+                                      const std::uint8_t*      susceptible,
+                                      const std::uint8_t*      infectious,
+                                      int                      range,
+                                      double                   sq_limit,
+                                      std::vector<close_pair>& pairs)
+{
+    const auto  n       = index.size();
+    const auto  width   = index.width();
+    const auto  height  = index.height();
+    const auto* xs      = index.xs();
+    const auto* ys      = index.ys();
+    const auto* offsets = index.offsets();
+
+    if (pairs.size() < n) pairs.resize(n);
+    while (true) {
+        auto* out      = pairs.data();
+        auto  capacity = static_cast<std::uint32_t>(pairs.size());
+        auto  count    = std::uint32_t { 0 };
+
+#pragma omp target teams distribute parallel for map(to : xs[0 : n], ys[0 : n], offsets[0 : width * height + 1], susceptible[0 : n], infectious[0 : n]) \
+    map(from : out[0 : capacity]) map(tofrom : count)
+        for (auto i = std::uint32_t { 0 }; i < n; ++i) {
+            if ((susceptible[i] | infectious[i]) == 0) continue;
+
+            // The index only holds the agents inside the grid
+            const auto x = static_cast<int>(xs[i]);
+            const auto y = static_cast<int>(ys[i]);
+            for (auto rows = 0; rows <= range && y + rows < height; ++rows) {
+                // In its own row, the agents after it in the index
+                const auto row   = static_cast<std::uint32_t>((y + rows) * width);
+                const auto max_x = static_cast<std::uint32_t>(x + range < width ? x + range : width - 1);
+                const auto begin = rows == 0 ? i + 1 : offsets[row + static_cast<std::uint32_t>(x - range > 0 ? x - range : 0)];
+                const auto end   = offsets[row + max_x + 1];
+                for (auto j = begin; j < end; ++j) {
+                    if (((susceptible[i] & infectious[j]) | (susceptible[j] & infectious[i])) == 0) continue;
+
+                    const auto dx = xs[j] - xs[i];
+                    const auto dy = ys[j] - ys[i];
+                    if (dx * dx + dy * dy > sq_limit) continue;
+
+                    auto slot = std::uint32_t {};
+#pragma omp atomic capture
+                    slot = count++;
+                    if (slot < capacity) out[slot] = { i, j };
+                }
+            }
+        }
+
+        if (count <= capacity) return count;
+        pairs.resize(count);
+    }
+}
@@ -0,0 +1,196 @@
+/// @file infection_logic/close_pairs.hpp
+/// @brief Search of the close agents of a spatial index, for the contacts
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../coordinates.hpp"
+#include "../spatial_index.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace sti {
+
+/// @brief Two close agents, by their position in the spatial index
+struct close_pair {
+    std::uint32_t i;
+    std::uint32_t j;
+};
+
+/// @brief Find the agents of a block that are close to a point and flagged
+/// @details The test is d^2 <= sq_limit, evaluated with vector instructions
+/// when the target supports them (AVX2 or NEON), the results are the same as
+/// the scalar version, the lanes use separate multiply and add
+/// @param xs The x coordinates of the block
+/// @param ys The y coordinates of the block
+/// @param flags One byte per agent, only agents with a non-zero flag match
+/// @param n The number of agents in the block
+/// @param x The x coordinate of the point
+/// @param y The y coordinate of the point
+/// @param sq_limit The limit of the squared distance
+/// @param hits Output, offsets inside the block of the matching agents
+/// @return The number of matching agents
+inline std::uint32_t close_and_flagged(const double*       xs,
+                                       const double*       ys,
+                                       const std::uint8_t* flags,
+                                       std::uint32_t       n,
+                                       double              x,
+                                       double              y,
+                                       double              sq_limit,
+                                       std::uint32_t*      hits)
+{
+    auto count = std::uint32_t { 0 };
+    auto k     = std::uint32_t { 0 };
+
+#if defined(__AVX2__)
+    const auto px    = _mm256_set1_pd(x);
+    const auto py    = _mm256_set1_pd(y);
+    const auto limit = _mm256_set1_pd(sq_limit);
+    const auto zero  = _mm256_setzero_si256();
+    for (; k + 4 <= n; k += 4) {
+        const auto dx   = _mm256_sub_pd(_mm256_loadu_pd(xs + k), px);
+        const auto dy   = _mm256_sub_pd(_mm256_loadu_pd(ys + k), py);
+        const auto sq_d = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        const auto near = _mm256_cmp_pd(sq_d, limit, _CMP_LE_OQ);
+
+        // Widen the 4 flag bytes to 64 bit lanes
+        auto packed = std::int32_t {};
+        std::memcpy(&packed, flags + k, sizeof(packed));
+        const auto wide    = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+        const auto flagged = _mm256_castsi256_pd(_mm256_xor_si256(_mm256_cmpeq_epi64(wide, zero),
+                                                                  _mm256_set1_epi64x(-1)));
+
+        auto mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_and_pd(near, flagged)));
+        while (mask != 0) {
+            const auto lane = static_cast<std::uint32_t>(__builtin_ctz(mask));
+            hits[count++]   = k + lane;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const auto px    = vdupq_n_f64(x);
+    const auto py    = vdupq_n_f64(y);
+    const auto limit = vdupq_n_f64(sq_limit);
+    for (; k + 2 <= n; k += 2) {
+        const auto dx   = vsubq_f64(vld1q_f64(xs + k), px);
+        const auto dy   = vsubq_f64(vld1q_f64(ys + k), py);
+        const auto sq_d = vaddq_f64(vmulq_f64(dx, dx), vmulq_f64(dy, dy));
+        const auto near = vcleq_f64(sq_d, limit);
+        if (vgetq_lane_u64(near, 0) != 0 && flags[k] != 0) hits[count++] = k;
+        if (vgetq_lane_u64(near, 1) != 0 && flags[k + 1] != 0) hits[count++] = k + 1;
+    }
+#endif
+
+    // Scalar fallback, and the remainder of the vector loops
+    for (; k < n; ++k) {
+        const auto dx = xs[k] - x;
+        const auto dy = ys[k] - y;
+        if (dx * dx + dy * dy <= sq_limit && flags[k] != 0) hits[count++] = k;
+    }
+    return count;
+}
+
+/// @brief Call a function for each close pair of agents that can infect
+/// @details The pairs are enumerated from spatial_index::for_each_block(),
+/// so each unordered pair appears once, and its blocks tested with
+/// close_and_flagged(). A susceptible agent looks for infectious neighbours
+/// and vice versa, an agent that is both looks for either, so the lanes of
+/// the pair must still be tested by the caller
+/// @param index The agents and their locations
+/// @param susceptible The lanes in which each agent can get infected
+/// @param infectious The lanes in which each agent can infect
+/// @param involved The union of both flags
+/// @param range The maximum number of cells between the agents, per axis
+/// @param sq_limit The limit of the squared distance
+/// @param hits Scratch space, one slot per agent of the index
+/// @param f A callable with signature f(index_type i, index_type j)
+template <typename F>
+void for_each_close_pair(const spatial_index& index,
+                         const std::uint8_t*  susceptible,
+                         const std::uint8_t*  infectious,
+                         const std::uint8_t*  involved,
+                         int                  range,
+                         double               sq_limit,
+                         std::uint32_t*       hits,
+                         F&&                  f)
+{
+    using index_type = spatial_index::index_type;
+    index.for_each_block(range, [&](index_type i, index_type begin, index_type end) {
+        if (susceptible[i] == 0 && infectious[i] == 0) return;
+
+        const auto* partners = involved;
+        if (infectious[i] == 0) partners = infectious;
+        if (susceptible[i] == 0) partners = susceptible;
+
+        const auto count = close_and_flagged(index.xs() + begin,
+                                             index.ys() + begin,
+                                             partners + begin,
+                                             end - begin,
+                                             index.xs()[i],
+                                             index.ys()[i],
+                                             sq_limit,
+                                             hits);
+
+        for (auto h = std::uint32_t { 0 }; h < count; ++h) f(i, begin + hits[h]);
+    });
+}
+
+/// @brief Call a function for each flagged agent close to a point
+/// @details The agents are enumerated from spatial_index::for_each_block_around()
+/// and its blocks tested with close_and_flagged()
+/// @param index The agents and their locations
+/// @param point The point, i.e. a source of another process
+/// @param flags One byte per agent, only agents with a non-zero flag match
+/// @param range The maximum number of cells between the point and the agents, per axis
+/// @param sq_limit The limit of the squared distance
+/// @param hits Scratch space, one slot per agent of the index
+/// @param f A callable with signature f(index_type i)
+template <typename F>
+void for_each_close_to(const spatial_index&        index,
+                       const coordinates<double>&  point,
+                       const std::uint8_t*         flags,
+                       int                         range,
+                       double                      sq_limit,
+                       std::uint32_t*              hits,
+                       F&&                         f)
+{
+    using index_type = spatial_index::index_type;
+    index.for_each_block_around(point.discrete(), range, [&](index_type begin, index_type end) {
+        const auto count = close_and_flagged(index.xs() + begin,
+                                             index.ys() + begin,
+                                             flags + begin,
+                                             end - begin,
+                                             point.x,
+                                             point.y,
+                                             sq_limit,
+                                             hits);
+
+        for (auto h = std::uint32_t { 0 }; h < count; ++h) f(begin + hits[h]);
+    });
+}
+
+/// @brief Find the close pairs of agents that can infect in some lane, in the device
+/// @details Built with STI_OFFLOAD the search runs in the default OpenMP
+/// device, otherwise in the host. The pairs are the same ones as
+/// for_each_close_pair() after testing their lanes, in any order
+/// @param index The agents and their locations
+/// @param susceptible The lanes in which each agent can get infected
+/// @param infectious The lanes in which each agent can infect
+/// @param range The maximum number of cells between the agents, per axis
+/// @param sq_limit The limit of the squared distance
+/// @param pairs Output, grown as needed, its capacity is kept between calls
+/// @return The number of pairs stored in pairs
+std::uint32_t device_close_pairs(const spatial_index&     index,
+                                 const std::uint8_t*      susceptible,
+                                 const std::uint8_t*      infectious,
+                                 int                      range,
+                                 double                   sq_limit,
+                                 std::vector<close_pair>& pairs);
+
+} // namespace sti
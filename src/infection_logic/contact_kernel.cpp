@@ -0,0 +1,208 @@
+/// @file infection_logic/contact_kernel.cpp
+/// @brief Infection between nearby humans, resolved for all the agents at once
+#include "contact_kernel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "../contagious_agent.hpp"
+#include "../counter_rng.hpp"
+#include "../spatial_index.hpp"
+#include "close_pairs.hpp"
+#include "human_infection_cycle.hpp"
+#include "source_exchange.hpp"
+#include "static_registry.hpp"
+
+#if defined(STI_OFFLOAD)
+#include <omp.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a contact kernel
+/// @param rank The rank of this process
+sti::contact_kernel::contact_kernel(int rank)
+    : _rank { rank }
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Also evaluate the infectious humans of the other processes
+/// @param sources The exchange of the sources, replacing the Repast ghosts
+void sti::contact_kernel::use_remote_sources(const source_exchange* sources)
+{
+    _remote = sources;
+}
+
+/// @brief Also evaluate the static agents of the other processes
+/// @param registry The registry of the static agents, replacing their ghosts
+void sti::contact_kernel::use_static_sources(const static_registry* registry)
+{
+    _static = registry;
+}
+
+/// @brief Search the close pairs in the default OpenMP device
+/// @details Ignored if the build has no offloading or there is no device
+/// @param enabled True to use the device
+void sti::contact_kernel::use_device(bool enabled)
+{
+#if defined(STI_OFFLOAD)
+    _device = enabled && omp_get_num_devices() > 0;
+#else
+    static_cast<void>(enabled);
+    _device = false;
+#endif
+}
+
+/// @brief Evaluate all the contacts and infect the humans
+/// @param index The agents and their locations, the space wrapper index
+/// while its snapshot is valid
+void sti::contact_kernel::run(const spatial_index& index)
+{
+    const auto n = index.size();
+    if (n == 0) return;
+
+    // Gather the state of each agent once
+    _cycles.resize(n);
+    _susceptible.resize(n);
+    _infectious.resize(n);
+    _involved.resize(n);
+    for (auto i = spatial_index::index_type { 0 }; i < n; ++i) {
+        auto*      agent = index.agent_at(i);
+        auto*      cycle = agent->get_infection_logic();
+        const auto local = agent->getId().currentRank() == _rank;
+        _cycles[i]       = cycle;
+        _susceptible[i]  = local ? cycle->susceptible_lanes() : 0;
+        _infectious[i]   = cycle->infectious_lanes();
+        _involved[i]     = static_cast<std::uint8_t>(_susceptible[i] | _infectious[i]);
+    }
+
+    // All the humans share the same flyweight, hence the same distance in
+    // each lane. The pairs are searched with the largest one
+    const auto lanes     = _cycles[0]->lanes();
+    auto       distances = std::array<double, human_infection_cycle::max_lanes> {};
+    for (auto lane = std::size_t { 0 }; lane < lanes; ++lane) distances[lane] = _cycles[0]->infect_distance(lane);
+    const auto distance = *std::max_element(distances.begin(), distances.begin() + static_cast<std::ptrdiff_t>(lanes));
+    const auto range    = static_cast<int>(std::ceil(distance));
+
+    // Store the contacts from a source to a receiver, in the lanes in which
+    // the source is infectious and the receiver susceptible
+    const auto add_contacts = [&](std::uint8_t                 lanes_mask,
+                                  spatial_index::index_type    receiver,
+                                  const infection_source&      source,
+                                  double                       sq_distance,
+                                  const human_infection_cycle& probabilities,
+                                  bool                         remote) {
+        auto mask = static_cast<unsigned>(lanes_mask);
+        if (mask == 0) return;
+
+        const auto d = std::sqrt(sq_distance);
+        while (mask != 0) {
+            const auto lane = static_cast<std::size_t>(__builtin_ctz(mask));
+            mask &= mask - 1;
+
+            // The candidates passed the test of the largest distance, the
+            // lanes with a shorter one repeat it with their own
+            if (distances[lane] < distance && sq_distance > distances[lane]) continue;
+
+            // Same tests as space_wrapper::agents_around() and
+            // human_infection_cycle::get_infect_probability()
+            const auto probability = remote ? probabilities.infectious_probability_at(d, lane)
+                                            : probabilities.infect_probability_at(d, lane);
+            if (probability <= 0.0) continue;
+
+            _contacts.push_back({ _cycles[receiver]->subject(),
+                                  source.subject(),
+                                  _cycles[receiver],
+                                  source,
+                                  probability,
+                                  static_cast<std::uint8_t>(lane) });
+        }
+    };
+
+    // Enumerate the pairs, block by block. In a lane a pair can infect in at
+    // most one direction: the receiver must be healthy and the source must
+    // not, so a susceptible agent looks for infectious neighbours and vice
+    // versa. With several lanes an agent can be both, and looks for either
+    _contacts.clear();
+    const auto add_pair = [&](spatial_index::index_type i, spatial_index::index_type j) {
+        const auto [x, y]      = index.location_at(i) - index.location_at(j);
+        const auto sq_distance = x * x + y * y;
+
+        add_contacts(static_cast<std::uint8_t>(_susceptible[i] & _infectious[j]),
+                     i,
+                     _cycles[j]->source(),
+                     sq_distance,
+                     *_cycles[j],
+                     false);
+        add_contacts(static_cast<std::uint8_t>(_susceptible[j] & _infectious[i]),
+                     j,
+                     _cycles[i]->source(),
+                     sq_distance,
+                     *_cycles[i],
+                     false);
+    };
+
+    _hits.resize(n);
+    if (_device) {
+        // The device finds the same pairs in any order, the contacts are
+        // sorted before resolving them
+        const auto pairs = device_close_pairs(index, _susceptible.data(), _infectious.data(), range, distance, _pairs);
+        for (auto p = std::uint32_t { 0 }; p < pairs; ++p) add_pair(_pairs[p].i, _pairs[p].j);
+    }
+    else for_each_close_pair(index, _susceptible.data(), _infectious.data(), _involved.data(), range, distance, _hits.data(), add_pair);
+
+    // The infectious humans of the other processes, with the same tests
+    const auto add_remote = [&](const std::vector<remote_source>& sources) {
+        for (const auto& remote : sources) {
+            for_each_close_to(index, remote.location, _susceptible.data(), range, distance, _hits.data(), [&](spatial_index::index_type receiver) {
+                const auto [x, y] = index.location_at(receiver) - remote.location;
+
+                // All the humans share the parameters of each lane, the
+                // receiver gives them
+                add_contacts(static_cast<std::uint8_t>(_susceptible[receiver] & remote.lanes),
+                             receiver,
+                             infection_source::human(remote.id.id(), remote.id.startingRank(), remote.id.agentType(), remote.subject),
+                             x * x + y * y,
+                             *_cycles[receiver],
+                             true);
+            });
+        }
+    };
+    if (_remote != nullptr) add_remote(_remote->sources());
+    if (_static != nullptr) add_remote(_static->sources());
+
+    // Resolve the contacts in a fixed order, a human stops rolling after the
+    // first infection of each lane. The lanes use the same random numbers.
+    // The order and the numbers only use the stable subjects, so they are
+    // the same with any split of the plan
+    std::sort(_contacts.begin(), _contacts.end(), [](const contact& lo, const contact& ro) {
+        if (lo.receiver_subject != ro.receiver_subject) return lo.receiver_subject < ro.receiver_subject;
+        if (lo.lane != ro.lane) return lo.lane < ro.lane;
+        return lo.source_subject < ro.source_subject;
+    });
+
+    for (auto it = _contacts.begin(); it != _contacts.end();) {
+        const auto receiver     = it->receiver_subject;
+        const auto lane         = it->lane;
+        auto       got_infected = false;
+        for (; it != _contacts.end() && it->receiver_subject == receiver && it->lane == lane; ++it) {
+            if (got_infected) continue;
+
+            // *Roll the dice*, a number per pair of receiver and source
+            const auto random_number = counter_rng::instance().uniform_pair(counter_rng::event::CONTACT,
+                                                                            it->receiver_subject,
+                                                                            it->source_subject);
+            if (random_number < it->probability) {
+                it->receiver->infected(it->source, it->lane);
+                got_infected = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/// @file infection_logic/contact_kernel.hpp
+/// @brief Infection between nearby humans, resolved for all the agents at once
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "close_pairs.hpp"
+#include "infection_cycle.hpp"
+
+// Fw. declarations
+namespace sti {
+class human_infection_cycle;
+class source_exchange;
+class static_registry;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Resolve the infections between nearby humans
+/// @details Each pair of close agents is enumerated once from a spatial
+/// index, the one of the space wrapper in the simulation, and only the direction from the infectious
+/// agent to the susceptible one is evaluated. The candidate infections are
+/// stored in a buffer, sorted by the stable subjects of the humans, and
+/// applied after all the pairs have been visited, so the result does not
+/// depend on the agent iteration order nor on the process layout. Only
+/// the agents local to this process can get infected, the ghosts, or the
+/// sources received from the other processes, act as sources.
+///
+/// The infection lanes of the humans are evaluated in the same pass: the
+/// flags of each agent have one bit per lane, so each pair is enumerated and
+/// its distance computed once, and then tested in all the lanes at once.
+///
+/// When built with OFFLOAD, the search of the close pairs can run on an
+/// accelerator, see use_device(). Only the pairs come back to the host, the
+/// probabilities and the random numbers are evaluated as in the host search,
+/// so the infections are the same.
+class contact_kernel {
+
+public:
+    using precission = infection_cycle::precission;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create a contact kernel
+    /// @param rank The rank of this process
+    explicit contact_kernel(int rank);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Also evaluate the infectious humans of the other processes
+    /// @param sources The exchange of the sources, replacing the Repast ghosts
+    void use_remote_sources(const source_exchange* sources);
+
+    /// @brief Also evaluate the static agents of the other processes
+    /// @param registry The registry of the static agents, replacing their ghosts
+    void use_static_sources(const static_registry* registry);
+
+    /// @brief Search the close pairs in the default OpenMP device
+    /// @details Ignored if the build has no offloading or there is no device
+    /// @param enabled True to use the device
+    void use_device(bool enabled);
+
+    /// @brief Evaluate all the contacts and infect the humans
+    /// @param index The agents and their locations, the space wrapper index
+    /// while its snapshot is valid
+    void run(const spatial_index& index);
+
+private:
+    /// @brief A possible infection, from an infectious human to a susceptible one
+    struct contact {
+        std::uint64_t          receiver_subject;
+        std::uint64_t          source_subject;
+        human_infection_cycle* receiver;
+        infection_source       source;
+        precission             probability;
+        std::uint8_t           lane;
+    };
+
+    int                    _rank;
+    const source_exchange* _remote {};
+    const static_registry* _static {};
+    bool                   _device {};
+
+    // Per agent attributes, indexed as the spatial index, the flags have one
+    // bit per lane
+    std::vector<human_infection_cycle*> _cycles;
+    std::vector<std::uint8_t>           _susceptible;
+    std::vector<std::uint8_t>           _infectious;
+    std::vector<std::uint8_t>           _involved; // Either of them
+
+    std::vector<contact>       _contacts;
+    std::vector<std::uint32_t> _hits;
+    std::vector<close_pair>    _pairs; // The capacity of the device output
+}; // class contact_kernel
+
+} // namespace sti
@@ -43,6 +43,9 @@ public:
     /// determine how an agent got infected
     [[nodiscard]] virtual std::string name() const = 0;
 
+    /// @brief Get the compact identity of the environment
+    [[nodiscard]] virtual infection_source source() const = 0;
+
 }; // class infection_environment
 
 } // namespace sti
\ No newline at end of file
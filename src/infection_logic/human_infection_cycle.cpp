@@ -1,16 +1,21 @@
 #include "human_infection_cycle.hpp"
 
 #include <boost/json.hpp>
-#include <repast_hpc/Random.h>
 #include <repast_hpc/Grid.h>
 #include <repast_hpc/Moore2DGridQuery.h>
 #include <repast_hpc/VN2DGridQuery.h>
 #include <repast_hpc/Point.h>
 #include <sstream>
 
+#include "../agent_wire.hpp"
 #include "../contagious_agent.hpp"
+#include "../counter_rng.hpp"
 #include "environment.hpp"
-#include "../space_wrapper.hpp"
+#include "infection_tally.hpp"
+#include "../agent_locations.hpp"
+#include "object_infection.hpp"
+
+static_assert(sti::human_infection_cycle::max_lanes == sti::infection_wire::max_lanes, "The wire must carry all the lanes");
 
 ////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
@@ -28,6 +33,7 @@ sti::human_infection_cycle::human_infection_cycle(flyweight_ptr fw, environment_
 
 /// @brief Construct a cycle starting in a given state, specifing the time of infection
 /// @param id The id of the agent associated with this patient
+/// @param subject The stable subject of the agent, see counter_rng::entity
 /// @param fw The flyweight containing the shared attributes
 /// @param stage The initial stage
 /// @param mode The "mode"
@@ -35,6 +41,7 @@ sti::human_infection_cycle::human_infection_cycle(flyweight_ptr fw, environment_
 /// @param env The infection environment this human resides in
 sti::human_infection_cycle::human_infection_cycle(flyweight_ptr          fw,
                                                   const repast::AgentId& id,
+                                                  std::uint64_t          subject,
                                                   STAGE                  stage,
                                                   MODE                   mode,
                                                   datetime               infection_time,
@@ -42,11 +49,17 @@ sti::human_infection_cycle::human_infection_cycle(flyweight_ptr          fw,
     : _flyweight { fw }
     , _environment { env }
     , _id { id }
+    , _subject { subject }
     , _stage { stage }
     , _mode { mode }
     , _infection_time { infection_time }
     , _infect_location {}
 {
+    // The extra lanes start in the same state
+    for (auto lane = std::size_t { 1 }; lane < lanes(); ++lane) {
+        _extra_lanes[lane - 1].stage          = stage;
+        _extra_lanes[lane - 1].infection_time = infection_time;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -58,50 +71,128 @@ sti::human_infection_cycle::human_infection_cycle(flyweight_ptr          fw,
 void sti::human_infection_cycle::mode(MODE new_mode)
 {
     _mode = new_mode;
+    ++_version;
+}
+
+/// @brief Get the infection mode
+sti::human_infection_cycle::MODE sti::human_infection_cycle::mode() const
+{
+    return _mode;
+}
+
+/// @brief Get the stage of the primary lane
+sti::human_infection_cycle::STAGE sti::human_infection_cycle::stage() const
+{
+    return _stage;
+}
+
+/// @brief Get the time of infection of the primary lane
+sti::datetime sti::human_infection_cycle::infection_time() const
+{
+    return _infection_time;
+}
+
+/// @brief Get the infection environment this human resides, or nullptr
+const sti::infection_environment* sti::human_infection_cycle::environment() const
+{
+    return _environment;
 }
 
 /// @brief Get an ID/string to identify the object in post-processing
 /// @return A string identifying the object
 std::string sti::human_infection_cycle::get_id() const
 {
-    return "human." + std::to_string(_id.id()) + "." + std::to_string(_id.startingRank()) + "." + std::to_string(_id.agentType());
+    return source().str();
 }
 
-/// @brief Set the infection environment this human resides
-/// @param env_ptr A pointer to the environment
-void sti::human_infection_cycle::set_environment(const infection_environment* env_ptr)
+/// @brief Get the compact identity of the human
+/// @return The source, carrying the agent id and the subject
+sti::infection_source sti::human_infection_cycle::source() const
 {
-    _environment = env_ptr;
+    return infection_source::human(_id.id(), _id.startingRank(), _id.agentType(), _subject);
 }
 
-/// @brief Get the probability of contaminating an object
-/// @return A value in the range [0, 1)
-sti::infection_cycle::precission sti::human_infection_cycle::get_contamination_probability() const
+/// @brief Get the subject of the random numbers of the human
+/// @details Independent of the process layout, see counter_rng::entity
+std::uint64_t sti::human_infection_cycle::subject() const
 {
-    if (_stage == STAGE::HEALTHY) return 0.0;
-    if (_mode == MODE::IMMUNE) return 0.0;
+    return _subject;
+}
 
-    return _flyweight->contamination_probability;
+/// @brief Set the infection environment this human resides
+/// @param env_ptr A pointer to the environment
+void sti::human_infection_cycle::set_environment(const infection_environment* env_ptr)
+{
+    _environment = env_ptr;
 }
 
 /// @brief Get the probability of infecting humans
 /// @param position The requesting agent position, to determine the distance
+/// @param lane The infection lane
 /// @return A value in the range [0, 1)
-sti::infection_cycle::precission sti::human_infection_cycle::get_infect_probability(coordinates<double> position) const
+sti::infection_cycle::precission sti::human_infection_cycle::get_infect_probability(coordinates<double> position, std::size_t lane) const
 {
-    if (_stage == STAGE::HEALTHY) return 0.0; // If the human is healthy, can't infect
-    if (_mode == MODE::IMMUNE) return 0.0; // If the human is immune, can't infect
-    if (_mode == MODE::COMA) return 0.0; // If the human is in coma, can't infect
+    if ((infectious_lanes() & (1U << lane)) == 0) return 0.0;
 
     // Otherwise calculate the distance to the other person
     const auto my_position = _flyweight->space->get_continuous_location(_id);
-    const auto distance    = sq_distance(my_position, position);
+    return infect_probability_at(sq_distance(my_position, position), lane);
+}
 
-    if (distance > _flyweight->infect_distance) return 0.0;
+/// @brief Get the probability of infecting a human at a given distance
+/// @param distance The distance to the other human
+/// @param lane The infection lane
+/// @return A value in the range [0, 1)
+sti::infection_cycle::precission sti::human_infection_cycle::infect_probability_at(distance_t distance, std::size_t lane) const
+{
+    if ((infectious_lanes() & (1U << lane)) == 0) return 0.0;
 
     // If the other agent is less that X meters away, and this one is either
     // sick or incubating, return the standard infect probability
-    return _flyweight->infect_probability;
+    return infectious_probability_at(distance, lane);
+}
+
+/// @brief Get the probability of any infectious human infecting a human at
+/// a given distance, used for the sources of other processes
+/// @param distance The distance between the humans
+/// @param lane The infection lane
+/// @return A value in the range [0, 1)
+sti::infection_cycle::precission sti::human_infection_cycle::infectious_probability_at(distance_t distance, std::size_t lane) const
+{
+    if (lane == 0) {
+        if (distance > _flyweight->infect_distance) return 0.0;
+        return _flyweight->infect_probability;
+    }
+
+    const auto& parameters = _flyweight->extra_lanes[lane - 1];
+    if (distance > parameters.infect_distance) return 0.0;
+    return parameters.infect_probability;
+}
+
+/// @brief Get the maximum distance at which this human can infect
+/// @param lane The infection lane
+sti::infection_cycle::distance_t sti::human_infection_cycle::infect_distance(std::size_t lane) const
+{
+    if (lane == 0) return _flyweight->infect_distance;
+    return _flyweight->extra_lanes[lane - 1].infect_distance;
+}
+
+/// @brief Check if the human can get infected by nearby humans
+bool sti::human_infection_cycle::susceptible() const
+{
+    if (_stage != STAGE::HEALTHY) return false; // If the human is already infected, can't get infected
+    if (_mode == MODE::IMMUNE) return false; // If the human is immune, can't get infected
+    if (_mode == MODE::COMA) return false; // If the human is in coma, has no nearby humans
+    return true;
+}
+
+/// @brief Check if the human can infect nearby humans
+bool sti::human_infection_cycle::infectious() const
+{
+    if (_stage == STAGE::HEALTHY) return false; // If the human is healthy, can't infect
+    if (_mode == MODE::IMMUNE) return false; // If the human is immune, can't infect
+    if (_mode == MODE::COMA) return false; // If the human is in coma, can't infect
+    return true;
 }
 
 /// @brief Check if the person is sick
@@ -110,57 +201,103 @@ bool sti::human_infection_cycle::is_sick() const
     return _stage == STAGE::SICK;
 }
 
-/// @brief Make the human interact with another infection logic
-/// @param other The other infection cycle
-void sti::human_infection_cycle::interact_with(const infection_cycle& other)
+/// @brief Get the number of infection lanes, 1 if there are no extra lanes
+std::size_t sti::human_infection_cycle::lanes() const
 {
-    // Get the chance of getting infected by that agent
-    const auto my_location        = _flyweight->space->get_continuous_location(_id);
-    const auto infect_probability = other.get_infect_probability(my_location);
+    return 1 + _flyweight->extra_lanes.size();
+}
 
-    // *Roll the dice*
-    const auto random_number = repast::Random::instance()->nextDouble();
-    if (random_number < infect_probability) {
-        // Got infected
-        infected(other.get_id());
+/// @brief Get the lanes in which the human can get infected by nearby humans
+sti::human_infection_cycle::lane_mask sti::human_infection_cycle::susceptible_lanes() const
+{
+    // Same tests as susceptible()
+    auto mask = lane_mask { 0 };
+    if (_mode == MODE::IMMUNE || _mode == MODE::COMA) return mask;
+    for (auto lane = std::size_t { 0 }; lane < lanes(); ++lane) {
+        if (lane_stage(lane) == STAGE::HEALTHY) mask |= static_cast<lane_mask>(1U << lane);
     }
+    return mask;
 }
 
-/// @brief Try to get infected via the environment
-void sti::human_infection_cycle::infect_with_environment()
+/// @brief Get the lanes in which the human can infect nearby humans
+sti::human_infection_cycle::lane_mask sti::human_infection_cycle::infectious_lanes() const
 {
-    if (_environment == nullptr) return; // If there is no environment, return
-    if (_stage != STAGE::HEALTHY) return; // If the agent is already infected, return
-    if (_mode == MODE::IMMUNE) return; // If the agent is immune, return
+    // Same tests as infectious()
+    auto mask = lane_mask { 0 };
+    if (_mode == MODE::IMMUNE || _mode == MODE::COMA) return mask;
+    for (auto lane = std::size_t { 0 }; lane < lanes(); ++lane) {
+        if (lane_stage(lane) != STAGE::HEALTHY) mask |= static_cast<lane_mask>(1U << lane);
+    }
+    return mask;
+}
 
-    // Otherwise generate a random number and compare with the environment
-    // probability of getting infected
-    const auto random_number = repast::Random::instance()->nextDouble();
-    if (random_number < _environment->get_probability()) {
-        // The agent got infected, store the name
-        infected(_environment->name());
+/// @brief Try to get infected by another cycle, in all the lanes
+/// @tparam Cycle The type of the other cycle, the concrete one if known
+/// @param other The other cycle
+template <typename Cycle>
+void sti::human_infection_cycle::infect_with(const Cycle& other)
+{
+    // *Roll the dice*, the same number in all the lanes
+    const auto my_location   = _flyweight->space->get_continuous_location(_id);
+    const auto other_source  = other.source();
+    const auto random_number = counter_rng::instance().uniform_pair(counter_rng::event::CONTACT,
+                                                                    _subject,
+                                                                    other_source.subject());
+
+    for (auto lane = std::size_t { 0 }; lane < lanes(); ++lane) {
+        // Get the chance of getting infected by that agent
+        if (random_number < other.get_infect_probability(my_location, lane)) {
+            // Got infected
+            infected(other_source, lane);
+        }
     }
 }
 
-/// @brief Try go get infected with nearby agents
-void sti::human_infection_cycle::infect_with_nearby()
+/// @brief Make the human interact with another infection logic
+/// @details Adapter for the cycles only known by their interface
+/// @param other The other infection cycle
+void sti::human_infection_cycle::interact_with(const infection_cycle& other)
 {
-    if (_stage != STAGE::HEALTHY) return; // If the human is already infected do nothing
-    if (_mode == MODE::IMMUNE) return; // If the human is immune, can't infect
-    if (_mode == MODE::COMA) return; // If the human is in coma, can't infect
+    infect_with(other);
+}
 
-    const auto my_location = _flyweight->space->get_continuous_location(_id);
-    const auto near_agents = _flyweight->space->agents_around(my_location, _flyweight->infect_distance);
+/// @brief Make the human interact with an object
+/// @details Resolved at compile time, the chairs and the beds use this
+/// overload and the probabilities of the object are not virtual calls
+/// @param other The object
+void sti::human_infection_cycle::interact_with(const object_infection& other)
+{
+    infect_with(other);
+}
 
-    for (const auto& agent : near_agents) {
+/// @brief Try to get infected via the environment
+void sti::human_infection_cycle::infect_with_environment()
+{
+    if (_environment == nullptr) return; // If there is no environment, return
+    if (_mode == MODE::IMMUNE) return; // If the agent is immune, return
 
-        this->interact_with(*agent->get_infection_logic());
-        // If got infected No need to keep iterating over the remaining agents
-        if (_stage != STAGE::HEALTHY) break;
+    // The same environment in all the lanes, a single virtual call. Without
+    // a chance of infecting, e.g. out of the period of the environment, no
+    // number is drawn
+    const auto probability = _environment->get_probability();
+    if (probability <= 0.0) return;
+    for (auto lane = std::size_t { 0 }; lane < lanes(); ++lane) {
+        if (lane_stage(lane) != STAGE::HEALTHY) continue; // If the agent is already infected, skip
+
+        // Otherwise generate a random number and compare with the environment
+        // probability of getting infected
+        const auto random_number = counter_rng::instance().uniform(counter_rng::event::ENVIRONMENT, _subject);
+        if (random_number < probability) {
+            // The agent got infected, store the name
+            infected(_environment->source(), lane);
+        }
     }
 }
 
+
 /// @brief The infection has time-based stages, this method performs the changes
+/// @details The infection via nearby humans is resolved by the contact
+/// kernel, once for all the agents
 void sti::human_infection_cycle::tick()
 {
     // The infection cycle must go from INCUBATING to SICK if the correpsonding
@@ -168,11 +305,19 @@ void sti::human_infection_cycle::tick()
     if (_stage == STAGE::INCUBATING) {
         if (_incubation_end < _flyweight->clk->now()) {
             _stage = STAGE::SICK;
+            ++_version;
+        }
+    }
+
+    for (auto lane = std::size_t { 1 }; lane < lanes(); ++lane) {
+        auto& state = _extra_lanes[lane - 1];
+        if (state.stage == STAGE::INCUBATING && state.incubation_end < _flyweight->clk->now()) {
+            state.stage = STAGE::SICK;
+            ++_version;
         }
     }
 
     this->infect_with_environment();
-    this->infect_with_nearby();
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -205,31 +350,134 @@ boost::json::value sti::human_infection_cycle::stats() const
         }
     };
 
-    return {
+    auto stats = boost::json::object {
         { "infection_id", get_id() },
         { "infection_model", "human" },
         { "infection_mode", mtos(_mode) },
         { "infection_stage", stos(_stage) },
         { "infection_time", _infection_time.seconds_since_epoch() },
         { "incubation_end", _incubation_end.seconds_since_epoch() },
-        { "infected_by", _infected_by },
+        { "infected_by", _infected_by.str() },
         { "infect_location", _infect_location }
     };
+
+    // All the lanes, the first one repeats the primary lane
+    if (lanes() > 1) {
+        auto lane_stats = boost::json::array {};
+        lane_stats.push_back({ { "infection_stage", stos(_stage) },
+                               { "infection_time", _infection_time.seconds_since_epoch() },
+                               { "incubation_end", _incubation_end.seconds_since_epoch() },
+                               { "infected_by", _infected_by.str() } });
+        for (auto lane = std::size_t { 1 }; lane < lanes(); ++lane) {
+            const auto& state = _extra_lanes[lane - 1];
+            lane_stats.push_back({ { "infection_stage", stos(state.stage) },
+                                   { "infection_time", state.infection_time.seconds_since_epoch() },
+                                   { "incubation_end", state.incubation_end.seconds_since_epoch() },
+                                   { "infected_by", state.infected_by.str() } });
+        }
+        stats["infection_lanes"] = std::move(lane_stats);
+    }
+    return stats;
 }
 
 /// @brief Indicate that the patient has been infected
 /// @param infected_by Who infected the agent
-void sti::human_infection_cycle::infected(const std::string& infected_by)
+void sti::human_infection_cycle::infected(const infection_source& infected_by)
 {
 
     _stage = STAGE::INCUBATING;
     // The infection time is a uniform distribution in the range [min, max],
     // generate a random integer in the range [0, max - min], then offset it
     const auto range           = _flyweight->max_incubation_time.length() - _flyweight->min_incubation_time.length();
-    const auto random          = static_cast<timedelta::resolution>(repast::Random::instance()->nextDouble() * static_cast<double>(range));
+    const auto random          = static_cast<timedelta::resolution>(counter_rng::instance().uniform(counter_rng::event::INCUBATION, _subject) * static_cast<double>(range));
     const auto incubation_time = timedelta { _flyweight->min_incubation_time.length() + random };
     _infection_time            = _flyweight->clk->now();
     _incubation_end            = _infection_time + incubation_time;
     _infected_by               = infected_by;
     _infect_location           = _flyweight->space->get_discrete_location(_id);
-}
\ No newline at end of file
+    ++_version;
+    if (_flyweight->tally != nullptr) _flyweight->tally->add(infected_by);
+}
+
+/// @brief Indicate that the patient has been infected in a lane
+/// @param infected_by Who infected the agent
+/// @param lane The infection lane
+void sti::human_infection_cycle::infected(const infection_source& infected_by, std::size_t lane)
+{
+    if (lane == 0) {
+        infected(infected_by);
+        return;
+    }
+
+    // Same as the primary lane, with the same random number
+    const auto& parameters      = _flyweight->extra_lanes[lane - 1];
+    auto&       state           = _extra_lanes[lane - 1];
+    const auto  range           = parameters.max_incubation_time.length() - parameters.min_incubation_time.length();
+    const auto  random          = static_cast<timedelta::resolution>(counter_rng::instance().uniform(counter_rng::event::INCUBATION, _subject) * static_cast<double>(range));
+    const auto  incubation_time = timedelta { parameters.min_incubation_time.length() + random };
+    state.stage                 = STAGE::INCUBATING;
+    state.infection_time        = _flyweight->clk->now();
+    state.incubation_end        = state.infection_time + incubation_time;
+    state.infected_by           = infected_by;
+    ++_version;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// WIRE FORMAT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Store the infection state in the fixed layout format
+/// @param wire The destination
+void sti::human_infection_cycle::pack(infection_wire& wire) const
+{
+    wire.id             = _id.id();
+    wire.starting_rank  = _id.startingRank();
+    wire.agent_type     = _id.agentType();
+    wire.current_rank   = _id.currentRank();
+    wire.subject        = _subject;
+    wire.stage          = static_cast<std::uint8_t>(_stage);
+    wire.mode           = static_cast<std::uint8_t>(_mode);
+    wire.infection_time = _infection_time.seconds_since_epoch();
+    wire.incubation_end = _incubation_end.seconds_since_epoch();
+    wire.infect_x       = _infect_location.x;
+    wire.infect_y       = _infect_location.y;
+    wire.infected_by    = _infected_by;
+
+    for (auto lane = std::size_t { 0 }; lane < _extra_lanes.size(); ++lane) {
+        const auto& state = _extra_lanes[lane];
+
+        wire.extra_lanes[lane].stage          = static_cast<std::uint8_t>(state.stage);
+        wire.extra_lanes[lane].infection_time = state.infection_time.seconds_since_epoch();
+        wire.extra_lanes[lane].incubation_end = state.incubation_end.seconds_since_epoch();
+        wire.extra_lanes[lane].infected_by    = state.infected_by;
+    }
+}
+
+/// @brief Restore the infection state from the fixed layout format
+/// @param wire The source
+void sti::human_infection_cycle::unpack(const infection_wire& wire)
+{
+    _id              = repast::AgentId { wire.id, wire.starting_rank, wire.agent_type, wire.current_rank };
+    _subject         = wire.subject;
+    _stage           = static_cast<STAGE>(wire.stage);
+    _mode            = static_cast<MODE>(wire.mode);
+    _infection_time  = datetime { wire.infection_time };
+    _incubation_end  = datetime { wire.incubation_end };
+    _infect_location = { wire.infect_x, wire.infect_y };
+    _infected_by     = wire.infected_by;
+
+    for (auto lane = std::size_t { 0 }; lane < _extra_lanes.size(); ++lane) {
+        auto& state          = _extra_lanes[lane];
+        state.stage          = static_cast<STAGE>(wire.extra_lanes[lane].stage);
+        state.infection_time = datetime { wire.extra_lanes[lane].infection_time };
+        state.incubation_end = datetime { wire.extra_lanes[lane].incubation_end };
+        state.infected_by    = wire.extra_lanes[lane].infected_by;
+    }
+    ++_version;
+}
+
+/// @brief Get a counter incremented on every change of the state
+std::uint32_t sti::human_infection_cycle::version() const
+{
+    return _version;
+}
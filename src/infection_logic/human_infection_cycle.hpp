@@ -2,11 +2,12 @@
 /// @brief The human infection logic
 #pragma once
 
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <repast_hpc/AgentId.h>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/utility.hpp>
+#include <vector>
 
 #include "../clock.hpp"
 #include "infection_cycle.hpp"
@@ -20,10 +21,12 @@ namespace json {
 } // namespace boost
 
 namespace sti {
+struct infection_wire;
+class agent_locations;
 class clock;
 class infection_environment;
+class infection_tally;
 class object_infection;
-class space_wrapper;
 } // namespace sti
 
 namespace sti {
@@ -36,16 +39,37 @@ public:
     // FLYWEIGHT
     ////////////////////////////////////////////////////////////////////////////
 
+    /// @brief The infection parameters of a lane, see LANES
+    struct lane_parameters {
+        precission infect_probability {};
+        precission infect_distance {};
+        precission contamination_probability {};
+        timedelta  min_incubation_time;
+        timedelta  max_incubation_time;
+    };
+
     /// @brief Struct containing the shared attributes of all infection in humans
+    /// @details The parameters are the ones of the primary lane
     struct flyweight {
-        const sti::space_wrapper* space {};
-        const sti::clock*         clk {};
+        const sti::agent_locations* space {};
+        const sti::clock*           clk {};
 
         precission infect_probability {};
         precission infect_distance {};
         precission contamination_probability {};
         timedelta  min_incubation_time;
         timedelta  max_incubation_time;
+
+        std::vector<lane_parameters> extra_lanes {}; // Lanes 1, 2...
+        sti::infection_tally*        tally {};       // Counts the new infections, if set
+
+        /// @brief Get the parameters of a lane
+        /// @param lane The lane, 0 is the primary one
+        lane_parameters lane(std::size_t lane) const
+        {
+            if (lane == 0) return { infect_probability, infect_distance, contamination_probability, min_incubation_time, max_incubation_time };
+            return extra_lanes[lane - 1];
+        }
     };
 
     using flyweight_ptr   = const flyweight*;
@@ -74,6 +98,33 @@ public:
                 // environment
     }; // clang-format on
 
+    ////////////////////////////////////////////////////////////////////////////
+    // LANES
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @details A cycle can carry several independent infection states, the
+    /// lanes, each one with its own parameters, to evaluate several scenarios
+    /// over the same movement of the agents. The primary lane, 0, is the one
+    /// the rest of the simulation sees: the sick staff leave, the sources sent
+    /// to the other processes and the statistics of a single lane run. The
+    /// extra lanes only observe, they share the mode with the primary one and
+    /// the random numbers of each decision, so a lane with the parameters of
+    /// the primary one reproduces it.
+
+    /// @brief Maximum number of lanes, including the primary one
+    static constexpr auto max_lanes = std::size_t { 4 };
+
+    /// @brief One bit per lane
+    using lane_mask = std::uint8_t;
+
+    /// @brief The infection state of an extra lane
+    struct lane_state {
+        STAGE            stage { HEALTHY };
+        datetime         infection_time;
+        datetime         incubation_end;
+        infection_source infected_by;
+    };
+
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -83,6 +134,7 @@ public:
 
     /// @brief Construct a cycle starting in a given state, specifing the time of infection
     /// @param id The id of the agent associated with this patient
+    /// @param subject The stable subject of the agent, see counter_rng::entity
     /// @param fw The flyweight containing the shared attributes
     /// @param stage The initial stage
     /// @param mode The "mode"
@@ -90,6 +142,7 @@ public:
     /// @param env The infection environment this human resides in
     human_infection_cycle(flyweight_ptr          fw,
                           const repast::AgentId& id,
+                          std::uint64_t          subject,
                           STAGE                  stage,
                           MODE                   mode,
                           datetime               infection_time,
@@ -103,33 +156,112 @@ public:
     /// @param new_mode The new mode to use in this infection
     void mode(MODE new_mode);
 
+    /// @brief Get the infection mode
+    MODE mode() const;
+
+    /// @brief Get the stage of the primary lane
+    STAGE stage() const;
+
+    /// @brief Get the time of infection of the primary lane
+    datetime infection_time() const;
+
+    /// @brief Get the infection environment this human resides, or nullptr
+    const infection_environment* environment() const;
+
     /// @brief Get an ID/string to identify the object in post-processing
     /// @return A string identifying the object
     std::string get_id() const override;
 
+    /// @brief Get the compact identity of the human
+    /// @return The source, carrying the agent id and the subject
+    infection_source source() const override;
+
+    /// @brief Get the subject of the random numbers of the human
+    /// @details Independent of the process layout, see counter_rng::entity
+    std::uint64_t subject() const;
+
     /// @brief Set the infection environment this human resides
     /// @param env_ptr A pointer to the environment
     void set_environment(const infection_environment* env_ptr);
 
     /// @brief Get the probability of contaminating an object
+    /// @details Defined here, so the interactions with the objects inline it
+    /// @param lane The infection lane
     /// @return A value in the range [0, 1)
-    precission get_contamination_probability() const override;
+    precission get_contamination_probability(std::size_t lane) const override
+    {
+        if (lane_stage(lane) == STAGE::HEALTHY) return 0.0;
+        if (_mode == MODE::IMMUNE) return 0.0;
+
+        return _flyweight->lane(lane).contamination_probability;
+    }
 
     /// @brief Get the probability of infecting humans
     /// @param position The requesting agent position, to determine the distance
+    /// @param lane The infection lane
+    /// @return A value in the range [0, 1)
+    precission get_infect_probability(coordinates<double> position, std::size_t lane) const override;
+
+    /// @brief Get the probability of infecting a human at a given distance
+    /// @param distance The distance to the other human
+    /// @param lane The infection lane
     /// @return A value in the range [0, 1)
-    precission get_infect_probability(coordinates<double> position) const override;
+    precission infect_probability_at(distance_t distance, std::size_t lane = 0) const;
+
+    /// @brief Get the probability of any infectious human infecting a human at
+    /// a given distance, used for the sources of other processes
+    /// @param distance The distance between the humans
+    /// @param lane The infection lane
+    /// @return A value in the range [0, 1)
+    precission infectious_probability_at(distance_t distance, std::size_t lane = 0) const;
+
+    /// @brief Get the maximum distance at which this human can infect
+    /// @param lane The infection lane
+    distance_t infect_distance(std::size_t lane = 0) const;
+
+    /// @brief Check if the human can get infected by nearby humans
+    bool susceptible() const;
+
+    /// @brief Check if the human can infect nearby humans
+    bool infectious() const;
+
+    /// @brief Get the number of infection lanes, 1 if there are no extra lanes
+    std::size_t lanes() const;
+
+    /// @brief Get the lanes in which the human can get infected by nearby humans
+    lane_mask susceptible_lanes() const;
+
+    /// @brief Get the lanes in which the human can infect nearby humans
+    lane_mask infectious_lanes() const;
 
     /// @brief Check if the person is sick
     bool is_sick() const;
 
     /// @brief Make the human interact with another infection logic
+    /// @details Adapter for the cycles only known by their interface
     /// @param other The other infection cycle
     void interact_with(const infection_cycle& other) override;
 
+    /// @brief Make the human interact with an object
+    /// @details Resolved at compile time, the chairs and the beds use this
+    /// overload and the probabilities of the object are not virtual calls
+    /// @param other The object
+    void interact_with(const object_infection& other);
+
     /// @brief The infection has time-based stages, this method performs the changes
+    /// @details The infection via nearby humans is resolved by the contact
+    /// kernel, once for all the agents
     void tick();
 
+    /// @brief Indicate that the patient has been infected
+    /// @param infected_by Who infected the agent
+    void infected(const infection_source& infected_by);
+
+    /// @brief Indicate that the patient has been infected in a lane
+    /// @param infected_by Who infected the agent
+    /// @param lane The infection lane
+    void infected(const infection_source& infected_by, std::size_t lane);
+
     ////////////////////////////////////////////////////////////////////////////
     // DATA COLLECTION
     ////////////////////////////////////////////////////////////////////////////
@@ -138,66 +270,53 @@ public:
     /// @return A Boost.JSON value containing relevant statistics
     boost::json::value stats() const;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // WIRE FORMAT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Store the infection state in the fixed layout format
+    /// @param wire The destination
+    void pack(infection_wire& wire) const;
+
+    /// @brief Restore the infection state from the fixed layout format
+    /// @param wire The source
+    void unpack(const infection_wire& wire);
+
+    /// @brief Get a counter incremented on every change of the state
+    std::uint32_t version() const;
+
 private:
 
     /// @brief Try to get infected via the environment
     void infect_with_environment();
 
-    /// @brief Try go get infected with nearby agents
-    void infect_with_nearby();
-    
-    friend class boost::serialization::access;
+    /// @brief Try to get infected by another cycle, in all the lanes
+    /// @tparam Cycle The type of the other cycle, the concrete one if known
+    /// @param other The other cycle
+    template <typename Cycle>
+    void infect_with(const Cycle& other);
 
-    // Private serialization, for security
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int /*unused*/)
+    /// @brief Get the stage of a lane
+    STAGE lane_stage(std::size_t lane) const
     {
-        ar& _id;
-        ar& _stage;
-        ar& _infection_time;
-        ar& _infected_by;
-        ar& _infect_location;
-        ar& _incubation_end;
-        ar& _mode;
+        return lane == 0 ? _stage : _extra_lanes[lane - 1].stage;
     }
 
-    /// @brief Indicate that the patient has been infected
-    /// @param infected_by Who infected the agent
-    void infected(const std::string& infected_by);
-
     flyweight_ptr   _flyweight;
     environment_ptr _environment;
 
     repast::AgentId  _id;
+    std::uint64_t    _subject {};
     STAGE            _stage;
     MODE             _mode;
     datetime         _infection_time;
     datetime         _incubation_end;
-    std::string      _infected_by;
+    infection_source _infected_by;
     coordinates<int> _infect_location;
+    std::uint32_t    _version {};
+
+    std::array<lane_state, max_lanes - 1> _extra_lanes;
 
 }; // class human_infection_cycle
 
 } // namespace sti
-
-// Enum serialization
-namespace boost {
-namespace serialization {
-
-    template <class Archive>
-    void serialize(Archive& ar, sti::human_infection_cycle::STAGE& s, const unsigned int /*unused*/)
-    {
-        ar& s;
-    } // void serialize(...)
-
-    template <class Archive>
-    void serialize(Archive& ar, sti::human_infection_cycle::MODE& m, const unsigned int /*unused*/)
-    {
-        ar& m;
-    } // void serialize(...)
-
-} // namespace serialization
-} // namespaces boost
-
-BOOST_CLASS_IMPLEMENTATION(sti::human_infection_cycle, boost::serialization::object_serializable);
-BOOST_CLASS_TRACKING(sti::human_infection_cycle, boost::serialization::track_never)
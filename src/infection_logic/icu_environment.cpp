@@ -36,11 +36,27 @@ void sti::icu_environment::patients(std::uint32_t patients)
     _current_patients = patients;
 }
 
+/// @brief Set how often the agents are exposed
+/// @param rate The rate of the exposure
+void sti::icu_environment::rate(const tick_rate& rate)
+{
+    _rate = rate;
+}
+
+/// @brief Expose the agents if the tick is due in the rate
+/// @param tick The current tick
+void sti::icu_environment::sync(double tick)
+{
+    _exposed = _rate.due(tick);
+}
+
 /// @brief Get the probability of infecting
-/// @return A value in the range [0, 1), depending of the number of patients
+/// @return A value in the range [0, 1), depending of the number of
+/// patients, or 0 in the ticks without exposure
 [[nodiscard]] sti::infection_cycle::precission sti::icu_environment::get_probability() const
 {
-    return static_cast<decltype(_icu_infection_chance)>(_current_patients) * _icu_infection_chance;
+    if (!_exposed) return 0.0;
+    return _rate.per_period(static_cast<decltype(_icu_infection_chance)>(_current_patients) * _icu_infection_chance);
 }
 
 /// @brief Get the name of the environemnt, for statistic reasons
@@ -50,3 +66,11 @@ std::string sti::icu_environment::name() const
 {
     return _name;
 }
+
+/// @brief Get the compact identity of the environment
+sti::infection_source sti::icu_environment::source() const
+{
+    // The ICU is created before the infection factory interns the names, the
+    // symbol is only looked up when an agent gets infected
+    return infection_source::environment(symbol_table::instance().intern(_name));
+}
@@ -4,6 +4,7 @@
 /// infecting an agent is based in the current number of persons in the ICU
 #pragma once
 
+#include "../tick_rate.hpp"
 #include "environment.hpp"
 #include "infection_cycle.hpp"
 
@@ -22,10 +23,14 @@ namespace sti {
 /// @brief The infection env. of an ICU, the innate infection hazard of an ICU
 /// @details Represents the infection environemnt of an ICU, the probability of
 /// infecting an agent residing in this environment is linearly proportional to
-/// the number of agents residing in the environment.
+/// the number of agents residing in the environment. With a rate the agents
+/// are only exposed in the due ticks, to the probability of the whole period.
 class icu_environment final : public infection_environment {
 
 public:
+    /// @brief The name of the environment if none is given
+    static constexpr auto default_name = "icu_environment";
+
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -33,7 +38,7 @@ public:
     /// @brief Construct an ICU infection environment
     /// @param hospital_params JSON parameters of the hospital
     /// @param name The name of the environment, by default is 'icu'
-    icu_environment(const boost::json::object& hospital_params, const std::string& name = "icu_environment");
+    icu_environment(const boost::json::object& hospital_params, const std::string& name = default_name);
 
     ////////////////////////////////////////////////////////////////////////////
     // BEHAVIOUR
@@ -47,8 +52,17 @@ public:
     /// @param patients The number of patients currently in the ICU
     void patients(std::uint32_t patients);
 
+    /// @brief Set how often the agents are exposed
+    /// @param rate The rate of the exposure
+    void rate(const tick_rate& rate);
+
+    /// @brief Expose the agents if the tick is due in the rate
+    /// @param tick The current tick
+    void sync(double tick);
+
     /// @brief Get the probability of infecting
-    /// @return A value in the range [0, 1), depending of the number of patients
+    /// @return A value in the range [0, 1), depending of the number of
+    /// patients, or 0 in the ticks without exposure
     infection_cycle::precission get_probability() const override;
 
     /// @brief Get the name of the environemnt, for statistic reasons
@@ -56,10 +70,15 @@ public:
     /// determine how an agent got infected
     std::string name() const override;
 
+    /// @brief Get the compact identity of the environment
+    infection_source source() const override;
+
 private:
     std::string                 _name;
     std::uint32_t               _current_patients;
     infection_cycle::precission _icu_infection_chance;
+    tick_rate                   _rate;
+    bool                        _exposed { true };
 
 }; // class icu_environemnt
 
@@ -2,8 +2,11 @@
 /// @brief Base class for infection logics
 #pragma once
 
+#include <cstddef>
 #include <string>
 
+#include "infection_source.hpp"
+
 // Fw. declarations
 namespace repast {
 class AgentId;
@@ -19,6 +22,9 @@ namespace sti {
 class contagious_agent;
 
 /// @brief Base class/interface for the different types of infections
+/// @details The concrete cycles are final, and the interactions between a
+/// human and an object have overloads for the concrete types, resolved at
+/// compile time. This interface is the adapter for the other combinations.
 class infection_cycle {
 
 public:
@@ -37,19 +43,25 @@ public:
     virtual ~infection_cycle() = default;
 
     /// @brief Get the probability of contaminating an object
+    /// @param lane The infection lane, 0 is the primary one
     /// @return A value in the range [0, 1)
-    [[nodiscard]] virtual precission get_contamination_probability() const = 0;
+    [[nodiscard]] virtual precission get_contamination_probability(std::size_t lane) const = 0;
 
     /// @brief Get the probability of infecting humans
     /// @param position The requesting agent position, to determine the distance
+    /// @param lane The infection lane, 0 is the primary one
     /// @return A value in the range [0, 1)
-    [[nodiscard]] virtual precission get_infect_probability(coordinates<double> position) const = 0;
+    [[nodiscard]] virtual precission get_infect_probability(coordinates<double> position, std::size_t lane) const = 0;
 
     /// @brief Get an ID/string to identify the object in post-processing
     /// @return A string identifying the object
     virtual std::string get_id() const = 0;
 
-    /// @brief Make the cycle interact with another cycle
+    /// @brief Get the compact identity of the cycle, used in the infection logic
+    /// @return The source, get_id() is its string form
+    virtual infection_source source() const = 0;
+
+    /// @brief Make the cycle interact with another cycle, in all the lanes
     /// @param other A reference to the other cycle
     virtual void interact_with(const infection_cycle& other) = 0;
 
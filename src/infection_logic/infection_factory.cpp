@@ -1,13 +1,43 @@
 #include "infection_factory.hpp"
 
+#include <algorithm>
 #include <boost/json/object.hpp>
 #include <repast_hpc/RepastProcess.h>
 
 #include "../json_serialization.hpp"
-#include "../space_wrapper.hpp"
+#include "../agent_locations.hpp"
 #include "../clock.hpp"
 #include "object_infection.hpp"
 #include "human_infection_cycle.hpp"
+#include "icu_environment.hpp"
+#include "infection_source.hpp"
+
+namespace {
+
+/// @brief Get a section of the parameters of a lane
+/// @param lane The parameters of the lane, or nullptr
+/// @param key The name of the section
+/// @return The section, or nullptr if the lane doesn't change it
+const boost::json::object* lane_section(const boost::json::object* lane, boost::json::string_view key)
+{
+    if (lane == nullptr) return nullptr;
+    const auto* section = lane->if_contains(key);
+    return section == nullptr ? nullptr : &section->as_object();
+}
+
+/// @brief Get a parameter of a lane, or the one of the primary lane
+/// @param lane The section of the lane, or nullptr
+/// @param primary The same section of the primary lane
+/// @param key The name of the parameter
+const boost::json::value& lane_value(const boost::json::object* lane, const boost::json::object& primary, boost::json::string_view key)
+{
+    if (lane != nullptr) {
+        if (const auto* value = lane->if_contains(key)) return *value;
+    }
+    return primary.at(key);
+}
+
+} // namespace
 
 ////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
@@ -15,10 +45,10 @@
 
 /// @brief Construct an infection factory, used to create infection cycles
 /// @param hospital_params The boost.JSON object containing the hospital paramters
-/// @param space The space wrapper
+/// @param space The locations of the agents, the space wrapper
 /// @param clock The simulation clock
 sti::infection_factory::infection_factory(const boost::json::object& hospital_props,
-                                          const space_wrapper*       space,
+                                          const agent_locations*     space,
                                           const clock*               clock)
     : _human_flyweight {
         space,
@@ -34,6 +64,8 @@ sti::infection_factory::infection_factory(const boost::json::object& hospital_pr
 
         const auto object_types = hospital_props.at("parameters").at("objects").as_object();
         for (const auto& [object_name, value] : object_types) {
+            // Intern the types in the same order in all the processes
+            symbol_table::instance().intern(object_name.to_string());
             map[object_name.to_string()] = {
                 space,
                 clock,
@@ -45,6 +77,60 @@ sti::infection_factory::infection_factory(const boost::json::object& hospital_pr
     }() }
     , _ghost_objects { 0 }
 {
+    // The environments are only created in the process managing them, but
+    // the humans can carry their name anywhere
+    symbol_table::instance().intern(icu_environment::default_name);
+
+    // The extra infection lanes, changing some of the parameters
+    const auto& parameters = hospital_props.at("parameters").as_object();
+    const auto* lanes      = parameters.if_contains("lanes");
+    if (lanes == nullptr) return;
+    if (lanes->as_array().size() + 1 > human_infection_cycle::max_lanes) throw too_many_lanes {};
+
+    const auto& human   = parameters.at("human").as_object();
+    const auto& objects = parameters.at("objects").as_object();
+    for (const auto& lane : lanes->as_array()) {
+        const auto* human_lane = lane_section(&lane.as_object(), "human");
+        const auto& incubation = lane_value(human_lane, human, "incubation_time");
+        _human_flyweight.extra_lanes.push_back({ lane_value(human_lane, human, "infect_probability").as_double(),
+                                                 lane_value(human_lane, human, "infect_distance").as_double(),
+                                                 lane_value(human_lane, human, "contamination_probability").as_double(),
+                                                 boost::json::value_to<sti::timedelta>(incubation.at("min")),
+                                                 boost::json::value_to<sti::timedelta>(incubation.at("max")) });
+
+        const auto* objects_lane = lane_section(&lane.as_object(), "objects");
+        for (auto& [object_name, fw] : _object_flyweights) {
+            const auto& object      = objects.at(object_name).as_object();
+            const auto* object_lane = lane_section(objects_lane, object_name);
+            fw.extra_lanes.push_back({ lane_value(object_lane, object, "infect_probability").as_double(),
+                                       boost::json::value_to<sti::timedelta>(lane_value(object_lane, object, "cleaning_interval")) });
+        }
+    }
+}
+
+/// @brief Get the largest infection distance of all the lanes
+/// @details The distance the spaces and the exchanges must cover
+/// @param hospital_props The boost.JSON object containing the hospital paramters
+double sti::infection_factory::max_infect_distance(const boost::json::object& hospital_props)
+{
+    const auto& parameters = hospital_props.at("parameters").as_object();
+    const auto& human      = parameters.at("human").as_object();
+    auto        distance   = human.at("infect_distance").as_double();
+
+    if (const auto* lanes = parameters.if_contains("lanes")) {
+        for (const auto& lane : lanes->as_array()) {
+            const auto* human_lane = lane_section(&lane.as_object(), "human");
+            distance               = std::max(distance, lane_value(human_lane, human, "infect_distance").as_double());
+        }
+    }
+    return distance;
+}
+
+/// @brief Count the new infections of all the humans
+/// @param tally The counters, outlive the factory and the humans
+void sti::infection_factory::count_infections(infection_tally* tally)
+{
+    _human_flyweight.tally = tally;
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -60,17 +146,19 @@ sti::human_infection_cycle sti::infection_factory::make_human_cycle() const
 
 /// @brief Get a new human infection cycle
 /// @param id The agent id associated with this cycle
+/// @param subject The stable subject of the agent, see counter_rng::entity
 /// @param is Initial stage of the cycle
 /// @param mode The "mode" of the cycle
 /// @param infection_time The time of infection
 /// @return A human infection cycle object
 sti::human_infection_cycle sti::infection_factory::make_human_cycle(
     const agent_id&              id,
+    std::uint64_t                subject,
     human_infection_cycle::STAGE is,
     human_infection_cycle::MODE  mode,
     datetime                     infection_time) const
 {
-    return { &_human_flyweight, id, is, mode, infection_time };
+    return { &_human_flyweight, id, subject, is, mode, infection_time };
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -87,11 +175,29 @@ sti::object_infection sti::infection_factory::make_object_infection()
 /// @brief Construct an object infection cycle with no repast relationship
 /// @param type The object type, normally 'chair' or 'bed'
 /// @param is Initial stage of the cycle
+/// @param subject The stable subject of the object, see counter_rng::entity
 /// @return An object infection cycle object
 sti::object_infection sti::infection_factory::make_object_infection(
     const object_type&      type,
-    object_infection::STAGE is)
+    object_infection::STAGE is,
+    std::uint64_t           subject)
 {
     const auto id = object_infection::id_type { repast::RepastProcess::instance()->rank(), _ghost_objects++ };
-    return { &_object_flyweights, id, type, is };
+    return { &_object_flyweights, id, subject, type, is };
+}
+
+/// @brief Construct an object infection cycle with a given id
+/// @details Recreates the objects of another run, see infection_replay
+/// @param type The object type, normally 'chair' or 'bed'
+/// @param is Initial stage of the cycle
+/// @param id The id of the object in the other run
+/// @param subject The subject of the object in the other run
+/// @return An object infection cycle object
+sti::object_infection sti::infection_factory::make_object_infection(
+    const object_type&        type,
+    object_infection::STAGE   is,
+    object_infection::id_type id,
+    std::uint64_t             subject)
+{
+    return { &_object_flyweights, id, subject, type, is };
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 /// @brief Infection factory, to ease the creation of infection
 #pragma once
 
+#include <exception>
 #include <map>
 
 #include "human_infection_cycle.hpp"
@@ -19,14 +20,30 @@ class AgentId;
 }
 
 namespace sti {
+class agent_locations;
 class parallel_agent;
 class clock;
-class space_wrapper;
 } // namespace sti
 
 namespace sti {
 
+/// @brief Error reading the infection lanes of the hospital parameters
+struct too_many_lanes : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: More infection lanes than supported by human_infection_cycle::max_lanes";
+    }
+};
+
 /// @brief Stores infection flyweights and creates new instances
+/// @details The hospital parameters can contain, next to "human" and
+/// "objects", a "lanes" array with the parameters of the extra infection
+/// lanes, see human_infection_cycle. Each lane has the same layout as the
+/// parameters, "human" and "objects", and only the values that change,
+/// the rest are the ones of the primary lane:
+///
+///     "lanes": [ { "human": { "infect_probability": 0.2 } },
+///                { "objects": { "chair": { "cleaning_interval": ... } } } ]
 class infection_factory {
 
 public:
@@ -39,12 +56,21 @@ public:
 
     /// @brief Construct an infection factory, used to create infection cycles
     /// @param hospital_props The boost.JSON object containing the hospital paramters
-    /// @param space The space wrapper
+    /// @param space The locations of the agents, the space wrapper
     /// @param clock The simulation clock
     infection_factory(const boost::json::object& hospital_props,
-                      const space_wrapper*       space,
+                      const agent_locations*     space,
                       const clock*               clock);
 
+    /// @brief Get the largest infection distance of all the lanes
+    /// @details The distance the spaces and the exchanges must cover
+    /// @param hospital_props The boost.JSON object containing the hospital paramters
+    static double max_infect_distance(const boost::json::object& hospital_props);
+
+    /// @brief Count the new infections of all the humans
+    /// @param tally The counters, outlive the factory and the humans
+    void count_infections(infection_tally* tally);
+
     ////////////////////////////////////////////////////////////////////////////
     // HUMAN INFECTION CYCLE CREATION
     ////////////////////////////////////////////////////////////////////////////
@@ -55,11 +81,13 @@ public:
 
     /// @brief Get a new human infection cycle
     /// @param id The agent id associated with this cycle
+    /// @param subject The stable subject of the agent, see counter_rng::entity
     /// @param is Initial stage of the cycle
     /// @param mode The "mode" of the cycle
     /// @param infection_time The time of infection
     /// @return A human infection cycle object
     human_infection_cycle make_human_cycle(const agent_id&              id,
+                                           std::uint64_t                subject,
                                            human_infection_cycle::STAGE is,
                                            human_infection_cycle::MODE  mode,
                                            datetime                     infection_time) const;
@@ -75,9 +103,23 @@ public:
     /// @brief Construct an object infection cycle with no repast relationship
     /// @param type The object type, normally 'chair' or 'bed'
     /// @param is Initial stage of the cycle
+    /// @param subject The stable subject of the object, see counter_rng::entity
+    /// @return An object infection cycle object
+    object_infection make_object_infection(const object_type&      type,
+                                           object_infection::STAGE is,
+                                           std::uint64_t           subject);
+
+    /// @brief Construct an object infection cycle with a given id
+    /// @details Recreates the objects of another run, see infection_replay
+    /// @param type The object type, normally 'chair' or 'bed'
+    /// @param is Initial stage of the cycle
+    /// @param id The id of the object in the other run
+    /// @param subject The subject of the object in the other run
     /// @return An object infection cycle object
     object_infection make_object_infection(const object_type&        type,
-                                               object_infection::STAGE is);
+                                           object_infection::STAGE   is,
+                                           object_infection::id_type id,
+                                           std::uint64_t             subject);
 
 private:
     human_flyweight                         _human_flyweight;
@@ -0,0 +1,111 @@
+/// @file infection_logic/infection_source.cpp
+/// @brief Compact identities of the infection cycles
+#include "infection_source.hpp"
+
+#include <exception>
+
+////////////////////////////////////////////////////////////////////////////////
+// SYMBOL TABLE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the table of the process
+sti::symbol_table& sti::symbol_table::instance()
+{
+    static auto table = symbol_table {};
+    return table;
+}
+
+/// @brief Get the symbol of a name, interning it if it's new
+/// @param name The name
+/// @return The symbol
+sti::symbol sti::symbol_table::intern(const std::string& name)
+{
+    const auto it = _symbols.find(name);
+    if (it != _symbols.end()) return it->second;
+
+    const auto s = static_cast<symbol>(_names.size());
+    _names.push_back(name);
+    _symbols[name] = s;
+    return s;
+}
+
+/// @brief Get the name of a symbol
+/// @param s The symbol, obtained from intern()
+/// @return The name
+const std::string& sti::symbol_table::name(symbol s) const
+{
+    if (s >= _names.size()) throw std::exception {};
+    return _names[s];
+}
+
+/// @brief Get the number of symbols interned
+std::size_t sti::symbol_table::size() const
+{
+    return _names.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// INFECTION SOURCE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the source of a human
+sti::infection_source sti::infection_source::human(std::int32_t id, std::int32_t starting_rank, std::int32_t agent_type, std::uint64_t key)
+{
+    return { KIND::HUMAN,
+             static_cast<std::uint32_t>(agent_type),
+             id,
+             static_cast<std::uint32_t>(starting_rank),
+             key };
+}
+
+/// @brief Get the source of an object
+sti::infection_source sti::infection_source::object(symbol type, std::int32_t rank, std::uint32_t serial, std::uint64_t key)
+{
+    return { KIND::OBJECT, type, rank, serial, key };
+}
+
+/// @brief Get the source of an environment
+sti::infection_source sti::infection_source::environment(symbol name)
+{
+    return { KIND::ENVIRONMENT, name, 0, 0, 0 };
+}
+
+/// @brief Get the name of the source, as used in the statistics
+/// @return The name, or an empty string if there is no source
+std::string sti::infection_source::str() const
+{
+    switch (kind) {
+    case KIND::NONE:
+        return {};
+    case KIND::HUMAN:
+        return "human." + std::to_string(first) + "." + std::to_string(second) + "." + std::to_string(type);
+    case KIND::OBJECT:
+        return symbol_table::instance().name(type) + '.' + std::to_string(first) + '.' + std::to_string(second);
+    case KIND::ENVIRONMENT:
+        return symbol_table::instance().name(type);
+    }
+    return {};
+}
+
+/// @brief Get the random stream subject of the source
+/// @details Humans use their key, the objects and the environments a hash
+/// of the kind, the type and the key. None of them use the ids
+std::uint64_t sti::infection_source::subject() const
+{
+    if (kind == KIND::HUMAN) return key;
+
+    // FNV-1a of the fields, the type symbols are interned in the same order
+    // in all the processes
+    auto h   = std::uint64_t { 14695981039346656037ULL };
+    auto mix = [&](std::uint32_t word) {
+        for (auto i = 0U; i < 4U; ++i) {
+            h ^= (word >> (8U * i)) & 0xFFU;
+            h *= 1099511628211ULL;
+        }
+    };
+    mix(static_cast<std::uint32_t>(kind));
+    mix(type);
+    mix(static_cast<std::uint32_t>(key));
+    mix(static_cast<std::uint32_t>(key >> 32U));
+    return h;
+}
@@ -0,0 +1,92 @@
+/// @file infection_logic/infection_source.hpp
+/// @brief Compact identities of the infection cycles
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sti {
+
+/// @brief An interned name
+using symbol = std::uint32_t;
+
+/// @brief Table of interned names, shared by all the infection cycles of the process
+/// @details The symbols are assigned in interning order, and travel to other
+/// processes inside the agents, so every name must be interned in all the
+/// processes in the same order, during the construction of the model. The
+/// infection factory interns the object types and the environments.
+class symbol_table {
+
+public:
+    /// @brief Get the table of the process
+    static symbol_table& instance();
+
+    /// @brief Get the symbol of a name, interning it if it's new
+    /// @param name The name
+    /// @return The symbol
+    symbol intern(const std::string& name);
+
+    /// @brief Get the name of a symbol
+    /// @param s The symbol, obtained from intern()
+    /// @return The name
+    const std::string& name(symbol s) const;
+
+    /// @brief Get the number of symbols interned
+    std::size_t size() const;
+
+private:
+    std::vector<std::string>                _names;
+    std::unordered_map<std::string, symbol> _symbols;
+}; // class symbol_table
+
+/// @brief Identity of the cycle that infected or contaminated another
+/// @details Only numbers: the agent id for humans, the type and id for
+/// objects, the name for environments. The string form is only built for the
+/// statistics. The ids depend on the process layout, the random numbers use
+/// the key instead, the stable subject of the cycle, see counter_rng.
+struct infection_source {
+
+    /// @brief The kind of cycle
+    enum class KIND : std::uint8_t { NONE,
+                                     HUMAN,
+                                     OBJECT,
+                                     ENVIRONMENT };
+
+    KIND          kind { KIND::NONE };
+    std::uint32_t type {};   // Agent type for humans, the name symbol otherwise
+    std::int32_t  first {};  // Agent id for humans, rank for objects
+    std::uint32_t second {}; // Starting rank for humans, serial for objects
+    std::uint64_t key {};    // The subject of the humans and the objects
+
+    /// @brief Get the source of a human
+    static infection_source human(std::int32_t id, std::int32_t starting_rank, std::int32_t agent_type, std::uint64_t key);
+
+    /// @brief Get the source of an object
+    static infection_source object(symbol type, std::int32_t rank, std::uint32_t serial, std::uint64_t key);
+
+    /// @brief Get the source of an environment
+    static infection_source environment(symbol name);
+
+    /// @brief Get the name of the source, as used in the statistics
+    /// @return The name, or an empty string if there is no source
+    std::string str() const;
+
+    /// @brief Get the random stream subject of the source
+    /// @details Humans use their key, the objects and the environments a hash
+    /// of the kind, the type and the key. None of them use the ids
+    std::uint64_t subject() const;
+
+    template <class Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& kind;
+        ar& type;
+        ar& first;
+        ar& second;
+        ar& key;
+    }
+}; // struct infection_source
+
+} // namespace sti
@@ -0,0 +1,74 @@
+/// @file infection_logic/infection_tally.hpp
+/// @brief Counters of the new infections of the humans, by their source
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "infection_source.hpp"
+
+namespace sti {
+
+/// @brief Counts the new infections of the humans, by the kind of source
+/// @details The infections by other humans are counted together, the ones by
+/// objects and environments by the symbol of their type or name. The agents
+/// can get infected in several threads, see act_phase, so the counters are
+/// atomic. Only the primary lane is counted.
+class infection_tally {
+
+public:
+    /// @brief Create a tally with all the counters at zero
+    /// @param symbols The number of symbols, see symbol_table::size()
+    explicit infection_tally(std::size_t symbols)
+        : _symbols { symbols }
+        , _by_symbol { std::make_unique<std::atomic<std::uint64_t>[]>(symbols) }
+    {
+        reset();
+    }
+
+    /// @brief Count a new infection
+    /// @param source Who infected the human
+    void add(const infection_source& source)
+    {
+        if (source.kind == infection_source::KIND::HUMAN) {
+            _humans.fetch_add(1, std::memory_order_relaxed);
+        } else if (source.kind != infection_source::KIND::NONE && source.type < _symbols) {
+            _by_symbol[source.type].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Get the infections by other humans
+    std::uint64_t humans() const
+    {
+        return _humans.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Get the infections by an object type or an environment
+    /// @param s The symbol of the type or the name
+    std::uint64_t by_symbol(symbol s) const
+    {
+        return _by_symbol[s].load(std::memory_order_relaxed);
+    }
+
+    /// @brief Get the number of symbols counted
+    std::size_t symbols() const
+    {
+        return _symbols;
+    }
+
+    /// @brief Set all the counters to zero
+    void reset()
+    {
+        _humans.store(0, std::memory_order_relaxed);
+        for (auto s = std::size_t { 0 }; s < _symbols; ++s) _by_symbol[s].store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t>                    _humans {};
+    std::size_t                                   _symbols;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> _by_symbol;
+}; // class infection_tally
+
+} // namespace sti
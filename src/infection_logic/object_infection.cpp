@@ -1,7 +1,6 @@
 #include "object_infection.hpp"
 
 #include <boost/json/object.hpp>
-#include <repast_hpc/Random.h>
 #include <repast_hpc/Grid.h>
 #include <repast_hpc/Moore2DGridQuery.h>
 #include <repast_hpc/VN2DGridQuery.h>
@@ -9,8 +8,10 @@
 #include <sstream>
 #include <string>
 
+#include "human_infection_cycle.hpp"
 #include "infection_cycle.hpp"
 #include "../contagious_agent.hpp"
+#include "../counter_rng.hpp"
 #include "../coordinates.hpp"
 
 ////////////////////////////////////////////////////////////////////////////
@@ -20,8 +21,9 @@
 /// @brief Construct an empty object, flyweight is still needed
 /// @param fw The flyweight containing shared data
 /// @param type The object type, i.e. chair, bed
-sti::object_infection::object_infection(flyweights_ptr fw)
-    : _flyweights { fw }
+sti::object_infection::object_infection(flyweights_ptr /*unused*/)
+    : _flyweight {}
+    , _object_type {}
     , _stage { STAGE::CLEAN }
 {
 }
@@ -29,19 +31,26 @@ sti::object_infection::object_infection(flyweights_ptr fw)
 /// @brief Construct an object infection logic
 /// @param fw The object flyweight
 /// @param uint_id Unsigned int giving the agent an id
+/// @param subject The stable subject of the object, see counter_rng::entity
 /// @param type The object type, i.e. chair, bed
 /// @param is The initial stage of the object
 sti::object_infection::object_infection(
     flyweights_ptr     fw,
     id_type            id,
+    std::uint64_t      subject,
     const object_type& type,
     STAGE              is)
-    : _flyweights { fw }
+    : _flyweight { &fw->at(type) }
     , _id { id }
-    , _object_type { type }
+    , _subject { subject }
+    , _object_type { symbol_table::instance().intern(type) }
     , _stage { is }
-    , _next_clean { fw->at(_object_type).clock->now() + fw->at(_object_type).cleaning_interval }
+    , _next_clean { _flyweight->clock->now() + _flyweight->cleaning_interval }
 {
+    // The extra lanes start in the same state
+    for (const auto& lane : _flyweight->extra_lanes) {
+        _extra_lanes.push_back({ is, _flyweight->clock->now() + lane.cleaning_interval, {} });
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -52,58 +61,114 @@ sti::object_infection::object_infection(
 /// @return A string identifying the object
 std::string sti::object_infection::get_id() const
 {
-    return _object_type + '.' + std::to_string(_id.first) + '.' + std::to_string(_id.second);
+    return source().str();
 }
 
-/// @brief Clean the object, removing contamination and resetting the state
+/// @brief Get the compact identity of the object
+/// @return The source, carrying the type symbol, the id and the subject
+sti::infection_source sti::object_infection::source() const
+{
+    return infection_source::object(_object_type, _id.first, _id.second, _subject);
+}
+
+/// @brief Clean the object in all the lanes, removing contamination and
+/// resetting the state
 void sti::object_infection::clean()
 {
     _stage = STAGE::CLEAN;
+    for (auto& lane : _extra_lanes) lane.stage = STAGE::CLEAN;
 }
 
 /// @brief Get the probability of contaminating an object
+/// @param lane The infection lane
 /// @return A value in the range [0, 1)
-sti::infection_cycle::precission sti::object_infection::get_contamination_probability() const
+sti::infection_cycle::precission sti::object_infection::get_contamination_probability(std::size_t /*unused*/) const
 {
     // An object can't contaminate other objects
     return 0.0;
 }
 
-/// @brief Get the probability of infecting humans
-/// @param position The requesting agent position, to determine the probability
-/// @return A value in the range [0, 1)
-sti::infection_cycle::precission sti::object_infection::get_infect_probability(coordinates<double> /*unused*/) const
-{
-    return _flyweights->at(_object_type).infect_chance;
-}
-
-/// @brief Make the object interact with another infectious cycle
+/// @brief Get contaminated by another cycle, in all the lanes
 /// @details Note that this can infect/contaminate both agents depending on
 /// the current status of each  cycle
-/// @param human A reference to the human infection interacting with this object
-void sti::object_infection::interact_with(const infection_cycle& other)
+/// @tparam Cycle The type of the other cycle, the concrete one if known
+/// @param other The other cycle
+template <typename Cycle>
+void sti::object_infection::contaminate_with(const Cycle& other)
 {
-    // If the object is already contaminated do nothing
-    if (_stage == STAGE::CONTAMINATED) return;
-
     // Generate a random number and compare with the contamination
-    // probability of the other cycle
-    const auto random_number = repast::Random::instance()->nextDouble();
-    if (random_number < other.get_contamination_probability()) {
+    // probability of the other cycle, the same number in all the lanes
+    const auto other_source  = other.source();
+    const auto random_number = counter_rng::instance().uniform_pair(counter_rng::event::CONTAMINATION,
+                                                                    source().subject(),
+                                                                    other_source.subject());
+
+    // If the object is already contaminated do nothing
+    if (_stage != STAGE::CONTAMINATED && random_number < other.get_contamination_probability(0)) {
         // The object got contaminated, change state and record the source
         _stage = STAGE::CONTAMINATED;
-        _infected_by.push_back({ other.get_id(),
-                                 _flyweights->at(_object_type).clock->now() });
+        _infected_by.push_back({ other_source, _flyweight->clock->now() });
     }
+
+    for (auto lane = std::size_t { 0 }; lane < _extra_lanes.size(); ++lane) {
+        auto& state = _extra_lanes[lane];
+        if (state.stage != STAGE::CONTAMINATED && random_number < other.get_contamination_probability(lane + 1)) {
+            state.stage = STAGE::CONTAMINATED;
+            state.infected_by.push_back({ other_source, _flyweight->clock->now() });
+        }
+    }
+}
+
+/// @brief Make the object interact with another cycle
+/// @details Adapter for the cycles only known by their interface
+/// @param other A reference to the human infection interacting with this object
+void sti::object_infection::interact_with(const infection_cycle& other)
+{
+    contaminate_with(other);
+}
+
+/// @brief Make the object interact with a human
+/// @details Resolved at compile time, the chairs and the beds use this
+/// overload and the probabilities of the human are not virtual calls
+/// @param other The human interacting with this object
+void sti::object_infection::interact_with(const human_infection_cycle& other)
+{
+    contaminate_with(other);
 }
 
 /// @brief Perform the periodic logic, i.e. clean the object
+/// @details Each lane is cleaned when its own cleaning is due
 void sti::object_infection::tick()
 {
-    if (_next_clean <= _flyweights->at(_object_type).clock->now()) {
-        clean();
-        _next_clean = _next_clean + _flyweights->at(_object_type).cleaning_interval;
+    const auto now = _flyweight->clock->now();
+    if (_next_clean <= now) {
+        _stage      = STAGE::CLEAN;
+        _next_clean = _next_clean + _flyweight->cleaning_interval;
+    }
+
+    for (auto lane = std::size_t { 0 }; lane < _extra_lanes.size(); ++lane) {
+        auto& state = _extra_lanes[lane];
+        if (state.next_clean <= now) {
+            state.stage      = STAGE::CLEAN;
+            state.next_clean = state.next_clean + _flyweight->extra_lanes[lane].cleaning_interval;
+        }
+    }
+}
+
+/// @brief Get the instant of the next cleaning, the earliest of all the lanes
+sti::datetime sti::object_infection::next_clean() const
+{
+    auto next = _next_clean;
+    for (const auto& lane : _extra_lanes) {
+        if (lane.next_clean < next) next = lane.next_clean;
     }
+    return next;
+}
+
+/// @brief Check if the next cleaning is due, and tick() would clean the object
+bool sti::object_infection::cleaning_due() const
+{
+    return next_clean() <= _flyweight->clock->now();
 }
 
 /// @brief Get statistics about the infection
@@ -120,10 +185,23 @@ boost::json::value sti::object_infection::stats() const
         }
     };
 
-    return {
+    auto stats = boost::json::object {
         { "infection_id", get_id() },
         { "infection_model", "object" },
         { "infection_stage", to_string(_stage) },
-        { "infections", _infected_by }
+        { "infections", boost::json::value_from(_infected_by) }
     };
+
+    // All the lanes, the first one repeats the primary lane
+    if (!_extra_lanes.empty()) {
+        auto lane_stats = boost::json::array {};
+        lane_stats.push_back({ { "infection_stage", to_string(_stage) },
+                               { "infections", boost::json::value_from(_infected_by) } });
+        for (const auto& lane : _extra_lanes) {
+            lane_stats.push_back({ { "infection_stage", to_string(lane.stage) },
+                                   { "infections", boost::json::value_from(lane.infected_by) } });
+        }
+        stats["infection_lanes"] = std::move(lane_stats);
+    }
+    return stats;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 /// @brief Monoprocess objects with no physical representation.
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <utility>
@@ -9,6 +10,7 @@
 
 #include "infection_cycle.hpp"
 #include "../clock.hpp"
+#include "../coordinates.hpp"
 
 // Fw. declarations
 namespace boost {
@@ -17,7 +19,7 @@ namespace json {
 } // namespace json
 } // namespace boost
 namespace sti {
-class space_wrapper;
+class agent_locations;
 class human_infection_cycle;
 } // namespace sti
 
@@ -32,13 +34,22 @@ public:
     // FLYWEIGHT
     ////////////////////////////////////////////////////////////////////////////
 
+    /// @brief The infection parameters of a lane, see human_infection_cycle
+    struct lane_parameters {
+        precission infect_chance {};
+        timedelta  cleaning_interval;
+    };
+
     /// @brief Struct containing the shared attributes of all object infections
+    /// @details The parameters are the ones of the primary lane
     struct flyweight {
-        const sti::space_wrapper* space {};
-        const sti::clock*         clock {};
+        const sti::agent_locations* space {};
+        const sti::clock*           clock {};
 
         precission infect_chance {};
         timedelta  cleaning_interval;
+
+        std::vector<lane_parameters> extra_lanes {}; // Lanes 1, 2...
     };
 
     using flyweights_ptr = const std::map<object_type, flyweight>*;
@@ -49,8 +60,15 @@ public:
 
     /// @brief Struct used to store the infection statistics
     struct infection_stat {
-        std::string infected_by;
-        datetime    time;
+        infection_source infected_by;
+        datetime         time;
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& infected_by;
+            ar& time;
+        }
     }; // struct infection_state
 
     ////////////////////////////////////////////////////////////////////////////
@@ -61,6 +79,26 @@ public:
     enum class STAGE { CLEAN,
                        CONTAMINATED };
 
+    ////////////////////////////////////////////////////////////////////////////
+    // LANES
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief The infection state of an extra lane, see human_infection_cycle
+    /// @details Each lane has its own cleanings, as the interval can change
+    struct lane_state {
+        STAGE                       stage { STAGE::CLEAN };
+        datetime                    next_clean;
+        std::vector<infection_stat> infected_by;
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& stage;
+            ar& next_clean;
+            ar& infected_by;
+        }
+    };
+
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -72,10 +110,12 @@ public:
     /// @brief Construct an object infection logic
     /// @param fw The object flyweight
     /// @param uint_id Unsigned int giving the agent an id
+    /// @param subject The stable subject of the object, see counter_rng::entity
     /// @param type The object type, i.e. chair, bed
     /// @param is The initial stage of the object
     object_infection(flyweights_ptr     fw,
                      id_type            uint_id,
+                     std::uint64_t      subject,
                      const object_type& type,
                      STAGE              is);
 
@@ -95,36 +135,82 @@ public:
     /// @return A string identifying the object
     std::string get_id() const override;
 
-    /// @brief Clean the object, removing contamination and resetting the state
+    /// @brief Get the compact identity of the object
+    /// @return The source, carrying the type symbol, the id and the subject
+    infection_source source() const override;
+
+    /// @brief Clean the object in all the lanes, removing contamination and
+    /// resetting the state
     void clean();
 
     /// @brief Get the probability of contaminating an object
+    /// @param lane The infection lane
     /// @return A value in the range [0, 1)
-    precission get_contamination_probability() const override;
+    precission get_contamination_probability(std::size_t lane) const override;
 
     /// @brief Get the probability of infecting humans
+    /// @details Defined here, so the interactions with the humans inline it
     /// @param position The requesting agent position, to determine the probability
+    /// @param lane The infection lane
     /// @return A value in the range [0, 1)
-    precission get_infect_probability(coordinates<double> position) const override;
+    precission get_infect_probability(coordinates<double> /*unused*/, std::size_t lane) const override
+    {
+        if (lane == 0) return _flyweight->infect_chance;
+        return _flyweight->extra_lanes[lane - 1].infect_chance;
+    }
 
     /// @brief Make the object interact with another cycle
+    /// @details Adapter for the cycles only known by their interface
     /// @param other A reference to the human infection interacting with this object
     void interact_with(const infection_cycle& other) override;
 
+    /// @brief Make the object interact with a human
+    /// @details Resolved at compile time, the chairs and the beds use this
+    /// overload and the probabilities of the human are not virtual calls
+    /// @param other The human interacting with this object
+    void interact_with(const human_infection_cycle& other);
+
     /// @brief Perform the periodic logic, i.e. clean the object
+    /// @details Each lane is cleaned when its own cleaning is due
     void tick();
 
+    /// @brief Get the instant of the next cleaning, the earliest of all the lanes
+    datetime next_clean() const;
+
+    /// @brief Check if the next cleaning is due, and tick() would clean the object
+    bool cleaning_due() const;
+
     /// @brief Get statistics about the infection
     /// @return A Boost.JSON value containing relevant statistics
     boost::json::value stats() const;
 
+    /// @brief Serialize the state that changes during the simulation
+    /// @details The flyweight, the id, the subject and the type are kept, the object must
+    /// be created the same way before reading a checkpoint
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& _stage;
+        ar& _next_clean;
+        ar& _infected_by;
+        ar& _extra_lanes;
+    }
+
 private:
-    flyweights_ptr                                _flyweights;
-    id_type                                       _id;
-    object_type                                   _object_type;
-    STAGE                                         _stage;
-    datetime                                      _next_clean;
+    /// @brief Get contaminated by another cycle, in all the lanes
+    /// @tparam Cycle The type of the other cycle, the concrete one if known
+    /// @param other The other cycle
+    template <typename Cycle>
+    void contaminate_with(const Cycle& other);
+
+    const flyweight*            _flyweight;
+    id_type                     _id;
+    std::uint64_t               _subject {};
+    symbol                      _object_type;
+    STAGE                       _stage;
+    datetime                    _next_clean;
     std::vector<infection_stat> _infected_by;
+    std::vector<lane_state>     _extra_lanes;
 
 }; // class object_cycle
 
@@ -132,7 +218,7 @@ private:
 inline void tag_invoke(boost::json::value_from_tag /*unused*/, boost::json::value& jv, const object_infection::infection_stat& td)
 {
     jv = {
-        { "infected_by", td.infected_by },
+        { "infected_by", td.infected_by.str() },
         { "time", td.time.seconds_since_epoch() }
     };
 }
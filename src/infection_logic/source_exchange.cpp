@@ -0,0 +1,93 @@
+/// @file infection_logic/source_exchange.cpp
+/// @brief Exchange of the infectious humans near the borders of the processes
+#include "source_exchange.hpp"
+
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/nonblocking.hpp>
+#include <boost/serialization/vector.hpp>
+#include <repast_hpc/GridDimensions.h>
+
+#include "../contagious_agent.hpp"
+#include "../space_wrapper.hpp"
+#include "human_infection_cycle.hpp"
+
+namespace {
+
+constexpr auto mpi_tag = 7316;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Find the processes close to this one, collective
+/// @param space The space wrapper, already split between the processes
+/// @param comm The MPI communicator
+/// @param radius The infection distance, the largest of all the lanes
+sti::source_exchange::source_exchange(const space_wrapper* space, communicator* comm, double radius)
+    : _space { space }
+    , _communicator { comm }
+{
+    const auto dims  = space->local_dimensions();
+    const auto local = std::vector<double> { dims.origin().getX(),
+                                             dims.origin().getY(),
+                                             dims.origin().getX() + dims.extents().getX(),
+                                             dims.origin().getY() + dims.extents().getY() };
+    auto       all   = std::vector<std::vector<double>> {};
+    boost::mpi::all_gather(*comm, local, all);
+
+    // A process is close if its area, expanded by the distance, overlaps this
+    // one. The relation is symmetric, so both ends of a pair exchange
+    for (auto p = 0; p < comm->size(); ++p) {
+        if (p == comm->rank()) continue;
+        const auto& area     = all[static_cast<std::size_t>(p)];
+        const auto  expanded = halo { p, area[0] - radius, area[1] - radius, area[2] + radius, area[3] + radius };
+        if (expanded.x0 <= local[2] && local[0] <= expanded.x1 && expanded.y0 <= local[3] && local[1] <= expanded.y1) {
+            _neighbours.push_back(expanded);
+        }
+    }
+    _outgoing.resize(_neighbours.size());
+    _incoming.resize(_neighbours.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Send the local sources to the close processes, and receive theirs
+/// @details The space wrapper snapshot must be valid, collective with the
+/// close processes
+void sti::source_exchange::exchange()
+{
+    for (auto& out : _outgoing) out.clear();
+
+    const auto& store = _space->store();
+    for (auto slot = agent_store::slot_type { 0 }; slot < store.size(); ++slot) {
+        const auto* agent = store.local_at(slot);
+        if (agent == nullptr) continue;
+        if (_space->is_static(store.id_at(slot))) continue; // Sent by the static registry
+
+        const auto* cycle = agent->get_infection_logic();
+        const auto  lanes = cycle->infectious_lanes();
+        if (lanes == 0) continue;
+
+        const auto location = store.location_at(slot);
+        for (auto n = std::size_t { 0 }; n < _neighbours.size(); ++n) {
+            if (_neighbours[n].contains(location)) _outgoing[n].push_back({ store.id_at(slot), cycle->subject(), location, lanes });
+        }
+    }
+
+    // Every close process gets a message, even if empty, so the receives
+    // are known in advance
+    auto requests = std::vector<boost::mpi::request> {};
+    for (auto n = std::size_t { 0 }; n < _neighbours.size(); ++n) {
+        requests.push_back(_communicator->isend(_neighbours[n].rank, mpi_tag, _outgoing[n]));
+        requests.push_back(_communicator->irecv(_neighbours[n].rank, mpi_tag, _incoming[n]));
+    }
+    boost::mpi::wait_all(requests.begin(), requests.end());
+
+    // In rank order, so the contacts are the same every run
+    _sources.clear();
+    for (const auto& in : _incoming) _sources.insert(_sources.end(), in.begin(), in.end());
+}
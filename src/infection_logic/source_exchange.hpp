@@ -0,0 +1,96 @@
+/// @file infection_logic/source_exchange.hpp
+/// @brief Exchange of the infectious humans near the borders of the processes
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <cstdint>
+#include <repast_hpc/AgentId.h>
+#include <vector>
+
+#include "../coordinates.hpp"
+
+// Fw. declarations
+namespace sti {
+class space_wrapper;
+} // namespace sti
+
+namespace sti {
+
+/// @brief An infectious human of another process, close to this one
+struct remote_source {
+    repast::AgentId     id;
+    std::uint64_t       subject; // The stable subject, see counter_rng::entity
+    coordinates<double> location;
+    std::uint8_t        lanes; // The infectious lanes, see human_infection_cycle
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& id;
+        ar& subject;
+        ar& location;
+        ar& lanes;
+    }
+};
+
+/// @brief Replacement of the Repast ghosts for the contacts between processes
+/// @details The ghosts only act as sources in the contact kernel, and a
+/// source only needs its id, location and infectious lanes, as all the
+/// infectious humans share the same probability and distance in each lane. With space.ghosts = infectious the
+/// Repast spaces have no buffer, and each tick this exchange sends the local
+/// infectious humans within the infection distance of another process to
+/// that process. The humans not infectious in any lane are never sent.
+class source_exchange {
+
+public:
+    using communicator = boost::mpi::communicator;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Find the processes close to this one, collective
+    /// @param space The space wrapper, already split between the processes
+    /// @param comm The MPI communicator
+    /// @param radius The infection distance, the largest of all the lanes
+    source_exchange(const space_wrapper* space, communicator* comm, double radius);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Send the local sources to the close processes, and receive theirs
+    /// @details The space wrapper snapshot must be valid, collective with the
+    /// close processes
+    void exchange();
+
+    /// @brief Get the sources received in the last exchange
+    /// @details Defined here, so the contact kernel links without the exchange
+    const std::vector<remote_source>& sources() const
+    {
+        return _sources;
+    }
+
+private:
+    /// @brief The area of a process, expanded by the infection distance
+    struct halo {
+        int    rank;
+        double x0, y0, x1, y1;
+
+        /// @brief Check if a point is inside the area
+        bool contains(const coordinates<double>& p) const
+        {
+            return p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1;
+        }
+    };
+
+    const space_wrapper* _space;
+    communicator*        _communicator;
+
+    std::vector<halo>                       _neighbours;
+    std::vector<std::vector<remote_source>> _outgoing;
+    std::vector<std::vector<remote_source>> _incoming;
+    std::vector<remote_source>              _sources;
+}; // class source_exchange
+
+} // namespace sti
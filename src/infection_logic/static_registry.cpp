@@ -0,0 +1,135 @@
+/// @file infection_logic/static_registry.cpp
+/// @brief The staff that never moves, replicated in the close processes
+#include "static_registry.hpp"
+
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/nonblocking.hpp>
+#include <boost/serialization/vector.hpp>
+#include <repast_hpc/GridDimensions.h>
+
+#include "../contagious_agent.hpp"
+#include "../space_wrapper.hpp"
+#include "human_infection_cycle.hpp"
+
+namespace {
+
+constexpr auto mpi_tag = 7317;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Find the processes close to this one, collective
+/// @param space The space wrapper, already split between the processes
+/// @param comm The MPI communicator
+/// @param radius The infection distance, the largest of all the lanes
+sti::static_registry::static_registry(const space_wrapper* space, communicator* comm, double radius)
+    : _communicator { comm }
+{
+    const auto dims  = space->local_dimensions();
+    const auto local = std::vector<double> { dims.origin().getX(),
+                                             dims.origin().getY(),
+                                             dims.origin().getX() + dims.extents().getX(),
+                                             dims.origin().getY() + dims.extents().getY() };
+    auto       all   = std::vector<std::vector<double>> {};
+    boost::mpi::all_gather(*comm, local, all);
+
+    // The same neighbours as the source exchange, a static agent is sent to
+    // the processes whose expanded area contains it
+    for (auto p = 0; p < comm->size(); ++p) {
+        if (p == comm->rank()) continue;
+        const auto& area     = all[static_cast<std::size_t>(p)];
+        const auto  expanded = halo { p, area[0] - radius, area[1] - radius, area[2] + radius, area[3] + radius };
+        if (expanded.x0 <= local[2] && local[0] <= expanded.x1 && expanded.y0 <= local[3] && local[1] <= expanded.y1) {
+            _neighbours.push_back(expanded);
+        }
+    }
+    _outgoing.resize(_neighbours.size());
+    _incoming.resize(_neighbours.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Register a local static agent, sent in the next exchange
+/// @param agent The agent, must outlive its registration
+/// @param location The location of the agent
+void sti::static_registry::add(const contagious_agent* agent, const coordinates<double>& location)
+{
+    _local[agent->getId()] = local_agent { agent, location };
+}
+
+/// @brief Unregister a local static agent, before destroying it
+/// @param id The id of the agent
+void sti::static_registry::remove(const repast::AgentId& id)
+{
+    const auto it = _local.find(id);
+    if (it == _local.end()) return;
+
+    if (it->second.published) send({ id, it->second.agent->get_infection_logic()->subject(), it->second.location, 0, true });
+    _local.erase(it);
+}
+
+/// @brief Send the changes of the local static agents to the close
+/// processes, and apply theirs
+/// @details Collective with the close processes
+void sti::static_registry::exchange()
+{
+    // The first exchange of an agent registers it, the next ones only send
+    // the changes of its lanes
+    for (auto& [key, local] : _local) {
+        const auto lanes = local.agent->get_infection_logic()->infectious_lanes();
+        if (local.published && lanes == local.sent) continue;
+
+        send({ local.agent->getId(), local.agent->get_infection_logic()->subject(), local.location, lanes, false });
+        local.sent      = lanes;
+        local.published = true;
+    }
+
+    // Every close process gets a message, even if empty, so the receives
+    // are known in advance
+    auto requests = std::vector<boost::mpi::request> {};
+    for (auto n = std::size_t { 0 }; n < _neighbours.size(); ++n) {
+        requests.push_back(_communicator->isend(_neighbours[n].rank, mpi_tag, _outgoing[n]));
+        requests.push_back(_communicator->irecv(_neighbours[n].rank, mpi_tag, _incoming[n]));
+    }
+    boost::mpi::wait_all(requests.begin(), requests.end());
+    for (auto& out : _outgoing) out.clear();
+
+    auto changed = false;
+    for (const auto& in : _incoming) {
+        for (const auto& e : in) {
+            changed = true;
+            if (e.removed) {
+                _remote.erase(e.id);
+            } else {
+                _remote[e.id] = remote_source { e.id, e.subject, e.location, e.lanes };
+            }
+        }
+    }
+    if (!changed) return;
+
+    // In key order, so the contacts are the same every run
+    _sources.clear();
+    for (const auto& [key, source] : _remote) {
+        if (source.lanes != 0) _sources.push_back(source);
+    }
+}
+
+/// @brief Get the number of static agents of the other processes known
+std::size_t sti::static_registry::remote_agents() const
+{
+    return _remote.size();
+}
+
+/// @brief Queue an event for the close processes containing its location
+/// @param e The event
+void sti::static_registry::send(const event& e)
+{
+    for (auto n = std::size_t { 0 }; n < _neighbours.size(); ++n) {
+        if (_neighbours[n].contains(e.location)) _outgoing[n].push_back(e);
+    }
+}
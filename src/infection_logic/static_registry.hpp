@@ -0,0 +1,131 @@
+/// @file infection_logic/static_registry.hpp
+/// @brief The staff that never moves, replicated in the close processes
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <cstdint>
+#include <map>
+#include <repast_hpc/AgentId.h>
+#include <vector>
+
+#include "../agent_key.hpp"
+#include "../coordinates.hpp"
+#include "source_exchange.hpp"
+
+// Fw. declarations
+namespace sti {
+class contagious_agent;
+class space_wrapper;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Replacement of the Repast ghosts for the agents that never move
+/// @details The doctors and the receptionists stay in their cell for the
+/// whole run, with staff.static = true they are taken out of the Repast
+/// spaces (space_wrapper::make_static()) so they are never balanced nor
+/// synchronized as ghosts. Instead, each process keeps a table of the static
+/// agents of the other processes within the infection distance, registered
+/// once with their location, and only the changes of their infectious lanes,
+/// or their removal when the staff is replaced, are sent as events to the
+/// close processes. The contact kernel evaluates them as remote sources.
+class static_registry {
+
+public:
+    using communicator = boost::mpi::communicator;
+
+    /// @brief A change of a static agent, sent to the close processes
+    struct event {
+        repast::AgentId     id;
+        std::uint64_t       subject; // The stable subject, see counter_rng::entity
+        coordinates<double> location;
+        std::uint8_t        lanes;   // The infectious lanes, see human_infection_cycle
+        bool                removed; // The agent left, the staff was replaced
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& id;
+            ar& subject;
+            ar& location;
+            ar& lanes;
+            ar& removed;
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Find the processes close to this one, collective
+    /// @param space The space wrapper, already split between the processes
+    /// @param comm The MPI communicator
+    /// @param radius The infection distance, the largest of all the lanes
+    static_registry(const space_wrapper* space, communicator* comm, double radius);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Register a local static agent, sent in the next exchange
+    /// @param agent The agent, must outlive its registration
+    /// @param location The location of the agent
+    void add(const contagious_agent* agent, const coordinates<double>& location);
+
+    /// @brief Unregister a local static agent, before destroying it
+    /// @param id The id of the agent
+    void remove(const repast::AgentId& id);
+
+    /// @brief Send the changes of the local static agents to the close
+    /// processes, and apply theirs
+    /// @details Collective with the close processes
+    void exchange();
+
+    /// @brief Get the static agents of the other processes infectious in some lane
+    /// @details Defined here, so the contact kernel links without the registry
+    const std::vector<remote_source>& sources() const
+    {
+        return _sources;
+    }
+
+    /// @brief Get the number of static agents of the other processes known
+    std::size_t remote_agents() const;
+
+private:
+    /// @brief The area of a process, expanded by the infection distance
+    struct halo {
+        int    rank;
+        double x0, y0, x1, y1;
+
+        /// @brief Check if a point is inside the area
+        bool contains(const coordinates<double>& p) const
+        {
+            return p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1;
+        }
+    };
+
+    /// @brief A static agent of this process
+    struct local_agent {
+        const contagious_agent* agent;
+        coordinates<double>     location;
+        std::uint8_t            sent {}; // The lanes the close processes know
+        bool                    published {};
+    };
+
+    /// @brief Queue an event for the close processes containing its location
+    /// @param e The event
+    void send(const event& e);
+
+    communicator* _communicator;
+
+    std::vector<halo>               _neighbours;
+    std::vector<std::vector<event>> _outgoing;
+    std::vector<std::vector<event>> _incoming;
+
+    // Ordered by key, so the events and the sources have a fixed order
+    std::map<agent_key, local_agent>   _local;
+    std::map<agent_key, remote_source> _remote;
+    std::vector<remote_source>         _sources;
+}; // class static_registry
+
+} // namespace sti
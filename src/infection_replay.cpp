@@ -0,0 +1,314 @@
+/// @file infection_replay.cpp
+/// @brief Run the infection logic alone, from the infection traces of a simulation
+#include "infection_replay.hpp"
+
+#include <algorithm>
+#include <boost/json/array.hpp>
+#include <boost/json/serialize.hpp>
+#include <fstream>
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
+#include <utility>
+
+#include "agent_locations.hpp"
+#include "contagious_agent.hpp"
+#include "counter_rng.hpp"
+#include "json_serialization.hpp"
+#include "movement_recorder.hpp"
+
+namespace {
+
+/// @brief Open the traces of all the processes of a run
+/// @throws sti::bad_trace If there are no traces, or they are not of the same run
+/// @param paths The paths of the traces
+std::vector<std::unique_ptr<sti::infection_trace_reader>> open_traces(const std::vector<std::string>& paths)
+{
+    auto traces = std::vector<std::unique_ptr<sti::infection_trace_reader>> {};
+    for (const auto& path : paths) traces.push_back(std::make_unique<sti::infection_trace_reader>(path));
+    if (traces.empty()) throw sti::bad_trace {};
+
+    // The same seed, tick and plan, and each process once
+    const auto& first = traces.front()->header();
+    auto        ranks = std::vector<std::int32_t> {};
+    for (const auto& t : traces) {
+        const auto& h = t->header();
+        if (h.seed != first.seed || h.seconds_per_tick != first.seconds_per_tick || h.width != first.width || h.height != first.height) {
+            throw sti::bad_trace {};
+        }
+        if (std::find(ranks.begin(), ranks.end(), h.rank) != ranks.end()) throw sti::bad_trace {};
+        ranks.push_back(h.rank);
+    }
+    return traces;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// LOCATIONS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief The locations of the humans in the current tick
+class sti::infection_replay::locations final : public agent_locations {
+
+public:
+    /// @brief Set the location of a human in the current tick
+    /// @param id The packed id of the human
+    /// @param location The continuous location
+    void set(std::uint64_t id, const coordinates<double>& location)
+    {
+        _locations[id] = location;
+    }
+
+    /// @brief Forget a human that left
+    /// @param id The packed id of the human
+    void remove(std::uint64_t id)
+    {
+        _locations.erase(id);
+    }
+
+    /// @brief Get the discrete location of an agent
+    /// @param id The id of the agent
+    /// @return The discrete (integral) location of the agent
+    coordinates<int> get_discrete_location(const repast::AgentId& id) const override
+    {
+        return get_continuous_location(id).discrete();
+    }
+
+    /// @brief Get the continuous location of an agent
+    /// @param id The id of the agent
+    /// @return The continuous point of the agent
+    coordinates<double> get_continuous_location(const repast::AgentId& id) const override
+    {
+        return _locations.at(movement_recorder::pack(id));
+    }
+
+private:
+    std::unordered_map<std::uint64_t, coordinates<double>> _locations;
+}; // class locations
+
+////////////////////////////////////////////////////////////////////////////////
+// REPLAY AGENT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief A human of the traces, only its infection logic
+/// @details The contact kernel visits contagious agents, the behaviour and
+/// the exchange between processes are not needed
+class sti::infection_replay::replay_agent final : public contagious_agent {
+
+public:
+    /// @brief Create a human as first seen in the traces
+    /// @param id The agent id, in the process 0
+    /// @param infection The infection logic
+    replay_agent(const repast::AgentId& id, human_infection_cycle infection)
+        : contagious_agent { id }
+        , _infection { std::move(infection) }
+    {
+    }
+
+    void pack(agent_wire& /*unused*/) const override { }
+
+    void unpack(const id_t& /*unused*/, const agent_wire& /*unused*/, std::uint8_t /*unused*/) override { }
+
+    state_versions versions() const override
+    {
+        return { _infection.version(), 0 };
+    }
+
+    type get_type() const override
+    {
+        return to_agent_enum(getId().agentType());
+    }
+
+    void act() override { }
+
+    human_infection_cycle* get_infection_logic() override
+    {
+        return &_infection;
+    }
+
+    const human_infection_cycle* get_infection_logic() const override
+    {
+        return &_infection;
+    }
+
+    boost::json::object stats() const override
+    {
+        return {
+            { "repast_id", to_string(getId()) },
+            { "type", to_string(get_type()) },
+            { "infection", _infection.stats() }
+        };
+    }
+
+    std::uint32_t seen {}; // The last tick in the traces
+
+private:
+    human_infection_cycle _infection;
+}; // class replay_agent
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Open the traces and create the objects recorded in them
+/// @throws bad_trace If a trace can't be read, or the traces are not of the same run
+/// @param hospital_props The hospital parameters, those of the replay
+/// @param traces The paths of the traces of all the processes of the run
+sti::infection_replay::infection_replay(const boost::json::object& hospital_props, const std::vector<std::string>& traces)
+    : _traces { open_traces(traces) }
+    , _frames(_traces.size())
+    , _clock { std::make_unique<clock>(_traces.front()->header().seconds_per_tick) }
+    , _locations { std::make_unique<locations>() }
+    , _factory { std::make_unique<infection_factory>(hospital_props, _locations.get(), _clock.get()) }
+    , _environment { hospital_props }
+    , _index { _traces.front()->header().width, _traces.front()->header().height }
+{
+    counter_rng::instance().seed(_traces.front()->header().seed);
+
+    // The objects keep their ids and subjects, and with them their random
+    // numbers. They are created before the first tick, as in the simulation
+    _objects.resize(_traces.size());
+    for (auto t = std::size_t { 0 }; t < _traces.size(); ++t) {
+        const auto& declared = _traces[t]->objects();
+        _objects[t].reserve(declared.size());
+        for (const auto& o : declared) {
+            _objects[t].push_back(_factory->make_object_infection(o.type, object_infection::STAGE::CLEAN, { o.rank, o.serial }, o.subject));
+        }
+    }
+
+    // The pools don't change anymore, the objects can be referenced
+    for (auto& pool : _objects) {
+        for (auto& o : pool) _cleanings.add(&o);
+    }
+}
+
+sti::infection_replay::~infection_replay() = default;
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Replay the next tick of the traces
+/// @throws bad_trace If the traces are truncated or out of step
+/// @return False if the traces have no more ticks
+bool sti::infection_replay::step()
+{
+    // All the processes wrote the same ticks
+    auto read = std::size_t { 0 };
+    for (auto t = std::size_t { 0 }; t < _traces.size(); ++t) {
+        if (_traces[t]->next(_frames[t])) ++read;
+    }
+    if (read == 0) return false;
+    if (read != _traces.size()) throw bad_trace {};
+    for (const auto& f : _frames) {
+        if (f.tick != _frames.front().tick) throw bad_trace {};
+    }
+
+    _tick = _frames.front().tick;
+    _clock->sync(_tick);
+    counter_rng::instance().tick(_tick);
+
+    // The humans, as seen when the contacts were evaluated
+    for (const auto& f : _frames) update_agents(f);
+    remove_absent();
+
+    // The ICU and its beds, and then the chairs, as each process did
+    for (const auto& f : _frames) {
+        if (f.icu_patients != infection_trace::no_icu) _environment.patients(static_cast<std::uint32_t>(f.icu_patients));
+    }
+    for (auto t = std::size_t { 0 }; t < _frames.size(); ++t) {
+        for (const auto& i : _frames[t].interactions) {
+            const auto agent = _agents.find(i.agent);
+            if (agent == _agents.end()) continue;
+
+            auto& object = _objects[t][i.object];
+            auto* human  = agent->second->get_infection_logic();
+            object.interact_with(*human);
+            human->interact_with(object);
+        }
+    }
+    _cleanings.tick();
+
+    // Infections between nearby humans
+    _index.clear();
+    for (auto& [id, agent] : _agents) _index.add(agent.get(), _locations->get_continuous_location(agent->getId()));
+    _index.build();
+    _contacts.run(_index);
+
+    // The stage changes and the infections of the environment
+    for (auto& [id, agent] : _agents) agent->get_infection_logic()->tick();
+    return true;
+}
+
+/// @brief Replay all the ticks of the traces
+/// @return The number of ticks replayed
+std::uint32_t sti::infection_replay::run()
+{
+    auto ticks = std::uint32_t { 0 };
+    while (step()) ++ticks;
+    return ticks;
+}
+
+/// @brief Create the humans not seen yet and update the rest
+/// @param frame A frame of the current tick
+void sti::infection_replay::update_agents(const infection_trace_reader::frame& frame)
+{
+    for (const auto& a : frame.agents) {
+        const auto mode = static_cast<human_infection_cycle::MODE>(a.mode);
+
+        auto& agent = _agents[a.id];
+        if (!agent) {
+            const auto id = infection_trace::unpack(a.id);
+            agent         = std::make_unique<replay_agent>(id,
+                                                   _factory->make_human_cycle(id,
+                                                                              a.subject,
+                                                                              static_cast<human_infection_cycle::STAGE>(a.stage),
+                                                                              mode,
+                                                                              datetime { a.infection_time }));
+        }
+
+        // The behaviour can change the mode and move the human to the ICU
+        auto* infection = agent->get_infection_logic();
+        infection->mode(mode);
+        infection->set_environment((a.flags & infection_trace::in_environment) != 0 ? &_environment : nullptr);
+        _locations->set(a.id, { a.x, a.y });
+        agent->seen = _tick;
+    }
+}
+
+/// @brief Remove the humans that are no longer in the traces
+void sti::infection_replay::remove_absent()
+{
+    for (auto it = _agents.begin(); it != _agents.end();) {
+        if (it->second->seen == _tick) {
+            ++it;
+            continue;
+        }
+        _removed.push_back(it->second->stats());
+        _locations->remove(it->first);
+        it = _agents.erase(it);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// STATISTICS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Save the infection of the humans and the objects
+/// @details The humans are written to replay_agents.json, including the
+/// ones that left, and the objects to replay_objects.json
+/// @param folderpath The folder to save the results to
+void sti::infection_replay::save(const std::string& folderpath) const
+{
+    auto agents = _removed;
+    for (const auto& [id, agent] : _agents) agents.push_back(agent->stats());
+    auto agents_file = std::ofstream { folderpath + "/replay_agents.json" };
+    agents_file << agents;
+
+    auto objects = boost::json::array {};
+    for (const auto& pool : _objects) {
+        for (const auto& o : pool) objects.push_back(o.stats());
+    }
+    auto objects_file = std::ofstream { folderpath + "/replay_objects.json" };
+    objects_file << objects;
+}
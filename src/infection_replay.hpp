@@ -0,0 +1,117 @@
+/// @file infection_replay.hpp
+/// @brief Run the infection logic alone, from the infection traces of a simulation
+#pragma once
+
+#include <boost/json/array.hpp>
+#include <boost/json/object.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clock.hpp"
+#include "infection_logic/cleaning_queue.hpp"
+#include "infection_logic/contact_kernel.hpp"
+#include "infection_logic/icu_environment.hpp"
+#include "infection_logic/infection_factory.hpp"
+#include "infection_logic/object_infection.hpp"
+#include "infection_trace.hpp"
+#include "spatial_index.hpp"
+
+namespace sti {
+
+/// @brief Runs the infection logic of a recorded simulation again
+/// @details The traces of all the processes of a run, see infection_trace,
+/// are read in lockstep, and every tick the humans, the chairs, the beds and
+/// the ICU environment run the same infection logic as in the simulation:
+/// the interactions with the objects, the cleanings, the contacts between
+/// nearby humans and the stage changes. The hospital parameters can differ
+/// from the recorded run, which makes the sensitivity studies of the
+/// infection parameters much cheaper than running the whole simulation:
+/// there are no behaviour, paths, Repast spaces nor MPI. The random numbers
+/// are the same as in the simulation, so with the same parameters the
+/// replay gets the same infections.
+///
+/// The movements are the recorded ones: a patient that doesn't get infected
+/// in the replay still leaves the hospital when it did in the simulation,
+/// and a human infected in the replay doesn't change its behaviour. The
+/// humans start in the recorded stage when they first appear in the traces.
+class infection_replay {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Open the traces and create the objects recorded in them
+    /// @throws bad_trace If a trace can't be read, or the traces are not of the same run
+    /// @param hospital_props The hospital parameters, those of the replay
+    /// @param traces The paths of the traces of all the processes of the run
+    infection_replay(const boost::json::object& hospital_props, const std::vector<std::string>& traces);
+
+    infection_replay(const infection_replay&) = delete;
+    infection_replay& operator=(const infection_replay&) = delete;
+
+    infection_replay(infection_replay&&) = delete;
+    infection_replay& operator=(infection_replay&&) = delete;
+
+    ~infection_replay();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Replay the next tick of the traces
+    /// @throws bad_trace If the traces are truncated or out of step
+    /// @return False if the traces have no more ticks
+    bool step();
+
+    /// @brief Replay all the ticks of the traces
+    /// @return The number of ticks replayed
+    std::uint32_t run();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // STATISTICS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Save the infection of the humans and the objects
+    /// @details The humans are written to replay_agents.json, including the
+    /// ones that left, and the objects to replay_objects.json
+    /// @param folderpath The folder to save the results to
+    void save(const std::string& folderpath) const;
+
+private:
+    /// @brief The locations of the humans in the current tick
+    class locations;
+
+    /// @brief A human of the traces, only its infection logic
+    class replay_agent;
+
+    /// @brief Create the humans not seen yet and update the rest
+    /// @param frame A frame of the current tick
+    void update_agents(const infection_trace_reader::frame& frame);
+
+    /// @brief Remove the humans that are no longer in the traces
+    void remove_absent();
+
+    std::vector<std::unique_ptr<infection_trace_reader>> _traces;
+    std::vector<infection_trace_reader::frame>           _frames; // Of the current tick, one per trace
+    std::uint32_t                                        _tick {};
+
+    std::unique_ptr<clock>             _clock;
+    std::unique_ptr<locations>         _locations;
+    std::unique_ptr<infection_factory> _factory;
+    icu_environment                    _environment;
+
+    std::vector<std::vector<object_infection>> _objects; // As declared in each trace
+    cleaning_queue                             _cleanings;
+
+    std::map<std::uint64_t, std::unique_ptr<replay_agent>> _agents; // By packed id
+    boost::json::array                                     _removed;
+
+    spatial_index  _index;
+    contact_kernel _contacts { 0 };
+}; // class infection_replay
+
+} // namespace sti
@@ -0,0 +1,240 @@
+/// @file infection_trace.cpp
+/// @brief Binary trace of the inputs of the infection logic, to replay it alone
+#include "infection_trace.hpp"
+
+#include <cstring>
+#include <repast_hpc/AgentId.h>
+
+#include "infection_logic/human_infection_cycle.hpp"
+#include "infection_logic/infection_source.hpp"
+#include "infection_logic/object_infection.hpp"
+#include "memory_usage.hpp"
+#include "movement_recorder.hpp"
+
+namespace {
+
+/// @brief The magic of the trace files
+constexpr char trace_magic[8] = { 'S', 'T', 'I', 'T', 'R', 'A', 'C', '1' };
+
+static_assert(sizeof(sti::infection_trace::header_record) == 40, "The header must have no padding");
+static_assert(sizeof(sti::infection_trace::frame_record) == 16, "The frame header must have no padding");
+static_assert(sizeof(sti::infection_trace::agent_record) == 40, "The agent record must have no padding");
+static_assert(sizeof(sti::infection_trace::interaction_record) == 16, "The interaction record must have no padding");
+
+/// @brief Read a value from the trace
+/// @throws sti::bad_trace If the file ends before the value
+template <typename T>
+void read_value(std::ifstream& file, T& value)
+{
+    if (!file.read(reinterpret_cast<char*>(&value), sizeof(T))) throw sti::bad_trace {};
+}
+
+/// @brief Read a number of records from the trace
+/// @throws sti::bad_trace If the file ends before the last record
+template <typename T>
+void read_records(std::ifstream& file, std::vector<T>& out, std::uint32_t n)
+{
+    out.resize(n);
+    if (n == 0) return;
+    if (!file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(n * sizeof(T)))) throw sti::bad_trace {};
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// INFECTION TRACE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the file, the header is written with the first frame
+/// @param path The path of the file
+/// @param rank The rank of the process
+/// @param seed The seed of the random numbers, see counter_rng
+/// @param seconds_per_tick The length of a tick
+/// @param width The width of the hospital plan
+/// @param height The height of the hospital plan
+sti::infection_trace::infection_trace(const std::string& path,
+                                      int                rank,
+                                      std::uint64_t      seed,
+                                      std::uint32_t      seconds_per_tick,
+                                      int                width,
+                                      int                height)
+    : _file { path, 1U << 20U }
+    , _header {}
+{
+    std::memcpy(_header.magic, trace_magic, sizeof(trace_magic));
+    _header.version          = version;
+    _header.rank             = rank;
+    _header.seed             = seed;
+    _header.seconds_per_tick = seconds_per_tick;
+    _header.width            = width;
+    _header.height           = height;
+}
+
+/// @brief Add an object of this process to the header
+/// @details Every object must be declared before the first frame
+/// @param object The object, must outlive the trace
+void sti::infection_trace::declare_object(const object_infection& object)
+{
+    const auto [it, inserted] = _object_index.try_emplace(&object, _header.objects);
+    if (!inserted) return;
+    ++_header.objects;
+
+    const auto  source = object.source();
+    const auto& type   = symbol_table::instance().name(source.type);
+    const auto  length = static_cast<std::uint32_t>(type.size());
+    _objects.append(reinterpret_cast<const char*>(&source.first), sizeof(source.first));
+    _objects.append(reinterpret_cast<const char*>(&source.second), sizeof(source.second));
+    _objects.append(reinterpret_cast<const char*>(&source.key), sizeof(source.key));
+    _objects.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    _objects.append(type);
+}
+
+/// @brief Start the frame of a new tick
+/// @param tick The tick
+void sti::infection_trace::begin_tick(std::uint32_t tick)
+{
+    _frame = { tick, no_icu, 0, 0 };
+    _agents.clear();
+    _interactions.clear();
+}
+
+/// @brief Set the patients in the ICU environment in the current tick
+/// @param patients The number of patients, only set by the real ICU
+void sti::infection_trace::icu_patients(std::uint32_t patients)
+{
+    _frame.icu_patients = static_cast<std::int32_t>(patients);
+}
+
+/// @brief Add an interaction between an object and a human to the current frame
+/// @param object The object, already declared
+/// @param agent The id of the human
+void sti::infection_trace::interaction(const object_infection& object, const repast::AgentId& agent)
+{
+    _interactions.push_back({ _object_index.at(&object), 0, movement_recorder::pack(agent) });
+}
+
+/// @brief Add a local agent to the current frame
+/// @param id The agent id
+/// @param location The agent location
+/// @param cycle The infection logic of the agent
+void sti::infection_trace::add_agent(const repast::AgentId&     id,
+                                     const coordinates<double>& location,
+                                     const human_infection_cycle& cycle)
+{
+    _agents.push_back({ movement_recorder::pack(id),
+                        cycle.subject(),
+                        location.x,
+                        location.y,
+                        cycle.infection_time().seconds_since_epoch(),
+                        static_cast<std::uint8_t>(cycle.stage()),
+                        static_cast<std::uint8_t>(cycle.mode()),
+                        cycle.environment() != nullptr ? in_environment : std::uint8_t { 0 },
+                        0 });
+}
+
+/// @brief Finish the frame of the current tick and queue it for writing
+void sti::infection_trace::end_tick()
+{
+    // The objects are known once the simulation starts
+    if (!_started) {
+        _file.append(&_header, sizeof(_header));
+        _file.append(_objects);
+        _started = true;
+    }
+
+    _frame.agents       = static_cast<std::uint32_t>(_agents.size());
+    _frame.interactions = static_cast<std::uint32_t>(_interactions.size());
+    _file.append(&_frame, sizeof(_frame));
+    _file.append(_agents.data(), _agents.size() * sizeof(agent_record));
+    _file.append(_interactions.data(), _interactions.size() * sizeof(interaction_record));
+}
+
+/// @brief Write the remaining frames and close the file
+void sti::infection_trace::close()
+{
+    _file.close();
+}
+
+/// @brief Get the heap bytes of the frame, the objects and the file buffers
+std::size_t sti::infection_trace::memory_bytes() const
+{
+    return memory::bytes(_agents) + memory::bytes(_interactions) + memory::bytes(_objects)
+         + memory::bytes(_object_index) + _file.memory_bytes();
+}
+
+/// @brief Restore an agent id packed by movement_recorder::pack
+/// @param packed The packed id
+/// @param current_rank The current rank of the agent
+/// @return The agent id
+repast::AgentId sti::infection_trace::unpack(std::uint64_t packed, int current_rank)
+{
+    const auto id            = static_cast<int>(static_cast<std::uint32_t>(packed & 0xFFFFFFFFULL));
+    const auto starting_rank = static_cast<int>(static_cast<std::int16_t>((packed >> 32U) & 0xFFFFU));
+    const auto type          = static_cast<int>(static_cast<std::int16_t>((packed >> 48U) & 0xFFFFU));
+    return { id, starting_rank, type, current_rank };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// INFECTION TRACE READER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Open a trace and read the header and the objects
+/// @throws bad_trace If the file can't be read or is not a trace
+/// @param path The path of the file
+sti::infection_trace_reader::infection_trace_reader(const std::string& path)
+    : _file { path, std::ios::binary }
+{
+    if (!_file) throw bad_trace {};
+    read_value(_file, _header);
+    if (std::memcmp(_header.magic, trace_magic, sizeof(trace_magic)) != 0 || _header.version != infection_trace::version) {
+        throw bad_trace {};
+    }
+
+    _objects.reserve(_header.objects);
+    for (auto i = std::uint32_t { 0 }; i < _header.objects; ++i) {
+        auto o      = object {};
+        auto length = std::uint32_t {};
+        read_value(_file, o.rank);
+        read_value(_file, o.serial);
+        read_value(_file, o.subject);
+        read_value(_file, length);
+        o.type.resize(length);
+        if (length > 0 && !_file.read(o.type.data(), length)) throw bad_trace {};
+        _objects.push_back(std::move(o));
+    }
+}
+
+/// @brief Get the header of the trace
+const sti::infection_trace_reader::header_record& sti::infection_trace_reader::header() const
+{
+    return _header;
+}
+
+/// @brief Get the objects of the process, in the order they are referenced
+const std::vector<sti::infection_trace_reader::object>& sti::infection_trace_reader::objects() const
+{
+    return _objects;
+}
+
+/// @brief Read the next frame
+/// @throws bad_trace If the frame is truncated
+/// @param out The frame read, its buffers are reused
+/// @return False if there are no more frames
+bool sti::infection_trace_reader::next(frame& out)
+{
+    auto header = infection_trace::frame_record {};
+    if (!_file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        // A partial header is a truncated file, no bytes is the end
+        if (_file.gcount() != 0) throw bad_trace {};
+        return false;
+    }
+
+    out.tick         = header.tick;
+    out.icu_patients = header.icu_patients;
+    read_records(_file, out.agents, header.agents);
+    read_records(_file, out.interactions, header.interactions);
+    for (const auto& i : out.interactions) {
+        if (i.object >= _objects.size()) throw bad_trace {};
+    }
+    return true;
+}
@@ -0,0 +1,238 @@
+/// @file infection_trace.hpp
+/// @brief Binary trace of the inputs of the infection logic, to replay it alone
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "clock.hpp"
+#include "coordinates.hpp"
+#include "record_stream.hpp"
+
+// Fw. declarations
+namespace repast {
+class AgentId;
+} // namespace repast
+
+namespace sti {
+class human_infection_cycle;
+class object_infection;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Error reading an infection trace
+struct bad_trace : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The infection trace is missing, truncated, or was written by another version";
+    }
+};
+
+/// @brief Writes every tick what the infection logic of a process sees
+/// @details The trace contains, for each tick, the local agents with their
+/// location and infection state, the humans that interacted with each chair
+/// or bed, and the number of patients in the ICU. It's enough to run the
+/// infection logic again, without the behaviour of the agents, see
+/// infection_replay. The file starts with a header and the objects of the
+/// process, followed by one frame per tick. The values are in the byte order
+/// of the host:
+///
+///     header:      char magic[8] = "STITRAC1", u32 version, i32 rank,
+///                  u64 seed, u32 seconds_per_tick, i32 width, i32 height,
+///                  u32 objects
+///     object:      i32 rank, u32 serial, u64 subject, u32 type_length,
+///                  char type[]
+///     frame:       u32 tick, i32 icu_patients (-1 = no ICU), u32 agents,
+///                  u32 interactions
+///     agent:       u64 packed_id, u64 subject, f64 x, f64 y,
+///                  u32 infection_time, u8 stage, u8 mode,
+///                  u8 flags (1 = in environment), u8 unused
+///     interaction: u32 object, u32 unused, u64 packed_id
+///
+/// The ids are packed as in movement_recorder, the objects are referenced by
+/// their position in the header. The subjects are the ones of the random
+/// numbers, see counter_rng, so the replay draws the same numbers. The interactions are in the order they were
+/// executed. The file is written by a background thread.
+class infection_trace {
+
+public:
+    constexpr static auto version        = std::uint32_t { 2 };
+    constexpr static auto in_environment = std::uint8_t { 1 };
+    constexpr static auto no_icu         = std::int32_t { -1 };
+
+    /// @brief The header of the file, followed by the objects
+    struct header_record {
+        char          magic[8];
+        std::uint32_t version;
+        std::int32_t  rank;
+        std::uint64_t seed;
+        std::uint32_t seconds_per_tick;
+        std::int32_t  width;
+        std::int32_t  height;
+        std::uint32_t objects;
+    };
+
+    /// @brief The header of a frame, followed by the agents and the interactions
+    struct frame_record {
+        std::uint32_t tick;
+        std::int32_t  icu_patients;
+        std::uint32_t agents;
+        std::uint32_t interactions;
+    };
+
+    /// @brief A local agent, at the moment of the contacts between humans
+    struct agent_record {
+        std::uint64_t id;
+        std::uint64_t subject;
+        double        x;
+        double        y;
+        std::uint32_t infection_time;
+        std::uint8_t  stage;
+        std::uint8_t  mode;
+        std::uint8_t  flags;
+        std::uint8_t  unused;
+    };
+
+    /// @brief A human interacting with an object, in both directions
+    struct interaction_record {
+        std::uint32_t object;
+        std::uint32_t unused;
+        std::uint64_t agent;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the file, the header is written with the first frame
+    /// @param path The path of the file
+    /// @param rank The rank of the process
+    /// @param seed The seed of the random numbers, see counter_rng
+    /// @param seconds_per_tick The length of a tick
+    /// @param width The width of the hospital plan
+    /// @param height The height of the hospital plan
+    infection_trace(const std::string& path,
+                    int                rank,
+                    std::uint64_t      seed,
+                    std::uint32_t      seconds_per_tick,
+                    int                width,
+                    int                height);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add an object of this process to the header
+    /// @details Every object must be declared before the first frame
+    /// @param object The object, must outlive the trace
+    void declare_object(const object_infection& object);
+
+    /// @brief Start the frame of a new tick
+    /// @param tick The tick
+    void begin_tick(std::uint32_t tick);
+
+    /// @brief Set the patients in the ICU environment in the current tick
+    /// @param patients The number of patients, only set by the real ICU
+    void icu_patients(std::uint32_t patients);
+
+    /// @brief Add an interaction between an object and a human to the current frame
+    /// @param object The object, already declared
+    /// @param agent The id of the human
+    void interaction(const object_infection& object, const repast::AgentId& agent);
+
+    /// @brief Add a local agent to the current frame
+    /// @param id The agent id
+    /// @param location The agent location
+    /// @param cycle The infection logic of the agent
+    void add_agent(const repast::AgentId& id, const coordinates<double>& location, const human_infection_cycle& cycle);
+
+    /// @brief Finish the frame of the current tick and queue it for writing
+    void end_tick();
+
+    /// @brief Write the remaining frames and close the file
+    void close();
+
+    /// @brief Get the heap bytes of the frame, the objects and the file buffers
+    std::size_t memory_bytes() const;
+
+    /// @brief Restore an agent id packed by movement_recorder::pack
+    /// @param packed The packed id
+    /// @param current_rank The current rank of the agent
+    /// @return The agent id
+    static repast::AgentId unpack(std::uint64_t packed, int current_rank = 0);
+
+private:
+    async_file    _file;
+    header_record _header;
+    std::string   _objects; // As written in the file
+    bool          _started {};
+
+    std::unordered_map<const object_infection*, std::uint32_t> _object_index;
+
+    frame_record                    _frame {};
+    std::vector<agent_record>       _agents;
+    std::vector<interaction_record> _interactions;
+}; // class infection_trace
+
+/// @brief Reads an infection trace, one frame at a time
+class infection_trace_reader {
+
+public:
+    using header_record      = infection_trace::header_record;
+    using agent_record       = infection_trace::agent_record;
+    using interaction_record = infection_trace::interaction_record;
+
+    /// @brief An object declared in the header
+    struct object {
+        std::int32_t  rank;
+        std::uint32_t serial;
+        std::uint64_t subject;
+        std::string   type;
+    };
+
+    /// @brief The inputs of the infection logic in a tick
+    struct frame {
+        std::uint32_t                   tick {};
+        std::int32_t                    icu_patients { infection_trace::no_icu };
+        std::vector<agent_record>       agents;
+        std::vector<interaction_record> interactions;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Open a trace and read the header and the objects
+    /// @throws bad_trace If the file can't be read or is not a trace
+    /// @param path The path of the file
+    explicit infection_trace_reader(const std::string& path);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the header of the trace
+    const header_record& header() const;
+
+    /// @brief Get the objects of the process, in the order they are referenced
+    const std::vector<object>& objects() const;
+
+    /// @brief Read the next frame
+    /// @throws bad_trace If the frame is truncated
+    /// @param out The frame read, its buffers are reused
+    /// @return False if there are no more frames
+    bool next(frame& out);
+
+private:
+    std::ifstream       _file;
+    header_record       _header {};
+    std::vector<object> _objects;
+}; // class infection_trace_reader
+
+} // namespace sti
@@ -0,0 +1,75 @@
+/// @file instrumentation.cpp
+/// @brief Runtime switches and timestamps of the performance metrics
+#include "instrumentation.hpp"
+
+#include <cstdio>
+#include <repast_hpc/Properties.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+/// @brief Read a clock in nanoseconds
+std::int64_t read_clock(clockid_t id)
+{
+    auto ts = timespec {};
+    clock_gettime(id, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+} // namespace
+
+/// @brief Read a boolean flag of the properties
+/// @param props The simulation properties
+/// @param key The name of the property
+/// @return True if the property is true, True or 1, false if missing
+bool sti::instrumentation::enabled(repast::Properties& props, const std::string& key)
+{
+    const auto& value = props.getProperty(key);
+    return value == "true" || value == "True" || value == "1";
+}
+
+/// @brief Nanoseconds of the monotonic clock
+std::int64_t sti::instrumentation::monotonic_ns()
+{
+    return read_clock(CLOCK_MONOTONIC);
+}
+
+/// @brief Nanoseconds of the coarse monotonic clock
+std::int64_t sti::instrumentation::coarse_ns()
+{
+    return read_clock(CLOCK_MONOTONIC_COARSE);
+}
+
+/// @brief Get the timestamp source selected in the properties
+/// @param props The simulation properties
+/// @return The function returning the timestamps
+sti::instrumentation::clock_function sti::instrumentation::select_clock(repast::Properties& props)
+{
+    if (props.getProperty("debug.clock") == "coarse") return &coarse_ns;
+    return &monotonic_ns;
+}
+
+/// @brief Get the resident set size of the process, in bytes
+/// @return The bytes, or 0 if /proc is not available
+std::int64_t sti::instrumentation::resident_bytes()
+{
+    auto* statm = std::fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+
+    // The second field is the resident pages
+    auto       size     = 0L;
+    auto       resident = 0L;
+    const auto read     = std::fscanf(statm, "%ld %ld", &size, &resident);
+    std::fclose(statm);
+    return read == 2 ? static_cast<std::int64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+}
+
+/// @brief Get the peak resident set size of the process, in bytes
+std::int64_t sti::instrumentation::peak_resident_bytes()
+{
+    auto usage = rusage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::int64_t>(usage.ru_maxrss) * 1024;
+}
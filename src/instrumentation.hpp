@@ -0,0 +1,57 @@
+/// @file instrumentation.hpp
+/// @brief Runtime switches and timestamps of the performance metrics
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Fw. declarations
+namespace repast {
+class Properties;
+} // namespace repast
+
+namespace sti {
+
+/// @brief Helpers of the metrics enabled in the properties file
+/// @details The metrics read their flag once at construction and branch on it,
+/// a disabled metric costs a predictable branch per call. The properties are:
+///  - debug.performance.metrics: per tick timings of the main loop
+///  - debug.pathfinder.statistics: pathfinder cache hits and time spent
+///  - debug.clock: the timestamp source, monotonic (default) or coarse
+///  - debug.hardware.counters: cycles, instructions, cache and branch misses
+///    of the ticks and the profiled phases, see hardware_counters
+///  - debug.memory.metrics: per tick heap bytes of the subsystems, with the
+///    performance metrics
+namespace instrumentation {
+
+    /// @brief A source of timestamps, in nanoseconds
+    using clock_function = std::int64_t (*)();
+
+    /// @brief Read a boolean flag of the properties
+    /// @param props The simulation properties
+    /// @param key The name of the property
+    /// @return True if the property is true, True or 1, false if missing
+    bool enabled(repast::Properties& props, const std::string& key);
+
+    /// @brief Nanoseconds of the monotonic clock
+    std::int64_t monotonic_ns();
+
+    /// @brief Nanoseconds of the coarse monotonic clock
+    /// @details Cheaper than monotonic_ns(), the resolution is the kernel tick,
+    /// usually between 1 and 4 ms
+    std::int64_t coarse_ns();
+
+    /// @brief Get the timestamp source selected in the properties
+    /// @param props The simulation properties
+    /// @return The function returning the timestamps
+    clock_function select_clock(repast::Properties& props);
+
+    /// @brief Get the resident set size of the process, in bytes
+    /// @return The bytes, or 0 if /proc is not available
+    std::int64_t resident_bytes();
+
+    /// @brief Get the peak resident set size of the process, in bytes
+    std::int64_t peak_resident_bytes();
+
+} // namespace instrumentation
+} // namespace sti
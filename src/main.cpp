@@ -6,9 +6,12 @@
 #include <unistd.h>
 
 #include <boost/mpi.hpp>
+#include <repast_hpc/Properties.h>
 #include <repast_hpc/RepastProcess.h>
 
+#include "ensemble.hpp"
 #include "model.hpp"
+#include "node_topology.hpp"
 
 int main(int argc, char** argv)
 {
@@ -19,10 +22,29 @@ int main(int argc, char** argv)
     const auto config_file = args.at(1); // Configuration file is arg 1
     const auto props_file  = args.at(2); // Properties file is arg 2
 
-    // Start MPI
-    boost::mpi::environment  env(argc, argv);
+    // Start MPI, the service thread of the managers is a second MPI caller.
+    // With the logic in several threads only the main thread calls MPI, but
+    // the level must still allow the other threads to exist
+    const auto early_props = repast::Properties { props_file, argc, argv, nullptr };
+    const auto threaded    = [&early_props](const std::string& key) {
+        const auto& value = early_props.getProperty(key);
+        return !value.empty() && value != "1";
+    };
+    auto threading = boost::mpi::threading::single;
+    if (threaded("act.threads") || threaded("tick.graph.threads")) threading = boost::mpi::threading::funneled;
+    if (early_props.getProperty("managers.thread") == "true") threading = boost::mpi::threading::multiple;
+    boost::mpi::environment  env(argc, argv, threading);
     boost::mpi::communicator world;
 
+    // Fail before running with a level of threads the MPI library can't give
+    if (env.thread_level() < threading) {
+        if (world.rank() == 0) {
+            std::cerr << "The MPI library provides the thread level " << env.thread_level()
+                      << ", the configuration requires " << threading << std::endl;
+        }
+        boost::mpi::environment::abort(1);
+    }
+
     // Look for the debug flag
     const auto it = std::find_if(args.begin(), args.end(), [](const auto& arg) {
         if (arg.length() >= 8) {
@@ -48,9 +70,32 @@ int main(int argc, char** argv)
         }
     }
 
-    repast::RepastProcess::init(config_file);
+    // Optionally run several replicas, each in a group of processes, with its
+    // properties appended to the arguments
+    auto replica      = sti::split_ensemble(props_file, argc, argv, world);
+    auto replica_args = std::vector<std::string> { args };
+    replica_args.insert(replica_args.end(), replica.overrides.begin(), replica.overrides.end());
+    auto replica_argv = std::vector<char*> {};
+    for (auto& arg : replica_args) replica_argv.push_back(arg.data());
+    const auto ensemble = replica.comm.size() != world.size();
+
+    // Optionally reorder the processes of the replica, before Repast splits
+    // the space, so the adjacent regions share a node. The balanced
+    // decomposition chooses its layout from the plan, it keeps the order
+    const auto decomposition = early_props.getProperty("space.decomposition");
+    if (early_props.getProperty("topology.aware") == "true" && (decomposition.empty() || decomposition == "uniform")) {
+        replica.comm = sti::node_topology::reorder(replica.comm,
+                                                   { boost::lexical_cast<int>(early_props.getProperty("x.process")),
+                                                     boost::lexical_cast<int>(early_props.getProperty("y.process")) });
+    }
+
+    repast::RepastProcess::init(config_file, &replica.comm);
 
-    auto                    model  = std::make_unique<sti::model>(props_file, argc, argv, &world);
+    auto                    model  = std::make_unique<sti::model>(props_file,
+                                                                  static_cast<int>(replica_argv.size()),
+                                                                  replica_argv.data(),
+                                                                  &replica.comm,
+                                                                  ensemble ? &world : nullptr);
     repast::ScheduleRunner& runner = repast::RepastProcess::instance()->getScheduleRunner();
 
     model->init();
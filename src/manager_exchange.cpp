@@ -0,0 +1,298 @@
+/// @file manager_exchange.cpp
+/// @brief Synchronization of all the managers in a single exchange per tick
+#include "manager_exchange.hpp"
+
+#include <boost/mpi/environment.hpp>
+#include <utility>
+
+#include "memory_usage.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// MPI TRANSPORT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the transport of a communicator
+/// @param communicator The MPI communicator, duplicated
+sti::mpi_transport::mpi_transport(const boost::mpi::communicator& communicator)
+    : _communicator { communicator, boost::mpi::comm_duplicate }
+{
+}
+
+/// @brief Get the rank of this process
+int sti::mpi_transport::rank() const
+{
+    return _communicator.rank();
+}
+
+/// @brief Get the number of processes
+int sti::mpi_transport::size() const
+{
+    return _communicator.size();
+}
+
+/// @brief Get the communicator the messages are packed for
+MPI_Comm sti::mpi_transport::packing() const
+{
+    return _communicator;
+}
+
+/// @brief Start the synchronous sends of the messages of a round
+/// @param tag The tag of the round
+/// @param outgoing The messages by destination, unchanged until receive()
+void sti::mpi_transport::send(int tag, const std::map<int, buffer_type>& outgoing)
+{
+    _sends.resize(outgoing.size());
+    auto request = _sends.begin();
+    for (const auto& [destination, buffer] : outgoing) {
+        MPI_Issend(buffer.data(), static_cast<int>(buffer.size()), MPI_PACKED, destination, tag, _communicator, &*request++);
+    }
+}
+
+/// @brief Receive the messages of a round, until all the sends are matched
+/// @param tag The tag of the round
+/// @param incoming Output, the messages by source
+void sti::mpi_transport::receive(int tag, std::map<int, buffer_type>& incoming)
+{
+    incoming.clear();
+
+    // A synchronous send completes once the receiver matched it. When all
+    // the processes have their sends completed, and entered the barrier,
+    // there are no more messages to receive
+    auto barrier        = MPI_Request {};
+    auto barrier_active = false;
+    auto done           = 0;
+    while (done == 0) {
+        auto arrived = 0;
+        auto status  = MPI_Status {};
+        MPI_Iprobe(MPI_ANY_SOURCE, tag, _communicator, &arrived, &status);
+        if (arrived != 0) {
+            auto count = 0;
+            MPI_Get_count(&status, MPI_PACKED, &count);
+            auto& buffer = incoming[status.MPI_SOURCE];
+            buffer.resize(static_cast<std::size_t>(count));
+            MPI_Recv(buffer.data(), count, MPI_PACKED, status.MPI_SOURCE, tag, _communicator, MPI_STATUS_IGNORE);
+        }
+
+        if (barrier_active) {
+            MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+        } else {
+            auto sent = 0;
+            MPI_Testall(static_cast<int>(_sends.size()), _sends.data(), &sent, MPI_STATUSES_IGNORE);
+            if (sent != 0) {
+                MPI_Ibarrier(_communicator, &barrier);
+                barrier_active = true;
+            }
+        }
+    }
+    _sends.clear();
+}
+
+/// @brief Get the heap bytes of the requests of the sends
+std::size_t sti::mpi_transport::memory_bytes() const
+{
+    return memory::bytes(_sends);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create an empty exchange over MPI
+/// @param communicator The MPI communicator
+sti::manager_exchange::manager_exchange(communicator_ptr communicator)
+    : _transport { std::make_unique<mpi_transport>(*communicator) }
+{
+}
+
+/// @brief Create an empty exchange over a transport
+/// @param transport The transport of the rounds
+sti::manager_exchange::manager_exchange(std::unique_ptr<exchange_transport> transport)
+    : _transport { std::move(transport) }
+{
+}
+
+/// @brief Stop the service thread, if any
+sti::manager_exchange::~manager_exchange()
+{
+    if (!_service.joinable()) return;
+    {
+        const auto lock = std::lock_guard { _mutex };
+        _closing        = true;
+    }
+    _changed.notify_all();
+    _service.join();
+}
+
+/// @brief Add a manager to the exchange
+/// @param participant The manager, must outlive the exchange
+void sti::manager_exchange::join(exchange_participant* participant)
+{
+    _participants.push_back(participant);
+}
+
+/// @brief Serve the requests and exchange the responses in a thread
+/// @details After post() the thread waits for the requests, serves them
+/// and exchanges the responses, and complete() waits for the thread. The
+/// managers are not touched by the caller in between, see post(), the
+/// results are the same. The thread is a second MPI caller
+/// @throws no_thread_multiple If MPI wasn't initialized with MPI_THREAD_MULTIPLE
+void sti::manager_exchange::serve_in_thread()
+{
+    if (boost::mpi::environment::thread_level() < boost::mpi::threading::multiple) throw no_thread_multiple {};
+    if (!_service.joinable()) _service = std::thread { [this]() { service_loop(); } };
+}
+
+/// @brief Exchange the requests and responses of all the managers
+/// @details Equivalent to post() followed by complete()
+void sti::manager_exchange::sync()
+{
+    post();
+    complete();
+}
+
+/// @brief Start sending the requests to the real managers
+/// @details The managers must not receive new requests until complete()
+void sti::manager_exchange::post()
+{
+    write_round([](const auto* participant, int destination) { return participant->pending_requests(destination); },
+                [](auto* participant, int destination, auto& ar) { participant->write_requests(destination, ar); });
+    _transport->send(mpi_tag, _outgoing);
+
+    if (_service.joinable()) {
+        {
+            const auto lock = std::lock_guard { _mutex };
+            _posted         = true;
+        }
+        _changed.notify_all();
+    }
+}
+
+/// @brief Wait for the requests, serve them, and exchange the responses
+/// @details Equivalent to serve() followed by finish()
+void sti::manager_exchange::complete()
+{
+    if (!_service.joinable()) {
+        serve();
+        finish();
+        return;
+    }
+
+    auto lock = std::unique_lock { _mutex };
+    _changed.wait(lock, [this]() { return !_posted; });
+    if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+/// @brief Wait for the requests, serve them, and start sending the responses
+void sti::manager_exchange::serve()
+{
+    _transport->receive(mpi_tag, _incoming);
+
+    // The requests are read in rank order, the managers see them in the same
+    // order regardless of the arrival
+    read_round([](auto* participant, int source, auto& ar) { participant->read_requests(source, ar); });
+
+    for (auto* participant : _participants) {
+        participant->serve();
+    }
+
+    write_round([](const auto* participant, int destination) { return participant->pending_responses(destination); },
+                [](auto* participant, int destination, auto& ar) { participant->write_responses(destination, ar); });
+    _transport->send(mpi_tag + 1, _outgoing);
+}
+
+/// @brief Wait for the responses and read them
+void sti::manager_exchange::finish()
+{
+    _transport->receive(mpi_tag + 1, _incoming);
+    read_round([](auto* participant, int source, auto& ar) { participant->read_responses(source, ar); });
+}
+
+/// @brief Check if no manager has requests or responses for any process
+bool sti::manager_exchange::idle() const
+{
+    for (const auto* participant : _participants) {
+        for (auto p = 0; p < _transport->size(); ++p) {
+            if (participant->pending_requests(p) || participant->pending_responses(p)) return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Get the heap bytes of the managers and the message buffers
+std::size_t sti::manager_exchange::memory_bytes() const
+{
+    auto total = memory::bytes(_participants) + memory::bytes(_outgoing) + memory::bytes(_incoming) + _transport->memory_bytes();
+    for (const auto* participant : _participants) total += participant->memory_bytes();
+    return total;
+}
+
+/// @brief Write the sections of the managers with something for each process
+/// @param pending Check if a manager has something for a process
+/// @param write Write the section of a manager for a process
+template <typename P, typename W>
+void sti::manager_exchange::write_round(P&& pending, W&& write)
+{
+    // One message per process, only if any manager has something for it
+    _outgoing.clear();
+    for (auto p = 0; p < _transport->size(); ++p) {
+        if (p == _transport->rank()) continue;
+
+        auto sections = std::vector<std::uint32_t> {};
+        for (auto i = std::size_t { 0 }; i < _participants.size(); ++i) {
+            if (pending(_participants[i], p)) sections.push_back(static_cast<std::uint32_t>(i));
+        }
+        if (sections.empty()) continue;
+
+        auto& buffer = _outgoing[p];
+        auto  ar     = exchange_participant::oarchive { _transport->packing(), buffer };
+        ar << static_cast<std::uint32_t>(sections.size());
+        for (const auto i : sections) {
+            ar << i;
+            write(_participants[i], p, ar);
+        }
+    }
+}
+
+/// @brief Read the sections of the messages received, in rank order
+/// @param read Read the section of a manager from a process
+template <typename R>
+void sti::manager_exchange::read_round(R&& read)
+{
+    for (auto& [source, buffer] : _incoming) {
+        auto ar       = exchange_participant::iarchive { _transport->packing(), buffer };
+        auto sections = std::uint32_t {};
+        ar >> sections;
+        for (auto s = std::uint32_t { 0 }; s < sections; ++s) {
+            auto i = std::uint32_t {};
+            ar >> i;
+            read(_participants.at(i), source, ar);
+        }
+    }
+}
+
+/// @brief Body of the service thread
+void sti::manager_exchange::service_loop()
+{
+    while (true) {
+        {
+            auto lock = std::unique_lock { _mutex };
+            _changed.wait(lock, [this]() { return _posted || _closing; });
+            if (!_posted) return;
+        }
+
+        auto error = std::exception_ptr {};
+        try {
+            serve();
+            finish();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            const auto lock = std::lock_guard { _mutex };
+            _error          = error;
+            _posted         = false;
+        }
+        _changed.notify_all();
+    }
+}
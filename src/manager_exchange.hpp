@@ -0,0 +1,323 @@
+/// @file manager_exchange.hpp
+/// @brief Synchronization of all the managers in a single exchange per tick
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/packed_iarchive.hpp>
+#include <boost/mpi/packed_oarchive.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mpi.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sti {
+
+/// @brief Error starting the service thread of the managers
+struct no_thread_multiple : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The managers thread needs MPI_THREAD_MULTIPLE";
+    }
+};
+
+/// @brief A manager exchanging requests and responses with the other processes
+/// @details Usually the manager is split in a real instance, in one process,
+/// and proxies in the rest. The proxies implement pending_requests(),
+/// write_requests() and read_responses(), the real instance read_requests(),
+/// serve(), pending_responses() and write_responses(). A manager distributed
+/// among all the processes implements all of them. The methods not implemented
+/// do nothing, and report nothing pending.
+class exchange_participant {
+
+public:
+    using iarchive = boost::mpi::packed_iarchive;
+    using oarchive = boost::mpi::packed_oarchive;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    exchange_participant() = default;
+
+    exchange_participant(const exchange_participant&) = default;
+    exchange_participant& operator=(const exchange_participant&) = default;
+
+    exchange_participant(exchange_participant&&) = default;
+    exchange_participant& operator=(exchange_participant&&) = default;
+
+    virtual ~exchange_participant() = default;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are requests for a process since the last exchange (proxy)
+    /// @param destination The rank of the process
+    virtual bool pending_requests(int /*unused*/) const { return false; }
+
+    /// @brief Write the requests for a process since the last exchange (proxy)
+    /// @param destination The rank of the process
+    /// @param ar The archive of the message to the process
+    virtual void write_requests(int /*unused*/, oarchive& /*unused*/) { }
+
+    /// @brief Read the requests of a proxy (real)
+    /// @param source The rank of the proxy
+    /// @param ar The archive of the message from the proxy
+    virtual void read_requests(int /*unused*/, iarchive& /*unused*/) { }
+
+    /// @brief Process the requests read, after all the proxies (real)
+    virtual void serve() { }
+
+    /// @brief Check if a proxy must receive responses, after serve() (real)
+    /// @param destination The rank of the proxy
+    virtual bool pending_responses(int /*unused*/) const { return false; }
+
+    /// @brief Write the responses for a proxy (real)
+    /// @param destination The rank of the proxy
+    /// @param ar The archive of the message to the proxy
+    virtual void write_responses(int /*unused*/, oarchive& /*unused*/) { }
+
+    /// @brief Read the responses of the real manager (proxy)
+    /// @param source The rank of the real manager
+    /// @param ar The archive of the message from the real manager
+    virtual void read_responses(int /*unused*/, iarchive& /*unused*/) { }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // MEMORY
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the heap bytes of the queues and the pending messages
+    /// @details An estimate, see memory::bytes()
+    virtual std::size_t memory_bytes() const { return 0; }
+
+}; // class exchange_participant
+
+/// @brief The messages of the rounds of the exchange between the processes
+/// @details A round sends at most one message to each process, and receives
+/// all the messages sent to this process in the same round. The messages
+/// are packed for the communicator of packing().
+class exchange_transport {
+
+public:
+    using buffer_type = boost::mpi::packed_oarchive::buffer_type;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    exchange_transport() = default;
+
+    exchange_transport(const exchange_transport&) = delete;
+    exchange_transport& operator=(const exchange_transport&) = delete;
+
+    exchange_transport(exchange_transport&&) = delete;
+    exchange_transport& operator=(exchange_transport&&) = delete;
+
+    virtual ~exchange_transport() = default;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the rank of this process
+    virtual int rank() const = 0;
+
+    /// @brief Get the number of processes
+    virtual int size() const = 0;
+
+    /// @brief Get the communicator the messages are packed for
+    virtual MPI_Comm packing() const = 0;
+
+    /// @brief Start sending the messages of a round
+    /// @param tag The tag of the round
+    /// @param outgoing The messages by destination, unchanged until receive()
+    virtual void send(int tag, const std::map<int, buffer_type>& outgoing) = 0;
+
+    /// @brief Receive the messages of a round, until the round is complete
+    /// @param tag The tag of the round
+    /// @param incoming Output, the messages by source
+    virtual void receive(int tag, std::map<int, buffer_type>& incoming) = 0;
+
+    /// @brief Get the heap bytes of the transport
+    virtual std::size_t memory_bytes() const { return 0; }
+
+}; // class exchange_transport
+
+/// @brief The rounds of the exchange over MPI, each one a non-blocking consensus
+/// @details Only the processes with something pending send a message, the
+/// receivers don't know how many to expect. The messages are sent with
+/// synchronous non-blocking sends, and the receivers probe for incoming
+/// messages until all the processes have their sends matched, detected with
+/// a non-blocking barrier (NBX). Idle processes add no messages, only their
+/// part of the barrier.
+class mpi_transport final : public exchange_transport {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the transport of a communicator
+    /// @param communicator The MPI communicator, duplicated
+    explicit mpi_transport(const boost::mpi::communicator& communicator);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the rank of this process
+    int rank() const override;
+
+    /// @brief Get the number of processes
+    int size() const override;
+
+    /// @brief Get the communicator the messages are packed for
+    MPI_Comm packing() const override;
+
+    /// @brief Start the synchronous sends of the messages of a round
+    /// @param tag The tag of the round
+    /// @param outgoing The messages by destination, unchanged until receive()
+    void send(int tag, const std::map<int, buffer_type>& outgoing) override;
+
+    /// @brief Receive the messages of a round, until all the sends are matched
+    /// @param tag The tag of the round
+    /// @param incoming Output, the messages by source
+    void receive(int tag, std::map<int, buffer_type>& incoming) override;
+
+    /// @brief Get the heap bytes of the requests of the sends
+    std::size_t memory_bytes() const override;
+
+private:
+    // Duplicated, the barriers and probes don't interfere with Repast
+    boost::mpi::communicator _communicator;
+    std::vector<MPI_Request> _sends;
+}; // class mpi_transport
+
+/// @brief Synchronize all the managers with one message per pair of processes
+/// @details The exchange has two rounds. First every process sends to each
+/// process the requests of all the managers for it, in a single message. Then
+/// every manager processes the requests, and the responses of all the managers
+/// in a process are sent back in a single message per destination. Each
+/// message contains one section per manager with something pending, preceded
+/// by the index of the manager in the exchange.
+/// Only the processes with something pending send a message. The rounds run
+/// over a transport, MPI by default (see mpi_transport), or an emulated
+/// network of processes inside a single one (see emulated_network).
+/// The exchange can be split with post() and complete(), to overlap the
+/// first round with work not depending on the managers, and complete() with
+/// serve() and finish(), to run the phases of all the emulated processes in
+/// lockstep. With serve_in_thread() everything from post() to complete()
+/// runs in a service thread, so a process receives and answers the requests
+/// as they arrive while it runs the logic not depending on the managers.
+/// All the processes must join the same managers, in the same order.
+class manager_exchange {
+
+public:
+    using communicator_ptr = boost::mpi::communicator*;
+
+    constexpr static auto mpi_tag = 6150; // Requests, responses use the next one
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create an empty exchange over MPI
+    /// @param communicator The MPI communicator
+    explicit manager_exchange(communicator_ptr communicator);
+
+    /// @brief Create an empty exchange over a transport
+    /// @param transport The transport of the rounds
+    explicit manager_exchange(std::unique_ptr<exchange_transport> transport);
+
+    manager_exchange(const manager_exchange&) = delete;
+    manager_exchange& operator=(const manager_exchange&) = delete;
+
+    manager_exchange(manager_exchange&&) = delete;
+    manager_exchange& operator=(manager_exchange&&) = delete;
+
+    /// @brief Stop the service thread, if any
+    ~manager_exchange();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add a manager to the exchange
+    /// @param participant The manager, must outlive the exchange
+    void join(exchange_participant* participant);
+
+    /// @brief Serve the requests and exchange the responses in a thread
+    /// @details After post() the thread waits for the requests, serves them
+    /// and exchanges the responses, and complete() waits for the thread. The
+    /// managers are not touched by the caller in between, see post(), the
+    /// results are the same. The thread is a second MPI caller
+    /// @throws no_thread_multiple If MPI wasn't initialized with MPI_THREAD_MULTIPLE
+    void serve_in_thread();
+
+    /// @brief Exchange the requests and responses of all the managers
+    /// @details Equivalent to post() followed by complete()
+    void sync();
+
+    /// @brief Start sending the requests to the real managers
+    /// @details The managers must not receive new requests until complete()
+    void post();
+
+    /// @brief Wait for the requests, serve them, and exchange the responses
+    /// @details Equivalent to serve() followed by finish(), or waits for the
+    /// service thread to run them
+    /// @throws Whatever the service thread threw
+    void complete();
+
+    /// @brief Wait for the requests, serve them, and start sending the responses
+    void serve();
+
+    /// @brief Wait for the responses and read them
+    void finish();
+
+    /// @brief Check if no manager has requests or responses for any process
+    /// @details With nothing pending a sync sends no message, see
+    /// tick.fast.forward in the model
+    bool idle() const;
+
+    /// @brief Get the heap bytes of the managers and the message buffers
+    /// @details An estimate, see memory::bytes()
+    std::size_t memory_bytes() const;
+
+private:
+    using buffer_type = exchange_transport::buffer_type;
+
+    /// @brief Write the sections of the managers with something for each process
+    /// @param pending Check if a manager has something for a process
+    /// @param write Write the section of a manager for a process
+    template <typename P, typename W>
+    void write_round(P&& pending, W&& write);
+
+    /// @brief Read the sections of the messages received, in rank order
+    /// @param read Read the section of a manager from a process
+    template <typename R>
+    void read_round(R&& read);
+
+    /// @brief Body of the service thread
+    void service_loop();
+
+    std::unique_ptr<exchange_transport> _transport;
+    std::vector<exchange_participant*>  _participants;
+    std::map<int, buffer_type>          _outgoing; // Only the messages to send
+    std::map<int, buffer_type>          _incoming; // Only the messages received
+
+    // The service thread, from post() to complete()
+    std::thread             _service;
+    std::mutex              _mutex;
+    std::condition_variable _changed;
+    bool                    _posted {};
+    bool                    _closing {};
+    std::exception_ptr      _error;
+}; // class manager_exchange
+
+} // namespace sti
@@ -0,0 +1,96 @@
+#include "manager_placement.hpp"
+
+#include <algorithm>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cstddef>
+#include <repast_hpc/GridDimensions.h>
+#include <repast_hpc/Properties.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "coordinates.hpp"
+#include "decomposition.hpp"
+#include "hospital_plan.hpp"
+#include "space_wrapper.hpp"
+
+namespace {
+
+/// @brief A manager to place, and the cells it serves
+struct role {
+    std::string                        property;
+    std::vector<sti::coordinates<int>> boxes;
+};
+
+/// @brief Get the managers of the hospital, from the most expensive
+std::vector<role> roles(const sti::hospital_plan& plan)
+{
+    auto out = std::vector<role> { { "chair.manager.rank", {} },
+                                   { "doctors.manager.rank", {} },
+                                   { "triage.manager.rank", {} },
+                                   { "reception.manager.rank", {} } };
+    for (const auto& c : plan.chairs()) out[0].boxes.push_back(c.location);
+    for (const auto& d : plan.doctors()) out[1].boxes.push_back(d.patient_chair);
+    for (const auto& t : plan.triages()) out[2].boxes.push_back(t.location);
+    for (const auto& r : plan.receptionists()) out[3].boxes.push_back(r.patient_chair);
+
+    std::stable_sort(out.begin(), out.end(), [](const role& a, const role& b) {
+        return a.boxes.size() > b.boxes.size();
+    });
+    return out;
+}
+
+} // namespace
+
+/// @brief Choose the ranks of the managers set to auto in the properties
+/// @param props The simulation properties, modified
+/// @param plan The hospital plan
+/// @param space The space, already split between the processes
+/// @param comm The MPI communicator
+void sti::place_managers(repast::Properties& props, const hospital_plan& plan, const space_wrapper& space, boost::mpi::communicator& comm)
+{
+    auto placed = roles(plan);
+    placed.erase(std::remove_if(placed.begin(), placed.end(), [&](const role& r) {
+                     return props.getProperty(r.property) != "auto";
+                 }),
+                 placed.end());
+    if (placed.empty()) return;
+
+    // The cost of the area of this process, followed by the boxes of each
+    // manager inside it
+    const auto area  = space.local_dimensions();
+    const auto costs = cell_costs(plan);
+    auto       local = std::vector<double>(placed.size() + 1, 0.0);
+    for (auto y = 0; y < plan.height(); ++y) {
+        for (auto x = 0; x < plan.width(); ++x) {
+            const auto cell = coordinates<int> { x, y };
+            const auto cost = costs[static_cast<std::size_t>(y * plan.width() + x)];
+            if (cost > 0 && area.contains(cell)) local[0] += cost;
+        }
+    }
+    for (auto r = std::size_t { 0 }; r < placed.size(); ++r) {
+        for (const auto& box : placed[r].boxes) {
+            if (area.contains(box)) local[r + 1] += 1;
+        }
+    }
+
+    auto all = std::vector<std::vector<double>> {};
+    boost::mpi::all_gather(comm, local, all);
+
+    auto load = std::vector<double> {};
+    for (const auto& process : all) load.push_back(process[0]);
+
+    for (auto r = std::size_t { 0 }; r < placed.size(); ++r) {
+        const auto key = [&](std::size_t p) {
+            return std::tuple { load[p], -all[p][r + 1], p };
+        };
+        auto best = std::size_t { 0 };
+        for (auto p = std::size_t { 1 }; p < all.size(); ++p) {
+            if (key(p) < key(best)) best = p;
+        }
+        load[best] += static_cast<double>(placed[r].boxes.size());
+        props.putProperty(placed[r].property, std::to_string(best));
+    }
+}
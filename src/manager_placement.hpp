@@ -0,0 +1,38 @@
+/// @file manager_placement.hpp
+/// @brief Automatic choice of the processes running the real managers
+#pragma once
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace repast {
+class Properties;
+} // namespace repast
+
+namespace sti {
+class hospital_plan;
+class space_wrapper;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Choose the ranks of the managers set to auto in the properties
+/// @details The reception, triage, doctors and chair managers accept
+/// <name>.manager.rank = auto. Each process estimates the cost of its agents
+/// from the cells of its area (see cell_costs()) and the processes share it.
+/// The managers are placed from the most to the least expensive, its cost
+/// being the number of boxes or chairs served, in the process with the lowest
+/// cost so far, preferring the process holding most of its boxes on ties.
+/// The real ICU stays where its entry is. All the processes reach the same
+/// placement, and write it back to the properties
+/// @param props The simulation properties, modified
+/// @param plan The hospital plan
+/// @param space The space, already split between the processes
+/// @param comm The MPI communicator
+void place_managers(repast::Properties& props, const hospital_plan& plan, const space_wrapper& space, boost::mpi::communicator& comm);
+
+} // namespace sti
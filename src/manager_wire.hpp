@@ -0,0 +1,371 @@
+/// @file manager_wire.hpp
+/// @brief Fixed layout messages of the managers, sent as MPI datatypes
+#pragma once
+
+#include <boost/mpi/datatype.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "agent_key.hpp"
+#include "chair_manager.hpp"
+#include "clock.hpp"
+#include "coordinates.hpp"
+#include "doctors_queue.hpp"
+
+namespace sti {
+
+/// @brief The key of an agent, without the current rank
+struct agent_id_wire {
+    std::uint64_t key;
+
+    agent_id_wire() = default;
+
+    explicit agent_id_wire(const agent_key& k)
+        : key { k.packed() }
+    {
+    }
+
+    agent_key value() const
+    {
+        return agent_key::from_packed(key);
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& key;
+    }
+};
+
+/// @brief A continuous location
+struct location_wire {
+    double x;
+    double y;
+
+    location_wire() = default;
+
+    explicit location_wire(const coordinates<double>& location)
+        : x { location.x }
+        , y { location.y }
+    {
+    }
+
+    coordinates<double> value() const
+    {
+        return { x, y };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& x;
+        ar& y;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// CHAIR MANAGER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief A chair_request_msg
+struct chair_request_wire {
+    agent_id_wire agent_id;
+    std::uint64_t subject;
+
+    chair_request_wire() = default;
+
+    explicit chair_request_wire(const chair_request_msg& msg)
+        : agent_id { msg.agent_id }
+        , subject { msg.subject }
+    {
+    }
+
+    chair_request_msg value() const
+    {
+        return { agent_id.value(), subject };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& agent_id;
+        ar& subject;
+    }
+};
+
+/// @brief A chair_release_msg
+struct chair_release_wire {
+    location_wire chair_location;
+
+    chair_release_wire() = default;
+
+    explicit chair_release_wire(const chair_release_msg& msg)
+        : chair_location { msg.chair_location }
+    {
+    }
+
+    chair_release_msg value() const
+    {
+        return { chair_location.value() };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& chair_location;
+    }
+};
+
+/// @brief A chair_response_msg, with the optional location as a flag
+struct chair_response_wire {
+    agent_id_wire agent_id;
+    location_wire chair_location;
+    std::int32_t  has_chair;
+
+    chair_response_wire() = default;
+
+    explicit chair_response_wire(const chair_response_msg& msg)
+        : agent_id { msg.agent_id }
+        , chair_location { msg.chair_location.value_or(coordinates<double> { 0.0, 0.0 }) }
+        , has_chair { msg.chair_location ? 1 : 0 }
+    {
+    }
+
+    chair_response_msg value() const
+    {
+        auto msg = chair_response_msg { agent_id.value(), {} };
+        if (has_chair != 0) msg.chair_location = chair_location.value();
+        return msg;
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& agent_id;
+        ar& chair_location;
+        ar& has_chair;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// QUEUES AND ICU
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief A turn of a queue, an agent and the location assigned
+struct turn_wire {
+    agent_id_wire agent_id;
+    location_wire location;
+
+    turn_wire() = default;
+
+    explicit turn_wire(const std::pair<agent_key, coordinates<double>>& turn)
+        : agent_id { turn.first }
+        , location { turn.second }
+    {
+    }
+
+    std::pair<agent_key, coordinates<double>> value() const
+    {
+        return { agent_id.value(), location.value() };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& agent_id;
+        ar& location;
+    }
+};
+
+/// @brief A response of the ICU, an agent and if it was admitted
+struct admission_wire {
+    agent_id_wire agent_id;
+    std::int32_t  admitted;
+
+    admission_wire() = default;
+
+    explicit admission_wire(const std::pair<agent_key, bool>& response)
+        : agent_id { response.first }
+        , admitted { response.second ? 1 : 0 }
+    {
+    }
+
+    std::pair<agent_key, bool> value() const
+    {
+        return { agent_id.value(), admitted != 0 };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& agent_id;
+        ar& admitted;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// DOCTORS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief An enqueue in the doctors, the specialty and the patient turn
+struct patient_turn_wire {
+    std::uint32_t specialty;
+    agent_id_wire agent_id;
+    std::uint32_t timeout;
+
+    patient_turn_wire() = default;
+
+    explicit patient_turn_wire(const std::pair<doctors_queue::specialty_type, doctors_queue::patient_turn>& enqueue)
+        : specialty { enqueue.first }
+        , agent_id { enqueue.second.id }
+        , timeout { enqueue.second.timeout.seconds_since_epoch() }
+    {
+    }
+
+    std::pair<doctors_queue::specialty_type, doctors_queue::patient_turn> value() const
+    {
+        return { static_cast<doctors_queue::specialty_type>(specialty), { agent_id.value(), datetime { timeout } } };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& specialty;
+        ar& agent_id;
+        ar& timeout;
+    }
+};
+
+/// @brief A dequeue from the doctors, the specialty and the agent
+struct specialty_id_wire {
+    std::uint32_t specialty;
+    agent_id_wire agent_id;
+
+    specialty_id_wire() = default;
+
+    explicit specialty_id_wire(const std::pair<doctors_queue::specialty_type, agent_key>& dequeue)
+        : specialty { dequeue.first }
+        , agent_id { dequeue.second }
+    {
+    }
+
+    std::pair<doctors_queue::specialty_type, agent_key> value() const
+    {
+        return { static_cast<doctors_queue::specialty_type>(specialty), agent_id.value() };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& specialty;
+        ar& agent_id;
+    }
+};
+
+/// @brief A doctors_queue::doctor_turn, the box is resolved to a location by
+/// the process of the patient
+struct doctor_turn_wire {
+    std::uint32_t specialty;
+    agent_id_wire agent_id;
+    std::uint32_t box;
+
+    doctor_turn_wire() = default;
+
+    explicit doctor_turn_wire(const doctors_queue::doctor_turn& turn)
+        : specialty { turn.specialty }
+        , agent_id { turn.id }
+        , box { turn.box }
+    {
+    }
+
+    doctors_queue::doctor_turn value() const
+    {
+        return { static_cast<doctors_queue::specialty_type>(specialty), agent_id.value(), box };
+    }
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& specialty;
+        ar& agent_id;
+        ar& box;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ARCHIVES
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write messages as an array of their wires
+/// @details The wires are MPI datatypes, so the packed archive writes the
+/// whole array with a single MPI_Pack, without per element serialization
+/// @param ar The archive of the message
+/// @param messages The messages to write
+template <typename Wire, typename Archive, typename T>
+void write_wires(Archive& ar, const std::vector<T>& messages)
+{
+    auto wires = std::vector<Wire> {};
+    wires.reserve(messages.size());
+    for (const auto& msg : messages) wires.emplace_back(msg);
+    ar << wires;
+}
+
+/// @brief Read messages written by write_wires(), appended to a vector
+/// @param ar The archive of the message
+/// @param messages The vector to append the messages to
+template <typename Wire, typename Archive, typename T>
+void read_wires(Archive& ar, std::vector<T>& messages)
+{
+    auto wires = std::vector<Wire> {};
+    ar >> wires;
+    messages.reserve(messages.size() + wires.size());
+    for (const auto& wire : wires) messages.push_back(wire.value());
+}
+
+} // namespace sti
+
+// The MPI datatypes are built from the serialize() of each wire, the packed
+// archives then copy the arrays of wires as a block
+BOOST_IS_MPI_DATATYPE(sti::agent_id_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::agent_id_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::agent_id_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::location_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::location_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::location_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::chair_request_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::chair_request_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::chair_request_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::chair_release_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::chair_release_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::chair_release_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::chair_response_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::chair_response_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::chair_response_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::turn_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::turn_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::turn_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::admission_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::admission_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::admission_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::patient_turn_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::patient_turn_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::patient_turn_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::specialty_id_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::specialty_id_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::specialty_id_wire, boost::serialization::track_never)
+
+BOOST_IS_MPI_DATATYPE(sti::doctor_turn_wire)
+BOOST_CLASS_IMPLEMENTATION(sti::doctor_turn_wire, boost::serialization::object_serializable);
+BOOST_CLASS_TRACKING(sti::doctor_turn_wire, boost::serialization::track_never)
@@ -0,0 +1,142 @@
+/// @file memory_usage.hpp
+/// @brief Estimates of the heap memory held by the containers
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sti {
+
+/// @brief Heap bytes held by the containers of the subsystems
+/// @details The estimates count the storage reserved by the containers and
+/// the nodes of the maps, with the pointers of the usual implementations,
+/// and the containers nested in them. They don't include the allocator
+/// headers, so they are a lower bound of the memory, but they grow with the
+/// real one and are cheap enough to be taken every tick: the elements are
+/// only visited if they can hold heap storage.
+namespace memory {
+
+    // Declared first, so the nested containers find all the overloads
+
+    template <typename T>
+    std::size_t bytes(const T& value);
+
+    template <typename T, typename A>
+    std::size_t bytes(const std::vector<T, A>& v);
+
+    std::size_t bytes(const std::string& s);
+
+    template <typename T, typename A>
+    std::size_t bytes(const std::list<T, A>& l);
+
+    template <typename K, typename V, typename C, typename A>
+    std::size_t bytes(const std::map<K, V, C, A>& m);
+
+    template <typename K, typename V, typename C, typename A>
+    std::size_t bytes(const std::multimap<K, V, C, A>& m);
+
+    template <typename K, typename V, typename H, typename E, typename A>
+    std::size_t bytes(const std::unordered_map<K, V, H, E, A>& m);
+
+    template <typename K, typename C, typename A>
+    std::size_t bytes(const std::set<K, C, A>& s);
+
+    /// @brief Get the heap bytes of a value without heap storage
+    template <typename T>
+    std::size_t bytes(const T& /*unused*/)
+    {
+        return 0;
+    }
+
+    /// @brief Get the heap bytes of a vector, the capacity and the elements' storage
+    template <typename T, typename A>
+    std::size_t bytes(const std::vector<T, A>& v)
+    {
+        auto total = v.capacity() * sizeof(T);
+        if constexpr (!std::is_trivially_copyable_v<T>) {
+            for (const auto& e : v) total += bytes(e);
+        }
+        return total;
+    }
+
+    /// @brief Get the heap bytes of a string, 0 if stored inline
+    inline std::size_t bytes(const std::string& s)
+    {
+        static const auto inline_capacity = std::string {}.capacity();
+        return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+    }
+
+    /// @brief Get the heap bytes of a list, a node with two links per element
+    template <typename T, typename A>
+    std::size_t bytes(const std::list<T, A>& l)
+    {
+        auto total = l.size() * (sizeof(T) + 2 * sizeof(void*));
+        if constexpr (!std::is_trivially_copyable_v<T>) {
+            for (const auto& e : l) total += bytes(e);
+        }
+        return total;
+    }
+
+    /// @brief Get the heap bytes of an ordered map, a node with three links
+    /// and a color per element
+    template <typename Map>
+    std::size_t tree_bytes(const Map& m)
+    {
+        using key_type    = typename Map::key_type;
+        using mapped_type = typename Map::mapped_type;
+
+        auto total = m.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void*));
+        if constexpr (!std::is_trivially_copyable_v<key_type> || !std::is_trivially_copyable_v<mapped_type>) {
+            for (const auto& [key, value] : m) total += bytes(key) + bytes(value);
+        }
+        return total;
+    }
+
+    /// @brief Get the heap bytes of a map
+    template <typename K, typename V, typename C, typename A>
+    std::size_t bytes(const std::map<K, V, C, A>& m)
+    {
+        return tree_bytes(m);
+    }
+
+    /// @brief Get the heap bytes of a multimap
+    template <typename K, typename V, typename C, typename A>
+    std::size_t bytes(const std::multimap<K, V, C, A>& m)
+    {
+        return tree_bytes(m);
+    }
+
+    /// @brief Get the heap bytes of a hash map, the buckets and a node with the
+    /// next link and the hash per element
+    template <typename K, typename V, typename H, typename E, typename A>
+    std::size_t bytes(const std::unordered_map<K, V, H, E, A>& m)
+    {
+        auto total = m.bucket_count() * sizeof(void*)
+            + m.size() * (sizeof(typename std::unordered_map<K, V, H, E, A>::value_type) + 2 * sizeof(void*));
+        if constexpr (!std::is_trivially_copyable_v<K> || !std::is_trivially_copyable_v<V>) {
+            for (const auto& [key, value] : m) total += bytes(key) + bytes(value);
+        }
+        return total;
+    }
+
+    /// @brief Get the heap bytes of a set, a node with three links and a
+    /// color per element
+    template <typename K, typename C, typename A>
+    std::size_t bytes(const std::set<K, C, A>& s)
+    {
+        auto total = s.size() * (sizeof(K) + 4 * sizeof(void*));
+        if constexpr (!std::is_trivially_copyable_v<K>) {
+            for (const auto& key : s) total += bytes(key);
+        }
+        return total;
+    }
+
+} // namespace memory
+} // namespace sti
@@ -2,11 +2,15 @@
 #include <boost/json/parse.hpp>
 #include <boost/json/serialize.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/mpi/collectives.hpp>
 #include <boost/mpi/communicator.hpp>
-#include <chrono>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -16,6 +20,7 @@
 #include <repast_hpc/initialize_random.h>
 #include <repast_hpc/Point.h>
 #include <repast_hpc/Properties.h>
+#include <repast_hpc/Random.h>
 #include <repast_hpc/RepastProcess.h>
 #include <repast_hpc/Schedule.h>
 #include <repast_hpc/SharedContext.h>
@@ -26,39 +31,120 @@
 #include <string>
 #include <vector>
 
+#include "act_phase.hpp"
 #include "agent_factory.hpp"
 #include "agent_package.hpp"
 #include "chair_manager.hpp"
+#include "checkpoint.hpp"
 #include "clock.hpp"
+#include "compiled_plan.hpp"
 #include "contagious_agent.hpp"
 #include "coordinates.hpp"
-#include "debug_flags.hpp"
+#include "counter_rng.hpp"
 #include "doctors.hpp"
 #include "doctors_queue.hpp"
 #include "entry.hpp"
 #include "exit.hpp"
+#include "hardware_counters.hpp"
 #include "hospital_plan.hpp"
+#include "instrumentation.hpp"
+#include "infection_logic/contact_kernel.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
 #include "infection_logic/infection_cycle.hpp"
 #include "infection_logic/infection_factory.hpp"
 #include "infection_logic/object_infection.hpp"
+#include "infection_logic/source_exchange.hpp"
+#include "infection_logic/static_registry.hpp"
+#include "epidemic_series.hpp"
+#include "infection_trace.hpp"
 #include "json_loader.hpp"
 #include "json_serialization.hpp"
+#include "manager_exchange.hpp"
+#include "manager_placement.hpp"
 #include "model.hpp"
+#include "movement_recorder.hpp"
+#include "node_topology.hpp"
 #include "staff_manager.hpp"
+#include "output_files.hpp"
+#include "output_tasks.hpp"
+#include "table_writer.hpp"
+#include "telemetry.hpp"
+#include "tick_graph.hpp"
 #include "triage.hpp"
+#include "wake_queue.hpp"
 #include "patient.hpp"
+#include "person.hpp"
+#include "phase_profiler.hpp"
 #include "reception.hpp"
 #include "icu.hpp"
 #include "icu/real_icu.hpp"
 
 namespace {
-auto now_in_ns()
+
+/// @brief Version of the checkpoint format, increased on every change
+constexpr auto checkpoint_version = 8U;
+
+/// @brief The profiled phases of the tick, in the order of tick_phases()
+namespace tick_phase {
+    enum : sti::phase_profiler::phase_id {
+        tick,
+        managers,
+        rhpc_sync,
+        snapshot,
+        logic,
+        exit,
+        chairs,
+        entry,
+        icu,
+        staff,
+        trace,
+        contacts,
+        timers,
+        agents,
+        walk,
+        series,
+        movements,
+    };
+} // namespace tick_phase
+
+/// @brief Get the names and the nesting of the profiled phases of the tick
+std::vector<sti::phase_profiler::definition> tick_phases()
 {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()).time_since_epoch()).count();
-}
+    using namespace tick_phase;
+    return {
+        { "tick", sti::phase_profiler::no_parent },
+        { "managers", tick },
+        { "rhpc_sync", tick },
+        { "snapshot", tick },
+        { "logic", tick },
+        { "exit", logic },
+        { "chairs", logic },
+        { "entry", logic },
+        { "icu", logic },
+        { "staff", logic },
+        { "trace", logic },
+        { "contacts", logic },
+        { "timers", logic },
+        { "agents", logic },
+        { "walk", logic },
+        { "series", logic },
+        { "movements", logic },
+    };
 }
 
+/// @brief The state read and written by the phases of the tick graph
+namespace tick_resource {
+    enum : sti::tick_graph::resource_set {
+        population = 1U << 0U, // The context, the spaces and their snapshot
+        people     = 1U << 1U, // The infection logic of the agents and the objects
+        trace      = 1U << 2U, // The infection trace
+        parked     = 1U << 3U, // The parked agents and the timers
+        all        = ~0U,
+    };
+} // namespace tick_resource
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // PROCESS METRICS
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,14 +153,23 @@ auto now_in_ns()
 class sti::process_metrics {
 
 public:
+    /// @brief Heap bytes of the subsystems at the end of a tick, see memory::bytes()
+    struct memory_metrics {
+        std::int64_t resident {}; // Resident set of the process
+        std::int64_t pathfinder {}; // Paths and flow fields
+        std::int64_t managers {}; // Queues, pools and pending messages of the managers, and the morgue
+        std::int64_t outputs {}; // Buffers of the exit and the movements
+        std::int64_t agents {}; // Pools of the agents, local and ghosts
+    };
+
     /// @brief Metrics of a single tick
     template <std::size_t MPIStages>
     struct tick_metrics {
         using instant_type               = std::int64_t;
         constexpr static auto mpi_stages = MPIStages;
 
-        tick_metrics()
-            : tick_start_time { now_in_ns() }
+        tick_metrics(std::int64_t start)
+            : tick_start_time { start }
         {
         }
 
@@ -82,20 +177,41 @@ public:
         std::array<std::int64_t, MPIStages> mpi_sync_ns; // Finish time of each MPI sync stages
         std::int32_t                        current_agents {}; // Number of agents in this process
         std::int64_t                        rhpc_sync_ns {}; // Finish time of the RepastHPC sync
+        std::int64_t                        overlap_ns {}; // Finish time of the work overlapped with the managers sync, if pipelined
         std::int64_t                        logic_ns {}; // Finish time of logic execution
+        std::int64_t                        critical_path_ns {}; // Longest chain of the logic phases, with tick.graph.threads
+        std::int64_t                        graph_work_ns {}; // Time of all the logic phases in all the threads, with tick.graph.threads
         std::int64_t                        tick_end_time {}; // Finish time of the tick
+        hardware_counters::values           counters {}; // Counted during the tick
+        hardware_counters::values           logic_counters {}; // Counted from the RepastHPC sync to the end of the logic
+        memory_metrics                      memory {}; // Only with debug.memory.metrics
     };
 
-    using per_tick_metrics = tick_metrics<5>;
+    using per_tick_metrics = tick_metrics<1>;
 
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
 
     /// @brief Construct a new metric collector
+    /// @details The per tick metrics are only collected if
+    /// debug.performance.metrics is enabled, the global ones always. The
+    /// hardware counters of each tick are added if they are available, and
+    /// the memory if debug.memory.metrics is enabled, and the critical path of
+    /// the logic with tick.graph.threads
+    /// @param props The simulation properties
     /// @param mpi_stages_tags The names of the MPI stages
-    process_metrics(const std::array<std::string, per_tick_metrics::mpi_stages>& mpi_stages_tags)
-        : _simulation_epoch { now_in_ns() }
+    /// @param counters The hardware counters of the process
+    process_metrics(repast::Properties&                                          props,
+                    const std::array<std::string, per_tick_metrics::mpi_stages>& mpi_stages_tags,
+                    const hardware_counters&                                     counters)
+        : _per_tick { instrumentation::enabled(props, "debug.performance.metrics") }
+        , _counted { _per_tick && counters.available() }
+        , _memory { _per_tick && instrumentation::enabled(props, "debug.memory.metrics") }
+        , _graph { _per_tick && !props.getProperty("tick.graph.threads").empty() }
+        , _counters { &counters }
+        , _now { instrumentation::select_clock(props) }
+        , _simulation_epoch { instrumentation::monotonic_ns() }
         , _mpi_stages_tags { mpi_stages_tags }
     {
     }
@@ -104,62 +220,104 @@ public:
     // GLOBAL METRICS
     ////////////////////////////////////////////////////////////////////////////
 
+    /// @brief Indicate the placement of the process in the nodes, with topology.aware
+    /// @param mapping The placement
+    void topology(const node_topology::mapping& mapping)
+    {
+        _mapping = mapping;
+        _mapped  = true;
+    }
+
     /// @brief Indicate the number of ticks, so the metrics can preallocate enough space
     void preallocate(std::size_t ticks)
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _per_tick_metrics.reserve(ticks);
-        }
+        if (_per_tick) _per_tick_metrics.reserve(ticks);
     }
 
     /// @brief Indicate that the program is going to save files
     void start_save()
     {
-        _presave_time = now_in_ns();
+        _presave_time = instrumentation::monotonic_ns();
     }
-    /// @brief Save the metrics to a file as a csv
-    /// @param path The folder to save the metrics to
-    /// @param process The process number
-    void save(const std::string& folder, int process)
+    /// @brief Save the metrics, as the tick_metrics and global_metrics tables
+    /// @param output The writer of the tables
+    void save(const table_writer& output)
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            auto tick_path = std::ostringstream {};
-            tick_path << folder << "/tick_metrics.p" << process << ".csv";
-            auto tick_file = std::ofstream { tick_path.str() };
-
-            tick_file << "tick,"
-                      << "start_time,"
-                      << "end_time,"
-                      << "agents,";
-            for (const auto& tag : _mpi_stages_tags) tick_file << tag << "_sync,";
-            tick_file << "rhpc_sync,"
-                      << "logic\n";
-
-            auto i = 0U;
-            for (const auto& metric : _per_tick_metrics) {
-                tick_file << i++ << ","
-                          << metric.tick_start_time << ','
-                          << metric.tick_end_time << ','
-                          << metric.current_agents << ",";
-                for (const auto& mpi_value : metric.mpi_sync_ns) tick_file << mpi_value << ",";
-                tick_file << metric.rhpc_sync_ns << ","
-                          << metric.logic_ns
-                          << "\n";
+        if (_per_tick) {
+            auto ticks = table {};
+
+            auto& tick       = ticks.add_column<std::int32_t>("tick");
+            auto& start_time = ticks.add_column<std::int64_t>("start_time");
+            auto& end_time   = ticks.add_column<std::int64_t>("end_time");
+            auto& agents     = ticks.add_column<std::int32_t>("agents");
+            auto  mpi_syncs  = std::vector<std::vector<std::int64_t>*> {};
+            for (const auto& tag : _mpi_stages_tags) mpi_syncs.push_back(&ticks.add_column<std::int64_t>(tag + "_sync"));
+            auto& rhpc_sync = ticks.add_column<std::int64_t>("rhpc_sync");
+            auto& overlap   = ticks.add_column<std::int64_t>("overlap");
+            auto& logic     = ticks.add_column<std::int64_t>("logic");
+
+            // The measures of the tick graph
+            auto* critical_path = _graph ? &ticks.add_column<std::int64_t>("critical_path") : nullptr;
+            auto* graph_work    = _graph ? &ticks.add_column<std::int64_t>("graph_work") : nullptr;
+
+            // The hardware counters, a column per counter in the tick and in the logic
+            auto counted       = std::vector<std::vector<std::int64_t>*> {};
+            auto logic_counted = std::vector<std::vector<std::int64_t>*> {};
+            for (const auto* name : hardware_counters::names) {
+                if (!_counted) break;
+                counted.push_back(&ticks.add_column<std::int64_t>(name));
+                logic_counted.push_back(&ticks.add_column<std::int64_t>("logic_" + std::string { name }));
             }
-        }
-        _end_time = now_in_ns();
 
-        auto global_path = std::ostringstream {};
-        global_path << folder << "/global_metrics.p" << process << ".csv";
-        auto global_file = std::ofstream { global_path.str() };
-
-        global_file << "epoch" << ','
-                    << "presave_time" << ','
-                    << "end_time" << '\n';
+            // The memory, a column per subsystem
+            auto memory = std::vector<std::pair<std::vector<std::int64_t>*, std::int64_t memory_metrics::*>> {};
+            if (_memory) {
+                memory.emplace_back(&ticks.add_column<std::int64_t>("resident_bytes"), &memory_metrics::resident);
+                memory.emplace_back(&ticks.add_column<std::int64_t>("pathfinder_bytes"), &memory_metrics::pathfinder);
+                memory.emplace_back(&ticks.add_column<std::int64_t>("managers_bytes"), &memory_metrics::managers);
+                memory.emplace_back(&ticks.add_column<std::int64_t>("outputs_bytes"), &memory_metrics::outputs);
+                memory.emplace_back(&ticks.add_column<std::int64_t>("agents_bytes"), &memory_metrics::agents);
+            }
 
-        global_file << _simulation_epoch << ','
-                    << _presave_time << ','
-                    << _end_time << '\n';
+            auto i = 0;
+            for (const auto& metric : _per_tick_metrics) {
+                tick.push_back(i++);
+                start_time.push_back(metric.tick_start_time);
+                end_time.push_back(metric.tick_end_time);
+                agents.push_back(metric.current_agents);
+                for (auto s = std::size_t { 0 }; s < mpi_syncs.size(); ++s) mpi_syncs[s]->push_back(metric.mpi_sync_ns.at(s));
+                rhpc_sync.push_back(metric.rhpc_sync_ns);
+                overlap.push_back(metric.overlap_ns);
+                logic.push_back(metric.logic_ns);
+                if (_graph) {
+                    critical_path->push_back(metric.critical_path_ns);
+                    graph_work->push_back(metric.graph_work_ns);
+                }
+                for (auto c = std::size_t { 0 }; c < counted.size(); ++c) {
+                    counted[c]->push_back(static_cast<std::int64_t>(metric.counters.at(c)));
+                    logic_counted[c]->push_back(static_cast<std::int64_t>(metric.logic_counters.at(c)));
+                }
+                for (const auto& [column, field] : memory) column->push_back(metric.memory.*field);
+            }
+            output.write("tick_metrics", ticks);
+        }
+        _end_time = instrumentation::monotonic_ns();
+
+        auto global = table {};
+        global.add_column<std::int64_t>("epoch").push_back(_simulation_epoch);
+        global.add_column<std::int64_t>("presave_time").push_back(_presave_time);
+        global.add_column<std::int64_t>("end_time").push_back(_end_time);
+        global.add_column<std::int64_t>("peak_resident_bytes").push_back(instrumentation::peak_resident_bytes());
+        if (_mapped) {
+            global.add_column<std::int32_t>("node").push_back(_mapping.node);
+            global.add_column<std::int32_t>("nodes").push_back(_mapping.nodes);
+            global.add_column<std::int32_t>("node_rank").push_back(_mapping.node_rank);
+            global.add_column<std::int32_t>("node_size").push_back(_mapping.node_size);
+            global.add_column<std::int32_t>("neighbours").push_back(_mapping.neighbours);
+            global.add_column<std::int32_t>("node_neighbours").push_back(_mapping.node_neighbours);
+            global.add_column<std::int32_t>("bound_threads").push_back(_mapping.bound_threads);
+        }
+        output.write("global_metrics", global);
     }
 
     ////////////////////////////////////////////////////////////////////////////
@@ -169,10 +327,10 @@ public:
     /// @brief Indicate the start of a new tick
     void new_tick()
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _per_tick_metrics.push_back(per_tick_metrics {});
-            _current_tick = _per_tick_metrics.end() - 1;
-        }
+        if (!_per_tick) return;
+        _per_tick_metrics.emplace_back(_now());
+        _current_tick = _per_tick_metrics.end() - 1;
+        if (_counted) _current_tick->counters = _counters->read();
     }
 
     /// @brief Notify the start of the MPI synchronization
@@ -180,48 +338,89 @@ public:
     template <std::size_t StageNumber>
     void finish_mpi_stage() const
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _current_tick->mpi_sync_ns.at(StageNumber) = now_in_ns();
-        }
+        if (_per_tick) _current_tick->mpi_sync_ns.at(StageNumber) = _now();
     }
 
     /// @brief Notify the start of the RepastHPC synchronization
     void finish_rhpc_sync() const
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _current_tick->rhpc_sync_ns = now_in_ns();
-        }
+        if (_per_tick) _current_tick->rhpc_sync_ns = _now();
+        if (_counted) _current_tick->logic_counters = _counters->read();
+    }
+
+    /// @brief Notify the end of the work overlapped with the managers sync
+    /// @details In the pipelined tick the managers sync finishes after this
+    /// instant, the time from the tick start is communication hidden behind
+    /// useful work, and the rest of the managers sync is waiting
+    void finish_overlap() const
+    {
+        if (_per_tick) _current_tick->overlap_ns = _now();
     }
 
     /// @brief Notify te start of the logic
     void finish_logic() const
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _current_tick->logic_ns = now_in_ns();
-        }
+        if (_per_tick) _current_tick->logic_ns = _now();
+        if (_counted) _current_tick->logic_counters = difference(_counters->read(), _current_tick->logic_counters);
     }
 
     /// @brief Indicate how many agents are currently in the simulation
     /// @param n The number of agents
     void agents(std::int32_t n) const
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _current_tick->current_agents = n;
-        }
+        if (_per_tick) _current_tick->current_agents = n;
+    }
+
+    /// @brief Indicate the measures of the tick graph
+    /// @param critical_path The time of the longest chain of dependent phases
+    /// @param work The time of all the phases in all the threads
+    void graph(std::int64_t critical_path, std::int64_t work) const
+    {
+        if (!_graph) return;
+        _current_tick->critical_path_ns = critical_path;
+        _current_tick->graph_work_ns    = work;
+    }
+
+    /// @brief Check if the memory of the subsystems is recorded every tick
+    bool tracking_memory() const
+    {
+        return _memory;
+    }
+
+    /// @brief Indicate the memory of the subsystems at the end of the tick
+    /// @param usage The heap bytes
+    void memory(const memory_metrics& usage) const
+    {
+        if (_memory) _current_tick->memory = usage;
     }
 
     /// @brief Indicate the end of a tick
     void tick_end() const
     {
-        if constexpr (sti::debug::per_tick_performance) {
-            _current_tick->tick_end_time = now_in_ns();
-        }
+        if (_per_tick) _current_tick->tick_end_time = _now();
+        if (_counted) _current_tick->counters = difference(_counters->read(), _current_tick->counters);
     }
 
 private:
+    /// @brief Get the counts between two reads of the counters
+    static hardware_counters::values difference(const hardware_counters::values& end, const hardware_counters::values& start)
+    {
+        auto out = hardware_counters::values {};
+        for (auto c = std::size_t { 0 }; c < out.size(); ++c) out.at(c) = end.at(c) - start.at(c);
+        return out;
+    }
+
+    bool                                                  _per_tick;
+    bool                                                  _counted;
+    bool                                                  _memory;
+    bool                                                  _graph;
+    const hardware_counters*                              _counters;
+    instrumentation::clock_function                       _now;
     std::int64_t                                          _simulation_epoch;
     std::int64_t                                          _presave_time {};
     std::int64_t                                          _end_time {};
+    node_topology::mapping                                _mapping {};
+    bool                                                  _mapped {};
     std::vector<per_tick_metrics>                         _per_tick_metrics {};
     decltype(_per_tick_metrics)::iterator                 _current_tick;
     std::array<std::string, per_tick_metrics::mpi_stages> _mpi_stages_tags {};
@@ -235,34 +434,37 @@ private:
 class sti::model::statistics {
 
 public:
-    using agent_id_type = repast::AgentId;
-    using location_type = coordinates<double>;
-
-    /// @brief Preallocate the number of entries in the vector
-    /// @param ticks The number of ticks the simulation will run
-    void preallocate_ticks(std::size_t ticks)
+    /// @brief Create the statistics, enabled by the properties
+    /// @details If movements.track is true the agents locations are written to
+    /// movements.p<rank>.bin, with a keyframe every movements.keyframe.interval
+    /// ticks
+    /// @param props The simulation properties
+    /// @param rank The rank of the process
+    statistics(repast::Properties& props, int rank)
     {
-        if constexpr (sti::debug::track_movements) {
-            _agents_locations.reserve(ticks);
-        }
+        if (props.getProperty("movements.track") != "true") return;
+
+        auto path = std::ostringstream {};
+        path << props.getProperty("output.folder") << "/movements.p" << rank << ".bin";
+
+        const auto& interval = props.getProperty("movements.keyframe.interval");
+        _movements           = std::make_unique<movement_recorder>(
+            path.str(),
+            interval.empty() ? movement_recorder::default_interval : boost::lexical_cast<std::uint32_t>(interval));
     }
 
-    /// @brief Indicate the beggining of a new tick
-    void new_tick(datetime epoch)
+    /// @brief Check if the agents locations are recorded
+    bool tracking_movements() const
     {
-        if constexpr (sti::debug::track_movements) {
-            _agents_locations.push_back({ epoch, {} });
-            _current_tick = _agents_locations.end() - 1;
-        }
+        return _movements != nullptr;
     }
 
-    /// @brief Indicate the number of agents that will be stored in this tick
+    /// @brief Indicate the beggining of a new tick
+    /// @param epoch The time of the tick
     /// @param nagents The number of agents for which positions will be collected
-    void preallocate_agents(std::size_t nagents)
+    void new_tick(datetime epoch, std::size_t nagents)
     {
-        if constexpr (sti::debug::track_movements) {
-            _current_tick->agents.reserve(nagents);
-        }
+        if (_movements) _movements->begin_tick(epoch, nagents);
     }
 
     /// @brief Add a new agent location to the current tick
@@ -270,78 +472,80 @@ public:
     /// @param location The agent location
     void add_agent_location(const repast::AgentId& id, const coordinates<double> location)
     {
-        if constexpr (sti::debug::track_movements) {
-            _current_tick->agents.push_back({ id, location });
-        }
+        if (_movements) _movements->add(id, location);
     }
 
-    /// @brief Save the stats to a file as a csv
-    /// @param folderpath The folder to save the metrics to
-    /// @param rank The process number
-    void save(const std::string& folderpath, int rank) const
+    /// @brief Indicate the end of the current tick
+    void end_tick()
     {
-        if constexpr (sti::debug::track_movements) {
-
-            auto filepath = std::ostringstream {};
-            filepath << folderpath << "/agents_locations.p" << rank << ".csv";
-            auto file = std::ofstream { filepath.str() };
-
-            file << "datetime" << ','
-                 << "repast_id" << ','
-                 << "x" << ','
-                 << "y" << '\n';
-
-            for (const auto& iteration : _agents_locations) {
-                for (const auto& agent : iteration.agents) {
-                    file << iteration.time.seconds_since_epoch() << ","
-                         << to_string(agent.id) << ","
-                         << agent.location.x << ','
-                         << agent.location.y << '\n';
-                }
-            }
-        }
+        if (_movements) _movements->end_tick();
     }
 
-    struct agent_location {
-        agent_id_type id;
-        location_type location;
-    };
+    /// @brief Write the remaining locations and close the file
+    void save()
+    {
+        if (_movements) _movements->close();
+    }
 
-    struct tick_entry {
-        datetime                    time;
-        std::vector<agent_location> agents;
-    };
+    /// @brief Get the heap bytes of the locations not yet written
+    std::size_t memory_bytes() const
+    {
+        return _movements ? _movements->memory_bytes() : 0;
+    }
 
 private:
-    std::vector<tick_entry>               _agents_locations;
-    decltype(_agents_locations)::iterator _current_tick;
+    std::unique_ptr<movement_recorder> _movements;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
 ////////////////////////////////////////////////////////////////////////////////
 
-sti::model::model(const std::string& props_file, int argc, char** argv, boost::mpi::communicator* comm)
+/// @brief Create the simulation
+/// @param props_file The properties file
+/// @param argc The arguments count
+/// @param argv The arguments, key=value ones override the properties
+/// @param comm The processes running this simulation
+/// @param setup The processes of all the replicas of an ensemble, sharing
+/// the read-only setup, or nullptr if there is a single replica
+sti::model::model(const std::string& props_file, int argc, char** argv, boost::mpi::communicator* comm, boost::mpi::communicator* setup)
     : _communicator { comm }
+    , _setup { setup != nullptr ? setup : comm }
     , _props { new repast::Properties(props_file, argc, argv, comm) }
     , _context(comm)
     , _rank { repast::RepastProcess::instance()->rank() }
     , _stop_at { 0 }
-    , _hospital_props { load_json(_props->getProperty("hospital.file")) }
+    // The hospital file can be the JSON or the plan compiled from it with
+    // sti-compile-plan, mapped without parsing by all the processes
+    , _compiled_plan { compiled_plan::is_compiled(_props->getProperty("hospital.file"))
+                           ? std::make_unique<compiled_plan>(_props->getProperty("hospital.file"))
+                           : nullptr }
+    , _hospital_props { _compiled_plan ? _compiled_plan->parameters() : load_json(_props->getProperty("hospital.file")) }
     , _clock { std::make_unique<clock>(boost::lexical_cast<std::uint64_t>(_props->getProperty("seconds.per.tick"))) }
-    , _hospital { _hospital_props, _clock.get() }
-    , _spaces { _hospital, *_props, _context, comm }
-    , _pmetrics { new process_metrics { {
-          "chairs",
-          "reception",
-          "triage",
-          "doctors",
-          "icu",
-      } } }
-    , _stats { new statistics {} }
+    , _hospital(_compiled_plan ? hospital_plan { *_compiled_plan, _clock.get() } : hospital_plan { _hospital_props, _clock.get() })
+    , _spaces { _hospital,
+                *_props,
+                _context,
+                comm,
+                infection_factory::max_infect_distance(_hospital_props) }
+    , _counters { std::make_unique<hardware_counters>(instrumentation::enabled(*_props, "debug.hardware.counters")) }
+    , _pmetrics { new process_metrics { *_props,
+                                        {
+                                            "managers",
+                                        },
+                                        *_counters } }
+    , _stats { new statistics { *_props, _rank } }
+    , _profiler { std::make_unique<phase_profiler>(instrumentation::enabled(*_props, "debug.phase.profile"),
+                                                   instrumentation::select_clock(*_props),
+                                                   tick_phases(),
+                                                   instrumentation::enabled(*_props, "debug.hardware.counters") ? _counters.get() : nullptr) }
+    , _contacts { std::make_unique<contact_kernel>(_rank) }
+    , _timers { std::make_unique<wake_queue>(_clock->seconds_per_tick()) }
 {
-    // Initialize the random generation
+    // Initialize the random generation, the counter-based generator uses the
+    // same seed as Repast, shared by all the processes
     repast::initializeRandom(*_props, comm);
+    counter_rng::instance().seed(repast::Random::instance()->seed());
 }
 
 sti::model::~model() = default;
@@ -350,11 +554,120 @@ sti::model::~model() = default;
 /// @details Loads the map
 void sti::model::init()
 {
+    // Optionally reuse the paths generated in previous runs with this plan
+    const auto& path_cache = _props->getProperty("pathfinder.cache.file");
+    if (!path_cache.empty()) {
+        _hospital.get_pathfinder()->use_cache_file(path_cache);
+    }
+
+    // Optionally precompute the paths to every destination, otherwise the
+    // pathfinder runs A* lazily on each cache miss. The fields can be stored
+    // per process or shared by all the processes in a node, including the
+    // other replicas of an ensemble, which must use the same plan
+    const auto& flow_fields = _props->getProperty("pathfinder.flow.fields");
+    if (flow_fields == "true") {
+        _hospital.precompute_paths();
+    } else if (flow_fields == "shared") {
+        _hospital.get_pathfinder()->precompute_shared(_hospital.destinations(), _setup);
+    }
+
+    // Optionally bound the memory of the paths found with A*, evicting the
+    // least recently used destinations, or the least used ones
+    const auto& path_budget = _props->getProperty("pathfinder.cache.budget");
+    if (!path_budget.empty()) {
+        const auto eviction = _props->getProperty("pathfinder.cache.eviction") == "frequency" ? pathfinder::EVICTION::FREQUENCY
+                                                                                               : pathfinder::EVICTION::LRU;
+        _hospital.get_pathfinder()->bound_cache(boost::lexical_cast<std::size_t>(path_budget), eviction);
+    }
+
+    // Optionally search the paths in a hierarchy of clusters, for large plans
+    const auto& path_clusters = _props->getProperty("pathfinder.hierarchy.cluster");
+    if (!path_clusters.empty()) {
+        _hospital.get_pathfinder()->use_hierarchy(boost::lexical_cast<int>(path_clusters));
+    }
+
+    // Optionally collect the pathfinder statistics
+    if (instrumentation::enabled(*_props, "debug.pathfinder.statistics")) {
+        _hospital.get_pathfinder()->collect_statistics(instrumentation::select_clock(*_props));
+    }
+
+    // Optionally run the agents logic in several threads, the writes to the
+    // managers are deferred and executed in agent order before the sync
+    const auto& act_threads = _props->getProperty("act.threads");
+    if (!act_threads.empty() && act_threads != "1") {
+        _act = std::make_unique<act_phase>(boost::lexical_cast<int>(act_threads));
+    }
+
+    // Optionally run the independent phases of the logic concurrently, with
+    // the agents loop split in tasks. The chunks defer their writes too
+    const auto& graph_threads = _props->getProperty("tick.graph.threads");
+    if (!graph_threads.empty()) {
+        _graph = std::make_unique<tick_graph>(boost::lexical_cast<int>(graph_threads), instrumentation::select_clock(*_props));
+        if (!_act) _act = std::make_unique<act_phase>(_graph->threads());
+    }
+
+    // Optionally bind the threads of the logic to the cores of the process,
+    // before their first phase, and report the placement of the processes
+    // in the nodes. The processes were reordered by main()
+    if (_props->getProperty("topology.aware") == "true") {
+        _topology = std::make_unique<node_topology>(*_communicator);
+        _topology->bind_threads(_act ? _act->threads() : 1);
+        _pmetrics->topology(_topology->report(_spaces, *_communicator));
+    }
+
+    // Optionally replace the Repast ghosts by an exchange of the infectious
+    // humans close to the borders of the processes
+    if (_props->getProperty("space.ghosts") == "infectious") {
+        _sources = std::make_unique<source_exchange>(&_spaces,
+                                                     _communicator,
+                                                     infection_factory::max_infect_distance(_hospital_props));
+        _contacts->use_remote_sources(_sources.get());
+    }
+
+    // Optionally search the close pairs in an accelerator, if built with OFFLOAD
+    _contacts->use_device(_props->getProperty("contacts.device") == "true");
+
+    // The managers set to auto are placed where they collide the least with
+    // the agents of each process
+    place_managers(*_props, _hospital, _spaces, *_communicator);
+
     _chair_manager = make_chair_manager(*_props, _communicator, _hospital, &_spaces);
     _reception.reset(new reception { *_props, _communicator, _hospital });
     _triage.reset(new triage { *_props, _hospital_props, _communicator, _clock.get(), _hospital });
     _doctors = std::make_unique<doctors>(*_props, _hospital_props, _communicator, _hospital);
-    _icu.reset(new icu(&_context, _communicator, _hospital_props, _hospital, &_spaces, _clock.get()));
+    _icu.reset(new icu(&_context,
+                       _communicator,
+                       _hospital_props,
+                       _hospital,
+                       &_spaces,
+                       _clock.get(),
+                       _props->getProperty("output.folder"),
+                       _props->getProperty("icu.admission") == "rma"));
+
+    // All the managers are synchronized together, in the same order in all
+    // the processes. Optionally overlap the synchronization with the logic
+    // not depending on the managers
+    _pipelined = _props->getProperty("tick.pipelined") == "true";
+
+    // Optionally skip the synchronizations with nothing to send, see tick()
+    _fast_forward = _props->getProperty("tick.fast.forward") == "true";
+
+    // Optionally skip the Repast status and projection synchronizations when
+    // no agent was created, removed, or moved near the border of a process
+    _skip_space_sync = _props->getProperty("tick.skip.space.sync") == "true";
+    _managers  = std::make_unique<manager_exchange>(_communicator);
+    _managers->join(_chair_manager.get());
+    _managers->join(_reception->queues());
+    _managers->join(_triage->queues());
+    _managers->join(_doctors->queues());
+    _managers->join(&_icu->admission());
+
+    // Optionally serve the managers in a thread of their own, while the
+    // logic not depending on them runs. The tick is pipelined to have it
+    if (_props->getProperty("managers.thread") == "true") {
+        _managers->serve_in_thread();
+        _pipelined = true;
+    }
     _agent_factory.reset(new agent_factory { _communicator,
                                              &_context,
                                              &_spaces,
@@ -365,20 +678,41 @@ void sti::model::init()
                                              _triage.get(),
                                              _doctors.get(),
                                              _icu.get(),
+                                             _timers.get(),
                                              _hospital_props });
     _staff_manager = std::make_unique<sti::staff_manager>(&_context, _agent_factory.get(), &_spaces, &_hospital, &_hospital_props);
 
+    // Optionally keep the doctors and the receptionists out of the Repast
+    // spaces, the close processes get their changes instead of ghosts
+    if (_props->getProperty("staff.static") == "true") {
+        _static_staff = std::make_unique<static_registry>(&_spaces,
+                                                          _communicator,
+                                                          infection_factory::max_infect_distance(_hospital_props));
+        _contacts->use_static_sources(_static_staff.get());
+        _staff_manager->use_static(_static_staff.get());
+    }
+
     // Create the package provider and receiver
-    _provider = std::make_unique<agent_provider>(&_context, _communicator);
-    _receiver = std::make_unique<agent_receiver>(&_context, _agent_factory.get(), _communicator);
+    _provider = std::make_unique<agent_provider>(&_context);
+    _receiver = std::make_unique<agent_receiver>(&_context, _agent_factory.get());
 
     // Create the entry logic, if the entry is in this process, and send the
     // rest of the processes the ticks to execute
     const auto en = _hospital.entry();
     if (_spaces.local_dimensions().contains(std::vector { en.location.x, en.location.y })) {
-        auto       patient_distribution = load_patient_distribution(_hospital_props);
-        const auto days                 = patient_distribution.days();
-        _entry.reset(new sti::hospital_entry { en.location, _clock.get(), std::move(patient_distribution), _agent_factory.get() });
+        // A streamed influx only keeps a day in memory, and the counters of
+        // the finished days in a spool file
+        const auto& influx_file = _props->getProperty("patient.influx.file");
+        auto        influx      = std::unique_ptr<influx_source> {};
+        auto        spool       = std::string {};
+        if (!influx_file.empty()) {
+            influx = std::make_unique<influx_stream>(influx_file);
+            spool  = _props->getProperty("output.folder") + "/entry.p" + std::to_string(_rank) + ".days";
+        } else {
+            influx = std::make_unique<patient_distribution>(_compiled_plan ? load_patient_distribution(*_compiled_plan) : load_patient_distribution(_hospital_props));
+        }
+        const auto days = influx->days();
+        _entry.reset(new sti::hospital_entry { en.location, _clock.get(), std::move(influx), _agent_factory.get(), std::move(spool) });
 
         // Calculate how many ticks and broadcast to the rest
         const auto seconds_per_tick = boost::lexical_cast<std::uint32_t>(_props->getProperty("seconds.per.tick"));
@@ -397,14 +731,31 @@ void sti::model::init()
         _communicator->recv(boost::mpi::any_source, 3854, _stop_at);
     }
 
+    // Only the entry reads the influx, the JSON copy is released
+    if (auto* parameters = _hospital_props.if_contains("parameters"); parameters && parameters->is_object()) {
+        if (auto* patient = parameters->as_object().if_contains("patient"); patient && patient->is_object()) {
+            patient->as_object().erase("influx");
+        }
+    }
+
+    // The slow subsystems optionally run once every some simulated seconds,
+    // instead of every tick, see init_schedule()
+    _entry_rate = tick_rate::parse(_props->getProperty("entry.period"), _clock->seconds_per_tick());
+    _staff_rate = tick_rate::parse(_props->getProperty("staff.period"), _clock->seconds_per_tick());
+    if (_icu->get_real_icu()) {
+        _icu->get_real_icu()->get().environment_rate(tick_rate::parse(_props->getProperty("icu.environment.period"), _clock->seconds_per_tick()));
+    }
+
     // Create the exit, if the exit is in this process
     const auto ex = _hospital.exit();
     if (_spaces.local_dimensions().contains(std::vector { ex.location.x, ex.location.y })) {
-        _exit.reset(new sti::hospital_exit(&_context, &_spaces, _clock.get(), ex.location, *_entry));
+        _exit.reset(new sti::hospital_exit(&_context, &_spaces, _clock.get(), ex.location, _props->getProperty("output.folder"), _rank));
     }
 
-    // Create medical personnel
-    _staff_manager->create_staff();
+    // Create medical personnel, a restarted run restores it with the rest of
+    // the agents
+    const auto& restart = _props->getProperty("restart.folder");
+    if (restart.empty()) _staff_manager->create_staff();
 
     // Create the beds
     if (_icu->get_real_icu()) {
@@ -414,16 +765,85 @@ void sti::model::init()
     // Create the chairs
     _chair_manager->create_chairs(_hospital, *_agent_factory->get_infection_factory());
 
+    // Optionally record the inputs of the infection logic, to run it again
+    // with other parameters without the rest of the simulation, see sti-replay
+    if (_props->getProperty("infection.trace") == "true") {
+        auto path = std::ostringstream {};
+        path << _props->getProperty("output.folder") << "/infection_trace.p" << _rank << ".bin";
+        _trace = std::make_unique<infection_trace>(path.str(),
+                                                   _rank,
+                                                   counter_rng::instance().seed(),
+                                                   static_cast<std::uint32_t>(_clock->seconds_per_tick()),
+                                                   static_cast<int>(_hospital.width()),
+                                                   static_cast<int>(_hospital.height()));
+        _chair_manager->record_to(_trace.get());
+        if (_icu->get_real_icu()) _icu->get_real_icu()->get().record_to(_trace.get());
+    }
+
+    // Optionally count the epidemic every tick, reduced into a single file
+    // every epidemic.series.interval ticks
+    if (instrumentation::enabled(*_props, "epidemic.series")) {
+        const auto& interval = _props->getProperty("epidemic.series.interval");
+        _series              = std::make_unique<epidemic_series>(_communicator,
+                                                    _props->getProperty("output.folder"),
+                                                    _hospital.specialties(),
+                                                    interval.empty() ? epidemic_series::default_interval : boost::lexical_cast<std::uint32_t>(interval));
+        _agent_factory->get_infection_factory()->count_infections(_series->infections());
+    }
+
+    // Optionally push the metrics of all the processes to an HTTP endpoint
+    // every telemetry.interval ticks, while the simulation runs
+    const auto& endpoint = _props->getProperty("telemetry.endpoint");
+    if (!endpoint.empty()) {
+        const auto& interval = _props->getProperty("telemetry.interval");
+        _telemetry           = std::make_unique<telemetry>(_communicator,
+                                                 endpoint,
+                                                 telemetry::parse_format(_props->getProperty("telemetry.format")),
+                                                 interval.empty() ? telemetry::default_interval : boost::lexical_cast<std::uint32_t>(interval),
+                                                 *_profiler);
+    }
+
+    // Everything with state kept in the checkpoints, the entry and the exit
+    // only exist in some processes, but always in the same ones
+    _checkpointed = { _chair_manager.get(),
+                      _reception->queues(),
+                      _triage->queues(),
+                      _doctors->queues(),
+                      &_icu->admission(),
+                      _triage.get(),
+                      _staff_manager.get(),
+                      _timers.get(),
+                      _agent_factory.get(),
+                      _hospital.get_pathfinder() };
+    if (_entry) _checkpointed.push_back(_entry.get());
+    if (_exit) _checkpointed.push_back(_exit.get());
+
+    // Write a checkpoint after each of the ticks in checkpoint.ticks, and
+    // optionally continue from one
+    const auto& ticks = _props->getProperty("checkpoint.ticks");
+    if (!ticks.empty()) {
+        auto tokens = std::vector<std::string> {};
+        boost::split(tokens, ticks, boost::is_any_of(","));
+        for (auto& t : tokens) {
+            boost::trim(t);
+            if (!t.empty()) _checkpoint_ticks.push_back(boost::lexical_cast<int>(t));
+        }
+        std::sort(_checkpoint_ticks.begin(), _checkpoint_ticks.end());
+    }
+    if (!restart.empty()) restore(restart);
+
     // Reserve vectors to avoid reallocations
     _pmetrics->preallocate(static_cast<std::size_t>(_stop_at));
-    _stats->preallocate_ticks(static_cast<std::size_t>(_stop_at));
 } // sti::model::init()
 
 /// @brief Initialize the scheduler
 /// @param runner The repast schedule runner
 void sti::model::init_schedule(repast::ScheduleRunner& runner)
 {
-    runner.scheduleEvent(1, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<model>(this, &model::tick)));
+    // A single event runs the tick, the subsystems with a period of their own
+    // are skipped inside it out of their due ticks. As separate events they
+    // would have no order with the synchronizations of the tick
+    runner.scheduleEvent(_first_tick, 1, repast::Schedule::FunctorPtr(new repast::MethodFunctor<model>(this, &model::tick)));
     runner.scheduleEndEvent(repast::Schedule::FunctorPtr(new repast::MethodFunctor<model>(this, &model::finish)));
     runner.scheduleStop(_stop_at);
 }
@@ -432,59 +852,345 @@ void sti::model::init_schedule(repast::ScheduleRunner& runner)
 void sti::model::tick()
 {
     _pmetrics->new_tick();
+    const auto timed_tick = _profiler->time(tick_phase::tick);
 
-    // Sync the clock with the simulation tick
-    _clock->sync(repast::RepastProcess::instance()->getScheduleRunner().currentTick());
+    // Sync the clock and the random generator with the simulation tick
+    const auto current_tick = repast::RepastProcess::instance()->getScheduleRunner().currentTick();
+    _clock->sync(current_tick);
+    counter_rng::instance().tick(static_cast<std::uint32_t>(current_tick));
 
-    _stats->new_tick(_clock->now());
 
     ////////////////////////////////////////////////////////////////////////////
     // INTER-PROCESS SYNCHRONIZATION
     ////////////////////////////////////////////////////////////////////////////
 
-    _chair_manager->sync();
-    _pmetrics->finish_mpi_stage<0>();
-    _reception->sync();
-    _pmetrics->finish_mpi_stage<1>();
-    _triage->sync();
-    _pmetrics->finish_mpi_stage<2>();
-    _doctors->queues()->sync();
-    _pmetrics->finish_mpi_stage<3>();
-    _icu->admission().sync();
-    _pmetrics->finish_mpi_stage<4>();
-
-    _spaces.balance(); // Move the agents accross processes
-    repast::RepastProcess::instance()->synchronizeAgentStatus<sti::contagious_agent, agent_package, agent_provider, agent_receiver>(_context, *_provider, *_receiver, *_receiver);
-    repast::RepastProcess::instance()->synchronizeProjectionInfo<sti::contagious_agent, agent_package, agent_provider, agent_receiver>(_context, *_provider, *_receiver, *_receiver);
-    repast::RepastProcess::instance()->synchronizeAgentStates<agent_package, agent_provider, agent_receiver>(*_provider, *_receiver);
+    // In fast forward, if no process had an agent moving, created or removed,
+    // nor a manager message pending, the managers and the agents status would
+    // exchange nothing. If no agent was created, removed or moved near a
+    // border, the agents status and projections would exchange nothing either.
+    // A single reduction of both bits replaces them, the changes of the ghosts
+    // are still sent, so the results are the same
+    auto activity = (_activity ? 1U : 0U) | (_border_activity ? 2U : 0U);
+    if (_fast_forward || _skip_space_sync) {
+        activity = boost::mpi::all_reduce(*_communicator, activity, std::bit_or<unsigned int> {});
+    }
+    const auto sync_all    = !_fast_forward || (activity & 1U) != 0;
+    const auto sync_spaces = sync_all && (!_skip_space_sync || (activity & 2U) != 0);
+
+    // In the pipelined tick the manager messages stay in flight during the
+    // Repast synchronization and the logic not depending on the managers
+    if (_pipelined) {
+        if (sync_all) _managers->post();
+    } else {
+        _profiler->run(tick_phase::managers, [&]() { if (sync_all) _managers->sync(); });
+        _pmetrics->finish_mpi_stage<0>();
+    }
+
+    _profiler->run(tick_phase::rhpc_sync, [&]() {
+        if (sync_spaces) {
+            _spaces.balance(); // Move the agents accross processes
+            repast::RepastProcess::instance()->synchronizeAgentStatus<sti::contagious_agent, agent_package, agent_provider, agent_receiver>(_context, *_provider, *_receiver, *_receiver);
+            repast::RepastProcess::instance()->synchronizeProjectionInfo<sti::contagious_agent, agent_package, agent_provider, agent_receiver>(_context, *_provider, *_receiver, *_receiver);
+        }
+        // The copies already exist in the other processes, send only the changes
+        _provider->deltas(true);
+        repast::RepastProcess::instance()->synchronizeAgentStates<agent_package, agent_provider, agent_receiver>(*_provider, *_receiver);
+        _provider->deltas(false);
+    });
     _pmetrics->finish_rhpc_sync();
 
+    // The locations don't change until the walk stage, cache them
+    _profiler->run(tick_phase::snapshot, [&]() { _spaces.snapshot(); });
+    if (_trace) _trace->begin_tick(static_cast<std::uint32_t>(current_tick));
+
     ////////////////////////////////////////////////////////////////////////////
     // LOGIC
     ////////////////////////////////////////////////////////////////////////////
 
-    if (_entry) _entry->generate_patients();
-    if (_exit) _exit->tick();
-    if (_icu->get_real_icu()) _icu->get_real_icu()->get().tick();
-    _chair_manager->tick();
-    _staff_manager->tick();
+    // The exit and the chairs infection don't interact with the managers nor
+    // with the rest of the logic, their order doesn't change the results
+    if (_pipelined) {
+        _profiler->run(tick_phase::logic, [&]() {
+            _profiler->run(tick_phase::exit, [&]() { if (_exit) _exit->tick(); });
+            _profiler->run(tick_phase::chairs, [&]() { _chair_manager->tick(); });
+        });
+        _pmetrics->finish_overlap();
+
+        _profiler->run(tick_phase::managers, [&]() { if (sync_all) _managers->complete(); });
+        _pmetrics->finish_mpi_stage<0>();
+    }
 
-    // Check how many agents are currently in this process
-    _pmetrics->agents(_context.size()); // Add the metric
-    _stats->preallocate_agents(static_cast<std::size_t>(_context.size()));
+    // With the tick graph each phase declares the state it reads and writes,
+    // and the phases run concurrently in the order of the dependencies.
+    // Without it they run here, in order
+    using namespace tick_resource;
+    const auto timed_logic = _profiler->time(tick_phase::logic);
+    const auto phase       = [&](phase_profiler::phase_id id, tick_graph::resource_set reads, tick_graph::resource_set writes, tick_graph::task f, bool main_thread = false) {
+        if (_graph) {
+            _graph->add(id, reads, writes, std::move(f), main_thread);
+        } else {
+            _profiler->run(id, f);
+        }
+    };
 
-    // Iterate over all the agents
-    for (auto it = _context.localBegin(); it != _context.localEnd(); ++it) {
-        (*it)->act();
+    // The entry creates the patients of the whole period at once
+    phase(tick_phase::entry, 0, population | people | trace, [&]() { if (_entry && _entry_rate.due(current_tick)) _entry->generate_patients(); });
+    if (!_pipelined) phase(tick_phase::exit, 0, population | people | trace, [&]() { if (_exit) _exit->tick(); });
+    phase(tick_phase::icu, 0, population | people | trace, [&]() { if (_icu->get_real_icu()) _icu->get_real_icu()->get().tick(); });
+    if (!_pipelined) phase(tick_phase::chairs, population, people | trace, [&]() { _chair_manager->tick(); });
+
+    // Check how many agents are currently in this process, after the staff
+    // replaced the sick ones
+    phase(tick_phase::staff, 0, population | people | trace, [&]() {
+        if (_staff_rate.due(current_tick)) _staff_manager->tick();
+        _pmetrics->agents(_context.size()); // Add the metric
+    });
+
+    // The agents seen by the contacts close the frame of the infection trace
+    if (_trace) {
+        phase(tick_phase::trace, population | people, trace, [&]() {
+            const auto& snapshot = _spaces.store();
+            for (auto slot = agent_store::slot_type { 0 }; slot < snapshot.size(); ++slot) {
+                const auto* a = snapshot.local_at(slot);
+                if (a != nullptr) _trace->add_agent(snapshot.id_at(slot), snapshot.location_at(slot), *a->get_infection_logic());
+            }
+            _trace->end_tick();
+        });
+    }
 
-        // Add the location to the log
-        _stats->add_agent_location((**it).getId(), _spaces.get_continuous_location((**it).getId()));
+    // Infections between nearby humans, evaluated once per pair
+    // The fixed staff only tick their infection, they are done here instead
+    // of in the agents loop, without the virtual act(). The exchange of the
+    // sources is MPI, in the main thread
+    phase(tick_phase::contacts, population, people | trace, [&]() {
+        if (_sources) _sources->exchange();
+        if (_static_staff) _static_staff->exchange();
+
+        // The last writer of the population is done, and the contacts are the
+        // only reader of the index
+        _spaces.rebuild_index();
+        _contacts->run(_spaces.index());
+
+        const auto& snapshot = _spaces.store();
+        const auto& staff    = snapshot.local_slots(to_int(contagious_agent::type::FIXED_PERSON));
+        for (auto i = std::size_t { 0 }; i < staff.size(); ++i) {
+            auto* person = static_cast<person_agent*>(snapshot.agent_at(staff[i]));
+            if (person != nullptr) person->get_infection_logic()->tick();
+        }
+    }, _sources != nullptr || _static_staff != nullptr);
+
+    // Wake up the patients whose waiting time elapsed, the rest of the parked
+    // agents only tick their infection logic
+    phase(tick_phase::timers, population, parked, [&]() {
+        _timers->wake(_clock->now(), [this](const repast::AgentId& id) {
+            auto* parked = _context.getAgent(id);
+            if (parked != nullptr) parked->parked(false);
+        });
+    });
+    // Iterate over the local patients, in the slots of the snapshot. The
+    // range only contains patients, the calls are not virtual
+    const auto& store    = _spaces.store();
+    const auto& patients = store.local_slots(to_int(contagious_agent::type::PATIENT));
+    const auto  act      = [&](std::size_t i) {
+        auto* p = static_cast<patient_agent*>(store.agent_at(patients[i]));
+        if (p == nullptr) return;
+        if (p->parked()) {
+            p->get_infection_logic()->tick();
+        } else {
+            p->act();
+        }
+    };
+    if (_graph) {
+        // The entry and the exit change the patients before the loop starts
+        _act->begin_chunks(_graph->max_chunks());
+        _graph->add_chunked(
+            tick_phase::agents, 0, all, [&]() { return patients.size(); },
+            [&](std::size_t chunk, std::size_t begin, std::size_t end) { _act->run_chunk(chunk, begin, end, act); },
+            [&]() { _act->end_chunks(); });
+
+        _graph->run();
+        _graph->report(*_profiler);
+        _pmetrics->graph(_graph->critical_path_ns(), _graph->work_ns());
+        _graph->clear();
+    } else {
+        _profiler->run(tick_phase::agents, [&]() {
+            if (_act) {
+                _act->run(patients.size(), act);
+            } else {
+                for (auto i = std::size_t { 0 }; i < patients.size(); ++i) act(i);
+            }
+        });
     }
+
+    // Move all the patients that decided to walk in this tick
+    _profiler->run(tick_phase::walk, [&]() { _spaces.walk(); });
+
+    // The state of the hospital at the end of the tick
+    if (_series) {
+        _profiler->run(tick_phase::series, [&]() {
+            for (const auto slot : patients) {
+                const auto* p = static_cast<const patient_agent*>(store.agent_at(slot));
+                if (p != nullptr) _series->add_patient(*p);
+            }
+            _series->chairs_occupied(_chair_manager->occupied());
+            if (_icu->get_real_icu()) _series->icu_beds_in_use(_icu->get_real_icu()->get().beds_in_use());
+            _series->end_tick(static_cast<std::uint32_t>(current_tick));
+        });
+    }
+
+    // Add the locations to the log, the walk updated the snapshot
+    if (_stats->tracking_movements()) {
+        _profiler->run(tick_phase::movements, [&]() {
+            _stats->new_tick(_clock->now(), static_cast<std::size_t>(_context.size()));
+            for (auto slot = agent_store::slot_type { 0 }; slot < store.size(); ++slot) {
+                if (store.local_at(slot) != nullptr) _stats->add_agent_location(store.id_at(slot), store.location_at(slot));
+            }
+            _stats->end_tick();
+        });
+    }
+
+    // The next tick only synchronizes everything if a patient is still active,
+    // or something changed in this tick
+    if (_fast_forward) {
+        auto active = !_managers->idle() || _spaces.changes() != _space_changes;
+        for (auto i = std::size_t { 0 }; i < patients.size() && !active; ++i) {
+            const auto* p = store.agent_at(patients[i]);
+            active        = p != nullptr && !p->parked();
+        }
+        _activity      = active;
+        _space_changes = _spaces.changes();
+    }
+    if (_skip_space_sync) {
+        _border_activity = _spaces.border_changes() != _border_changes;
+        _border_changes  = _spaces.border_changes();
+    }
+
+    // No manager message is in flight at the end of the tick
+    const auto tick_number = static_cast<int>(current_tick);
+    if (std::binary_search(_checkpoint_ticks.begin(), _checkpoint_ticks.end(), tick_number)) checkpoint(tick_number);
     _pmetrics->finish_logic();
 
+    // The heap of the subsystems, to size the nodes of the long runs
+    if (_pmetrics->tracking_memory()) {
+        auto usage       = process_metrics::memory_metrics {};
+        usage.resident   = instrumentation::resident_bytes();
+        usage.pathfinder = static_cast<std::int64_t>(_hospital.get_pathfinder()->memory_bytes());
+        usage.managers   = static_cast<std::int64_t>(_managers->memory_bytes());
+        usage.outputs    = static_cast<std::int64_t>((_exit ? _exit->memory_bytes() : 0) + _stats->memory_bytes() + (_trace ? _trace->memory_bytes() : 0)
+                                                  + (_series ? _series->memory_bytes() : 0));
+        usage.agents     = static_cast<std::int64_t>(patient_agent::pool().memory_bytes() + person_agent::pool().memory_bytes());
+        _pmetrics->memory(usage);
+    }
+
+    // The window of the telemetry, the patients are only counted at its end
+    if (_telemetry) {
+        _telemetry->end_tick(static_cast<std::uint32_t>(current_tick), [&]() {
+            auto s   = telemetry::sample {};
+            s.agents = static_cast<std::int64_t>(_context.size());
+            for (const auto slot : patients) {
+                const auto* p = static_cast<const patient_agent*>(store.agent_at(slot));
+                if (p != nullptr) s.add_patient(*p);
+            }
+            return s;
+        });
+    }
+
     _pmetrics->tick_end();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the state of the simulation after a tick
+/// @details Each process writes its own file in checkpoint.folder/<tick>
+/// @param tick The tick just finished
+void sti::model::checkpoint(int tick) const
+{
+    auto writer = checkpoint_writer { *_communicator };
+    auto& ar    = writer.archive();
+
+    // The header, to check the restarted run has the same layout
+    const auto dims = _spaces.local_dimensions();
+    ar << checkpoint_version;
+    ar << _communicator->size();
+    ar << static_cast<std::uint64_t>(_clock->seconds_per_tick());
+    ar << tick;
+    ar << counter_rng::instance().seed();
+    ar << std::vector<double> { dims.origin().getX(), dims.origin().getY(), dims.extents().getX(), dims.extents().getY() };
+
+    // The local agents, the ghosts are copied again in the first sync
+    auto local = std::vector<const agent*> {};
+    for (auto it = _context.localBegin(); it != _context.localEnd(); ++it) local.push_back(&**it);
+
+    ar << static_cast<std::uint64_t>(local.size());
+    for (const auto* a : local) {
+        ar << agent_package { a, wire_section::ALL };
+        ar << _spaces.get_continuous_location(a->getId());
+        ar << a->parked();
+    }
+
+    for (const auto* participant : _checkpointed) participant->save_state(ar);
+
+    auto folder = _props->getProperty("checkpoint.folder");
+    if (folder.empty()) folder = _props->getProperty("output.folder") + "/checkpoint";
+    writer.write(folder + "/" + std::to_string(tick), _rank);
+}
+
+/// @brief Continue the simulation from a checkpoint
+/// @details The movements log and the performance metrics only cover the
+/// ticks after the restart
+/// @throws bad_checkpoint If written with another layout or tick length
+/// @param folder The folder of the checkpoint, as written by checkpoint()
+void sti::model::restore(const std::string& folder)
+{
+    auto  reader = checkpoint_reader { folder, *_communicator };
+    auto& ar     = reader.archive();
+
+    auto version          = 0U;
+    auto size             = 0;
+    auto seconds_per_tick = std::uint64_t {};
+    auto tick             = 0;
+    auto seed             = std::uint64_t {};
+    auto area             = std::vector<double> {};
+    ar >> version;
+    ar >> size;
+    ar >> seconds_per_tick;
+    ar >> tick;
+    ar >> seed;
+    ar >> area;
+
+    const auto dims = _spaces.local_dimensions();
+    const auto same = version == checkpoint_version
+        && size == _communicator->size()
+        && seconds_per_tick == static_cast<std::uint64_t>(_clock->seconds_per_tick())
+        && area == std::vector<double> { dims.origin().getX(), dims.origin().getY(), dims.extents().getX(), dims.extents().getY() };
+    if (!same) throw bad_checkpoint {};
+
+    // Keep the draws of the original run, unless forking a new scenario
+    if (_props->getProperty("restart.reseed") != "true") counter_rng::instance().seed(seed);
+    _clock->sync(tick);
+    _first_tick = tick + 1;
+
+    auto agents = std::uint64_t {};
+    ar >> agents;
+    for (auto i = std::uint64_t { 0 }; i < agents; ++i) {
+        auto package  = agent_package {};
+        auto location = coordinates<double> {};
+        auto parked   = false;
+        ar >> package;
+        ar >> location;
+        ar >> parked;
+
+        auto* a = _receiver->createAgent(package);
+        _context.addAgent(a);
+        _spaces.move_to(a->getId(), location);
+        a->parked(parked);
+    }
+
+    for (auto* participant : _checkpointed) participant->load_state(ar);
+}
+
 /// @brief Final function for data collection and such
 void sti::model::finish()
 {
@@ -492,48 +1198,90 @@ void sti::model::finish()
 
     // The rank 0 creates the folder and broadcasts it
     const auto& folderpath = _props->getProperty("output.folder");
+    auto        files      = _props->getProperty("output.shared") == "true" ? output_files { _communicator, folderpath }
+                                                                            : output_files { folderpath, _communicator->rank() };
+    const auto  output     = make_table_writer(*_props, files);
+
+    // Optionally the subsystems snapshot their results in this thread, and
+    // the formatting and the writing run in the output tasks meanwhile
+    auto        tasks   = std::unique_ptr<output_tasks> {};
+    const auto& threads = _props->getProperty("output.threads");
+    if (!threads.empty()) {
+        tasks = std::make_unique<output_tasks>(boost::lexical_cast<unsigned>(threads));
+        files.run_on(tasks.get());
+    }
+    const auto run = [&](const output_tasks::task& save) {
+        if (tasks) {
+            tasks->run(save);
+        } else {
+            save();
+        }
+    };
 
-    if (_exit) _exit->save(folderpath, _rank);
-    if (_entry) _entry->save(folderpath, _communicator->rank());
-    _triage->save(folderpath);
+    if (_exit) _exit->save(files);
+    if (_entry) _entry->save(*output);
+    run([&]() { _triage->save(folderpath); });
     _icu->save(folderpath);
-    _chair_manager->save(folderpath, _communicator->rank());
-    _staff_manager->save(folderpath, _communicator->rank());
-    _stats->save(folderpath, _communicator->rank());
-    _hospital.get_pathfinder()->save(folderpath, _communicator->rank());
+    _chair_manager->save(files);
+    _staff_manager->save(files);
+    _stats->save();
+    if (_trace) _trace->close();
+    if (_series) _series->close();
+    if (_telemetry) _telemetry->close();
+    run([&]() { _hospital.get_pathfinder()->save(files); });
 
     // Remove the remaining agents
     // Iterate over all the agents to perform their actions
-    remove_remnants(folderpath);
+    remove_remnants(files, tasks.get());
+
+    _profiler->report(*_communicator, *output);
+
+    // The end time of the global metrics is taken once the rest is written
+    if (tasks) tasks->wait();
+    _pmetrics->save(*output);
 
-    _pmetrics->save(folderpath, _communicator->rank());
+    // With output.shared, the files of all the processes are written now
+    files.close();
 }
 
 /// @brief Remove all the agents that are still in the simulation
 /// @details Remove all the agents in the simulation and collect their
-/// metrics into a file
-void sti::model::remove_remnants(const std::string& folderpath)
+/// metrics into a file. With the output tasks the stats are generated and
+/// serialized in parallel chunks, the agents are not modified meanwhile
+/// @param output The result files
+/// @param tasks The output tasks, nullptr to generate the stats here
+void sti::model::remove_remnants(output_files& output, output_tasks* tasks)
 {
-    auto to_remove = std::vector<repast::AgentId> {};
-
-    auto output = boost::json::array {};
-    for (auto it = _context.localBegin(); it != _context.localEnd(); ++it) {
-        auto stats = (**it).stats();
-        output.push_back(stats);
-        to_remove.push_back((**it).getId());
+    auto agents = std::vector<const contagious_agent*> {};
+    for (auto it = _context.localBegin(); it != _context.localEnd(); ++it) agents.push_back(&**it);
+
+    // The records of each chunk, separated by commas
+    auto       parts = std::vector<std::string>(tasks != nullptr ? tasks->chunks(agents.size()) : 1);
+    const auto stats = [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        auto& part = parts[chunk];
+        for (auto i = begin; i < end; ++i) {
+            if (i != begin) part += ',';
+            part += boost::json::serialize(agents[i]->stats());
+        }
+    };
+    if (tasks != nullptr) {
+        tasks->run_chunks(agents.size(), stats);
+    } else {
+        stats(0, 0, agents.size());
     }
 
-    for (const auto& id : to_remove) {
+    for (const auto* remnant : agents) {
+        const auto id = remnant->getId();
         _context.removeAgent(id);
     }
 
-    auto os = std::ostringstream {};
-    os << folderpath
-       << "/agents.p"
-       << _communicator->rank()
-       << ".json";
-
-    auto file = std::ofstream { os.str() };
-
-    file << output;
+    output.write("agents", "json", [parts = std::move(parts)]() {
+        auto array = std::string { "[" };
+        for (const auto& part : parts) {
+            if (part.empty()) continue;
+            if (array.size() > 1) array += ',';
+            array += part;
+        }
+        return array + "]";
+    });
 }
\ No newline at end of file
@@ -8,11 +8,13 @@
 #include <repast_hpc/GridComponents.h>
 #include <repast_hpc/SharedDiscreteSpace.h>
 #include <boost/json/object.hpp>
+#include <vector>
 
 #include "agent_package.hpp"
 #include "contagious_agent.hpp"
 #include "hospital_plan.hpp"
 #include "space_wrapper.hpp"
+#include "tick_rate.hpp"
 
 // Fw. declarations
 namespace boost {
@@ -27,11 +29,28 @@ class ScheduleRunner;
 } // namespace repast
 
 namespace sti {
+class act_phase;
 class agent_factory;
+class checkpoint_participant;
+class compiled_plan;
+class contact_kernel;
+class epidemic_series;
 class staff_manager;
 class triage;
 class doctors;
 class icu;
+class manager_exchange;
+class hardware_counters;
+class node_topology;
+class infection_trace;
+class output_files;
+class output_tasks;
+class phase_profiler;
+class source_exchange;
+class static_registry;
+class telemetry;
+class tick_graph;
+class wake_queue;
 } // namespace sti
 
 namespace sti {
@@ -50,7 +69,14 @@ public:
     using continuous_space = repast::SharedContinuousSpace<agent, repast::StrictBorders, repast::SimpleAdder<agent>>;
     using discrete_space   = repast::SharedDiscreteSpace<agent, repast::StrictBorders, repast::SimpleAdder<agent>>;
 
-    model(const std::string& props_file, int argc, char** argv, boost::mpi::communicator* comm);
+    /// @brief Create the simulation
+    /// @param props_file The properties file
+    /// @param argc The arguments count
+    /// @param argv The arguments, key=value ones override the properties
+    /// @param comm The processes running this simulation
+    /// @param setup The processes of all the replicas of an ensemble, sharing
+    /// the read-only setup, or nullptr if there is a single replica
+    model(const std::string& props_file, int argc, char** argv, boost::mpi::communicator* comm, boost::mpi::communicator* setup = nullptr);
 
     model(const model&) = delete;
     model& operator=(const model&) = delete;
@@ -79,41 +105,86 @@ public:
     void finish();
 
     /// @brief Remove all the agents that are still in the simulation
-    /// @param folderpath The folder to write the file to
     /// @details Remove all the agents in the simulation and collect their
-    /// metrics into a file
-    void remove_remnants(const std::string& folderpath);
+    /// metrics into a file. With the output tasks the stats are generated and
+    /// serialized in parallel chunks, the agents are not modified meanwhile
+    /// @param output The result files
+    /// @param tasks The output tasks, nullptr to generate the stats here
+    void remove_remnants(output_files& output, output_tasks* tasks);
 
 private:
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the state of the simulation after a tick
+    /// @details Each process writes its own file in checkpoint.folder/<tick>
+    /// @param tick The tick just finished
+    void checkpoint(int tick) const;
+
+    /// @brief Continue the simulation from a checkpoint
+    /// @throws bad_checkpoint If written with another layout or tick length
+    /// @param folder The folder of the checkpoint, as written by checkpoint()
+    void restore(const std::string& folder);
+
     boost::mpi::communicator*    _communicator;
+    boost::mpi::communicator*    _setup;
     repast::Properties*          _props;
     repast::SharedContext<agent> _context;
     const int                    _rank;
     int                          _stop_at;
+    int                          _first_tick { 1 };
 
-    boost::json::object    _hospital_props;
-    std::unique_ptr<clock> _clock;
-    sti::hospital_plan     _hospital;
+    std::unique_ptr<compiled_plan> _compiled_plan; // If the hospital file is compiled
+    boost::json::object            _hospital_props;
+    std::unique_ptr<clock>         _clock;
+    sti::hospital_plan             _hospital;
 
     space_wrapper                   _spaces;
     std::unique_ptr<agent_provider> _provider;
     std::unique_ptr<agent_receiver> _receiver;
 
-    std::unique_ptr<process_metrics> _pmetrics;
-    std::unique_ptr<statistics>      _stats;
+    std::unique_ptr<hardware_counters> _counters; // Shared by the metrics and the profiler
+    std::unique_ptr<process_metrics>   _pmetrics;
+    std::unique_ptr<statistics>        _stats;
+    std::unique_ptr<phase_profiler>    _profiler;
+    std::unique_ptr<contact_kernel>    _contacts;
+    std::unique_ptr<source_exchange>   _sources {}; // Only with space.ghosts = infectious
+    std::unique_ptr<static_registry>   _static_staff {}; // Only with staff.static = true
+    std::unique_ptr<infection_trace>   _trace {};   // Only with infection.trace = true
+    std::unique_ptr<epidemic_series>   _series {};  // Only with epidemic.series = true
+    std::unique_ptr<telemetry>         _telemetry {}; // Only with a telemetry.endpoint
+
+    std::unique_ptr<wake_queue>     _timers;
+    std::unique_ptr<act_phase>      _act {}; // Only with several threads, see init()
+    std::unique_ptr<tick_graph>     _graph {}; // Only with tick.graph.threads
+    std::unique_ptr<node_topology>  _topology {}; // Only with topology.aware = true
 
     std::unique_ptr<agent_factory> _agent_factory {}; // Properly initalized in init()
 
-    std::unique_ptr<chair_manager> _chair_manager {}; // Properly initalized in init()
-    std::unique_ptr<reception>     _reception {}; // Properly initialized in init()
-    std::unique_ptr<triage>        _triage {}; // Properly initialized in init()
-    std::unique_ptr<doctors>       _doctors {}; // Properly initialized in init()
-    std::unique_ptr<icu>           _icu {}; // Properly initialized in init()
-    std::unique_ptr<staff_manager> _staff_manager {};
+    std::unique_ptr<chair_manager>    _chair_manager {}; // Properly initalized in init()
+    std::unique_ptr<reception>        _reception {}; // Properly initialized in init()
+    std::unique_ptr<triage>           _triage {}; // Properly initialized in init()
+    std::unique_ptr<doctors>          _doctors {}; // Properly initialized in init()
+    std::unique_ptr<icu>              _icu {}; // Properly initialized in init()
+    std::unique_ptr<manager_exchange> _managers {}; // Properly initialized in init()
+    bool                              _pipelined {};
+    bool                              _fast_forward {};
+    bool                              _activity { true }; // Something to synchronize after the last tick
+    std::uint64_t                     _space_changes {};
+    bool                              _skip_space_sync {};
+    bool                              _border_activity { true }; // An agent near a border in the last tick
+    std::uint64_t                     _border_changes {};
+    std::unique_ptr<staff_manager>    _staff_manager {};
+    tick_rate                         _staff_rate {}; // With staff.period
+    tick_rate                         _entry_rate {}; // With entry.period
 
     std::unique_ptr<hospital_entry> _entry {}; // Properly initalized in init()
     std::unique_ptr<hospital_exit>  _exit {}; // Properly initalized in init()
 
+    std::vector<checkpoint_participant*> _checkpointed {}; // In the order of the checkpoint
+    std::vector<int>                     _checkpoint_ticks {}; // Sorted
+
 }; // class model
 
 } // namespace sti
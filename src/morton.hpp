@@ -0,0 +1,34 @@
+/// @file morton.hpp
+/// @brief Z-order (Morton) codes of the grid cells
+#pragma once
+
+#include <cstdint>
+
+#include "coordinates.hpp"
+
+namespace sti {
+
+/// @brief Spread the bits of a value, leaving a zero between each two
+/// @param v A 32 bit value
+/// @return The bits of v in the even positions
+constexpr std::uint64_t morton_spread(std::uint32_t v)
+{
+    auto x = static_cast<std::uint64_t>(v);
+    x      = (x | (x << 16U)) & 0x0000FFFF0000FFFFULL;
+    x      = (x | (x << 8U)) & 0x00FF00FF00FF00FFULL;
+    x      = (x | (x << 4U)) & 0x0F0F0F0F0F0F0F0FULL;
+    x      = (x | (x << 2U)) & 0x3333333333333333ULL;
+    x      = (x | (x << 1U)) & 0x5555555555555555ULL;
+    return x;
+}
+
+/// @brief Get the Morton code of a cell, interleaving the bits of x and y
+/// @details The cells close in the code are close in the plan, sorting by the
+/// code visits the plan in square blocks instead of rows
+/// @param cell The cell, with non negative coordinates
+constexpr std::uint64_t morton_code(const coordinates<int>& cell)
+{
+    return morton_spread(static_cast<std::uint32_t>(cell.x)) | (morton_spread(static_cast<std::uint32_t>(cell.y)) << 1U);
+}
+
+} // namespace sti
@@ -0,0 +1,124 @@
+/// @file movement_recorder.cpp
+/// @brief Binary log of the agents locations, written while the simulation runs
+#include "movement_recorder.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <repast_hpc/AgentId.h>
+
+#include "memory_usage.hpp"
+
+namespace {
+
+/// @brief The header of a frame, as written in the file
+struct frame_header {
+    std::int64_t  time;
+    std::uint32_t records;
+    std::uint32_t flags;
+};
+
+static_assert(sizeof(frame_header) == 16, "The frame header must have no padding");
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the file and write the header
+/// @param path The path of the file
+/// @param keyframe_interval The number of ticks between keyframes, at least 1
+sti::movement_recorder::movement_recorder(const std::string& path, std::uint32_t keyframe_interval)
+    : _file { path, 1U << 20U }
+    , _keyframe_interval { std::max(keyframe_interval, std::uint32_t { 1 }) }
+{
+    static_assert(sizeof(record) == 16, "The record must have no padding");
+
+    const char magic[8] = { 'S', 'T', 'I', 'M', 'O', 'V', 'E', '1' };
+    _file.append(magic, sizeof(magic));
+    _file.append(&version, sizeof(version));
+    _file.append(&_keyframe_interval, sizeof(_keyframe_interval));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Start the frame of a new tick
+/// @param now The time of the tick
+/// @param nagents The expected number of agents, to reserve memory
+void sti::movement_recorder::begin_tick(datetime now, std::size_t nagents)
+{
+    _now      = now;
+    _keyframe = _tick % _keyframe_interval == 0;
+    _seen     = 0;
+    _frame.clear();
+    if (_keyframe) _frame.reserve(nagents);
+}
+
+/// @brief Add the location of an agent to the current frame
+/// @param id The agent id
+/// @param location The agent location
+void sti::movement_recorder::add(const repast::AgentId& id, const coordinates<double>& location)
+{
+    const auto packed = pack(id);
+    const auto x      = static_cast<float>(location.x);
+    const auto y      = static_cast<float>(location.y);
+
+    auto [it, inserted] = _last.try_emplace(packed, last_location { x, y, _tick });
+    if (!inserted && it->second.tick == _tick) return; // Already added in this tick
+    ++_seen;
+
+    // In the delta frames the agents that didn't move are skipped
+    if (_keyframe || inserted || it->second.x != x || it->second.y != y) {
+        _frame.push_back({ packed, x, y });
+    }
+    it->second = { x, y, _tick };
+}
+
+/// @brief Finish the frame of the current tick and queue it for writing
+void sti::movement_recorder::end_tick()
+{
+    // Forget the agents that were not added in this tick, the delta frames
+    // mark them as gone. If all the known agents were added nobody left.
+    if (_seen != _last.size()) {
+        constexpr auto gone = std::numeric_limits<float>::quiet_NaN();
+        for (auto it = _last.begin(); it != _last.end();) {
+            if (it->second.tick == _tick) {
+                ++it;
+                continue;
+            }
+            if (!_keyframe) _frame.push_back({ it->first, gone, gone });
+            it = _last.erase(it);
+        }
+    }
+
+    const auto header = frame_header { static_cast<std::int64_t>(_now.seconds_since_epoch()),
+                                       static_cast<std::uint32_t>(_frame.size()),
+                                       _keyframe ? keyframe_flag : 0 };
+    _file.append(&header, sizeof(header));
+    _file.append(_frame.data(), _frame.size() * sizeof(record));
+    ++_tick;
+}
+
+/// @brief Write the remaining frames and close the file
+void sti::movement_recorder::close()
+{
+    _file.close();
+}
+
+/// @brief Get the heap bytes of the frame, the last locations and the file buffers
+std::size_t sti::movement_recorder::memory_bytes() const
+{
+    return memory::bytes(_frame) + memory::bytes(_last) + _file.memory_bytes();
+}
+
+/// @brief Pack an agent id in 64 bits
+/// @param id The agent id
+/// @return The packed id
+std::uint64_t sti::movement_recorder::pack(const repast::AgentId& id)
+{
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.id()))
+         | static_cast<std::uint64_t>(static_cast<std::uint16_t>(id.startingRank())) << 32U
+         | static_cast<std::uint64_t>(static_cast<std::uint16_t>(id.agentType())) << 48U;
+}
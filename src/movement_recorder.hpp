@@ -0,0 +1,107 @@
+/// @file movement_recorder.hpp
+/// @brief Binary log of the agents locations, written while the simulation runs
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "clock.hpp"
+#include "coordinates.hpp"
+#include "record_stream.hpp"
+
+// Fw. declarations
+namespace repast {
+class AgentId;
+} // namespace repast
+
+namespace sti {
+
+/// @brief Writes the location of the agents every tick, in a compact binary file
+/// @details The file starts with a header, followed by one frame per tick.
+/// Every keyframe_interval ticks a keyframe contains all the agents, and the
+/// frames in between only contain the agents that moved, appeared or left
+/// since the previous frame. The agents that left have NaN coordinates. The
+/// values are in the byte order of the host:
+///
+///     header: char magic[8] = "STIMOVE1", u32 version, u32 keyframe_interval
+///     frame:  i64 seconds_since_epoch, u32 records, u32 flags (1 = keyframe)
+///     record: u64 packed_id, f32 x, f32 y
+///
+/// The packed id contains the id in the lower 32 bits, the starting rank in
+/// the next 16 and the agent type in the upper 16. The file is written by a
+/// background thread in fixed size chunks, only the frames not yet written
+/// are kept in memory.
+class movement_recorder {
+
+public:
+    constexpr static auto version          = std::uint32_t { 1 };
+    constexpr static auto keyframe_flag    = std::uint32_t { 1 };
+    constexpr static auto default_interval = std::uint32_t { 60 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the file and write the header
+    /// @param path The path of the file
+    /// @param keyframe_interval The number of ticks between keyframes, at least 1
+    movement_recorder(const std::string& path, std::uint32_t keyframe_interval = default_interval);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Start the frame of a new tick
+    /// @param now The time of the tick
+    /// @param nagents The expected number of agents, to reserve memory
+    void begin_tick(datetime now, std::size_t nagents);
+
+    /// @brief Add the location of an agent to the current frame
+    /// @param id The agent id
+    /// @param location The agent location
+    void add(const repast::AgentId& id, const coordinates<double>& location);
+
+    /// @brief Finish the frame of the current tick and queue it for writing
+    void end_tick();
+
+    /// @brief Write the remaining frames and close the file
+    void close();
+
+    /// @brief Get the heap bytes of the frame, the last locations and the file buffers
+    std::size_t memory_bytes() const;
+
+    /// @brief Pack an agent id in 64 bits
+    /// @param id The agent id
+    /// @return The packed id
+    static std::uint64_t pack(const repast::AgentId& id);
+
+private:
+    /// @brief A location in the file
+    struct record {
+        std::uint64_t id;
+        float         x;
+        float         y;
+    };
+
+    /// @brief The last location written of an agent
+    struct last_location {
+        float         x;
+        float         y;
+        std::uint64_t tick;
+    };
+
+    async_file    _file;
+    std::uint32_t _keyframe_interval;
+
+    std::uint64_t          _tick {};
+    datetime               _now {};
+    bool                   _keyframe {};
+    std::size_t            _seen {};
+    std::vector<record>    _frame;
+    std::unordered_map<std::uint64_t, last_location> _last;
+}; // class movement_recorder
+
+} // namespace sti
@@ -0,0 +1,160 @@
+/// @file node_topology.cpp
+/// @brief The nodes of the processes, and the placement of the regions in them
+#include "node_topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/mpi/collectives.hpp>
+#include <numeric>
+#include <repast_hpc/GridDimensions.h>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "morton.hpp"
+#include "space_wrapper.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Find the node of every process, collective
+/// @param comm The communicator of the replica
+sti::node_topology::node_topology(const boost::mpi::communicator& comm)
+{
+    auto raw = MPI_Comm {};
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, comm.rank(), MPI_INFO_NULL, &raw);
+    const auto node = boost::mpi::communicator { raw, boost::mpi::comm_take_ownership };
+    _node_rank      = node.rank();
+    _node_size      = node.size();
+
+    // The nodes are numbered in the order of their lowest rank
+    const auto leader  = boost::mpi::all_reduce(node, comm.rank(), boost::mpi::minimum<int> {});
+    auto       leaders = std::vector<int> {};
+    boost::mpi::all_gather(comm, leader, leaders);
+
+    auto sorted = leaders;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    for (const auto l : leaders) {
+        _node_of.push_back(static_cast<int>(std::lower_bound(sorted.begin(), sorted.end(), l) - sorted.begin()));
+    }
+}
+
+/// @brief Reorder the processes so the adjacent regions share a node, collective
+/// @param comm The communicator of the replica
+/// @param processes The number of processes along each axis
+/// @return The communicator with the new ranks, the same order if the
+/// grid doesn't have a process per rank
+boost::mpi::communicator sti::node_topology::reorder(const boost::mpi::communicator& comm, coordinates<int> processes)
+{
+    const auto topology = node_topology { comm };
+    if (processes.x * processes.y != comm.size()) return comm;
+
+    auto tiles = std::vector<coordinates<int>> {};
+    for (auto x = 0; x < processes.x; ++x) {
+        for (auto y = 0; y < processes.y; ++y) tiles.push_back({ x, y });
+    }
+    std::stable_sort(tiles.begin(), tiles.end(), [](const auto& lhs, const auto& rhs) {
+        return morton_code(lhs) < morton_code(rhs);
+    });
+
+    // The processes node by node, in rank order inside each node
+    auto order = std::vector<int>(static_cast<std::size_t>(comm.size()));
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+        return topology._node_of[static_cast<std::size_t>(lhs)] < topology._node_of[static_cast<std::size_t>(rhs)];
+    });
+
+    const auto position = static_cast<std::size_t>(std::find(order.begin(), order.end(), comm.rank()) - order.begin());
+    const auto tile     = tiles[position];
+    return comm.split(0, tile.x * processes.y + tile.y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Bind the OpenMP threads to the cores of this process
+/// @param threads The threads of the team
+void sti::node_topology::bind_threads(int threads)
+{
+    static_cast<void>(threads); // Without OpenMP the team is the main thread
+#ifdef __linux__
+    auto available = cpu_set_t {};
+    CPU_ZERO(&available);
+    if (sched_getaffinity(0, sizeof(available), &available) != 0) return;
+
+    auto cpus = std::vector<int> {};
+    for (auto c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &available)) cpus.push_back(c);
+    }
+
+    // Without a binding from the launcher every process sees all the cores
+    const auto unbound = cpus.size() >= std::thread::hardware_concurrency();
+    const auto share   = unbound ? std::max<std::size_t>(1, cpus.size() / static_cast<std::size_t>(_node_size)) : cpus.size();
+    const auto first   = unbound ? (static_cast<std::size_t>(_node_rank) * share) % cpus.size() : 0;
+    auto       own     = std::vector<int> {};
+    for (auto c = first; c < first + share && c < cpus.size(); ++c) own.push_back(cpus[c]);
+    if (own.empty()) return;
+
+    auto bound = std::atomic<int> { 0 };
+#pragma omp parallel num_threads(threads)
+    {
+        auto thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        auto set = cpu_set_t {};
+        CPU_ZERO(&set);
+        if (thread == 0) {
+            for (const auto c : own) CPU_SET(c, &set);
+        } else {
+            CPU_SET(own[static_cast<std::size_t>(thread) % own.size()], &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) ++bound;
+    }
+    _bound = bound;
+#endif
+}
+
+/// @brief Get the placement of this process, collective
+/// @param space The space, already split between the processes
+/// @param comm The communicator of the replica
+sti::node_topology::mapping sti::node_topology::report(const space_wrapper& space, const boost::mpi::communicator& comm) const
+{
+    // The regions as really split by Repast, not as expected by reorder()
+    const auto dims  = space.local_dimensions();
+    const auto local = std::vector<double> { dims.origin().getX(),
+                                             dims.origin().getY(),
+                                             dims.origin().getX() + dims.extents().getX(),
+                                             dims.origin().getY() + dims.extents().getY() };
+    auto       all   = std::vector<std::vector<double>> {};
+    boost::mpi::all_gather(comm, local, all);
+
+    const auto node = _node_of[static_cast<std::size_t>(comm.rank())];
+    auto       out  = mapping {};
+    out.node          = node;
+    out.nodes         = *std::max_element(_node_of.begin(), _node_of.end()) + 1;
+    out.node_rank     = _node_rank;
+    out.node_size     = _node_size;
+    out.bound_threads = _bound;
+
+    // Touching regions, also by a corner, exchange ghosts
+    for (auto p = 0; p < comm.size(); ++p) {
+        if (p == comm.rank()) continue;
+        const auto& area = all[static_cast<std::size_t>(p)];
+        if (area[0] <= local[2] && local[0] <= area[2] && area[1] <= local[3] && local[1] <= area[3]) {
+            ++out.neighbours;
+            if (_node_of[static_cast<std::size_t>(p)] == node) ++out.node_neighbours;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,84 @@
+/// @file node_topology.hpp
+/// @brief The nodes of the processes, and the placement of the regions in them
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <vector>
+
+#include "coordinates.hpp"
+
+// Fw. declarations
+namespace sti {
+class space_wrapper;
+} // namespace sti
+
+namespace sti {
+
+/// @brief The processes sharing a node, found with MPI_Comm_split_type
+/// @details With topology.aware = true the processes of each replica are
+/// reordered before Repast starts (reorder()), so the tiles of the space
+/// given to the processes of a node are a compact block of the process grid
+/// instead of whole rows: the adjacent regions, which exchange most of the
+/// ghosts and the migrations, share a node. Then the threads of the act phase
+/// and the tick graph are bound to the share of the cores of the node of the
+/// process (bind_threads()), and the mapping is reported in global_metrics.
+class node_topology {
+
+public:
+    /// @brief The placement of a process, the columns of global_metrics
+    struct mapping {
+        int node;            // Index of the node, by its lowest rank
+        int nodes;           // Number of nodes of the replica
+        int node_rank;       // Rank inside the node
+        int node_size;       // Processes in the node
+        int neighbours;      // Processes whose region touches this one
+        int node_neighbours; // The neighbours in the same node
+        int bound_threads;   // Threads bound to a core, 0 if not supported
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Find the node of every process, collective
+    /// @param comm The communicator of the replica
+    explicit node_topology(const boost::mpi::communicator& comm);
+
+    /// @brief Reorder the processes so the adjacent regions share a node, collective
+    /// @details Repast gives the tile (x, y) of the process grid to the rank
+    /// x * processes.y + y, the Cartesian order of MPI. The tiles are sorted
+    /// in Morton order and dealt to the processes node by node, so each node
+    /// gets consecutive tiles of the curve, close to a square block
+    /// @param comm The communicator of the replica
+    /// @param processes The number of processes along each axis
+    /// @return The communicator with the new ranks, the same order if the
+    /// grid doesn't have a process per rank
+    static boost::mpi::communicator reorder(const boost::mpi::communicator& comm, coordinates<int> processes);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Bind the OpenMP threads to the cores of this process
+    /// @details A process already bound by the launcher keeps its cores,
+    /// otherwise the cores of the node are split evenly between its
+    /// processes. Each worker thread of the team is bound to one core and the
+    /// main thread to the whole share, so the threads it starts later stay in
+    /// it. The threads are bound before the first parallel phase, the buffers
+    /// they fill are first touched in their cores
+    /// @param threads The threads of the team
+    void bind_threads(int threads);
+
+    /// @brief Get the placement of this process, collective
+    /// @param space The space, already split between the processes
+    /// @param comm The communicator of the replica
+    mapping report(const space_wrapper& space, const boost::mpi::communicator& comm) const;
+
+private:
+    std::vector<int> _node_of; // Node of each rank
+    int              _node_rank;
+    int              _node_size;
+    int              _bound {};
+}; // class node_topology
+
+} // namespace sti
@@ -0,0 +1,125 @@
+/// @file object_pool.hpp
+/// @brief Recycling allocator for the agents of a process
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace sti {
+
+/// @brief Free list of fixed size blocks, allocated in slabs
+/// @details The blocks released are reused by the next allocations, the slabs
+/// are only returned to the system when the pool is destroyed. Not thread
+/// safe.
+template <std::size_t Size, std::size_t Align, std::size_t SlabBlocks = 256>
+class block_pool {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get a free block, allocating a new slab if there are none
+    void* allocate()
+    {
+        if (_free == nullptr) grow();
+
+        auto* b = _free;
+        _free   = b->next;
+        ++_used;
+        return b->storage;
+    }
+
+    /// @brief Return a block to the pool
+    /// @param p The block, obtained from allocate()
+    void deallocate(void* p)
+    {
+        auto* b = static_cast<block*>(p);
+        b->next = _free;
+        _free   = b;
+        --_used;
+    }
+
+    /// @brief Get the number of blocks in use
+    std::size_t used() const
+    {
+        return _used;
+    }
+
+    /// @brief Get the number of blocks allocated, in use or free
+    std::size_t capacity() const
+    {
+        return _slabs.size() * SlabBlocks;
+    }
+
+    /// @brief Get the heap bytes of the slabs
+    std::size_t memory_bytes() const
+    {
+        return capacity() * sizeof(block) + _slabs.capacity() * sizeof(_slabs.front());
+    }
+
+private:
+    /// @brief A block, free blocks store the next free block
+    union block {
+        block* next;
+        alignas(Align) unsigned char storage[Size];
+    };
+
+    /// @brief Allocate a new slab, and add its blocks to the free list
+    void grow()
+    {
+        auto slab = std::make_unique<block[]>(SlabBlocks);
+        for (auto i = SlabBlocks; i > 0; --i) {
+            slab[i - 1].next = _free;
+            _free            = &slab[i - 1];
+        }
+        _slabs.push_back(std::move(slab));
+    }
+
+    std::vector<std::unique_ptr<block[]>> _slabs;
+    block*                                _free {};
+    std::size_t                           _used {};
+}; // class block_pool
+
+/// @brief Give a class allocation functions using a per process pool
+/// @details Every new and delete of T, including the ones in Repast when the
+/// agents migrate or are removed, recycle the blocks of the same pool, so
+/// the agents created and destroyed during the simulation don't fragment the
+/// heap. The agents must be created and destroyed from a single thread.
+template <typename T>
+class pooled {
+
+public:
+    /// @brief Allocate a T from the pool
+    static void* operator new(std::size_t size)
+    {
+        // Derived classes have a different size, use the global heap
+        if (size != sizeof(T)) return ::operator new(size);
+        return pool().allocate();
+    }
+
+    /// @brief Return a T to the pool
+    static void operator delete(void* p, std::size_t size)
+    {
+        if (p == nullptr) return;
+        if (size != sizeof(T)) {
+            ::operator delete(p);
+            return;
+        }
+        pool().deallocate(p);
+    }
+
+    /// @brief Get the pool of the process
+    /// @details Instantiated on first use, T is incomplete in the base list
+    static auto& pool()
+    {
+        // Never destroyed, the Repast context can delete agents during the
+        // destruction of the static objects
+        static auto* instance = new block_pool<sizeof(T), alignof(T)> {};
+        return *instance;
+    }
+}; // class pooled
+
+} // namespace sti
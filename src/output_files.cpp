@@ -0,0 +1,222 @@
+/// @file output_files.cpp
+/// @brief The result files of each process, one per process or shared
+#include "output_files.hpp"
+
+#include <algorithm>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mpi.h>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "output_tasks.hpp"
+
+namespace {
+
+/// @brief The bytes written by a process in each collective write
+/// @details The counts of MPI are int, the larger parts take several rounds
+constexpr auto write_round = std::uint64_t { 1 } << 30U;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the files of a process, one per result
+/// @param folder The output folder
+/// @param rank The rank of the process
+sti::output_files::output_files(std::string folder, int rank)
+    : _folder { std::move(folder) }
+    , _rank { rank }
+{
+}
+
+/// @brief Create the files shared by all the processes
+/// @param communicator The processes of the simulation
+/// @param folder The output folder
+sti::output_files::output_files(boost::mpi::communicator* communicator, std::string folder)
+    : _communicator { communicator }
+    , _folder { std::move(folder) }
+    , _rank { communicator->rank() }
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the output folder
+const std::string& sti::output_files::folder() const
+{
+    return _folder;
+}
+
+/// @brief Get the rank of this process
+int sti::output_files::rank() const
+{
+    return _rank;
+}
+
+/// @brief Check if the files are shared by all the processes
+bool sti::output_files::shared() const
+{
+    return _communicator != nullptr;
+}
+
+/// @brief Produce the results in the output tasks, until close()
+/// @param tasks The tasks, nullptr to produce them in the caller
+void sti::output_files::run_on(output_tasks* tasks)
+{
+    _tasks = tasks;
+}
+
+/// @brief Get the path of the file of this process
+/// @param name The name of the result
+/// @param extension The extension of the file
+/// @return The path <folder>/<name>.p<rank>.<extension>
+std::string sti::output_files::path(const std::string& name, const std::string& extension) const
+{
+    auto os = std::ostringstream {};
+    os << _folder << "/" << name << ".p" << _rank << "." << extension;
+    return os.str();
+}
+
+/// @brief Write a result of this process
+/// @throws output_write_error If the file can't be written
+/// @param name The name of the result
+/// @param extension The extension of the file
+/// @param content The content of the file
+void sti::output_files::write(const std::string& name, const std::string& extension, std::string content)
+{
+    if (shared()) {
+        const auto lock                  = std::lock_guard { _mutex };
+        _pending[name + "." + extension] = std::move(content);
+        return;
+    }
+
+    auto file = std::ofstream { path(name, extension), std::ios::binary };
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!file) throw output_write_error {};
+}
+
+/// @brief Write a result of this process, produced by a function
+/// @details The function runs in the output tasks if any, it must own
+/// the data it formats
+/// @throws output_write_error If the file can't be written, from close()
+/// with the output tasks
+/// @param name The name of the result
+/// @param extension The extension of the file
+/// @param produce The function returning the content of the file
+void sti::output_files::write(const std::string& name, const std::string& extension, std::function<std::string()> produce)
+{
+    if (_tasks == nullptr) {
+        write(name, extension, produce());
+        return;
+    }
+    _tasks->run([this, name, extension, produce = std::move(produce)]() { write(name, extension, produce()); });
+}
+
+/// @brief Add a result already written in the file of this process
+/// @details For the results streamed while the simulation runs. With the
+/// shared files the file is read back, and removed once shared
+/// @param name The name of the result
+/// @param extension The extension of the file, see path()
+void sti::output_files::adopt(const std::string& name, const std::string& extension)
+{
+    if (!shared()) return;
+
+    const auto filepath = path(name, extension);
+    auto       file     = std::ifstream { filepath, std::ios::binary };
+    if (!file) throw output_write_error {};
+
+    auto       content  = std::string { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+    const auto filename = name + "." + extension;
+
+    const auto lock    = std::lock_guard { _mutex };
+    _pending[filename] = std::move(content);
+    _adopted[filename] = filepath;
+}
+
+/// @brief Wait for the output tasks and write the shared files, collective
+/// @throws output_write_error If a file can't be written
+void sti::output_files::close()
+{
+    if (_tasks != nullptr) _tasks->wait();
+    _tasks = nullptr;
+    if (!shared()) return;
+
+    // The processes may have different results, all of them write every file
+    auto local = std::vector<std::string> {};
+    for (const auto& [filename, content] : _pending) local.push_back(filename);
+    auto all = std::vector<std::vector<std::string>> {};
+    boost::mpi::all_gather(*_communicator, local, all);
+
+    auto filenames = std::set<std::string> {};
+    for (const auto& names : all) filenames.insert(names.begin(), names.end());
+
+    const auto nothing = std::string {};
+    for (const auto& filename : filenames) {
+        const auto it = _pending.find(filename);
+        write_shared(filename, it == _pending.end() ? nothing : it->second);
+    }
+
+    for (const auto& [filename, filepath] : _adopted) std::remove(filepath.c_str());
+    _pending.clear();
+    _adopted.clear();
+}
+
+/// @brief Write the parts of all the processes into a file, collective
+/// @param filename The name of the file, in the folder
+/// @param content The part of this process
+void sti::output_files::write_shared(const std::string& filename, const std::string& content) const
+{
+    auto part = std::ostringstream {};
+    if (_rank == 0) part << shared_magic;
+    part << "@part rank=" << _rank << " bytes=" << content.size() << "\n";
+    part << content;
+    const auto data = part.str();
+
+    // The part of each process starts after the parts of the lower ranks
+    const auto size   = static_cast<std::uint64_t>(data.size());
+    auto       offset = std::uint64_t { 0 };
+    MPI_Exscan(&size, &offset, 1, MPI_UINT64_T, MPI_SUM, *_communicator);
+    if (_rank == 0) offset = 0; // Undefined in the first rank
+
+    const auto filepath = _folder + "/" + filename;
+    auto       file     = MPI_File {};
+    if (MPI_File_open(*_communicator, filepath.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        throw output_write_error {};
+    }
+
+    // Truncate the file of a previous run
+    auto written = MPI_File_set_size(file, 0) == MPI_SUCCESS;
+
+    const auto local_rounds = (size + write_round - 1) / write_round;
+    const auto rounds       = boost::mpi::all_reduce(*_communicator, local_rounds, boost::mpi::maximum<std::uint64_t> {});
+    for (auto r = std::uint64_t { 0 }; r < rounds; ++r) {
+        const auto begin = std::min(r * write_round, size);
+        const auto count = std::min(write_round, size - begin);
+        written          = MPI_File_write_at_all(file,
+                                        static_cast<MPI_Offset>(offset + begin),
+                                        data.data() + begin,
+                                        static_cast<int>(count),
+                                        MPI_BYTE,
+                                        MPI_STATUS_IGNORE)
+                     == MPI_SUCCESS
+                 && written;
+    }
+    written = MPI_File_close(&file) == MPI_SUCCESS && written;
+
+    // All the processes fail together, none is left in a collective
+    if (!boost::mpi::all_reduce(*_communicator, written, std::logical_and<bool> {})) throw output_write_error {};
+}
@@ -0,0 +1,138 @@
+/// @file output_files.hpp
+/// @brief The result files of each process, one per process or shared
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace sti {
+class output_tasks;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Error writing a result file
+struct output_write_error : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The output file could not be written";
+    }
+};
+
+/// @brief The files where the processes save their results
+/// @details Each process writes by default its own <name>.p<rank>.<extension>
+/// file. With the shared files the results are kept until close(), that
+/// writes all the processes into a single <name>.<extension> file with
+/// MPI-IO: the offsets are computed with an exclusive scan of the sizes, and
+/// each process writes its part with a collective write. The processes that
+/// have nothing for a file write an empty part, so a result saved only by
+/// some processes (the exit, the root of the reductions) is still written.
+///
+/// The shared files are self-describing, a reader needs no rank count:
+///
+///     STI-SHARED 1\n
+///     @part rank=<rank> bytes=<bytes>\n
+///     <bytes bytes, the file the process would have written>
+///     @part rank=<rank> bytes=<bytes>\n
+///     ...
+///
+/// With run_on() the results produced with a function are formatted and
+/// written by the output tasks, the writes are thread safe.
+class output_files {
+
+public:
+    constexpr static auto shared_magic = "STI-SHARED 1\n";
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the files of a process, one per result
+    /// @param folder The output folder
+    /// @param rank The rank of the process
+    output_files(std::string folder, int rank);
+
+    /// @brief Create the files shared by all the processes
+    /// @param communicator The processes of the simulation
+    /// @param folder The output folder
+    output_files(boost::mpi::communicator* communicator, std::string folder);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the output folder
+    const std::string& folder() const;
+
+    /// @brief Get the rank of this process
+    int rank() const;
+
+    /// @brief Check if the files are shared by all the processes
+    bool shared() const;
+
+    /// @brief Produce the results in the output tasks, until close()
+    /// @param tasks The tasks, nullptr to produce them in the caller
+    void run_on(output_tasks* tasks);
+
+    /// @brief Get the path of the file of this process
+    /// @param name The name of the result
+    /// @param extension The extension of the file
+    /// @return The path <folder>/<name>.p<rank>.<extension>
+    std::string path(const std::string& name, const std::string& extension) const;
+
+    /// @brief Write a result of this process
+    /// @throws output_write_error If the file can't be written
+    /// @param name The name of the result
+    /// @param extension The extension of the file
+    /// @param content The content of the file
+    void write(const std::string& name, const std::string& extension, std::string content);
+
+    /// @brief Write a result of this process, produced by a function
+    /// @details The function runs in the output tasks if any, it must own
+    /// the data it formats
+    /// @throws output_write_error If the file can't be written, from close()
+    /// with the output tasks
+    /// @param name The name of the result
+    /// @param extension The extension of the file
+    /// @param produce The function returning the content of the file
+    void write(const std::string& name, const std::string& extension, std::function<std::string()> produce);
+
+    /// @brief Add a result already written in the file of this process
+    /// @details For the results streamed while the simulation runs. With the
+    /// shared files the file is read back, and removed once shared
+    /// @param name The name of the result
+    /// @param extension The extension of the file, see path()
+    void adopt(const std::string& name, const std::string& extension);
+
+    /// @brief Wait for the output tasks and write the shared files, collective
+    /// @throws output_write_error If a file can't be written
+    void close();
+
+private:
+    /// @brief Write the parts of all the processes into a file, collective
+    /// @param filename The name of the file, in the folder
+    /// @param content The part of this process
+    void write_shared(const std::string& filename, const std::string& content) const;
+
+    boost::mpi::communicator* _communicator {};
+    std::string               _folder;
+    int                       _rank;
+    output_tasks*             _tasks {};
+
+    std::mutex                         _mutex;   // Guards the pending files
+    std::map<std::string, std::string> _pending; // By file name, only the shared files
+    std::map<std::string, std::string> _adopted; // The files to remove once shared
+}; // class output_files
+
+} // namespace sti
@@ -0,0 +1,149 @@
+/// @file output_tasks.cpp
+/// @brief Worker threads formatting and writing the results at the end of a run
+#include "output_tasks.hpp"
+
+#include <algorithm>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Start the workers
+/// @param workers The number of threads, 0 to use one per hardware thread
+sti::output_tasks::output_tasks(unsigned workers)
+{
+    if (workers == 0) workers = std::max(1U, std::thread::hardware_concurrency());
+    for (auto w = 0U; w < workers; ++w) _workers.emplace_back([this]() { work_loop(); });
+}
+
+/// @brief Finish the queued tasks and stop the workers
+sti::output_tasks::~output_tasks()
+{
+    {
+        const auto lock = std::lock_guard { _mutex };
+        _closing        = true;
+    }
+    _changed.notify_all();
+    for (auto& worker : _workers) worker.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of workers
+std::size_t sti::output_tasks::workers() const
+{
+    return _workers.size();
+}
+
+/// @brief Queue a task
+/// @param t The task
+void sti::output_tasks::run(task t)
+{
+    {
+        const auto lock = std::lock_guard { _mutex };
+        _queue.push_back(std::move(t));
+    }
+    _changed.notify_all();
+}
+
+/// @brief Get the number of chunks run_chunks() splits a range into
+/// @param n The size of the range
+std::size_t sti::output_tasks::chunks(std::size_t n) const
+{
+    return std::min(n, workers() * chunks_per_worker);
+}
+
+/// @brief Apply a function to chunks of a range, in parallel
+/// @details The chunks are queued as tasks, and awaited. Only from the
+/// main thread, like wait()
+/// @throws Whatever one of the chunks throws
+/// @param n The size of the range
+/// @param f The function, receives the chunk index, its first element
+/// and its end
+/// @return The number of chunks, see chunks()
+std::size_t sti::output_tasks::run_chunks(std::size_t n, const std::function<void(std::size_t, std::size_t, std::size_t)>& f)
+{
+    const auto total     = chunks(n);
+    auto       remaining = total;
+    auto       error     = std::exception_ptr {};
+    for (auto c = std::size_t { 0 }; c < total; ++c) {
+        run([&, c]() {
+            try {
+                f(c, n * c / total, n * (c + 1) / total);
+            } catch (...) {
+                const auto lock = std::lock_guard { _mutex };
+                if (!error) error = std::current_exception();
+            }
+            {
+                const auto lock = std::lock_guard { _mutex };
+                --remaining;
+            }
+            _changed.notify_all();
+        });
+    }
+
+    // The calling thread runs queued tasks too, instead of only waiting
+    auto lock = std::unique_lock { _mutex };
+    while (remaining != 0) {
+        if (_queue.empty()) {
+            _changed.wait(lock);
+            continue;
+        }
+        auto t = std::move(_queue.front());
+        _queue.pop_front();
+        lock.unlock();
+        try {
+            t();
+        } catch (...) {
+            lock.lock();
+            if (!_error) _error = std::current_exception();
+            continue;
+        }
+        lock.lock();
+    }
+    if (error) std::rethrow_exception(error);
+    return total;
+}
+
+/// @brief Wait until all the queued tasks ran, only from the main thread
+/// @throws Whatever the first failed task threw
+void sti::output_tasks::wait()
+{
+    auto lock = std::unique_lock { _mutex };
+    _changed.wait(lock, [this]() { return _queue.empty() && _running == 0; });
+    if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+/// @brief Body of the worker threads
+void sti::output_tasks::work_loop()
+{
+    while (true) {
+        auto t = task {};
+        {
+            auto lock = std::unique_lock { _mutex };
+            _changed.wait(lock, [this]() { return !_queue.empty() || _closing; });
+            if (_queue.empty()) return;
+
+            t = std::move(_queue.front());
+            _queue.pop_front();
+            ++_running;
+        }
+
+        auto error = std::exception_ptr {};
+        try {
+            t();
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            const auto lock = std::lock_guard { _mutex };
+            if (error && !_error) _error = error;
+            --_running;
+        }
+        _changed.notify_all();
+    }
+}
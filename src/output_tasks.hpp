@@ -0,0 +1,89 @@
+/// @file output_tasks.hpp
+/// @brief Worker threads formatting and writing the results at the end of a run
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sti {
+
+/// @brief A pool of threads running the output tasks of model::finish
+/// @details The subsystems snapshot their results on the main thread and
+/// queue the formatting and the writing of the files, that run concurrently
+/// on the workers while the main thread goes on with the next subsystem. A
+/// task can queue more tasks. The first exception thrown by a task is
+/// rethrown by wait(), the remaining tasks still run.
+class output_tasks {
+
+public:
+    using task = std::function<void()>;
+
+    /// @brief The chunks of run_chunks() per worker, to balance uneven chunks
+    constexpr static auto chunks_per_worker = std::size_t { 4 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Start the workers
+    /// @param workers The number of threads, 0 to use one per hardware thread
+    explicit output_tasks(unsigned workers);
+
+    output_tasks(const output_tasks&) = delete;
+    output_tasks& operator=(const output_tasks&) = delete;
+
+    output_tasks(output_tasks&&) = delete;
+    output_tasks& operator=(output_tasks&&) = delete;
+
+    /// @brief Finish the queued tasks and stop the workers
+    ~output_tasks();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of workers
+    std::size_t workers() const;
+
+    /// @brief Queue a task
+    /// @param t The task
+    void run(task t);
+
+    /// @brief Get the number of chunks run_chunks() splits a range into
+    /// @param n The size of the range
+    std::size_t chunks(std::size_t n) const;
+
+    /// @brief Apply a function to chunks of a range, in parallel
+    /// @details The chunks are queued as tasks, and awaited. Only from the
+    /// main thread, like wait()
+    /// @throws Whatever one of the chunks throws
+    /// @param n The size of the range
+    /// @param f The function, receives the chunk index, its first element
+    /// and its end
+    /// @return The number of chunks, see chunks()
+    std::size_t run_chunks(std::size_t n, const std::function<void(std::size_t, std::size_t, std::size_t)>& f);
+
+    /// @brief Wait until all the queued tasks ran, only from the main thread
+    /// @throws Whatever the first failed task threw
+    void wait();
+
+private:
+    /// @brief Body of the worker threads
+    void work_loop();
+
+    std::mutex               _mutex;
+    std::condition_variable  _changed;
+    std::deque<task>         _queue;
+    std::size_t              _running {};
+    bool                     _closing {};
+    std::exception_ptr       _error;
+    std::vector<std::thread> _workers;
+}; // class output_tasks
+
+} // namespace sti
@@ -1,28 +1,69 @@
 #include "pathfinder.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <deque>
 #include <fstream>
 #include <limits>
 #include <map>
 #include <memory>
 #include <optional>
+#include <queue>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <chrono>
+#include <utility>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/mpi/communicator.hpp>
+#include <boost/serialization/unordered_map.hpp>
+#include <mpi.h>
 
 #include "coordinates.hpp"
-#include "debug_flags.hpp"
 #include "clock.hpp"
+#include "memory_usage.hpp"
+#include "output_files.hpp"
 
 namespace {
-auto now_in_ns()
+
+/// @brief The four movements allowed, the index is stored in the flow fields
+const auto flow_directions = std::array {
+    sti::coordinates<int> { 0, 1 },
+    sti::coordinates<int> { 0, -1 },
+    sti::coordinates<int> { 1, 0 },
+    sti::coordinates<int> { -1, 0 }
+};
+
+/// @brief Flow field value of the cells that can't reach the destination
+constexpr auto flow_unreachable = std::uint8_t { 0xFF };
+
+/// @brief Flow field value of the destination itself
+constexpr auto flow_goal = std::uint8_t { 0xFE };
+
+/// @brief Flow field value of the cells without a known direction, only used
+/// in the persistent cache, where the fields are built from the A* cache
+constexpr auto flow_unknown = std::uint8_t { 0xFD };
+
+/// @brief Get the direction pointing from one cell to an adjacent one
+/// @param diff The difference between the adjacent cell and the cell
+/// @return The index of the direction in flow_directions
+std::uint8_t flow_direction(const sti::coordinates<int>& diff)
 {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()).time_since_epoch()).count();
-}
+    for (auto i = 0U; i < flow_directions.size(); ++i) {
+        if (flow_directions.at(i) == diff) return static_cast<std::uint8_t>(i);
+    }
+    return flow_unreachable;
 }
 
+} // namespace
+
 /// @brief Collect pathfinding statistics
 class sti::pathfinder::statistics {
 
@@ -31,26 +72,30 @@ public:
         datetime      time;
         std::uint32_t cache_miss {};
         std::uint32_t cache_hit {};
+        std::uint32_t cache_eviction {};
     }; // struct entry
 
-    /// @brief Construct a new statistics object
+    /// @brief Construct a new statistics object, disabled
     statistics(const clock* clock)
         : _clock { clock }
     {
     }
 
+    /// @brief Start collecting the statistics
+    /// @param now The timestamp source
+    void enable(instrumentation::clock_function now)
+    {
+        _enabled = true;
+        _now     = now;
+    }
+
     /// @brief Notify of a cache hit
     /// @details The pathfinder saves all previous calculated paths in a cache,
     /// this method is used to count the number of cache hits
     void cache_hit()
     {
-        if constexpr (sti::debug::pathfinder_statistics) {
-            if (_cache.begin() == _cache.end() || (_cache.end() - 1)->time != _clock->now()) {
-                _cache.push_back({ _clock->now() });
-            }
-            const auto last = _cache.end() - 1;
-            last->cache_hit += 1;
-        }
+        if (!_enabled) return;
+        current().cache_hit += 1;
     } // void cache_hit()
 
     /// @brief Notify of a cache miss
@@ -58,77 +103,806 @@ public:
     /// this method is used to count the number of cache misses
     void cache_miss()
     {
-        if constexpr (sti::debug::pathfinder_statistics) {
-            if (_cache.begin() == _cache.end() || (_cache.end() - 1)->time != _clock->now()) {
-                _cache.push_back({ _clock->now() });
-            }
-            const auto last = _cache.end() - 1;
-            last->cache_miss += 1;
-        }
+        if (!_enabled) return;
+        current().cache_miss += 1;
     } // void cache_miss()
 
+    /// @brief Notify of the eviction of the paths to a destination
+    /// @details With a bounded cache, see pathfinder::bound_cache()
+    void cache_eviction()
+    {
+        if (!_enabled) return;
+        current().cache_eviction += 1;
+    } // void cache_eviction()
+
     /// @brief Indicate the start of a method call
     void call_start()
     {
-        if constexpr (sti::debug::pathfinder_statistics) {
-            _call_start = now_in_ns();
-        }
+        if (_enabled) _call_start = _now();
     }
 
     /// @brief Indicate the end of a method call
     void call_end()
     {
-        if constexpr (sti::debug::pathfinder_statistics) {
-            _time_spent_ns += now_in_ns() - _call_start;
-        }
+        if (_enabled) _time_spent_ns += _now() - _call_start;
     }
 
-    /// @brief Save the statistics to a file
-    /// @param folderpath The folder to save the file to
-    /// @param rank The rank of this process
-    void save(const std::string& folderpath, int rank) const
+    /// @brief Save the statistics to the result files
+    /// @param output The result files
+    void save(output_files& output) const
     {
-        if constexpr (sti::debug::pathfinder_statistics) {
-
-            auto cache_os = std::ostringstream {};
-            cache_os << folderpath
-                     << "/pathfinder_cache_stats.p"
-                     << rank
-                     << ".csv";
+        if (_enabled) {
+            // Formatted from a copy, with the output tasks
+            output.write("pathfinder_cache_stats", "csv", [cache = _cache]() {
+                auto cache_file = std::ostringstream {};
+                cache_file << "datetime,hits,misses,evictions\n";
 
-            auto cache_file = std::ofstream { cache_os.str() };
-            cache_file << "datetime,hits,misses\n";
-
-            for (const auto& entry : _cache) {
-                cache_file << entry.time.seconds_since_epoch() << ','
-                           << entry.cache_hit << ','
-                           << entry.cache_miss << '\n';
-            }
-            auto general_os = std::ostringstream {};
-            general_os << folderpath
-                       << "/pathfinder_global.p"
-                       << rank
-                       << ".csv";
+                for (const auto& record : cache) {
+                    cache_file << record.time.seconds_since_epoch() << ','
+                               << record.cache_hit << ','
+                               << record.cache_miss << ','
+                               << record.cache_eviction << '\n';
+                }
+                return cache_file.str();
+            });
 
-            auto general_file = std::ofstream { general_os.str() };
+            auto general_file = std::ostringstream {};
             general_file << "time_spent" << '\n';
             general_file << _time_spent_ns << '\n';
+            output.write("pathfinder_global", "csv", general_file.str());
         }
     } // void save(...)
 
 private:
-    const clock*       _clock;
-    std::vector<entry> _cache;
-    long               _time_spent_ns {};
-    long               _call_start {};
+    /// @brief Get the entry of the current tick, adding it if needed
+    entry& current()
+    {
+        if (_cache.empty() || _cache.back().time != _clock->now()) _cache.push_back({ _clock->now() });
+        return _cache.back();
+    }
+
+    const clock*                    _clock;
+    bool                            _enabled {};
+    instrumentation::clock_function _now {};
+    std::vector<entry>              _cache;
+    std::int64_t                    _time_spent_ns {};
+    std::int64_t                    _call_start {};
 }; // struct sti::pathfinder::statistics
 
+/// @brief Scratch memory used by A*, reused across searches
+/// @details All the arrays have width x height elements, indexed as the
+/// obstacles grid. Instead of clearing the arrays before every
+/// search, each cell stores the search (generation) in which it was written
+/// last, a cell with an old generation is considered unvisited. The open set
+/// is a binary heap with an index per cell, supporting decrease-key.
+class sti::pathfinder::search_space {
+
+public:
+    using index_type = std::uint32_t;
+
+    /// @brief Value indicating no cell, used for the start and closed cells
+    static constexpr auto no_index = std::numeric_limits<index_type>::max();
+
+    /// @brief Allocate the scratch memory for a given map
+    /// @param obstacles The obstacles grid
+    search_space(const obstacles_map* obstacles)
+        : _obstacles { obstacles }
+        , _generation(obstacles->size(), 0)
+        , _g_score(obstacles->size())
+        , _f_score(obstacles->size())
+        , _came_from(obstacles->size())
+        , _heap_position(obstacles->size())
+    {
+        _heap.reserve(obstacles->size());
+    }
+
+    /// @brief Get the flat index of a cell
+    index_type index(const coordinates<int>& cell) const
+    {
+        return static_cast<index_type>(_obstacles->index(cell));
+    }
+
+    /// @brief Get the cell of a flat index
+    coordinates<int> cell(index_type index) const
+    {
+        return _obstacles->cell(index);
+    }
+
+    /// @brief Start a new search, invalidating all previous values
+    void new_search()
+    {
+        _heap.clear();
+        if (++_current == 0) {
+            // The generation counter wrapped, reset the stamps
+            std::fill(_generation.begin(), _generation.end(), 0);
+            _current = 1;
+        }
+    }
+
+    /// @brief Check if a cell has been reached in the current search
+    bool visited(index_type index) const
+    {
+        return _generation[index] == _current;
+    }
+
+    /// @brief Get the cost from the start to a cell, infinity if unvisited
+    double g_score(index_type index) const
+    {
+        return visited(index) ? _g_score[index] : std::numeric_limits<double>::infinity();
+    }
+
+    /// @brief Get the previous cell in the path, no_index for the start
+    index_type came_from(index_type index) const
+    {
+        return _came_from[index];
+    }
+
+    /// @brief Set the scores of a cell, inserting it into the open set or
+    /// decreasing its key if already present
+    /// @param index The cell
+    /// @param from The previous cell in the path
+    /// @param g The cost from the start
+    /// @param f The estimated total cost
+    void update(index_type index, index_type from, double g, double f)
+    {
+        if (!visited(index)) {
+            _generation[index]    = _current;
+            _heap_position[index] = no_index;
+        }
+        _came_from[index] = from;
+        _g_score[index]   = g;
+        _f_score[index]   = f;
+
+        if (_heap_position[index] == no_index) {
+            _heap_position[index] = static_cast<index_type>(_heap.size());
+            _heap.push_back(index);
+        }
+        sift_up(_heap_position[index]);
+    }
+
+    /// @brief Check if the open set is empty
+    bool empty() const
+    {
+        return _heap.empty();
+    }
+
+    /// @brief Remove and return the cell with the lowest f score
+    index_type pop()
+    {
+        const auto top      = _heap.front();
+        _heap_position[top] = no_index;
+        _heap.front()       = _heap.back();
+        _heap.pop_back();
+        if (!_heap.empty()) {
+            _heap_position[_heap.front()] = 0;
+            sift_down(0);
+        }
+        return top;
+    }
+
+private:
+    /// @brief Move an element of the heap up until the heap property holds
+    void sift_up(index_type position)
+    {
+        const auto element = _heap[position];
+        while (position > 0) {
+            const auto parent = (position - 1) / 2;
+            if (_f_score[_heap[parent]] <= _f_score[element]) break;
+            _heap[position]                 = _heap[parent];
+            _heap_position[_heap[position]] = position;
+            position                        = parent;
+        }
+        _heap[position]         = element;
+        _heap_position[element] = position;
+    }
+
+    /// @brief Move an element of the heap down until the heap property holds
+    void sift_down(index_type position)
+    {
+        const auto element = _heap[position];
+        const auto size    = static_cast<index_type>(_heap.size());
+        while (true) {
+            auto child = 2 * position + 1;
+            if (child >= size) break;
+            if (child + 1 < size && _f_score[_heap[child + 1]] < _f_score[_heap[child]]) ++child;
+            if (_f_score[element] <= _f_score[_heap[child]]) break;
+            _heap[position]                 = _heap[child];
+            _heap_position[_heap[position]] = position;
+            position                        = child;
+        }
+        _heap[position]         = element;
+        _heap_position[element] = position;
+    }
+
+    const obstacles_map*       _obstacles;
+    std::uint32_t              _current {};
+    std::vector<std::uint32_t> _generation;
+    std::vector<double>        _g_score;
+    std::vector<double>        _f_score;
+    std::vector<index_type>    _came_from;
+    std::vector<index_type>    _heap_position;
+    std::vector<index_type>    _heap;
+}; // class sti::pathfinder::search_space
+
+/// @brief Persistent path cache, stored as a memory mapped binary file
+/// @details The file stores a set of flow fields, one per destination, so the
+/// paths can be reused across runs with the same plan. The file is mapped
+/// read-only, all the processes in a node share the same physical pages. The
+/// format, in native byte order, is:
+///   - header: magic 'STIP', version, grid hash, width, height, # of fields
+///   - the destination of each field, as two int32
+///   - the fields, width x height bytes each, indexed as the obstacles grid
+class sti::pathfinder::cache_file {
+
+public:
+    using destination_type = coordinates<int>;
+
+    /// @brief The file header
+    struct header {
+        std::array<char, 4> magic;
+        std::uint32_t       version;
+        std::uint64_t       grid_hash;
+        std::uint32_t       width;
+        std::uint32_t       height;
+        std::uint32_t       fields;
+        std::uint32_t       reserved;
+    }; // struct header
+
+    /// @brief A destination in the file
+    struct goal_entry {
+        std::int32_t x;
+        std::int32_t y;
+    }; // struct goal_entry
+
+    /// @brief A field mapped from the file
+    struct mapped_field {
+        const std::uint8_t* data;
+        bool                complete; // True if there are no unknown cells
+    }; // struct mapped_field
+
+    static constexpr auto magic   = std::array { 'S', 'T', 'I', 'P' };
+    static constexpr auto version = std::uint32_t { 1 };
+
+    /// @brief Map a cache file, if the file is missing or invalid the cache is empty
+    /// @param filepath The path to the file
+    /// @param obstacles The obstacles grid, to validate the file
+    cache_file(const std::string& filepath, const obstacles_map& obstacles)
+        : _filepath { filepath }
+    {
+        const auto fd = ::open(filepath.c_str(), O_RDONLY); // NOLINT
+        if (fd < 0) return;
+
+        struct stat st { };
+        if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(header)) {
+            _size = static_cast<std::size_t>(st.st_size);
+            _map  = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+            if (_map == MAP_FAILED) { // NOLINT
+                _map  = nullptr;
+                _size = 0;
+            }
+        }
+        ::close(fd);
+
+        if (_map != nullptr && !index(obstacles)) {
+            // The file belongs to another plan or is corrupted, ignore it
+            ::munmap(_map, _size);
+            _map  = nullptr;
+            _size = 0;
+            _fields.clear();
+        }
+    }
+
+    cache_file(const cache_file&) = delete;
+    cache_file& operator=(const cache_file&) = delete;
+
+    cache_file(cache_file&&) = delete;
+    cache_file& operator=(cache_file&&) = delete;
+
+    ~cache_file()
+    {
+        if (_map != nullptr) ::munmap(_map, _size);
+    }
+
+    /// @brief Get the path of the file
+    const std::string& filepath() const
+    {
+        return _filepath;
+    }
+
+    /// @brief Get the field of a destination
+    /// @param goal The destination
+    /// @return A pointer to the field, nullptr if the destination is not cached
+    const mapped_field* find(const destination_type& goal) const
+    {
+        const auto it = _fields.find(goal);
+        if (it == _fields.end()) return nullptr;
+        return &it->second;
+    }
+
+    /// @brief Get all the mapped fields
+    const std::unordered_map<destination_type, mapped_field>& fields() const
+    {
+        return _fields;
+    }
+
+    /// @brief Write a set of fields to a file
+    /// @details The file is written to a temporary file and then renamed, so
+    /// processes writing the same file concurrently never produce a corrupted
+    /// cache, and mapped copies remain valid
+    /// @param filepath The path of the file
+    /// @param rank The rank of the process, with the pid it names the
+    /// temporary file, unique between the replicas of an ensemble
+    /// @param obstacles The obstacles grid
+    /// @param fields The fields to store
+    static void write(const std::string&                                           filepath,
+                      int                                                          rank,
+                      const obstacles_map&                                         obstacles,
+                      const std::map<destination_type, std::vector<std::uint8_t>>& fields)
+    {
+        auto tmp_os = std::ostringstream {};
+        tmp_os << filepath << ".p" << rank << "." << getpid() << ".tmp";
+        const auto tmp_path = tmp_os.str();
+
+        {
+            auto file = std::ofstream { tmp_path, std::ios::binary };
+
+            const auto hdr = header {
+                magic,
+                version,
+                obstacles.hash(),
+                static_cast<std::uint32_t>(obstacles.width()),
+                static_cast<std::uint32_t>(obstacles.height()),
+                static_cast<std::uint32_t>(fields.size()),
+                0
+            };
+            file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr)); // NOLINT
+
+            for (const auto& [goal, field] : fields) {
+                const auto entry = goal_entry { goal.x, goal.y };
+                file.write(reinterpret_cast<const char*>(&entry), sizeof(entry)); // NOLINT
+            }
+            for (const auto& [goal, field] : fields) {
+                file.write(reinterpret_cast<const char*>(field.data()), static_cast<std::streamsize>(field.size())); // NOLINT
+            }
+        }
+
+        std::rename(tmp_path.c_str(), filepath.c_str());
+    }
+
+private:
+    /// @brief Validate the mapped file and index the fields
+    /// @param obstacles The obstacles grid
+    /// @return True if the file is valid for the given grid
+    bool index(const obstacles_map& obstacles)
+    {
+        const auto* bytes = static_cast<const std::uint8_t*>(_map);
+        auto        hdr   = header {};
+        std::memcpy(&hdr, bytes, sizeof(hdr));
+
+        if (hdr.magic != magic || hdr.version != version) return false;
+        if (hdr.grid_hash != obstacles.hash()) return false;
+        if (hdr.width != obstacles.width() || hdr.height != obstacles.height()) return false;
+
+        const auto field_size = obstacles.size();
+        const auto expected   = sizeof(header) + hdr.fields * (sizeof(goal_entry) + field_size);
+        if (_size != expected) return false;
+
+        const auto* goals = bytes + sizeof(header);
+        const auto* data  = goals + hdr.fields * sizeof(goal_entry);
+        for (auto i = std::size_t { 0 }; i < hdr.fields; ++i) {
+            auto entry = goal_entry {};
+            std::memcpy(&entry, goals + i * sizeof(goal_entry), sizeof(entry));
+
+            const auto* field    = data + i * field_size;
+            const auto  complete = std::find(field, field + field_size, flow_unknown) == field + field_size;
+            _fields[{ entry.x, entry.y }] = { field, complete };
+        }
+        return true;
+    }
+
+    std::string                                        _filepath;
+    void*                                              _map {};
+    std::size_t                                        _size {};
+    std::unordered_map<destination_type, mapped_field> _fields;
+}; // class sti::pathfinder::cache_file
+
+/// @brief Flow fields stored in a node-level MPI-3 shared memory window
+/// @details The first process of each node allocates the memory, the rest
+/// query the address of the segment. All the processes map the same pages.
+class sti::pathfinder::shared_fields {
+
+public:
+    /// @brief Allocate the shared window, collective over the communicator
+    /// @param comm The communicator containing all the processes
+    /// @param bytes The total size of the fields
+    shared_fields(MPI_Comm comm, std::size_t bytes)
+    {
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &_node_comm);
+        MPI_Comm_rank(_node_comm, &_node_rank);
+        MPI_Comm_size(_node_comm, &_node_size);
+
+        // Only the first process in the node allocates memory
+        const auto local_bytes = static_cast<MPI_Aint>(_node_rank == 0 ? bytes : 0);
+        void*      base        = nullptr;
+        MPI_Win_allocate_shared(local_bytes, 1, MPI_INFO_NULL, _node_comm, &base, &_window);
+
+        auto size = MPI_Aint {};
+        auto disp = int {};
+        MPI_Win_shared_query(_window, 0, &size, &disp, &base);
+        _data = static_cast<std::uint8_t*>(base);
+    }
+
+    shared_fields(const shared_fields&) = delete;
+    shared_fields& operator=(const shared_fields&) = delete;
+
+    shared_fields(shared_fields&&) = delete;
+    shared_fields& operator=(shared_fields&&) = delete;
+
+    ~shared_fields()
+    {
+        MPI_Win_free(&_window);
+        MPI_Comm_free(&_node_comm);
+    }
+
+    /// @brief Get the start of the shared segment
+    std::uint8_t* data()
+    {
+        return _data;
+    }
+
+    /// @brief Get the rank of the process inside the node
+    int node_rank() const
+    {
+        return _node_rank;
+    }
+
+    /// @brief Get the number of processes in the node
+    int node_size() const
+    {
+        return _node_size;
+    }
+
+    /// @brief Synchronize the memory between the processes of the node
+    void fence()
+    {
+        MPI_Win_fence(0, _window);
+    }
+
+    /// @brief The location of each field inside the segment
+    std::unordered_map<coordinates<int>, const std::uint8_t*> fields;
+
+private:
+    MPI_Comm      _node_comm {};
+    MPI_Win       _window {};
+    std::uint8_t* _data {};
+    int           _node_rank {};
+    int           _node_size {};
+}; // class sti::pathfinder::shared_fields
+
+/// @brief Abstraction of the obstacles grid in clusters, for HPA* searches
+/// @details The grid is split in square clusters. Every run of walkable cells
+/// along the border of two clusters is an entrance, with a pair of portals in
+/// its middle cell, one in each cluster. The distances between the portals of
+/// each cluster are computed once, with a BFS that doesn't leave the cluster,
+/// and are the edges of the abstract graph, with the unit edges crossing the
+/// entrances. A search only visits the cells of the start and goal clusters,
+/// to link them to their portals, and the portals, so its cost and the memory
+/// of the graph grow with the number of clusters, not the number of cells.
+/// The paths are optimal in the abstract graph, not in the grid, they can
+/// be slightly longer than the A* ones.
+class sti::pathfinder::hierarchy {
+
+public:
+    using index_type = std::uint32_t;
+
+    /// @brief The cells and the direction to take from each one, in order
+    using segment_type = std::vector<std::pair<index_type, std::uint8_t>>;
+
+    /// @brief Build the clusters, the portals and the distances between them
+    /// @param obstacles The obstacles grid
+    /// @param cluster_size The cells of each side of the clusters
+    hierarchy(const obstacles_map* obstacles, int cluster_size)
+        : _obstacles { obstacles }
+        , _size { std::max(cluster_size, 2) }
+        , _columns { (static_cast<int>(obstacles->width()) + _size - 1) / _size }
+        , _rows { (static_cast<int>(obstacles->height()) + _size - 1) / _size }
+        , _cluster_portals(static_cast<std::size_t>(_columns) * static_cast<std::size_t>(_rows))
+    {
+        const auto cells = static_cast<std::size_t>(_size) * static_cast<std::size_t>(_size);
+        for (auto* space : { &_from_start, &_to_goal }) {
+            space->distance.resize(cells);
+            space->parent.resize(cells);
+            space->queue.reserve(cells);
+        }
+
+        // The entrances between the horizontal and the vertical neighbors
+        for (auto cy = 0; cy < _rows; ++cy) {
+            for (auto cx = 0; cx < _columns; ++cx) {
+                if (cx + 1 < _columns) add_entrances({ (cx + 1) * _size - 1, cy * _size }, { 1, 0 });
+                if (cy + 1 < _rows) add_entrances({ cx * _size, (cy + 1) * _size - 1 }, { 0, 1 });
+            }
+        }
+
+        // The distances between the portals of each cluster
+        for (const auto& portals : _cluster_portals) {
+            for (const auto from : portals) {
+                search_cluster(_obstacles->cell(_portal_cells[from]), nullptr, _from_start);
+                for (const auto to : portals) {
+                    if (to == from) continue;
+                    const auto d = _from_start.distance[local(_obstacles->cell(_portal_cells[to]))];
+                    if (d > 0) _edges[from].push_back({ to, static_cast<std::uint32_t>(d) });
+                }
+            }
+        }
+
+        const auto nodes = _portal_cells.size() + 2;
+        _g_score.resize(nodes);
+        _came_from.resize(nodes);
+        _generation.resize(nodes, 0);
+    }
+
+    /// @brief Find the first segment of the path from start to goal
+    /// @details The segment goes from the start to the next portal of the
+    /// abstract path, or to the goal if it's the next node. Every cell of the
+    /// segment is on a shortest abstract path, a search from any of them
+    /// continues the same path
+    /// @param start The initial point
+    /// @param goal The destination point
+    /// @param segment Output, the cells of the segment and their directions
+    /// @return False if there is no path
+    bool first_segment(const coordinates<int>& start, const coordinates<int>& goal, segment_type& segment)
+    {
+        segment.clear();
+        if (start == goal) return false;
+
+        const auto start_cluster = cluster_of(start);
+        const auto goal_cluster  = cluster_of(goal);
+        search_cluster(start, &goal, _from_start);
+        search_cluster(goal, nullptr, _to_goal);
+
+        const auto start_node = static_cast<index_type>(_portal_cells.size());
+        const auto goal_node  = start_node + 1;
+        const auto node_cell  = [&](index_type node) {
+            if (node == start_node) return start;
+            if (node == goal_node) return goal;
+            return _obstacles->cell(_portal_cells[node]);
+        };
+
+        // A* over the portals, the start and the goal
+        if (++_current == 0) {
+            std::fill(_generation.begin(), _generation.end(), 0);
+            _current = 1;
+        }
+        using entry = std::pair<std::uint32_t, index_type>;
+        auto open   = std::priority_queue<entry, std::vector<entry>, std::greater<>> {};
+        const auto visit = [&](index_type from, index_type to, std::uint32_t cost) {
+            const auto g = _g_score[from] + cost;
+            if (_generation[to] == _current && _g_score[to] <= g) return;
+            _generation[to] = _current;
+            _g_score[to]    = g;
+            _came_from[to]  = from;
+            const auto d    = node_cell(to) - goal;
+            open.emplace(g + static_cast<std::uint32_t>(std::abs(d.x) + std::abs(d.y)), to);
+        };
+
+        _generation[start_node] = _current;
+        _g_score[start_node]    = 0;
+        open.emplace(0, start_node);
+        auto found = false;
+        while (!open.empty()) {
+            const auto [f, node] = open.top();
+            open.pop();
+            if (node == goal_node) {
+                found = true;
+                break;
+            }
+            const auto d = node_cell(node) - goal;
+            if (f > _g_score[node] + static_cast<std::uint32_t>(std::abs(d.x) + std::abs(d.y))) continue; // Stale entry
+
+            if (node == start_node) {
+                for (const auto portal : _cluster_portals[start_cluster]) {
+                    const auto cost = _from_start.distance[local(_obstacles->cell(_portal_cells[portal]))];
+                    if (cost >= 0) visit(node, portal, static_cast<std::uint32_t>(cost));
+                }
+                if (goal_cluster == start_cluster && _from_start.distance[local(goal)] >= 0) {
+                    visit(node, goal_node, static_cast<std::uint32_t>(_from_start.distance[local(goal)]));
+                }
+                continue;
+            }
+
+            for (const auto& e : _edges[node]) visit(node, e.to, e.cost);
+            if (_portal_clusters[node] == goal_cluster) {
+                const auto cost = _to_goal.distance[local(node_cell(node))];
+                if (cost >= 0) visit(node, goal_node, static_cast<std::uint32_t>(cost));
+            }
+        } // while (!open.empty())
+        if (!found) return false;
+
+        // The first node of the path that isn't the start cell
+        auto path = std::vector<index_type> {};
+        for (auto node = goal_node; node != start_node; node = _came_from[node]) path.push_back(node);
+        auto next = path.rbegin();
+        while (next != path.rend() && node_cell(*next) == start) ++next;
+        if (next == path.rend()) return false;
+        const auto target = node_cell(*next);
+
+        // Over an entrance, a single step into the neighbor cluster
+        if (cluster_of(target) != start_cluster || _from_start.distance[local(target)] < 0) {
+            const auto dir = flow_direction(target - start);
+            if (dir == flow_unreachable) return false;
+            segment.emplace_back(static_cast<index_type>(_obstacles->index(start)), dir);
+            return true;
+        }
+
+        // Inside the start cluster, follow the BFS back from the target
+        auto cells = std::vector<coordinates<int>> { target };
+        for (auto i = _from_start.parent[local(target)]; i >= 0; i = _from_start.parent[static_cast<std::size_t>(i)]) {
+            cells.push_back(global(start_cluster, i));
+        }
+        std::reverse(cells.begin(), cells.end());
+        for (auto i = std::size_t { 0 }; i + 1 < cells.size(); ++i) {
+            segment.emplace_back(static_cast<index_type>(_obstacles->index(cells[i])), flow_direction(cells[i + 1] - cells[i]));
+        }
+        return true;
+    } // bool first_segment(...)
+
+    /// @brief Get the heap bytes of the abstract graph and the scratch memory
+    std::size_t memory_bytes() const
+    {
+        auto total = memory::bytes(_portal_cells) + memory::bytes(_portal_clusters)
+            + memory::bytes(_edges) + memory::bytes(_cluster_portals) + memory::bytes(_portal_at)
+            + memory::bytes(_g_score) + memory::bytes(_came_from) + memory::bytes(_generation);
+        for (const auto* space : { &_from_start, &_to_goal }) {
+            total += memory::bytes(space->distance) + memory::bytes(space->parent) + memory::bytes(space->queue);
+        }
+        return total;
+    }
+
+private:
+    /// @brief An edge of the abstract graph
+    struct edge {
+        index_type    to;
+        std::uint32_t cost;
+    };
+
+    /// @brief Scratch memory of a BFS inside a cluster, by local index
+    struct local_space {
+        std::vector<std::int32_t> distance; // -1 if not reached
+        std::vector<std::int32_t> parent;   // -1 for the source
+        std::vector<std::int32_t> queue;
+    };
+
+    /// @brief Get the cluster of a cell
+    std::size_t cluster_of(const coordinates<int>& cell) const
+    {
+        return static_cast<std::size_t>(cell.y / _size) * static_cast<std::size_t>(_columns)
+            + static_cast<std::size_t>(cell.x / _size);
+    }
+
+    /// @brief Get the index of a cell inside its cluster
+    std::size_t local(const coordinates<int>& cell) const
+    {
+        return static_cast<std::size_t>(cell.y % _size) * static_cast<std::size_t>(_size)
+            + static_cast<std::size_t>(cell.x % _size);
+    }
+
+    /// @brief Get the cell of an index inside a cluster
+    coordinates<int> global(std::size_t cluster, std::int32_t index) const
+    {
+        const auto c = static_cast<int>(cluster);
+        return { (c % _columns) * _size + index % _size, (c / _columns) * _size + index / _size };
+    }
+
+    /// @brief Get the portal of a cell, creating it if needed
+    index_type portal(const coordinates<int>& cell)
+    {
+        const auto index = static_cast<index_type>(_obstacles->index(cell));
+        const auto it    = _portal_at.find(index);
+        if (it != _portal_at.end()) return it->second;
+
+        const auto p = static_cast<index_type>(_portal_cells.size());
+        _portal_at.emplace(index, p);
+        _portal_cells.push_back(index);
+        _portal_clusters.push_back(cluster_of(cell));
+        _edges.emplace_back();
+        _cluster_portals[cluster_of(cell)].push_back(p);
+        return p;
+    }
+
+    /// @brief Add the entrances along the border of two clusters
+    /// @param first The first cell of the border, in the first cluster
+    /// @param across The direction from the first cluster to the second one
+    void add_entrances(const coordinates<int>& first, const coordinates<int>& across)
+    {
+        const auto along  = coordinates<int> { across.y, across.x };
+        const auto length = across.x != 0 ? std::min(_size, static_cast<int>(_obstacles->height()) - first.y)
+                                          : std::min(_size, static_cast<int>(_obstacles->width()) - first.x);
+        const auto open   = [&](int i) {
+            const auto cell = first + coordinates<int> { along.x * i, along.y * i };
+            return _obstacles->walkable(cell) && _obstacles->walkable(cell + across);
+        };
+
+        for (auto i = 0; i < length;) {
+            if (!open(i)) {
+                ++i;
+                continue;
+            }
+            auto end = i;
+            while (end < length && open(end)) ++end;
+
+            const auto middle = (i + end - 1) / 2;
+            const auto a      = portal(first + coordinates<int> { along.x * middle, along.y * middle });
+            const auto b      = portal(first + coordinates<int> { along.x * middle + across.x, along.y * middle + across.y });
+            _edges[a].push_back({ b, 1 });
+            _edges[b].push_back({ a, 1 });
+            i = end;
+        }
+    }
+
+    /// @brief Breadth first search that doesn't leave the cluster of the source
+    /// @details The search only steps into walkable cells, or the target, as
+    /// adjacents() does. Since the moves are symmetric, a search from the goal
+    /// without target gives the distances to the goal
+    /// @param source The first cell, expanded even if it's not walkable
+    /// @param target The destination, reached but not expanded, or nullptr
+    /// @param space Output, the distances and the parents
+    void search_cluster(const coordinates<int>& source, const coordinates<int>* target, local_space& space) const
+    {
+        const auto cluster = cluster_of(source);
+        std::fill(space.distance.begin(), space.distance.end(), -1);
+        space.queue.clear();
+
+        const auto first      = static_cast<std::int32_t>(local(source));
+        space.distance[first] = 0;
+        space.parent[first]   = -1;
+        space.queue.push_back(first);
+        for (auto head = std::size_t { 0 }; head < space.queue.size(); ++head) {
+            const auto current = space.queue[head];
+            const auto cell    = global(cluster, current);
+            if (target != nullptr && cell == *target && cell != source) continue;
+
+            for (const auto& diff : flow_directions) {
+                const auto neighbor = cell + diff;
+                if (!_obstacles->contains(neighbor) || cluster_of(neighbor) != cluster) continue;
+                if (!_obstacles->walkable(neighbor) && (target == nullptr || neighbor != *target)) continue;
+
+                const auto index = local(neighbor);
+                if (space.distance[index] >= 0) continue;
+                space.distance[index] = space.distance[static_cast<std::size_t>(current)] + 1;
+                space.parent[index]   = current;
+                space.queue.push_back(static_cast<std::int32_t>(index));
+            }
+        }
+    }
+
+    const obstacles_map* _obstacles;
+    int                  _size;
+    int                  _columns;
+    int                  _rows;
+
+    // The abstract graph
+    std::vector<index_type>                    _portal_cells;    // Cell index of each portal
+    std::vector<std::size_t>                   _portal_clusters; // Cluster of each portal
+    std::vector<std::vector<edge>>             _edges;           // By portal
+    std::vector<std::vector<index_type>>       _cluster_portals; // By cluster
+    std::unordered_map<index_type, index_type> _portal_at;       // By cell index
+
+    // Scratch memory of the searches
+    local_space                _from_start;
+    local_space                _to_goal;
+    std::vector<std::uint32_t> _g_score;
+    std::vector<index_type>    _came_from;
+    std::vector<std::uint32_t> _generation;
+    std::uint32_t              _current {};
+}; // class sti::pathfinder::hierarchy
+
 /// @brief Construct a pathfinder
 /// @param obstacles The map with the obstacles
 /// @param clock The simulation clock, for statistics collection
 sti::pathfinder::pathfinder(const obstacles_map* obstacles,
                             const clock*         clock)
     : _obstacles { obstacles }
+    , _search { std::make_unique<search_space>(obstacles) }
     , _stats { std::make_unique<statistics>(clock) }
 {
 } // sti::pathfinder::pathfinder(...)
@@ -136,6 +910,40 @@ sti::pathfinder::pathfinder(const obstacles_map* obstacles,
 /// @brief Destruct defined later due to fw. declaration of statistics
 sti::pathfinder::~pathfinder() = default;
 
+/// @brief Collect the cache hits and the time spent, saved in save()
+/// @param now The timestamp source
+void sti::pathfinder::collect_statistics(instrumentation::clock_function now)
+{
+    _stats->enable(now);
+}
+
+/// @brief Bound the memory of the paths found with A*
+/// @details When a new path takes the paths over the budget, the paths
+/// to other destinations are evicted, the least recently used ones or the
+/// least used ones, until they fit again. An evicted path is searched
+/// again the next time it's needed
+/// @param budget The bytes of the cached paths, 0 for no bound
+/// @param eviction The destinations evicted first
+void sti::pathfinder::bound_cache(std::size_t budget, EVICTION eviction)
+{
+    _paths_budget = budget;
+    _eviction     = eviction;
+}
+
+/// @brief Search the paths not in the cache with HPA* instead of A*
+/// @details The grid is split in square clusters, linked by portals at
+/// the entrances between them, and the distances between the portals of
+/// each cluster are computed once. A miss searches the graph of portals
+/// and refines only its first segment inside the cluster of the start,
+/// which is cached as the A* paths. The time of a miss and the memory of
+/// the searches grow with the clusters instead of the cells, at the cost
+/// of paths slightly longer than the optimal ones
+/// @param cluster_size The cells of each side of the clusters
+void sti::pathfinder::use_hierarchy(int cluster_size)
+{
+    _hierarchy = std::make_unique<hierarchy>(_obstacles, cluster_size);
+}
+
 /// @brief Helper functions for the pathfinding
 namespace {
 
@@ -158,6 +966,22 @@ inline double heuristic(const sti::coordinates<int>& from, const sti::coordinate
     return distance(from, goal);
 }
 
+/// @brief Fixed capacity list of neighbors, to avoid allocating on each expansion
+struct neighbors_list {
+    std::array<sti::coordinates<int>, 4> cells;
+    std::size_t                          size {};
+
+    auto begin() const
+    {
+        return cells.begin();
+    }
+
+    auto end() const
+    {
+        return cells.begin() + static_cast<std::ptrdiff_t>(size);
+    }
+}; // struct neighbors_list
+
 /// @brief Get the neighbors of a given cell
 /// @param obstacles The map with the obstacles
 /// @param cell The cell to look for walkable neighbors
@@ -165,83 +989,28 @@ inline double heuristic(const sti::coordinates<int>& from, const sti::coordinate
 /// non-walkable cell should be inserted into the neighbors. For instance, the
 /// exit is non-walkable because it absorbs all the patients walking over it,
 /// but if the destination is the exit, the patient needs to step on it
-inline std::vector<sti::coordinates<int>> adjacents(
+inline neighbors_list adjacents(
     const sti::pathfinder::obstacles_map& obstacles,
     const sti::coordinates<int>&          cell,
     const sti::coordinates<int>&          goal)
 {
+    auto           neighbors = neighbors_list {};
+    constexpr auto dx        = std::array { 0, 0, 1, -1 };
+    constexpr auto dy        = std::array { 1, -1, 0, 0 };
 
-    auto       neighbors = std::vector<sti::coordinates<int>> {};
-    const auto diffs     = std::array {
-        sti::coordinates<int> { 0, 1 },
-        sti::coordinates<int> { 0, -1 },
-        sti::coordinates<int> { 1, 0 },
-        sti::coordinates<int> { -1, 0 }
-    };
-    for (const auto& diff : diffs) {
-        const auto& neighbor = cell + diff;
-        if (neighbor.x < 0 || neighbor.y < 0) continue;
-        if (static_cast<std::size_t>(neighbor.x) >= obstacles.size()
-            || static_cast<std::size_t>(neighbor.y) >= obstacles.at(0).size()) continue;
+    for (auto i = 0U; i < dx.size(); ++i) {
+        const auto neighbor = sti::coordinates<int> { cell.x + dx[i], cell.y + dy[i] };
+        if (!obstacles.contains(neighbor)) continue;
 
-        // If the neighbor is walkable or is the goal, add it to the return
-        // vector
-        const auto is_walkable = obstacles.at(static_cast<std::size_t>(neighbor.x))
-                                     .at(static_cast<std::size_t>(neighbor.y));
-        if (is_walkable || neighbor == goal) {
-            neighbors.push_back(neighbor);
+        // If the neighbor is walkable or is the goal, add it to the list
+        if (obstacles.walkable(neighbor) || neighbor == goal) {
+            neighbors.cells[neighbors.size++] = neighbor;
         }
     }
 
     return neighbors;
 }
 
-/// @brief Structure used in the heap queue for A*
-struct heap_element {
-    sti::coordinates<int> cell;
-    double                f_value;
-}; // struct node
-
-/// @brief Given a container queue, push element following min heap criteria
-template <typename T>
-void push_heap(T& queue, const heap_element& value)
-{
-    queue.push_back(value);
-    std::push_heap(queue.begin(), queue.end(),
-                   [](const auto& lo, const auto& ro) {
-                       return lo.f_value > ro.f_value;
-                   });
-} // void push_heap(...)
-
-/// @brief Given a container queue, pop element following min heap criteria
-template <typename T>
-auto pop_heap(T& queue)
-{
-    std::pop_heap(queue.begin(), queue.end(),
-                  [](const auto& lo, const auto& ro) {
-                      return lo.f_value > ro.f_value;
-                  });
-    const auto& value = *(queue.end() - 1);
-    queue.pop_back();
-    return value;
-} // auto pop_heap(..)
-
-/// @brief Store the generated path into the cache
-/// @param cache The cache were paths are saved, in the format 'current_cell' -> 'next_cell'
-/// @param came_from A map in the form of 'cell' -> 'previous_cell'
-/// @param goal The final cell of the path, to start the unwinging of came_from
-void save_path(
-    std::unordered_map<sti::coordinates<int>, sti::coordinates<int>>&       cache,
-    const std::unordered_map<sti::coordinates<int>, sti::coordinates<int>>& came_from,
-    const sti::coordinates<int>                                             goal)
-{
-    for (auto it = came_from.find(goal);
-         it != came_from.end();
-         it = came_from.find(it->second)) {
-        cache[it->second] = it->first;
-    }
-} // void save_path(...)
-
 /// @brief Exception thrown when no path is found between two cells
 struct no_path : public std::exception {
 
@@ -273,102 +1042,394 @@ sti::coordinates<int> sti::pathfinder::next_step(const coordinates<int>& start,
 {
     _stats->call_start();
     /// @brief Check if a given path is cached
-    /// @param paths The map of cached paths
     /// @param start_cell The starting point of the path
     /// @param goal_cell The end point of the path
-    const auto search_cache = [](const auto& paths,
-                                 const auto& start_cell,
-                                 const auto& goal_cell,
-                                 auto&       stats)
+    const auto search_cache = [this](const auto& start_cell,
+                                     const auto& goal_cell)
         -> std::optional<coordinates<int>> {
-        const auto has_goal_cell = paths.find(goal_cell);
-        if (has_goal_cell != paths.end()) {
-            const auto has_start_cell = has_goal_cell->second.find(start_cell);
-            if (has_start_cell != has_goal_cell->second.end()) {
-                stats.cache_hit();
-                return has_start_cell->second;
+        const auto has_goal_cell = _paths.find(goal_cell);
+        if (has_goal_cell != _paths.end()) {
+            auto&      table          = has_goal_cell->second;
+            const auto has_start_cell = table.directions.find(static_cast<std::uint32_t>(_obstacles->index(start_cell)));
+            if (has_start_cell != table.directions.end()) {
+                table.last_use = ++_uses;
+                ++table.uses;
+                _stats->cache_hit();
+                return start_cell + flow_directions.at(has_start_cell->second);
             }
         }
-        stats.cache_miss();
+        _stats->cache_miss();
         return {};
     }; // const auto search_cache
 
+    // If the destination has a flow field, the next cell is a single read.
+    // The fields of the persistent cache generated from A* paths can have
+    // unknown cells, in that case continue with the search
+    const auto* field = find_field(goal);
+    if (field != nullptr) {
+        const auto dir = field[_obstacles->index(start)];
+        if (dir == flow_unreachable) throw no_path { start, goal };
+        if (dir != flow_unknown) {
+            _stats->cache_hit();
+            _stats->call_end();
+            if (dir == flow_goal) return goal;
+            return start + flow_directions.at(dir);
+        }
+    }
+
     // First check if the start-goal have been previously calculated
-    const auto is_og_cached = search_cache(_paths, start, goal, *_stats);
+    const auto is_og_cached = search_cache(start, goal);
     if (is_og_cached) {
         return *is_og_cached;
     }
 
+    // With the hierarchy, cache the first segment of the abstract path
+    if (_hierarchy) {
+        auto segment = hierarchy::segment_type {};
+        if (!_hierarchy->first_segment(start, goal, segment)) throw no_path { start, goal };
+
+        auto&      table  = _paths[goal];
+        const auto before = memory::bytes(table.directions);
+        for (const auto& [cell, dir] : segment) table.directions[cell] = dir;
+        _paths_bytes += memory::bytes(table.directions) - before;
+        table.last_use = ++_uses;
+        ++table.uses;
+
+        const auto next = start + flow_directions.at(segment.front().second);
+        if (_paths_budget != 0 && _paths_bytes > _paths_budget) evict(goal);
+        _stats->call_end();
+        return next;
+    }
+
     // Otherwise, the path start -> goal doesn't exists, perform the search
-    auto open_set = std::vector<heap_element> {};
-    push_heap(open_set, { start, 0 });
-    auto came_from = std::unordered_map<sti::coordinates<int>, sti::coordinates<int>> {};
-    auto g_score   = std::unordered_map<sti::coordinates<int>, double> {};
-    g_score[start] = 0.0;
-    auto f_score   = std::unordered_map<sti::coordinates<int>, double> {};
-    f_score[start] = heuristic(start, goal);
+    using index_type = search_space::index_type;
+    auto& search     = *_search;
+    search.new_search();
+
+    const auto start_index = search.index(start);
+    const auto goal_index  = search.index(goal);
+    search.update(start_index, search_space::no_index, 0.0, heuristic(start, goal));
 
     // Search the set of nodes until is empty or the optimal path is found
-    while (!open_set.empty()) {
-        const auto& [current, h] = pop_heap(open_set);
+    auto path_end = search_space::no_index;
+    while (!search.empty()) {
+        const index_type current_index = search.pop();
+        const auto       current       = search.cell(current_index);
 
-        if (current == goal) {
-            save_path(_paths[goal], came_from, goal);
+        if (current_index == goal_index) {
+            path_end = current_index;
             break;
         }
 
-        // If the current cell is in the cache, the path from here to the goal
-        // already exists, so reutilize that
-        const auto is_cached = search_cache(_paths, start, goal, *_stats);
-        if (is_cached) {
-            save_path(_paths[goal], came_from, goal);
-            break;
+        for (const auto& neighbor : adjacents(*_obstacles, current, goal)) {
+            const auto neighbor_index   = search.index(neighbor);
+            const auto tentative_gscore = search.g_score(current_index) + distance(current, neighbor);
+
+            if (tentative_gscore < search.g_score(neighbor_index)) {
+                search.update(neighbor_index,
+                              current_index,
+                              tentative_gscore,
+                              tentative_gscore + heuristic(neighbor, goal));
+            }
+        } // for (const auto& neighbor : adjacents(*_obstacles, current, goal))
+    } // while (!search.empty())
+
+    if (path_end == search_space::no_index) throw no_path { start, goal };
+
+    // Store the generated path into the cache, in the format 'cell' -> 'direction'
+    auto&      table  = _paths[goal];
+    const auto before = memory::bytes(table.directions);
+    for (auto i = path_end; search.came_from(i) != search_space::no_index; i = search.came_from(i)) {
+        const auto from                                    = search.came_from(i);
+        table.directions[static_cast<std::uint32_t>(from)] = flow_direction(search.cell(i) - search.cell(from));
+    }
+    _paths_bytes += memory::bytes(table.directions) - before;
+    table.last_use = ++_uses;
+    ++table.uses;
+
+    const auto ret = table.directions.find(static_cast<std::uint32_t>(_obstacles->index(start)));
+    if (ret == table.directions.end()) throw no_path { start, goal };
+    const auto next = start + flow_directions.at(ret->second);
+    if (_paths_budget != 0 && _paths_bytes > _paths_budget) evict(goal);
+    _stats->call_end();
+    return next;
+
+} // sti::coordinates<int> sti::pathfinder::next_step(...)
+
+/// @brief Get the next point of several paths at once
+/// @details Equivalent to calling next_step() for each start/goal pair,
+/// but the flow field of consecutive requests with the same goal is only
+/// looked up once
+/// @throws no_path If there is no path between one of the pairs
+/// @param starts The initial points
+/// @param goals The destination points, one per initial point
+/// @param steps Output, the next cell of each path, resized as needed
+void sti::pathfinder::next_steps(const std::vector<coordinates<int>>& starts,
+                                 const std::vector<coordinates<int>>& goals,
+                                 std::vector<coordinates<int>>&       steps)
+{
+    steps.resize(starts.size());
+
+    const std::uint8_t* field = nullptr;
+    for (auto i = std::size_t { 0 }; i < starts.size(); ++i) {
+        const auto& start = starts[i];
+        const auto& goal  = goals[i];
+        if (i == 0 || goal != goals[i - 1]) field = find_field(goal);
+
+        // Fast path, the direction is stored in the field
+        if (field != nullptr) {
+            const auto dir = field[_obstacles->index(start)];
+            if (dir < flow_directions.size()) {
+                _stats->cache_hit();
+                steps[i] = start + flow_directions[dir];
+                continue;
+            }
+            if (dir == flow_goal) {
+                _stats->cache_hit();
+                steps[i] = goal;
+                continue;
+            }
         }
 
-        for (const auto& neighbor : adjacents(*_obstacles, current, goal)) {
+        // Unknown or unreachable cells, fall back to the regular query
+        steps[i] = next_step(start, goal);
+    }
+} // void sti::pathfinder::next_steps(...)
 
-            const auto tentative_gscore = g_score.at(current) + distance(current, neighbor);
+////////////////////////////////////////////////////////////////////////////
+// FLOW FIELDS
+////////////////////////////////////////////////////////////////////////////
 
-            const auto& has_gscore      = g_score.find(neighbor);
-            const auto  existing_gscore = has_gscore == g_score.end()
-                ? std::numeric_limits<double>::infinity()
-                : has_gscore->second;
+/// @brief Precompute the flow field of a set of destinations
+/// @details A flow field is a dense grid storing, for each cell, the
+/// direction to take in order to reach the destination. The field is
+/// generated with a single reverse BFS starting from the goal, after that
+/// next_step() is a single array read for that destination
+/// @param goals The destinations to precompute
+void sti::pathfinder::precompute(const std::vector<coordinates<int>>& goals)
+{
+    for (const auto& goal : goals) {
+        if (has_flow_field(goal)) continue;
 
-            if (tentative_gscore < existing_gscore) {
-                came_from[neighbor] = current;
-                g_score[neighbor]   = tentative_gscore;
-                f_score[neighbor]   = tentative_gscore + heuristic(neighbor, goal);
+        auto field = flow_field(_obstacles->size());
+        fill_flow_field(field.data(), goal);
+        _flow_fields[goal] = std::move(field);
+    }
+} // void sti::pathfinder::precompute(...)
 
-                const auto exists = std::find_if(open_set.begin(), open_set.end(),
-                                                 [&](const auto& element) {
-                                                     return element.cell == neighbor;
-                                                 });
-                if (exists == open_set.end()) {
-                    push_heap(open_set, { neighbor, f_score.at(neighbor) });
-                }
-            } // if (tentative_gscore < existing_gscore)
-        } // for (const auto& neighbor : adjacents(*_obstacles, current, goal))
-    } // while (!open_set.empty())
+/// @brief Precompute the flow fields in memory shared by all the processes
+/// of a node
+/// @details The fields are stored in an MPI-3 shared window, allocated by
+/// one process per node. Each process of the node computes a subset of the
+/// destinations, after the call all the fields are visible to all of them.
+/// This is a collective call, all the processes must provide the same goals.
+/// @param goals The destinations to precompute
+/// @param comm The communicator containing all the processes
+void sti::pathfinder::precompute_shared(const std::vector<coordinates<int>>& goals,
+                                        boost::mpi::communicator*            comm)
+{
+    // Remove the duplicates, keeping the order, so all processes agree
+    auto unique_goals = std::vector<coordinates<int>> {};
+    for (const auto& goal : goals) {
+        if (std::find(unique_goals.begin(), unique_goals.end(), goal) == unique_goals.end()) {
+            unique_goals.push_back(goal);
+        }
+    }
 
-    // Down here the element should be in the cache, find it and return it
-    try {
-        const auto ret = _paths.at(goal).at(start);
-        _stats->call_end();
-        return ret;
-    } catch (const std::out_of_range& /*unused*/) {
-        throw no_path { start, goal };
+    _shared = std::make_unique<shared_fields>(static_cast<MPI_Comm>(*comm),
+                                              unique_goals.size() * _obstacles->size());
+
+    const auto node_rank = _shared->node_rank();
+    const auto node_size = _shared->node_size();
+
+    _shared->fence();
+    for (auto i = std::size_t { 0 }; i < unique_goals.size(); ++i) {
+        auto* field = _shared->data() + i * _obstacles->size();
+        if (i % static_cast<std::size_t>(node_size) == static_cast<std::size_t>(node_rank)) {
+            fill_flow_field(field, unique_goals[i]);
+        }
+        _shared->fields[unique_goals[i]] = field;
     }
+    _shared->fence();
+} // void sti::pathfinder::precompute_shared(...)
 
-} // sti::coordinates<int> sti::pathfinder::next_step(...)
+/// @brief Generate the flow field of a destination with a reverse BFS
+/// @param field Pointer to the field, with space for all the cells
+/// @param goal The destination
+void sti::pathfinder::fill_flow_field(std::uint8_t* field, const coordinates<int>& goal) const
+{
+    std::fill(field, field + _obstacles->size(), flow_unreachable);
+    field[_obstacles->index(goal)] = flow_goal;
+
+    // The BFS only expands from walkable cells (and the goal), matching
+    // the rules of adjacents(). Non-walkable cells still get a direction,
+    // an agent standing on them (i.e. sitting in a chair) can leave
+    auto frontier = std::deque<coordinates<int>> { goal };
+    while (!frontier.empty()) {
+        const auto current = frontier.front();
+        frontier.pop_front();
+
+        for (const auto& diff : flow_directions) {
+            const auto neighbor = current + diff;
+            if (!_obstacles->contains(neighbor)) continue;
+
+            auto& value = field[_obstacles->index(neighbor)];
+            if (value != flow_unreachable) continue;
+
+            // The neighbor must move in the opposite direction to get here
+            value = flow_direction(current - neighbor);
+
+            if (_obstacles->walkable(neighbor)) frontier.push_back(neighbor);
+        }
+    }
+} // void sti::pathfinder::fill_flow_field(...)
+
+/// @brief Find the field of a destination: precomputed, shared or mapped
+/// @param goal The destination
+/// @return A pointer to the field, or nullptr if there is none
+const std::uint8_t* sti::pathfinder::find_field(const coordinates<int>& goal) const
+{
+    const auto own = _flow_fields.find(goal);
+    if (own != _flow_fields.end()) return own->second.data();
+
+    if (_shared) {
+        const auto shared = _shared->fields.find(goal);
+        if (shared != _shared->fields.end()) return shared->second;
+    }
+
+    if (_cache) {
+        const auto* mapped = _cache->find(goal);
+        if (mapped != nullptr) return mapped->data;
+    }
+    return nullptr;
+}
+
+/// @brief Check if a destination has a precomputed flow field
+/// @param goal The destination
+/// @return True if the field exists
+bool sti::pathfinder::has_flow_field(const coordinates<int>& goal) const
+{
+    if (_flow_fields.find(goal) != _flow_fields.end()) return true;
+    if (_shared && _shared->fields.find(goal) != _shared->fields.end()) return true;
+
+    if (_cache) {
+        const auto* mapped = _cache->find(goal);
+        return mapped != nullptr && mapped->complete;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// PERSISTENT CACHE
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Use a persistent cache file
+/// @details If the file exists and was generated with the same plan, it is
+/// mapped into memory and used to resolve next_step(). The cache, including
+/// the newly discovered paths, is written back to the file in save()
+/// @param filepath The path to the cache file
+void sti::pathfinder::use_cache_file(const std::string& filepath)
+{
+    _cache = std::make_unique<cache_file>(filepath, *_obstacles);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the paths discovered so far
+/// @details The flow fields are not written, they are precomputed again
+/// in the restarted run from the properties
+/// @param ar The archive of the checkpoint
+void sti::pathfinder::save_state(oarchive& ar) const
+{
+    ar << _paths;
+}
+
+/// @brief Add the paths discovered before the checkpoint
+/// @param ar The archive of the checkpoint
+void sti::pathfinder::load_state(iarchive& ar)
+{
+    auto paths = decltype(_paths) {};
+    ar >> paths;
+    for (auto& [destination, table] : paths) {
+        auto& known = _paths[destination];
+        _paths_bytes -= memory::bytes(known.directions);
+        known.directions.insert(table.directions.begin(), table.directions.end());
+        known.last_use = std::max(known.last_use, table.last_use);
+        known.uses += table.uses;
+        _paths_bytes += memory::bytes(known.directions);
+        _uses = std::max(_uses, known.last_use);
+    }
+}
+
+/// @brief Evict paths until they fit in the budget
+/// @param keep The destination of the path just stored, never evicted
+void sti::pathfinder::evict(const coordinates<int>& keep)
+{
+    // There are few destinations, the victim is found with a linear scan
+    const auto first = [this](const path_table& a, const path_table& b) {
+        if (_eviction == EVICTION::FREQUENCY && a.uses != b.uses) return a.uses < b.uses;
+        return a.last_use < b.last_use;
+    };
+
+    while (_paths_bytes > _paths_budget && _paths.size() > 1) {
+        auto victim = _paths.end();
+        for (auto it = _paths.begin(); it != _paths.end(); ++it) {
+            if (it->first == keep) continue;
+            if (victim == _paths.end() || first(it->second, victim->second)) victim = it;
+        }
+        _paths_bytes -= memory::bytes(victim->second.directions);
+        _paths.erase(victim);
+        _stats->cache_eviction();
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////
 // SAVE STATISTICS
 ////////////////////////////////////////////////////////////////////////////
 
-/// @brief Save the stadistics/metrics to a file
-/// @param filepath The path to the folder where
-/// @param rank The rank of the process
-void sti::pathfinder::save(const std::string& folderpath, int rank) const
+/// @brief Save the stadistics/metrics to the result files
+/// @details If a persistent cache file is in use, it is also updated
+/// @param output The result files
+void sti::pathfinder::save(output_files& output) const
+{
+    _stats->save(output);
+
+    if (!_cache) return;
+
+    // Merge all the known paths: the mapped fields, the precomputed fields
+    // and the A* cache, converted to (possibly incomplete) fields
+    auto fields = std::map<destination_type, flow_field> {};
+    for (const auto& [goal, mapped] : _cache->fields()) {
+        fields[goal] = flow_field(mapped.data, mapped.data + _obstacles->size());
+    }
+    if (_shared) {
+        for (const auto& [goal, field] : _shared->fields) {
+            fields[goal] = flow_field(field, field + _obstacles->size());
+        }
+    }
+    for (const auto& [goal, field] : _flow_fields) {
+        fields[goal] = field;
+    }
+    for (const auto& [goal, paths] : _paths) {
+        if (has_flow_field(goal)) continue;
+
+        auto& field = fields[goal];
+        if (field.empty()) {
+            field                          = flow_field(_obstacles->size(), flow_unknown);
+            field[_obstacles->index(goal)] = flow_goal;
+        }
+        for (const auto& [from, direction] : paths.directions) field[from] = direction;
+    }
+
+    cache_file::write(_cache->filepath(), output.rank(), *_obstacles, fields);
+}
+
+/// @brief Get the heap bytes of the paths and the flow fields of this process
+/// @details The shared and mapped fields are not counted
+std::size_t sti::pathfinder::memory_bytes() const
 {
-    _stats->save(folderpath, rank);
+    return memory::bytes(_paths) + _paths_bytes + memory::bytes(_flow_fields)
+        + (_hierarchy ? _hierarchy->memory_bytes() : 0);
 }
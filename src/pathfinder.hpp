@@ -2,30 +2,58 @@
 /// @brief The path finder that generates the paths for the patients
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "checkpoint.hpp"
 #include "coordinates.hpp"
+#include "instrumentation.hpp"
+#include "plan_grid.hpp"
 
 // Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
 namespace sti {
 class clock;
 class datetime;
+class output_files;
 } // namespace sti
 
 namespace sti {
 
 /// @brief Generate and provide paths to the patients
-class pathfinder {
+class pathfinder : public checkpoint_participant {
 
 public:
-    using obstacles_map = std::vector<std::vector<bool>>;
+    using obstacles_map = plan_grid;
+
+    /// @brief The destinations evicted first from a bounded path cache
+    enum class EVICTION { LRU,
+                          FREQUENCY };
 
     /// @brief Collect pathfinding statistics
     class statistics;
 
+    /// @brief Scratch memory for the searches
+    class search_space;
+
+    /// @brief Persistent, memory mapped, path cache
+    class cache_file;
+
+    /// @brief Flow fields in node-level shared memory
+    class shared_fields;
+
+    /// @brief Cluster abstraction of the grid, for hierarchical searches
+    class hierarchy;
+
     /// @brief Construct a pathfinder
     /// @param obstacles The map with the obstacles
     /// @param clock The simulation clock, for statistics collection
@@ -40,6 +68,30 @@ public:
     /// @brief Destruct defined later due to fw. declaration of statistics
     ~pathfinder();
 
+    /// @brief Collect the cache hits and the time spent, saved in save()
+    /// @param now The timestamp source
+    void collect_statistics(instrumentation::clock_function now);
+
+    /// @brief Bound the memory of the paths found with A*
+    /// @details When a new path takes the paths over the budget, the paths
+    /// to other destinations are evicted, the least recently used ones or the
+    /// least used ones, until they fit again. An evicted path is searched
+    /// again the next time it's needed
+    /// @param budget The bytes of the cached paths, 0 for no bound
+    /// @param eviction The destinations evicted first
+    void bound_cache(std::size_t budget, EVICTION eviction);
+
+    /// @brief Search the paths not in the cache with HPA* instead of A*
+    /// @details The grid is split in square clusters, linked by portals at
+    /// the entrances between them, and the distances between the portals of
+    /// each cluster are computed once. A miss searches the graph of portals
+    /// and refines only its first segment inside the cluster of the start,
+    /// which is cached as the A* paths. The time of a miss and the memory of
+    /// the searches grow with the clusters instead of the cells, at the cost
+    /// of paths slightly longer than the optimal ones
+    /// @param cluster_size The cells of each side of the clusters
+    void use_hierarchy(int cluster_size);
+
     ////////////////////////////////////////////////////////////////////////////
     // BEHAVIOUR
     ////////////////////////////////////////////////////////////////////////////
@@ -52,24 +104,132 @@ public:
     coordinates<int> next_step(const coordinates<int>& start,
                                const coordinates<int>& goal);
 
+    /// @brief Get the next point of several paths at once
+    /// @details Equivalent to calling next_step() for each start/goal pair,
+    /// but the flow field of consecutive requests with the same goal is only
+    /// looked up once
+    /// @throws no_path If there is no path between one of the pairs
+    /// @param starts The initial points
+    /// @param goals The destination points, one per initial point
+    /// @param steps Output, the next cell of each path, resized as needed
+    void next_steps(const std::vector<coordinates<int>>& starts,
+                    const std::vector<coordinates<int>>& goals,
+                    std::vector<coordinates<int>>&       steps);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // FLOW FIELDS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Precompute the flow field of a set of destinations
+    /// @details A flow field is a dense grid storing, for each cell, the
+    /// direction to take in order to reach the destination. The field is
+    /// generated with a single reverse BFS starting from the goal, after that
+    /// next_step() is a single array read for that destination
+    /// @param goals The destinations to precompute
+    void precompute(const std::vector<coordinates<int>>& goals);
+
+    /// @brief Precompute the flow fields in memory shared by all the processes
+    /// of a node
+    /// @details The fields are stored in an MPI-3 shared window, allocated by
+    /// one process per node. Each process of the node computes a subset of the
+    /// destinations, after the call all the fields are visible to all of them.
+    /// This is a collective call, all the processes must provide the same goals.
+    /// @param goals The destinations to precompute
+    /// @param comm The communicator containing all the processes
+    void precompute_shared(const std::vector<coordinates<int>>& goals,
+                           boost::mpi::communicator*            comm);
+
+    /// @brief Check if a destination has a precomputed flow field
+    /// @param goal The destination
+    /// @return True if the field exists
+    bool has_flow_field(const coordinates<int>& goal) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PERSISTENT CACHE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Use a persistent cache file
+    /// @details If the file exists and was generated with the same plan, it is
+    /// mapped into memory and used to resolve next_step(). The cache, including
+    /// the newly discovered paths, is written back to the file in save()
+    /// @param filepath The path to the cache file
+    void use_cache_file(const std::string& filepath);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the paths discovered so far
+    /// @details The flow fields are not written, they are precomputed again
+    /// in the restarted run from the properties
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Add the paths discovered before the checkpoint
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
     ////////////////////////////////////////////////////////////////////////////
     // SAVE STATISTICS
     ////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Save the stadistics/metrics to a file
-    /// @param filepath The path to the folder where
-    /// @param rank The rank of the process
-    void save(const std::string& folderpath, int rank) const;
+    /// @brief Save the stadistics/metrics to the result files
+    /// @details If a persistent cache file is in use, it is also updated
+    /// @param output The result files
+    void save(output_files& output) const;
+
+    /// @brief Get the heap bytes of the paths and the flow fields of this process
+    /// @details The shared and mapped fields are not counted
+    std::size_t memory_bytes() const;
 
 private:
+    /// @brief Generate the flow field of a destination with a reverse BFS
+    /// @param field Pointer to the field, with space for all the cells
+    /// @param goal The destination
+    void fill_flow_field(std::uint8_t* field, const coordinates<int>& goal) const;
+
+    /// @brief Find the field of a destination: precomputed, shared or mapped
+    /// @param goal The destination
+    /// @return A pointer to the field, or nullptr if there is none
+    const std::uint8_t* find_field(const coordinates<int>& goal) const;
+
+    /// @brief The paths found with A* to a destination
+    struct path_table {
+        std::unordered_map<std::uint32_t, std::uint8_t> directions; // By cell index, as the flow fields
+        std::uint64_t                                   last_use {};
+        std::uint64_t                                   uses {};
+
+        template <typename Archive>
+        void serialize(Archive& ar, const unsigned int /*unused*/)
+        {
+            ar& directions;
+            ar& last_use;
+            ar& uses;
+        }
+    };
+
+    /// @brief Evict paths until they fit in the budget
+    /// @param keep The destination of the path just stored, never evicted
+    void evict(const coordinates<int>& keep);
+
     const obstacles_map* _obstacles;
 
     using destination_type = coordinates<int>;
-    using from_type        = coordinates<int>;
-    using next_step_type   = coordinates<int>;
-    std::unordered_map<destination_type, std::unordered_map<from_type, next_step_type>> _paths;
-
-    std::unique_ptr<statistics> _stats;
+    std::unordered_map<destination_type, path_table> _paths;
+    std::size_t                                      _paths_bytes {};  // Of the directions
+    std::size_t                                      _paths_budget {}; // 0 if unbounded
+    EVICTION                                         _eviction {};
+    std::uint64_t                                    _uses {}; // Orders the uses of the paths
+
+    /// @brief Direction grid, indexed as the obstacles grid
+    using flow_field = std::vector<std::uint8_t>;
+    std::unordered_map<destination_type, flow_field> _flow_fields;
+
+    std::unique_ptr<shared_fields> _shared;
+    std::unique_ptr<cache_file>    _cache;
+    std::unique_ptr<search_space>  _search;
+    std::unique_ptr<hierarchy>     _hierarchy;
+    std::unique_ptr<statistics>    _stats;
 }; // class pathfinder
 
 } // namespace sti
\ No newline at end of file
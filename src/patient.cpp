@@ -2,9 +2,9 @@
 
 #include <boost/variant/detail/apply_visitor_delayed.hpp>
 #include <repast_hpc/Point.h>
-#include <boost/mpi/packed_iarchive.hpp>
-#include <boost/mpi/packed_oarchive.hpp>
 
+#include "act_phase.hpp"
+#include "agent_wire.hpp"
 #include "chair_manager.hpp"
 #include "clock.hpp"
 #include "hospital_plan.hpp"
@@ -12,6 +12,7 @@
 #include "reception.hpp"
 #include "space_wrapper.hpp"
 #include "triage.hpp"
+#include "wake_queue.hpp"
 
 ////////////////////////////////////////////////////////////////////////////
 // CONSTRUCTION
@@ -51,28 +52,37 @@ sti::patient_agent::~patient_agent() = default;
 // SERIALIZATION
 ////////////////////////////////////////////////////////////////////////////
 
-/// @brief Serialize the agent state into a string using Boost.Serialization
-/// @return A string with the serialized data
-void sti::patient_agent::serialize(serial_data& data, boost::mpi::communicator* communicator)
+/// @brief Store the agent state in the fixed layout format
+/// @param wire The destination, sent as is to other processes
+void sti::patient_agent::pack(agent_wire& wire) const
 {
-    // Used to make sure the stream is flushed
-    auto pa = boost::mpi::packed_oarchive { *communicator, data };
-    pa << (*this);
+    wire.behaviour.entry_time = _entry_time.seconds_since_epoch();
+    _infection_logic.pack(wire.infection);
+    _fsm.pack(wire.behaviour.fsm);
 }
 
-/// @brief Reconstruct the agent state from a string using Boost.Serialization
-/// @param data The serialized data
-void sti::patient_agent::serialize(const id_t&               id,
-                                   serial_data&              data,
-                                   boost::mpi::communicator* communicator)
+/// @brief Restore the agent state from the fixed layout format
+/// @param id The new AgentId
+/// @param wire The source
+/// @param sections The sections of the wire to restore, see wire_section
+void sti::patient_agent::unpack(const id_t& id, const agent_wire& wire, std::uint8_t sections)
 {
     contagious_agent::id(id);
-    { // Used to make sure the stream is flushed
-        auto ia = boost::mpi::packed_iarchive { *communicator, data };
-        ia >> (*this);
+    if ((sections & wire_section::INFECTION) != 0) {
+        _infection_logic.unpack(wire.infection);
+    }
+    if ((sections & wire_section::BEHAVIOUR) != 0) {
+        _entry_time = datetime { wire.behaviour.entry_time };
+        _fsm.unpack(wire.behaviour.fsm);
     }
 }
 
+/// @brief Get the version of each part of the agent state
+sti::contagious_agent::state_versions sti::patient_agent::versions() const
+{
+    return { _infection_logic.version(), _fsm.version() };
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // BAHAVIOUR
 ////////////////////////////////////////////////////////////////////////////
@@ -94,8 +104,8 @@ boost::json::object sti::patient_agent::stats() const
         { "type", "patient" },
         { "entry_time", _entry_time.seconds_since_epoch() },
         { "infection", _infection_logic.stats() },
-        { "last_state", _fsm.last_state },
-        { "diagnosis", boost::apply_visitor([](const auto& v) { return v.stats(); }, _fsm.diagnosis) }
+        { "last_state", _fsm.last_state_name() },
+        { "diagnosis", boost::apply_visitor([&](const auto& v) { return v.stats(*_flyweight->triage); }, _fsm.diagnosis) }
     };
 }
 
@@ -127,9 +137,29 @@ sti::patient_fsm::STATE sti::patient_agent::current_state() const
     return _fsm.current_state;
 }
 
+/// @brief Get the diagnosis of the triage
+/// @return The diagnosis, default constructed before the triage
+const sti::triage::triage_diagnosis& sti::patient_agent::diagnosis() const
+{
+    return _fsm.diagnosis;
+}
+
 /// @brief Execute the patient logic, both infection and behaviour
 void sti::patient_agent::act()
 {
     _infection_logic.tick();
     _fsm.tick();
+
+    // If the next transition only depends on time, park the patient until
+    // then. The attention time is only known after the FSM actions are
+    // committed, but the state is already updated
+    if (_flyweight->timers != nullptr && _fsm.wake_time()) {
+        act_phase::commit([this] {
+            const auto wake = _fsm.wake_time();
+            if (wake) {
+                parked(true);
+                _flyweight->timers->park(getId(), *wake);
+            }
+        });
+    }
 }
\ No newline at end of file
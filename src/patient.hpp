@@ -16,6 +16,7 @@
 #include "coordinates.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
 #include "infection_logic/infection_factory.hpp"
+#include "object_pool.hpp"
 #include "patient_fsm.hpp"
 
 // Fw. declarations
@@ -29,6 +30,7 @@ class hospital_plan;
 class infection_factory;
 class clock;
 class icu;
+class wake_queue;
 } // namespace sti
 
 namespace sti {
@@ -47,11 +49,11 @@ struct patient_flyweight {
     const double                             walk_speed {};
     sti::timedelta                           reception_time;
     sti::timedelta                           triage_duration;
-    patient_fsm::flyweight                   fsm {};
+    sti::wake_queue*                         timers {};
 };
 
 /// @brief An agent representing a patient
-class patient_agent final : public contagious_agent {
+class patient_agent final : public contagious_agent, public pooled<patient_agent> {
 
 public:
     ////////////////////////////////////////////////////////////////////////////
@@ -95,18 +97,18 @@ public:
     // SERIALIZATION
     ////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Serialize the agent state into a string using Boost.Serialization
-    /// @param communicator The MPI communicator over which this archive will be sent
-    /// @return A string with the serialized data
-    void serialize(serial_data& data, boost::mpi::communicator* communicator) override;
+    /// @brief Store the agent state in the fixed layout format
+    /// @param wire The destination, sent as is to other processes
+    void pack(agent_wire& wire) const override;
 
-    /// @brief Reconstruct the agent state from a string using Boost.Serialization
+    /// @brief Restore the agent state from the fixed layout format
     /// @param id The new AgentId
-    /// @param data The serialized data
-    /// @param communicator The MPI communicator over which the archive was sent
-    void serialize(const id_t&               id,
-                   serial_data&              data,
-                   boost::mpi::communicator* communicator) override;
+    /// @param wire The source
+    /// @param sections The sections of the wire to restore, see wire_section
+    void unpack(const id_t& id, const agent_wire& wire, std::uint8_t sections) override;
+
+    /// @brief Get the version of each part of the agent state
+    state_versions versions() const override;
 
     ////////////////////////////////////////////////////////////////////////////
     // BAHAVIOUR
@@ -136,21 +138,15 @@ public:
     /// @return The current state of the patient FSM
     patient_fsm::STATE current_state() const;
 
+    /// @brief Get the diagnosis of the triage
+    /// @return The diagnosis, default constructed before the triage
+    const triage::triage_diagnosis& diagnosis() const;
+
     /// @brief Execute the patient logic, both infection and behaviour
     void act() final;
 
 private:
     friend struct patient_fsm;
-    friend class boost::serialization::access;
-
-    // Private serialization, for security
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int /*unused*/)
-    {
-        ar& _entry_time;
-        ar& _infection_logic;
-        ar& _fsm;
-    } // serialize(...)
 
     flyweight_ptr         _flyweight;
     datetime              _entry_time;
@@ -159,6 +155,3 @@ private:
 }; // patient_agent
 
 } // namespace sti
-
-BOOST_CLASS_IMPLEMENTATION(sti::patient_agent, boost::serialization::object_serializable);
-BOOST_CLASS_TRACKING(sti::patient_agent, boost::serialization::track_never)
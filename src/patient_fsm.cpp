@@ -1,9 +1,14 @@
 #include "patient_fsm.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <repast_hpc/AgentId.h>
+#include <utility>
 #include <variant>
 
+#include "act_phase.hpp"
+#include "agent_wire.hpp"
 #include "chair_manager.hpp"
 #include "clock.hpp"
 #include "coordinates.hpp"
@@ -83,499 +88,596 @@ std::string state_2_string(sti::patient_fsm::STATE state)
     }
 }
 
-sti::patient_fsm::transition_table create_transition_table()
-{
-    auto table  = sti::patient_fsm::transition_table {};
-    using fsm   = sti::patient_fsm;
-    using STATE = sti::patient_fsm::STATE;
+using fsm   = sti::patient_fsm;
+using STATE = sti::patient_fsm::STATE;
 
-    ////////////////////////////////////////////////////////////////////////////
-    // AUXILIARY FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// AUXILIARY FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto always_true = [](fsm& /*unused*/) { return true; };
-    auto empty       = [](fsm& /*unused*/) {};
+bool always_true(fsm& /*unused*/)
+{
+    return true;
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // CHAIR FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+void empty(fsm& /*unused*/)
+{
+}
 
-    auto request_chair = [](fsm& m) {
-        m.patient_flyweight_->chairs->request_chair(m.patient->getId());
-    };
+////////////////////////////////////////////////////////////////////////////////
+// CHAIR FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto got_chair = [](fsm& m) {
-        auto response_peek = m.patient_flyweight_->chairs->peek_response(m.patient->getId());
-        if (response_peek.is_initialized()) {
-            if (response_peek->chair_location.is_initialized()) {
-                return true;
-            }
+void request_chair(fsm& m)
+{
+    m.patient_flyweight_->chairs->request_chair(m.patient->getId(), m.patient->get_infection_logic()->subject());
+}
+
+bool got_chair(fsm& m)
+{
+    auto response_peek = m.patient_flyweight_->chairs->peek_response(m.patient->getId());
+    if (response_peek.is_initialized()) {
+        if (response_peek->chair_location.is_initialized()) {
+            return true;
         }
-        return false;
-    };
+    }
+    return false;
+}
 
-    auto set_destination_chair = [](fsm& m) {
-        auto response = m.patient_flyweight_->chairs->get_response(m.patient->getId());
-        m.destination = response->chair_location.get();
-    };
+void set_destination_chair(fsm& m)
+{
+    auto response = m.patient_flyweight_->chairs->get_response(m.patient->getId());
+    m.destination = response->chair_location.get();
+}
 
-    auto no_chair_available = [](fsm& m) {
-        auto response = m.patient_flyweight_->chairs->peek_response(m.patient->getId());
-        if (response.is_initialized()) {
-            if (!response->chair_location.is_initialized()) {
-                // Remove the response from the queue
+bool no_chair_available(fsm& m)
+{
+    auto response = m.patient_flyweight_->chairs->peek_response(m.patient->getId());
+    if (response.is_initialized()) {
+        if (!response->chair_location.is_initialized()) {
+            // Remove the response from the queue
+            sti::act_phase::commit([&m] {
                 m.patient_flyweight_->chairs->get_response(m.patient->getId());
-                return true;
-            }
+            });
+            return true;
         }
-        return false;
-    };
+    }
+    return false;
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // TIME WAIT FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// TIME WAIT FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto time_elapsed = [](fsm& m) {
-        return m.attention_end < m.patient_flyweight_->clk->now();
-    };
+bool time_elapsed(fsm& m)
+{
+    return m.attention_end < m.patient_flyweight_->clk->now();
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // WALK AND MOVEMENT FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// WALK AND MOVEMENT FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto arrived = [](fsm& m) {
-        const auto patient_location = sti::coordinates<double> {
-            m.patient_flyweight_->space->get_continuous_location(m.patient->getId())
-        };
-        return m.destination == patient_location;
+bool arrived(fsm& m)
+{
+    const auto patient_location = sti::coordinates<double> {
+        m.patient_flyweight_->space->get_continuous_location(m.patient->getId())
     };
+    return m.destination == patient_location;
+}
 
-    auto not_arrived = [](fsm& m) {
-        const auto patient_location = sti::coordinates<double> {
-            m.patient_flyweight_->space->get_continuous_location(m.patient->getId())
-        };
-        return m.destination != patient_location;
+bool not_arrived(fsm& m)
+{
+    const auto patient_location = sti::coordinates<double> {
+        m.patient_flyweight_->space->get_continuous_location(m.patient->getId())
     };
+    return m.destination != patient_location;
+}
 
-    auto walk = [](fsm& m) {
-        auto movement_left    = m.patient_flyweight_->walk_speed * m.patient_flyweight_->clk->seconds_per_tick();
-        auto current_location = m.patient_flyweight_->space->get_continuous_location(m.patient->getId());
-
-        while (movement_left > 0.0 && current_location != m.destination) {
-            const auto next_cell         = m.patient_flyweight_->hospital->get_pathfinder()->next_step(current_location.discrete(),
-                                                                                              m.destination.discrete());
-            const auto new_location      = m.patient_flyweight_->space->move_towards(m.patient->getId(),
-                                                                               next_cell.continuous(),
-                                                                               movement_left);
-            const auto distance_traveled = sti::sq_distance(new_location, current_location);
-            current_location             = new_location;
-            movement_left -= distance_traveled;
-        }
-    };
+// The movement is deferred to the walk stage of the model, where all the
+// walking patients are moved in a single batch
+void walk(fsm& m)
+{
+    m.patient_flyweight_->space->enqueue_walk(m.patient->getId(),
+                                              m.destination,
+                                              m.patient_flyweight_->walk_speed * m.patient_flyweight_->clk->seconds_per_tick());
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // RECEPTION FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// RECEPTION FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto enqueue_in_reception = [](fsm& m) {
-        m.patient_flyweight_->reception->enqueue(m.patient->getId());
-    };
+void enqueue_in_reception(fsm& m)
+{
+    m.patient_flyweight_->reception->enqueue(m.patient->getId());
+}
 
-    auto reception_turn = [](fsm& m) -> bool {
-        return m.patient_flyweight_->reception->is_my_turn(m.patient->getId()).has_value();
-    };
+bool reception_turn(fsm& m)
+{
+    return m.patient_flyweight_->reception->is_my_turn(m.patient->getId()).has_value();
+}
 
-    auto set_destination_reception = [](fsm& m) {
-        m.destination = m.patient_flyweight_->reception->is_my_turn(m.patient->getId()).get();
-    };
+void set_destination_reception(fsm& m)
+{
+    m.destination = m.patient_flyweight_->reception->is_my_turn(m.patient->getId()).get();
+}
 
-    auto set_reception_time = [](fsm& m) {
-        m.attention_end = m.patient_flyweight_->clk->now() + m.patient_flyweight_->reception_time;
-    };
+void set_reception_time(fsm& m)
+{
+    m.attention_end = m.patient_flyweight_->clk->now() + m.patient_flyweight_->reception_time;
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // TRIAGE FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// TRIAGE FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto enqueue_in_triage = [](fsm& m) {
-        m.patient_flyweight_->triage->enqueue(m.patient->getId());
-    };
+void enqueue_in_triage(fsm& m)
+{
+    m.patient_flyweight_->triage->enqueue(m.patient->getId());
+}
 
-    auto triage_turn = [](fsm& m) -> bool {
-        return m.patient_flyweight_->triage->is_my_turn(m.patient->getId()).has_value();
-    };
+bool triage_turn(fsm& m)
+{
+    return m.patient_flyweight_->triage->is_my_turn(m.patient->getId()).has_value();
+}
 
-    auto set_destination_triage = [](fsm& m) {
-        m.destination = m.patient_flyweight_->triage->is_my_turn(m.patient->getId()).get();
-    };
+void set_destination_triage(fsm& m)
+{
+    m.destination = m.patient_flyweight_->triage->is_my_turn(m.patient->getId()).get();
+}
 
-    auto set_triage_time = [](fsm& m) {
-        m.attention_end = m.patient_flyweight_->clk->now() + m.patient_flyweight_->triage_duration;
-    };
+void set_triage_time(fsm& m)
+{
+    m.attention_end = m.patient_flyweight_->clk->now() + m.patient_flyweight_->triage_duration;
+}
 
-    auto get_diagnosis = [](fsm& m) {
-        m.diagnosis = m.patient_flyweight_->triage->diagnose();
-    };
+void get_diagnosis(fsm& m)
+{
+    m.diagnosis = m.patient_flyweight_->triage->diagnose(m.patient->get_infection_logic()->subject());
+}
 
-    auto to_doctor = [](fsm& m) {
-        return sti::triage::holds_doctor_diagnosis(m.diagnosis);
-    };
+bool to_doctor(fsm& m)
+{
+    return sti::triage::holds_doctor_diagnosis(m.diagnosis);
+}
 
-    auto to_icu = [](fsm& m) {
-        return sti::triage::holds_icu_diagnosis(m.diagnosis);
-    };
+bool to_icu(fsm& m)
+{
+    return sti::triage::holds_icu_diagnosis(m.diagnosis);
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // DOCTOR FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
-
-    auto enqueue_in_doctor = [](fsm& m) {
-        using doc_diagnosis              = sti::triage::doctor_diagnosis;
-        const auto& doctor_assigned      = boost::get<doc_diagnosis>(m.diagnosis).doctor_assigned;
-        const auto& attention_time_limit = boost::get<doc_diagnosis>(m.diagnosis).attention_time_limit;
-        m.patient_flyweight_->doctors->queues()->enqueue(doctor_assigned,
-                                                        m.patient->getId(),
-                                                        attention_time_limit);
-    };
+////////////////////////////////////////////////////////////////////////////////
+// DOCTOR FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto doctor_turn = [](fsm& m) {
-        const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
-        const auto  response        = m.patient_flyweight_->doctors->queues()->is_my_turn(doctor_assigned,
-                                                                                 m.patient->getId());
-        return response.is_initialized();
-    };
+void enqueue_in_doctor(fsm& m)
+{
+    using doc_diagnosis              = sti::triage::doctor_diagnosis;
+    const auto& doctor_assigned      = boost::get<doc_diagnosis>(m.diagnosis).doctor_assigned;
+    const auto& attention_time_limit = boost::get<doc_diagnosis>(m.diagnosis).attention_time_limit;
+    m.patient_flyweight_->doctors->queues()->enqueue(doctor_assigned,
+                                                    m.patient->getId(),
+                                                    attention_time_limit);
+}
 
-    auto set_doctor_destination = [](fsm& m) {
-        const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
-        const auto  response        = m.patient_flyweight_->doctors->queues()->is_my_turn(doctor_assigned,
-                                                                                 m.patient->getId());
-        m.destination               = response.get();
-    };
+bool doctor_turn(fsm& m)
+{
+    const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
+    const auto  response        = m.patient_flyweight_->doctors->queues()->is_my_turn(doctor_assigned,
+                                                                             m.patient->getId());
+    return response.is_initialized();
+}
 
-    auto doctor_timeout = [](fsm& m) {
-        return boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).attention_time_limit < m.patient_flyweight_->clk->now();
-    };
+void set_doctor_destination(fsm& m)
+{
+    const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
+    const auto  response        = m.patient_flyweight_->doctors->queues()->is_my_turn(doctor_assigned,
+                                                                             m.patient->getId());
+    m.destination               = response.get();
+}
 
-    auto set_doctor_time = [](fsm& m) {
-        const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
-        m.attention_end             = m.patient_flyweight_->clk->now() + m.patient_flyweight_->doctors->get_attention_duration(doctor_assigned);
-    };
+bool doctor_timeout(fsm& m)
+{
+    return boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).attention_time_limit < m.patient_flyweight_->clk->now();
+}
 
-    ////////////////////////////////////////////////////////////////////////////
-    // ICU FUNCTIONS
-    ////////////////////////////////////////////////////////////////////////////
+void set_doctor_time(fsm& m)
+{
+    const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
+    m.attention_end             = m.patient_flyweight_->clk->now() + m.patient_flyweight_->doctors->get_attention_duration(doctor_assigned);
+}
 
-    auto request_icu = [](fsm& m) {
-        m.patient_flyweight_->icu->admission().request_bed(m.patient->getId());
-    };
+////////////////////////////////////////////////////////////////////////////////
+// ICU FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    auto icu_available = [](fsm& m) {
-        // First "peek" the response without removing it. Only remove the
-        // response from the pool if the response is affirmative. If a negative
-        // response is removed, the "icu_full" guard will never find the response
-        const auto peek_response = m.patient_flyweight_->icu->admission().peek_response(m.patient->getId());
+void request_icu(fsm& m)
+{
+    m.patient_flyweight_->icu->admission().request_bed(m.patient->getId());
+}
 
-        if (peek_response.is_initialized()) {
-            if (peek_response.get()) {
+bool icu_available(fsm& m)
+{
+    // First "peek" the response without removing it. Only remove the
+    // response from the pool if the response is affirmative. If a negative
+    // response is removed, the "icu_full" guard will never find the response
+    const auto peek_response = m.patient_flyweight_->icu->admission().peek_response(m.patient->getId());
+
+    if (peek_response.is_initialized()) {
+        if (peek_response.get()) {
+            sti::act_phase::commit([&m] {
                 m.patient_flyweight_->icu->admission().get_response(m.patient->getId());
-                return true;
-            }
+            });
+            return true;
         }
-        return false;
-    };
-
-    auto icu_full = [](fsm& m) {
-        // First "peek" the response without removing it. Only remove the
-        // response from the pool if the response is negative. If a positive
-        // response is removed, the "icu_available" guard will never find the
-        // response
-        const auto peek_response = m.patient_flyweight_->icu->admission().peek_response(m.patient->getId());
+    }
+    return false;
+}
 
-        if (peek_response.is_initialized()) {
-            if (!peek_response.get()) {
+bool icu_full(fsm& m)
+{
+    // First "peek" the response without removing it. Only remove the
+    // response from the pool if the response is negative. If a positive
+    // response is removed, the "icu_available" guard will never find the
+    // response
+    const auto peek_response = m.patient_flyweight_->icu->admission().peek_response(m.patient->getId());
+
+    if (peek_response.is_initialized()) {
+        if (!peek_response.get()) {
+            sti::act_phase::commit([&m] {
                 m.patient_flyweight_->icu->admission().get_response(m.patient->getId());
-                return true;
-            }
+            });
+            return true;
         }
-        return false;
-    };
-
-    auto set_icu_destination = [](fsm& m) {
-        m.destination = m.patient_flyweight_->hospital->icu().location.continuous();
-    };
-
-    auto enter_icu = [](fsm& m) {
-        m.patient_flyweight_->icu->get_real_icu()->get().insert(m.patient);
-        m.patient->get_infection_logic()->mode(sti::human_infection_cycle::MODE::COMA);
-        m.attention_end = m.patient_flyweight_->clk->now() + boost::get<sti::triage::icu_diagnosis>(m.diagnosis).sleep_time;
-    };
-
-    auto leave_icu = [](fsm& m) {
-        m.patient_flyweight_->icu->get_real_icu()->get().remove(m.patient);
-        m.patient->get_infection_logic()->mode(sti::human_infection_cycle::MODE::NORMAL);
-    };
-
-    auto alive = [](fsm& m) {
-        return boost::get<sti::triage::icu_diagnosis>(m.diagnosis).survives;
-    };
-
-    auto dead = [](fsm& m) {
-        return !boost::get<sti::triage::icu_diagnosis>(m.diagnosis).survives;
-    };
-
-    auto kill = [](fsm& m) {
-        m.last_state = state_2_string(m.current_state);
-    };
-
-    ////////////////////////////////////////////////////////////////////////////
-    // EXIT TRANSITION
-    ////////////////////////////////////////////////////////////////////////////
-
-    auto set_exit_motive_and_destination = [](fsm& m) {
-        m.destination = m.patient_flyweight_->hospital->exit().location.continuous();
-        m.last_state  = state_2_string(m.current_state);
-    };
-
-    ////////////////////////////////////////////////////////////////////////////
-    // TRANSITION TABLE
-    ////////////////////////////////////////////////////////////////////////////
-    // clang-format off
-    
-    table[STATE::ENTRY] = {
-    //    GUARD           ACTION          DESTINATION
-    //  +---------------+---------------+-----------------------+
-        { always_true   , request_chair , STATE::WAIT_CHAIR_1   },
-    };
-
-    table[STATE::WAIT_CHAIR_1] = {
-    //    GUARD                   ACTION                              DESTINATION
-    //  +-----------------------+-----------------------------------+---------------------------+
-        { no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       },
-        { got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_1    },
-    };
-
-    table[STATE::WALK_TO_CHAIR_1] = {
-    //    GUARD           ACTION                  DESTINATION
-    //  +---------------+-----------------------+-------------------------------+
-        { not_arrived   , walk                  , STATE::WALK_TO_CHAIR_1        },
-        { arrived       , enqueue_in_reception  , STATE::WAIT_RECEPTION_TURN    },
-    };
-
-    table[STATE::WAIT_RECEPTION_TURN] = {
-    //    GUARD                   ACTION                      DESTINATION
-    //  +-----------------------+---------------------------+-------------------------------+
-        { reception_turn        , set_destination_reception , STATE::WALK_TO_RECEPTION      },
-    };
-
-    table[STATE::WALK_TO_RECEPTION] = {
-    //    GUARD           ACTION                  DESTINATION
-    //  +---------------+-----------------------+-------------------------------+
-        { not_arrived   , walk                  , STATE::WALK_TO_RECEPTION      },
-        { arrived       , set_reception_time    , STATE::WAIT_IN_RECEPTION      },
-    }; 
-
-    table[STATE::WAIT_IN_RECEPTION] = {
-    //    GUARD               ACTION          DESTINATION
-    //  +-------------------+---------------+---------------------------+
-        { time_elapsed      , request_chair , STATE::WAIT_CHAIR_2       },
-    };
-
-    table[STATE::WAIT_CHAIR_2] = {
-    //    GUARD                   ACTION                              DESTINATION
-    //  +-----------------------+-----------------------------------+---------------------------+
-        { no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       },
-        { got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_2    },
-    };
-
-    table[STATE::WALK_TO_CHAIR_2] = {
-    //    GUARD           ACTION             DESTINATION
-    //  +---------------+-------------------+---------------------------+
-        { not_arrived   , walk              , STATE::WALK_TO_CHAIR_2    },
-        { arrived       , enqueue_in_triage , STATE::WAIT_TRIAGE_TURN   },
-    };
-
-    table[STATE::WAIT_TRIAGE_TURN] = {
-    //    GUARD               ACTION                      DESTINATION
-    //  +-------------------+---------------------------+---------------------------+
-        { triage_turn       , set_destination_triage    , STATE::WALK_TO_TRIAGE     },
-    };
-
-    table[STATE::WALK_TO_TRIAGE] = {
-    //    GUARD           ACTION                  DESTINATION
-    //  +---------------+-----------------------+-----------------------+
-        { not_arrived   , walk                  , STATE::WALK_TO_TRIAGE },
-        { arrived       , set_triage_time       , STATE::WAIT_IN_TRIAGE },
-    }; 
-
-    table[STATE::WAIT_IN_TRIAGE] = {
-    //    GUARD               ACTION              DESTINATION
-    //  +-------------------+-------------------+---------------------------+
-        { time_elapsed      , get_diagnosis     , STATE::DISPATCH       },
-    };
-
-    table[STATE::DISPATCH] = {
-    //    GUARD           ACTION              DESTINATION
-    //  +---------------+-------------------+-----------------------+
-        { to_doctor     , request_chair     , STATE::WAIT_CHAIR_3   },
-        { to_icu        , request_icu       , STATE::WAIT_ICU       }
-    };
-
-    table[STATE::WAIT_CHAIR_3] = {
-    //    GUARD                   ACTION                              DESTINATION
-    //  +-----------------------+-----------------------------------+---------------------------+
-        { no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       },
-        { got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_3    },
-    };
-
-    table[STATE::WALK_TO_CHAIR_3] = {
-    //    GUARD           ACTION             DESTINATION
-    //  +---------------+-------------------+---------------------------+
-        { not_arrived   , walk              , STATE::WALK_TO_CHAIR_3    },
-        { arrived       , enqueue_in_doctor , STATE::WAIT_FOR_DOCTOR    },
-    };
-
-    table[STATE::WAIT_FOR_DOCTOR] = {
-    //    GUARD               ACTION                      DESTINATION
-    //  +-------------------+---------------------------+---------------------------+
-        { doctor_turn       , set_doctor_destination    , STATE::WALK_TO_DOCTOR      },
-        { doctor_timeout    , empty                     , STATE::NO_ATTENTION        }
-    };
-
-    table[STATE::WALK_TO_DOCTOR] = {
-    //    GUARD           ACTION                  DESTINATION
-    //  +---------------+-----------------------+-----------------------+
-        { not_arrived   , walk                  , STATE::WALK_TO_DOCTOR },
-        { arrived       , set_doctor_time       , STATE::WAIT_IN_DOCTOR },
-    }; 
-
-    table[STATE::WAIT_IN_DOCTOR] = {
-    //    GUARD               ACTION                              DESTINATION
-    //  +-------------------+-----------------------------------+---------------------------+
-        { time_elapsed      , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       },
-    };
-
-    table[STATE::NO_ATTENTION] = {
-    //    GUARD           ACTION                              DESTINATION
-    //  +---------------+-----------------------------------+---------------------------+
-        { always_true   , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       },
-    };
+    }
+    return false;
+}
 
-    table[STATE::WAIT_ICU] = {
-    //    GUARD           ACTION                              DESTINATION
-    //  +---------------+-----------------------------------+-----------------------+
-        { icu_available , set_icu_destination               , STATE::WALK_TO_ICU    },
-        { icu_full      , set_exit_motive_and_destination   , STATE::WALK_TO_ICU    },
-    };
+void set_icu_destination(fsm& m)
+{
+    m.destination = m.patient_flyweight_->hospital->icu().location.continuous();
+}
 
-    table[STATE::WALK_TO_ICU] = {
-    //    GUARD           ACTION              DESTINATION
-    //  +---------------+-------------------+-----------------------+
-        { not_arrived   , walk              , STATE::WALK_TO_ICU    },
-        { arrived       , enter_icu         , STATE::SLEEP          },
-    };
+void enter_icu(fsm& m)
+{
+    m.patient_flyweight_->icu->get_real_icu()->get().insert(m.patient);
+    m.patient->get_infection_logic()->mode(sti::human_infection_cycle::MODE::COMA);
+    m.attention_end = m.patient_flyweight_->clk->now() + boost::get<sti::triage::icu_diagnosis>(m.diagnosis).sleep_time;
+}
 
-    table[STATE::SLEEP] = {
-    //    GUARD           ACTION              DESTINATION
-    //  +---------------+-------------------+-------------------+
-        { time_elapsed  , empty             , STATE::RESOLVE   },
-    };
+void leave_icu(fsm& m)
+{
+    m.patient_flyweight_->icu->get_real_icu()->get().remove(m.patient);
+    m.patient->get_infection_logic()->mode(sti::human_infection_cycle::MODE::NORMAL);
+}
 
-    table[STATE::RESOLVE] = {
-    //    GUARD           ACTION                              DESTINATION
-    //  +---------------+-----------------------------------+-----------------------+
-        { alive         , leave_icu                         , STATE::LEAVE_ICU      },
-        { dead          , empty                             , STATE::MORGUE         }
-    };
+bool alive(fsm& m)
+{
+    return boost::get<sti::triage::icu_diagnosis>(m.diagnosis).survives;
+}
 
-    table[STATE::LEAVE_ICU] = {
-    //    GUARD           ACTION                              DESTINATION
-    //  +---------------+-----------------------------------+-----------------------+
-        { always_true   , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT   }
-    };
+bool dead(fsm& m)
+{
+    return !boost::get<sti::triage::icu_diagnosis>(m.diagnosis).survives;
+}
 
-    table[STATE::MORGUE] = {
-    //    GUARD           ACTION      DESTINATION
-    //  +---------------+-----------+-----------------------+
-        { always_true   , kill     , STATE::AWAITING_DELETION   }
-    };
+void kill_patient(fsm& m)
+{
+    m.last_state = m.current_state;
+}
 
-    table[STATE::WALK_TO_EXIT] = {
-    //    GUARD           ACTION      DESTINATION
-    //  +---------------+-----------+---------------------------+
-        { not_arrived   , walk      , STATE::WALK_TO_EXIT       },
-        { arrived       , empty     , STATE::AWAITING_DELETION  },
-    };
+////////////////////////////////////////////////////////////////////////////////
+// EXIT TRANSITION
+////////////////////////////////////////////////////////////////////////////////
 
-    table[STATE::AWAITING_DELETION] = {
-        
-    };
+void set_exit_motive_and_destination(fsm& m)
+{
+    m.destination = m.patient_flyweight_->hospital->exit().location.continuous();
+    m.last_state  = m.current_state;
+}
 
-    // clang-format on
+////////////////////////////////////////////////////////////////////////////////
+// EXIT ACTIONS
+////////////////////////////////////////////////////////////////////////////////
 
-    return table;
+// Return the chairs
+void release_chair(fsm& m)
+{
+    m.patient_flyweight_->chairs->release_chair(m.destination);
 }
 
-/// @brief Set the entry action for each state
-sti::patient_fsm::entry_list create_entry_actions()
+// Release the reception
+void release_reception(fsm& m)
 {
-    // using fsm   = sti::patient_fsm;
-    // using STATE = sti::patient_fsm::STATE;
-
-    auto entries = sti::patient_fsm::entry_list {};
-
-    return entries;
+    m.patient_flyweight_->reception->dequeue(m.patient->getId());
 }
 
-/// @brief Set the exit action for each state
-sti::patient_fsm::exit_list create_exit_actions()
+// Release the triage
+void release_triage(fsm& m)
 {
-    using fsm   = sti::patient_fsm;
-    using STATE = sti::patient_fsm::STATE;
-
-    auto exits = sti::patient_fsm::exit_list {};
-
-    // Set the exit action for the corresponding states
-    auto release_chair = [](fsm& m) {
-        m.patient_flyweight_->chairs->release_chair(m.destination);
-    };
-
-    // Return the chairs
-    exits[STATE::WAIT_RECEPTION_TURN] = release_chair;
-    exits[STATE::WAIT_TRIAGE_TURN]    = release_chair;
-    exits[STATE::WAIT_FOR_DOCTOR]     = release_chair;
-
-    // Release the reception
-    exits[STATE::WAIT_IN_RECEPTION] = [](fsm& m) {
-        m.patient_flyweight_->reception->dequeue(m.patient->getId());
-    };
-
-    // Release the triage
-    exits[STATE::WAIT_IN_TRIAGE] = [](fsm& m) {
-        m.patient_flyweight_->triage->dequeue(m.patient->getId());
-    };
+    m.patient_flyweight_->triage->dequeue(m.patient->getId());
+}
 
-    // Dequeue from the doctor
-    auto dequeue_from_doctor = [](fsm& m) {
-        const auto doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
-        m.patient_flyweight_->doctors->queues()->dequeue(doctor_assigned, m.patient->getId());
-    };
+// Dequeue from the doctor
+void dequeue_from_doctor(fsm& m)
+{
+    const auto& doctor_assigned = boost::get<sti::triage::doctor_diagnosis>(m.diagnosis).doctor_assigned;
+    m.patient_flyweight_->doctors->queues()->dequeue(doctor_assigned, m.patient->getId());
+}
 
-    exits[STATE::NO_ATTENTION]   = dequeue_from_doctor;
-    exits[STATE::WAIT_IN_DOCTOR] = dequeue_from_doctor;
+////////////////////////////////////////////////////////////////////////////////
+// STATE MACHINE GENERATION
+////////////////////////////////////////////////////////////////////////////////
+
+using guard_type  = bool (*)(fsm&);
+using action_type = void (*)(fsm&);
+
+/// @brief A transition, resolved at compile time
+/// @tparam Guard The condition to take the transition
+/// @tparam Action The action executed when the transition is taken
+/// @tparam Destination The new state
+template <guard_type Guard, action_type Action, STATE Destination>
+struct transition {
+    static constexpr auto guard       = Guard;
+    static constexpr auto action      = Action;
+    static constexpr auto destination = Destination;
+};
+
+/// @brief The list of transitions of a state, checked in order
+template <typename... Transitions>
+struct transitions { };
+
+/// @brief The transition table, specialized for every state
+template <STATE S>
+struct table;
+
+/// @brief The action executed when entering a state, none by default
+template <STATE S>
+constexpr action_type entry_action = empty;
+
+/// @brief The action executed when leaving a state, none by default
+template <STATE S>
+constexpr action_type exit_action = empty;
+
+// clang-format off
+template <> constexpr action_type exit_action<STATE::WAIT_RECEPTION_TURN> = release_chair;
+template <> constexpr action_type exit_action<STATE::WAIT_TRIAGE_TURN>    = release_chair;
+template <> constexpr action_type exit_action<STATE::WAIT_FOR_DOCTOR>     = release_chair;
+template <> constexpr action_type exit_action<STATE::WAIT_IN_RECEPTION>   = release_reception;
+template <> constexpr action_type exit_action<STATE::WAIT_IN_TRIAGE>      = release_triage;
+template <> constexpr action_type exit_action<STATE::NO_ATTENTION>        = dequeue_from_doctor;
+template <> constexpr action_type exit_action<STATE::WAIT_IN_DOCTOR>      = dequeue_from_doctor;
+// clang-format on
+
+/// @brief Check a transition and take it if the guard returns true
+/// @details The exit, transition and entry actions modify the managers and
+/// the space, inside a parallel act phase they are deferred to the commit
+/// phase. The state is updated immediately anyway.
+/// @return True if the transition was taken
+template <STATE S, typename T>
+bool take(fsm& m)
+{
+    if (!T::guard(m)) return false;
+
+    sti::act_phase::commit([p = &m] {
+        // The actions might read the state they are leaving
+        p->current_state = S;
+        exit_action<S>(*p);
+        T::action(*p);
+        p->current_state = T::destination;
+        entry_action<T::destination>(*p);
+    });
+    m.current_state = T::destination;
+    ++m._version;
+    return true;
+}
 
-    return exits;
+/// @brief Take the first transition with a guard returning true, if any
+template <STATE S, typename... Ts>
+void step(fsm& m, transitions<Ts...> /*unused*/)
+{
+    static_cast<void>((take<S, Ts>(m) || ...));
 }
 
-} // namespace
+/// @brief Execute the logic of a state
+template <STATE S>
+void run(fsm& m)
+{
+    step<S>(m, table<S> {});
+}
 
-/// @brief Default construct the FSM transitions
-sti::patient_fsm::flyweight::flyweight()
-    : transitions { create_transition_table() }
-    , entries { create_entry_actions() }
-    , exits { create_exit_actions() }
+////////////////////////////////////////////////////////////////////////////////
+// TRANSITION TABLE
+////////////////////////////////////////////////////////////////////////////////
+// clang-format off
+
+template <> struct table<STATE::ENTRY> : transitions<
+//               GUARD           ACTION          DESTINATION
+//             +---------------+---------------+-----------------------+
+    transition < always_true   , request_chair , STATE::WAIT_CHAIR_1   >
+> {};
+
+template <> struct table<STATE::WAIT_CHAIR_1> : transitions<
+//               GUARD                   ACTION                              DESTINATION
+//             +-----------------------+-----------------------------------+---------------------------+
+    transition < no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       >,
+    transition < got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_1    >
+> {};
+
+template <> struct table<STATE::WALK_TO_CHAIR_1> : transitions<
+//               GUARD           ACTION                  DESTINATION
+//             +---------------+-----------------------+-------------------------------+
+    transition < not_arrived   , walk                  , STATE::WALK_TO_CHAIR_1        >,
+    transition < arrived       , enqueue_in_reception  , STATE::WAIT_RECEPTION_TURN    >
+> {};
+
+template <> struct table<STATE::WAIT_RECEPTION_TURN> : transitions<
+//               GUARD                   ACTION                      DESTINATION
+//             +-----------------------+---------------------------+-------------------------------+
+    transition < reception_turn        , set_destination_reception , STATE::WALK_TO_RECEPTION      >
+> {};
+
+template <> struct table<STATE::WALK_TO_RECEPTION> : transitions<
+//               GUARD           ACTION                  DESTINATION
+//             +---------------+-----------------------+-------------------------------+
+    transition < not_arrived   , walk                  , STATE::WALK_TO_RECEPTION      >,
+    transition < arrived       , set_reception_time    , STATE::WAIT_IN_RECEPTION      >
+> {};
+
+template <> struct table<STATE::WAIT_IN_RECEPTION> : transitions<
+//               GUARD               ACTION          DESTINATION
+//             +-------------------+---------------+---------------------------+
+    transition < time_elapsed      , request_chair , STATE::WAIT_CHAIR_2       >
+> {};
+
+template <> struct table<STATE::WAIT_CHAIR_2> : transitions<
+//               GUARD                   ACTION                              DESTINATION
+//             +-----------------------+-----------------------------------+---------------------------+
+    transition < no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       >,
+    transition < got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_2    >
+> {};
+
+template <> struct table<STATE::WALK_TO_CHAIR_2> : transitions<
+//               GUARD           ACTION             DESTINATION
+//             +---------------+-------------------+---------------------------+
+    transition < not_arrived   , walk              , STATE::WALK_TO_CHAIR_2    >,
+    transition < arrived       , enqueue_in_triage , STATE::WAIT_TRIAGE_TURN   >
+> {};
+
+template <> struct table<STATE::WAIT_TRIAGE_TURN> : transitions<
+//               GUARD               ACTION                      DESTINATION
+//             +-------------------+---------------------------+---------------------------+
+    transition < triage_turn       , set_destination_triage    , STATE::WALK_TO_TRIAGE     >
+> {};
+
+template <> struct table<STATE::WALK_TO_TRIAGE> : transitions<
+//               GUARD           ACTION                  DESTINATION
+//             +---------------+-----------------------+-----------------------+
+    transition < not_arrived   , walk                  , STATE::WALK_TO_TRIAGE >,
+    transition < arrived       , set_triage_time       , STATE::WAIT_IN_TRIAGE >
+> {};
+
+template <> struct table<STATE::WAIT_IN_TRIAGE> : transitions<
+//               GUARD               ACTION              DESTINATION
+//             +-------------------+-------------------+---------------------------+
+    transition < time_elapsed      , get_diagnosis     , STATE::DISPATCH           >
+> {};
+
+template <> struct table<STATE::DISPATCH> : transitions<
+//               GUARD           ACTION              DESTINATION
+//             +---------------+-------------------+-----------------------+
+    transition < to_doctor     , request_chair     , STATE::WAIT_CHAIR_3   >,
+    transition < to_icu        , request_icu       , STATE::WAIT_ICU       >
+> {};
+
+template <> struct table<STATE::WAIT_CHAIR_3> : transitions<
+//               GUARD                   ACTION                              DESTINATION
+//             +-----------------------+-----------------------------------+---------------------------+
+    transition < no_chair_available    , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       >,
+    transition < got_chair             , set_destination_chair             , STATE::WALK_TO_CHAIR_3    >
+> {};
+
+template <> struct table<STATE::WALK_TO_CHAIR_3> : transitions<
+//               GUARD           ACTION             DESTINATION
+//             +---------------+-------------------+---------------------------+
+    transition < not_arrived   , walk              , STATE::WALK_TO_CHAIR_3    >,
+    transition < arrived       , enqueue_in_doctor , STATE::WAIT_FOR_DOCTOR    >
+> {};
+
+template <> struct table<STATE::WAIT_FOR_DOCTOR> : transitions<
+//               GUARD               ACTION                      DESTINATION
+//             +-------------------+---------------------------+---------------------------+
+    transition < doctor_turn       , set_doctor_destination    , STATE::WALK_TO_DOCTOR     >,
+    transition < doctor_timeout    , empty                     , STATE::NO_ATTENTION       >
+> {};
+
+template <> struct table<STATE::WALK_TO_DOCTOR> : transitions<
+//               GUARD           ACTION                  DESTINATION
+//             +---------------+-----------------------+-----------------------+
+    transition < not_arrived   , walk                  , STATE::WALK_TO_DOCTOR >,
+    transition < arrived       , set_doctor_time       , STATE::WAIT_IN_DOCTOR >
+> {};
+
+template <> struct table<STATE::WAIT_IN_DOCTOR> : transitions<
+//               GUARD               ACTION                              DESTINATION
+//             +-------------------+-----------------------------------+---------------------------+
+    transition < time_elapsed      , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       >
+> {};
+
+template <> struct table<STATE::NO_ATTENTION> : transitions<
+//               GUARD           ACTION                              DESTINATION
+//             +---------------+-----------------------------------+---------------------------+
+    transition < always_true   , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT       >
+> {};
+
+template <> struct table<STATE::WAIT_ICU> : transitions<
+//               GUARD           ACTION                              DESTINATION
+//             +---------------+-----------------------------------+-----------------------+
+    transition < icu_available , set_icu_destination               , STATE::WALK_TO_ICU    >,
+    transition < icu_full      , set_exit_motive_and_destination   , STATE::WALK_TO_ICU    >
+> {};
+
+template <> struct table<STATE::WALK_TO_ICU> : transitions<
+//               GUARD           ACTION              DESTINATION
+//             +---------------+-------------------+-----------------------+
+    transition < not_arrived   , walk              , STATE::WALK_TO_ICU    >,
+    transition < arrived       , enter_icu         , STATE::SLEEP          >
+> {};
+
+template <> struct table<STATE::SLEEP> : transitions<
+//               GUARD           ACTION              DESTINATION
+//             +---------------+-------------------+-------------------+
+    transition < time_elapsed  , empty             , STATE::RESOLVE    >
+> {};
+
+template <> struct table<STATE::RESOLVE> : transitions<
+//               GUARD           ACTION                              DESTINATION
+//             +---------------+-----------------------------------+-----------------------+
+    transition < alive         , leave_icu                         , STATE::LEAVE_ICU      >,
+    transition < dead          , empty                             , STATE::MORGUE         >
+> {};
+
+template <> struct table<STATE::LEAVE_ICU> : transitions<
+//               GUARD           ACTION                              DESTINATION
+//             +---------------+-----------------------------------+-----------------------+
+    transition < always_true   , set_exit_motive_and_destination   , STATE::WALK_TO_EXIT   >
+> {};
+
+template <> struct table<STATE::MORGUE> : transitions<
+//               GUARD           ACTION          DESTINATION
+//             +---------------+---------------+-------------------------------+
+    transition < always_true   , kill_patient  , STATE::AWAITING_DELETION      >
+> {};
+
+template <> struct table<STATE::WALK_TO_EXIT> : transitions<
+//               GUARD           ACTION      DESTINATION
+//             +---------------+-----------+---------------------------+
+    transition < not_arrived   , walk      , STATE::WALK_TO_EXIT       >,
+    transition < arrived       , empty     , STATE::AWAITING_DELETION  >
+> {};
+
+template <> struct table<STATE::AWAITING_DELETION> : transitions<
+> {};
+
+// clang-format on
+
+////////////////////////////////////////////////////////////////////////////////
+// DISPATCH
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr auto state_count = static_cast<std::size_t>(STATE::AWAITING_DELETION) + 1;
+
+/// @brief Build the table with the logic of every state, indexed by state
+template <std::size_t... I>
+constexpr std::array<action_type, sizeof...(I)> make_dispatch(std::index_sequence<I...> /*unused*/)
 {
+    return { run<static_cast<STATE>(I)>... };
 }
 
+constexpr auto dispatch = make_dispatch(std::make_index_sequence<state_count> {});
+
+} // namespace
+
 /// @brief Default construct an empty FSM, starting in the initial state
 /// @param fw The patient flyweight
 /// @param patient The patient associated with this FSM
@@ -599,27 +701,88 @@ void sti::patient_fsm::tick()
 
     // The logic is: iterate over the current state looking for a guard
     // returning true, when found, execute the exit action (if any), then
-    // execute the transition action, and finally update the state and return
-    for (const auto& transition : patient_flyweight_->fsm.transitions.at(current_state)) {
-
-        // Guard triggered, execute the plan
-        if (transition.guard(*this)) {
-
-            // Execute the exit action
-            if (patient_flyweight_->fsm.exits.find(current_state) != patient_flyweight_->fsm.exits.end()) {
-                patient_flyweight_->fsm.exits.at(current_state)(*this);
-            }
-
-            // Execute the transition action
-            transition.action(*this);
-
-            // Update the state, run the entry action and break the loop to
-            // avoid checking fot guards in the new state
-            current_state = transition.destination;
-            if (patient_flyweight_->fsm.entries.find(current_state) != patient_flyweight_->fsm.entries.end()) {
-                patient_flyweight_->fsm.entries.at(current_state)(*this);
-            }
-            break;
-        }
+    // execute the transition action, and finally update the state and run the
+    // entry action (if any). The transitions of each state are resolved at
+    // compile time, only the current state is looked up
+    dispatch[static_cast<std::size_t>(current_state)](*this);
+}
+
+/// @brief Get the instant the FSM waits for, if only time can change the state
+/// @details In these states the only guard is the attention time elapsed,
+/// the FSM can't change state until the first tick after the instant
+/// @return The instant, or none if the state depends on something else
+boost::optional<sti::datetime> sti::patient_fsm::wake_time() const
+{
+    switch (current_state) {
+    case STATE::WAIT_IN_RECEPTION:
+    case STATE::WAIT_IN_TRIAGE:
+    case STATE::WAIT_IN_DOCTOR:
+    case STATE::SLEEP:
+        return attention_end;
+    default:
+        return boost::none;
+    }
+}
+
+/// @brief Get the name of the last state the FSM left
+/// @return The name, or an empty string if the FSM never changed state
+std::string sti::patient_fsm::last_state_name() const
+{
+    if (!last_state) return {};
+    return state_2_string(*last_state);
+}
+
+/// @brief Get the name of a state, as in the statistics
+/// @param state The state
+std::string sti::patient_fsm::state_name(STATE state)
+{
+    return state_2_string(state);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// WIRE FORMAT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Store the FSM state in the fixed layout format
+/// @param wire The destination
+void sti::patient_fsm::pack(fsm_wire& wire) const
+{
+    wire.state         = static_cast<std::uint8_t>(current_state);
+    wire.diagnosis     = static_cast<std::uint8_t>(diagnosis.which());
+    wire.destination_x = destination.x;
+    wire.destination_y = destination.y;
+    wire.attention_end = attention_end.seconds_since_epoch();
+    wire.last_state    = last_state ? static_cast<std::uint8_t>(*last_state) : fsm_wire::no_state;
+
+    if (triage::holds_doctor_diagnosis(diagnosis)) {
+        const auto& d = boost::get<triage::doctor_diagnosis>(diagnosis);
+        wire.doctor_assigned      = d.doctor_assigned;
+        wire.level                = d.level;
+        wire.attention_time_limit = d.attention_time_limit.seconds_since_epoch();
+    } else {
+        const auto& d   = boost::get<triage::icu_diagnosis>(diagnosis);
+        wire.sleep_time = d.sleep_time.length();
+        wire.survives   = d.survives ? 1 : 0;
+    }
+}
+
+/// @brief Restore the FSM state from the fixed layout format
+/// @param wire The source
+void sti::patient_fsm::unpack(const fsm_wire& wire)
+{
+    current_state = static_cast<STATE>(wire.state);
+    destination   = { wire.destination_x, wire.destination_y };
+    attention_end = datetime { wire.attention_end };
+    last_state    = boost::none;
+    if (wire.last_state != fsm_wire::no_state) last_state = static_cast<STATE>(wire.last_state);
+
+    if (wire.diagnosis == 0) {
+        diagnosis = triage::doctor_diagnosis { wire.doctor_assigned,
+                                               wire.level,
+                                               datetime { wire.attention_time_limit } };
+    } else {
+        diagnosis = triage::icu_diagnosis { timedelta { wire.sleep_time },
+                                            wire.survives != 0 };
     }
-}
\ No newline at end of file
+    ++_version;
+}
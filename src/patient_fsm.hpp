@@ -2,10 +2,8 @@
 /// @brief Implement the patient circulation logic with a state machine
 #pragma once
 
-#include <boost/serialization/access.hpp>
-#include <boost/serialization/variant.hpp>
-#include <functional>
-#include <map>
+#include <boost/optional.hpp>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
@@ -16,6 +14,7 @@
 
 // Fw. declarations
 namespace sti {
+struct fsm_wire;
 class patient_agent;
 struct patient_flyweight;
 }
@@ -58,40 +57,18 @@ struct patient_fsm {
         AWAITING_DELETION,
     };
 
+    /// @brief The number of states
+    constexpr static auto states = static_cast<std::size_t>(STATE::AWAITING_DELETION) + 1;
+
     ////////////////////////////////////////////////////////////////////////////
     // TYPES
     ////////////////////////////////////////////////////////////////////////////
 
-    using guard_signature  = std::function<bool(patient_fsm&)>;
-    using action_signature = std::function<void(patient_fsm&)>;
-    struct transition_type {
-        guard_signature  guard;
-        action_signature action;
-        STATE            destination;
-    };
-    using transition_table = std::map<STATE, std::vector<transition_type>>;
-
-    using entry_signature = std::function<void(patient_fsm&)>;
-    using exit_signature  = std::function<void(patient_fsm&)>;
-
-    using entry_list = std::map<STATE, entry_signature>;
-    using exit_list  = std::map<STATE, exit_signature>;
+    // The transition table, the entry and exit actions of each state are
+    // generated at compile time, see patient_fsm.cpp
 
     using patient_flyweight_ptr = patient_flyweight*;
 
-    ////////////////////////////////////////////////////////////////////////////
-    // FLYWEIGHT / SHARED ATTRIBUTES
-    ////////////////////////////////////////////////////////////////////////////
-
-    class flyweight {
-    public:
-        flyweight();
-
-        transition_table transitions;
-        entry_list       entries;
-        exit_list        exits;
-    };
-
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -108,46 +85,54 @@ struct patient_fsm {
     /// @brief Execute the FSM logic, change states,
     void tick();
 
+    /// @brief Get the instant the FSM waits for, if only time can change the state
+    /// @details In these states the only guard is the attention time elapsed,
+    /// the FSM can't change state until the first tick after the instant
+    /// @return The instant, or none if the state depends on something else
+    boost::optional<datetime> wake_time() const;
+
+    /// @brief Get the name of the last state the FSM left
+    /// @return The name, or an empty string if the FSM never changed state
+    std::string last_state_name() const;
+
+    /// @brief Get the name of a state, as in the statistics
+    /// @param state The state
+    static std::string state_name(STATE state);
+
     ////////////////////////////////////////////////////////////////////////////
-    // INTERNAL STATE
+    // WIRE FORMAT
     ////////////////////////////////////////////////////////////////////////////
 
-    // Private serialization, for security
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int /*unused*/)
+    /// @brief Store the FSM state in the fixed layout format
+    /// @param wire The destination
+    void pack(fsm_wire& wire) const;
+
+    /// @brief Restore the FSM state from the fixed layout format
+    /// @param wire The source
+    void unpack(const fsm_wire& wire);
+
+    /// @brief Get a counter incremented on every transition
+    std::uint32_t version() const
     {
-        ar& current_state;
-        ar& destination;
-        ar& attention_end;
-        ar& last_state;
-        ar& diagnosis;
-    } // void serialize()
+        return _version;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // INTERNAL STATE
+    ////////////////////////////////////////////////////////////////////////////
 
     patient_flyweight_ptr patient_flyweight_;
     patient_agent*        patient;
 
-    // Internal serializable state
+    // Internal state, sent in the wire
     STATE                    current_state;
     coordinates<double>      destination;
     datetime                 attention_end;
-    std::string              last_state;
+    boost::optional<STATE>   last_state;
     triage::triage_diagnosis diagnosis;
+
+    // Not in the wire, only used to detect changes
+    std::uint32_t _version {};
 }; // class patient_fsm
 
 } // namespace sti
-
-// State enum serialization
-namespace boost {
-namespace serialization {
-
-    template <class Archive>
-    void serialize(Archive& ar, sti::patient_fsm::STATE& s, const unsigned int /*unused*/)
-    {
-        ar& s;
-    } // void serialize(...)
-
-} // namespace serialization
-} // namespaces boost
-
-BOOST_CLASS_IMPLEMENTATION(sti::patient_fsm, boost::serialization::object_serializable);
-BOOST_CLASS_TRACKING(sti::patient_fsm, boost::serialization::track_never)
@@ -1,9 +1,8 @@
 #include "person.hpp"
 
-#include <boost/mpi/packed_iarchive.hpp>
-#include <boost/mpi/packed_oarchive.hpp>
 #include <boost/json/value.hpp>
 
+#include "agent_wire.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
 #include "json_serialization.hpp"
 
@@ -40,26 +39,34 @@ sti::person_agent::person_agent(const id_t& id, const flyweight* fw)
 // SERIALIZATION
 ////////////////////////////////////////////////////////////////////////////
 
-/// @brief Serialize the agent state into a string using Boost.Serialization
-/// @return A string with the serialized data
-void sti::person_agent::serialize(serial_data& data, boost::mpi::communicator* communicator)
+/// @brief Store the agent state in the fixed layout format
+/// @param wire The destination, sent as is to other processes
+void sti::person_agent::pack(agent_wire& wire) const
 {
-    // Used to make sure the stream is flushed
-    auto pa = boost::mpi::packed_oarchive { *communicator, data };
-    pa << (*this);
+    wire.behaviour.role.assign(_type);
+    _infection_logic.pack(wire.infection);
 }
 
-/// @brief Reconstruct the agent state from a string using Boost.Serialization
-/// @param data The serialized data
-void sti::person_agent::serialize(const id_t&               id,
-                                  serial_data&              data,
-                                  boost::mpi::communicator* communicator)
+/// @brief Restore the agent state from the fixed layout format
+/// @param id The new AgentId
+/// @param wire The source
+/// @param sections The sections of the wire to restore, see wire_section
+void sti::person_agent::unpack(const id_t& id, const agent_wire& wire, std::uint8_t sections)
 {
     contagious_agent::id(id);
-    { // Used to make sure the stream is flushed
-        auto ia = boost::mpi::packed_iarchive { *communicator, data };
-        ia >> (*this);
+    if ((sections & wire_section::INFECTION) != 0) {
+        _infection_logic.unpack(wire.infection);
     }
+    if ((sections & wire_section::BEHAVIOUR) != 0) {
+        _type = wire.behaviour.role.str();
+    }
+}
+
+/// @brief Get the version of each part of the agent state
+/// @details The role never changes, only the infection has versions
+sti::contagious_agent::state_versions sti::person_agent::versions() const
+{
+    return { _infection_logic.version(), 0 };
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -74,6 +81,8 @@ sti::person_agent::type sti::person_agent::get_type() const
 }
 
 /// @brief Perform the actions this agent is supposed to
+/// @details Only ticks the infection, the model does it directly after
+/// the contacts instead of calling act()
 void sti::person_agent::act()
 {
     _infection_logic.tick();
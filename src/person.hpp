@@ -10,11 +10,12 @@
 
 #include "contagious_agent.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
+#include "object_pool.hpp"
 
 namespace sti {
 
 /// @brief An agent representing a person with no logic or mobility only tranmission
-class person_agent final : public contagious_agent {
+class person_agent final : public contagious_agent, public pooled<person_agent> {
 
 public:
     ////////////////////////////////////////////////////////////////////////////
@@ -51,18 +52,18 @@ public:
     // SERIALIZATION
     ////////////////////////////////////////////////////////////////////////////
 
-    /// @brief Serialize the agent state into a string using Boost.Serialization
-    /// @param communicator The MPI communicator over which this archive will be sent
-    /// @return A string with the serialized data
-    void serialize(serial_data& data, boost::mpi::communicator* communicator) override;
+    /// @brief Store the agent state in the fixed layout format
+    /// @param wire The destination, sent as is to other processes
+    void pack(agent_wire& wire) const override;
 
-    /// @brief Reconstruct the agent state from a string using Boost.Serialization
+    /// @brief Restore the agent state from the fixed layout format
     /// @param id The new AgentId
-    /// @param data The serialized data
-    /// @param communicator The MPI communicator over which the archive was sent
-    void serialize(const id_t&               id,
-                   serial_data&              data,
-                   boost::mpi::communicator* communicator) override;
+    /// @param wire The source
+    /// @param sections The sections of the wire to restore, see wire_section
+    void unpack(const id_t& id, const agent_wire& wire, std::uint8_t sections) override;
+
+    /// @brief Get the version of each part of the agent state
+    state_versions versions() const override;
 
     ////////////////////////////////////////////////////////////////////////////
     // BEHAVIOUR
@@ -73,6 +74,8 @@ public:
     type get_type() const override;
 
     /// @brief Perform the actions this agent is supposed to
+    /// @details Only ticks the infection, the model does it directly after
+    /// the contacts instead of calling act()
     void act() final;
 
     /// @brief Get the infection logic
@@ -92,16 +95,6 @@ public:
     boost::json::object stats() const override;
 
 private:
-    friend class boost::serialization::access;
-
-    // Private serialization, for security
-    template <class Archive>
-    void serialize(Archive& ar, const unsigned int /*unused*/)
-    {
-        ar& _type;
-        ar& _infection_logic;
-    }
-
     flyweight_ptr         _flyweight;
     person_type           _type;
     human_infection_cycle _infection_logic;
@@ -109,6 +102,3 @@ private:
 }; // class person_agent
 
 } // namespace sti
-
-BOOST_CLASS_IMPLEMENTATION(sti::person_agent, boost::serialization::object_serializable);
-BOOST_CLASS_TRACKING(sti::person_agent, boost::serialization::track_never)
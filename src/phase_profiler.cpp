@@ -0,0 +1,232 @@
+/// @file phase_profiler.cpp
+/// @brief Time spent in the named phases of the tick, aggregated across ranks
+#include "phase_profiler.hpp"
+
+#include <algorithm>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/operations.hpp>
+#include <utility>
+
+#include "table_writer.hpp"
+
+namespace {
+
+/// @brief Get the histogram bucket of a duration, the bucket b holds [2^b, 2^(b+1))
+std::size_t bucket_of(std::int64_t ns)
+{
+    if (ns <= 1) return 0;
+    const auto bucket = static_cast<std::size_t>(63 - __builtin_clzll(static_cast<unsigned long long>(ns)));
+    return std::min(bucket, sti::phase_profiler::buckets - 1);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a profiler
+/// @param enabled If false no time is measured
+/// @param now The timestamp source
+/// @param phases The phases, the id of a phase is its index, the parents
+/// must be defined before their children
+/// @param counters The hardware counters read with the timestamps, or
+/// nullptr to only measure the time
+sti::phase_profiler::phase_profiler(bool enabled, instrumentation::clock_function now, std::vector<definition> phases, const hardware_counters* counters)
+    : _enabled { enabled }
+    , _now { now }
+    , _counters { counters != nullptr && counters->available() ? counters : nullptr }
+    , _report_counters { counters != nullptr }
+    , _phases { std::move(phases) }
+    , _measures(_phases.size())
+{
+    _running.reserve(_phases.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Start a phase
+/// @param phase The phase, a child of the phase currently running
+/// @throws bad_phase_nesting If the phase is not a child of the running phase
+void sti::phase_profiler::enter(phase_id phase)
+{
+    const auto parent = _running.empty() ? no_parent : _running.back().phase;
+    if (_phases.at(phase).parent != parent) throw bad_phase_nesting {};
+    _running.push_back({ phase, _now(), _counters != nullptr ? _counters->read() : hardware_counters::values {} });
+}
+
+/// @brief Finish the phase currently running
+void sti::phase_profiler::leave()
+{
+    const auto finished = _running.back();
+    _running.pop_back();
+
+    auto& m = add_call(finished.phase, _now() - finished.start);
+    if (_counters == nullptr) return;
+    const auto counters = _counters->read();
+    for (auto c = std::size_t { 0 }; c < counters.size(); ++c) m.counters[c] += counters[c] - finished.counters_start[c];
+}
+
+/// @brief Add a call of a phase timed elsewhere, in another thread
+/// @details Without the hardware counters, they are per thread
+/// @param phase The phase, a child of the phase currently running
+/// @param ns The time of the call
+/// @throws bad_phase_nesting If the phase is not a child of the running phase
+void sti::phase_profiler::record(phase_id phase, std::int64_t ns)
+{
+    if (!_enabled) return;
+    const auto parent = _running.empty() ? no_parent : _running.back().phase;
+    if (_phases.at(phase).parent != parent) throw bad_phase_nesting {};
+    add_call(phase, ns);
+}
+
+/// @brief Add a call to the measures of a phase
+/// @param phase The phase
+/// @param ns The time of the call
+/// @return The measures
+sti::phase_profiler::measures& sti::phase_profiler::add_call(phase_id phase, std::int64_t ns)
+{
+    auto& m = _measures[phase];
+    m.calls += 1;
+    m.total_ns += ns;
+    m.min_ns = std::min(m.min_ns, ns);
+    m.max_ns = std::max(m.max_ns, ns);
+    m.histogram[bucket_of(ns)] += 1;
+    return m;
+}
+
+/// @brief Get the names and the parents of the phases, by phase id
+const std::vector<sti::phase_profiler::definition>& sti::phase_profiler::phases() const
+{
+    return _phases;
+}
+
+/// @brief Get the time spent in a phase so far, in this rank
+/// @param phase The phase
+std::int64_t sti::phase_profiler::total_ns(phase_id phase) const
+{
+    return _measures[phase].total_ns;
+}
+
+/// @brief Reduce the phases of all the ranks and write them in the root
+/// @param communicator The MPI communicator
+/// @param output The writer of the tables
+void sti::phase_profiler::report(boost::mpi::communicator& communicator, const table_writer& output) const
+{
+    if (!_enabled) return;
+    if (_report_counters) report_counters(communicator, output);
+
+    constexpr auto root = 0;
+    const auto     n    = static_cast<int>(_measures.size());
+
+    auto calls      = std::vector<std::uint64_t> {};
+    auto totals     = std::vector<std::int64_t> {};
+    auto mins       = std::vector<std::int64_t> {};
+    auto maxs       = std::vector<std::int64_t> {};
+    auto histograms = std::vector<std::uint64_t> {};
+    for (const auto& m : _measures) {
+        calls.push_back(m.calls);
+        totals.push_back(m.total_ns);
+        mins.push_back(m.min_ns);
+        maxs.push_back(m.max_ns);
+        histograms.insert(histograms.end(), m.histogram.begin(), m.histogram.end());
+    }
+
+    auto all_calls     = std::vector<std::uint64_t>(calls.size());
+    auto min_totals    = std::vector<std::int64_t>(totals.size());
+    auto max_totals    = std::vector<std::int64_t>(totals.size());
+    auto sum_totals    = std::vector<std::int64_t>(totals.size());
+    auto min_calls     = std::vector<std::int64_t>(mins.size());
+    auto max_calls     = std::vector<std::int64_t>(maxs.size());
+    auto all_histogram = std::vector<std::uint64_t>(histograms.size());
+
+    boost::mpi::reduce(communicator, calls.data(), n, all_calls.data(), std::plus<std::uint64_t> {}, root);
+    boost::mpi::reduce(communicator, totals.data(), n, min_totals.data(), boost::mpi::minimum<std::int64_t> {}, root);
+    boost::mpi::reduce(communicator, totals.data(), n, max_totals.data(), boost::mpi::maximum<std::int64_t> {}, root);
+    boost::mpi::reduce(communicator, totals.data(), n, sum_totals.data(), std::plus<std::int64_t> {}, root);
+    boost::mpi::reduce(communicator, mins.data(), n, min_calls.data(), boost::mpi::minimum<std::int64_t> {}, root);
+    boost::mpi::reduce(communicator, maxs.data(), n, max_calls.data(), boost::mpi::maximum<std::int64_t> {}, root);
+    boost::mpi::reduce(communicator, histograms.data(), static_cast<int>(histograms.size()), all_histogram.data(), std::plus<std::uint64_t> {}, root);
+
+    if (communicator.rank() != root) return;
+
+    auto profile = table {};
+    auto& phase  = profile.add_column<std::string>("phase");
+    auto& parent = profile.add_column<std::string>("parent");
+    auto& ncalls = profile.add_column<std::int64_t>("calls");
+    auto& tmin   = profile.add_column<std::int64_t>("total_min_ns");
+    auto& tmean  = profile.add_column<double>("total_mean_ns");
+    auto& tmax   = profile.add_column<std::int64_t>("total_max_ns");
+    auto& cmin   = profile.add_column<std::int64_t>("call_min_ns");
+    auto& cmax   = profile.add_column<std::int64_t>("call_max_ns");
+
+    auto histogram = table {};
+    auto& hphase   = histogram.add_column<std::string>("phase");
+    auto& hlower   = histogram.add_column<std::int64_t>("lower_ns");
+    auto& hcount   = histogram.add_column<std::int64_t>("count");
+
+    for (auto p = std::size_t { 0 }; p < _phases.size(); ++p) {
+        const auto& def = _phases[p];
+        phase.push_back(def.name);
+        parent.push_back(def.parent == no_parent ? "" : _phases.at(def.parent).name);
+        ncalls.push_back(static_cast<std::int64_t>(all_calls[p]));
+        tmin.push_back(min_totals[p]);
+        tmean.push_back(static_cast<double>(sum_totals[p]) / communicator.size());
+        tmax.push_back(max_totals[p]);
+        cmin.push_back(all_calls[p] == 0 ? 0 : min_calls[p]);
+        cmax.push_back(max_calls[p]);
+
+        for (auto b = std::size_t { 0 }; b < buckets; ++b) {
+            const auto count = all_histogram[p * buckets + b];
+            if (count == 0) continue;
+            hphase.push_back(def.name);
+            hlower.push_back(b == 0 ? 0 : std::int64_t { 1 } << b);
+            hcount.push_back(static_cast<std::int64_t>(count));
+        }
+    }
+
+    output.write("phase_profile", profile);
+    output.write("phase_histograms", histogram);
+}
+
+/// @brief Reduce the hardware counters of the phases and write them in the root
+/// @details The counters may be available in some ranks only, the rest send
+/// zeros so the gather is the same in all the ranks
+/// @param communicator The MPI communicator
+/// @param output The writer of the tables
+void sti::phase_profiler::report_counters(boost::mpi::communicator& communicator, const table_writer& output) const
+{
+    constexpr auto root = 0;
+
+    auto counts = std::vector<std::uint64_t> {};
+    for (const auto& m : _measures) counts.insert(counts.end(), m.counters.begin(), m.counters.end());
+
+    auto all_counts = std::vector<std::uint64_t> {};
+    boost::mpi::gather(communicator, counts.data(), static_cast<int>(counts.size()), all_counts, root);
+    if (communicator.rank() != root) return;
+
+    auto  counters = table {};
+    auto& rank     = counters.add_column<std::int32_t>("rank");
+    auto& phase    = counters.add_column<std::string>("phase");
+    auto  columns  = std::vector<std::vector<std::int64_t>*> {};
+    for (const auto* name : hardware_counters::names) columns.push_back(&counters.add_column<std::int64_t>(name));
+    auto& ipc = counters.add_column<double>("ipc");
+
+    auto it = all_counts.begin();
+    for (auto r = 0; r < communicator.size(); ++r) {
+        for (const auto& def : _phases) {
+            rank.push_back(r);
+            phase.push_back(def.name);
+            for (auto* column : columns) column->push_back(static_cast<std::int64_t>(*it++));
+
+            const auto cycles       = columns[hardware_counters::cycles]->back();
+            const auto instructions = columns[hardware_counters::instructions]->back();
+            ipc.push_back(cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles));
+        }
+    }
+
+    output.write("phase_counters", counters);
+}
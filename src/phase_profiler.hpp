@@ -0,0 +1,201 @@
+/// @file phase_profiler.hpp
+/// @brief Time spent in the named phases of the tick, aggregated across ranks
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "hardware_counters.hpp"
+#include "instrumentation.hpp"
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace sti {
+class table_writer;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Error in the nesting of the profiled phases
+struct bad_phase_nesting : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The phase is not a child of the running phase";
+    }
+};
+
+/// @brief Scoped timers of named phases that nest
+/// @details The phases are defined once, each with its parent, and timed with
+/// scope objects. Each phase keeps the number of calls, the total, minimum and
+/// maximum time and a histogram of the durations with power of two buckets.
+/// At the end report() reduces the phases of all the ranks, so the load
+/// imbalance of each phase is in the output. With hardware counters each
+/// phase also adds the cycles, instructions, cache and branch misses counted
+/// while running, reported per rank. When disabled the scopes only check a
+/// flag.
+class phase_profiler {
+
+public:
+    using phase_id = std::uint16_t;
+
+    constexpr static auto no_parent = std::numeric_limits<phase_id>::max();
+    constexpr static auto buckets   = std::size_t { 40 }; // Up to 2^40 ns, ~18 minutes
+
+    /// @brief The name and the parent of a phase
+    struct definition {
+        std::string name;
+        phase_id    parent;
+    };
+
+    /// @brief Times a phase from construction to destruction
+    class scope {
+
+    public:
+        /// @brief Enter a phase
+        /// @param profiler The profiler
+        /// @param phase The phase
+        scope(phase_profiler& profiler, phase_id phase)
+            : _profiler { profiler.enabled() ? &profiler : nullptr }
+        {
+            if (_profiler != nullptr) _profiler->enter(phase);
+        }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+        scope(scope&&) = delete;
+        scope& operator=(scope&&) = delete;
+
+        /// @brief Leave the phase
+        ~scope()
+        {
+            if (_profiler != nullptr) _profiler->leave();
+        }
+
+    private:
+        phase_profiler* _profiler;
+    }; // class scope
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create a profiler
+    /// @param enabled If false no time is measured
+    /// @param now The timestamp source
+    /// @param phases The phases, the id of a phase is its index, the parents
+    /// must be defined before their children
+    /// @param counters The hardware counters read with the timestamps, or
+    /// nullptr to only measure the time
+    phase_profiler(bool enabled, instrumentation::clock_function now, std::vector<definition> phases, const hardware_counters* counters = nullptr);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if the profiler measures
+    bool enabled() const
+    {
+        return _enabled;
+    }
+
+    /// @brief Time a phase until the end of the returned scope
+    /// @param phase The phase, a child of the phase currently running
+    /// @return The scope
+    scope time(phase_id phase)
+    {
+        return scope { *this, phase };
+    }
+
+    /// @brief Time a function as a phase
+    /// @param phase The phase, a child of the phase currently running
+    /// @param f The function
+    template <typename Function>
+    void run(phase_id phase, Function&& f)
+    {
+        const auto timed = time(phase);
+        f();
+    }
+
+    /// @brief Start a phase
+    /// @param phase The phase, a child of the phase currently running
+    /// @throws bad_phase_nesting If the phase is not a child of the running phase
+    void enter(phase_id phase);
+
+    /// @brief Finish the phase currently running
+    void leave();
+
+    /// @brief Add a call of a phase timed elsewhere, in another thread
+    /// @details Without the hardware counters, they are per thread
+    /// @param phase The phase, a child of the phase currently running
+    /// @param ns The time of the call
+    /// @throws bad_phase_nesting If the phase is not a child of the running phase
+    void record(phase_id phase, std::int64_t ns);
+
+    /// @brief Get the names and the parents of the phases, by phase id
+    const std::vector<definition>& phases() const;
+
+    /// @brief Get the time spent in a phase so far, in this rank
+    /// @param phase The phase
+    std::int64_t total_ns(phase_id phase) const;
+
+    /// @brief Reduce the phases of all the ranks and write them in the root
+    /// @details Collective, must be called by all the ranks. The root writes
+    /// the phase_profile table, with the calls and the min, mean and max
+    /// total time across ranks of each phase, and the phase_histograms
+    /// table, with the histograms of all the ranks added. With hardware
+    /// counters the phase_counters table has the counts of each phase in
+    /// each rank
+    /// @param communicator The MPI communicator
+    /// @param output The writer of the tables
+    void report(boost::mpi::communicator& communicator, const table_writer& output) const;
+
+private:
+    /// @brief The measures of a phase
+    struct measures {
+        std::uint64_t                      calls {};
+        std::int64_t                       total_ns {};
+        std::int64_t                       min_ns { std::numeric_limits<std::int64_t>::max() };
+        std::int64_t                       max_ns {};
+        std::array<std::uint64_t, buckets> histogram {};
+        hardware_counters::values          counters {};
+    };
+
+    /// @brief A running phase
+    struct running {
+        phase_id                  phase;
+        std::int64_t              start;
+        hardware_counters::values counters_start;
+    };
+
+    /// @brief Add a call to the measures of a phase
+    /// @param phase The phase
+    /// @param ns The time of the call
+    /// @return The measures
+    measures& add_call(phase_id phase, std::int64_t ns);
+
+    /// @brief Reduce the hardware counters of the phases and write them in the root
+    /// @param communicator The MPI communicator
+    /// @param output The writer of the tables
+    void report_counters(boost::mpi::communicator& communicator, const table_writer& output) const;
+
+    bool                            _enabled;
+    instrumentation::clock_function _now;
+    const hardware_counters*        _counters; // Only if they are available
+    bool                            _report_counters; // Even if not available in this rank
+    std::vector<definition>         _phases;
+    std::vector<measures>           _measures;
+    std::vector<running>            _running;
+}; // class phase_profiler
+
+} // namespace sti
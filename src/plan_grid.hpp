@@ -0,0 +1,201 @@
+/// @file plan_grid.hpp
+/// @brief Contiguous grid with the walkability and tile kind of each cell
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "coordinates.hpp"
+
+namespace sti {
+
+/// @brief Contiguous, row-major grid storing the hospital plan
+/// @details Each cell stores two things: a walkability bit, packed in 64 bit
+/// words, and a byte with the kind of tile (i.e. floor, wall, chair). All the
+/// cells are stored in two flat buffers, indexed as y * width + x.
+class plan_grid {
+
+public:
+    using word_type  = std::uint64_t;
+    using tile_type  = std::uint8_t;
+    using index_type = std::size_t;
+
+    static constexpr auto word_bits = index_type { 64 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Construct an empty grid
+    plan_grid() = default;
+
+    /// @brief Construct a grid with all the tiles in the same state
+    /// @param width The number of columns
+    /// @param height The number of rows
+    /// @param walkable The initial walkability of the cells
+    /// @param tile The initial kind of the cells
+    plan_grid(index_type width, index_type height, bool walkable = true, tile_type tile = 0)
+        : _width { width }
+        , _height { height }
+        , _walkable((width * height + word_bits - 1) / word_bits, walkable ? ~word_type { 0 } : word_type { 0 })
+        , _tiles(width * height, tile)
+    {
+    }
+
+    /// @brief Construct a grid from its buffers, as returned by walkable_words() and tiles()
+    /// @throws std::invalid_argument If the buffers don't match the dimensions
+    /// @param width The number of columns
+    /// @param height The number of rows
+    /// @param walkable The walkability bits
+    /// @param tiles The kind of each cell
+    plan_grid(index_type width, index_type height, std::vector<word_type> walkable, std::vector<tile_type> tiles)
+        : _width { width }
+        , _height { height }
+        , _walkable { std::move(walkable) }
+        , _tiles { std::move(tiles) }
+    {
+        if (_walkable.size() != (size() + word_bits - 1) / word_bits || _tiles.size() != size()) {
+            throw std::invalid_argument { "The grid buffers don't match its dimensions" };
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // DIMENSIONS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of columns
+    index_type width() const
+    {
+        return _width;
+    }
+
+    /// @brief Get the number of rows
+    index_type height() const
+    {
+        return _height;
+    }
+
+    /// @brief Get the number of cells
+    index_type size() const
+    {
+        return _width * _height;
+    }
+
+    /// @brief Check if a cell is inside the grid
+    bool contains(const coordinates<int>& cell) const
+    {
+        return cell.x >= 0 && cell.y >= 0
+            && static_cast<index_type>(cell.x) < _width
+            && static_cast<index_type>(cell.y) < _height;
+    }
+
+    /// @brief Get the flat index of a cell, the cell must be inside the grid
+    index_type index(const coordinates<int>& cell) const
+    {
+        return static_cast<index_type>(cell.y) * _width + static_cast<index_type>(cell.x);
+    }
+
+    /// @brief Get the cell of a flat index
+    coordinates<int> cell(index_type index) const
+    {
+        return { static_cast<int>(index % _width), static_cast<int>(index / _width) };
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // ACCESS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if a cell is walkable, the cell must be inside the grid
+    bool walkable(index_type index) const
+    {
+        return ((_walkable[index / word_bits] >> (index % word_bits)) & word_type { 1 }) != 0;
+    }
+
+    /// @brief Check if a cell is walkable, the cell must be inside the grid
+    bool walkable(const coordinates<int>& cell) const
+    {
+        return walkable(index(cell));
+    }
+
+    /// @brief Get the kind of tile of a cell, the cell must be inside the grid
+    tile_type tile(const coordinates<int>& cell) const
+    {
+        return _tiles[index(cell)];
+    }
+
+    /// @brief Set the walkability of a cell
+    /// @param cell The cell to modify
+    /// @param walkable True if the cell can be walked over
+    void set_walkable(const coordinates<int>& cell, bool walkable)
+    {
+        const auto i    = index(cell);
+        const auto mask = word_type { 1 } << (i % word_bits);
+        auto&      word = _walkable[i / word_bits];
+        word            = walkable ? (word | mask) : (word & ~mask);
+    }
+
+    /// @brief Set the walkability and the kind of a cell
+    /// @throws std::out_of_range If the cell is outside the grid
+    /// @param cell The cell to modify
+    /// @param walkable True if the cell can be walked over
+    /// @param tile The kind of tile
+    void set(const coordinates<int>& cell, bool walkable, tile_type tile)
+    {
+        if (!contains(cell)) {
+            auto os = std::ostringstream {};
+            os << "Tile " << cell << " is outside the plan";
+            throw std::out_of_range { os.str() };
+        }
+        set_walkable(cell, walkable);
+        _tiles[index(cell)] = tile;
+    }
+
+    /// @brief Get the walkability bits, packed in words, in index order
+    const std::vector<word_type>& walkable_words() const
+    {
+        return _walkable;
+    }
+
+    /// @brief Get the kind of each cell, in index order
+    const std::vector<tile_type>& tiles() const
+    {
+        return _tiles;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // IDENTIFICATION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get a hash of the walkable cells, to identify the plan
+    /// @details Two grids with the same dimensions and walkable cells produce
+    /// the same hash, regardless of the kind of each tile. FNV-1a is used.
+    /// @return A 64 bit hash
+    std::uint64_t hash() const
+    {
+        auto       h       = std::uint64_t { 14695981039346656037ULL };
+        const auto combine = [&](std::uint64_t value) {
+            for (auto byte = 0U; byte < 8U; ++byte) {
+                h ^= (value >> (byte * 8U)) & 0xFFU;
+                h *= 1099511628211ULL;
+            }
+        };
+        combine(_width);
+        combine(_height);
+        for (auto i = index_type { 0 }; i < size(); ++i) {
+            combine(walkable(i) ? 1U : 0U);
+        }
+        return h;
+    }
+
+private:
+    index_type             _width {};
+    index_type             _height {};
+    std::vector<word_type> _walkable;
+    std::vector<tile_type> _tiles;
+}; // class plan_grid
+
+} // namespace sti
@@ -7,26 +7,32 @@
 #include <utility>
 #include <vector>
 
+#include "agent_key.hpp"
+#include "checkpoint.hpp"
 #include "coordinates.hpp"
+#include "manager_exchange.hpp"
 
-// Fw. declarations
-namespace repast {
-class AgentId;
-}
 namespace sti {
 
 /// @brief A cross-process simple queue used to dispatch patients
 /// @details A cross-process queue, the queue resides in one process, and the
 ///          rest use a proxy class that communicates over MPI.
-class queue_manager {
+class queue_manager : public exchange_participant
+    , public checkpoint_participant {
 
 public:
-    using agent_id = repast::AgentId;
+    using exchange_participant::iarchive;
+    using exchange_participant::oarchive;
+
+    using agent_id = agent_key; // The agent ids convert to it
 
     // The front of the queue, containing the next agents/patients to be
     // attended and their assigned location
     using front_type = std::map<coordinates<double>, boost::optional<agent_id>>;
 
+    // A turn assigned, notified to the process of the patient
+    using turn_type = std::pair<agent_id, coordinates<double>>;
+
     ////////////////////////////////////////////////////////////////////////////
     // CONSTRUCTION
     ////////////////////////////////////////////////////////////////////////////
@@ -58,9 +64,6 @@ public:
     /// @return If the agent is in the front of the queue, the coordinates
     virtual boost::optional<coordinates<double>> is_my_turn(const agent_id& id) = 0;
 
-    /// @brief Synchronize the real queue and the remote queues
-    virtual void sync() = 0;
-
 }; // class queue_manager
 
 } // namespace sti
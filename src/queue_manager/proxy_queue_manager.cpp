@@ -1,12 +1,15 @@
-#include <algorithm>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/optional.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/unordered_map.hpp>
 #include <repast_hpc/AgentId.h>
 
 #include "proxy_queue_manager.hpp"
 
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
+
 /// @brief Construct a real queue display
 /// @param comm The MPI Communicator
 /// @param tag The MPI tag
@@ -34,6 +37,7 @@ void sti::proxy_queue_manager::enqueue(const agent_id& id)
 void sti::proxy_queue_manager::dequeue(const agent_id& id)
 {
     _to_dequeue.push_back(id);
+    _turns.erase(id);
 }
 
 /// @brief Check if the given agent is next in the attention
@@ -41,27 +45,72 @@ void sti::proxy_queue_manager::dequeue(const agent_id& id)
 /// @return If the agent is in the front of the queue, the coordinates
 boost::optional<sti::coordinates<double>> sti::proxy_queue_manager::is_my_turn(const agent_id& id)
 {
-    // Search for the patient in the box list
-    auto box_it = std::find_if(_boxes.begin(), _boxes.end(), [&](const auto& pair) {
-        return pair.second == id;
-    });
+    const auto it = _turns.find(id);
 
-    if (box_it != _boxes.end()) {
-        return box_it->first;
+    if (it != _turns.end()) {
+        return it->second;
     }
 
     return boost::none;
 }
 
-/// @brief Synchronize the real queue and the remote queues
-void sti::proxy_queue_manager::sync()
+////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Check if there are enqueues or dequeues since the last exchange
+/// @param destination The rank of the process
+bool sti::proxy_queue_manager::pending_requests(int destination) const
 {
-    auto mpi_tag = _tag;
-    _communicator->send(_real_rank, mpi_tag++, _to_enqueue);
-    _communicator->send(_real_rank, mpi_tag++, _to_dequeue);
+    return destination == _real_rank && (!_to_enqueue.empty() || !_to_dequeue.empty());
+}
 
-    boost::mpi::broadcast(*_communicator, _boxes, _real_rank);
+/// @brief Write the enqueues and dequeues since the last exchange
+/// @param destination The rank of the process
+/// @param ar The archive of the message to the real queue
+void sti::proxy_queue_manager::write_requests(int /*unused*/, oarchive& ar)
+{
+    write_wires<agent_id_wire>(ar, _to_enqueue);
+    write_wires<agent_id_wire>(ar, _to_dequeue);
 
     _to_enqueue.clear();
     _to_dequeue.clear();
-}
\ No newline at end of file
+}
+
+/// @brief Read the new turns of the patients of this process
+/// @param source The rank of the process
+/// @param ar The archive of the message from the real queue
+void sti::proxy_queue_manager::read_responses(int /*unused*/, iarchive& ar)
+{
+    auto new_turns = std::vector<turn_type> {};
+    read_wires<turn_wire>(ar, new_turns);
+    _turns.insert(new_turns.begin(), new_turns.end());
+}
+
+/// @brief Get the heap bytes of the turns and the requests
+std::size_t sti::proxy_queue_manager::memory_bytes() const
+{
+    return memory::bytes(_turns) + memory::bytes(_to_enqueue) + memory::bytes(_to_dequeue);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the turns and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_queue_manager::save_state(oarchive& ar) const
+{
+    ar << _turns;
+    ar << _to_enqueue;
+    ar << _to_dequeue;
+}
+
+/// @brief Read the turns and the requests not yet exchanged
+/// @param ar The archive of the checkpoint
+void sti::proxy_queue_manager::load_state(iarchive& ar)
+{
+    ar >> _turns;
+    ar >> _to_enqueue;
+    ar >> _to_dequeue;
+}
@@ -4,6 +4,8 @@
 
 #include <boost/mpi/communicator.hpp>
 #include <queue>
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
 
 #include "../queue_manager.hpp"
 
@@ -38,14 +40,46 @@ public:
     /// @return If the agent is in the front of the queue, the coordinates
     boost::optional<coordinates<double>> is_my_turn(const agent_id& id) override;
 
-    /// @brief Synchronize the real queue and the remote queues
-    void sync() override;
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Check if there are enqueues or dequeues since the last exchange
+    /// @param destination The rank of the process
+    bool pending_requests(int destination) const override;
+
+    /// @brief Write the enqueues and dequeues since the last exchange
+    /// @param destination The rank of the process
+    /// @param ar The archive of the message to the real queue
+    void write_requests(int destination, oarchive& ar) override;
+
+    /// @brief Read the new turns of the patients of this process
+    /// @param source The rank of the process
+    /// @param ar The archive of the message from the real queue
+    void read_responses(int source, iarchive& ar) override;
+
+    /// @brief Get the heap bytes of the turns and the requests
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the turns and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the turns and the requests not yet exchanged
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     communicator_ptr _communicator;
     int              _tag;
     int              _real_rank;
-    front_type       _boxes;
+
+    // The box assigned to the patients of this process with a turn
+    std::unordered_map<agent_id, coordinates<double>, agent_key::hash> _turns;
 
     std::vector<agent_id> _to_enqueue;
     std::vector<agent_id> _to_dequeue;
@@ -1,13 +1,16 @@
-#include <algorithm>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/optional.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/unordered_map.hpp>
 #include <repast_hpc/AgentId.h>
 #include <vector>
 
 #include "real_queue_manager.hpp"
 
+#include "../manager_wire.hpp"
+#include "../memory_usage.hpp"
+
 /// @brief Construct a real queue display
 /// @param comm The MPI Communicator
 /// @param tag The MPI tag for the communication
@@ -36,6 +39,7 @@ sti::real_queue_manager::real_queue_manager(communicator_ptr
 void sti::real_queue_manager::enqueue(const agent_id& id)
 {
     _queue.push_back(id);
+    _owner[id] = _communicator->rank();
 }
 
 /// @brief Remove a patient from the queue
@@ -43,17 +47,17 @@ void sti::real_queue_manager::enqueue(const agent_id& id)
 void sti::real_queue_manager::dequeue(const agent_id& id)
 {
     // Search  for the patient in the assigned boxes
-    auto box_it = std::find_if(_boxes.begin(), _boxes.end(), [&](const auto& pair) {
-        return pair.second == id;
-    });
+    const auto box_it = _box_of.find(id);
 
-    if (box_it != _boxes.end()) {
+    if (box_it != _box_of.end()) {
         // If the patient is in a box, remove it
-        box_it->second = {};
+        _boxes.at(box_it->second) = {};
+        _box_of.erase(box_it);
     } else {
         // The patient is not in the boxes, is in the queue
-        _queue.remove(id);
+        _queue.erase(id);
     }
+    _owner.erase(id);
 }
 
 /// @brief Check if the given agent is next in the attention
@@ -62,71 +66,114 @@ void sti::real_queue_manager::dequeue(const agent_id& id)
 boost::optional<sti::coordinates<double>> sti::real_queue_manager::is_my_turn(const agent_id& id)
 {
     // Search for the patient in the box list
-    auto box_it = std::find_if(_boxes.begin(), _boxes.end(), [&](const auto& pair) {
-        return pair.second == id;
-    });
+    const auto box_it = _box_of.find(id);
 
-    if (box_it != _boxes.end()) {
-        return box_it->first;
+    if (box_it != _box_of.end()) {
+        return box_it->second;
     }
 
     return boost::none;
 }
 
-/// @brief Synchronize the real queue and the remote queues
-void sti::real_queue_manager::sync()
-{
-    const auto& my_rank    = _communicator->rank();
-    const auto& world_size = _communicator->size();
-    auto        mpi_tag    = _tag;
-
-    // Receive the new agents
-    auto to_enqueue = std::vector {
-        static_cast<std::size_t>(world_size),
-        std::vector<agent_id> {}
-    };
-
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != my_rank) {
-            _communicator->recv(p, mpi_tag, to_enqueue[static_cast<unsigned long>(p)]);
-        }
-    }
-    mpi_tag++;
+////////////////////////////////////////////////////////////////////////////
+// EXCHANGE
+////////////////////////////////////////////////////////////////////////////
 
-    // Receive the agent to remove
-    auto to_dequeue = std::vector {
-        static_cast<std::size_t>(world_size),
-        std::vector<agent_id> {}
-    };
+/// @brief Read the enqueues and dequeues of a proxy
+/// @param source The rank of the proxy
+/// @param ar The archive of the message from the proxy
+void sti::real_queue_manager::read_requests(int source, iarchive& ar)
+{
+    auto to_enqueue = std::vector<agent_id> {};
+    read_wires<agent_id_wire>(ar, to_enqueue);
+    read_wires<agent_id_wire>(ar, _to_dequeue);
 
-    for (auto p = 0; p < world_size; ++p) {
-        if (p != my_rank) {
-            _communicator->recv(p, mpi_tag, to_dequeue[static_cast<unsigned long>(p)]);
-        }
+    for (const auto& id : to_enqueue) {
+        _to_enqueue.emplace_back(source, id);
     }
-    mpi_tag++;
+}
+
+/// @brief Apply the requests of all the proxies and update the front
+void sti::real_queue_manager::serve()
+{
+    _new_turns.clear();
 
     // First insert the new ones, then remove
-    for (const auto& vector : to_enqueue) {
-        for (const auto& new_agent : vector) {
-            this->enqueue(new_agent);
-        }
+    for (const auto& [source, new_agent] : _to_enqueue) {
+        _queue.push_back(new_agent);
+        _owner[new_agent] = source;
     }
 
-    for (const auto& vector : to_dequeue) {
-        for (const auto& agent : vector) {
-            this->dequeue(agent);
-        }
+    for (const auto& agent : _to_dequeue) {
+        this->dequeue(agent);
     }
 
-    // Update the front
+    _to_enqueue.clear();
+    _to_dequeue.clear();
+
+    // Update the front, the process of each patient receives only its turns.
+    // The patients don't move while they wait, and the releases of a box are
+    // always a dequeue from the process of the patient, known by its proxy
+    const auto my_rank = _communicator->rank();
     for (auto& [box, patient] : _boxes) {
         if (!patient.is_initialized() && !_queue.empty()) {
-            patient = _queue.front();
+            patient           = _queue.front();
+            _box_of[*patient] = box;
             _queue.pop_front();
+
+            const auto owner = _owner.at(*patient);
+            if (owner != my_rank) _new_turns[owner].push_back({ *patient, box });
         }
     }
+}
 
-    // Broadcast the new front
-    boost::mpi::broadcast(*_communicator, _boxes, _communicator->rank());
+/// @brief Check if a proxy has patients with new turns
+/// @param destination The rank of the proxy
+bool sti::real_queue_manager::pending_responses(int destination) const
+{
+    return _new_turns.count(destination) != 0;
+}
+
+/// @brief Write the new turns of the patients of a proxy
+/// @param destination The rank of the proxy
+/// @param ar The archive of the message to the proxy
+void sti::real_queue_manager::write_responses(int destination, oarchive& ar)
+{
+    write_wires<turn_wire>(ar, _new_turns[destination]);
+}
+
+/// @brief Get the heap bytes of the queue, the front and the messages
+std::size_t sti::real_queue_manager::memory_bytes() const
+{
+    return _queue.memory_bytes()
+        + memory::bytes(_boxes)
+        + memory::bytes(_box_of)
+        + memory::bytes(_owner)
+        + memory::bytes(_to_enqueue)
+        + memory::bytes(_to_dequeue)
+        + memory::bytes(_new_turns);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the queue, the front and the owner of each patient
+/// @param ar The archive of the checkpoint
+void sti::real_queue_manager::save_state(oarchive& ar) const
+{
+    ar << _queue;
+    ar << _boxes;
+    ar << _box_of;
+    ar << _owner;
+}
+
+/// @brief Read the queue, the front and the owner of each patient
+/// @param ar The archive of the checkpoint
+void sti::real_queue_manager::load_state(iarchive& ar)
+{
+    ar >> _queue;
+    ar >> _boxes;
+    ar >> _box_of;
+    ar >> _owner;
 }
@@ -3,12 +3,16 @@
 #pragma once
 
 #include <boost/mpi/communicator.hpp>
-#include <list>
 #include <map>
 #include <optional>
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "../queue_manager.hpp"
 #include "../hospital_plan.hpp"
+#include "../indexed_queue.hpp"
+#include "../queue_manager.hpp"
 
 namespace sti {
 
@@ -41,15 +45,60 @@ public:
     /// @return If the agent is in the front of the queue, the coordinates
     boost::optional<coordinates<double>> is_my_turn(const agent_id& id) override;
 
-    /// @brief Synchronize the real queue and the remote queues
-    void sync() override;
+    ////////////////////////////////////////////////////////////////////////////
+    // EXCHANGE
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Read the enqueues and dequeues of a proxy
+    /// @param source The rank of the proxy
+    /// @param ar The archive of the message from the proxy
+    void read_requests(int source, iarchive& ar) override;
+
+    /// @brief Apply the requests of all the proxies and update the front
+    void serve() override;
+
+    /// @brief Check if a proxy has patients with new turns
+    /// @param destination The rank of the proxy
+    bool pending_responses(int destination) const override;
+
+    /// @brief Write the new turns of the patients of a proxy
+    /// @param destination The rank of the proxy
+    /// @param ar The archive of the message to the proxy
+    void write_responses(int destination, oarchive& ar) override;
+
+    /// @brief Get the heap bytes of the queue, the front and the messages
+    std::size_t memory_bytes() const override;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the queue, the front and the owner of each patient
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the queue, the front and the owner of each patient
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
-    communicator_ptr                                       _communicator;
-    int                                                    _tag;
-    std::list<agent_id>                                    _queue;
+    communicator_ptr                                         _communicator;
+    int                                                      _tag;
+    indexed_queue<agent_id, agent_key::hash>                 _queue;
     std::map<coordinates<double>, boost::optional<agent_id>> _boxes;
     // std::vector<coordinates<double>> _boxes;
+
+    // The box assigned to each patient in the front, and the process of
+    // each patient enqueued
+    std::unordered_map<agent_id, coordinates<double>, agent_key::hash> _box_of;
+    std::unordered_map<agent_id, int, agent_key::hash>                 _owner;
+
+    // Requests of the proxies, received in the current exchange
+    std::vector<std::pair<int, agent_id>> _to_enqueue;
+    std::vector<agent_id>                 _to_dequeue;
+
+    // The turns assigned in the current exchange, by process of the patient
+    std::map<int, std::vector<turn_type>> _new_turns;
 };
 
 } // namespace sti
\ No newline at end of file
@@ -57,8 +57,9 @@ boost::optional<sti::coordinates<double>> sti::reception::is_my_turn(const agent
     return _queue_manager->is_my_turn(id);
 }
 
-/// @brief Synchronize the queues between the process
-void sti::reception::sync()
+/// @brief Get the queue, to synchronize it between the processes
+/// @return A pointer to the queue
+sti::queue_manager* sti::reception::queues()
 {
-    _queue_manager->sync();
+    return _queue_manager.get();
 }
\ No newline at end of file
@@ -53,8 +53,9 @@ public:
     /// @return If the agent has a reception assigned, the reception location
     boost::optional<sti::coordinates<double>> is_my_turn(const agent_id& id);
 
-    /// @brief Synchronize the queues between the process
-    void sync();
+    /// @brief Get the queue, to synchronize it between the processes
+    /// @return A pointer to the queue
+    queue_manager* queues();
 
 private:
     std::unique_ptr<sti::queue_manager> _queue_manager;
@@ -0,0 +1,209 @@
+/// @file record_stream.cpp
+/// @brief Files written by a background thread while the simulation runs
+#include "record_stream.hpp"
+
+#include <boost/json/serialize.hpp>
+#include <iterator>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// ASYNC FILE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the file and start the writer thread
+/// @param path The path of the file
+/// @param buffer_size The size of the buffer handed to the writer, in bytes
+sti::async_file::async_file(const std::string& path, std::size_t buffer_size)
+    : _path { path }
+    , _file { path, std::ios::binary }
+    , _buffer_size { buffer_size }
+{
+    _buffer.reserve(_buffer_size);
+    _writer = std::thread { [this]() { write_loop(); } };
+}
+
+/// @brief Close the file, if not already closed
+sti::async_file::~async_file()
+{
+    close();
+}
+
+/// @brief Append data at the end of the file
+/// @param data The first byte
+/// @param size The number of bytes
+void sti::async_file::append(const void* data, std::size_t size)
+{
+    _buffer.append(static_cast<const char*>(data), size);
+    if (_buffer.size() >= _buffer_size) hand_off();
+}
+
+/// @brief Append a string at the end of the file
+/// @param data The string
+void sti::async_file::append(const std::string& data)
+{
+    append(data.data(), data.size());
+}
+
+/// @brief Wait until all the data appended is in the file
+void sti::async_file::flush()
+{
+    if (_closed) return;
+
+    if (!_buffer.empty()) hand_off();
+    auto lock = std::unique_lock { _mutex };
+    _changed.wait(lock, [this]() { return !_pending && !_writing; });
+
+    // The writer is idle until the lock is released
+    _file.flush();
+}
+
+/// @brief Write the remaining data, stop the writer and close the file
+void sti::async_file::close()
+{
+    if (_closed) return;
+    _closed = true;
+
+    if (!_buffer.empty()) hand_off();
+    {
+        const auto lock = std::lock_guard { _mutex };
+        _closing        = true;
+    }
+    _changed.notify_one();
+    _writer.join();
+
+    _file.close();
+}
+
+/// @brief Check if the file is already closed
+bool sti::async_file::closed() const
+{
+    return _closed;
+}
+
+/// @brief Get the path of the file
+const std::string& sti::async_file::path() const
+{
+    return _path;
+}
+
+/// @brief Get the heap bytes of the buffers
+/// @details The buffer being filled, and the one handed to the writer,
+/// counted as full
+std::size_t sti::async_file::memory_bytes() const
+{
+    return _buffer.capacity() + _buffer_size;
+}
+
+/// @brief Give the buffer to the writer, waiting if it's still busy
+void sti::async_file::hand_off()
+{
+    {
+        auto lock = std::unique_lock { _mutex };
+        _changed.wait(lock, [this]() { return !_pending; });
+        std::swap(_buffer, _handed);
+        _pending = true;
+    }
+    _changed.notify_one();
+
+    // The buffer got back from the writer is already empty
+    _buffer.clear();
+}
+
+/// @brief Body of the writer thread
+void sti::async_file::write_loop()
+{
+    auto writing = std::string {};
+    while (true) {
+        {
+            auto lock = std::unique_lock { _mutex };
+            _changed.wait(lock, [this]() { return _pending || _closing; });
+            if (!_pending) return;
+
+            // Keep the buffer of the previous write, to reuse its memory
+            writing.clear();
+            std::swap(writing, _handed);
+            _pending = false;
+            _writing = true;
+        }
+        _changed.notify_one();
+
+        _file.write(writing.data(), static_cast<std::streamsize>(writing.size()));
+        {
+            const auto lock = std::lock_guard { _mutex };
+            _writing        = false;
+        }
+        _changed.notify_all();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// JSON RECORD STREAM
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the file and start the writer thread
+/// @param path The path of the file
+/// @param buffer_size The size of the buffer handed to the writer, in bytes
+sti::json_record_stream::json_record_stream(const std::string& path, std::size_t buffer_size)
+    : _file { path, buffer_size }
+{
+    _file.append("[", 1);
+}
+
+/// @brief Close the file, if not already closed
+sti::json_record_stream::~json_record_stream()
+{
+    close();
+}
+
+/// @brief Add a record at the end of the array
+/// @param record The record
+void sti::json_record_stream::push(const boost::json::value& record)
+{
+    if (_records++ != 0) _file.append(",", 1);
+    _file.append(boost::json::serialize(record));
+}
+
+/// @brief Write the remaining records, close the array and the file
+void sti::json_record_stream::close()
+{
+    if (_file.closed()) return;
+    _file.append("]", 1);
+    _file.close();
+}
+
+/// @brief Get the number of records pushed
+std::size_t sti::json_record_stream::size() const
+{
+    return _records;
+}
+
+/// @brief Get the heap bytes of the buffers of the file
+std::size_t sti::json_record_stream::memory_bytes() const
+{
+    return _file.memory_bytes();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the records pushed so far, as written in the file
+/// @details Waits for the writer, and reads the file back
+std::string sti::json_record_stream::records() const
+{
+    _file.flush();
+
+    // Skip the opening bracket of the array
+    auto file = std::ifstream { _file.path(), std::ios::binary };
+    file.ignore(1);
+    return { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> {} };
+}
+
+/// @brief Continue the records of another stream, before any push()
+/// @param records The records, as returned by records()
+/// @param count The number of records
+void sti::json_record_stream::resume(const std::string& records, std::size_t count)
+{
+    _file.append(records);
+    _records = count;
+}
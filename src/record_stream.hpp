@@ -0,0 +1,153 @@
+/// @file record_stream.hpp
+/// @brief Files written by a background thread while the simulation runs
+#pragma once
+
+#include <boost/json/value.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sti {
+
+/// @brief A file written in fixed size chunks by a background thread
+/// @details The data is appended to a buffer, and when it's full the buffer
+/// is handed to a writer thread, so the simulation doesn't wait for the disk.
+/// Only the data not yet written is kept in memory.
+class async_file {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the file and start the writer thread
+    /// @param path The path of the file
+    /// @param buffer_size The size of the buffer handed to the writer, in bytes
+    async_file(const std::string& path, std::size_t buffer_size);
+
+    async_file(const async_file&) = delete;
+    async_file& operator=(const async_file&) = delete;
+
+    async_file(async_file&&) = delete;
+    async_file& operator=(async_file&&) = delete;
+
+    /// @brief Close the file, if not already closed
+    ~async_file();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Append data at the end of the file
+    /// @param data The first byte
+    /// @param size The number of bytes
+    void append(const void* data, std::size_t size);
+
+    /// @brief Append a string at the end of the file
+    /// @param data The string
+    void append(const std::string& data);
+
+    /// @brief Wait until all the data appended is in the file
+    void flush();
+
+    /// @brief Write the remaining data, stop the writer and close the file
+    void close();
+
+    /// @brief Check if the file is already closed
+    bool closed() const;
+
+    /// @brief Get the path of the file
+    const std::string& path() const;
+
+    /// @brief Get the heap bytes of the buffers
+    /// @details The buffer being filled, and the one handed to the writer,
+    /// counted as full
+    std::size_t memory_bytes() const;
+
+private:
+    /// @brief Give the buffer to the writer, waiting if it's still busy
+    void hand_off();
+
+    /// @brief Body of the writer thread
+    void write_loop();
+
+    std::string   _path;
+    std::ofstream _file;
+    std::size_t   _buffer_size;
+    bool          _closed {};
+
+    // Filled by the simulation, and handed to the writer when full
+    std::string _buffer;
+
+    // Shared with the writer thread
+    std::mutex              _mutex;
+    std::condition_variable _changed;
+    std::string             _handed;
+    bool                    _pending {};
+    bool                    _writing {};
+    bool                    _closing {};
+    std::thread             _writer;
+}; // class async_file
+
+/// @brief A file with a JSON array, written one record at a time
+/// @details The file is a valid JSON array once closed.
+class json_record_stream {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the file and start the writer thread
+    /// @param path The path of the file
+    /// @param buffer_size The size of the buffer handed to the writer, in bytes
+    json_record_stream(const std::string& path, std::size_t buffer_size = 1U << 16U);
+
+    json_record_stream(const json_record_stream&) = delete;
+    json_record_stream& operator=(const json_record_stream&) = delete;
+
+    json_record_stream(json_record_stream&&) = delete;
+    json_record_stream& operator=(json_record_stream&&) = delete;
+
+    /// @brief Close the file, if not already closed
+    ~json_record_stream();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add a record at the end of the array
+    /// @param record The record
+    void push(const boost::json::value& record);
+
+    /// @brief Write the remaining records, close the array and the file
+    void close();
+
+    /// @brief Get the number of records pushed
+    std::size_t size() const;
+
+    /// @brief Get the heap bytes of the buffers of the file
+    std::size_t memory_bytes() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the records pushed so far, as written in the file
+    /// @details Waits for the writer, and reads the file back
+    std::string records() const;
+
+    /// @brief Continue the records of another stream, before any push()
+    /// @param records The records, as returned by records()
+    /// @param count The number of records
+    void resume(const std::string& records, std::size_t count);
+
+private:
+    mutable async_file _file;
+    std::size_t        _records {};
+}; // class json_record_stream
+
+} // namespace sti
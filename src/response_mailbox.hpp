@@ -0,0 +1,113 @@
+/// @file response_mailbox.hpp
+/// @brief Responses of a manager waiting to be read by the agents
+#pragma once
+
+#include <boost/optional.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+
+#include "agent_key.hpp"
+#include "memory_usage.hpp"
+
+namespace sti {
+
+/// @brief Responses of a manager, indexed by the agent that made the request
+/// @details An agent has at most one request in flight, so each agent has at
+/// most one response, a newer one replaces it. The agents peek the response
+/// in the guards of the FSM and take it in the actions, both in constant time.
+template <typename T>
+class response_mailbox {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Store the response to the request of an agent
+    /// @param id The key of the agent
+    /// @param response The response
+    void put(const agent_key& id, const T& response)
+    {
+        _responses.insert_or_assign(id, response);
+    }
+
+    /// @brief Get the response of an agent, keeping it in the mailbox
+    /// @param id The key of the agent
+    boost::optional<T> peek(const agent_key& id) const
+    {
+        const auto it = _responses.find(id);
+        if (it == _responses.end()) return boost::none;
+        return it->second;
+    }
+
+    /// @brief Get the response of an agent, removing it from the mailbox
+    /// @param id The key of the agent
+    boost::optional<T> take(const agent_key& id)
+    {
+        const auto it = _responses.find(id);
+        if (it == _responses.end()) return boost::none;
+
+        auto response = boost::optional<T> { std::move(it->second) };
+        _responses.erase(it);
+        return response;
+    }
+
+    /// @brief Check if there are no responses
+    bool empty() const
+    {
+        return _responses.empty();
+    }
+
+    /// @brief Get the number of responses
+    std::size_t size() const
+    {
+        return _responses.size();
+    }
+
+    /// @brief Get the heap bytes of the responses
+    std::size_t memory_bytes() const
+    {
+        return memory::bytes(_responses);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SERIALIZATION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the agents and their responses
+    template <typename Archive>
+    void save(Archive& ar, const unsigned int /*unused*/) const
+    {
+        ar << _responses.size();
+        for (const auto& [id, response] : _responses) {
+            ar << id;
+            ar << response;
+        }
+    }
+
+    /// @brief Replace the responses by the ones written with save()
+    template <typename Archive>
+    void load(Archive& ar, const unsigned int /*unused*/)
+    {
+        _responses.clear();
+
+        auto size = std::size_t {};
+        ar >> size;
+        for (auto i = std::size_t { 0 }; i < size; ++i) {
+            auto id       = agent_key {};
+            auto response = T {};
+            ar >> id;
+            ar >> response;
+            _responses.emplace(id, response);
+        }
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+private:
+    std::unordered_map<agent_key, T, agent_key::hash> _responses;
+}; // class response_mailbox
+
+} // namespace sti
@@ -0,0 +1,107 @@
+/// @file rma_window.cpp
+/// @brief Counters shared by all the processes through an MPI RMA window
+#include "rma_window.hpp"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the window, collective
+/// @param comm The MPI communicator
+/// @param host The rank of the process holding the counters
+/// @param size The number of counters
+/// @param initial The initial value of the counters
+sti::rma_counters::rma_counters(boost::mpi::communicator* comm, int host, std::size_t size, value_type initial)
+    : _host { host }
+    , _size { size }
+    , _memory { nullptr }
+    , _window { MPI_WIN_NULL }
+{
+    const auto local = comm->rank() == host ? size : std::size_t { 0 };
+    MPI_Win_allocate(static_cast<MPI_Aint>(local * sizeof(value_type)),
+                     static_cast<int>(sizeof(value_type)),
+                     MPI_INFO_NULL,
+                     *comm,
+                     &_memory,
+                     &_window);
+
+    // The host fills its memory before any process can access it
+    if (local != 0) std::fill(_memory, _memory + local, initial);
+    comm->barrier();
+
+    MPI_Win_lock_all(0, _window);
+}
+
+/// @brief Free the window, collective
+sti::rma_counters::~rma_counters()
+{
+    MPI_Win_unlock_all(_window);
+    MPI_Win_free(&_window);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ATOMIC OPERATIONS
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Add to a counter
+/// @param index The counter
+/// @param value The value to add, can be negative
+/// @return The value before the addition
+sti::rma_counters::value_type sti::rma_counters::fetch_add(std::size_t index, value_type value)
+{
+    auto before = value_type {};
+    MPI_Fetch_and_op(&value, &before, MPI_INT32_T, _host, static_cast<MPI_Aint>(index), MPI_SUM, _window);
+    MPI_Win_flush(_host, _window);
+    return before;
+}
+
+/// @brief Replace a counter, if it has the expected value
+/// @param index The counter
+/// @param expected The value the counter must have
+/// @param desired The new value
+/// @return The value before the operation, equal to expected on success
+sti::rma_counters::value_type sti::rma_counters::compare_swap(std::size_t index, value_type expected, value_type desired)
+{
+    auto before = value_type {};
+    MPI_Compare_and_swap(&desired, &expected, &before, MPI_INT32_T, _host, static_cast<MPI_Aint>(index), _window);
+    MPI_Win_flush(_host, _window);
+    return before;
+}
+
+/// @brief Replace a counter
+/// @param index The counter
+/// @param value The new value
+void sti::rma_counters::store(std::size_t index, value_type value)
+{
+    auto before = value_type {};
+    MPI_Fetch_and_op(&value, &before, MPI_INT32_T, _host, static_cast<MPI_Aint>(index), MPI_REPLACE, _window);
+    MPI_Win_flush(_host, _window);
+}
+
+/// @brief Read a counter
+/// @param index The counter
+sti::rma_counters::value_type sti::rma_counters::load(std::size_t index) const
+{
+    auto value = value_type {};
+    MPI_Fetch_and_op(nullptr, &value, MPI_INT32_T, _host, static_cast<MPI_Aint>(index), MPI_NO_OP, _window);
+    MPI_Win_flush(_host, _window);
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// LAYOUT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the rank of the process holding the counters
+int sti::rma_counters::host() const
+{
+    return _host;
+}
+
+/// @brief Get the number of counters
+std::size_t sti::rma_counters::size() const
+{
+    return _size;
+}
@@ -0,0 +1,85 @@
+/// @file rma_window.hpp
+/// @brief Counters shared by all the processes through an MPI RMA window
+#pragma once
+
+#include <boost/mpi/communicator.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mpi.h>
+
+namespace sti {
+
+/// @brief Array of integers in the memory of one process, updated atomically by all
+/// @details The window is opened with a passive target epoch for its whole
+/// life, every operation is an MPI atomic followed by a flush, so its result
+/// is known when the call returns. The host process doesn't take part in the
+/// operations of the others, and uses the same calls on its own memory.
+class rma_counters {
+
+public:
+    using value_type = std::int32_t;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the window, collective
+    /// @param comm The MPI communicator
+    /// @param host The rank of the process holding the counters
+    /// @param size The number of counters
+    /// @param initial The initial value of the counters
+    rma_counters(boost::mpi::communicator* comm, int host, std::size_t size, value_type initial);
+
+    rma_counters(const rma_counters&) = delete;
+    rma_counters& operator=(const rma_counters&) = delete;
+
+    rma_counters(rma_counters&&) = delete;
+    rma_counters& operator=(rma_counters&&) = delete;
+
+    /// @brief Free the window, collective
+    ~rma_counters();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // ATOMIC OPERATIONS
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Add to a counter
+    /// @param index The counter
+    /// @param value The value to add, can be negative
+    /// @return The value before the addition
+    value_type fetch_add(std::size_t index, value_type value);
+
+    /// @brief Replace a counter, if it has the expected value
+    /// @param index The counter
+    /// @param expected The value the counter must have
+    /// @param desired The new value
+    /// @return The value before the operation, equal to expected on success
+    value_type compare_swap(std::size_t index, value_type expected, value_type desired);
+
+    /// @brief Replace a counter
+    /// @param index The counter
+    /// @param value The new value
+    void store(std::size_t index, value_type value);
+
+    /// @brief Read a counter
+    /// @param index The counter
+    value_type load(std::size_t index) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // LAYOUT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the rank of the process holding the counters
+    int host() const;
+
+    /// @brief Get the number of counters
+    std::size_t size() const;
+
+private:
+    int         _host;
+    std::size_t _size;
+    value_type* _memory; // Only in the host
+    MPI_Win     _window;
+}; // class rma_counters
+
+} // namespace sti
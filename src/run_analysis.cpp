@@ -0,0 +1,382 @@
+/// @file run_analysis.cpp
+/// @brief The summary of a simulation, computed from its result files
+#include "run_analysis.hpp"
+
+#include <algorithm>
+#include <boost/json.hpp>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <system_error>
+#include <unordered_set>
+
+#include "output_files.hpp"
+#include "output_tasks.hpp"
+
+namespace {
+
+/// @brief The results with agents or objects, as in utils/postprocess.py
+constexpr const char* result_names[] = { "agents", "exit", "icu_beds", "chairs", "staff", "morgue" };
+
+/// @brief The size of the blocks fed to the parser
+constexpr auto block_size = std::size_t { 1U << 16U };
+
+constexpr auto seconds_per_day = std::int64_t { 24 * 60 * 60 };
+
+/// @brief Get a string field of an object, empty if missing
+std::string string_field(const boost::json::object& object, const char* name)
+{
+    const auto* value = object.if_contains(name);
+    if (value == nullptr || !value->is_string()) return {};
+    return std::string { value->get_string() };
+}
+
+/// @brief Divide, nan without cases as pandas
+double ratio(double cases, double total)
+{
+    return total == 0 ? std::numeric_limits<double>::quiet_NaN() : cases / total;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Read the agents files of a simulation
+/// @throws analysis_read_error If a file can't be read or parsed
+/// @param folder The output folder of the simulation
+/// @param threads The threads parsing the files, 0 for one per hardware thread
+sti::run_analysis::run_analysis(const std::string& folder, unsigned threads)
+{
+    auto parts = std::vector<part> {};
+    for (const auto* name : result_names) {
+        const auto found = find_parts(folder, name);
+        parts.insert(parts.end(), found.begin(), found.end());
+    }
+
+    // The parts are parsed in parallel, and merged in order so the records
+    // don't depend on the threads
+    auto read  = std::vector<records_of_part>(parts.size());
+    auto tasks = output_tasks { threads };
+    tasks.run_chunks(parts.size(), [&](std::size_t /*chunk*/, std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) read[i] = read_part(parts[i]);
+    });
+
+    for (auto& r : read) {
+        std::move(r.humans.begin(), r.humans.end(), std::back_inserter(_humans));
+        std::move(r.objects.begin(), r.objects.end(), std::back_inserter(_objects));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of agents and objects read
+std::size_t sti::run_analysis::records() const
+{
+    return _humans.size() + _objects.size();
+}
+
+/// @brief Get the summary, in the columns of utils/validator.py
+std::vector<sti::run_analysis::metric> sti::run_analysis::summary() const
+{
+    // The sources of the infections
+    auto staff_ids    = std::unordered_set<std::string> {};
+    auto patient_ids  = std::unordered_set<std::string> {};
+    auto object_ids   = std::unordered_set<std::string> {};
+    auto object_cases = 0.0;
+    for (const auto& h : _humans) (h.patient ? patient_ids : staff_ids).insert(h.infection_id);
+    for (const auto& o : _objects) {
+        object_ids.insert(o.infection_id);
+        object_cases += static_cast<double>(o.infections);
+    }
+
+    auto patients        = 0.0;
+    auto infected        = 0.0;
+    auto doctor_patients = 0.0;
+    auto icu             = 0.0;
+    auto icu_infected    = 0.0;
+    auto icu_deaths      = 0.0;
+    auto icu_rejected    = 0.0;
+    auto by_staff        = 0.0;
+    auto by_objects      = 0.0;
+    auto by_patients     = 0.0;
+    auto by_icu          = 0.0;
+    auto chair_rejected  = 0.0;
+    auto out_of_time     = 0.0;
+    for (const auto& h : _humans) {
+        const auto is_infected = !h.infected_by.empty();
+        if (h.infected_by == "icu_environment") ++by_icu;
+        if (h.diagnosis == "icu") {
+            ++icu;
+            if (is_infected) ++icu_infected;
+            if (is_infected && h.last_state == "MORGUE") ++icu_deaths;
+        }
+        if (!h.patient) continue;
+
+        ++patients;
+        if (is_infected) ++infected;
+        if (h.diagnosis == "doctor") ++doctor_patients;
+        if (staff_ids.count(h.infected_by) != 0) ++by_staff;
+        if (object_ids.count(h.infected_by) != 0) ++by_objects;
+        if (patient_ids.count(h.infected_by) != 0) ++by_patients;
+        if (h.last_state == "WAIT_ICU") ++icu_rejected;
+        if (h.last_state.rfind("WAIT_CHAIR", 0) == 0) ++chair_rejected;
+        if (h.last_state == "NO_ATTENTION") ++out_of_time;
+    }
+
+    return {
+        { "total_patients", patients },
+        { "infected_patients", infected },
+        { "punctual_prevalence", ratio(infected, patients) },
+        { "icu_total_patients", icu },
+        { "icu_infected_patients", icu_infected },
+        { "icu_punctual_prevalence", ratio(icu_infected, icu) },
+        { "infected_patients_deaths_at_icu", icu_deaths },
+        { "icu_mortality_of_infected_patients", ratio(icu_deaths, icu_infected) },
+        { "total_infected_patients_by_personal", by_staff },
+        { "percentage_infected_patients_by_personal", ratio(by_staff, infected) },
+        { "total_infected_objects", object_cases },
+        { "total_infected_patients_by_objects", by_objects },
+        { "percentage_infected_patients_by_objects", ratio(by_objects, infected) },
+        { "total_infected_patients_by_patients", by_patients },
+        { "percentage_infected_patients_by_patients", ratio(by_patients, infected) },
+        { "total_infected_patients_by_icu", by_icu },
+        { "percentage_infected_patients_by_icu", ratio(by_icu, infected) },
+        { "icu_rejected_patients", icu_rejected },
+        { "percentage_of_rejections_at_icu", ratio(icu_rejected, icu) },
+        { "waiting_room_rejected_patients", chair_rejected },
+        { "percentage_of_rejections_at_waiting_room", ratio(chair_rejected, patients) },
+        { "out_of_time_patients", out_of_time },
+        { "percentage_of_out_of_time_patients", ratio(out_of_time, doctor_patients) }
+    };
+}
+
+/// @brief Write the summary as a CSV table of one row
+/// @param out The stream
+void sti::run_analysis::write_summary(std::ostream& out) const
+{
+    const auto metrics = summary();
+    for (auto i = std::size_t { 0 }; i < metrics.size(); ++i) out << (i == 0 ? "" : ",") << metrics[i].name;
+    out << "\n"
+        << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (auto i = std::size_t { 0 }; i < metrics.size(); ++i) out << (i == 0 ? "" : ",") << metrics[i].value;
+    out << "\n";
+}
+
+/// @brief Write the patients entering each day against a reference
+/// @details The reference is the admission_distribution column of
+/// utils/admission_reference.csv, the fraction of the patients entering
+/// each day, scaled to the patients of the simulation
+/// @throws analysis_read_error If the reference can't be read
+/// @param out The stream
+/// @param reference The path of the reference
+void sti::run_analysis::write_admissions(std::ostream& out, const std::string& reference) const
+{
+    const auto fractions = read_reference(reference, "admission_distribution");
+
+    auto entered = std::vector<std::uint64_t>(fractions.size(), 0U);
+    auto total   = 0.0;
+    for (const auto& h : _humans) {
+        if (!h.patient || h.entry_time < 0) continue;
+        const auto day = static_cast<std::size_t>(h.entry_time / seconds_per_day);
+        if (day >= entered.size()) entered.resize(day + 1, 0U);
+        ++entered[day];
+        ++total;
+    }
+
+    out << "day,patients,reference,difference\n"
+        << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (auto day = std::size_t { 0 }; day < entered.size(); ++day) {
+        const auto expected = day < fractions.size() ? fractions[day] * total : 0.0;
+        const auto patients = static_cast<double>(entered[day]);
+        out << day << "," << entered[day] << "," << expected << "," << patients - expected << "\n";
+    }
+}
+
+/// @brief Write the patients entering in each interval of the day against a reference
+/// @details The reference is the percentage column of
+/// utils/day_distribution_reference.csv, one row per interval, the
+/// intervals splitting the day in equal parts
+/// @throws analysis_read_error If the reference can't be read
+/// @param out The stream
+/// @param reference The path of the reference
+void sti::run_analysis::write_day_distribution(std::ostream& out, const std::string& reference) const
+{
+    const auto fractions = read_reference(reference, "percentage");
+    if (fractions.empty()) throw analysis_read_error {};
+
+    const auto intervals = static_cast<std::int64_t>(fractions.size());
+    const auto length    = std::max(std::int64_t { 1 }, seconds_per_day / intervals);
+    auto       entered   = std::vector<std::uint64_t>(fractions.size(), 0U);
+    auto       total     = 0.0;
+    for (const auto& h : _humans) {
+        if (!h.patient || h.entry_time < 0) continue;
+        const auto interval = std::min((h.entry_time % seconds_per_day) / length, intervals - 1);
+        ++entered[static_cast<std::size_t>(interval)];
+        ++total;
+    }
+
+    out << "interval,patients,fraction,reference,difference\n"
+        << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (auto interval = std::size_t { 0 }; interval < entered.size(); ++interval) {
+        const auto fraction = ratio(static_cast<double>(entered[interval]), total);
+        out << interval << "," << entered[interval] << "," << fraction << ","
+            << fractions[interval] << "," << fraction - fractions[interval] << "\n";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// READING
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Find the parts of a result of all the processes
+/// @details From the <name>.json file shared by all the processes, see
+/// output_files, or from the <name>.p<rank>.json files
+/// @param folder The output folder
+/// @param name The name of the result
+std::vector<sti::run_analysis::part> sti::run_analysis::find_parts(const std::string& folder, const std::string& name)
+{
+    auto       parts  = std::vector<part> {};
+    const auto shared = folder + "/" + name + ".json";
+    if (std::filesystem::exists(shared)) {
+        auto file = std::ifstream { shared, std::ios::binary };
+        auto line = std::string {};
+        if (!std::getline(file, line) || line + "\n" != output_files::shared_magic) throw analysis_read_error {};
+
+        // A line "@part rank=<rank> bytes=<bytes>" before the part of each process
+        while (std::getline(file, line)) {
+            const auto field = line.find("bytes=");
+            if (line.rfind("@part", 0) != 0 || field == std::string::npos) throw analysis_read_error {};
+
+            const auto bytes  = std::stoull(line.substr(field + 6));
+            const auto offset = static_cast<std::uint64_t>(file.tellg());
+            if (bytes > 0) parts.push_back({ shared, offset, bytes });
+            file.seekg(static_cast<std::streamoff>(offset + bytes));
+        }
+        return parts;
+    }
+
+    const auto prefix = name + ".p";
+    auto       error  = std::error_code {};
+    for (const auto& entry : std::filesystem::directory_iterator { folder, error }) {
+        const auto filename = entry.path().filename().string();
+        if (filename.rfind(prefix, 0) != 0 || entry.path().extension() != ".json") continue;
+
+        // Only <name>.p<rank>.json, not the results with a longer name
+        const auto rank = filename.substr(prefix.size(), filename.size() - prefix.size() - 5);
+        if (rank.empty() || !std::all_of(rank.begin(), rank.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) continue;
+
+        const auto bytes = static_cast<std::uint64_t>(entry.file_size());
+        if (bytes > 0) parts.push_back({ entry.path().string(), 0, bytes });
+    }
+    if (error) throw analysis_read_error {};
+
+    std::sort(parts.begin(), parts.end(), [](const part& a, const part& b) { return a.path < b.path; });
+    return parts;
+}
+
+/// @brief Parse a part, keeping only the fields of the summary
+/// @param p The part
+sti::run_analysis::records_of_part sti::run_analysis::read_part(const part& p)
+{
+    auto file = std::ifstream { p.path, std::ios::binary };
+    if (!file || !file.seekg(static_cast<std::streamoff>(p.offset))) throw analysis_read_error {};
+
+    // The document lives in a monotonic buffer, released at once after the
+    // fields are copied
+    auto parser = boost::json::stream_parser {};
+    parser.reset(boost::json::make_shared_resource<boost::json::monotonic_resource>());
+
+    auto block     = std::vector<char>(block_size);
+    auto remaining = p.bytes;
+    auto ec        = boost::json::error_code {};
+    while (remaining > 0) {
+        const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, block.size()));
+        if (!file.read(block.data(), static_cast<std::streamsize>(n))) throw analysis_read_error {};
+        parser.write(block.data(), n, ec);
+        if (ec) throw analysis_read_error {};
+        remaining -= n;
+    }
+    parser.finish(ec);
+    if (ec) throw analysis_read_error {};
+
+    const auto document = parser.release();
+    if (!document.is_array()) throw analysis_read_error {};
+
+    auto records = records_of_part {};
+    for (const auto& value : document.get_array()) {
+        if (!value.is_object()) continue;
+
+        // The agents have their infection in a field, the objects are their
+        // infection
+        const auto& agent     = value.get_object();
+        const auto* nested    = agent.if_contains("infection");
+        const auto& infection = nested != nullptr && nested->is_object() ? nested->get_object() : agent;
+        const auto  model     = string_field(infection, "infection_model");
+
+        if (model == "object") {
+            const auto* infections = infection.if_contains("infections");
+            records.objects.push_back({ string_field(infection, "infection_id"),
+                                        infections != nullptr && infections->is_array() ? infections->get_array().size() : 0U });
+        } else if (model == "human") {
+            auto h         = human_record {};
+            h.patient      = string_field(agent, "type") == "patient";
+            h.infection_id = string_field(infection, "infection_id");
+            h.infected_by  = string_field(infection, "infected_by");
+            h.last_state   = string_field(agent, "last_state");
+
+            const auto* diagnosis = agent.if_contains("diagnosis");
+            if (diagnosis != nullptr && diagnosis->is_object()) h.diagnosis = string_field(diagnosis->get_object(), "type");
+
+            const auto* entry = agent.if_contains("entry_time");
+            if (entry != nullptr && entry->is_int64()) h.entry_time = entry->get_int64();
+            if (entry != nullptr && entry->is_uint64()) h.entry_time = static_cast<std::int64_t>(entry->get_uint64());
+            records.humans.push_back(std::move(h));
+        }
+    }
+    return records;
+}
+
+/// @brief Read a column of a reference CSV file
+/// @throws analysis_read_error If the file or the column are missing
+/// @param path The path of the file
+/// @param column The name of the column
+std::vector<double> sti::run_analysis::read_reference(const std::string& path, const std::string& column)
+{
+    auto file = std::ifstream { path };
+    auto line = std::string {};
+    if (!file || !std::getline(file, line)) throw analysis_read_error {};
+
+    const auto split = [](const std::string& row) {
+        auto cells  = std::vector<std::string> {};
+        auto stream = std::istringstream { row };
+        auto cell   = std::string {};
+        while (std::getline(stream, cell, ',')) {
+            if (!cell.empty() && cell.back() == '\r') cell.pop_back();
+            cells.push_back(cell);
+        }
+        return cells;
+    };
+
+    const auto header = split(line);
+    const auto found  = std::find(header.begin(), header.end(), column);
+    if (found == header.end()) throw analysis_read_error {};
+    const auto index = static_cast<std::size_t>(found - header.begin());
+
+    auto values = std::vector<double> {};
+    while (std::getline(file, line)) {
+        const auto cells = split(line);
+        if (cells.empty()) continue;
+        if (index >= cells.size()) throw analysis_read_error {};
+        values.push_back(std::stod(cells[index]));
+    }
+    return values;
+}
@@ -0,0 +1,130 @@
+/// @file run_analysis.hpp
+/// @brief The summary of a simulation, computed from its result files
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace sti {
+
+/// @brief Error reading a result file of a simulation
+struct analysis_read_error : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: A result file of the simulation can't be read";
+    }
+};
+
+/// @brief The summary of a simulation, the tables of the validation scripts
+/// @details The agents files (agents, exit, icu_beds, chairs, staff and
+/// morgue) of all the processes, per process or shared (output.shared), are
+/// split in parts, one per process, parsed in parallel by the output tasks.
+/// Each part is fed to a streaming JSON parser in blocks, and only the fields
+/// of the summary are kept: the document of a part is released once read.
+///
+/// The rows are the same as the ones utils/validator.py computes with pandas,
+/// the ratios without cases are nan.
+class run_analysis {
+
+public:
+    /// @brief A value of the summary
+    struct metric {
+        std::string name;
+        double      value;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Read the agents files of a simulation
+    /// @throws analysis_read_error If a file can't be read or parsed
+    /// @param folder The output folder of the simulation
+    /// @param threads The threads parsing the files, 0 for one per hardware thread
+    run_analysis(const std::string& folder, unsigned threads);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of agents and objects read
+    std::size_t records() const;
+
+    /// @brief Get the summary, in the columns of utils/validator.py
+    std::vector<metric> summary() const;
+
+    /// @brief Write the summary as a CSV table of one row
+    /// @param out The stream
+    void write_summary(std::ostream& out) const;
+
+    /// @brief Write the patients entering each day against a reference
+    /// @details The reference is the admission_distribution column of
+    /// utils/admission_reference.csv, the fraction of the patients entering
+    /// each day, scaled to the patients of the simulation
+    /// @throws analysis_read_error If the reference can't be read
+    /// @param out The stream
+    /// @param reference The path of the reference
+    void write_admissions(std::ostream& out, const std::string& reference) const;
+
+    /// @brief Write the patients entering in each interval of the day against a reference
+    /// @details The reference is the percentage column of
+    /// utils/day_distribution_reference.csv, one row per interval, the
+    /// intervals splitting the day in equal parts
+    /// @throws analysis_read_error If the reference can't be read
+    /// @param out The stream
+    /// @param reference The path of the reference
+    void write_day_distribution(std::ostream& out, const std::string& reference) const;
+
+private:
+    /// @brief The fields of an agent used by the summary
+    struct human_record {
+        bool         patient {};
+        std::string  infection_id;
+        std::string  infected_by;
+        std::string  diagnosis;
+        std::string  last_state;
+        std::int64_t entry_time { -1 };
+    };
+
+    /// @brief The fields of an object used by the summary
+    struct object_record {
+        std::string infection_id;
+        std::size_t infections {};
+    };
+
+    /// @brief A part of a result file, the records of a process
+    struct part {
+        std::string   path;
+        std::uint64_t offset {};
+        std::uint64_t bytes {};
+    };
+
+    /// @brief The records read from a part
+    struct records_of_part {
+        std::vector<human_record>  humans;
+        std::vector<object_record> objects;
+    };
+
+    /// @brief Find the parts of a result of all the processes
+    /// @param folder The output folder
+    /// @param name The name of the result
+    static std::vector<part> find_parts(const std::string& folder, const std::string& name);
+
+    /// @brief Parse a part, keeping only the fields of the summary
+    /// @param p The part
+    static records_of_part read_part(const part& p);
+
+    /// @brief Read a column of a reference CSV file
+    /// @param path The path of the file
+    /// @param column The name of the column
+    static std::vector<double> read_reference(const std::string& path, const std::string& column);
+
+    std::vector<human_record>  _humans;
+    std::vector<object_record> _objects;
+}; // class run_analysis
+
+} // namespace sti
@@ -1,49 +1,92 @@
 #include "space_wrapper.hpp"
 
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
 #include <cmath>
 #include <repast_hpc/AgentId.h>
 #include <repast_hpc/Moore2DGridQuery.h>
 #include <repast_hpc/Point.h>
 #include <repast_hpc/Properties.h>
 #include <sstream>
+#include <tuple>
+#include <utility>
 
 #include "coordinates.hpp"
+#include "decomposition.hpp"
 #include "hospital_plan.hpp"
 #include "contagious_agent.hpp"
+#include "morton.hpp"
+#include "pathfinder.hpp"
 
 /// @brief Create a space wrapper
 /// @param building_plan The hospital plan
 /// @param props A repast properties object
 /// @param context The repast agent context
 /// @param comm The Boost.MPI communicator
-sti::space_wrapper::space_wrapper(sti::hospital_plan& building_plan, properties& props, agent_context& context, communicator* comm)
+/// @param interaction_radius The largest distance at which two agents interact
+sti::space_wrapper::space_wrapper(sti::hospital_plan& building_plan, properties& props, agent_context& context, communicator* comm, double interaction_radius)
+    : _pathfinder { building_plan.get_pathfinder() }
+    , _context { &context }
+    , _rank { comm->rank() }
+    , _index { static_cast<int>(building_plan.obstacles().width()),
+               static_cast<int>(building_plan.obstacles().height()) }
 {
 
-    const auto origin             = repast::Point<double> { 0, 0 };
-    const auto extent             = repast::Point<double> { static_cast<double>(building_plan.width()), static_cast<double>(building_plan.height()) };
+    // The grid can be padded around the building, to balance the processes
+    const auto split              = make_decomposition(building_plan, props, comm->size());
+    const auto origin             = repast::Point<double> { static_cast<double>(split.origin.x), static_cast<double>(split.origin.y) };
+    const auto extent             = repast::Point<double> { static_cast<double>(split.extent.x), static_cast<double>(split.extent.y) };
     const auto grid_dimensions    = repast::GridDimensions { origin, extent };
-    const auto process_dimensions = std::vector<int> { repast::strToInt(props.getProperty("x.process")),
-                                                       repast::strToInt(props.getProperty("y.process")) };
+    const auto process_dimensions = std::vector<int> { split.processes.x, split.processes.y };
+
+    // The ghosts only matter to the contacts, so the halo only needs to cover
+    // the interaction radius, or nothing if the sources are exchanged apart
+    const auto buffer = props.getProperty("space.ghosts") == "infectious"
+        ? 0
+        : static_cast<int>(std::ceil(interaction_radius));
 
     _discrete_space = new discrete_space {
         "ParallelAgentDiscreteSpace",
         grid_dimensions,
         process_dimensions,
-        2,
+        buffer,
         comm
     };
     _continuous_space = new continuous_space {
         "ParallelAgentContinuousSpace",
         grid_dimensions,
         process_dimensions,
-        0,
+        buffer,
         comm
     };
 
     context.addProjection(_discrete_space);
     context.addProjection(_continuous_space);
+
+    _query = std::make_unique<repast::Moore2DGridQuery<agent>>(_discrete_space);
+
+    // An agent closer than the buffer to the border is a ghost of a neighbour
+    const auto  local        = local_dimensions();
+    const auto& local_origin = local.origin();
+    const auto& local_extent = local.extents();
+    _interior_min            = continuous_point { local_origin.getX() + buffer, local_origin.getY() + buffer };
+    _interior_max            = continuous_point { local_origin.getX() + local_extent.getX() - buffer,
+                                                  local_origin.getY() + local_extent.getY() - buffer };
+
+    // The cells are offset by the origin of the grid, so the codes are non negative
+    _grid_origin = split.origin;
+    if (props.getProperty("agents.order") == "morton") {
+        const auto& period = props.getProperty("agents.order.period");
+        _order_period      = period.empty() ? 50U : std::max(1U, boost::lexical_cast<std::uint32_t>(period));
+    }
+
+    // No path is longer than the cells of the plan
+    _macro     = props.getProperty("walk.macro") == "true";
+    _max_route = building_plan.obstacles().width() * building_plan.obstacles().height();
 }
 
+sti::space_wrapper::~space_wrapper() = default;
+
 /// @brief Get the area simulated in this process
 /// @return The area simulated, consisting of an origin point an the extent
 repast::GridDimensions sti::space_wrapper::local_dimensions() const
@@ -51,16 +94,150 @@ repast::GridDimensions sti::space_wrapper::local_dimensions() const
     return _continuous_space->dimensions();
 }
 
+/// @brief Store the location of all the agents in the context
+/// @details After the snapshot, the location queries are a single hash
+/// lookup instead of a query to the Repast spaces, and the neighbour
+/// queries use a spatial index of the local and ghost agents. The agents
+/// moved through this wrapper keep the snapshot up to date, balance()
+/// discards it. After a move the neighbour queries go to the Repast spaces
+/// until rebuild_index()
+void sti::space_wrapper::snapshot()
+{
+    _snapshot.clear();
+    if (_order_period == 0) {
+        for (auto it = _context->begin(); it != _context->end(); ++it) snapshot_agent(&**it);
+    } else {
+        // The agents keep the last sorted order, the removed ones are skipped
+        // and the ones created since then go last, in the context order
+        if (_order_age++ % _order_period == 0) sort_order();
+        for (const auto& id : _order) {
+            auto* a = _context->getAgent(id);
+            if (a != nullptr) snapshot_agent(a);
+        }
+        if (_snapshot.size() != static_cast<agent_store::slot_type>(_context->size())) {
+            for (auto it = _context->begin(); it != _context->end(); ++it) {
+                if (_snapshot.find((**it).getId()) == agent_store::npos) snapshot_agent(&**it);
+            }
+        }
+    }
+    _snapshot_valid = true;
+    rebuild_index();
+}
+
+/// @brief Add an agent of the context to the snapshot
+/// @param a The agent
+void sti::space_wrapper::snapshot_agent(agent* a)
+{
+    const auto& id = a->getId();
+    if (!_static.empty()) {
+        const auto it = _static.find(id);
+        if (it != _static.end()) {
+            _snapshot.add(a, it->second, true);
+            return;
+        }
+    }
+    _continuous_space->getLocation(id, _continuous_buffer);
+    _snapshot.add(a, { _continuous_buffer.at(0), _continuous_buffer.at(1) }, id.currentRank() == _rank);
+}
+
+/// @brief Sort the agents of the context by the Morton code of their cell
+/// @details The consecutive agents of the act loop are close in the plan, so
+/// their neighbour queries, grid cells and paths are likely in the cache. The
+/// ties are broken by the id, the order only depends on the locations
+void sti::space_wrapper::sort_order()
+{
+    auto keys = std::vector<std::pair<std::uint64_t, repast::AgentId>> {};
+    keys.reserve(static_cast<std::size_t>(_context->size()));
+    for (auto it = _context->begin(); it != _context->end(); ++it) {
+        const auto& id    = (**it).getId();
+        const auto  fixed = _static.find(id);
+        const auto  point = [&]() {
+            if (fixed != _static.end()) return fixed->second;
+            _continuous_space->getLocation(id, _continuous_buffer);
+            return continuous_point { _continuous_buffer.at(0), _continuous_buffer.at(1) };
+        }();
+        keys.emplace_back(morton_code(point.discrete() - _grid_origin), id);
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const auto& lho, const auto& rho) {
+        const auto key = [](const auto& k) {
+            return std::make_tuple(k.first, k.second.startingRank(), k.second.agentType(), k.second.id());
+        };
+        return key(lho) < key(rho);
+    });
+
+    _order.clear();
+    for (const auto& [code, id] : keys) _order.push_back(id);
+}
+
+/// @brief Rebuild the spatial index from the snapshot
+void sti::space_wrapper::rebuild_index()
+{
+    _index.clear();
+    for (auto slot = agent_store::slot_type { 0 }; slot < _snapshot.size(); ++slot) {
+        auto* a = _snapshot.agent_at(slot);
+        if (a != nullptr) _index.add(a, _snapshot.location_at(slot));
+    }
+    _index.build();
+    _index_dirty = false;
+}
+
+/// @brief Get the agents of the snapshot, in dense slots
+/// @details Only valid after snapshot(), and until balance()
+const sti::agent_store& sti::space_wrapper::store() const
+{
+    return _snapshot;
+}
+
+/// @brief Store the new location of an agent in the snapshot, if valid
+/// @param id The id of the agent
+/// @param point The new location
+void sti::space_wrapper::update_snapshot(const repast::AgentId& id, const continuous_point& point)
+{
+    if (!_snapshot_valid) return;
+
+    // The agents created after the snapshot get a new slot
+    const auto slot = _snapshot.find(id);
+    if (slot != agent_store::npos) {
+        _snapshot.set_location(slot, point);
+    } else {
+        auto* a = _context->getAgent(id);
+        if (a != nullptr) _snapshot.add(a, point, id.currentRank() == _rank);
+    }
+    _index_dirty = true;
+}
+
+/// @brief Get the spatial index of the local and ghost agents
+/// @details Only valid after snapshot() or rebuild_index(), until the
+/// next move or balance()
+/// @throws stale_index If the agents changed since the last rebuild
+/// @return A reference to the index, checked to be up to date
+const sti::spatial_index& sti::space_wrapper::index() const
+{
+    if (!_snapshot_valid || _index_dirty) throw stale_index {};
+    return _index;
+}
+
 /// @brief Get the discrete location of an agent
 /// @param id The id of the agent
 /// @return The discrete (integral) location of the agent
 sti::space_wrapper::discrete_point sti::space_wrapper::get_discrete_location(const repast::AgentId& id) const
 {
-    auto buff = std::vector<int> {};
-    _discrete_space->getLocation(id, buff);
+    if (_snapshot_valid) {
+        const auto slot = _snapshot.find(id);
+        if (slot != agent_store::npos) return _snapshot.location_at(slot).discrete();
+    }
+    if (!_static.empty()) {
+        const auto it = _static.find(id);
+        if (it != _static.end()) return it->second.discrete();
+    }
+
+    // The patients query their location from several threads
+    thread_local auto buffer = std::vector<int> {};
+    _discrete_space->getLocation(id, buffer);
     return {
-        buff.at(0),
-        buff.at(1)
+        buffer.at(0),
+        buffer.at(1)
     };
 }
 
@@ -69,11 +246,21 @@ sti::space_wrapper::discrete_point sti::space_wrapper::get_discrete_location(con
 /// @return The continuous point of the agent
 sti::space_wrapper::continuous_point sti::space_wrapper::get_continuous_location(const repast::AgentId& id) const
 {
-    auto buff = std::vector<double> {};
-    _continuous_space->getLocation(id, buff);
+    if (_snapshot_valid) {
+        const auto slot = _snapshot.find(id);
+        if (slot != agent_store::npos) return _snapshot.location_at(slot);
+    }
+    if (!_static.empty()) {
+        const auto it = _static.find(id);
+        if (it != _static.end()) return it->second;
+    }
+
+    // The patients query their location from several threads
+    thread_local auto buffer = std::vector<double> {};
+    _continuous_space->getLocation(id, buffer);
     return {
-        buff.at(0),
-        buff.at(1)
+        buffer.at(0),
+        buffer.at(1)
     };
 }
 
@@ -84,26 +271,46 @@ sti::space_wrapper::continuous_point sti::space_wrapper::get_continuous_location
 std::vector<sti::space_wrapper::agent*> sti::space_wrapper::agents_around(continuous_point p,
                                                                           double           r) const
 {
+    auto buf = std::vector<agent*> {};
+    agents_around(p, r, buf);
+    return buf;
+}
+
+/// @brief Get the agents around a certain point of the map
+/// @param p The center of the circle
+/// @param r The radius of the circle
+/// @param out Output buffer, cleared and filled with the agents inside the circle
+void sti::space_wrapper::agents_around(continuous_point     p,
+                                       double               r,
+                                       std::vector<agent*>& out) const
+{
 
     const auto cell  = p.discrete();
     const auto range = static_cast<int>(std::ceil(r));
 
+    out.clear();
+
+    // With an up to date index, scan its buckets
+    if (_snapshot_valid && !_index_dirty) {
+        _index.for_each_around(cell, range, [&](agent* a, const continuous_point& loc) {
+            const auto [x, y] = loc - p;
+            if (!(x * x + y * y > r)) out.push_back(a);
+        });
+        return;
+    }
+
     // Coarse search
-    auto buf   = std::vector<agent*> {};
-    auto query = repast::Moore2DGridQuery<agent> { _discrete_space };
-    query.query(cell, range, true, buf);
+    _query->query(cell, range, true, out);
 
     // Fine search
-    buf.erase(std::remove_if(buf.begin(),
-                             buf.end(),
+    out.erase(std::remove_if(out.begin(),
+                             out.end(),
                              [&](const auto& agent) {
                                  const auto loc = get_continuous_location(agent->getId());
                                  const auto d   = _continuous_space->getDistanceSq(p, loc);
                                  return d > r;
                              }),
-              buf.end());
-
-    return buf;
+              out.end());
 }
 
 /// @brief Get the agents located in a specific cell
@@ -111,13 +318,26 @@ std::vector<sti::space_wrapper::agent*> sti::space_wrapper::agents_around(contin
 /// @return A vector containing the agents in that cell
 std::vector<sti::space_wrapper::agent*> sti::space_wrapper::agents_in_cell(const discrete_point& c) const
 {
-    auto buf   = std::vector<agent*> {};
-    auto query = repast::Moore2DGridQuery<agent> { _discrete_space };
-    query.query(c, 0, true, buf);
-
+    auto buf = std::vector<agent*> {};
+    agents_in_cell(c, buf);
     return buf;
 }
 
+/// @brief Get the agents located in a specific cell
+/// @param c The cell to query
+/// @param out Output buffer, cleared and filled with the agents in that cell
+void sti::space_wrapper::agents_in_cell(const discrete_point& c, std::vector<agent*>& out) const
+{
+    out.clear();
+    if (_snapshot_valid && !_index_dirty) {
+        _index.for_each_around(c, 0, [&](agent* a, const continuous_point& /*unused*/) {
+            out.push_back(a);
+        });
+        return;
+    }
+    _query->query(c, 0, true, out);
+}
+
 /// @brief Move the agent towards a certain cell
 /// @param id The id of the agent
 /// @param cell The discrete point/cell to move to
@@ -138,14 +358,7 @@ sti::space_wrapper::continuous_point sti::space_wrapper::move_towards(const repa
 /// @return The agent new effective location
 sti::space_wrapper::continuous_point sti::space_wrapper::move_towards(const repast::AgentId& id, const continuous_point& point, space_unit d)
 {
-    const auto agent_pt = [&]() {
-        auto buf = std::vector<double> {};
-        _continuous_space->getLocation(id, buf);
-        return coordinates<double> {
-            buf.at(0),
-            buf.at(1)
-        };
-    }();
+    const auto agent_pt = get_continuous_location(id);
 
     // Calculate the distance in each axis
     const auto diff_vector = point - agent_pt;
@@ -180,8 +393,11 @@ sti::space_wrapper::continuous_point sti::space_wrapper::move_to(const repast::A
 
     const auto cell = point.discrete();
 
+    track_border(id, point);
     _discrete_space->moveTo(id, cell);
     _continuous_space->moveTo(id, point);
+    update_snapshot(id, point);
+    ++_changes;
 
     return point;
 }
@@ -196,30 +412,273 @@ sti::space_wrapper::continuous_point sti::space_wrapper::move_to(const repast::A
 {
     auto point = cell.continuous();
 
+    track_border(id, point);
     _discrete_space->moveTo(id, cell);
     _continuous_space->moveTo(id, point);
+    update_snapshot(id, point);
+    ++_changes;
 
     return point;
 }
 
+/// @brief Move the agent to a point in the cell it already is
+/// @details Only the continuous projection is written
+/// @param id The id of the agent
+/// @param point The new location
+void sti::space_wrapper::move_within_cell(const repast::AgentId& id, const continuous_point& point)
+{
+    track_border(id, point);
+    _continuous_space->moveTo(id, point);
+    update_snapshot(id, point);
+    ++_changes;
+}
+
+/// @brief Enqueue an agent to walk towards a destination
+/// @details The agent is not moved until walk() is called, this allows
+/// resolving the paths of all the walking agents in a single batch
+/// @param id The id of the agent
+/// @param destination The final destination of the agent
+/// @param d The distance the agent can walk
+void sti::space_wrapper::enqueue_walk(const repast::AgentId& id, const continuous_point& destination, space_unit d)
+{
+    _walkers.push_back({ id, {}, destination, d, false, {} });
+}
+
+/// @brief Move all the agents enqueued with enqueue_walk()
+/// @details The agents follow the path returned by the pathfinder until
+/// they run out of distance or reach their destination. The next cell of
+/// all the agents is resolved with a single query per step, and the final
+/// location is written to both projections once per agent. In macro mode
+/// the next cell is read from the route of the agent instead, and the
+/// discrete projection is only written when the agent changes cell
+/// @throws no_path If one of the agents can't reach its destination
+void sti::space_wrapper::walk()
+{
+    const auto keeps_walking = [](const walker& w) {
+        return w.movement_left > 0.0 && w.location != w.destination;
+    };
+
+    // Read the initial location of all the agents
+    _active.clear();
+    for (auto i = std::size_t { 0 }; i < _walkers.size(); ++i) {
+        auto& w    = _walkers[i];
+        w.location = get_continuous_location(w.id);
+        w.from     = w.location.discrete();
+        if (keeps_walking(w)) _active.push_back(i);
+    }
+    if (_macro) walk_routes();
+
+    // Advance all the agents one cell per iteration, the arithmetic is the
+    // same as move_towards()
+    while (!_active.empty()) {
+        _starts.clear();
+        _goals.clear();
+        for (const auto i : _active) {
+            _starts.push_back(_walkers[i].location.discrete());
+            _goals.push_back(_walkers[i].destination.discrete());
+        }
+        _pathfinder->next_steps(_starts, _goals, _steps);
+
+        auto still_active = std::size_t { 0 };
+        for (auto k = std::size_t { 0 }; k < _active.size(); ++k) {
+            auto&      w      = _walkers[_active[k]];
+            const auto target = _steps[k].continuous();
+
+            auto [x, y]       = target - w.location;
+            const auto length = std::sqrt(x * x + y * y);
+            const auto d      = std::min(w.movement_left, length);
+
+            auto new_location = target;
+            if (d != 0.0) {
+                x *= d / length;
+                y *= d / length;
+                new_location = w.location + sti::coordinates<double> { x, y };
+                w.moved      = true;
+            }
+
+            w.movement_left -= sti::sq_distance(new_location, w.location);
+            w.location = new_location;
+            if (keeps_walking(w)) _active[still_active++] = _active[k];
+        }
+        _active.resize(still_active);
+    }
+
+    // Write the final locations
+    for (const auto& w : _walkers) {
+        if (!w.moved) continue;
+        if (_macro && w.location.discrete() == w.from) {
+            move_within_cell(w.id, w.location);
+        } else {
+            move_to(w.id, w.location);
+        }
+    }
+    _walkers.clear();
+}
+
+/// @brief Advance the active walkers along their routes, in macro mode
+/// @details The arithmetic is the same as walk(), and the cells of a route
+/// are the ones next_step() returns, so the agents make the same moves
+void sti::space_wrapper::walk_routes()
+{
+    ++_walks;
+    for (const auto i : _active) {
+        auto&      w    = _walkers[i];
+        const auto goal = w.destination.discrete();
+        auto&      r    = _routes[w.id];
+        r.walk          = _walks;
+
+        while (w.movement_left > 0.0 && w.location != w.destination) {
+            const auto target = route_step(r, w.location.discrete(), goal).continuous();
+
+            auto [x, y]       = target - w.location;
+            const auto length = std::sqrt(x * x + y * y);
+            const auto d      = std::min(w.movement_left, length);
+
+            auto new_location = target;
+            if (d != 0.0) {
+                x *= d / length;
+                y *= d / length;
+                new_location = w.location + sti::coordinates<double> { x, y };
+                w.moved      = true;
+            }
+
+            w.movement_left -= sti::sq_distance(new_location, w.location);
+            w.location = new_location;
+        }
+        if (w.location == w.destination) _routes.erase(w.id);
+    }
+    _active.clear();
+
+    // Forget the routes of the agents that stopped walking or left the process
+    for (auto it = _routes.begin(); it != _routes.end();) {
+        it = it->second.walk == _walks ? std::next(it) : _routes.erase(it);
+    }
+}
+
+/// @brief Get the next cell of a route, searching it again if needed
+/// @details The route is searched when the walk starts, when its goal
+/// changes, or when the agent leaves it
+/// @throws no_path If the agent can't reach the goal
+/// @param r The route
+/// @param cell The cell of the agent
+/// @param goal The goal of the walk
+sti::space_wrapper::discrete_point sti::space_wrapper::route_step(route& r, const discrete_point& cell, const discrete_point& goal)
+{
+    // The agent is in the cell of the route it was, or entered the next one
+    auto follows = r.goal == goal && r.at < r.cells.size();
+    if (follows && r.cells[r.at] != cell) {
+        follows = r.at + 1 < r.cells.size() && r.cells[r.at + 1] == cell;
+        if (follows) ++r.at;
+    }
+    if (follows && r.at + 1 == r.cells.size() && cell != goal) follows = false;
+
+    if (!follows) {
+        r.goal = goal;
+        r.at   = 0;
+        r.cells.clear();
+        r.cells.push_back(cell);
+        while (r.cells.back() != goal && r.cells.size() <= _max_route) r.cells.push_back(_pathfinder->next_step(r.cells.back(), goal));
+    }
+
+    // In the goal cell the agent still walks to the exact destination
+    if (r.at + 1 < r.cells.size()) return r.cells[r.at + 1];
+    return _pathfinder->next_step(goal, goal);
+}
+
 /// @brief Remove the given agent from the space
 /// @param agent The agent to remove
 void sti::space_wrapper::remove_agent(contagious_agent* agent)
 {
+    _snapshot.remove(agent->getId());
+    _index_dirty = true;
+    ++_changes;
+
+    // The static agents are only in this wrapper
+    if (_static.erase(agent->getId()) != 0) return;
     _discrete_space->removeAgent(agent);
     _continuous_space->removeAgent(agent);
+    ++_border_changes;
+}
+
+/// @brief Take an agent that never moves out of the Repast spaces
+/// @details The agent keeps its location in this wrapper and stays in the
+/// snapshot and the index, but Repast neither balances it nor copies it
+/// as a ghost to the other processes, see static_registry. Only for local
+/// agents, before they are synchronized
+/// @param agent The agent, already placed
+void sti::space_wrapper::make_static(contagious_agent* agent)
+{
+    const auto& id    = agent->getId();
+    const auto  point = get_continuous_location(id);
+    _static[id]       = point;
+    _discrete_space->removeAgent(agent);
+    _continuous_space->removeAgent(agent);
+    ++_changes;
+}
+
+/// @brief Check if an agent was taken out of the Repast spaces
+/// @param id The id of the agent
+bool sti::space_wrapper::is_static(const repast::AgentId& id) const
+{
+    return !_static.empty() && _static.count(id) != 0;
+}
+
+/// @brief Make room in the snapshot for agents about to be created
+/// @param n The number of agents
+void sti::space_wrapper::reserve(std::size_t n)
+{
+    if (_snapshot_valid) _snapshot.reserve(_snapshot.size() + n);
 }
 
 /// @brief Synchronize the agents between the processes
 void sti::space_wrapper::balance()
 {
+    // The agents can change process, the snapshot is no longer valid
+    _snapshot_valid = false;
     _discrete_space->balance();
 }
 
-/// @brief Calculate the distance between two continuous points
-/// @return The distance between the points
-double sti::sq_distance(const space_wrapper::continuous_point& lho, const space_wrapper::continuous_point& rho)
+/// @brief Get the number of times the local agents were placed, moved or
+/// removed, to detect the ticks where the spaces don't change
+std::uint64_t sti::space_wrapper::changes() const
+{
+    return _changes;
+}
+
+/// @brief Get the number of times an agent was created, removed, or moved
+/// from or to a cell near the border of the process
+/// @details An agent far from the border is not in the ghost layer of any
+/// process nor leaves this one, if no process has one of these changes the
+/// Repast status and projection synchronizations have nothing to send
+std::uint64_t sti::space_wrapper::border_changes() const
+{
+    return _border_changes;
+}
+
+/// @brief Count a move if the agent is new, or starts or ends near the border
+/// @param id The id of the agent, before moving it
+/// @param point The new location
+void sti::space_wrapper::track_border(const repast::AgentId& id, const continuous_point& point)
+{
+    if (near_border(point)) {
+        ++_border_changes;
+        return;
+    }
+
+    // The snapshot has the previous location of most agents, the ones just
+    // created have no location in the spaces
+    const auto slot = _snapshot_valid ? _snapshot.find(id) : agent_store::npos;
+    if (slot != agent_store::npos) {
+        if (near_border(_snapshot.location_at(slot))) ++_border_changes;
+    } else if (!_continuous_space->getLocation(id, _continuous_buffer)
+               || near_border({ _continuous_buffer.at(0), _continuous_buffer.at(1) })) {
+        ++_border_changes;
+    }
+}
+
+/// @brief Check if a point is out of the cells far from the border
+bool sti::space_wrapper::near_border(const continuous_point& point) const
 {
-    const auto diff = lho - rho;
-    return sqrt(diff.x * diff.x + diff.y * diff.y);
+    return point.x < _interior_min.x || point.y < _interior_min.y
+        || point.x >= _interior_max.x || point.y >= _interior_max.y;
 }
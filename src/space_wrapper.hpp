@@ -4,12 +4,19 @@
 
 #include <boost/mpi/communicator.hpp>
 #include <cstdint>
+#include <exception>
+#include <memory>
+#include <repast_hpc/AgentId.h>
 #include <repast_hpc/SharedContext.h>
 #include <repast_hpc/SharedContinuousSpace.h>
 #include <repast_hpc/SharedDiscreteSpace.h>
+#include <unordered_map>
 #include <vector>
 
+#include "agent_locations.hpp"
+#include "agent_store.hpp"
 #include "coordinates.hpp"
+#include "spatial_index.hpp"
 
 // Forward declarations of repast classes
 namespace repast {
@@ -17,6 +24,8 @@ namespace repast {
 class Properties;
 class AgentId;
 class GridDimensions;
+template <typename T>
+class Moore2DGridQuery;
 }
 
 namespace sti {
@@ -24,9 +33,18 @@ namespace sti {
 // Forward declarations
 class hospital_plan;
 class contagious_agent;
+class pathfinder;
+
+/// @brief The spatial index was requested after a change of the agents
+struct stale_index : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The spatial index is stale, call rebuild_index() after the agents move";
+    }
+};
 
 /// @brief A space wrapper
-class space_wrapper {
+class space_wrapper final : public agent_locations {
 
 public:
     using agent            = contagious_agent;
@@ -46,11 +64,27 @@ public:
     ////////////////////////////////////////////////////////////////////////////
 
     /// @brief Create a space wrapper
+    /// @details The ghost layer of both Repast spaces is as wide as the
+    /// interaction radius, rounded up. With space.ghosts = infectious the
+    /// spaces have no ghosts, and the contacts between processes are left to
+    /// a source_exchange. With agents.order = morton the snapshot stores the
+    /// agents sorted by the Morton code of their cell, sorted again every
+    /// agents.order.period snapshots (50 by default). With walk.macro = true
+    /// the walking agents follow the route computed when they start walking
     /// @param building_plan The hospital plan
     /// @param props A repast properties object
     /// @param context The repast agent context
     /// @param comm The Boost.MPI communicator
-    space_wrapper(sti::hospital_plan& building_plan, properties& props, agent_context& context, communicator* comm);
+    /// @param interaction_radius The largest distance at which two agents interact
+    space_wrapper(sti::hospital_plan& building_plan, properties& props, agent_context& context, communicator* comm, double interaction_radius);
+
+    space_wrapper(const space_wrapper&) = delete;
+    space_wrapper& operator=(const space_wrapper&) = delete;
+
+    space_wrapper(space_wrapper&&) = delete;
+    space_wrapper& operator=(space_wrapper&&) = delete;
+
+    ~space_wrapper();
 
     ////////////////////////////////////////////////////////////////////////////
     // BEHAVIOUR
@@ -60,15 +94,42 @@ public:
     /// @return The area simulated, consisting of an origin point an the extent
     repast::GridDimensions local_dimensions() const;
 
+    /// @brief Store the location of all the agents in the context
+    /// @details After the snapshot, the location queries are a single hash
+    /// lookup instead of a query to the Repast spaces, and the neighbour
+    /// queries use a spatial index of the local and ghost agents. The agents
+    /// moved through this wrapper keep the snapshot up to date, balance()
+    /// discards it. After a move the neighbour queries go to the Repast spaces
+    /// until rebuild_index()
+    void snapshot();
+
+    /// @brief Get the agents of the snapshot, in dense slots
+    /// @details Only valid after snapshot(), and until balance()
+    const agent_store& store() const;
+
+    /// @brief Rebuild the spatial index from the snapshot
+    /// @details The moves, creations and removals after snapshot() leave the
+    /// index stale; the queries never rebuild it, so they stay read only
+    /// under threads. The model calls this once per tick, after the phases
+    /// that change the population and before the contacts
+    void rebuild_index();
+
+    /// @brief Get the spatial index of the local and ghost agents
+    /// @details Only valid after snapshot() or rebuild_index(), until the
+    /// next move or balance()
+    /// @throws stale_index If the agents changed since the last rebuild
+    /// @return A reference to the index, checked to be up to date
+    const spatial_index& index() const;
+
     /// @brief Get the discrete location of an agent
     /// @param id The id of the agent
     /// @return The discrete (integral) location of the agent
-    discrete_point get_discrete_location(const repast::AgentId& id) const;
+    discrete_point get_discrete_location(const repast::AgentId& id) const override;
 
     /// @brief Get the continuous location of an agent
     /// @param id The id of the agent
     /// @return The continuous point of the agent
-    continuous_point get_continuous_location(const repast::AgentId& id) const;
+    continuous_point get_continuous_location(const repast::AgentId& id) const override;
 
     /// @brief Get the agents around a certain point of the map
     /// @param p The center of the circle
@@ -76,11 +137,22 @@ public:
     /// @return A vector containing the agents inside the circle
     std::vector<agent*> agents_around(continuous_point p, double r) const;
 
+    /// @brief Get the agents around a certain point of the map
+    /// @param p The center of the circle
+    /// @param r The radius of the circle
+    /// @param out Output buffer, cleared and filled with the agents inside the circle
+    void agents_around(continuous_point p, double r, std::vector<agent*>& out) const;
+
     /// @brief Get the agents located in a specific cell
     /// @param c The cell to query
     /// @return A vector containing the agents in that cell
     std::vector<agent*> agents_in_cell(const discrete_point& c) const;
 
+    /// @brief Get the agents located in a specific cell
+    /// @param c The cell to query
+    /// @param out Output buffer, cleared and filled with the agents in that cell
+    void agents_in_cell(const discrete_point& c, std::vector<agent*>& out) const;
+
     /// @brief Move the agent towards a certain cell
     /// @param id The id of the agent
     /// @param cell The discrete point/cell to move to
@@ -109,20 +181,164 @@ public:
     /// @return The agent new effective location
     continuous_point move_to(const repast::AgentId& id, const discrete_point& cell);
 
+    /// @brief Enqueue an agent to walk towards a destination
+    /// @details The agent is not moved until walk() is called, this allows
+    /// resolving the paths of all the walking agents in a single batch
+    /// @param id The id of the agent
+    /// @param destination The final destination of the agent
+    /// @param d The distance the agent can walk
+    void enqueue_walk(const repast::AgentId& id, const continuous_point& destination, space_unit d);
+
+    /// @brief Move all the agents enqueued with enqueue_walk()
+    /// @details The agents follow the path returned by the pathfinder until
+    /// they run out of distance or reach their destination. The next cell of
+    /// all the agents is resolved with a single query per step, and the final
+    /// location is written to both projections once per agent. In macro mode
+    /// the next cell is read from the route of the agent instead, and the
+    /// discrete projection is only written when the agent changes cell
+    /// @throws no_path If one of the agents can't reach its destination
+    void walk();
+
     /// @brief Remove the given agent from the space
     /// @param agent The agent to remove
     void remove_agent(contagious_agent* agent);
 
+    /// @brief Take an agent that never moves out of the Repast spaces
+    /// @details The agent keeps its location in this wrapper and stays in the
+    /// snapshot and the index, but Repast neither balances it nor copies it
+    /// as a ghost to the other processes, see static_registry. Only for local
+    /// agents, before they are synchronized
+    /// @param agent The agent, already placed
+    void make_static(contagious_agent* agent);
+
+    /// @brief Check if an agent was taken out of the Repast spaces
+    /// @param id The id of the agent
+    bool is_static(const repast::AgentId& id) const;
+
+    /// @brief Make room in the snapshot for agents about to be created
+    /// @param n The number of agents
+    void reserve(std::size_t n);
+
     /// @brief Synchronize the agents between the processes
     void balance();
 
+    /// @brief Get the number of times the local agents were placed, moved or
+    /// removed, to detect the ticks where the spaces don't change
+    std::uint64_t changes() const;
+
+    /// @brief Get the number of times an agent was created, removed, or moved
+    /// from or to a cell near the border of the process
+    /// @details An agent far from the border is not in the ghost layer of any
+    /// process nor leaves this one, if no process has one of these changes the
+    /// Repast status and projection synchronizations have nothing to send
+    std::uint64_t border_changes() const;
+
 private:
+    /// @brief Add an agent of the context to the snapshot
+    /// @param a The agent
+    void snapshot_agent(agent* a);
+
+    /// @brief Sort the agents of the context by the Morton code of their cell
+    void sort_order();
+
+    /// @brief Store the new location of an agent in the snapshot, if valid
+    /// @param id The id of the agent
+    /// @param point The new location
+    void update_snapshot(const repast::AgentId& id, const continuous_point& point);
+
+    /// @brief Count a move if the agent is new, or starts or ends near the border
+    /// @param id The id of the agent, before moving it
+    /// @param point The new location
+    void track_border(const repast::AgentId& id, const continuous_point& point);
+
+    /// @brief Check if a point is out of the cells far from the border
+    bool near_border(const continuous_point& point) const;
+
+    /// @brief Move the agent to a point in the cell it already is
+    /// @details Only the continuous projection is written
+    /// @param id The id of the agent
+    /// @param point The new location
+    void move_within_cell(const repast::AgentId& id, const continuous_point& point);
+
+    /// @brief The cells from the start of a walk to its goal
+    struct route {
+        discrete_point              goal;
+        std::vector<discrete_point> cells;
+        std::size_t                 at {};   // The cell the agent is in
+        std::uint64_t               walk {}; // The last walk() following it
+    };
+
+    /// @brief Advance the active walkers along their routes, in macro mode
+    /// @details The arithmetic is the same as walk(), and the cells of a route
+    /// are the ones next_step() returns, so the agents make the same moves
+    void walk_routes();
+
+    /// @brief Get the next cell of a route, searching it again if needed
+    /// @details The route is searched when the walk starts, when its goal
+    /// changes, or when the agent leaves it
+    /// @throws no_path If the agent can't reach the goal
+    /// @param r The route
+    /// @param cell The cell of the agent
+    /// @param goal The goal of the walk
+    discrete_point route_step(route& r, const discrete_point& cell, const discrete_point& goal);
+
+    /// @brief An agent enqueued to walk
+    struct walker {
+        repast::AgentId  id;
+        continuous_point location;
+        continuous_point destination;
+        space_unit       movement_left;
+        bool             moved;
+        discrete_point   from; // The cell before walking
+    };
+
     continuous_space* _continuous_space;
     discrete_space*   _discrete_space;
-};
+    pathfinder*       _pathfinder;
+    agent_context*    _context;
+
+    // Query scratch memory, reused across calls
+    std::unique_ptr<repast::Moore2DGridQuery<agent>> _query;
+    std::vector<double>                              _continuous_buffer;
+
+    // Location of the agents, valid from snapshot() to balance()
+    int         _rank;
+    bool        _snapshot_valid {};
+    agent_store _snapshot;
+
+    // Order of the agents in the snapshot, by the Morton code of the cells;
+    // between sorts the agents keep it, and the new ones go last
+    discrete_point               _grid_origin;
+    std::uint32_t                _order_period {}; // Snapshots between sorts, 0 keeps the context order
+    std::uint32_t                _order_age {};
+    std::vector<repast::AgentId> _order;
+
+    // Agents sorted by cell, valid while the snapshot is valid
+    spatial_index _index;
+    bool          _index_dirty {};
 
-/// @brief Calculate the distance between two continuous points
-/// @return The distance between the points
-double sq_distance(const space_wrapper::continuous_point& lho, const space_wrapper::continuous_point& rho);
+    std::uint64_t _changes {};
+
+    // The local cells out of reach of the ghost layers of the neighbours
+    continuous_point _interior_min;
+    continuous_point _interior_max;
+    std::uint64_t    _border_changes {};
+
+    // Walk stage buffers, reused across ticks
+    std::vector<walker>         _walkers;
+    std::vector<std::size_t>    _active;
+    std::vector<discrete_point> _starts;
+    std::vector<discrete_point> _goals;
+    std::vector<discrete_point> _steps;
+
+    // The routes of the walking agents, only with walk.macro = true
+    bool                                                  _macro {};
+    std::size_t                                           _max_route {}; // The cells of the plan
+    std::uint64_t                                         _walks {};
+    std::unordered_map<agent_key, route, agent_key::hash> _routes;
+
+    // The agents out of the Repast spaces, see make_static()
+    std::unordered_map<agent_key, continuous_point, agent_key::hash> _static;
+};
 
 } // namespace sti
@@ -0,0 +1,77 @@
+/// @file spatial_index.cpp
+/// @brief Uniform grid of agents, for fast contact detection
+#include "spatial_index.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create an empty index
+/// @param width The number of columns of the grid
+/// @param height The number of rows of the grid
+sti::spatial_index::spatial_index(int width, int height)
+    : _width { width }
+    , _height { height }
+    , _offsets(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) + 1, 0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BUILD
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Discard all the agents, staged and indexed
+void sti::spatial_index::clear()
+{
+    std::fill(_offsets.begin(), _offsets.end(), 0);
+    _agents.clear();
+    _xs.clear();
+    _ys.clear();
+    _staged_cells.clear();
+    _staged_agents.clear();
+    _staged_locations.clear();
+}
+
+/// @brief Stage an agent to be indexed in the next build()
+/// @details Agents outside the grid are ignored
+/// @param a The agent
+/// @param location The continuous location of the agent
+void sti::spatial_index::add(agent* a, const point& location)
+{
+    const auto c = location.discrete();
+    if (c.x < 0 || c.y < 0 || c.x >= _width || c.y >= _height) return;
+
+    _staged_cells.push_back(static_cast<index_type>(c.y * _width + c.x));
+    _staged_agents.push_back(a);
+    _staged_locations.push_back(location);
+}
+
+/// @brief Sort the staged agents into the grid cells
+void sti::spatial_index::build()
+{
+    // Count the agents per cell, shifted by one so the prefix sum yields the
+    // first position of each cell
+    std::fill(_offsets.begin(), _offsets.end(), 0);
+    for (const auto c : _staged_cells) {
+        _offsets[c + 1] += 1;
+    }
+    for (auto c = std::size_t { 1 }; c < _offsets.size(); ++c) {
+        _offsets[c] += _offsets[c - 1];
+    }
+
+    // Scatter the agents, using a copy of the offsets as insertion cursor
+    _agents.resize(_staged_agents.size());
+    _xs.resize(_staged_locations.size());
+    _ys.resize(_staged_locations.size());
+    _cursor.assign(_offsets.begin(), _offsets.end() - 1);
+    for (auto i = std::size_t { 0 }; i < _staged_cells.size(); ++i) {
+        const auto position = _cursor[_staged_cells[i]]++;
+        _agents[position]   = _staged_agents[i];
+        _xs[position]       = _staged_locations[i].x;
+        _ys[position]       = _staged_locations[i].y;
+    }
+
+    _staged_cells.clear();
+    _staged_agents.clear();
+    _staged_locations.clear();
+}
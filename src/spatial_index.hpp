@@ -0,0 +1,218 @@
+/// @file spatial_index.hpp
+/// @brief Uniform grid of agents, for fast contact detection
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "coordinates.hpp"
+
+// Fw. declarations
+namespace sti {
+class contagious_agent;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Uniform grid storing the agents of each cell contiguously
+/// @details The index is rebuilt from scratch with a counting sort: the agents
+/// are staged with add(), and build() places the agents of each cell, and
+/// their locations, next to each other. Iterating over the neighbours of a
+/// point is a linear scan over the buckets around it, without any agent
+/// lookup. The coordinates are stored as two separate arrays (x and y), so
+/// a bucket can be processed with vector instructions.
+class spatial_index {
+
+public:
+    using agent      = contagious_agent;
+    using point      = coordinates<double>;
+    using cell       = coordinates<int>;
+    using index_type = std::uint32_t;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create an empty index
+    /// @param width The number of columns of the grid
+    /// @param height The number of rows of the grid
+    spatial_index(int width, int height);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BUILD
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Discard all the agents, staged and indexed
+    void clear();
+
+    /// @brief Stage an agent to be indexed in the next build()
+    /// @details Agents outside the grid are ignored
+    /// @param a The agent
+    /// @param location The continuous location of the agent
+    void add(agent* a, const point& location);
+
+    /// @brief Sort the staged agents into the grid cells
+    void build();
+
+    ////////////////////////////////////////////////////////////////////////////
+    // QUERIES
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Call a function for each agent in a square of cells
+    /// @param center The center cell of the square
+    /// @param range The number of cells in each direction
+    /// @param f A callable with signature f(agent*, const point&)
+    template <typename F>
+    void for_each_around(const cell& center, int range, F&& f) const
+    {
+        for_each_block_around(center, range, [&](index_type begin, index_type end) {
+            for (auto i = begin; i < end; ++i) {
+                f(_agents[i], point { _xs[i], _ys[i] });
+            }
+        });
+    }
+
+    /// @brief Call a function for each block of agents in a square of cells
+    /// @details The blocks are contiguous ranges of the index, one per row
+    /// @param center The center cell of the square
+    /// @param range The number of cells in each direction
+    /// @param f A callable with signature f(index_type begin, index_type end)
+    template <typename F>
+    void for_each_block_around(const cell& center, int range, F&& f) const
+    {
+        const auto min_x = std::max(center.x - range, 0);
+        const auto max_x = std::min(center.x + range, _width - 1);
+        const auto min_y = std::max(center.y - range, 0);
+        const auto max_y = std::min(center.y + range, _height - 1);
+
+        for (auto y = min_y; y <= max_y; ++y) {
+            // The cells of a row are contiguous, so are their agents
+            const auto row   = static_cast<index_type>(y * _width);
+            const auto begin = _offsets[row + static_cast<index_type>(min_x)];
+            const auto end   = _offsets[row + static_cast<index_type>(max_x) + 1];
+            if (begin < end) f(begin, end);
+        }
+    }
+
+    /// @brief Call a function once for each agent and block of neighbours
+    /// @details The neighbours of each agent, whose cells are at most range
+    /// cells apart (in each axis), are split in contiguous blocks of the
+    /// index, and only the forward half of the neighbourhood is visited: the
+    /// agents after it in its own cell, the following cells of its row, and
+    /// the rows below. Hence each unordered pair of agents appears in exactly
+    /// one block.
+    /// @param range The maximum number of cells between the agents, per axis
+    /// @param f A callable with signature f(index_type i, index_type begin, index_type end)
+    template <typename F>
+    void for_each_block(int range, F&& f) const
+    {
+        for (auto y = 0; y < _height; ++y) {
+            for (auto x = 0; x < _width; ++x) {
+                const auto here  = static_cast<index_type>(y * _width + x);
+                const auto begin = _offsets[here];
+                const auto end   = _offsets[here + 1];
+                if (begin == end) continue;
+
+                for (auto dy = 0; dy <= range && y + dy < _height; ++dy) {
+                    const auto min_x = dy == 0 ? x + 1 : std::max(x - range, 0);
+                    const auto max_x = std::min(x + range, _width - 1);
+
+                    const auto row         = static_cast<index_type>((y + dy) * _width);
+                    const auto other_begin = min_x > max_x ? 0 : _offsets[row + static_cast<index_type>(min_x)];
+                    const auto other_end   = min_x > max_x ? 0 : _offsets[row + static_cast<index_type>(max_x) + 1];
+                    for (auto i = begin; i < end; ++i) {
+                        // Pairs inside the cell, then the rest of the row
+                        if (dy == 0 && i + 1 < end) f(i, i + 1, end);
+                        if (other_begin < other_end) f(i, other_begin, other_end);
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief Call a function once for each pair of agents in nearby cells
+    /// @details Each unordered pair of agents whose cells are at most range
+    /// cells apart (in each axis) is visited exactly once. The function
+    /// receives the position of both agents in the index, see agent_at() and
+    /// location_at()
+    /// @param range The maximum number of cells between the agents, per axis
+    /// @param f A callable with signature f(index_type, index_type)
+    template <typename F>
+    void for_each_pair(int range, F&& f) const
+    {
+        for_each_block(range, [&](index_type i, index_type begin, index_type end) {
+            for (auto j = begin; j < end; ++j) f(i, j);
+        });
+    }
+
+    /// @brief Get the number of indexed agents
+    index_type size() const
+    {
+        return static_cast<index_type>(_agents.size());
+    }
+
+    /// @brief Get an indexed agent
+    /// @param i The position of the agent in the index
+    agent* agent_at(index_type i) const
+    {
+        return _agents[i];
+    }
+
+    /// @brief Get the location of an indexed agent
+    /// @param i The position of the agent in the index
+    point location_at(index_type i) const
+    {
+        return { _xs[i], _ys[i] };
+    }
+
+    /// @brief Get the x coordinates of all the agents, in index order
+    const double* xs() const
+    {
+        return _xs.data();
+    }
+
+    /// @brief Get the y coordinates of all the agents, in index order
+    const double* ys() const
+    {
+        return _ys.data();
+    }
+
+    /// @brief Get the first agent of each cell, and the end of the last one
+    /// @details The agents of the cell c are in [offsets()[c], offsets()[c + 1]),
+    /// there are width() * height() + 1 offsets
+    const index_type* offsets() const
+    {
+        return _offsets.data();
+    }
+
+    /// @brief Get the number of columns of the grid
+    int width() const
+    {
+        return _width;
+    }
+
+    /// @brief Get the number of rows of the grid
+    int height() const
+    {
+        return _height;
+    }
+
+private:
+    int _width;
+    int _height;
+
+    // Indexed agents, the agents of cell c are in [offsets[c], offsets[c + 1])
+    std::vector<index_type> _offsets;
+    std::vector<agent*>     _agents;
+    std::vector<double>     _xs;
+    std::vector<double>     _ys;
+
+    // Staged agents, waiting for build()
+    std::vector<index_type> _staged_cells;
+    std::vector<agent*>     _staged_agents;
+    std::vector<point>      _staged_locations;
+    std::vector<index_type> _cursor;
+}; // class spatial_index
+
+} // namespace sti
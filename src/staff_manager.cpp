@@ -1,13 +1,15 @@
 #include "staff_manager.hpp"
 
 #include <boost/json.hpp>
-#include <fstream>
-#include <repast_hpc/Random.h>
-#include <sstream>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "agent_factory.hpp"
+#include "counter_rng.hpp"
 #include "hospital_plan.hpp"
 #include "infection_logic/human_infection_cycle.hpp"
+#include "infection_logic/static_registry.hpp"
+#include "output_files.hpp"
 #include "person.hpp"
 #include "utils.hpp"
 #include "space_wrapper.hpp"
@@ -34,39 +36,61 @@ sti::staff_manager::staff_manager(repast::SharedContext<contagious_agent>* conte
 /// @brief Create a person of a given type
 /// @param location The location to insert the person into
 /// @param type The person type
+/// @param subject The stable subject of the person, the cell of the post
+/// and its replacements, see counter_rng::entity
 sti::person_agent* sti::staff_manager::create_person(const sti::coordinates<double>&  location,
-                                                     const person_agent::person_type& type)
+                                                     const person_agent::person_type& type,
+                                                     std::uint64_t                    subject)
 {
 
     const auto immunity_chance = _hospital_props->at("parameters").at("personnel").at("immunity").as_double();
 
     auto is_immune = [&]() -> bool {
-        const auto random = repast::Random::instance()->nextDouble();
+        const auto random = counter_rng::instance().uniform(counter_rng::event::STAFF_IMMUNITY, subject);
         return random < immunity_chance;
     };
 
-    return _agent_factory->insert_new_person(location,
-                                             type,
-                                             human_infection_cycle::STAGE::HEALTHY,
-                                             is_immune());
+    auto* person = _agent_factory->insert_new_person(location,
+                                                     type,
+                                                     human_infection_cycle::STAGE::HEALTHY,
+                                                     is_immune(),
+                                                     subject);
+    if (_static != nullptr) {
+        _spaces->make_static(person);
+        _static->add(person, location);
+    }
+    return person;
+}
+
+/// @brief Keep the staff out of the Repast spaces, in a static registry
+/// @details Before create_staff() or the restart
+/// @param registry The registry, nullptr to keep the staff as Repast agents
+void sti::staff_manager::use_static(static_registry* registry)
+{
+    _static = registry;
 }
 
 /// @brief Create all the hospital staff agents
+/// @details The staff is keyed by the cell of its post, which any layout
+/// assigns to exactly one process
 void sti::staff_manager::create_staff()
 {
+    using entity = counter_rng::entity;
 
     for (const auto& doc : _hospital_plan->doctors()) {
 
         if (_spaces->local_dimensions().contains(doc.location)) {
 
-            auto* agent = create_person(doc.location.continuous(), doc.type);
+            const auto subject = counter_rng::subject(entity::STAFF, doc.location.x, doc.location.y);
+            auto*      agent   = create_person(doc.location.continuous(), doc.type, subject);
             _created.push_back(agent);
         }
     }
 
     for (const auto& rec : _hospital_plan->receptionists()) {
         if (_spaces->local_dimensions().contains(rec.location)) {
-            auto* agent = create_person(rec.location.continuous(), "receptionist");
+            const auto subject = counter_rng::subject(entity::STAFF, rec.location.x, rec.location.y);
+            auto*      agent   = create_person(rec.location.continuous(), "receptionist", subject);
             _created.push_back(agent);
         }
     }
@@ -81,21 +105,24 @@ void sti::staff_manager::tick()
         if (person->get_infection_logic()->is_sick()) {
             const auto type = person->get_role();
             const auto location = _spaces->get_continuous_location(person->getId());
+
+            // The next generation of the post, see counter_rng::subject()
+            const auto subject = person->get_infection_logic()->subject() + 1;
             _removed_staff.push_back(person->stats());
 
+            if (_static != nullptr) _static->remove(person->getId());
             _spaces->remove_agent(person);
             _context->removeAgent(person);
 
-            auto* new_person = create_person(location, type);
+            auto* new_person = create_person(location, type, subject);
             person = new_person;
         }
     }
 }
 
 /// @brief Save all the staff agents
-/// @param folderpath The folder to save the results to
-/// @param rank The process rank
-void sti::staff_manager::save(const std::string& folderpath, int rank) const
+/// @param output The result files
+void sti::staff_manager::save(output_files& output) const
 {
     auto array = boost::json::array {_removed_staff};
 
@@ -105,11 +132,41 @@ void sti::staff_manager::save(const std::string& folderpath, int rank) const
         _context->removeAgent(person);
     }
 
-    auto os = std::ostringstream {};
-    os << folderpath
-       << "/staff.p"
-       << rank
-       << ".json";
-    auto file = std::ofstream { os.str() };
-    file << array;
+    output.write("staff", "json", [array = std::move(array)]() { return boost::json::serialize(array); });
+}
+
+/// @brief Write the staff replaced and the ids of the current one
+/// @param ar The archive of the checkpoint
+void sti::staff_manager::save_state(oarchive& ar) const
+{
+    auto ids = std::vector<repast::AgentId> {};
+    for (const auto* person : _created) ids.push_back(person->getId());
+
+    ar << boost::json::serialize(_removed_staff);
+    ar << ids;
+}
+
+/// @brief Read the staff replaced, and find the current one in the context
+/// @throws bad_checkpoint If a member of the staff was not restored
+/// @param ar The archive of the checkpoint
+void sti::staff_manager::load_state(iarchive& ar)
+{
+    auto removed = std::string {};
+    auto ids     = std::vector<repast::AgentId> {};
+    ar >> removed;
+    ar >> ids;
+
+    _removed_staff = boost::json::parse(removed).as_array();
+    _created.clear();
+    for (const auto& id : ids) {
+        auto* person = static_cast<person_agent*>(_context->getAgent(id));
+        if (person == nullptr) throw bad_checkpoint {};
+        _created.push_back(person);
+
+        // The restored staff was placed in the Repast spaces
+        if (_static != nullptr) {
+            _spaces->make_static(person);
+            _static->add(person, _spaces->get_continuous_location(id));
+        }
+    }
 }
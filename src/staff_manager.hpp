@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 
+#include "checkpoint.hpp"
 #include "coordinates.hpp"
 #include "person.hpp"
 
@@ -23,13 +24,15 @@ namespace sti {
 class hospital_plan;
 class agent_factory;
 class contagious_agent;
+class output_files;
 class space_wrapper;
+class static_registry;
 } // namespace sti
 
 namespace sti {
 
 /// @brief Manage the creation, maintenance and destruction of hospital staff
-class staff_manager {
+class staff_manager : public checkpoint_participant {
 
 public:
     /// @brief Construct a staff_manager
@@ -44,6 +47,11 @@ public:
                   const hospital_plan*                     hospital,
                   const boost::json::object*               hospital_props);
 
+    /// @brief Keep the staff out of the Repast spaces, in a static registry
+    /// @details Before create_staff() or the restart
+    /// @param registry The registry, nullptr to keep the staff as Repast agents
+    void use_static(static_registry* registry);
+
     /// @brief Create all the hospital staff agents
     void create_staff();
 
@@ -51,22 +59,34 @@ public:
     void tick();
 
     /// @brief Save
-    /// @param folderpath The folder to save the results to
-    /// @param rank The process rank
-    void save(const std::string& folderpath, int rank) const;
+    /// @param output The result files
+    void save(output_files& output) const;
+
+    /// @brief Write the staff replaced and the ids of the current one
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the staff replaced, and find the current one in the context
+    /// @throws bad_checkpoint If a member of the staff was not restored
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
 
 private:
     /// @brief Create a person of a given type
     /// @param location The location to insert the person into
     /// @param type The person type
+    /// @param subject The stable subject of the person, the cell of the post
+    /// and its replacements, see counter_rng::entity
     person_agent* create_person(const sti::coordinates<double>&  location,
-                                const person_agent::person_type& type);
+                                const person_agent::person_type& type,
+                                std::uint64_t                    subject);
 
     repast::SharedContext<contagious_agent>* _context;
     agent_factory*                           _agent_factory;
     space_wrapper*                           _spaces;
     const hospital_plan*                     _hospital_plan;
     const boost::json::object*               _hospital_props;
+    static_registry*                         _static {};
 
     boost::json::array         _removed_staff;
     std::vector<person_agent*> _created;
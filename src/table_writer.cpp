@@ -0,0 +1,184 @@
+/// @file table_writer.cpp
+/// @brief Typed tables of results, and the formats they are written in
+#include "table_writer.hpp"
+
+#include <algorithm>
+#include <netcdfcpp.h>
+#include <repast_hpc/Properties.h>
+#include <sstream>
+
+#include "output_files.hpp"
+
+namespace {
+
+/// @brief Get the path of the file of a table
+std::string table_path(const std::string& folder, const std::string& name, int rank, const std::string& extension)
+{
+    auto os = std::ostringstream {};
+    os << folder << "/" << name << ".p" << rank << "." << extension;
+    return os.str();
+}
+
+/// @brief Get the number of values of a column
+std::size_t column_size(const sti::table::column_data& data)
+{
+    return boost::apply_visitor([](const auto& values) { return values.size(); }, data);
+}
+
+/// @brief Format a table as comma separated text
+std::string format_csv(const sti::table& t)
+{
+    auto file = std::ostringstream {};
+
+    const auto& columns = t.columns();
+    for (auto c = std::size_t { 0 }; c < columns.size(); ++c) {
+        file << (c == 0 ? "" : ",") << columns[c].name;
+    }
+    file << '\n';
+
+    for (auto row = std::size_t { 0 }; row < t.rows(); ++row) {
+        for (auto c = std::size_t { 0 }; c < columns.size(); ++c) {
+            if (c != 0) file << ',';
+            boost::apply_visitor([&](const auto& values) { file << values.at(row); }, columns[c].data);
+        }
+        file << '\n';
+    }
+    return file.str();
+}
+
+/// @brief Add a variable with the values of a column to a NetCDF file
+struct netcdf_column_writer : public boost::static_visitor<bool> {
+    NcFile*            file;
+    NcDim*             rows;
+    const std::string* name;
+
+    bool operator()(const std::vector<std::int32_t>& values) const
+    {
+        auto* var = file->add_var(name->c_str(), ncInt, rows);
+        return var != nullptr && (values.empty() || var->put(values.data(), static_cast<long>(values.size())));
+    }
+
+    bool operator()(const std::vector<std::int64_t>& values) const
+    {
+        // The classic format has no 64 bits integers
+        const auto as_double = std::vector<double>(values.begin(), values.end());
+        return (*this)(as_double);
+    }
+
+    bool operator()(const std::vector<double>& values) const
+    {
+        auto* var = file->add_var(name->c_str(), ncDouble, rows);
+        return var != nullptr && (values.empty() || var->put(values.data(), static_cast<long>(values.size())));
+    }
+
+    bool operator()(const std::vector<std::string>& values) const
+    {
+        auto length = std::size_t { 1 };
+        for (const auto& s : values) length = std::max(length, s.size());
+
+        // One row of chars per string, padded with zeros
+        auto chars = std::vector<char>(values.size() * length, '\0');
+        for (auto i = std::size_t { 0 }; i < values.size(); ++i) {
+            std::copy(values[i].begin(), values[i].end(), chars.begin() + static_cast<std::ptrdiff_t>(i * length));
+        }
+
+        auto* chars_dim = file->add_dim((*name + "_length").c_str(), static_cast<long>(length));
+        if (chars_dim == nullptr) return false;
+        auto* var = file->add_var(name->c_str(), ncChar, rows, chars_dim);
+        if (var == nullptr || !var->add_att("_Encoding", "utf-8")) return false;
+        return values.empty() || var->put(chars.data(), static_cast<long>(values.size()), static_cast<long>(length));
+    }
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// TABLE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of rows, the size of the first column
+std::size_t sti::table::rows() const
+{
+    if (_columns.empty()) return 0;
+    return column_size(_columns.front().data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CSV WRITER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a writer
+/// @param files The result files
+sti::csv_table_writer::csv_table_writer(output_files* files)
+    : _files { files }
+{
+}
+
+/// @brief Write a table
+/// @param name The name of the table, the file is <folder>/<name>.p<rank>.csv
+/// @param t The table
+/// @throws table_write_error If the file can't be written
+void sti::csv_table_writer::write(const std::string& name, const table& t) const
+{
+    try {
+        _files->write(name, "csv", [t]() { return format_csv(t); });
+    } catch (const output_write_error&) {
+        throw table_write_error {};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NETCDF WRITER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a writer
+/// @param folder The output folder
+/// @param rank The rank of the process
+sti::netcdf_table_writer::netcdf_table_writer(std::string folder, int rank)
+    : _folder { std::move(folder) }
+    , _rank { rank }
+{
+}
+
+/// @brief Write a table
+/// @param name The name of the table, the file is <folder>/<name>.p<rank>.nc
+/// @param t The table
+/// @throws table_write_error If the file can't be written
+void sti::netcdf_table_writer::write(const std::string& name, const table& t) const
+{
+    // Report the errors with the return values instead of exiting
+    const auto errors = NcError { NcError::silent_nonfatal };
+
+    const auto path = table_path(_folder, name, _rank, "nc");
+    auto       file = NcFile { path.c_str(), NcFile::Replace, nullptr, 0, NcFile::Offset64Bits };
+    if (!file.is_valid()) throw table_write_error {};
+
+    auto* rows = file.add_dim("row", static_cast<long>(t.rows()));
+    if (rows == nullptr) throw table_write_error {};
+
+    for (const auto& column : t.columns()) {
+        if (column_size(column.data) != t.rows()) throw table_write_error {};
+
+        const auto written = boost::apply_visitor(netcdf_column_writer { {}, &file, rows, &column.name }, column.data);
+        if (!written) throw table_write_error {};
+    }
+
+    if (!file.close()) throw table_write_error {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FACTORY
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the writer selected in the properties
+/// @details The property output.format selects the format, csv (default) or
+/// netcdf. The NetCDF files are always one per process
+/// @param props The simulation properties
+/// @param files The result files
+/// @return The writer
+std::unique_ptr<sti::table_writer> sti::make_table_writer(repast::Properties& props, output_files& files)
+{
+    const auto& format = props.getProperty("output.format");
+    if (format == "netcdf") return std::make_unique<netcdf_table_writer>(files.folder(), files.rank());
+    return std::make_unique<csv_table_writer>(&files);
+}
@@ -0,0 +1,147 @@
+/// @file table_writer.hpp
+/// @brief Typed tables of results, and the formats they are written in
+#pragma once
+
+#include <boost/variant.hpp>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fw. declarations
+namespace repast {
+class Properties;
+} // namespace repast
+
+namespace sti {
+class output_files;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Error writing a table
+struct table_write_error : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The table could not be written";
+    }
+};
+
+/// @brief A table of results, stored by columns
+/// @details Each column has a name and a type, the columns are filled by the
+/// producer with add_column() and must end with the same number of rows.
+class table {
+
+public:
+    using column_data = boost::variant<std::vector<std::int32_t>,
+                                       std::vector<std::int64_t>,
+                                       std::vector<double>,
+                                       std::vector<std::string>>;
+
+    /// @brief A named column
+    struct column {
+        std::string name;
+        column_data data;
+    };
+
+    /// @brief Add a column at the end of the table
+    /// @details The reference stays valid while the table exists
+    /// @tparam T The type of the column: std::int32_t, std::int64_t, double or std::string
+    /// @param name The name of the column
+    /// @return The values of the column, to be filled
+    template <typename T>
+    std::vector<T>& add_column(const std::string& name)
+    {
+        _columns.push_back({ name, std::vector<T> {} });
+        return boost::get<std::vector<T>>(_columns.back().data);
+    }
+
+    /// @brief Get the columns, in insertion order
+    const std::deque<column>& columns() const
+    {
+        return _columns;
+    }
+
+    /// @brief Get the number of rows, the size of the first column
+    std::size_t rows() const;
+
+private:
+    std::deque<column> _columns;
+}; // class table
+
+/// @brief Writes the tables of a process in a file format
+class table_writer {
+
+public:
+    table_writer()                    = default;
+    table_writer(const table_writer&) = default;
+    table_writer& operator=(const table_writer&) = default;
+
+    table_writer(table_writer&&) = default;
+    table_writer& operator=(table_writer&&) = default;
+
+    virtual ~table_writer() = default;
+
+    /// @brief Write a table
+    /// @param name The name of the table, the file is <folder>/<name>.p<rank>.<extension>
+    /// @param t The table
+    /// @throws table_write_error If the file can't be written
+    virtual void write(const std::string& name, const table& t) const = 0;
+}; // class table_writer
+
+/// @brief Write the tables as comma separated text, one file per table
+/// @details The tables go to the result files, shared by all the processes
+/// with output.shared, see output_files. With the output tasks a copy of
+/// the table is formatted by a worker
+class csv_table_writer final : public table_writer {
+
+public:
+    /// @brief Create a writer
+    /// @param files The result files
+    explicit csv_table_writer(output_files* files);
+
+    /// @brief Write a table
+    /// @param name The name of the table, the file is <folder>/<name>.p<rank>.csv
+    /// @param t The table
+    /// @throws table_write_error If the file can't be written
+    void write(const std::string& name, const table& t) const override;
+
+private:
+    output_files* _files;
+}; // class csv_table_writer
+
+/// @brief Write the tables in NetCDF classic format, one file per table
+/// @details Each column is a variable over the row dimension, the values are
+/// stored in binary and can be read without parsing. The classic format has
+/// no 64 bits integers, they are stored as doubles, exact up to 2^53. The
+/// strings are stored as char matrices, padded to the longest one.
+class netcdf_table_writer final : public table_writer {
+
+public:
+    /// @brief Create a writer
+    /// @param folder The output folder
+    /// @param rank The rank of the process
+    netcdf_table_writer(std::string folder, int rank);
+
+    /// @brief Write a table
+    /// @param name The name of the table, the file is <folder>/<name>.p<rank>.nc
+    /// @param t The table
+    /// @throws table_write_error If the file can't be written
+    void write(const std::string& name, const table& t) const override;
+
+private:
+    std::string _folder;
+    int         _rank;
+}; // class netcdf_table_writer
+
+/// @brief Create the writer selected in the properties
+/// @details The property output.format selects the format, csv (default) or
+/// netcdf. The NetCDF files are always one per process
+/// @param props The simulation properties
+/// @param files The result files
+/// @return The writer
+std::unique_ptr<table_writer> make_table_writer(repast::Properties& props, output_files& files);
+
+} // namespace sti
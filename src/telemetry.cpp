@@ -0,0 +1,332 @@
+/// @file telemetry.cpp
+/// @brief Metrics of the running simulation, pushed to an HTTP endpoint
+#include "telemetry.hpp"
+
+#include <boost/mpi/communicator.hpp>
+#include <condition_variable>
+#include <curl/curl.h>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "instrumentation.hpp"
+#include "patient.hpp"
+#include "patient_fsm.hpp"
+#include "phase_profiler.hpp"
+
+namespace {
+
+/// @brief The fields of the window of a rank, followed by the phases
+enum field : std::size_t { TICKS,
+                           WINDOW_NS,
+                           AGENTS,
+                           RESIDENT,
+                           PEAK_RESIDENT,
+                           WAITING,
+                           PHASES = WAITING + sti::telemetry::QUEUES };
+
+/// @brief The names of the queues, in the order of telemetry::QUEUE
+constexpr const char* queue_names[sti::telemetry::QUEUES] = { "chairs", "reception", "triage", "doctors", "icu" };
+
+/// @brief The limit of a request to the endpoint, in milliseconds
+constexpr auto request_timeout_ms = 5000L;
+
+/// @brief Discard the body of the responses
+std::size_t discard(char* /*unused*/, std::size_t size, std::size_t n, void* /*unused*/)
+{
+    return size * n;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// SAMPLE
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Count a local patient in its queue, if it's waiting in one
+/// @param patient The patient
+void sti::telemetry::sample::add_patient(const patient_agent& patient)
+{
+    using STATE = patient_fsm::STATE;
+
+    switch (patient.current_state()) {
+    case STATE::WAIT_CHAIR_1:
+    case STATE::WAIT_CHAIR_2:
+    case STATE::WAIT_CHAIR_3:
+        ++waiting[CHAIRS];
+        break;
+    case STATE::WAIT_RECEPTION_TURN:
+        ++waiting[RECEPTION];
+        break;
+    case STATE::WAIT_TRIAGE_TURN:
+        ++waiting[TRIAGE];
+        break;
+    case STATE::WAIT_FOR_DOCTOR:
+        ++waiting[DOCTORS];
+        break;
+    case STATE::WAIT_ICU:
+        ++waiting[ICU];
+        break;
+    default:
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PUBLISHER
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Sends the payloads from a background thread
+/// @details Only the last payload is kept, if the endpoint is slower than
+/// the windows the older ones are dropped
+class sti::telemetry::publisher {
+
+public:
+    /// @brief Start the thread
+    /// @param endpoint The URL the payloads are posted to
+    explicit publisher(std::string endpoint)
+        : _endpoint { std::move(endpoint) }
+    {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        _sender = std::thread { [this]() { send_loop(); } };
+    }
+
+    publisher(const publisher&) = delete;
+    publisher& operator=(const publisher&) = delete;
+
+    publisher(publisher&&) = delete;
+    publisher& operator=(publisher&&) = delete;
+
+    /// @brief Send the last payload and stop the thread
+    ~publisher()
+    {
+        {
+            const auto lock = std::lock_guard { _mutex };
+            _closing        = true;
+        }
+        _changed.notify_one();
+        _sender.join();
+        curl_global_cleanup();
+    }
+
+    /// @brief Queue a payload, replacing the one not sent yet
+    /// @param payload The body of the request
+    void send(std::string payload)
+    {
+        {
+            const auto lock = std::lock_guard { _mutex };
+            _payload        = std::move(payload);
+            _pending        = true;
+        }
+        _changed.notify_one();
+    }
+
+private:
+    /// @brief Body of the sender thread
+    void send_loop()
+    {
+        auto* curl    = curl_easy_init();
+        auto* headers = curl_slist_append(nullptr, "Content-Type: text/plain; version=0.0.4");
+        auto  sending = std::string {};
+        while (true) {
+            {
+                auto lock = std::unique_lock { _mutex };
+                _changed.wait(lock, [this]() { return _pending || _closing; });
+                if (!_pending) break;
+                std::swap(sending, _payload);
+                _pending = false;
+            }
+
+            // A failed request is lost, the next window brings new values
+            if (curl == nullptr) continue;
+            curl_easy_setopt(curl, CURLOPT_URL, _endpoint.c_str());
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, sending.c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(sending.size()));
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, request_timeout_ms);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &discard);
+            curl_easy_perform(curl);
+        }
+        curl_slist_free_all(headers);
+        if (curl != nullptr) curl_easy_cleanup(curl);
+    }
+
+    std::string _endpoint;
+
+    // Shared with the sender thread
+    std::mutex              _mutex;
+    std::condition_variable _changed;
+    std::string             _payload;
+    bool                    _pending {};
+    bool                    _closing {};
+    std::thread             _sender;
+}; // class publisher
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create the telemetry, the rank 0 starts the publisher thread
+/// @param communicator The processes of the simulation
+/// @param endpoint The URL the metrics are posted to
+/// @param format The format of the metrics
+/// @param interval The ticks of each window
+/// @param profiler The profiler of the tick phases
+sti::telemetry::telemetry(boost::mpi::communicator* communicator,
+                          const std::string&        endpoint,
+                          FORMAT                    format,
+                          std::uint32_t             interval,
+                          const phase_profiler&     profiler)
+    : _communicator { communicator }
+    , _format { format }
+    , _interval { interval == 0 ? default_interval : interval }
+    , _profiler { profiler }
+    , _window_start { instrumentation::monotonic_ns() }
+    , _phases_start(profiler.phases().size())
+    , _send(PHASES + profiler.phases().size())
+{
+    if (_communicator->rank() != 0) return;
+    _received.resize(_send.size() * static_cast<std::size_t>(_communicator->size()));
+    _publisher = std::make_unique<publisher>(endpoint);
+}
+
+sti::telemetry::~telemetry()
+{
+    close();
+}
+
+/// @brief Read the format of the telemetry.format property
+/// @throws bad_telemetry_format If it's not prometheus (the default) or influx
+/// @param name The value of the property
+sti::telemetry::FORMAT sti::telemetry::parse_format(const std::string& name)
+{
+    if (name.empty() || name == "prometheus") return FORMAT::PROMETHEUS;
+    if (name == "influx") return FORMAT::INFLUX;
+    throw bad_telemetry_format {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Complete the last gather and stop the publisher, collective
+void sti::telemetry::close()
+{
+    if (_request != MPI_REQUEST_NULL) {
+        MPI_Wait(&_request, MPI_STATUS_IGNORE);
+        publish();
+    }
+    _publisher.reset();
+}
+
+/// @brief Publish the gathered windows if the collective completed
+void sti::telemetry::progress()
+{
+    if (_request == MPI_REQUEST_NULL) return;
+
+    auto done = 0;
+    MPI_Test(&_request, &done, MPI_STATUS_IGNORE);
+    if (done != 0) publish();
+}
+
+/// @brief Gather the window of this rank, completing the previous gather first
+/// @param tick The last tick of the window
+/// @param s The sample of this rank
+void sti::telemetry::close_window(std::uint32_t tick, const sample& s)
+{
+    // The previous gather started a window ago, it's almost always complete
+    if (_request != MPI_REQUEST_NULL) {
+        MPI_Wait(&_request, MPI_STATUS_IGNORE);
+        publish();
+    }
+
+    const auto now       = instrumentation::monotonic_ns();
+    _send[TICKS]         = _window_ticks;
+    _send[WINDOW_NS]     = now - _window_start;
+    _send[AGENTS]        = s.agents;
+    _send[RESIDENT]      = instrumentation::resident_bytes();
+    _send[PEAK_RESIDENT] = instrumentation::peak_resident_bytes();
+    for (auto q = std::size_t { 0 }; q < QUEUES; ++q) _send[WAITING + q] = s.waiting[q];
+    for (auto p = std::size_t { 0 }; p < _phases_start.size(); ++p) {
+        const auto total = _profiler.total_ns(static_cast<phase_profiler::phase_id>(p));
+        _send[PHASES + p] = total - _phases_start[p];
+        _phases_start[p]  = total;
+    }
+
+    MPI_Igather(_send.data(),
+                static_cast<int>(_send.size()),
+                MPI_INT64_T,
+                _received.data(),
+                static_cast<int>(_send.size()),
+                MPI_INT64_T,
+                0,
+                *_communicator,
+                &_request);
+    _gathered_tick = tick;
+    _window_ticks  = 0;
+    _window_start  = now;
+}
+
+/// @brief Format the gathered windows and hand them to the publisher
+void sti::telemetry::publish()
+{
+    if (!_publisher) return;
+
+    const auto& phases  = _profiler.phases();
+    const auto  fields  = _send.size();
+    const auto  ranks   = static_cast<std::size_t>(_communicator->size());
+    auto        payload = std::ostringstream {};
+
+    // The times are means per tick of the window, in seconds
+    const auto per_tick = [&](std::size_t rank, std::size_t field) {
+        const auto* w = &_received[rank * fields];
+        return w[TICKS] == 0 ? 0.0 : static_cast<double>(w[field]) / static_cast<double>(w[TICKS]) / 1e9;
+    };
+
+    if (_format == FORMAT::PROMETHEUS) {
+        payload << "# TYPE sti_tick gauge\nsti_tick " << _gathered_tick << "\n";
+        payload << "# TYPE sti_tick_seconds gauge\n";
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) payload << "sti_tick_seconds{rank=\"" << r << "\"} " << per_tick(r, WINDOW_NS) << "\n";
+        payload << "# TYPE sti_agents gauge\n";
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) payload << "sti_agents{rank=\"" << r << "\"} " << _received[r * fields + AGENTS] << "\n";
+        payload << "# TYPE sti_waiting gauge\n";
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) {
+            for (auto q = std::size_t { 0 }; q < QUEUES; ++q) {
+                payload << "sti_waiting{rank=\"" << r << "\",queue=\"" << queue_names[q] << "\"} " << _received[r * fields + WAITING + q] << "\n";
+            }
+        }
+        payload << "# TYPE sti_resident_bytes gauge\n";
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) payload << "sti_resident_bytes{rank=\"" << r << "\"} " << _received[r * fields + RESIDENT] << "\n";
+        payload << "# TYPE sti_peak_resident_bytes gauge\n";
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) payload << "sti_peak_resident_bytes{rank=\"" << r << "\"} " << _received[r * fields + PEAK_RESIDENT] << "\n";
+        if (_profiler.enabled()) {
+            payload << "# TYPE sti_phase_seconds gauge\n";
+            for (auto r = std::size_t { 0 }; r < ranks; ++r) {
+                for (auto p = std::size_t { 0 }; p < phases.size(); ++p) {
+                    payload << "sti_phase_seconds{rank=\"" << r << "\",phase=\"" << phases[p].name << "\"} " << per_tick(r, PHASES + p) << "\n";
+                }
+            }
+        }
+    } else {
+        for (auto r = std::size_t { 0 }; r < ranks; ++r) {
+            const auto* w = &_received[r * fields];
+            payload << "sti,rank=" << r
+                    << " tick=" << _gathered_tick << "i"
+                    << ",tick_seconds=" << per_tick(r, WINDOW_NS)
+                    << ",agents=" << w[AGENTS] << "i"
+                    << ",resident_bytes=" << w[RESIDENT] << "i"
+                    << ",peak_resident_bytes=" << w[PEAK_RESIDENT] << "i";
+            for (auto q = std::size_t { 0 }; q < QUEUES; ++q) payload << ",waiting_" << queue_names[q] << "=" << w[WAITING + q] << "i";
+            payload << "\n";
+
+            if (!_profiler.enabled()) continue;
+            for (auto p = std::size_t { 0 }; p < phases.size(); ++p) {
+                payload << "sti_phase,rank=" << r << ",phase=" << phases[p].name << " seconds=" << per_tick(r, PHASES + p) << "\n";
+            }
+        }
+    }
+
+    _publisher->send(payload.str());
+}
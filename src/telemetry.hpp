@@ -0,0 +1,157 @@
+/// @file telemetry.hpp
+/// @brief Metrics of the running simulation, pushed to an HTTP endpoint
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+// Fw. declarations
+namespace boost {
+namespace mpi {
+    class communicator;
+} // namespace mpi
+} // namespace boost
+
+namespace sti {
+class patient_agent;
+class phase_profiler;
+} // namespace sti
+
+namespace sti {
+
+/// @brief Error reading the telemetry properties
+struct bad_telemetry_format : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The telemetry format must be prometheus or influx";
+    }
+};
+
+/// @brief Publishes the metrics of all the ranks while the simulation runs
+/// @details Every interval ticks each rank closes a window with its mean tick
+/// time, the time of each profiled phase (with debug.phase.profile), its
+/// local agents, the patients waiting in each queue and its resident memory.
+/// The windows are gathered in the rank 0 with a non-blocking collective,
+/// that completes while the next ticks run, and a background thread of the
+/// rank 0 pushes them with libcurl to the endpoint, in the text format of a
+/// Prometheus pushgateway or in the InfluxDB line protocol. The metrics are
+/// reported by rank, so a rank slower than the rest, or stalled, shows up
+/// minutes into the run. The simulation never waits for the network: a
+/// window that arrives while the previous one is still being sent replaces
+/// it, and the failed requests are dropped.
+class telemetry {
+
+public:
+    /// @brief The format of the published metrics
+    enum class FORMAT { PROMETHEUS,
+                        INFLUX };
+
+    /// @brief The queues of the patients
+    enum QUEUE { CHAIRS,
+                 RECEPTION,
+                 TRIAGE,
+                 DOCTORS,
+                 ICU,
+                 QUEUES };
+
+    constexpr static auto default_interval = std::uint32_t { 100 };
+
+    /// @brief The state of a rank at the end of a window
+    struct sample {
+        std::int64_t                     agents {};
+        std::array<std::int64_t, QUEUES> waiting {};
+
+        /// @brief Count a local patient in its queue, if it's waiting in one
+        /// @param patient The patient
+        void add_patient(const patient_agent& patient);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create the telemetry, the rank 0 starts the publisher thread
+    /// @param communicator The processes of the simulation
+    /// @param endpoint The URL the metrics are posted to
+    /// @param format The format of the metrics
+    /// @param interval The ticks of each window
+    /// @param profiler The profiler of the tick phases
+    telemetry(boost::mpi::communicator* communicator,
+              const std::string&        endpoint,
+              FORMAT                    format,
+              std::uint32_t             interval,
+              const phase_profiler&     profiler);
+
+    telemetry(const telemetry&) = delete;
+    telemetry& operator=(const telemetry&) = delete;
+
+    telemetry(telemetry&&) = delete;
+    telemetry& operator=(telemetry&&) = delete;
+
+    ~telemetry();
+
+    /// @brief Read the format of the telemetry.format property
+    /// @throws bad_telemetry_format If it's not prometheus (the default) or influx
+    /// @param name The value of the property
+    static FORMAT parse_format(const std::string& name);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Finish a tick, collective at the end of each window
+    /// @param tick The tick
+    /// @param sampler A callable returning the sample of this rank, only
+    /// called at the end of a window
+    template <typename Sampler>
+    void end_tick(std::uint32_t tick, Sampler&& sampler)
+    {
+        progress();
+        if (++_window_ticks < _interval) return;
+        close_window(tick, sampler());
+    }
+
+    /// @brief Complete the last gather and stop the publisher, collective
+    void close();
+
+private:
+    /// @brief Sends the payloads from a background thread
+    class publisher;
+
+    /// @brief Publish the gathered windows if the collective completed
+    void progress();
+
+    /// @brief Gather the window of this rank, completing the previous gather first
+    /// @param tick The last tick of the window
+    /// @param s The sample of this rank
+    void close_window(std::uint32_t tick, const sample& s);
+
+    /// @brief Format the gathered windows and hand them to the publisher
+    void publish();
+
+    boost::mpi::communicator* _communicator;
+    FORMAT                    _format;
+    std::uint32_t             _interval;
+    const phase_profiler&     _profiler;
+
+    // The current window
+    std::uint32_t             _window_ticks {};
+    std::int64_t              _window_start;
+    std::vector<std::int64_t> _phases_start; // Total of each phase when the window started
+
+    // The gather in flight
+    MPI_Request               _request { MPI_REQUEST_NULL };
+    std::uint32_t             _gathered_tick {};
+    std::vector<std::int64_t> _send;
+    std::vector<std::int64_t> _received; // Only in the rank 0
+
+    std::unique_ptr<publisher> _publisher; // Only in the rank 0
+}; // class telemetry
+
+} // namespace sti
@@ -0,0 +1,305 @@
+/// @file tick_graph.cpp
+/// @brief Run the independent phases of the tick logic concurrently
+#include "tick_graph.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create an empty graph
+/// @param threads Number of threads, 0 to use the OpenMP default
+/// @param now The timestamp source of the measures
+sti::tick_graph::tick_graph(int threads, instrumentation::clock_function now)
+    : _threads { threads }
+    , _now { now }
+{
+#ifdef _OPENMP
+    if (_threads <= 0) _threads = omp_get_max_threads();
+#else
+    _threads = 1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the number of threads
+int sti::tick_graph::threads() const
+{
+    return _threads;
+}
+
+/// @brief Get the number of chunks a chunked phase of n elements is split into
+/// @param n The number of elements
+std::size_t sti::tick_graph::chunks(std::size_t n) const
+{
+    return std::min(n, max_chunks());
+}
+
+/// @brief Get the maximum number of chunks of a chunked phase
+std::size_t sti::tick_graph::max_chunks() const
+{
+    return static_cast<std::size_t>(_threads) * chunks_per_thread;
+}
+
+/// @brief Remove all the phases, to build the graph of the next tick
+void sti::tick_graph::clear()
+{
+    _nodes.clear();
+}
+
+/// @brief Add a phase
+/// @param phase The profiled phase
+/// @param reads The resources read
+/// @param writes The resources written
+/// @param run The phase
+/// @param main_thread If the phase must run in the calling thread (MPI)
+void sti::tick_graph::add(phase_id phase, resource_set reads, resource_set writes, task run, bool main_thread)
+{
+    auto& n       = add_node(phase, reads, writes);
+    n.run         = std::move(run);
+    n.main_thread = main_thread;
+}
+
+/// @brief Add a phase split in chunks of a range, run concurrently
+/// @param phase The profiled phase
+/// @param reads The resources read
+/// @param writes The resources written
+/// @param size Returns the size of the range, once the dependencies finished
+/// @param chunk Runs a chunk, concurrently with the others
+/// @param finish Runs after all the chunks
+void sti::tick_graph::add_chunked(phase_id phase, resource_set reads, resource_set writes, size_task size, chunk_task chunk, task finish)
+{
+    auto& added   = add_node(phase, reads, writes);
+    added.run     = std::move(finish);
+    added.chunk   = std::move(chunk);
+    added.size    = std::move(size);
+    added.chunked = true;
+}
+
+/// @brief Run all the phases and wait for them
+/// @throws Whatever the first failed phase threw, the phases depending
+/// on it don't run
+void sti::tick_graph::run()
+{
+    auto main_nodes = std::size_t { 0 };
+    for (auto& n : _nodes) {
+        n.pending     = n.predecessors.size();
+        n.chunks_ns   = 0;
+        n.chunks_max  = 0;
+        if (n.main_thread) ++main_nodes;
+    }
+    _main_left = main_nodes;
+    _failed    = false;
+    _error     = nullptr;
+    _main_ready.clear();
+
+    // The phases were added in an order that respects the dependencies
+    if (_threads == 1) {
+        for (auto i = std::size_t { 0 }; i < _nodes.size(); ++i) {
+            _nodes[i].start = _now();
+            split(i);
+            if (_nodes[i].chunks != 0) {
+                for (auto c = std::size_t { 0 }; c < _nodes[i].chunks; ++c) execute_chunk(i, c);
+            } else {
+                execute(i);
+            }
+        }
+    } else {
+        // The master thread starts the graph and runs the main thread phases,
+        // then joins the rest in the barrier, where they all run the tasks.
+        // The task scheduling is left to the OpenMP runtime, that steals them.
+        // The wait for a main thread phase spins, the taskyield of libgomp
+        // doesn't run other tasks
+#pragma omp parallel num_threads(_threads)
+#pragma omp master
+        {
+            for (auto i = std::size_t { 0 }; i < _nodes.size(); ++i) {
+                if (_nodes[i].pending == 0) ready(i);
+            }
+            while (_main_left != 0) {
+                auto next = _nodes.size();
+                {
+                    const auto lock = std::lock_guard { _mutex };
+                    if (!_main_ready.empty()) {
+                        next = _main_ready.back();
+                        _main_ready.pop_back();
+                    }
+                }
+                if (next != _nodes.size()) {
+                    execute(next);
+                } else {
+#pragma omp taskyield
+                }
+            }
+        }
+    }
+
+    measure();
+    if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+/// @brief Add the time of each phase of the last run to a profiler
+/// @param profiler The profiler, the phases are children of the running one
+void sti::tick_graph::report(phase_profiler& profiler) const
+{
+    for (const auto& n : _nodes) profiler.record(n.phase, n.ns);
+}
+
+/// @brief Get the time of the longest chain of dependent phases of the last run
+std::int64_t sti::tick_graph::critical_path_ns() const
+{
+    return _critical_ns;
+}
+
+/// @brief Get the time of all the phases of the last run, the chunks added
+std::int64_t sti::tick_graph::work_ns() const
+{
+    return _work_ns;
+}
+
+/// @brief Add a node, with the dependencies on the previous ones
+/// @details A node depends on the previous nodes writing what it reads
+/// (read after write) or writes (write after write), and on the previous
+/// nodes reading what it writes (write after read)
+/// @return The node
+sti::tick_graph::node& sti::tick_graph::add_node(phase_id phase, resource_set reads, resource_set writes)
+{
+    const auto i     = _nodes.size();
+    auto&      added = _nodes.emplace_back();
+    added.phase      = phase;
+    added.reads      = reads;
+    added.writes     = writes;
+    for (auto j = std::size_t { 0 }; j < i; ++j) {
+        auto& previous = _nodes[j];
+        if ((reads & previous.writes) == 0 && (writes & (previous.reads | previous.writes)) == 0) continue;
+        previous.successors.push_back(i);
+        added.predecessors.push_back(j);
+    }
+    return added;
+}
+
+/// @brief Start a node whose dependencies finished
+/// @param i The node
+void sti::tick_graph::ready(std::size_t i)
+{
+    if (_threads == 1) return; // The run follows the order of the nodes
+    auto& n = _nodes[i];
+    n.start = _now();
+    split(i);
+    if (n.main_thread) {
+        const auto lock = std::lock_guard { _mutex };
+        _main_ready.push_back(i);
+        return;
+    }
+
+    if (n.chunks == 0) {
+#pragma omp task default(shared) firstprivate(i)
+        execute(i);
+        return;
+    }
+    for (auto c = std::size_t { 0 }; c < n.chunks; ++c) {
+#pragma omp task default(shared) firstprivate(i, c)
+        execute_chunk(i, c);
+    }
+}
+
+/// @brief Split a chunked node whose dependencies finished
+/// @details The size of the range is only known once the phases before it
+/// ran, a failed run doesn't split
+/// @param i The node
+void sti::tick_graph::split(std::size_t i)
+{
+    auto& n  = _nodes[i];
+    n.n      = 0;
+    n.chunks = 0;
+    if (n.chunked && !_failed) guarded([&]() { n.n = n.size(); });
+    n.chunks      = chunks(n.n);
+    n.chunks_left = n.chunks;
+}
+
+/// @brief Run a node that isn't chunked and finish it
+/// @details Also the last step of a chunked node
+/// @param i The node
+void sti::tick_graph::execute(std::size_t i)
+{
+    auto&      n     = _nodes[i];
+    const auto start = _now();
+    if (n.run) guarded(n.run);
+    const auto end = _now();
+
+    n.ns      = end - n.start;
+    n.span_ns = end - start + n.chunks_max;
+    n.work_ns = end - start + n.chunks_ns;
+    finish(i);
+}
+
+/// @brief Run a chunk of a chunked node, the last one finishes the node
+/// @param i The node
+/// @param c The chunk
+void sti::tick_graph::execute_chunk(std::size_t i, std::size_t c)
+{
+    auto&      n     = _nodes[i];
+    const auto start = _now();
+    guarded([&]() { n.chunk(c, n.n * c / n.chunks, n.n * (c + 1) / n.chunks); });
+    const auto ns = _now() - start;
+
+    n.chunks_ns += ns;
+    auto longest = n.chunks_max.load();
+    while (longest < ns && !n.chunks_max.compare_exchange_weak(longest, ns)) {
+    }
+    if (--n.chunks_left == 0) execute(i);
+}
+
+/// @brief Run a function of a node, keeping the first error
+/// @details After an error the functions are skipped, the nodes still
+/// finish so the run ends
+/// @param f The function
+template <typename F>
+void sti::tick_graph::guarded(F&& f)
+{
+    if (_failed) return;
+    try {
+        f();
+    } catch (...) {
+        const auto lock = std::lock_guard { _mutex };
+        if (!_error) _error = std::current_exception();
+        _failed = true;
+    }
+}
+
+/// @brief Finish a node, readying the nodes depending on it
+/// @param i The node
+void sti::tick_graph::finish(std::size_t i)
+{
+    const auto& n = _nodes[i];
+    for (const auto s : n.successors) {
+        if (--_nodes[s].pending == 0) ready(s);
+    }
+    if (n.main_thread) --_main_left;
+}
+
+/// @brief Compute the critical path and the work of the last run
+/// @details The predecessors of a node are before it, the longest chain
+/// ending in each node is computed in one pass
+void sti::tick_graph::measure()
+{
+    auto longest = std::vector<std::int64_t>(_nodes.size());
+    _critical_ns = 0;
+    _work_ns     = 0;
+    for (auto i = std::size_t { 0 }; i < _nodes.size(); ++i) {
+        const auto& n = _nodes[i];
+        for (const auto p : n.predecessors) longest[i] = std::max(longest[i], longest[p]);
+        longest[i] += n.span_ns;
+        _critical_ns = std::max(_critical_ns, longest[i]);
+        _work_ns += n.work_ns;
+    }
+}
@@ -0,0 +1,179 @@
+/// @file tick_graph.hpp
+/// @brief Run the independent phases of the tick logic concurrently
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "instrumentation.hpp"
+#include "phase_profiler.hpp"
+
+namespace sti {
+
+/// @brief A graph of the phases of the tick logic, run as OpenMP tasks
+/// @details Each phase declares the state it reads and writes as a set of
+/// resource bits. A phase depends on every phase added before it that writes
+/// something it reads or writes, or reads something it writes, so the results
+/// are those of running the phases in the order they were added, and the
+/// phases with disjoint sets run concurrently. The ready phases are OpenMP
+/// tasks, the runtime balances them among the threads, and a chunked phase
+/// (the agents loop) is split in tasks too, sized once its dependencies
+/// finished, with a last step after all its chunks. The phases that make MPI
+/// calls run in the calling thread.
+/// run() measures each phase: the critical path, the longest chain of
+/// dependent phases, bounds the time of the logic with unlimited threads.
+class tick_graph {
+
+public:
+    using resource_set = std::uint32_t;
+    using phase_id     = phase_profiler::phase_id;
+    using task         = std::function<void()>;
+    using size_task    = std::function<std::size_t()>;
+
+    /// @brief Runs a chunk of a chunked phase: chunk index, first element, end
+    using chunk_task = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+    /// @brief The chunks of a chunked phase per thread, to balance uneven chunks
+    constexpr static auto chunks_per_thread = std::size_t { 4 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create an empty graph
+    /// @param threads Number of threads, 0 to use the OpenMP default
+    /// @param now The timestamp source of the measures
+    tick_graph(int threads, instrumentation::clock_function now);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the number of threads
+    int threads() const;
+
+    /// @brief Get the number of chunks a chunked phase of n elements is split into
+    /// @param n The number of elements
+    std::size_t chunks(std::size_t n) const;
+
+    /// @brief Get the maximum number of chunks of a chunked phase
+    std::size_t max_chunks() const;
+
+    /// @brief Remove all the phases, to build the graph of the next tick
+    void clear();
+
+    /// @brief Add a phase
+    /// @param phase The profiled phase
+    /// @param reads The resources read
+    /// @param writes The resources written
+    /// @param run The phase
+    /// @param main_thread If the phase must run in the calling thread (MPI)
+    void add(phase_id phase, resource_set reads, resource_set writes, task run, bool main_thread = false);
+
+    /// @brief Add a phase split in chunks of a range, run concurrently
+    /// @param phase The profiled phase
+    /// @param reads The resources read
+    /// @param writes The resources written
+    /// @param size Returns the size of the range, once the dependencies finished
+    /// @param chunk Runs a chunk, concurrently with the others
+    /// @param finish Runs after all the chunks
+    void add_chunked(phase_id phase, resource_set reads, resource_set writes, size_task size, chunk_task chunk, task finish);
+
+    /// @brief Run all the phases and wait for them
+    /// @throws Whatever the first failed phase threw, the phases depending
+    /// on it don't run
+    void run();
+
+    /// @brief Add the time of each phase of the last run to a profiler
+    /// @param profiler The profiler, the phases are children of the running one
+    void report(phase_profiler& profiler) const;
+
+    /// @brief Get the time of the longest chain of dependent phases of the last run
+    std::int64_t critical_path_ns() const;
+
+    /// @brief Get the time of all the phases of the last run, the chunks added
+    std::int64_t work_ns() const;
+
+private:
+    /// @brief A phase of the graph
+    struct node {
+        phase_id                 phase;
+        resource_set             reads;
+        resource_set             writes;
+        task                     run;
+        chunk_task               chunk;
+        size_task                size;
+        std::size_t              n {};
+        std::size_t              chunks {};
+        bool                     chunked {};
+        bool                     main_thread {};
+        std::vector<std::size_t> successors;
+        std::vector<std::size_t> predecessors;
+
+        // The state of the current run
+        std::atomic<std::size_t>  pending {};
+        std::atomic<std::size_t>  chunks_left {};
+        std::atomic<std::int64_t> chunks_ns {};  // All the chunks added
+        std::atomic<std::int64_t> chunks_max {}; // The longest chunk
+        std::int64_t              start {};
+        std::int64_t              ns {};      // From the start to the end, profiled
+        std::int64_t              span_ns {}; // With unlimited threads
+        std::int64_t              work_ns {}; // In all the threads
+    };
+
+    /// @brief Add a node, with the dependencies on the previous ones
+    /// @return The node
+    node& add_node(phase_id phase, resource_set reads, resource_set writes);
+
+    /// @brief Start a node whose dependencies finished
+    /// @param i The node
+    void ready(std::size_t i);
+
+    /// @brief Split a chunked node whose dependencies finished
+    /// @param i The node
+    void split(std::size_t i);
+
+    /// @brief Run a node that isn't chunked and finish it
+    /// @param i The node
+    void execute(std::size_t i);
+
+    /// @brief Run a chunk of a chunked node, the last one finishes the node
+    /// @param i The node
+    /// @param c The chunk
+    void execute_chunk(std::size_t i, std::size_t c);
+
+    /// @brief Run a function of a node, keeping the first error
+    /// @param f The function
+    template <typename F>
+    void guarded(F&& f);
+
+    /// @brief Finish a node, readying the nodes depending on it
+    /// @param i The node
+    void finish(std::size_t i);
+
+    /// @brief Compute the critical path and the work of the last run
+    void measure();
+
+    int                             _threads;
+    instrumentation::clock_function _now;
+    std::deque<node>                _nodes; // Never relocated, the nodes have atomics
+
+    // The state of the current run
+    std::atomic<std::size_t> _main_left {}; // The main thread nodes not finished
+    std::atomic<bool>        _failed {};
+    std::mutex               _mutex; // Guards the error and the main thread queue
+    std::exception_ptr       _error;
+    std::vector<std::size_t> _main_ready;
+
+    // The measures of the last run
+    std::int64_t _critical_ns {};
+    std::int64_t _work_ns {};
+}; // class tick_graph
+
+} // namespace sti
@@ -0,0 +1,59 @@
+/// @file tick_rate.cpp
+/// @brief The period of the subsystems that don't need to run every tick
+#include "tick_rate.hpp"
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Create a rate from its period
+/// @param period The period, in simulated seconds
+/// @param seconds_per_tick The length of a tick
+sti::tick_rate::tick_rate(timedelta::resolution period, timedelta::resolution seconds_per_tick)
+    : _period { std::max(1U, period / std::max(1U, seconds_per_tick)) }
+{
+}
+
+/// @brief Read the period of a property, in simulated seconds
+/// @throws bad_tick_rate If the value is not a positive number
+/// @param value The value of the property, empty to run every tick
+/// @param seconds_per_tick The length of a tick
+sti::tick_rate sti::tick_rate::parse(const std::string& value, timedelta::resolution seconds_per_tick)
+{
+    if (value.empty()) return {};
+
+    auto period = timedelta::resolution {};
+    if (!boost::conversion::try_lexical_convert(value, period) || period == 0) throw bad_tick_rate {};
+    return { period, seconds_per_tick };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BEHAVIOUR
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the ticks between two runs
+std::uint32_t sti::tick_rate::period() const
+{
+    return _period;
+}
+
+/// @brief Check if the subsystem runs in a tick
+/// @param tick The tick
+bool sti::tick_rate::due(double tick) const
+{
+    return _period == 1 || static_cast<std::uint64_t>(tick) % _period == 0;
+}
+
+/// @brief Convert a per tick probability into the probability of the period
+/// @details The chance of at least one success in the ticks of the period
+/// @param probability The probability of each tick
+double sti::tick_rate::per_period(double probability) const
+{
+    if (_period == 1 || probability <= 0.0) return probability;
+    if (probability >= 1.0) return 1.0;
+    return 1.0 - std::pow(1.0 - probability, static_cast<double>(_period));
+}
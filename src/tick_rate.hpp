@@ -0,0 +1,67 @@
+/// @file tick_rate.hpp
+/// @brief The period of the subsystems that don't need to run every tick
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <string>
+
+#include "clock.hpp"
+
+namespace sti {
+
+/// @brief Error reading the period of a subsystem
+struct bad_tick_rate : public std::exception {
+    const char* what() const noexcept override
+    {
+        return "Exception: The period of a subsystem must be a positive number of seconds";
+    }
+};
+
+/// @brief How often a slow subsystem runs, once every some ticks
+/// @details The period is given in simulated seconds and rounded down to
+/// whole ticks, at least one, so a smaller seconds.per.tick doesn't run the
+/// slow subsystems more often. The due ticks are the multiples of the period,
+/// a restarted simulation runs them in the same ticks.
+class tick_rate {
+
+public:
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create a rate running every tick
+    tick_rate() = default;
+
+    /// @brief Create a rate from its period
+    /// @param period The period, in simulated seconds
+    /// @param seconds_per_tick The length of a tick
+    tick_rate(timedelta::resolution period, timedelta::resolution seconds_per_tick);
+
+    /// @brief Read the period of a property, in simulated seconds
+    /// @throws bad_tick_rate If the value is not a positive number
+    /// @param value The value of the property, empty to run every tick
+    /// @param seconds_per_tick The length of a tick
+    static tick_rate parse(const std::string& value, timedelta::resolution seconds_per_tick);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Get the ticks between two runs
+    std::uint32_t period() const;
+
+    /// @brief Check if the subsystem runs in a tick
+    /// @param tick The tick
+    bool due(double tick) const;
+
+    /// @brief Convert a per tick probability into the probability of the period
+    /// @details The chance of at least one success in the ticks of the period
+    /// @param probability The probability of each tick
+    double per_period(double probability) const;
+
+private:
+    std::uint32_t _period { 1 };
+}; // class tick_rate
+
+} // namespace sti
@@ -0,0 +1,66 @@
+/// @file tools/analyze.cpp
+/// @brief Compute the summary tables of a simulation from its result files
+/// @details Usage: sti-analyze <output folder> [--threads <n>]
+/// [--admissions <admission_reference.csv>] [--day-distribution <day_distribution_reference.csv>]
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../run_analysis.hpp"
+
+int main(int argc, char** argv)
+{
+    const auto args  = std::vector<std::string> { argv, argv + argc }; // NOLINT
+    const auto usage = [&]() {
+        std::cerr << "Usage: " << args.at(0) << " <output folder> [--threads <n>]"
+                  << " [--admissions <admission_reference.csv>]"
+                  << " [--day-distribution <day_distribution_reference.csv>]" << std::endl;
+        return 1;
+    };
+    if (args.size() < 2 || args.size() % 2 != 0) return usage();
+
+    auto threads          = 0U;
+    auto admissions       = std::string {};
+    auto day_distribution = std::string {};
+    for (auto i = std::size_t { 2 }; i < args.size(); i += 2) {
+        if (args[i] == "--threads") {
+            threads = static_cast<unsigned>(std::stoul(args[i + 1]));
+        } else if (args[i] == "--admissions") {
+            admissions = args[i + 1];
+        } else if (args[i] == "--day-distribution") {
+            day_distribution = args[i + 1];
+        } else {
+            return usage();
+        }
+    }
+
+    try {
+        // The tables are written next to the results, the summary is
+        // printed too
+        const auto& folder   = args[1];
+        const auto  start    = std::chrono::steady_clock::now();
+        const auto  analysis = sti::run_analysis { folder, threads };
+
+        auto summary = std::ofstream { folder + "/summary.csv" };
+        analysis.write_summary(summary);
+        analysis.write_summary(std::cout);
+        if (!admissions.empty()) {
+            auto file = std::ofstream { folder + "/admissions.csv" };
+            analysis.write_admissions(file, admissions);
+        }
+        if (!day_distribution.empty()) {
+            auto file = std::ofstream { folder + "/day_distribution.csv" };
+            analysis.write_day_distribution(file, day_distribution);
+        }
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << analysis.records() << " agents and objects analyzed in " << elapsed << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
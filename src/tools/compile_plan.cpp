@@ -0,0 +1,40 @@
+/// @file tools/compile_plan.cpp
+/// @brief Compile a hospital JSON file to the binary plan mapped at startup
+/// @details Usage: sti-compile-plan <hospital.json> <output>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../clock.hpp"
+#include "../compiled_plan.hpp"
+#include "../hospital_plan.hpp"
+#include "../json_loader.hpp"
+
+int main(int argc, char** argv)
+{
+    const auto args = std::vector<std::string> { argv, argv + argc }; // NOLINT
+    if (args.size() != 3) {
+        std::cerr << "Usage: " << args.at(0) << " <hospital.json> <output>" << std::endl;
+        return 1;
+    }
+
+    try {
+        // The plan is loaded as in the simulation, so the compiled file has the
+        // same grid, tiles and specialty ids
+        const auto hospital = sti::load_json(args[1]);
+        const auto clk      = sti::clock { 1 };
+        const auto plan     = sti::hospital_plan { hospital, &clk };
+        sti::compiled_plan::write(args[2], plan, hospital);
+
+        // Read it back, so an invalid file is reported now and not at startup
+        const auto compiled = sti::compiled_plan { args[2] };
+        std::cout << args[2] << ": " << compiled.width() << "x" << compiled.height()
+                  << " plan, " << plan.doctors().size() << " doctors, "
+                  << compiled.influx_days() << " days of influx" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+/// @file tools/replay_infection.cpp
+/// @brief Run the infection logic again from the infection traces of a simulation
+/// @details Usage: sti-replay <hospital.json> <output folder> <traces...>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../compiled_plan.hpp"
+#include "../infection_replay.hpp"
+#include "../json_loader.hpp"
+
+int main(int argc, char** argv)
+{
+    const auto args = std::vector<std::string> { argv, argv + argc }; // NOLINT
+    if (args.size() < 4) {
+        std::cerr << "Usage: " << args.at(0) << " <hospital.json> <output folder> <traces...>" << std::endl;
+        return 1;
+    }
+
+    try {
+        // The parameters of the replay, the plan can be compiled as in the
+        // simulation, only the parameters are used
+        const auto hospital = sti::compiled_plan::is_compiled(args[1])
+                                ? sti::compiled_plan { args[1] }.parameters()
+                                : sti::load_json(args[1]);
+
+        const auto start  = std::chrono::steady_clock::now();
+        auto       replay = sti::infection_replay { hospital, { args.begin() + 3, args.end() } };
+        const auto ticks  = replay.run();
+        replay.save(args[2]);
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << ticks << " ticks of " << args.size() - 3 << " traces replayed in " << elapsed << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -3,18 +3,20 @@
 #include <boost/json/object.hpp>
 #include <boost/json/value.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <numeric>
 #include <repast_hpc/AgentId.h>
 #include <repast_hpc/Properties.h>
-#include <repast_hpc/Random.h>
 #include <string>
 #include <vector>
 
 #include "clock.hpp"
 #include "coordinates.hpp"
+#include "counter_rng.hpp"
 #include "hospital_plan.hpp"
 #include "json_serialization.hpp"
 #include "queue_manager.hpp"
@@ -34,6 +36,14 @@ struct sti::triage::statistic {
     std::map<timedelta, counter_type>                                icu_diagnostics;
     counter_type                                                     icu_deaths {};
     std::map<doctor_type, std::map<triage_level_type, counter_type>> doctors_diagnostics;
+
+    template <typename Archive>
+    void serialize(Archive& ar, const unsigned int /*unused*/)
+    {
+        ar& icu_diagnostics;
+        ar& icu_deaths;
+        ar& doctors_diagnostics;
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -120,6 +130,7 @@ sti::triage::triage(const properties_type&     execution_props,
     , _icu_death_probability { [&]() {
         return hospital_props.at("parameters").at("triage").at("icu").at("death_probability").as_double();
     }() }
+    , _specialties { plan.specialties() }
 {
     // Make sure all probabilities sum 1
     sti::validate_distribution(
@@ -132,6 +143,18 @@ sti::triage::triage(const properties_type&     execution_props,
         _levels_probabilities.begin(), _levels_probabilities.end(),
         [](auto acc, const auto& val) { return acc + val.second; },
         "Triage level distribution");
+
+    // The specialties are sent as their id in the plan, the specialties
+    // without doctors can't be diagnosed
+    auto doctors = std::vector<std::pair<specialty_id, probability_precission>> {};
+    for (const auto& [specialty, probability] : _doctors_probabilities) {
+        if (probability > 0.0) doctors.push_back({ plan.find_specialty(specialty), probability });
+    }
+    // A table without outcomes can't be sampled, every patient goes to the ICU
+    // or to a doctor if the other has no chance
+    if (_icu_probability < 1.0) _doctors_table = alias_table<specialty_id> { doctors };
+    if (_icu_probability > 0.0) _icu_sleep_table = alias_table<timedelta> { _icu_sleep_times };
+    _levels_table = alias_table<triage_level_type> { _levels_probabilities };
 }
 
 sti::triage::~triage() = default;
@@ -162,80 +185,65 @@ boost::optional<sti::coordinates<double>> sti::triage::is_my_turn(const agent_id
     return _queue_manager->is_my_turn(id);
 }
 
-/// @brief Synchronize the queues between the process
-void sti::triage::sync()
+/// @brief Get the queue, to synchronize it between the processes
+/// @return A pointer to the queue
+sti::queue_manager* sti::triage::queues()
 {
-    _queue_manager->sync();
+    return _queue_manager.get();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // DIAGNOSTIC
 ////////////////////////////////////////////////////////////////////////////////
 
-namespace {
-
-/// @brief Find the bucket/bin in which a value falls
-/// @details Given a container with bin "tags" and the width of the bins, and a
-/// value, try to find the bin in which the value falls. Note that a "sub"
-/// histogram can be used, where probabilities sum < 1.0. If this is the case,
-/// an offset must be provided satisfying the contition sum(p) + offset = 1.0;
-/// in this case the parameter number *must* be greater than the offset, offset
-/// is considered the missing bin [0, offset).
-/// @tparam Value The "tag" type for a given bracket
-/// @tparam Chance The type used for the probability
-/// @param map The map containing the brackets (consisting of tag and probability)
-/// @param number The number trying to fit in the probability
-/// @param offset If the probabilities don't sum 1, an offset fullfiling P + offset = 1 must be provided
-template <typename Iterable, typename Chance>
-[[nodiscard]] auto find_bracket(const Iterable& container, Chance number, Chance offset = Chance(0.0))
-{
-    for (const auto& [value, chance] : container) {
-        if (offset <= number && number <= offset + chance) {
-            return value;
-        }
-        offset += chance;
-    }
-    const auto last = --container.end();
-    return last->first;
-}
-
-} // namespace
-
 /// @brief Diagnose a patient, randomly select a doctor or ICU
+/// @param subject The stable subject of the patient, see counter_rng::entity
 /// @return The diagnostic
-sti::triage::triage_diagnosis sti::triage::diagnose()
+sti::triage::triage_diagnosis sti::triage::diagnose(std::uint64_t subject)
 {
+    const auto& rng = counter_rng::instance();
+    using event     = counter_rng::event;
+
     // Roll dice
-    const auto random_dispatch = repast::Random::instance()->nextDouble();
+    const auto random_dispatch = rng.uniform(event::TRIAGE, subject, 0);
 
     // If the number falls in the ICU bracket (the lower one), return an ICU
     // diagnostic
     if (random_dispatch <= _icu_probability) {
-        const auto random_sleep_time = repast::Random::instance()->nextDouble();
-        const auto sleep_time        = find_bracket(_icu_sleep_times, random_sleep_time);
+        const auto random_sleep_time = rng.uniform(event::TRIAGE, subject, 1);
+        const auto sleep_time        = _icu_sleep_table.sample(random_sleep_time);
         _stats->icu_diagnostics[sleep_time] += 1;
 
-        const auto random_survives_chance = repast::Random::instance()->nextDouble();
+        const auto random_survives_chance = rng.uniform(event::TRIAGE, subject, 2);
         const auto survives               = random_survives_chance >= _icu_death_probability;
         if (!survives) _stats->icu_deaths += 1;
 
         return icu_diagnosis { sleep_time, survives };
     }
 
-    // Otherwise check in which doctor it falls
-    const auto doctor_assigned = find_bracket(_doctors_probabilities, random_dispatch, _icu_probability);
+    // Otherwise check in which doctor it falls, the number is uniform in the
+    // doctors bracket (icu, 1)
+    const auto random_doctor   = (random_dispatch - _icu_probability) / (1.0 - _icu_probability);
+    const auto doctor_assigned = _doctors_table.sample(random_doctor);
 
-    const auto random_level       = repast::Random::instance()->nextDouble();
-    const auto severity_diagnosed = find_bracket(_levels_probabilities, random_level);
+    const auto random_level       = rng.uniform(event::TRIAGE, subject, 3);
+    const auto severity_diagnosed = _levels_table.sample(random_level);
     const auto attention_limit    = _clock->now() + _levels_time_limit.at(severity_diagnosed);
 
     // Increment the statistics
-    _stats->doctors_diagnostics[doctor_assigned][severity_diagnosed] += 1;
+    _stats->doctors_diagnostics[specialty(doctor_assigned)][severity_diagnosed] += 1;
 
     // Now we have all the information, return the doctor and the wait time
     return doctor_diagnosis { doctor_assigned, severity_diagnosed, attention_limit };
 }
 
+/// @brief Get the name of a specialty of the diagnosis
+/// @param id The specialty, as in doctor_diagnosis and hospital_plan
+const sti::triage::doctor_type& sti::triage::specialty(specialty_id id) const
+{
+    return _specialties.at(id);
+}
+
 /// @brief Save the stadistics/metrics to a file
 /// @param filepath The path to the folder where
 void sti::triage::save(const std::string& folderpath) const
@@ -255,3 +263,21 @@ void sti::triage::save(const std::string& folderpath) const
     auto file = std::ofstream { os.str() };
     file << jv;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the statistics, the queue is saved on its own
+/// @param ar The archive of the checkpoint
+void sti::triage::save_state(oarchive& ar) const
+{
+    ar << *_stats;
+}
+
+/// @brief Read the statistics, the queue is restored on its own
+/// @param ar The archive of the checkpoint
+void sti::triage::load_state(iarchive& ar)
+{
+    ar >> *_stats;
+}
@@ -6,9 +6,14 @@
 #include <boost/serialization/variant.hpp>
 #include <boost/mpi/communicator.hpp>
 #include <boost/variant.hpp>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "alias_table.hpp"
+#include "checkpoint.hpp"
 #include "clock.hpp"
 #include "coordinates.hpp"
 #include "queue_manager.hpp"
@@ -30,7 +35,7 @@ class hospital_plan;
 
 namespace sti {
 
-class triage {
+class triage : public checkpoint_participant {
 
 public:
     using agent_id                = repast::AgentId;
@@ -38,6 +43,7 @@ public:
     using communicator_ptr        = boost::mpi::communicator*;
     using probability_precission  = double;
     using doctor_type             = std::string;
+    using specialty_id            = std::uint16_t;
     using attention_waittime_type = sti::datetime;
     using triage_level_type       = std::int32_t;
 
@@ -49,8 +55,10 @@ public:
     ////////////////////////////////////////////////////////////////////////////
 
     /// @brief Represents a doctor diagnosis, contains doctor assigned and priority
+    /// @details The specialty is the index in the triage distribution, its name
+    /// is given by triage::specialty()
     struct doctor_diagnosis {
-        doctor_type             doctor_assigned;
+        specialty_id            doctor_assigned;
         triage_level_type       level;
         attention_waittime_type attention_time_limit;
 
@@ -63,11 +71,12 @@ public:
         } // void serialize(...)
 
         /// @brief Get a JSON object containing the information about this diagnosis
-        boost::json::object stats() const
+        /// @param names The triage, to get the name of the specialty
+        boost::json::object stats(const triage& names) const
         {
             return {
                 { "type", "doctor" },
-                { "specialty", doctor_assigned },
+                { "specialty", names.specialty(doctor_assigned) },
                 { "triage_level", level},
                 { "attention_datetime_limit", attention_time_limit }
             };
@@ -88,7 +97,7 @@ public:
         }
 
         /// @brief Get a JSON object containing the information about this diagnosis
-        boost::json::object stats() const
+        boost::json::object stats(const triage& /*unused*/) const
         {
             return {
                 { "type", "icu" },
@@ -158,16 +167,22 @@ public:
     /// @return If the agent has a triage assigned, the triage location
     boost::optional<sti::coordinates<double>> is_my_turn(const agent_id& id);
 
-    /// @brief Synchronize the queues between the process
-    void sync();
+    /// @brief Get the queue, to synchronize it between the processes
+    /// @return A pointer to the queue
+    queue_manager* queues();
 
     ////////////////////////////////////////////////////////////////////////////
     // REAL TRIAGE BEHAVIOR
     ////////////////////////////////////////////////////////////////////////////
 
     /// @brief Diagnose a patient, randomly select a doctor or ICU
+    /// @param subject The stable subject of the patient, see counter_rng::entity
     /// @return The diagnostic
-    triage_diagnosis diagnose();
+    triage_diagnosis diagnose(std::uint64_t subject);
+
+    /// @brief Get the name of a specialty of the diagnosis
+    /// @param id The specialty, as in doctor_diagnosis and hospital_plan
+    const doctor_type& specialty(specialty_id id) const;
 
     ////////////////////////////////////////////////////////////////////////////
     // SAVE STATISTICS
@@ -177,6 +192,18 @@ public:
     /// @param filepath The path to the folder where
     void save(const std::string& folderpath) const;
 
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the statistics, the queue is saved on its own
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Read the statistics, the queue is restored on its own
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
 private:
     std::unique_ptr<sti::queue_manager> _queue_manager;
     int                                 _this_rank;
@@ -193,6 +220,14 @@ private:
     std::vector<std::pair<timedelta, probability_precission>> _icu_sleep_times;
     probability_precission                                    _icu_death_probability;
 
+    // The names of the specialties, by their id in the plan
+    std::vector<doctor_type> _specialties;
+
+    // The distributions, sampled in constant time
+    alias_table<specialty_id>      _doctors_table;
+    alias_table<triage_level_type> _levels_table;
+    alias_table<timedelta>         _icu_sleep_table;
+
 }; // class triage
 
 } // namespace sti
@@ -0,0 +1,79 @@
+/// @file wake_queue.cpp
+/// @brief Calendar queue of agents waiting for an instant
+#include "wake_queue.hpp"
+
+#include <algorithm>
+#include <boost/serialization/vector.hpp>
+#include <vector>
+
+/// @brief Create an empty queue
+/// @param seconds_per_tick The length of a tick, and of a bucket
+/// @param buckets The number of buckets in the ring
+sti::wake_queue::wake_queue(timedelta::resolution seconds_per_tick, std::size_t buckets)
+    : _width { std::max(seconds_per_tick, timedelta::resolution { 1 }) }
+    , _buckets(std::max(buckets, std::size_t { 1 }))
+{
+}
+
+/// @brief Park an agent until an instant
+/// @param id The agent id
+/// @param until The agent is woken up in the first wake() after this instant
+void sti::wake_queue::park(const agent_id& id, datetime until)
+{
+    // Instants already visited go in the current bucket, visited again
+    const auto k = std::max(key(until), _cursor);
+    _buckets[k % _buckets.size()].push_back({ id, until });
+    ++_size;
+}
+
+/// @brief Get the number of agents parked
+std::size_t sti::wake_queue::size() const
+{
+    return _size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Write the agents parked and the last instant visited
+/// @param ar The archive of the checkpoint
+void sti::wake_queue::save_state(oarchive& ar) const
+{
+    auto ids    = std::vector<agent_id> {};
+    auto untils = std::vector<datetime> {};
+    for (const auto& bucket : _buckets) {
+        for (const auto& e : bucket) {
+            ids.push_back(e.id);
+            untils.push_back(e.until);
+        }
+    }
+    ar << _cursor;
+    ar << ids;
+    ar << untils;
+}
+
+/// @brief Park again the agents written by save_state()
+/// @param ar The archive of the checkpoint
+void sti::wake_queue::load_state(iarchive& ar)
+{
+    auto ids    = std::vector<agent_id> {};
+    auto untils = std::vector<datetime> {};
+    ar >> _cursor;
+    ar >> ids;
+    ar >> untils;
+
+    for (auto& bucket : _buckets) bucket.clear();
+    _size = 0;
+    for (auto i = std::size_t { 0 }; i < ids.size(); ++i) park(ids[i], untils[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Get the bucket key of an instant
+std::size_t sti::wake_queue::key(datetime instant) const
+{
+    return static_cast<std::size_t>(instant.seconds_since_epoch() / _width);
+}
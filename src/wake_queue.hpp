@@ -0,0 +1,103 @@
+/// @file wake_queue.hpp
+/// @brief Calendar queue of agents waiting for an instant
+#pragma once
+
+#include <cstddef>
+#include <repast_hpc/AgentId.h>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "clock.hpp"
+
+namespace sti {
+
+/// @brief Calendar queue of agents waiting for an instant
+/// @details The time is divided in buckets of one tick, stored in a ring. An
+/// agent is stored in the bucket of the instant it must wake up, agents
+/// waiting more than a full ring stay in their bucket until their year comes
+/// around. Parking and waking are constant time, regardless of the number of
+/// agents waiting.
+class wake_queue : public checkpoint_participant {
+
+public:
+    using agent_id = repast::AgentId;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CONSTRUCTION
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Create an empty queue
+    /// @param seconds_per_tick The length of a tick, and of a bucket
+    /// @param buckets The number of buckets in the ring
+    explicit wake_queue(timedelta::resolution seconds_per_tick, std::size_t buckets = 4096);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BEHAVIOUR
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Park an agent until an instant
+    /// @param id The agent id
+    /// @param until The agent is woken up in the first wake() after this instant
+    void park(const agent_id& id, datetime until);
+
+    /// @brief Wake up all the agents waiting for an instant before now
+    /// @param now The current instant
+    /// @param f Function receiving the id of each agent woken up
+    template <typename F>
+    void wake(datetime now, F&& f)
+    {
+        const auto current = key(now);
+
+        // Visit the buckets between the last visit and now, at most a full
+        // ring. The current bucket is visited again in the next call, it might
+        // contain agents waiting for a later instant of the tick
+        const auto last = current - _cursor < _buckets.size() ? current : _cursor + _buckets.size() - 1;
+        for (auto k = _cursor; k <= last; ++k) {
+            auto& bucket = _buckets[k % _buckets.size()];
+
+            auto kept = std::size_t { 0 };
+            for (auto i = std::size_t { 0 }; i < bucket.size(); ++i) {
+                if (bucket[i].until < now) {
+                    f(bucket[i].id);
+                } else {
+                    bucket[kept++] = bucket[i];
+                }
+            }
+            _size -= bucket.size() - kept;
+            bucket.resize(kept);
+        }
+        _cursor = current;
+    }
+
+    /// @brief Get the number of agents parked
+    std::size_t size() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CHECKPOINT
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// @brief Write the agents parked and the last instant visited
+    /// @param ar The archive of the checkpoint
+    void save_state(oarchive& ar) const override;
+
+    /// @brief Park again the agents written by save_state()
+    /// @param ar The archive of the checkpoint
+    void load_state(iarchive& ar) override;
+
+private:
+    /// @brief An agent waiting in a bucket
+    struct entry {
+        agent_id id;
+        datetime until;
+    };
+
+    /// @brief Get the bucket key of an instant
+    std::size_t key(datetime instant) const;
+
+    timedelta::resolution           _width;
+    std::vector<std::vector<entry>> _buckets;
+    std::size_t                     _cursor {};
+    std::size_t                     _size {};
+}; // class wake_queue
+
+} // namespace sti
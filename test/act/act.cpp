@@ -0,0 +1,133 @@
+/// @brief Parallel act phase test, the same results with any number of threads
+#include "act_phase.hpp"
+#include "counter_rng.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+using sti::counter_rng;
+using event = sti::counter_rng::event;
+
+constexpr auto agents = std::size_t { 300 };
+constexpr auto chairs = std::size_t { 40 };
+constexpr auto ticks  = 50U;
+
+/// @brief A manager of chairs, served in the sync as the real one
+struct manager {
+    struct request {
+        std::size_t agent;
+        std::size_t start; // The first chair checked
+        bool        release;
+    };
+
+    std::vector<int>     owners = std::vector<int>(chairs, -1);
+    std::vector<request> requests;
+
+    /// @brief Serve the requests in their order, the responses are seen next tick
+    void serve(std::vector<int>& seats, std::string& output)
+    {
+        for (const auto& r : requests) {
+            if (r.release) {
+                owners[static_cast<std::size_t>(seats[r.agent])] = -1;
+                seats[r.agent]                                   = -1;
+                output += "release " + std::to_string(r.agent) + '\n';
+                continue;
+            }
+            for (auto k = std::size_t { 0 }; k < chairs; ++k) {
+                const auto chair = (r.start + k) % chairs;
+                if (owners[chair] >= 0) continue;
+                owners[chair]  = static_cast<int>(r.agent);
+                seats[r.agent] = static_cast<int>(chair);
+                output += "take " + std::to_string(r.agent) + ' ' + std::to_string(chair) + '\n';
+                break;
+            }
+        }
+        requests.clear();
+    }
+};
+
+/// @brief The final state and output of a run
+struct result {
+    std::vector<int> owners;
+    std::vector<int> seats;
+    std::vector<int> waited;
+    std::string      output;
+};
+
+/// @brief A loop over the agents: sequential, or one of the act phase modes
+using agents_loop = std::function<void(const std::function<void(std::size_t)>&)>;
+
+/// @brief Run the agents, they read the shared state and commit the writes
+result run(const agents_loop& loop)
+{
+    auto& rng    = counter_rng::instance();
+    auto  shared = manager {};
+    auto  seats  = std::vector<int>(agents, -1);
+    auto  waited = std::vector<int>(agents, 0); // Own state, written in the read phase
+    auto  output = std::string {};
+
+    for (auto tick = 1U; tick <= ticks; ++tick) {
+        rng.tick(tick);
+        loop([&](std::size_t i) {
+            const auto subject = counter_rng::subject(counter_rng::entity::PATIENT, i);
+            if (seats[i] >= 0) {
+                if (rng.uniform(event::CHAIR, subject, 1) < 0.2) {
+                    sti::act_phase::commit([&shared, i] { shared.requests.push_back({ i, 0, true }); });
+                }
+                return;
+            }
+
+            waited[i] += 1;
+            if (rng.uniform(event::CHAIR, subject, 0) < 0.3) {
+                const auto start = static_cast<std::size_t>(rng.uniform(event::CHAIR, subject, 2) * chairs);
+                sti::act_phase::commit([&shared, i, start] { shared.requests.push_back({ i, start, false }); });
+                sti::act_phase::commit([&output, i, tick] { output += "request " + std::to_string(i) + " at " + std::to_string(tick) + '\n'; });
+            }
+        });
+        shared.serve(seats, output);
+    }
+
+    return { shared.owners, seats, waited, output };
+}
+
+bool operator==(const result& lho, const result& rho)
+{
+    return lho.owners == rho.owners && lho.seats == rho.seats && lho.waited == rho.waited && lho.output == rho.output;
+}
+
+} // namespace
+
+int main()
+{
+    counter_rng::instance().seed(2024);
+
+    // Without an act phase, as act.threads = 1: the writes run immediately
+    const auto sequential = run([](const auto& f) {
+        for (auto i = std::size_t { 0 }; i < agents; ++i) f(i);
+    });
+    assert(!sequential.output.empty()); // NOLINT
+
+    // act.threads = N, the writes are deferred and committed in agent order
+    for (const auto threads : { 1, 2, 4, 7 }) {
+        auto act = sti::act_phase { threads };
+        assert((run([&act](const auto& f) { act.run(agents, f); }) == sequential)); // NOLINT
+    }
+
+    // tick.graph.threads, the agents split in chunks of different sizes
+    auto act = sti::act_phase { 1 };
+    assert((run([&act](const auto& f) { // NOLINT
+               const auto bounds = std::vector<std::size_t> { 0, 1, 97, 250, agents };
+               act.begin_chunks(bounds.size() - 1);
+               for (auto c = bounds.size() - 1; c > 0; --c) act.run_chunk(c - 1, bounds[c - 1], bounds[c], f);
+               act.end_chunks();
+           })
+            == sequential));
+
+    return 0;
+}
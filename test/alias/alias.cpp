@@ -0,0 +1,49 @@
+/// @brief Sampling of discrete distributions test
+#include "alias_table.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <string>
+
+int main()
+{
+    // Without outcomes, or all of them impossible
+    auto thrown = false;
+    try {
+        sti::alias_table<int> { {} };
+    } catch (const sti::empty_distribution&) {
+        thrown = true;
+    }
+    assert(thrown); // NOLINT
+    thrown = false;
+    try {
+        sti::alias_table<int> { { { 1, 0.0 }, { 2, 0.0 } } };
+    } catch (const sti::empty_distribution&) {
+        thrown = true;
+    }
+    assert(thrown); // NOLINT
+
+    // A single outcome is always sampled
+    const auto single = sti::alias_table<std::string> { { { "a", 3.0 } } };
+    assert(single.sample(0.0) == "a"); // NOLINT
+    assert(single.sample(0.999) == "a"); // NOLINT
+
+    // The frequencies of evenly spaced numbers are the probabilities, that
+    // don't need to sum 1. The impossible outcome is never sampled
+    const auto table = sti::alias_table<int> { { { 1, 1.0 }, { 2, 2.0 }, { 3, 0.0 }, { 4, 5.0 } } };
+    assert((table.values() == std::vector<int> { 1, 2, 3, 4 })); // NOLINT
+
+    constexpr auto samples = 80000;
+    auto           counts  = std::map<int, int> {};
+    for (auto i = 0; i < samples; ++i) ++counts[table.sample((i + 0.5) / samples)];
+    assert(counts[3] == 0); // NOLINT
+    assert(std::abs(counts[1] - samples / 8) <= 1); // NOLINT
+    assert(std::abs(counts[2] - samples / 4) <= 1); // NOLINT
+    assert(std::abs(counts[4] - samples * 5 / 8) <= 1); // NOLINT
+
+    // The same number, the same outcome
+    assert(table.sample(0.3) == table.sample(0.3)); // NOLINT
+
+    return 0;
+}
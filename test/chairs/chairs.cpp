@@ -0,0 +1,73 @@
+/// @brief Free chairs allocator test
+#include "chair_allocator.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+/// @brief The chair the linear scan of the pool used to take
+/// @param in_use The chairs in use
+/// @param random The start of the probe
+int scan(const std::vector<bool>& in_use, double random)
+{
+    const auto n = in_use.size();
+    auto       c = static_cast<std::size_t>(random * static_cast<double>(n));
+    for (auto i = std::size_t { 0 }; i < n; ++i, c = (c + 1) % n) {
+        if (!in_use[c]) return static_cast<int>(c);
+    }
+    return -1;
+}
+
+} // namespace
+
+int main()
+{
+    // The same chairs as the scan, with any pattern of chairs in use
+    for (const auto n : { 1U, 2U, 5U, 16U, 37U }) {
+        auto allocator = sti::chair_allocator { n };
+        auto in_use    = std::vector<bool>(n);
+        auto state     = 12345U;
+        for (auto step = 0; step < 4000; ++step) {
+            state = state * 1103515245U + 12345U;
+            if (state % 3 != 0) {
+                const auto random   = static_cast<double>(state >> 8U) / static_cast<double>(1U << 24U);
+                const auto expected = scan(in_use, random);
+                const auto taken    = allocator.take(0, random);
+                assert((taken ? static_cast<int>(*taken) : -1) == expected); // NOLINT
+                if (taken) in_use[*taken] = true;
+            } else {
+                const auto c = (state >> 4U) % n;
+                assert(allocator.release(c) == in_use[c]); // NOLINT
+                in_use[c] = false;
+            }
+
+            auto free = std::size_t { 0 };
+            for (const auto used : in_use) free += used ? 0 : 1;
+            assert(allocator.free() == free); // NOLINT
+        }
+    }
+
+    // The region of the requester first, then the nearest ones, the lower
+    // one on ties
+    auto regions = sti::chair_allocator { std::vector<int> { 0, 0, 1, 1, 2, 2 } };
+    assert(*regions.take(1, 0.0) == 2); // NOLINT
+    assert(*regions.take(1, 0.0) == 3); // NOLINT
+    assert(*regions.take(1, 0.0) == 0); // NOLINT
+    assert(*regions.take(1, 0.0) == 1); // NOLINT
+    assert(*regions.take(1, 0.0) == 4); // NOLINT
+    assert(*regions.take(5, 0.9) == 5); // NOLINT
+    assert(!regions.take(1, 0.0)); // NOLINT
+    assert(regions.free() == 0); // NOLINT
+
+    // Released and restored chairs are free again
+    assert(regions.release(3)); // NOLINT
+    assert(!regions.release(3)); // NOLINT
+    regions.assign(0, false);
+    assert(regions.free() == 2); // NOLINT
+    assert(*regions.take(0, 0.0) == 0); // NOLINT
+    assert(*regions.take(0, 0.0) == 3); // NOLINT
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/// @brief Process layout independence of the infections test
+#include "agent_locations.hpp"
+#include "agent_wire.hpp"
+#include "clock.hpp"
+#include "contagious_agent.hpp"
+#include "counter_rng.hpp"
+#include "infection_logic/contact_kernel.hpp"
+#include "infection_logic/human_infection_cycle.hpp"
+#include "spatial_index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <repast_hpc/AgentId.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using sti::human_infection_cycle;
+using entity = sti::counter_rng::entity;
+
+constexpr auto side       = 40;  // Width and height of the plan
+constexpr auto population = 240; // Number of humans
+constexpr auto ticks      = 60;
+
+/// @brief Pack the part of the id that doesn't change with the migrations
+std::uint64_t pack(const repast::AgentId& id)
+{
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.id()))
+         | static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.startingRank())) << 32U;
+}
+
+/// @brief The locations of the humans in the current tick
+class locations final : public sti::agent_locations {
+
+public:
+    void set(const repast::AgentId& id, const sti::coordinates<double>& location)
+    {
+        _locations[pack(id)] = location;
+    }
+
+    sti::coordinates<int> get_discrete_location(const repast::AgentId& id) const override
+    {
+        return get_continuous_location(id).discrete();
+    }
+
+    sti::coordinates<double> get_continuous_location(const repast::AgentId& id) const override
+    {
+        return _locations.at(pack(id));
+    }
+
+private:
+    std::unordered_map<std::uint64_t, sti::coordinates<double>> _locations;
+}; // class locations
+
+/// @brief A human with only its infection logic
+class human final : public sti::contagious_agent {
+
+public:
+    human(const repast::AgentId& id, human_infection_cycle infection)
+        : contagious_agent { id }
+        , infection { std::move(infection) }
+    {
+    }
+
+    void pack(sti::agent_wire& /*unused*/) const override { }
+
+    void unpack(const id_t& /*unused*/, const sti::agent_wire& /*unused*/, std::uint8_t /*unused*/) override { }
+
+    state_versions versions() const override
+    {
+        return { infection.version(), 0 };
+    }
+
+    type get_type() const override
+    {
+        return type::PATIENT;
+    }
+
+    void act() override { }
+
+    human_infection_cycle* get_infection_logic() override
+    {
+        return &infection;
+    }
+
+    const human_infection_cycle* get_infection_logic() const override
+    {
+        return &infection;
+    }
+
+    boost::json::object stats() const override
+    {
+        return {};
+    }
+
+    human_infection_cycle infection;
+}; // class human
+
+/// @brief The process owning a location, in a layout of side x side processes
+int owner(const sti::coordinates<double>& location, int processes_side)
+{
+    const auto x = static_cast<int>(location.x) * processes_side / side;
+    const auto y = static_cast<int>(location.y) * processes_side / side;
+    return y * processes_side + x;
+}
+
+/// @brief The same population run in a layout of processes
+/// @details Every process keeps its own copy of all the humans, the local ones
+/// and the ghosts of the rest, the ghosts are updated from their owner before
+/// the contacts, as the Repast synchronization does
+class layout {
+
+public:
+    layout(int processes_side, const std::vector<sti::coordinates<double>>& start, const sti::clock& clk)
+        : _side { processes_side }
+    {
+        _flyweight.space                     = &_locations;
+        _flyweight.clk                       = &clk;
+        _flyweight.infect_probability        = 0.2;
+        _flyweight.infect_distance           = 2.5;
+        _flyweight.contamination_probability = 0.0;
+        _flyweight.min_incubation_time       = sti::timedelta { 0, 0, 10, 0 };
+        _flyweight.max_incubation_time       = sti::timedelta { 0, 0, 40, 0 };
+
+        const auto processes = _side * _side;
+        auto       serials   = std::vector<int>(static_cast<std::size_t>(processes), 0);
+        _copies.resize(static_cast<std::size_t>(processes));
+        for (auto k = std::size_t { 0 }; k < start.size(); ++k) {
+            // The Repast id depends on the process that created the human, the
+            // subject only on the order of entry
+            const auto rank  = owner(start[k], _side);
+            const auto id    = repast::AgentId { serials[static_cast<std::size_t>(rank)]++, rank, 0, rank };
+            const auto stage = k % 12 == 0 ? human_infection_cycle::STAGE::SICK : human_infection_cycle::STAGE::HEALTHY;
+            const auto cycle = human_infection_cycle { &_flyweight, id, sti::counter_rng::subject(entity::PATIENT, k), stage, human_infection_cycle::MODE::NORMAL, clk.now() };
+            for (auto& copy : _copies) copy.push_back(std::make_unique<human>(id, cycle));
+        }
+
+        for (auto rank = 0; rank < processes; ++rank) {
+            _kernels.emplace_back(rank);
+            _indexes.emplace_back(side, side);
+        }
+    }
+
+    /// @brief Move the humans, resolve the contacts and advance the cycles
+    void step(const std::vector<sti::coordinates<double>>& positions)
+    {
+        for (auto k = std::size_t { 0 }; k < positions.size(); ++k) {
+            const auto rank = owner(positions[k], _side);
+            _locations.set(_copies[0][k]->getId(), positions[k]);
+
+            // Migrate, and copy the state of the owner to the ghosts
+            const auto& ghost = _copies[static_cast<std::size_t>(_owner(k))][k]->infection;
+            for (auto& copy : _copies) {
+                copy[k]->getId().currentRank(rank);
+                copy[k]->infection = ghost;
+            }
+        }
+
+        for (auto rank = std::size_t { 0 }; rank < _copies.size(); ++rank) {
+            auto& index = _indexes[rank];
+            index.clear();
+            for (auto k = std::size_t { 0 }; k < positions.size(); ++k) index.add(_copies[rank][k].get(), positions[k]);
+            index.build();
+            _kernels[rank].run(index);
+        }
+
+        for (auto k = std::size_t { 0 }; k < positions.size(); ++k) state(k).tick();
+    }
+
+    /// @brief The state of a human, in its owner
+    human_infection_cycle& state(std::size_t k)
+    {
+        return _copies[static_cast<std::size_t>(_owner(k))][k]->infection;
+    }
+
+private:
+    int _owner(std::size_t k) const
+    {
+        return _copies[0][k]->getId().currentRank();
+    }
+
+    int                                              _side;
+    locations                                        _locations;
+    human_infection_cycle::flyweight                 _flyweight;
+    std::vector<std::vector<std::unique_ptr<human>>> _copies; // By rank, then by entry
+    std::vector<sti::contact_kernel>                 _kernels;
+    std::vector<sti::spatial_index>                  _indexes;
+}; // class layout
+
+} // namespace
+
+int main()
+{
+    auto& rng = sti::counter_rng::instance();
+    rng.seed(1234);
+
+    auto clk       = sti::clock { 60 };
+    auto gen       = std::mt19937 { 7 }; // NOLINT
+    auto position  = std::uniform_real_distribution<double> { 0.0, static_cast<double>(side) };
+    auto movement  = std::uniform_real_distribution<double> { -1.5, 1.5 };
+    auto positions = std::vector<sti::coordinates<double>>(population);
+    for (auto& p : positions) p = { position(gen), position(gen) };
+
+    auto single = layout { 1, positions, clk };
+    auto four   = layout { 2, positions, clk };
+
+    auto infected = 0;
+    for (auto tick = 1; tick <= ticks; ++tick) {
+        rng.tick(static_cast<std::uint32_t>(tick));
+        clk.sync(tick);
+
+        for (auto& p : positions) {
+            p.x = std::clamp(p.x + movement(gen), 0.0, side - 0.01);
+            p.y = std::clamp(p.y + movement(gen), 0.0, side - 0.01);
+        }
+        single.step(positions);
+        four.step(positions);
+
+        // The same seed gives the same infections, by the same sources, at
+        // the same times, in 1x1 and 2x2 processes
+        infected = 0;
+        for (auto k = std::size_t { 0 }; k < positions.size(); ++k) {
+            auto a = sti::infection_wire {};
+            auto b = sti::infection_wire {};
+            single.state(k).pack(a);
+            four.state(k).pack(b);
+            assert(a.subject == b.subject);                         // NOLINT
+            assert(a.stage == b.stage);                             // NOLINT
+            assert(a.infection_time == b.infection_time);           // NOLINT
+            assert(a.incubation_end == b.incubation_end);           // NOLINT
+            assert(a.infected_by.kind == b.infected_by.kind);       // NOLINT
+            assert(a.infected_by.subject() == b.infected_by.subject()); // NOLINT
+            infected += a.infected_by.kind == sti::infection_source::KIND::HUMAN ? 1 : 0;
+        }
+    }
+
+    // The run did infect, the comparison is not between two empty outcomes
+    assert(infected > 0); // NOLINT
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/// @brief Close pairs search test, against a brute force scan
+/// @details Built once for the default target, the scalar or NEON search, and
+/// once with AVX2 in x86, see test/CMakeLists.txt
+#include "infection_logic/close_pairs.hpp"
+#include "spatial_index.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using pair_set = std::set<std::pair<std::uint32_t, std::uint32_t>>;
+
+/// @brief Squared distance between two agents of the index
+double sq_distance(const sti::spatial_index& index, std::uint32_t i, std::uint32_t j)
+{
+    const auto dx = index.xs()[i] - index.xs()[j];
+    const auto dy = index.ys()[i] - index.ys()[j];
+    return dx * dx + dy * dy;
+}
+
+/// @brief Check the searches on one set of agents
+void check(const std::vector<sti::coordinates<double>>& points, int width, int height, int range, double sq_limit, std::mt19937& gen)
+{
+    auto index = sti::spatial_index { width, height };
+    for (const auto& p : points) index.add(nullptr, p);
+    index.build();
+    const auto n = index.size();
+    assert(n == points.size()); // NOLINT
+
+    // Two lanes, any combination of flags
+    auto lanes       = std::uniform_int_distribution<int> { 0, 3 };
+    auto susceptible = std::vector<std::uint8_t>(n);
+    auto infectious  = std::vector<std::uint8_t>(n);
+    auto involved    = std::vector<std::uint8_t>(n);
+    for (auto i = std::uint32_t { 0 }; i < n; ++i) {
+        susceptible[i] = static_cast<std::uint8_t>(lanes(gen));
+        infectious[i]  = static_cast<std::uint8_t>(lanes(gen));
+        involved[i]    = static_cast<std::uint8_t>(susceptible[i] | infectious[i]);
+    }
+    const auto can_infect = [&](std::uint32_t i, std::uint32_t j) {
+        return ((susceptible[i] & infectious[j]) | (susceptible[j] & infectious[i])) != 0;
+    };
+
+    // Brute force, all the pairs
+    auto expected = pair_set {};
+    for (auto i = std::uint32_t { 0 }; i < n; ++i) {
+        for (auto j = i + 1; j < n; ++j) {
+            if (sq_distance(index, i, j) <= sq_limit && can_infect(i, j)) expected.insert({ i, j });
+        }
+    }
+
+    // The host search, each pair once, after testing the lanes
+    auto hits  = std::vector<std::uint32_t>(n);
+    auto host  = pair_set {};
+    auto calls = std::size_t { 0 };
+    sti::for_each_close_pair(index, susceptible.data(), infectious.data(), involved.data(), range, sq_limit, hits.data(), [&](std::uint32_t i, std::uint32_t j) {
+        assert(sq_distance(index, i, j) <= sq_limit); // NOLINT
+        if (!can_infect(i, j)) return;
+        ++calls;
+        host.insert({ std::min(i, j), std::max(i, j) });
+    });
+    assert(calls == host.size()); // NOLINT
+    assert(host == expected);     // NOLINT
+
+    // The device search, in the host without offloading, the same pairs
+    auto pairs   = std::vector<sti::close_pair> {};
+    auto count   = sti::device_close_pairs(index, susceptible.data(), infectious.data(), range, sq_limit, pairs);
+    auto device  = pair_set {};
+    for (auto p = std::uint32_t { 0 }; p < count; ++p) device.insert({ std::min(pairs[p].i, pairs[p].j), std::max(pairs[p].i, pairs[p].j) });
+    assert(count == device.size()); // NOLINT
+    assert(device == expected);     // NOLINT
+
+    // Around a point, i.e. a source of another process: the grid corners,
+    // an exact cell and the agents themselves
+    auto centers = std::vector<sti::coordinates<double>> { { 0.0, 0.0 },
+                                                           { width - 0.01, height - 0.01 },
+                                                           { 5.0, 5.0 } };
+    for (auto i = std::uint32_t { 0 }; i < n; i += 7) centers.push_back(index.location_at(i));
+    for (const auto& center : centers) {
+        auto around = std::set<std::uint32_t> {};
+        sti::for_each_close_to(index, center, susceptible.data(), range, sq_limit, hits.data(), [&](std::uint32_t i) {
+            assert(around.insert(i).second); // NOLINT
+        });
+
+        auto near = std::set<std::uint32_t> {};
+        for (auto i = std::uint32_t { 0 }; i < n; ++i) {
+            const auto dx = index.xs()[i] - center.x;
+            const auto dy = index.ys()[i] - center.y;
+            if (dx * dx + dy * dy <= sq_limit && susceptible[i] != 0) near.insert(i);
+        }
+        assert(around == near); // NOLINT
+    }
+}
+
+} // namespace
+
+int main()
+{
+#if defined(__AVX2__)
+    // Skipped in a CPU without AVX2, see SKIP_RETURN_CODE
+    if (__builtin_cpu_supports("avx2") == 0) return 77;
+#endif
+
+    auto gen = std::mt19937 { 42 }; // NOLINT
+
+    // The blocks of every size, also those not multiple of the vector width,
+    // with the remainder in the scalar loop. Some agents exactly at the limit
+    auto unit = std::uniform_real_distribution<double> { 0.0, 1.0 };
+    auto bit  = std::bernoulli_distribution { 0.7 };
+    for (auto n = std::uint32_t { 0 }; n <= 13; ++n) {
+        auto xs    = std::vector<double>(n);
+        auto ys    = std::vector<double>(n);
+        auto flags = std::vector<std::uint8_t>(n);
+        for (auto k = std::uint32_t { 0 }; k < n; ++k) {
+            xs[k]    = 10.0 + 8.0 * (unit(gen) - 0.5);
+            ys[k]    = 10.0 + 8.0 * (unit(gen) - 0.5);
+            flags[k] = bit(gen) ? 1 : 0;
+            if (k % 3 == 0) {
+                xs[k] = 13.0; // 3-4-5, exactly 25
+                ys[k] = 14.0;
+            }
+        }
+
+        auto hits = std::vector<std::uint32_t>(n);
+        const auto count = sti::close_and_flagged(xs.data(), ys.data(), flags.data(), n, 10.0, 10.0, 25.0, hits.data());
+
+        auto expected = std::vector<std::uint32_t> {};
+        for (auto k = std::uint32_t { 0 }; k < n; ++k) {
+            const auto dx = xs[k] - 10.0;
+            const auto dy = ys[k] - 10.0;
+            if (dx * dx + dy * dy <= 25.0 && flags[k] != 0) expected.push_back(k);
+        }
+        assert((std::vector<std::uint32_t>(hits.begin(), hits.begin() + count) == expected)); // NOLINT
+    }
+
+    // Random agents in grids whose sides are not multiples of 4 or 2, and
+    // pairs exactly at the limit, along both axes and across the cells
+    const auto settings = std::vector<std::pair<int, double>> { { 1, 1.0 }, { 2, 2.25 }, { 3, 6.25 } };
+    for (const auto& [range, sq_limit] : settings) {
+        for (const auto& [width, height] : std::vector<std::pair<int, int>> { { 23, 17 }, { 5, 3 }, { 1, 7 } }) {
+            auto x      = std::uniform_real_distribution<double> { 0.0, static_cast<double>(width) };
+            auto y      = std::uniform_real_distribution<double> { 0.0, static_cast<double>(height) };
+            auto points = std::vector<sti::coordinates<double>> {};
+            for (auto i = 0; i < 5 * width * height; ++i) points.push_back({ x(gen), y(gen) });
+
+            const auto side = std::sqrt(sq_limit);
+            for (auto i = 0; i < 8; ++i) {
+                const auto p = sti::coordinates<double> { static_cast<double>(i % width), static_cast<double>(i % height) };
+                points.push_back(p);
+                if (p.x + side < width) points.push_back({ p.x + side, p.y });
+                if (p.y + side < height) points.push_back({ p.x, p.y + side });
+            }
+
+            check(points, width, height, range, sq_limit, gen);
+        }
+    }
+
+    return 0;
+}
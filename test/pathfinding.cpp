@@ -1,93 +1,156 @@
+/// @brief Path finder test, the flow fields and HPA* against A*
 #include "pathfinder.hpp"
+
 #include <cassert>
-#include <coordinates.hpp>
-#include <iostream>
-#include <limits>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <random>
 #include <vector>
+
 #include "clock.hpp"
+#include "coordinates.hpp"
+#include "plan_grid.hpp"
+
+namespace {
 
-void print(const std::vector<std::vector<bool>>&     map,
-           const sti::coordinates<int>&              start_1,
-           const sti::coordinates<int>&              goal_1,
-           const std::vector<sti::coordinates<int>>& path)
+using cell = sti::coordinates<int>;
+
+/// @brief The number of steps from every cell to a goal, with a plain BFS
+/// @details The same moves as the path finder: the four adjacent cells, the
+/// walkable ones or the goal. -1 for the cells that can't reach it
+std::vector<int> distances(const sti::plan_grid& map, const cell& goal)
 {
-    const auto ncols = map.size();
-    const auto nrows = map.at(0).size();
-    for (auto y = nrows - 1; y != std::numeric_limits<decltype(nrows)>::max(); --y) {
-        for (auto x = 0UL; x < ncols; ++x) {
-            auto       cell    = sti::coordinates<int> { static_cast<int>(x), static_cast<int>(y) };
-            const auto is_path = std::find(path.begin(), path.end(), cell);
-
-            if (is_path != path.end()) {
-                std::cout << '*';
-            } else if (start_1.x == x && start_1.y == y) {
-                std::cout << 'S';
-            } else if (goal_1.x == x && goal_1.y == y) {
-                std::cout << 'G';
-            } else {
-                std::cout << (map.at(x).at(y) ? ' ' : '#');
-            }
-            std::cout << ' ';
+    auto result   = std::vector<int>(map.size(), -1);
+    auto frontier = std::deque<cell> { goal };
+    result[map.index(goal)] = 0;
+    while (!frontier.empty()) {
+        const auto current = frontier.front();
+        frontier.pop_front();
+        for (const auto& diff : { cell { 0, 1 }, cell { 0, -1 }, cell { 1, 0 }, cell { -1, 0 } }) {
+            const auto neighbor = current + diff;
+            if (!map.contains(neighbor) || !map.walkable(neighbor)) continue;
+            if (result[map.index(neighbor)] >= 0) continue;
+            result[map.index(neighbor)] = result[map.index(current)] + 1;
+            frontier.push_back(neighbor);
         }
-        std::cout << '\n';
     }
+    return result;
 }
-int main(int argc, char* argv[])
+
+/// @brief Follow the path from start to goal, checking each step
+/// @return The number of steps, -1 if the path is longer than the cells
+int walk(sti::pathfinder& pathfinder, const sti::plan_grid& map, const cell& start, const cell& goal)
 {
-    auto args = std::vector(argv, argv + argc);
-    // Create the obstacles map, 10x10 grid completley walkable
-    const auto ncols = 10UL;
-    const auto nrows = 10UL;
-    auto       map   = std::vector<std::vector<bool>> {};
-    for (auto x = 0UL; x < ncols; ++x) {
-        map.push_back(std::vector<bool>(nrows, true));
+    auto steps = 0;
+    for (auto current = start; current != goal; ++steps) {
+        if (steps > static_cast<int>(map.size())) return -1;
+        const auto next = pathfinder.next_step(current, goal);
+        assert(std::abs(next.x - current.x) + std::abs(next.y - current.y) == 1); // NOLINT
+        assert(map.walkable(next) || next == goal);                               // NOLINT
+        current = next;
     }
+    return steps;
+}
 
-    // Then add the walls in the border
-    for (auto x = 0UL; x < ncols; ++x) {
-        for (auto y = 0UL; y < nrows; ++y) {
-            if (x == 0 || x == ncols - 1) map.at(x).at(y) = false;
-            if (y == 0 || y == nrows - 1) map.at(x).at(y) = false;
+/// @brief A plan with walls in the border and random obstacles inside
+sti::plan_grid random_plan(std::size_t side, double obstacles, unsigned seed)
+{
+    auto map    = sti::plan_grid { side, side };
+    auto gen    = std::mt19937 { seed };
+    auto wall   = std::bernoulli_distribution { obstacles };
+    const auto last = static_cast<int>(side) - 1;
+    for (auto x = 0; x <= last; ++x) {
+        for (auto y = 0; y <= last; ++y) {
+            const auto border = x == 0 || y == 0 || x == last || y == last;
+            if (border || wall(gen)) map.set_walkable({ x, y }, false);
         }
     }
+    return map;
+}
 
-    // and add the middle diagonal wall
-    for (auto i = 2UL; i < nrows - 2; ++i) {
-        map.at(i).at(i) = false;
-    }
+} // namespace
 
-    // The path starts at (1, 8), the goal is (8, 1)
-    const auto start_1 = sti::coordinates<int> { 1, 8 };
-    const auto goal_1  = sti::coordinates<int> { 8, 1 };
+int main()
+{
+    auto clock = sti::clock { 60 };
 
-    // Create the pathfinder
-    auto clock      = sti::clock { 60 };
-    auto pathfinder = sti::pathfinder { &map, &clock };
+    // A 10x10 plan with walls in the border and a diagonal wall in the middle
+    {
+        const auto side = 10UL;
+        auto       map  = random_plan(side, 0.0, 0);
+        for (auto i = 2; i < static_cast<int>(side) - 2; ++i) map.set_walkable({ i, i }, false);
 
-    // Generate the path to go from start to end
-    auto path_1 = std::vector<sti::coordinates<int>> {};
-    for (auto current = pathfinder.next_step(start_1, goal_1); current != goal_1; current = pathfinder.next_step(current, goal_1)) {
-        path_1.push_back(current);
-    }
+        const auto start = cell { 1, 8 };
+        const auto goal  = cell { 8, 1 };
+        const auto best  = distances(map, goal)[map.index(start)];
 
-    // Print the map to stdout
-    print(map, start_1, goal_1, path_1);
-
-    // Try again from the same spot, there should be no cache misses, update
-    // the clock to simulate another tick
-    clock.sync(1.0);
-    const auto start_2 = sti::coordinates<int> { 1, 8 };
-    const auto goal_2  = sti::coordinates<int> { 8, 1 };
-    auto       path_2  = std::vector<sti::coordinates<int>> {};
-    for (auto current = pathfinder.next_step(start_2, goal_2); current != goal_2; current = pathfinder.next_step(current, goal_2)) {
-        path_2.push_back(current);
+        auto pathfinder = sti::pathfinder { &map, &clock };
+        assert(walk(pathfinder, map, start, goal) == best); // NOLINT
+
+        // The same path in another tick is all cached, no new search
+        clock.sync(1.0);
+        const auto bytes = pathfinder.memory_bytes();
+        assert(walk(pathfinder, map, start, goal) == best); // NOLINT
+        assert(pathfinder.memory_bytes() == bytes);         // NOLINT
     }
-    print(map, start_2, goal_2, path_2);
 
-    assert(stats_1->cache_misses == stats_2->cache_misses);
+    // Random plans: A* finds the shortest paths, the flow fields agree with
+    // it on every step, and the HPA* paths stay within the bound
+    const auto side    = 32UL;
+    const auto cluster = 8;
+    for (auto seed = 1U; seed <= 4U; ++seed) {
+        const auto map = random_plan(side, 0.25, seed);
+
+        auto gen    = std::mt19937 { seed };
+        auto coord  = std::uniform_int_distribution<int> { 1, static_cast<int>(side) - 2 };
+        auto random = [&] {
+            for (;;) {
+                const auto c = cell { coord(gen), coord(gen) };
+                if (map.walkable(c)) return c;
+            }
+        };
+
+        auto goals = std::vector<cell> {};
+        for (auto i = 0; i < 6; ++i) goals.push_back(random());
+
+        auto astar = sti::pathfinder { &map, &clock };
+        auto flow  = sti::pathfinder { &map, &clock };
+        auto hpa   = sti::pathfinder { &map, &clock };
+        flow.precompute(goals);
+        hpa.use_hierarchy(cluster);
+
+        auto reached = 0;
+        for (const auto& goal : goals) {
+            assert(flow.has_flow_field(goal)); // NOLINT
+            const auto best = distances(map, goal);
 
-    // Save the stats
-    pathfinder.save(args.at(1), 0);
+            for (auto i = 0; i < 20; ++i) {
+                const auto start = random();
+                const auto d     = best[map.index(start)];
+                if (d < 0 || start == goal) continue;
+                ++reached;
+
+                // The flow fields and A* agree on every cell of the path: both
+                // next cells are one step closer to the goal. They can break
+                // the ties between equal paths differently
+                for (auto current = start; current != goal; current = astar.next_step(current, goal)) {
+                    const auto closer = best[map.index(current)] - 1;
+                    assert(best[map.index(flow.next_step(current, goal))] == closer);  // NOLINT
+                    assert(best[map.index(astar.next_step(current, goal))] == closer); // NOLINT
+                }
+                assert(walk(astar, map, start, goal) == d); // NOLINT
+                assert(walk(flow, map, start, goal) == d);  // NOLINT
+
+                // HPA* reaches the goal. Each cluster crossed can add a
+                // detour to its portal of up to two sides of the cluster
+                const auto h = walk(hpa, map, start, goal);
+                assert(h >= d);                                       // NOLINT
+                assert(h <= d + 2 * cluster * (d / cluster + 2));     // NOLINT
+            }
+        }
+        assert(reached > 0); // NOLINT
+    }
 
     return 0;
 }
@@ -0,0 +1,58 @@
+/// @brief Recycling allocator of the agents test
+#include "object_pool.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace {
+
+/// @brief A class allocated from its pool
+struct pooled_agent : public sti::pooled<pooled_agent> {
+    std::uint64_t value {};
+    double        other {};
+};
+
+/// @brief A derived class, larger, goes to the global heap
+struct larger_agent : public pooled_agent {
+    double more[8] {};
+};
+
+} // namespace
+
+int main()
+{
+    // A slab of 4 blocks, grown on demand
+    auto pool   = sti::block_pool<sizeof(double), alignof(double), 4> {};
+    auto blocks = std::vector<void*> {};
+    for (auto i = 0; i < 6; ++i) blocks.push_back(pool.allocate());
+    assert(pool.used() == 6); // NOLINT
+    assert(pool.capacity() == 8); // NOLINT
+    assert(std::set<void*>(blocks.begin(), blocks.end()).size() == 6); // NOLINT
+    for (auto* b : blocks) assert(reinterpret_cast<std::uintptr_t>(b) % alignof(double) == 0); // NOLINT
+
+    // The released blocks are reused before growing
+    pool.deallocate(blocks[2]);
+    assert(pool.used() == 5); // NOLINT
+    assert(pool.allocate() == blocks[2]); // NOLINT
+    assert(pool.capacity() == 8); // NOLINT
+    for (auto* b : blocks) pool.deallocate(b);
+    assert(pool.used() == 0); // NOLINT
+
+    // The class allocation functions recycle the blocks of its pool
+    auto* a = new pooled_agent {};
+    assert(pooled_agent::pool().used() == 1); // NOLINT
+    delete a;
+    assert(pooled_agent::pool().used() == 0); // NOLINT
+    auto* b = new pooled_agent {};
+    assert(b == a); // NOLINT
+    delete b;
+
+    // The derived classes don't use the pool
+    auto* c = new larger_agent {};
+    assert(pooled_agent::pool().used() == 0); // NOLINT
+    delete c;
+
+    return 0;
+}
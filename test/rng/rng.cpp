@@ -0,0 +1,72 @@
+/// @brief Counter-based random numbers test
+#include "counter_rng.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <set>
+
+int main()
+{
+    using sti::counter_rng;
+    using event = sti::counter_rng::event;
+
+    auto rng = counter_rng {};
+    rng.seed(42);
+    rng.tick(7);
+
+    // The same key reproduces the same draw, in every instance
+    auto copy = counter_rng {};
+    copy.seed(42);
+    copy.tick(7);
+    assert(rng.uniform(event::CONTACT, 1234, 5) == copy.uniform(event::CONTACT, 1234, 5)); // NOLINT
+    assert(rng.uniform_pair(event::CONTACT, 1, 2) == copy.uniform_pair(event::CONTACT, 1, 2)); // NOLINT
+    assert(rng.seed() == 42); // NOLINT
+
+    // Any change of the key changes the draw
+    const auto base = rng.uniform(event::CONTACT, 1234, 5);
+    assert(base != rng.uniform(event::CONTACT, 1235, 5)); // NOLINT
+    assert(base != rng.uniform(event::CONTACT, 1234, 6)); // NOLINT
+    assert(base != rng.uniform(event::CONTAMINATION, 1234, 5)); // NOLINT
+    copy.tick(8);
+    assert(base != copy.uniform(event::CONTACT, 1234, 5)); // NOLINT
+    copy.tick(7);
+    copy.seed(43);
+    assert(base != copy.uniform(event::CONTACT, 1234, 5)); // NOLINT
+
+    // The draws of distinct (subject, draw) pairs are distinct, and in [0, 1)
+    auto draws = std::set<double> {};
+    for (auto subject = std::uint64_t { 0 }; subject < 64; ++subject) {
+        for (auto draw = std::uint32_t { 0 }; draw < 64; ++draw) {
+            const auto value = rng.uniform(event::CONTACT, subject << 32U, draw);
+            assert(value >= 0.0 && value < 1.0); // NOLINT
+            draws.insert(value);
+        }
+    }
+    assert(draws.size() == 64 * 64); // NOLINT
+
+    // The staff of the same column differ only in the upper bits of their
+    // subject, the pairs must still get a draw each
+    using entity        = sti::counter_rng::entity;
+    const auto receiver = counter_rng::subject(entity::PATIENT, 1);
+    auto       pairs    = std::set<double> {};
+    for (auto x = std::int32_t { 0 }; x < 256; ++x) {
+        const auto source = counter_rng::subject(entity::STAFF, x, 3);
+        pairs.insert(rng.uniform_pair(event::CONTACT, receiver, source));
+    }
+    assert(pairs.size() == 256); // NOLINT
+
+    // A pair draw is not a single draw of the subject
+    assert(rng.uniform_pair(event::CONTACT, receiver, 0) != rng.uniform(event::CONTACT, receiver, 0)); // NOLINT
+    assert(rng.uniform_pair(event::CONTACT, 1, 2) != rng.uniform_pair(event::CONTACT, 2, 1)); // NOLINT
+
+    // The subjects keep the identity of the entity, and the kind separates
+    // the numbers and the cells
+    assert(counter_rng::subject(entity::PATIENT, 5) != counter_rng::subject(entity::PATIENT, 6)); // NOLINT
+    assert(counter_rng::subject(entity::PATIENT, 5) != counter_rng::subject(entity::BED, 5)); // NOLINT
+    assert(counter_rng::subject(entity::STAFF, 2, 3) != counter_rng::subject(entity::CHAIR, 2, 3)); // NOLINT
+    assert(counter_rng::subject(entity::STAFF, 2, 3) != counter_rng::subject(entity::STAFF, 3, 2)); // NOLINT
+    assert(counter_rng::subject(entity::STAFF, 2, 3, 1) == counter_rng::subject(entity::STAFF, 2, 3) + 1); // NOLINT
+    assert(counter_rng::subject(std::string { "a" }) != counter_rng::subject(std::string { "b" })); // NOLINT
+
+    return 0;
+}
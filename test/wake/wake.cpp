@@ -0,0 +1,54 @@
+/// @brief Calendar queue of the parked agents test
+#include "wake_queue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+int main()
+{
+    // Ticks of 60 seconds, a ring of 4 buckets, the agents waiting longer
+    // than a ring stay in their bucket
+    auto queue = sti::wake_queue { 60, 4 };
+    auto woken = std::vector<int> {};
+    auto wake  = [&](sti::datetime::resolution now) {
+        woken.clear();
+        queue.wake(sti::datetime { now }, [&](const auto& id) { woken.push_back(id.id()); });
+        std::sort(woken.begin(), woken.end());
+    };
+
+    queue.park({ 1, 0, 0 }, sti::datetime { 30 });
+    queue.park({ 2, 0, 0 }, sti::datetime { 90 });
+    queue.park({ 3, 0, 0 }, sti::datetime { 600 }); // More than a ring later
+    assert(queue.size() == 3); // NOLINT
+
+    // Woken only once the instant has passed, also inside the bucket
+    wake(30);
+    assert(woken.empty()); // NOLINT
+    wake(31);
+    assert((woken == std::vector<int> { 1 })); // NOLINT
+
+    wake(120);
+    assert((woken == std::vector<int> { 2 })); // NOLINT
+    assert(queue.size() == 1); // NOLINT
+
+    // The bucket of the agent waiting longer comes around before its instant
+    wake(300);
+    assert(woken.empty()); // NOLINT
+    wake(601);
+    assert((woken == std::vector<int> { 3 })); // NOLINT
+    assert(queue.size() == 0); // NOLINT
+
+    // An instant already visited wakes in the next call
+    queue.park({ 4, 0, 0 }, sti::datetime { 10 });
+    wake(660);
+    assert((woken == std::vector<int> { 4 })); // NOLINT
+
+    // A jump longer than the ring visits every bucket once
+    for (auto i = 0; i < 8; ++i) queue.park({ 10 + i, 0, 0 }, sti::datetime { 700U + 60U * static_cast<unsigned>(i) });
+    wake(5000);
+    assert(woken.size() == 8); // NOLINT
+    assert(queue.size() == 0); // NOLINT
+
+    return 0;
+}
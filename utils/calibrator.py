@@ -31,6 +31,9 @@ parser.add_argument('--bed-infection', type=float,
                     help='Bed infection probability')
 parser.add_argument('--icu-chance', type=float,
                     help='ICU environment infection probability')
+parser.add_argument('--restart-folder',
+                    help='Fork every run from this checkpoint, written by a '
+                    '1x1 process run with 10 seconds per tick')
 args = parser.parse_args()
 
 
@@ -322,7 +325,9 @@ def worker(human_infection, human_contamination, chair_infection, bed_infection,
     props = sim.SimulationProperties(1, 1, seconds_per_tick=10,
                                      chair_manager_process=0,
                                      reception_manager_process=0,
-                                     simulation_seed=random.randint(10000, 10000000))
+                                     simulation_seed=random.randint(10000, 10000000),
+                                     restart_folder=args.restart_folder,
+                                     restart_reseed=args.restart_folder is not None)
     simulation = sim.Simulation(props, hospital)
 
     print(f"Starting {simulation.id}")
@@ -8,6 +8,7 @@ import tabulate
 import multiprocessing as mp
 import simulation as sim
 import performance as perf
+import scenario
 
 parser = argparse.ArgumentParser(
     description='Run simulation several times, store results in file')
@@ -28,12 +29,6 @@ def make_simulation(layout: "tuple[int]",
                     doctor_process: int) -> sim.Simulation:
     """Create a simulation with the correct configuration"""
 
-    human_infection = 1.500000e-01
-    human_contamination = 3.000000e-05
-    chair_infection = 8.000000e-06
-    bed_infection = 7.000000e-08
-    icu_chance = 4.800000e-09
-
     width = 53
     height = 36
     hospital = sim.Hospital(width, height)
@@ -115,206 +110,14 @@ def make_simulation(layout: "tuple[int]",
         'int64').to_numpy()
     infected_percentage = year['pneumonia_probability'].to_numpy()
 
-    hospital.parameters = {
-        'human': {
-            'infect_distance': 2.0,
-            'contamination_probability': human_contamination,
-            'incubation_time': {
-                'min': sim.TimePeriod(0, 14, 0, 0),
-                'max': sim.TimePeriod(6, 0,  0, 0)
-            },
-            'infect_probability': human_infection
-        },
-        'objects': {
-            'chair': {
-                'infect_probability': chair_infection,
-                'cleaning_interval': sim.TimePeriod(1, 0, 0, 0)
-            },
-            'bed': {
-                'infect_probability': bed_infection,
-                'cleaning_interval': sim.TimePeriod(1, 0, 0, 0)
-            }
-        },
-        'icu': {
-            'beds': 90,
-            'sleep_times': [
-                {
-                    'time': sim.TimePeriod(2, 14, 24, 0),
-                    'probability': 0.004748328
-                },
-                {
-                    'time': sim.TimePeriod(3, 0, 0, 0),
-                    'probability': 0.088623115
-                },
-                {
-                    'time': sim.TimePeriod(3, 7, 12, 0),
-                    'probability': 0.017333166
-                },
-                {
-                    'time': sim.TimePeriod(3, 16, 48, 0),
-                    'probability': 0.032968386
-                },
-                {
-                    'time': sim.TimePeriod(4, 4, 48, 0),
-                    'probability': 0.013086353
-                },
-                {
-                    'time': sim.TimePeriod(4, 9, 36, 0),
-                    'probability': 0.100335789
-                },
-                {
-                    'time': sim.TimePeriod(4, 16, 48, 0),
-                    'probability': 0.066380434
-                },
-                {
-                    'time': sim.TimePeriod(4, 21, 36, 0),
-                    'probability': 0.000017555
-                },
-                {
-                    'time': sim.TimePeriod(6, 7, 12, 0),
-                    'probability': 0.007899849
-                },
-                {
-                    'time': sim.TimePeriod(6, 9, 36, 0),
-                    'probability': 0.100224175
-                },
-                {
-                    'time': sim.TimePeriod(6, 12, 0, 0),
-                    'probability': 0.084432757
-                },
-                {
-                    'time': sim.TimePeriod(6, 16, 48, 0),
-                    'probability': 0.117953925
-                },
-                {
-                    'time': sim.TimePeriod(7, 9, 36, 0),
-                    'probability': 0.053206605
-                },
-                {
-                    'time': sim.TimePeriod(8, 0, 0, 0),
-                    'probability': 0.026187069
-                },
-                {
-                    'time': sim.TimePeriod(9, 4, 48, 0),
-                    'probability': 0.122177398
-                },
-                {
-                    'time': sim.TimePeriod(9, 7, 12, 0),
-                    'probability': 0.033379033
-                },
-                {
-                    'time': sim.TimePeriod(10, 4, 48, 0),
-                    'probability': 0.037753818
-                },
-                {
-                    'time': sim.TimePeriod(29, 16, 48, 0),
-                    'probability': 0.094000000
-                }
-            ]
-        },
-        'reception': {
-            'attention_time': sim.TimePeriod(0, 0, 1, 0)
-        },
-        'triage': {
-            'icu': {
-                'death_probability': 0.255,
-                'probability': 0.070724557
-            },
-            'doctors_probabilities': [
-                {
-                    'specialty': 'general_practitioner',
-                    'probability': 0.444567551
-                },
-                {
-                    'specialty': 'psychiatrist',
-                    'probability': 0.045610876
-                },
-                {
-                    'specialty': 'surgeon',
-                    'probability': 0.292939085
-                },
-                {
-                    'specialty': 'pediatry',
-                    'probability': 0.051335318
-                },
-                {
-                    'specialty': 'gynecologist',
-                    'probability': 0.075895021
-                },
-                {
-                    'specialty': 'geriatrics',
-                    'probability': 0.018927592
-                },
-            ],
-            'levels': [
-                {
-                    'level': 1,
-                    'probability': 0.0418719,
-                    'wait_time': sim.TimePeriod(0, 0, 0, 0)
-                },
-                {
-                    'level': 2,
-                    'probability': 0.0862069,
-                    'wait_time': sim.TimePeriod(0, 0, 15, 0)
-                },
-                {
-                    'level': 3,
-                    'probability': 0.6305419,
-                    'wait_time': sim.TimePeriod(0, 1, 0, 0)
-                },
-                {
-                    'level': 4,
-                    'probability': 0.2266010,
-                    'wait_time': sim.TimePeriod(0, 2, 0, 0)
-                },
-                {
-                    'level': 5,
-                    'probability': 0.0147783,
-                    'wait_time': sim.TimePeriod(0, 4, 0, 0)
-                }
-            ],
-            'attention_time': sim.TimePeriod(0, 0, 15, 0)
-        },
-        'doctors': [
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'general_practitioner'
-            },
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'psychiatrist'
-            },
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'surgeon'
-            },
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'gynecologist'
-            },
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'geriatrics'
-            },
-            {
-                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
-                'specialty': 'pediatry'
-            },
-        ],
-        'patient': {
-            'walk_speed': 0.2,
-            'infected_probability': infected_percentage,
-            'influx': influx
-        },
-        'personnel': {
-            'immunity': 0.81
-        },
-        'environments': {
-            'icu': {
-                'infection_probability': icu_chance
-            }
-        }
-    }
+    hospital.parameters = scenario.reference_parameters({
+        'general_practitioner': 0.444567551,
+        'psychiatrist': 0.045610876,
+        'surgeon': 0.292939085,
+        'pediatry': 0.051335318,
+        'gynecologist': 0.075895021,
+        'geriatrics': 0.018927592,
+    }, influx, infected_percentage)
 
     hospital.validate()
 
@@ -386,6 +189,138 @@ class LocalConfiguration(object):
         return data
 
 
+class ScalingConfiguration(LocalConfiguration):
+    """A run in a synthetic large hospital, reporting the time of each phase of
+    the tick across processes
+
+    Keyword arguments:
+
+    - tag -- A name to identify the run
+    - layout -- The number of processes along x and y
+    - patients -- Expected number of patients entering the hospital
+    - dimensions -- The width and height of the building
+    - departments -- The number of departments along x and y
+    - days -- The simulated days
+    - seconds_per_tick -- Period of a tick in the simulation
+    """
+
+    def __init__(self,
+                 tag: str,
+                 layout: "tuple[int, int]",
+                 patients: int,
+                 dimensions: "tuple[int, int]" = (500, 500),
+                 departments: "tuple[int, int]" = (4, 4),
+                 days: int = 1,
+                 seconds_per_tick: int = 10):
+
+        # The managers are placed by the simulation, away from the busiest
+        # processes
+        super().__init__(tag, layout, patients, seconds_per_tick,
+                         'auto', 'auto', 'auto', 'auto')
+        self.dimensions = dimensions
+        self.departments = departments
+        self.days = days
+
+    def run(self) -> dict:
+        """Run the simulation, return the metrics with the mean and max time
+        of each phase, in seconds"""
+
+        hospital = scenario.large_hospital(*self.dimensions,
+                                           departments=self.departments,
+                                           patients=self.patients,
+                                           days=self.days)
+        props = sim.SimulationProperties(self.layout[0], self.layout[1],
+                                         seconds_per_tick=self.seconds_per_tick,
+                                         chair_manager_process=self.chair_process,
+                                         reception_manager_process=self.reception_process,
+                                         triage_manager_process=self.triage_process,
+                                         doctors_manager_process=self.doctor_process,
+                                         debug_phases=True,
+                                         simulation_seed=random.randint(10000, 10000000))
+        simulation = sim.Simulation(props, hospital)
+        simulation.run()
+        metrics = perf.Metrics(simulation.folder)
+
+        data = {
+            'run_id': simulation.id,
+            'tag': self.tag,
+            'configuration_type': 'scaling',
+            'x_processes': self.layout[0],
+            'y_processes': self.layout[1],
+            'processes': self.layout[0] * self.layout[1],
+            'width': self.dimensions[0],
+            'height': self.dimensions[1],
+            'departments': self.departments[0] * self.departments[1],
+            'patients': self.patients,
+            'seconds_per_tick': self.seconds_per_tick,
+            'total_time': metrics.total_time.total_seconds()
+        }
+        for phase, times in metrics.phase_imbalance().iterrows():
+            data[f"{phase}_mean"] = times['mean']
+            data[f"{phase}_max"] = times['max']
+        return data
+
+
+def process_layouts(max_processes: int) -> "list[tuple[int, int]]":
+    """Return the layouts for 1, 2, 4... up to max_processes, splitting the
+    building in the most square tiles"""
+    layouts = []
+    k = 0
+    while 2 ** k <= max_processes:
+        x = 2 ** ((k + 1) // 2)
+        layouts.append((x, 2 ** k // x))
+        k += 1
+    return layouts
+
+
+def strong_scaling(file, max_processes: int, patients: int,
+                   dimensions=(500, 500), departments=(4, 4),
+                   repetitions=1, **kwargs):
+    """Return a batch running the same hospital and load in each layout
+
+    Keyword arguments:
+
+    - file -- Output CSV file
+    - max_processes -- The largest number of processes
+    - patients -- Expected number of patients entering the hospital
+    - dimensions -- The width and height of the building
+    - departments -- The number of departments along x and y
+    - repetitions -- Runs of each layout
+    """
+    batch = Batch(file)
+    for layout in process_layouts(max_processes):
+        batch.add_configurations(repetitions, ScalingConfiguration(
+            'strong', layout, patients, dimensions, departments, **kwargs))
+    return batch
+
+
+def weak_scaling(file, max_processes: int, patients_per_process: int,
+                 dimensions_per_process=(250, 250),
+                 departments_per_process=(2, 2), repetitions=1, **kwargs):
+    """Return a batch where the building and the load grow with the layout,
+    so each process keeps the same area, departments and patients
+
+    Keyword arguments:
+
+    - file -- Output CSV file
+    - max_processes -- The largest number of processes
+    - patients_per_process -- Expected number of patients for each process
+    - dimensions_per_process -- The width and height of the tile of a process
+    - departments_per_process -- The departments along x and y in each tile
+    - repetitions -- Runs of each layout
+    """
+    batch = Batch(file)
+    for x, y in process_layouts(max_processes):
+        dimensions = (dimensions_per_process[0] * x,
+                      dimensions_per_process[1] * y)
+        departments = (departments_per_process[0] * x,
+                       departments_per_process[1] * y)
+        batch.add_configurations(repetitions, ScalingConfiguration(
+            'weak', (x, y), patients_per_process * x * y, dimensions,
+            departments, **kwargs))
+    return batch
+
+
 class Batch(object):
     """A collection of configurations, waiting to be executed
 
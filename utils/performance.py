@@ -2,10 +2,11 @@
 
 from collections import namedtuple
 import argparse
-import glob
+import io
 import matplotlib.pyplot as plt
 import pandas as pd
-import re
+
+from postprocess import read_parts
 
 
 class Metrics(object):
@@ -25,15 +26,13 @@ class Metrics(object):
 
     def __init__(self, folderpath):
 
-        tick_files = glob.glob(f"{folderpath}/tick_metrics.p*.csv")
+        tick_parts = read_parts(folderpath, 'tick_metrics', 'csv')
 
         # Per tick metrics can be disable, so the the file may no exist
-        if tick_files:
+        if tick_parts:
             tick_dfs = []
-            for tick_path in tick_files:
-                tick_df = pd.read_csv(tick_path)
-                process = int(
-                    re.match(r'.+tick_metrics\.p(\d+)\.csv', tick_path)[1])
+            for process, data in tick_parts:
+                tick_df = pd.read_csv(io.BytesIO(data))
                 tick_df['process'] = process
                 tick_dfs.append(tick_df)
             tmp_df = pd.concat(tick_dfs)
@@ -56,16 +55,46 @@ class Metrics(object):
             self.ticks['total_mpi_sync'] = self.ticks[[
                 *self.mpi_stages]].sum(axis='columns')
 
-        global_files = glob.glob(f"{folderpath}/global_metrics.p*.csv")
+            # The time waiting for the managers sync. In the pipelined ticks
+            # it finishes after the overlapped work, only the rest is a wait
+            if 'overlap' in tmp_df:
+                pipelined = tmp_df['overlap'] > 0
+                self.ticks['managers_wait'] = self.ticks[self.mpi_stages[0]]
+                self.ticks.loc[pipelined, 'managers_wait'] = (
+                    tmp_df[self.mpi_stages[0]] - tmp_df['overlap'])[pipelined]
+
+            # With the tick graph, the longest chain of the logic phases and
+            # the time of all of them, already durations
+            if 'critical_path' in tmp_df:
+                self.ticks['critical_path'] = tmp_df['critical_path']
+                self.ticks['graph_work'] = tmp_df['graph_work']
+
         global_dfs = []
-        for global_path in global_files:
-            global_df = pd.read_csv(global_path)
-            process = int(
-                re.match(r'.+global_metrics\.p(\d+)\.csv', global_path)[1])
+        for process, data in read_parts(folderpath, 'global_metrics', 'csv'):
+            global_df = pd.read_csv(io.BytesIO(data))
             global_df['process'] = process
             global_dfs.append(global_df)
         self.global_df = pd.concat(global_dfs)
 
+        # The phase profile is written only by the root, already reduced
+        profile_parts = read_parts(folderpath, 'phase_profile', 'csv')
+        histogram_parts = read_parts(folderpath, 'phase_histograms', 'csv')
+        self.phases = (pd.read_csv(io.BytesIO(profile_parts[0][1]))
+                       if profile_parts else None)
+        self.phase_histograms = (pd.read_csv(io.BytesIO(histogram_parts[0][1]))
+                                 if histogram_parts else None)
+
+    def phase_imbalance(self) -> pd.DataFrame:
+        """Return the time of each phase across processes, in seconds, and
+        the ratio between the slowest process and the mean"""
+        if self.phases is None:
+            raise Exception("Run doesn't have the phase profile")
+        df = self.phases.set_index('phase')
+        out = df[['total_min_ns', 'total_mean_ns', 'total_max_ns']] / 1e9
+        out.columns = ['min', 'mean', 'max']
+        out['imbalance'] = df['total_max_ns'] / df['total_mean_ns']
+        return out
+
     @property
     def total_time(self):
         """The total time it took to run the simulation"""
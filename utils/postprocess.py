@@ -9,6 +9,43 @@ from pathlib import Path
 import sys
 sys.path.append(Path(__file__).parent)
 
+def read_parts(folderpath, name, extension):
+    """Load a result of all the processes, as (process, bytes) pairs, from its
+    <name>.p<rank>.<extension> files or from the <name>.<extension> file
+    shared by all of them (output.shared), see output_files.hpp"""
+    shared = Path(folderpath) / f"{name}.{extension}"
+    if not shared.exists():
+        paths = glob.glob(f"{folderpath}/{name}.p*.{extension}")
+        return [(int(re.match(rf'.+\.p(\d+)\.{extension}$', path)[1]),
+                 Path(path).read_bytes()) for path in paths]
+
+    data = shared.read_bytes()
+    magic = b'STI-SHARED 1\n'
+    if not data.startswith(magic):
+        raise Exception(f"{shared} is not a shared output file")
+
+    # A line "@part rank=<rank> bytes=<bytes>" before the part of each process
+    parts = []
+    offset = len(magic)
+    while offset < len(data):
+        end = data.index(b'\n', offset)
+        fields = dict(f.split(b'=') for f in data[offset:end].split()[1:])
+        size = int(fields[b'bytes'])
+        if size > 0:
+            parts.append((int(fields[b'rank']), data[end + 1:end + 1 + size]))
+        offset = end + 1 + size
+    return parts
+
+
+def read_table(path):
+    """Load a table written by the simulation, in CSV or NetCDF format"""
+    if path.endswith('.nc'):
+        import xarray as xr
+        with xr.open_dataset(path) as ds:
+            return ds.to_dataframe().reset_index(drop=True)
+    return pd.read_csv(path)
+
+
 def rename_columns(df: pd.DataFrame):
 
     prefixes = ('infection.', 'diagnosis.')
@@ -30,12 +67,12 @@ def rename_columns(df: pd.DataFrame):
 class AgentsOutput(object):
     """Load the agents output from output files"""
 
-    files_globs = ('agents.p*.json',
-                   'exit.p*.json',
-                   'icu_beds.p*.json',
-                   'chairs.p*.json',
-                   'staff.p*.json',
-                   'morgue.p*.json')
+    files_names = ('agents',
+                   'exit',
+                   'icu_beds',
+                   'chairs',
+                   'staff',
+                   'morgue')
 
     human_cols = ['repast_id', 'type', 'process',
                   'infection_id', 'infection_model', 'infection_mode',
@@ -56,17 +93,15 @@ class AgentsOutput(object):
 
     def __init__(self, folderpath):
 
-        paths = [path for f in self.files_globs
-                 for path in glob.glob(f"{folderpath}/{f}")]
+        parts = [part for name in self.files_names
+                 for part in read_parts(folderpath, name, 'json')]
 
         # Load all the files found
         dfs = []
-        for path in paths:
-            with open(path) as f:
-                data = json.load(f)
-            df = pd.json_normalize(data)
+        for process, data in parts:
+            df = pd.json_normalize(json.loads(data))
             df = rename_columns(df)
-            df['process'] = int(re.match(r'.+\.p(\d+)\.json', path)[1])
+            df['process'] = process
             dfs.append(df)
 
         df = pd.concat(dfs)
@@ -83,17 +118,62 @@ class AgentsOutput(object):
         self.patients = df[df['type'] == 'patient'][self.patient_cols]
 
 
+def read_movements(path):
+    """Load the agents locations of a movements binary file, one row per agent
+    and tick, see movement_recorder.hpp for the format"""
+    import numpy as np
+
+    data = np.fromfile(path, dtype=np.uint8)
+    if data[:8].tobytes() != b'STIMOVE1':
+        raise Exception(f"{path} is not a movements file")
+
+    frame_dtype = np.dtype([('time', '<i8'), ('records', '<u4'), ('flags', '<u4')])
+    record_dtype = np.dtype([('id', '<u8'), ('x', '<f4'), ('y', '<f4')])
+
+    # Replay the frames, keeping the last known location of each agent
+    agents = dict()
+    times, ids, xs, ys = [], [], [], []
+    offset = 16
+    while offset < data.size:
+        frame = data[offset:offset + frame_dtype.itemsize].view(frame_dtype)[0]
+        offset += frame_dtype.itemsize
+        size = int(frame['records']) * record_dtype.itemsize
+        records = data[offset:offset + size].view(record_dtype)
+        offset += size
+
+        if frame['flags'] & 1:
+            agents.clear()
+        for record in records:
+            if np.isnan(record['x']):
+                agents.pop(int(record['id']), None)
+            else:
+                agents[int(record['id'])] = (record['x'], record['y'])
+
+        for agent, (x, y) in agents.items():
+            times.append(int(frame['time']))
+            ids.append(agent)
+            xs.append(x)
+            ys.append(y)
+
+    ids = np.array(ids, dtype=np.uint64)
+    repast_ids = [f"{i & 0xFFFFFFFF}.{(i >> 32) & 0xFFFF}.{i >> 48}"
+                  for i in ids.tolist()]
+    return pd.DataFrame({'datetime': times, 'repast_id': repast_ids,
+                         'x': np.array(xs, dtype=np.float64),
+                         'y': np.array(ys, dtype=np.float64)})
+
+
 class AgentsLocations(object):
     """Load the agents locations generated by a simulation"""
 
-    positions_glob = 'agents_locations.p*.csv'
+    positions_glob = 'movements.p*.bin'
 
     def __init__(self, folderpath):
         paths = glob.glob(f"{folderpath}/{self.positions_glob}")
         dfs = []
         for path in paths:
-            df = pd.read_csv(path)
-            df['process'] = int(re.match(r'.+\.p(\d+)\.csv', path)[1])
+            df = read_movements(path)
+            df['process'] = int(re.match(r'.+\.p(\d+)\.bin', path)[1])
             dfs.append(df)
 
         self.df = pd.concat(dfs)
@@ -0,0 +1,31 @@
+#!/usr/bin/python3
+"""Run the strong or weak scaling sweep in the synthetic large hospital"""
+
+import argparse
+import libbenchmark as bench
+
+parser = argparse.ArgumentParser(
+    description='Sweep the process layouts, store the phase times in a file')
+parser.add_argument('mode', choices=['strong', 'weak'],
+                    help='strong: same hospital for every layout, '
+                         'weak: the hospital grows with the processes')
+parser.add_argument('--file', required=True, help='Output CSV file')
+parser.add_argument('-n', '--max-processes', type=int, default=8,
+                    help='Largest number of processes')
+parser.add_argument('-p', '--patients', type=int, default=10000,
+                    help='Patients, per process in weak scaling')
+parser.add_argument('-d', '--days', type=int, default=1,
+                    help='Simulated days')
+parser.add_argument('-r', '--repetitions', type=int, default=1,
+                    help='Runs of each layout')
+args = parser.parse_args()
+
+if args.mode == 'strong':
+    batch = bench.strong_scaling(args.file, args.max_processes, args.patients,
+                                 repetitions=args.repetitions, days=args.days)
+else:
+    batch = bench.weak_scaling(args.file, args.max_processes, args.patients,
+                               repetitions=args.repetitions, days=args.days)
+
+print(batch.report())
+batch.run()
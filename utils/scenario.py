@@ -0,0 +1,455 @@
+#!/usr/bin/python3
+"""Generate synthetic hospitals and patient influxes, to measure how the
+simulation scales with buildings larger than the reference emergency department
+"""
+
+from pathlib import Path
+import math
+import numpy as np
+import struct
+import simulation as sim
+
+icu_probability = 0.070724557
+
+
+def reference_parameters(doctors_probabilities: "dict[str, float]",
+                         influx: np.ndarray,
+                         infected_probability: np.ndarray) -> dict:
+    """Return the calibrated parameters of the reference hospital
+
+    Keyword arguments:
+
+    - doctors_probabilities -- The chance of a patient being sent to each
+      specialty by the triage, summing 1 with the ICU probability
+    - influx -- The patients entering the hospital, a row per day
+    - infected_probability -- The chance of a patient being infected, per day
+    """
+
+    human_infection = 1.500000e-01
+    human_contamination = 3.000000e-05
+    chair_infection = 8.000000e-06
+    bed_infection = 7.000000e-08
+    icu_chance = 4.800000e-09
+
+    return {
+        'human': {
+            'infect_distance': 2.0,
+            'contamination_probability': human_contamination,
+            'incubation_time': {
+                'min': sim.TimePeriod(0, 14, 0, 0),
+                'max': sim.TimePeriod(6, 0,  0, 0)
+            },
+            'infect_probability': human_infection
+        },
+        'objects': {
+            'chair': {
+                'infect_probability': chair_infection,
+                'cleaning_interval': sim.TimePeriod(1, 0, 0, 0)
+            },
+            'bed': {
+                'infect_probability': bed_infection,
+                'cleaning_interval': sim.TimePeriod(1, 0, 0, 0)
+            }
+        },
+        'icu': {
+            'beds': 90,
+            'sleep_times': [
+                {
+                    'time': sim.TimePeriod(2, 14, 24, 0),
+                    'probability': 0.004748328
+                },
+                {
+                    'time': sim.TimePeriod(3, 0, 0, 0),
+                    'probability': 0.088623115
+                },
+                {
+                    'time': sim.TimePeriod(3, 7, 12, 0),
+                    'probability': 0.017333166
+                },
+                {
+                    'time': sim.TimePeriod(3, 16, 48, 0),
+                    'probability': 0.032968386
+                },
+                {
+                    'time': sim.TimePeriod(4, 4, 48, 0),
+                    'probability': 0.013086353
+                },
+                {
+                    'time': sim.TimePeriod(4, 9, 36, 0),
+                    'probability': 0.100335789
+                },
+                {
+                    'time': sim.TimePeriod(4, 16, 48, 0),
+                    'probability': 0.066380434
+                },
+                {
+                    'time': sim.TimePeriod(4, 21, 36, 0),
+                    'probability': 0.000017555
+                },
+                {
+                    'time': sim.TimePeriod(6, 7, 12, 0),
+                    'probability': 0.007899849
+                },
+                {
+                    'time': sim.TimePeriod(6, 9, 36, 0),
+                    'probability': 0.100224175
+                },
+                {
+                    'time': sim.TimePeriod(6, 12, 0, 0),
+                    'probability': 0.084432757
+                },
+                {
+                    'time': sim.TimePeriod(6, 16, 48, 0),
+                    'probability': 0.117953925
+                },
+                {
+                    'time': sim.TimePeriod(7, 9, 36, 0),
+                    'probability': 0.053206605
+                },
+                {
+                    'time': sim.TimePeriod(8, 0, 0, 0),
+                    'probability': 0.026187069
+                },
+                {
+                    'time': sim.TimePeriod(9, 4, 48, 0),
+                    'probability': 0.122177398
+                },
+                {
+                    'time': sim.TimePeriod(9, 7, 12, 0),
+                    'probability': 0.033379033
+                },
+                {
+                    'time': sim.TimePeriod(10, 4, 48, 0),
+                    'probability': 0.037753818
+                },
+                {
+                    'time': sim.TimePeriod(29, 16, 48, 0),
+                    'probability': 0.094000000
+                }
+            ]
+        },
+        'reception': {
+            'attention_time': sim.TimePeriod(0, 0, 1, 0)
+        },
+        'triage': {
+            'icu': {
+                'death_probability': 0.255,
+                'probability': icu_probability
+            },
+            'doctors_probabilities': [
+                {
+                    'specialty': specialty,
+                    'probability': probability
+                } for specialty, probability in doctors_probabilities.items()
+            ],
+            'levels': [
+                {
+                    'level': 1,
+                    'probability': 0.0418719,
+                    'wait_time': sim.TimePeriod(0, 0, 0, 0)
+                },
+                {
+                    'level': 2,
+                    'probability': 0.0862069,
+                    'wait_time': sim.TimePeriod(0, 0, 15, 0)
+                },
+                {
+                    'level': 3,
+                    'probability': 0.6305419,
+                    'wait_time': sim.TimePeriod(0, 1, 0, 0)
+                },
+                {
+                    'level': 4,
+                    'probability': 0.2266010,
+                    'wait_time': sim.TimePeriod(0, 2, 0, 0)
+                },
+                {
+                    'level': 5,
+                    'probability': 0.0147783,
+                    'wait_time': sim.TimePeriod(0, 4, 0, 0)
+                }
+            ],
+            'attention_time': sim.TimePeriod(0, 0, 15, 0)
+        },
+        'doctors': [
+            {
+                'attention_duration': sim.TimePeriod(0, 0, 15, 0),
+                'specialty': specialty
+            } for specialty in doctors_probabilities
+        ],
+        'patient': {
+            'walk_speed': 0.2,
+            'infected_probability': infected_probability,
+            'influx': influx
+        },
+        'personnel': {
+            'immunity': 0.81
+        },
+        'environments': {
+            'icu': {
+                'infection_probability': icu_chance
+            }
+        }
+    }
+
+
+def patient_influx(days: int, patients: int, intervals=12,
+                   weekly_variation=0.2, seed=None) -> np.ndarray:
+    """Return a patient distribution, a row per day and a column per interval of
+    the day, as in the patient distribution file
+
+    The patients follow a weekly cycle around the mean, and in the day they
+    peak at noon and are the fewest at midnight. The counts are drawn from a
+    Poisson distribution, so different seeds give the same load but not the
+    same arrivals
+
+    Keyword arguments:
+
+    - days -- The number of days
+    - patients -- The expected total number of patients
+    - intervals -- The number of intervals in which each day is divided
+    - weekly_variation -- Relative amplitude of the weekly cycle
+    - seed -- Seed of the random generator
+    """
+    if days < 1 or intervals < 1:
+        raise Exception('days and intervals should be >= 1')
+    rng = np.random.default_rng(seed)
+
+    daily = 1 + weekly_variation * np.cos(2 * np.pi * np.arange(days) / 7)
+    daily = patients * daily / daily.sum()
+
+    hours = (np.arange(intervals) + 0.5) * 24 / intervals
+    profile = 1.5 + np.cos(2 * np.pi * (hours - 12) / 24)
+    profile = profile / profile.sum()
+
+    return rng.poisson(np.outer(daily, profile)).astype('int64')
+
+
+def infected_probability(days: int, mean=0.05, seasonality=0.5) -> np.ndarray:
+    """Return the chance of a patient being infected for each day, following a
+    yearly cycle with the peak in the first day
+
+    Keyword arguments:
+
+    - days -- The number of days
+    - mean -- The mean probability
+    - seasonality -- Relative amplitude of the yearly cycle
+    """
+    day = np.arange(days)
+    probability = mean * (1 + seasonality * np.cos(2 * np.pi * day / 365))
+    if probability.max() >= 1:
+        raise Exception('Infected probability should be < 1')
+    return probability.astype('float64')
+
+
+def large_hospital(width=500, height=500, departments=(4, 4),
+                   doctors_per_department=8, chairs_per_department=150,
+                   receptionists=8, triages=8, patients=10000, days=1,
+                   seed=None) -> sim.Hospital:
+    """Build a hospital with a lobby and a grid of departments
+
+    The lobby spans the bottom of the building, with the entry and exit in the
+    middle, the receptionists at their left and the triages at their right.
+    The departments are walled rooms separated by corridors, each one with a
+    door in the bottom wall, its doctors along the top wall and its waiting
+    chairs in between, every other tile so the patients can walk around them.
+    Each department is a specialty, with the same chance of being chosen in
+    the triage
+
+    Keyword arguments:
+
+    - width -- The width of the building
+    - height -- The height of the building
+    - departments -- The number of departments along x and y
+    - doctors_per_department -- The doctors in each department
+    - chairs_per_department -- The chairs in each department
+    - receptionists -- The number of receptionists
+    - triages -- The number of triages
+    - patients -- The expected number of patients entering the hospital
+    - days -- The number of days of the patient influx
+    - seed -- Seed for the patient influx
+    """
+
+    corridor = 3
+    lobby = 10
+    columns, rows = departments
+    if columns < 1 or rows < 1:
+        raise Exception('There should be at least one department')
+    room_width = (width - 2 - corridor * (columns + 1)) // columns
+    room_height = (height - 2 - lobby - corridor * (rows + 1)) // rows
+    if room_width < 8 or room_height < 10:
+        raise Exception(f"{columns}x{rows} departments don't fit in a "
+                        f"{width}x{height} building")
+    if (room_width - 4) // 3 + 1 < doctors_per_department:
+        raise Exception(f"{doctors_per_department} doctors don't fit in a "
+                        f"department {room_width} tiles wide")
+
+    hospital = sim.Hospital(width, height)
+    entry = (width // 2 - 1, 0)
+    exit = (width // 2 + 1, 0)
+
+    for x in range(width):
+        if (x, 0) not in (entry, exit):
+            hospital.add_element(sim.Wall((x, 0)))
+        hospital.add_element(sim.Wall((x, height - 1)))
+    for y in range(1, height - 1):
+        hospital.add_element(sim.Wall((0, y)))
+        hospital.add_element(sim.Wall((width - 1, y)))
+
+    hospital.add_element(sim.Entry(entry))
+    hospital.add_element(sim.Exit(exit))
+    hospital.add_element(sim.ICU((width - 2, 1)))
+
+    for r in range(receptionists):
+        x = entry[0] - 4 - 3 * r
+        if x < 2:
+            raise Exception(f"{receptionists} receptionists don't fit")
+        hospital.add_element(sim.Receptionist((x, 6), (x, 4)))
+    for t in range(triages):
+        x = exit[0] + 4 + 3 * t
+        if x > width - 4:
+            raise Exception(f"{triages} triages don't fit")
+        hospital.add_element(sim.Triage((x, 5)))
+
+    specialties = []
+    for j in range(rows):
+        for i in range(columns):
+            specialty = f"department_{len(specialties)}"
+            specialties.append(specialty)
+
+            x0 = 1 + corridor + i * (room_width + corridor)
+            y0 = 1 + lobby + corridor + j * (room_height + corridor)
+            x1 = x0 + room_width - 1
+            y1 = y0 + room_height - 1
+            door = (x0 + room_width // 2, x0 + room_width // 2 + 1)
+
+            for x in range(x0, x1 + 1):
+                if x not in door:
+                    hospital.add_element(sim.Wall((x, y0)))
+                hospital.add_element(sim.Wall((x, y1)))
+            for y in range(y0 + 1, y1):
+                hospital.add_element(sim.Wall((x0, y)))
+                hospital.add_element(sim.Wall((x1, y)))
+
+            for d in range(doctors_per_department):
+                x = x0 + 2 + 3 * d
+                hospital.add_element(sim.DoctorOffice(
+                    specialty, (x, y1 - 1), (x, y1 - 2)))
+
+            seats = [(x, y)
+                     for y in range(y0 + 2, y1 - 3, 2)
+                     for x in range(x0 + 2, x1 - 1, 2)]
+            if len(seats) < chairs_per_department:
+                raise Exception(f"{chairs_per_department} chairs don't fit in "
+                                f"a {room_width}x{room_height} department")
+            for seat in seats[:chairs_per_department]:
+                hospital.add_element(sim.Chair(seat))
+
+    # Round up, the triage probabilities should sum at least 1
+    share = (1 - icu_probability) / len(specialties) * (1 + 1e-9)
+    hospital.parameters = reference_parameters(
+        {specialty: share for specialty in specialties},
+        patient_influx(days, patients, seed=seed),
+        infected_probability(days))
+    hospital.validate()
+    return hospital
+
+
+def save_plan(hospital: sim.Hospital, path):
+    """Save the building in the binary plan file format
+
+    Keyword arguments:
+
+    - hospital -- The hospital to save
+    - path -- The path of the plan file
+    """
+    width, height = hospital.dimensions
+    specialties = [d['specialty'] for d in hospital.parameters['doctors']]
+    if len(specialties) > 128:
+        raise Exception('The plan format supports up to 128 specialties')
+
+    codes = {
+        sim.Wall: 0x01,
+        sim.Chair: 0x10,
+        sim.Entry: 0x40,
+        sim.Exit: 0x41,
+        sim.ICU: 0x43,
+    }
+    tiles = np.zeros((width, height), dtype=np.uint8)
+    for element in hospital.elements:
+        if isinstance(element, sim.DoctorOffice):
+            location = element.doctor_location
+            code = 0x80 + specialties.index(element.specialty)
+        elif isinstance(element, sim.Receptionist):
+            location = element.receptionist_location
+            code = 0x60
+        elif isinstance(element, sim.Triage):
+            location = element.patient_location
+            code = 0x42
+        else:
+            location = element.location
+            code = codes[type(element)]
+        tiles[location.x, location.y] = code
+
+    # The tiles are stored column wise, the y coordinate changes first
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<4sII4x', b'PLA\x01', width, height))
+        f.write(tiles.tobytes(order='C'))
+
+
+def save_influx(influx: np.ndarray, path):
+    """Save a patient distribution in the patient distribution file format
+
+    Keyword arguments:
+
+    - influx -- The patients entering the hospital, a row per day
+    - path -- The path of the CSV file
+    """
+    np.savetxt(path, influx, fmt='%d', delimiter=',')
+
+
+def save(hospital: sim.Hospital, folder):
+    """Save the hospital file, the plan and the patient distribution of a
+    scenario in a folder"""
+    folder = Path(folder)
+    folder.mkdir(parents=True, exist_ok=True)
+    hospital.save(folder)
+    save_plan(hospital, folder/'plan.bin')
+    save_influx(hospital.parameters['patient']['influx'], folder/'influx.csv')
+
+
+if __name__ == '__main__':
+    import argparse
+
+    def pair(value: str) -> "tuple[int, int]":
+        x, y = value.lower().split('x')
+        return int(x), int(y)
+
+    parser = argparse.ArgumentParser(
+        description='Generate a synthetic hospital and its patient influx')
+    parser.add_argument('folder', help='Output folder')
+    parser.add_argument('--size', type=pair, default=(500, 500),
+                        help='Building WIDTHxHEIGHT, 500x500 by default')
+    parser.add_argument('--departments', type=pair, default=(4, 4),
+                        help='Departments COLUMNSxROWS, 4x4 by default')
+    parser.add_argument('--doctors', type=int, default=8,
+                        help='Doctors per department')
+    parser.add_argument('--chairs', type=int, default=150,
+                        help='Chairs per department')
+    parser.add_argument('--patients', type=int, default=10000,
+                        help='Expected number of patients')
+    parser.add_argument('--days', type=int, default=1,
+                        help='Days of the patient influx')
+    parser.add_argument('--seed', type=int, help='Seed of the patient influx')
+    args = parser.parse_args()
+
+    hospital = large_hospital(*args.size, departments=args.departments,
+                              doctors_per_department=args.doctors,
+                              chairs_per_department=args.chairs,
+                              patients=args.patients, days=args.days,
+                              seed=args.seed)
+    save(hospital, args.folder)
+    print(f"{hospital.dimensions[0]}x{hospital.dimensions[1]} hospital with "
+          f"{len(hospital.parameters['doctors'])} departments and "
+          f"{sum(isinstance(e, sim.Chair) for e in hospital.elements)} chairs, "
+          f"{hospital.parameters['patient']['influx'].sum()} patients")
@@ -638,18 +638,47 @@ class SimulationProperties(object):
         - x -- Number of processes in which to split the map along the x axis
         - y -- Number of processes in which to split the map along the y axis
         - seconds_per_tick -- Period of a tick in the simulation
-        - chair_manager_process -- Rank of the process containing the chair pool
-        - reception_manager_process -- Rank of the process containing the reception queue
-        - triage_manager_process -- Rank of the process containing the triage queue
-        - doctors_manager_process -- Rank of the process containing the doctors queues
+        - chair_manager_process -- Rank of the process containing the chair pool,
+          'auto' to place it from the plan, 'sharded' to split it between the
+          processes, or 'rma' to claim the chairs in an MPI RMA window
+        - reception_manager_process -- Rank of the process containing the reception queue,
+          or 'auto' to place it from the plan
+        - triage_manager_process -- Rank of the process containing the triage queue,
+          or 'auto' to place it from the plan
+        - doctors_manager_process -- Rank of the process containing the doctors queues,
+          or 'auto' to place it from the plan
         - simulation_seed -- Int used as a random seed for the simulation
         - debug_performance -- Collect performance statistics inside the simulation 
+        - debug_pathfinder -- Collect the pathfinder cache hits and time spent
+        - debug_phases -- Profile the phases of the tick, aggregated across processes
+        - pathfinder_flow_fields -- Precompute the paths to all destinations at
+          startup, True for a copy per process, 'shared' for a copy per node
+        - pathfinder_cache_file -- File used to persist the paths across runs, or None
+        - track_movements -- Record the location of the agents every tick
+        - balanced_decomposition -- Choose the process layout and the borders
+          of the processes from the plan, instead of using x and y
+        - infectious_ghosts -- Only send to the neighbour processes the
+          infectious humans, instead of all the agents in the borders
+        - checkpoint_ticks -- Ticks after which the whole state is saved to
+          the checkpoint folder of the output
+        - restart_folder -- Checkpoint to continue from, or None. It must be
+          written with the same process layout and seconds per tick
+        - restart_reseed -- Continue the checkpoint with simulation_seed,
+          instead of the seed of the checkpointed run
+        - rma_icu_admission -- Reserve the ICU beds in an MPI RMA window,
+          instead of sending the requests to the process of the ICU
     """
 
     def __init__(self, x=1, y=1, seconds_per_tick=60, chair_manager_process=0,
                  reception_manager_process=0, triage_manager_process=0,
                  doctors_manager_process=0, simulation_seed=1574454,
-                 debug_performance=False):
+                 debug_performance=False, debug_pathfinder=False,
+                 debug_phases=False,
+                 pathfinder_flow_fields=False,
+                 pathfinder_cache_file=None, track_movements=False,
+                 balanced_decomposition=False, infectious_ghosts=False,
+                 checkpoint_ticks=(), restart_folder=None,
+                 restart_reseed=False, rma_icu_admission=False):
 
         self.process_layout = (x, y)
         self.number_of_processes = x * y
@@ -660,6 +689,17 @@ class SimulationProperties(object):
         self.doctors_manager_process = doctors_manager_process
         self.simulation_seed = simulation_seed
         self.debug_performance = debug_performance
+        self.debug_pathfinder = debug_pathfinder
+        self.debug_phases = debug_phases
+        self.pathfinder_flow_fields = pathfinder_flow_fields
+        self.pathfinder_cache_file = pathfinder_cache_file
+        self.track_movements = track_movements
+        self.balanced_decomposition = balanced_decomposition
+        self.infectious_ghosts = infectious_ghosts
+        self.checkpoint_ticks = checkpoint_ticks
+        self.restart_folder = restart_folder
+        self.restart_reseed = restart_reseed
+        self.rma_icu_admission = rma_icu_admission
 
     @property
     def process_layout(self):
@@ -695,8 +735,12 @@ class SimulationProperties(object):
 
     @chair_manager_process.setter
     def chair_manager_process(self, value):
+        if value in ('auto', 'sharded', 'rma'):
+            self._chair_manager_process = value
+            return
         if not isinstance(value, int):
-            raise Exception('chair_manager_process should be an int')
+            raise Exception(
+                "chair_manager_process should be an int, 'auto', 'sharded' or 'rma'")
         if not 0 <= value < self.number_of_processes:
             raise Exception(('chair_manager_process should be in the range '
                              f"[0, {self.number_of_processes}"))
@@ -708,8 +752,11 @@ class SimulationProperties(object):
 
     @reception_manager_process.setter
     def reception_manager_process(self, value):
+        if value == 'auto':
+            self._reception_manager_process = value
+            return
         if not isinstance(value, int):
-            raise Exception('reception_manager_process should be an int')
+            raise Exception("reception_manager_process should be an int or 'auto'")
         if not 0 <= value < self.number_of_processes:
             raise Exception(('reception_manager_process should be in the range '
                              f"[0, {self.number_of_processes}"))
@@ -721,8 +768,11 @@ class SimulationProperties(object):
 
     @triage_manager_process.setter
     def triage_manager_process(self, value):
+        if value == 'auto':
+            self._triage_manager_process = value
+            return
         if not isinstance(value, int):
-            raise Exception('triage_manager_process should be an int')
+            raise Exception("triage_manager_process should be an int or 'auto'")
         if not 0 <= value < self.number_of_processes:
             raise Exception(('triage_manager_process should be in the range '
                              f"[0, {self.number_of_processes}"))
@@ -734,8 +784,11 @@ class SimulationProperties(object):
 
     @doctors_manager_process.setter
     def doctors_manager_process(self, value):
+        if value == 'auto':
+            self._doctors_manager_process = value
+            return
         if not isinstance(value, int):
-            raise Exception('doctors_manager_process should be an int')
+            raise Exception("doctors_manager_process should be an int or 'auto'")
         if not 0 <= value < self.number_of_processes:
             raise Exception(('doctors_manager_process should be in the range '
                              f"[0, {self.number_of_processes}"))
@@ -761,6 +814,117 @@ class SimulationProperties(object):
             raise Exception('debug_performance should be a bool')
         self._debug_performance = value
 
+    @property
+    def debug_pathfinder(self):
+        return self._debug_pathfinder
+
+    @debug_pathfinder.setter
+    def debug_pathfinder(self, value):
+        if not isinstance(value, bool):
+            raise Exception('debug_pathfinder should be a bool')
+        self._debug_pathfinder = value
+
+    @property
+    def debug_phases(self):
+        return self._debug_phases
+
+    @debug_phases.setter
+    def debug_phases(self, value):
+        if not isinstance(value, bool):
+            raise Exception('debug_phases should be a bool')
+        self._debug_phases = value
+
+    @property
+    def pathfinder_flow_fields(self):
+        return self._pathfinder_flow_fields
+
+    @pathfinder_flow_fields.setter
+    def pathfinder_flow_fields(self, value):
+        if not isinstance(value, bool) and value != 'shared':
+            raise Exception(
+                "pathfinder_flow_fields should be a bool or 'shared'")
+        self._pathfinder_flow_fields = value
+
+    @property
+    def pathfinder_cache_file(self):
+        return self._pathfinder_cache_file
+
+    @pathfinder_cache_file.setter
+    def pathfinder_cache_file(self, value):
+        if value is not None and not isinstance(value, (str, Path)):
+            raise Exception('pathfinder_cache_file should be a path or None')
+        self._pathfinder_cache_file = value
+
+    @property
+    def track_movements(self):
+        return self._track_movements
+
+    @track_movements.setter
+    def track_movements(self, value):
+        if not isinstance(value, bool):
+            raise Exception('track_movements should be a bool')
+        self._track_movements = value
+
+    @property
+    def balanced_decomposition(self):
+        return self._balanced_decomposition
+
+    @balanced_decomposition.setter
+    def balanced_decomposition(self, value):
+        if not isinstance(value, bool):
+            raise Exception('balanced_decomposition should be a bool')
+        self._balanced_decomposition = value
+
+    @property
+    def infectious_ghosts(self):
+        return self._infectious_ghosts
+
+    @infectious_ghosts.setter
+    def infectious_ghosts(self, value):
+        if not isinstance(value, bool):
+            raise Exception('infectious_ghosts should be a bool')
+        self._infectious_ghosts = value
+
+    @property
+    def checkpoint_ticks(self):
+        return self._checkpoint_ticks
+
+    @checkpoint_ticks.setter
+    def checkpoint_ticks(self, value):
+        if not all(isinstance(t, int) and t > 0 for t in value):
+            raise Exception('checkpoint_ticks should be positive ints')
+        self._checkpoint_ticks = tuple(value)
+
+    @property
+    def restart_folder(self):
+        return self._restart_folder
+
+    @restart_folder.setter
+    def restart_folder(self, value):
+        if value is not None and not isinstance(value, (str, Path)):
+            raise Exception('restart_folder should be a path or None')
+        self._restart_folder = value
+
+    @property
+    def restart_reseed(self):
+        return self._restart_reseed
+
+    @restart_reseed.setter
+    def restart_reseed(self, value):
+        if not isinstance(value, bool):
+            raise Exception('restart_reseed should be a bool')
+        self._restart_reseed = value
+
+    @property
+    def rma_icu_admission(self):
+        return self._rma_icu_admission
+
+    @rma_icu_admission.setter
+    def rma_icu_admission(self, value):
+        if not isinstance(value, bool):
+            raise Exception('rma_icu_admission should be a bool')
+        self._rma_icu_admission = value
+
     def save(self, folder, run_id):
         """Save the properties to a file"""
 
@@ -776,18 +940,45 @@ class SimulationProperties(object):
                 f"reception.manager.rank = {self.reception_manager_process}\n")
             f.write(f"triage.manager.rank = {self.triage_manager_process}\n")
             f.write(f"doctors.manager.rank = {self.doctors_manager_process}\n")
+            f.write(
+                f"icu.admission = {'rma' if self.rma_icu_admission else 'exchange'}\n")
+            f.write(
+                f"space.decomposition = {'balanced' if self.balanced_decomposition else 'uniform'}\n")
+            f.write(
+                f"space.ghosts = {'infectious' if self.infectious_ghosts else 'all'}\n")
 
             f.write('# Output\n')
             f.write(f"output.folder = {folder.absolute()}\n")
 
             f.write('# Debug\n')
             f.write(f"debug.performance.metrics = {self.debug_performance}\n")
+            f.write(
+                f"debug.pathfinder.statistics = {str(self.debug_pathfinder).lower()}\n")
+            f.write(
+                f"debug.phase.profile = {str(self.debug_phases).lower()}\n")
+            f.write(
+                f"movements.track = {str(self.track_movements).lower()}\n")
 
             f.write('# Hospital file\n')
             f.write(f"hospital.file = {folder.absolute()/'hospital.json'}\n")
 
             f.write('# Simulation\n')
             f.write(f"seconds.per.tick = {self.seconds_per_tick}\n")
+            f.write(
+                f"pathfinder.flow.fields = {str(self.pathfinder_flow_fields).lower()}\n")
+            if self.pathfinder_cache_file is not None:
+                f.write(
+                    f"pathfinder.cache.file = {Path(self.pathfinder_cache_file).absolute()}\n")
+
+            f.write('# Checkpoints\n')
+            if self.checkpoint_ticks:
+                f.write(
+                    f"checkpoint.ticks = {','.join(str(t) for t in self.checkpoint_ticks)}\n")
+            if self.restart_folder is not None:
+                f.write(
+                    f"restart.folder = {Path(self.restart_folder).absolute()}\n")
+                f.write(
+                    f"restart.reseed = {str(self.restart_reseed).lower()}\n")
 
             f.write('# Randomness\n')
             f.write(f"random.seed = {self.simulation_seed}\n")